@@ -0,0 +1,307 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file bench_json.c
+ * @brief Benchmarks of searching shadow documents of several sizes with
+ * coreJSON, and with the JSON index of the shadow demo.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Include the JSON library. */
+#include "core_json.h"
+
+/* Include the JSON index of the shadow demo. */
+#include "shadow_json_index.h"
+
+#include "benchmark.h"
+
+/**
+ * @brief Numbers of reported properties of the benchmarked documents, which
+ * make documents of about 200 bytes, 4 kB and 30 kB.
+ */
+#define JSON_PROPERTY_COUNTS        { 2U, 64U, 512U }
+
+/**
+ * @brief Largest number in #JSON_PROPERTY_COUNTS.
+ */
+#define JSON_MAX_PROPERTY_COUNT     ( 512U )
+
+/**
+ * @brief Size of the document buffer, for #JSON_MAX_PROPERTY_COUNT
+ * properties with their metadata.
+ */
+#define JSON_DOCUMENT_SIZE          ( 65536U )
+
+/**
+ * @brief Entries of the JSON index: every property and its metadata, their
+ * enclosing objects and the top-level members.
+ */
+#define JSON_INDEX_ENTRIES          ( ( 3U * JSON_MAX_PROPERTY_COUNT ) + 16U )
+
+/**
+ * @brief Query of the last member of the document, which a search finds
+ * after scanning the whole document.
+ */
+#define JSON_VERSION_QUERY          "version"
+
+/**
+ * @brief A document and a key path to search in it.
+ */
+typedef struct JsonBenchmark
+{
+    char * pDocument;      /**< @brief The document. */
+    size_t documentLength; /**< @brief Length of the document. */
+    const char * pQuery;   /**< @brief The key path. */
+    size_t queryLength;    /**< @brief Length of the key path. */
+    JsonIndex_t index;     /**< @brief The index of the document. */
+} JsonBenchmark_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The benchmarked document.
+ */
+static char document[ JSON_DOCUMENT_SIZE ];
+
+/**
+ * @brief Storage of the index of the document.
+ */
+static JsonIndexEntry_t indexEntries[ JSON_INDEX_ENTRIES ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write a shadow document with reported properties and their metadata.
+ *
+ * @param[out] pBuffer Buffer to write the document into.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in] propertyCount Number of reported properties.
+ *
+ * @return Length of the document.
+ */
+static size_t writeDocument( char * pBuffer,
+                             size_t bufferSize,
+                             size_t propertyCount );
+
+/**
+ * @brief Validate the document.
+ *
+ * @param[in] pContext The #JsonBenchmark_t.
+ * @param[in] iterations Number of validations.
+ */
+static void validate( void * pContext,
+                      uint64_t iterations );
+
+/**
+ * @brief Search the key path in the document with JSON_Search.
+ *
+ * @param[in] pContext The #JsonBenchmark_t.
+ * @param[in] iterations Number of searches.
+ */
+static void search( void * pContext,
+                    uint64_t iterations );
+
+/**
+ * @brief Build the index of the document.
+ *
+ * @param[in] pContext The #JsonBenchmark_t.
+ * @param[in] iterations Number of builds.
+ */
+static void buildIndex( void * pContext,
+                        uint64_t iterations );
+
+/**
+ * @brief Look up the key path in the index of the document.
+ *
+ * @param[in] pContext The #JsonBenchmark_t.
+ * @param[in] iterations Number of lookups.
+ */
+static void searchIndex( void * pContext,
+                         uint64_t iterations );
+
+/*-----------------------------------------------------------*/
+
+static size_t writeDocument( char * pBuffer,
+                             size_t bufferSize,
+                             size_t propertyCount )
+{
+    size_t length = 0U;
+    size_t property = 0U;
+
+    length += ( size_t ) snprintf( &pBuffer[ length ], bufferSize - length, "{\"state\":{\"reported\":{" );
+
+    for( property = 0U; property < propertyCount; property++ )
+    {
+        length += ( size_t ) snprintf( &pBuffer[ length ], bufferSize - length,
+                                       "%s\"sensor%lu\":%lu",
+                                       ( property == 0U ) ? "" : ",",
+                                       ( unsigned long ) property,
+                                       ( unsigned long ) ( 1000U + property ) );
+    }
+
+    length += ( size_t ) snprintf( &pBuffer[ length ], bufferSize - length, "}},\"metadata\":{\"reported\":{" );
+
+    for( property = 0U; property < propertyCount; property++ )
+    {
+        length += ( size_t ) snprintf( &pBuffer[ length ], bufferSize - length,
+                                       "%s\"sensor%lu\":{\"timestamp\":1600000000}",
+                                       ( property == 0U ) ? "" : ",",
+                                       ( unsigned long ) property );
+    }
+
+    length += ( size_t ) snprintf( &pBuffer[ length ], bufferSize - length,
+                                   "}},\"timestamp\":1600000000,\"clientToken\":\"benchmark\",\"version\":42}" );
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+static void validate( void * pContext,
+                      uint64_t iterations )
+{
+    const JsonBenchmark_t * pBenchmark = ( const JsonBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    JSONStatus_t status = JSONSuccess;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        status = JSON_Validate( pBenchmark->pDocument, pBenchmark->documentLength );
+        Benchmark_Consume( &status );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void search( void * pContext,
+                    uint64_t iterations )
+{
+    const JsonBenchmark_t * pBenchmark = ( const JsonBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    char * pValue = NULL;
+    size_t valueLength = 0U;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) JSON_Search( pBenchmark->pDocument,
+                              pBenchmark->documentLength,
+                              pBenchmark->pQuery,
+                              pBenchmark->queryLength,
+                              '.',
+                              &pValue,
+                              &valueLength );
+        Benchmark_Consume( pValue );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void buildIndex( void * pContext,
+                        uint64_t iterations )
+{
+    JsonBenchmark_t * pBenchmark = ( JsonBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    JsonIndexStatus_t status = JsonIndexSuccess;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        status = JsonIndex_Build( &pBenchmark->index,
+                                  indexEntries,
+                                  JSON_INDEX_ENTRIES,
+                                  pBenchmark->pDocument,
+                                  pBenchmark->documentLength );
+        Benchmark_Consume( &status );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void searchIndex( void * pContext,
+                         uint64_t iterations )
+{
+    const JsonBenchmark_t * pBenchmark = ( const JsonBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    const char * pValue = NULL;
+    size_t valueLength = 0U;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) JsonIndex_Get( &pBenchmark->index,
+                                pBenchmark->pQuery,
+                                pBenchmark->queryLength,
+                                '.',
+                                &pValue,
+                                &valueLength );
+        Benchmark_Consume( pValue );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_Json( void )
+{
+    static JsonBenchmark_t benchmark;
+    const size_t propertyCounts[] = JSON_PROPERTY_COUNTS;
+    char nestedQuery[ 48 ];
+    char name[ 64 ];
+    size_t index = 0U;
+
+    benchmark.pDocument = document;
+
+    for( index = 0U; index < ( sizeof( propertyCounts ) / sizeof( propertyCounts[ 0 ] ) ); index++ )
+    {
+        benchmark.documentLength = writeDocument( document, sizeof( document ), propertyCounts[ index ] );
+
+        ( void ) snprintf( name, sizeof( name ), "json_validate/%lu", ( unsigned long ) benchmark.documentLength );
+        Benchmark_Run( name, validate, &benchmark );
+
+        /* The last member, and the last reported property. */
+        benchmark.pQuery = JSON_VERSION_QUERY;
+        benchmark.queryLength = sizeof( JSON_VERSION_QUERY ) - 1U;
+        ( void ) snprintf( name, sizeof( name ), "json_search_version/%lu", ( unsigned long ) benchmark.documentLength );
+        Benchmark_Run( name, search, &benchmark );
+
+        benchmark.pQuery = nestedQuery;
+        benchmark.queryLength = ( size_t ) snprintf( nestedQuery, sizeof( nestedQuery ),
+                                                     "state.reported.sensor%lu",
+                                                     ( unsigned long ) ( propertyCounts[ index ] - 1U ) );
+        ( void ) snprintf( name, sizeof( name ), "json_search_nested/%lu", ( unsigned long ) benchmark.documentLength );
+        Benchmark_Run( name, search, &benchmark );
+
+        /* The index is built once to look up every key path of a document. */
+        ( void ) snprintf( name, sizeof( name ), "json_index_build/%lu", ( unsigned long ) benchmark.documentLength );
+        Benchmark_Run( name, buildIndex, &benchmark );
+
+        ( void ) JsonIndex_Build( &benchmark.index,
+                                  indexEntries,
+                                  JSON_INDEX_ENTRIES,
+                                  benchmark.pDocument,
+                                  benchmark.documentLength );
+        ( void ) snprintf( name, sizeof( name ), "json_index_get_nested/%lu", ( unsigned long ) benchmark.documentLength );
+        Benchmark_Run( name, searchIndex, &benchmark );
+    }
+}
@@ -0,0 +1,292 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file bench_serializer.c
+ * @brief Benchmarks of serializing and deserializing MQTT packets.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Include the MQTT serializer. */
+#include "core_mqtt_serializer.h"
+
+#include "benchmark.h"
+
+/**
+ * @brief Payload sizes of the benchmarked PUBLISH packets.
+ */
+#define SERIALIZER_PAYLOAD_SIZES       { 16U, 256U, SERIALIZER_MAX_PAYLOAD_SIZE }
+
+/**
+ * @brief Largest size in #SERIALIZER_PAYLOAD_SIZES.
+ */
+#define SERIALIZER_MAX_PAYLOAD_SIZE    ( 4096U )
+
+/**
+ * @brief Size of the buffer packets are serialized into.
+ */
+#define SERIALIZER_BUFFER_SIZE         ( SERIALIZER_MAX_PAYLOAD_SIZE + 128U )
+
+/**
+ * @brief Topic of the PUBLISH packets.
+ */
+#define SERIALIZER_TOPIC               "$aws/things/benchmark/shadow/update"
+
+/**
+ * @brief Client identifier of the CONNECT packet.
+ */
+#define SERIALIZER_CLIENT_IDENTIFIER   "benchmark-client"
+
+/**
+ * @brief A PUBLISH and the buffer it is serialized into.
+ */
+typedef struct SerializerBenchmark
+{
+    MQTTPublishInfo_t publishInfo; /**< @brief The PUBLISH. */
+    MQTTFixedBuffer_t buffer;      /**< @brief The buffer. */
+    MQTTPacketInfo_t packetInfo;   /**< @brief The serialized packet, to deserialize. */
+} SerializerBenchmark_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Storage of the serialized packets, and the payload.
+ */
+static uint8_t packetBuffer[ SERIALIZER_BUFFER_SIZE ];
+static uint8_t payload[ SERIALIZER_MAX_PAYLOAD_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Serialize a QoS 1 PUBLISH, including computing its size.
+ *
+ * @param[in] pContext The #SerializerBenchmark_t.
+ * @param[in] iterations Number of packets.
+ */
+static void serializePublish( void * pContext,
+                              uint64_t iterations );
+
+/**
+ * @brief Deserialize the PUBLISH serialized in the buffer.
+ *
+ * @param[in] pContext The #SerializerBenchmark_t.
+ * @param[in] iterations Number of packets.
+ */
+static void deserializePublish( void * pContext,
+                                uint64_t iterations );
+
+/**
+ * @brief Serialize a PUBACK.
+ *
+ * @param[in] pContext The #SerializerBenchmark_t.
+ * @param[in] iterations Number of packets.
+ */
+static void serializeAck( void * pContext,
+                          uint64_t iterations );
+
+/**
+ * @brief Deserialize the PUBACK serialized in the buffer.
+ *
+ * @param[in] pContext The #SerializerBenchmark_t.
+ * @param[in] iterations Number of packets.
+ */
+static void deserializeAck( void * pContext,
+                            uint64_t iterations );
+
+/**
+ * @brief Serialize a CONNECT, including computing its size.
+ *
+ * @param[in] pContext The #SerializerBenchmark_t.
+ * @param[in] iterations Number of packets.
+ */
+static void serializeConnect( void * pContext,
+                              uint64_t iterations );
+
+/**
+ * @brief Describe a packet in the buffer for deserializing it.
+ *
+ * @param[in,out] pBenchmark The benchmark.
+ * @param[in] packetSize Size of the packet.
+ * @param[in] remainingLength Remaining length of the packet.
+ */
+static void setPacketInfo( SerializerBenchmark_t * pBenchmark,
+                           size_t packetSize,
+                           size_t remainingLength );
+
+/*-----------------------------------------------------------*/
+
+static void serializePublish( void * pContext,
+                              uint64_t iterations )
+{
+    SerializerBenchmark_t * pBenchmark = ( SerializerBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+    MQTTStatus_t status = MQTTSuccess;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) MQTT_GetPublishPacketSize( &pBenchmark->publishInfo, &remainingLength, &packetSize );
+        status = MQTT_SerializePublish( &pBenchmark->publishInfo,
+                                        ( uint16_t ) ( ( iteration & 0x7FFFU ) + 1U ),
+                                        remainingLength,
+                                        &pBenchmark->buffer );
+        Benchmark_Consume( &status );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void deserializePublish( void * pContext,
+                                uint64_t iterations )
+{
+    SerializerBenchmark_t * pBenchmark = ( SerializerBenchmark_t * ) pContext;
+    MQTTPublishInfo_t publishInfo;
+    uint64_t iteration = 0U;
+    uint16_t packetId = 0U;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) MQTT_DeserializePublish( &pBenchmark->packetInfo, &packetId, &publishInfo );
+        Benchmark_Consume( &publishInfo );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void serializeAck( void * pContext,
+                          uint64_t iterations )
+{
+    SerializerBenchmark_t * pBenchmark = ( SerializerBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    MQTTStatus_t status = MQTTSuccess;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        status = MQTT_SerializeAck( &pBenchmark->buffer,
+                                    MQTT_PACKET_TYPE_PUBACK,
+                                    ( uint16_t ) ( ( iteration & 0x7FFFU ) + 1U ) );
+        Benchmark_Consume( &status );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void deserializeAck( void * pContext,
+                            uint64_t iterations )
+{
+    SerializerBenchmark_t * pBenchmark = ( SerializerBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    uint16_t packetId = 0U;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) MQTT_DeserializeAck( &pBenchmark->packetInfo, &packetId, NULL );
+        Benchmark_Consume( &packetId );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void serializeConnect( void * pContext,
+                              uint64_t iterations )
+{
+    SerializerBenchmark_t * pBenchmark = ( SerializerBenchmark_t * ) pContext;
+    MQTTConnectInfo_t connectInfo;
+    uint64_t iteration = 0U;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+    MQTTStatus_t status = MQTTSuccess;
+
+    ( void ) memset( &connectInfo, 0x00, sizeof( connectInfo ) );
+    connectInfo.cleanSession = true;
+    connectInfo.keepAliveSeconds = 60U;
+    connectInfo.pClientIdentifier = SERIALIZER_CLIENT_IDENTIFIER;
+    connectInfo.clientIdentifierLength = ( uint16_t ) ( sizeof( SERIALIZER_CLIENT_IDENTIFIER ) - 1U );
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) MQTT_GetConnectPacketSize( &connectInfo, NULL, &remainingLength, &packetSize );
+        status = MQTT_SerializeConnect( &connectInfo, NULL, remainingLength, &pBenchmark->buffer );
+        Benchmark_Consume( &status );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void setPacketInfo( SerializerBenchmark_t * pBenchmark,
+                           size_t packetSize,
+                           size_t remainingLength )
+{
+    /* The remaining data follows the fixed header. */
+    ( void ) memset( &pBenchmark->packetInfo, 0x00, sizeof( pBenchmark->packetInfo ) );
+    pBenchmark->packetInfo.type = packetBuffer[ 0 ];
+    pBenchmark->packetInfo.pRemainingData = &packetBuffer[ packetSize - remainingLength ];
+    pBenchmark->packetInfo.remainingLength = remainingLength;
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_Serializer( void )
+{
+    static SerializerBenchmark_t benchmark;
+    const size_t payloadSizes[] = SERIALIZER_PAYLOAD_SIZES;
+    char name[ 64 ];
+    size_t index = 0U;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+
+    ( void ) memset( payload, 'x', sizeof( payload ) );
+    ( void ) memset( &benchmark, 0x00, sizeof( benchmark ) );
+    benchmark.buffer.pBuffer = packetBuffer;
+    benchmark.buffer.size = sizeof( packetBuffer );
+    benchmark.publishInfo.qos = MQTTQoS1;
+    benchmark.publishInfo.pTopicName = SERIALIZER_TOPIC;
+    benchmark.publishInfo.topicNameLength = ( uint16_t ) ( sizeof( SERIALIZER_TOPIC ) - 1U );
+    benchmark.publishInfo.pPayload = payload;
+
+    for( index = 0U; index < ( sizeof( payloadSizes ) / sizeof( payloadSizes[ 0 ] ) ); index++ )
+    {
+        benchmark.publishInfo.payloadLength = payloadSizes[ index ];
+
+        ( void ) snprintf( name, sizeof( name ), "mqtt_serialize_publish/%lu", ( unsigned long ) payloadSizes[ index ] );
+        Benchmark_Run( name, serializePublish, &benchmark );
+
+        /* Deserialize a PUBLISH as received from the network. */
+        ( void ) MQTT_GetPublishPacketSize( &benchmark.publishInfo, &remainingLength, &packetSize );
+        ( void ) MQTT_SerializePublish( &benchmark.publishInfo, 1U, remainingLength, &benchmark.buffer );
+        setPacketInfo( &benchmark, packetSize, remainingLength );
+        ( void ) snprintf( name, sizeof( name ), "mqtt_deserialize_publish/%lu", ( unsigned long ) payloadSizes[ index ] );
+        Benchmark_Run( name, deserializePublish, &benchmark );
+    }
+
+    Benchmark_Run( "mqtt_serialize_puback", serializeAck, &benchmark );
+
+    ( void ) MQTT_SerializeAck( &benchmark.buffer, MQTT_PACKET_TYPE_PUBACK, 1U );
+    setPacketInfo( &benchmark, MQTT_PUBLISH_ACK_PACKET_SIZE, MQTT_PUBLISH_ACK_PACKET_SIZE - 2U );
+    Benchmark_Run( "mqtt_deserialize_puback", deserializeAck, &benchmark );
+
+    Benchmark_Run( "mqtt_serialize_connect", serializeConnect, &benchmark );
+}
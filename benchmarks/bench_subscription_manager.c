@@ -0,0 +1,246 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file bench_subscription_manager.c
+ * @brief Benchmarks of topic matching and dispatch by the subscription
+ * manager at registries of 10 to 10,000 topic filters.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Include the subscription manager of the MQTT demos. */
+#include "mqtt_subscription_manager.h"
+
+#include "benchmark.h"
+
+/**
+ * @brief Registry sizes that are benchmarked.
+ */
+#define SUBSCRIPTION_FILTER_COUNTS      { 10U, 100U, 1000U, 10000U }
+
+/**
+ * @brief Every this many topic filters, one ends in a wildcard instead of a
+ * topic level, so that dispatch also walks the topic trie.
+ */
+#define SUBSCRIPTION_WILDCARD_INTERVAL  ( 10U )
+
+/**
+ * @brief Size of the buffer of every topic filter and topic name.
+ */
+#define SUBSCRIPTION_TOPIC_SIZE         ( 32U )
+
+/**
+ * @brief Most topic levels a registry needs: the topic filters share their
+ * first level, and a wildcard filter has three levels.
+ */
+#define SUBSCRIPTION_TOPIC_LEVELS( filterCount )    ( ( ( filterCount ) * 3U ) + 1U )
+
+/**
+ * @brief Topic names to dispatch, which match or do not match the registry.
+ */
+typedef struct SubscriptionBenchmark
+{
+    MQTTContext_t * pContext;   /**< @brief The context passed to dispatch. */
+    char * pTopicNames;         /**< @brief The topic names, #SUBSCRIPTION_TOPIC_SIZE bytes apart. */
+    uint16_t * pTopicLengths;   /**< @brief The length of every topic name. */
+    size_t topicCount;          /**< @brief Number of topic names. */
+} SubscriptionBenchmark_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of callbacks invoked.
+ */
+static uint64_t callbackCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Callback of every topic filter.
+ *
+ * @param[in] pContext The MQTT context.
+ * @param[in] pPublishInfo The PUBLISH.
+ */
+static void countCallback( MQTTContext_t * pContext,
+                           MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Dispatch PUBLISHes, cycling through the topic names.
+ *
+ * @param[in] pContext The #SubscriptionBenchmark_t.
+ * @param[in] iterations Number of PUBLISHes.
+ */
+static void dispatch( void * pContext,
+                      uint64_t iterations );
+
+/**
+ * @brief Write the topic names of a benchmark.
+ *
+ * @param[out] pBenchmark The benchmark.
+ * @param[in] pPrefix First topic level of every topic name.
+ */
+static void writeTopicNames( SubscriptionBenchmark_t * pBenchmark,
+                             const char * pPrefix );
+
+/*-----------------------------------------------------------*/
+
+static void countCallback( MQTTContext_t * pContext,
+                           MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+
+    callbackCount++;
+}
+
+/*-----------------------------------------------------------*/
+
+static void dispatch( void * pContext,
+                      uint64_t iterations )
+{
+    SubscriptionBenchmark_t * pBenchmark = ( SubscriptionBenchmark_t * ) pContext;
+    MQTTPublishInfo_t publishInfo;
+    uint64_t iteration = 0U;
+    size_t topic = 0U;
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS0;
+    publishInfo.pPayload = "{}";
+    publishInfo.payloadLength = 2U;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        publishInfo.pTopicName = &pBenchmark->pTopicNames[ topic * SUBSCRIPTION_TOPIC_SIZE ];
+        publishInfo.topicNameLength = pBenchmark->pTopicLengths[ topic ];
+
+        SubscriptionManager_DispatchHandler( pBenchmark->pContext, &publishInfo );
+
+        topic++;
+
+        if( topic == pBenchmark->topicCount )
+        {
+            topic = 0U;
+        }
+    }
+
+    Benchmark_Consume( &callbackCount );
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeTopicNames( SubscriptionBenchmark_t * pBenchmark,
+                             const char * pPrefix )
+{
+    size_t index = 0U;
+
+    for( index = 0U; index < pBenchmark->topicCount; index++ )
+    {
+        pBenchmark->pTopicLengths[ index ] =
+            ( uint16_t ) snprintf( &pBenchmark->pTopicNames[ index * SUBSCRIPTION_TOPIC_SIZE ],
+                                   SUBSCRIPTION_TOPIC_SIZE,
+                                   "%s/device%lu/state",
+                                   pPrefix,
+                                   ( unsigned long ) index );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_SubscriptionManager( void )
+{
+    static MQTTContext_t context;
+    const size_t filterCounts[] = SUBSCRIPTION_FILTER_COUNTS;
+    SubscriptionBenchmark_t benchmark;
+    char name[ 64 ];
+    char * pFilters = NULL;
+    uint16_t filterLength = 0U;
+    void * pArena = NULL;
+    size_t arenaSize = 0U;
+    size_t countIndex = 0U;
+    size_t index = 0U;
+    SubscriptionManagerStatus_t status = SUBSCRIPTION_MANAGER_SUCCESS;
+
+    benchmark.pContext = &context;
+
+    for( countIndex = 0U; countIndex < ( sizeof( filterCounts ) / sizeof( filterCounts[ 0 ] ) ); countIndex++ )
+    {
+        benchmark.topicCount = filterCounts[ countIndex ];
+        arenaSize = SubscriptionManager_GetArenaSize( ( uint16_t ) SUBSCRIPTION_TOPIC_LEVELS( benchmark.topicCount ) );
+
+        /* The registry points into the topic filters, so they are kept until
+         * the registry is released. */
+        pArena = malloc( arenaSize );
+        pFilters = malloc( benchmark.topicCount * SUBSCRIPTION_TOPIC_SIZE );
+        benchmark.pTopicNames = malloc( benchmark.topicCount * SUBSCRIPTION_TOPIC_SIZE );
+        benchmark.pTopicLengths = malloc( benchmark.topicCount * sizeof( uint16_t ) );
+
+        if( ( pArena == NULL ) || ( pFilters == NULL ) ||
+            ( benchmark.pTopicNames == NULL ) || ( benchmark.pTopicLengths == NULL ) )
+        {
+            status = SUBSCRIPTION_MANAGER_BAD_PARAMETER;
+        }
+        else
+        {
+            status = SubscriptionManager_Init( pArena, arenaSize );
+        }
+
+        for( index = 0U; ( index < benchmark.topicCount ) && ( status == SUBSCRIPTION_MANAGER_SUCCESS ); index++ )
+        {
+            filterLength = ( uint16_t ) snprintf( &pFilters[ index * SUBSCRIPTION_TOPIC_SIZE ],
+                                                  SUBSCRIPTION_TOPIC_SIZE,
+                                                  ( ( index % SUBSCRIPTION_WILDCARD_INTERVAL ) == 0U ) ?
+                                                  "bench/device%lu/+" : "bench/device%lu/state",
+                                                  ( unsigned long ) index );
+            status = SubscriptionManager_RegisterCallback( &pFilters[ index * SUBSCRIPTION_TOPIC_SIZE ],
+                                                           filterLength,
+                                                           countCallback );
+        }
+
+        if( status == SUBSCRIPTION_MANAGER_SUCCESS )
+        {
+            /* Every topic name matches one exact or one wildcard filter. */
+            writeTopicNames( &benchmark, "bench" );
+            ( void ) snprintf( name, sizeof( name ), "subscription_dispatch_match/%lu", ( unsigned long ) benchmark.topicCount );
+            Benchmark_Run( name, dispatch, &benchmark );
+
+            writeTopicNames( &benchmark, "other" );
+            ( void ) snprintf( name, sizeof( name ), "subscription_dispatch_miss/%lu", ( unsigned long ) benchmark.topicCount );
+            Benchmark_Run( name, dispatch, &benchmark );
+        }
+        else
+        {
+            printf( "Skipping the subscription manager benchmarks of %lu topic filters.\n",
+                    ( unsigned long ) benchmark.topicCount );
+        }
+
+        /* Return to the static registry before releasing the arena. */
+        ( void ) SubscriptionManager_Init( NULL, 0U );
+        free( benchmark.pTopicLengths );
+        free( benchmark.pTopicNames );
+        free( pFilters );
+        free( pArena );
+    }
+}
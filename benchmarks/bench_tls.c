@@ -0,0 +1,463 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file bench_tls.c
+ * @brief Benchmarks of TLS handshakes of the OpenSSL transport, with and
+ * without session resumption, against a TLS server in the same process.
+ *
+ * Every operation connects to the server over TCP on the loopback
+ * interface, receives one byte, which also receives the session tickets of
+ * TLS 1.3, and disconnects. The server uses a self-signed certificate
+ * generated at startup, so no credentials are needed.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* OpenSSL includes. */
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+/* Include OpenSSL implementation of transport interface. */
+#include "openssl_posix.h"
+
+#include "benchmark.h"
+
+/**
+ * @brief Address of the server.
+ */
+#define TLS_SERVER_ADDRESS            "127.0.0.1"
+
+/**
+ * @brief Validity of the certificate of the server in seconds.
+ */
+#define TLS_CERTIFICATE_VALIDITY_S    ( 86400L )
+
+/**
+ * @brief Timeout of the transport in milliseconds.
+ */
+#define TLS_TRANSPORT_TIMEOUT_MS      ( 5000U )
+
+/**
+ * @brief Credentials of one kind of handshake.
+ */
+typedef struct TlsBenchmark
+{
+    OpensslCredentials_t credentials; /**< @brief Credentials of the client. */
+} TlsBenchmark_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Key and self-signed certificate of the server.
+ */
+static EVP_PKEY * pServerKey = NULL;
+static X509 * pServerCertificate = NULL;
+
+/**
+ * @brief The certificate of the server as DER, which the client trusts.
+ */
+static uint8_t * pRootCa = NULL;
+static size_t rootCaLength = 0U;
+
+/**
+ * @brief SSL context, listening socket and thread of the server.
+ */
+static SSL_CTX * pServerContext = NULL;
+static int listenSocket = -1;
+static pthread_t serverThread;
+
+/**
+ * @brief Address of the server.
+ */
+static ServerInfo_t serverInfo;
+
+/**
+ * @brief TLS context shared by the connections of the client.
+ */
+static OpensslTlsContext_t tlsContext;
+
+/**
+ * @brief Store of the TLS session of the server, and the saved session.
+ */
+static OpensslSessionStore_t sessionStore;
+static uint8_t savedSession[ OPENSSL_MAX_SESSION_LENGTH ];
+static size_t savedSessionLength = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Generate the key and self-signed certificate of the server.
+ *
+ * @return 0 on success; -1 on failure.
+ */
+static int generateCertificate( void );
+
+/**
+ * @brief Start the server on an ephemeral port of the loopback interface.
+ *
+ * @return 0 on success; -1 on failure.
+ */
+static int startServer( void );
+
+/**
+ * @brief Stop the server and release its resources.
+ */
+static void stopServer( void );
+
+/**
+ * @brief Thread of the server, which accepts connections one at a time,
+ * sends one byte on each, and waits for the client to disconnect.
+ *
+ * @param[in] pArgument Unused.
+ *
+ * @return NULL.
+ */
+static void * serveConnections( void * pArgument );
+
+/**
+ * @brief Load the TLS session saved in #savedSession.
+ *
+ * @param[in] pStoreContext Unused.
+ * @param[out] pBuffer Buffer to copy the session into.
+ * @param[in] bufferSize Size of @p pBuffer.
+ *
+ * @return Length of the session, 0 if none is saved.
+ */
+static size_t loadSession( void * pStoreContext,
+                           uint8_t * pBuffer,
+                           size_t bufferSize );
+
+/**
+ * @brief Save a TLS session in #savedSession.
+ *
+ * @param[in] pStoreContext Unused.
+ * @param[in] pSession The serialized session.
+ * @param[in] sessionLength Length of @p pSession.
+ */
+static void saveSession( void * pStoreContext,
+                         const uint8_t * pSession,
+                         size_t sessionLength );
+
+/**
+ * @brief Connect to the server, receive one byte and disconnect.
+ *
+ * @param[in] pContext The #TlsBenchmark_t.
+ * @param[in] iterations Number of connections.
+ */
+static void handshake( void * pContext,
+                       uint64_t iterations );
+
+/*-----------------------------------------------------------*/
+
+static int generateCertificate( void )
+{
+    int status = -1;
+    EVP_PKEY_CTX * pKeyContext = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, NULL );
+    X509_NAME * pName = NULL;
+    X509_EXTENSION * pExtension = NULL;
+    X509V3_CTX extensionContext;
+    unsigned char * pDer = NULL;
+    int derLength = 0;
+
+    if( ( pKeyContext != NULL ) &&
+        ( EVP_PKEY_keygen_init( pKeyContext ) == 1 ) &&
+        ( EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pKeyContext, NID_X9_62_prime256v1 ) == 1 ) &&
+        ( EVP_PKEY_keygen( pKeyContext, &pServerKey ) == 1 ) )
+    {
+        pServerCertificate = X509_new();
+    }
+
+    if( pServerCertificate != NULL )
+    {
+        /* A self-signed CA certificate can be trusted as its own root. */
+        ( void ) X509_set_version( pServerCertificate, 2 );
+        ( void ) ASN1_INTEGER_set( X509_get_serialNumber( pServerCertificate ), 1 );
+        ( void ) X509_gmtime_adj( X509_getm_notBefore( pServerCertificate ), 0 );
+        ( void ) X509_gmtime_adj( X509_getm_notAfter( pServerCertificate ), TLS_CERTIFICATE_VALIDITY_S );
+        ( void ) X509_set_pubkey( pServerCertificate, pServerKey );
+
+        pName = X509_get_subject_name( pServerCertificate );
+        ( void ) X509_NAME_add_entry_by_txt( pName, "CN", MBSTRING_ASC,
+                                             ( const unsigned char * ) "localhost", -1, -1, 0 );
+        ( void ) X509_set_issuer_name( pServerCertificate, pName );
+
+        X509V3_set_ctx_nodb( &extensionContext );
+        X509V3_set_ctx( &extensionContext, pServerCertificate, pServerCertificate, NULL, NULL, 0 );
+        pExtension = X509V3_EXT_conf_nid( NULL, &extensionContext, NID_basic_constraints, "critical,CA:TRUE" );
+
+        if( ( pExtension != NULL ) &&
+            ( X509_add_ext( pServerCertificate, pExtension, -1 ) == 1 ) &&
+            ( X509_sign( pServerCertificate, pServerKey, EVP_sha256() ) > 0 ) )
+        {
+            derLength = i2d_X509( pServerCertificate, NULL );
+        }
+
+        X509_EXTENSION_free( pExtension );
+    }
+
+    if( derLength > 0 )
+    {
+        pRootCa = malloc( ( size_t ) derLength );
+    }
+
+    if( pRootCa != NULL )
+    {
+        pDer = pRootCa;
+        rootCaLength = ( size_t ) i2d_X509( pServerCertificate, &pDer );
+        status = 0;
+    }
+
+    EVP_PKEY_CTX_free( pKeyContext );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static int startServer( void )
+{
+    int status = -1;
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof( address );
+
+    ( void ) memset( &address, 0x00, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_port = 0U;
+    address.sin_addr.s_addr = inet_addr( TLS_SERVER_ADDRESS );
+
+    pServerContext = SSL_CTX_new( TLS_server_method() );
+    listenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+
+    if( ( pServerContext != NULL ) &&
+        ( SSL_CTX_use_certificate( pServerContext, pServerCertificate ) == 1 ) &&
+        ( SSL_CTX_use_PrivateKey( pServerContext, pServerKey ) == 1 ) &&
+        ( listenSocket >= 0 ) &&
+        ( bind( listenSocket, ( struct sockaddr * ) &address, sizeof( address ) ) == 0 ) &&
+        ( listen( listenSocket, 16 ) == 0 ) &&
+        ( getsockname( listenSocket, ( struct sockaddr * ) &address, &addressLength ) == 0 ) &&
+        ( pthread_create( &serverThread, NULL, serveConnections, NULL ) == 0 ) )
+    {
+        serverInfo.pHostName = TLS_SERVER_ADDRESS;
+        serverInfo.hostNameLength = sizeof( TLS_SERVER_ADDRESS ) - 1U;
+        serverInfo.port = ntohs( address.sin_port );
+        status = 0;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void stopServer( void )
+{
+    /* Shutting down the listening socket makes accept fail, which ends the
+     * server thread. */
+    if( listenSocket >= 0 )
+    {
+        ( void ) shutdown( listenSocket, SHUT_RDWR );
+
+        if( serverInfo.pHostName != NULL )
+        {
+            ( void ) pthread_join( serverThread, NULL );
+        }
+
+        ( void ) close( listenSocket );
+        listenSocket = -1;
+    }
+
+    SSL_CTX_free( pServerContext );
+    pServerContext = NULL;
+    X509_free( pServerCertificate );
+    pServerCertificate = NULL;
+    EVP_PKEY_free( pServerKey );
+    pServerKey = NULL;
+    free( pRootCa );
+    pRootCa = NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serveConnections( void * pArgument )
+{
+    int clientSocket = accept( listenSocket, NULL, NULL );
+    SSL * pSsl = NULL;
+    uint8_t buffer[ 64 ];
+    int noDelay = 1;
+
+    ( void ) pArgument;
+
+    while( clientSocket >= 0 )
+    {
+        /* Without this, Nagle's algorithm holds back the last handshake
+         * flight until the client's delayed ACK, which dominates the time. */
+        ( void ) setsockopt( clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof( noDelay ) );
+        pSsl = SSL_new( pServerContext );
+
+        if( ( pSsl != NULL ) &&
+            ( SSL_set_fd( pSsl, clientSocket ) == 1 ) &&
+            ( SSL_accept( pSsl ) == 1 ) &&
+            ( SSL_write( pSsl, "x", 1 ) == 1 ) )
+        {
+            /* Wait for the client to close the connection. */
+            while( SSL_read( pSsl, buffer, sizeof( buffer ) ) > 0 )
+            {
+            }
+        }
+
+        SSL_free( pSsl );
+        ( void ) close( clientSocket );
+        clientSocket = accept( listenSocket, NULL, NULL );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t loadSession( void * pStoreContext,
+                           uint8_t * pBuffer,
+                           size_t bufferSize )
+{
+    size_t sessionLength = 0U;
+
+    ( void ) pStoreContext;
+
+    if( savedSessionLength <= bufferSize )
+    {
+        ( void ) memcpy( pBuffer, savedSession, savedSessionLength );
+        sessionLength = savedSessionLength;
+    }
+
+    return sessionLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void saveSession( void * pStoreContext,
+                         const uint8_t * pSession,
+                         size_t sessionLength )
+{
+    ( void ) pStoreContext;
+
+    if( sessionLength <= sizeof( savedSession ) )
+    {
+        ( void ) memcpy( savedSession, pSession, sessionLength );
+        savedSessionLength = sessionLength;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void handshake( void * pContext,
+                       uint64_t iterations )
+{
+    const TlsBenchmark_t * pBenchmark = ( const TlsBenchmark_t * ) pContext;
+    NetworkContext_t networkContext;
+    uint64_t iteration = 0U;
+    uint8_t byte = 0U;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) memset( &networkContext, 0x00, sizeof( networkContext ) );
+
+        if( Openssl_Connect( &networkContext,
+                             &serverInfo,
+                             &pBenchmark->credentials,
+                             TLS_TRANSPORT_TIMEOUT_MS,
+                             TLS_TRANSPORT_TIMEOUT_MS ) == OPENSSL_SUCCESS )
+        {
+            ( void ) Openssl_Recv( &networkContext, &byte, 1U );
+            ( void ) Openssl_Disconnect( &networkContext );
+        }
+
+        Benchmark_Consume( &byte );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_Tls( void )
+{
+    static TlsBenchmark_t benchmark;
+    int status = generateCertificate();
+
+    /* A peer that closes first must not terminate the process. */
+    ( void ) signal( SIGPIPE, SIG_IGN );
+
+    if( status == 0 )
+    {
+        status = startServer();
+    }
+
+    if( status == 0 )
+    {
+        ( void ) memset( &benchmark, 0x00, sizeof( benchmark ) );
+        benchmark.credentials.pRootCa = pRootCa;
+        benchmark.credentials.rootCaLength = rootCaLength;
+
+        /* Every connect parses the credentials into a new SSL context. */
+        Benchmark_Run( "tls_handshake/full_new_context", handshake, &benchmark );
+
+        sessionStore.load = loadSession;
+        sessionStore.save = saveSession;
+        sessionStore.pStoreContext = NULL;
+        benchmark.credentials.pSessionStore = &sessionStore;
+
+        if( Openssl_TlsContextInit( &tlsContext, &benchmark.credentials ) == OPENSSL_SUCCESS )
+        {
+            benchmark.credentials.pTlsContext = &tlsContext;
+
+            /* Without the session store, the shared context does not resume. */
+            benchmark.credentials.pSessionStore = NULL;
+            Benchmark_Run( "tls_handshake/full", handshake, &benchmark );
+
+            benchmark.credentials.pSessionStore = &sessionStore;
+            Benchmark_Run( "tls_handshake/resumed", handshake, &benchmark );
+
+            ( void ) Openssl_TlsContextCleanup( &tlsContext );
+        }
+        else
+        {
+            printf( "Skipping the shared TLS context benchmarks.\n" );
+        }
+    }
+    else
+    {
+        printf( "Skipping the TLS benchmarks, as the server could not be started.\n" );
+    }
+
+    stopServer();
+}
@@ -0,0 +1,134 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file bench_transport.c
+ * @brief Benchmarks of sending and receiving over the loopback transport.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Include the in-memory loopback transport. */
+#include "loopback_posix.h"
+
+#include "benchmark.h"
+
+/**
+ * @brief Size of the rings of the connection. It must be a power of 2 and
+ * hold the largest message.
+ */
+#define TRANSPORT_RING_SIZE             ( 65536U )
+
+/**
+ * @brief Largest message size that is benchmarked.
+ */
+#define TRANSPORT_MAX_MESSAGE_SIZE      ( 16384U )
+
+/**
+ * @brief Message sizes that are benchmarked.
+ */
+#define TRANSPORT_MESSAGE_SIZES         { 64U, 1024U, TRANSPORT_MAX_MESSAGE_SIZE }
+
+/**
+ * @brief A loopback connection and the message size to send over it.
+ */
+typedef struct TransportBenchmark
+{
+    NetworkContext_t sender;   /**< @brief The sending endpoint. */
+    NetworkContext_t receiver; /**< @brief The receiving endpoint. */
+    size_t messageSize;        /**< @brief Bytes sent and received by every operation. */
+} TransportBenchmark_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The rings of the connection, from the sender to the receiver and back.
+ */
+static uint8_t forwardStorage[ TRANSPORT_RING_SIZE ];
+static uint8_t backwardStorage[ TRANSPORT_RING_SIZE ];
+static LoopbackRing_t forwardRing;
+static LoopbackRing_t backwardRing;
+
+/**
+ * @brief The message sent, and the buffer it is received into.
+ */
+static uint8_t message[ TRANSPORT_MAX_MESSAGE_SIZE ];
+static uint8_t receiveBuffer[ TRANSPORT_MAX_MESSAGE_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send a message from one endpoint and receive it on the other.
+ *
+ * @param[in] pContext The #TransportBenchmark_t.
+ * @param[in] iterations Number of messages.
+ */
+static void sendAndReceive( void * pContext,
+                            uint64_t iterations );
+
+/*-----------------------------------------------------------*/
+
+static void sendAndReceive( void * pContext,
+                            uint64_t iterations )
+{
+    TransportBenchmark_t * pBenchmark = ( TransportBenchmark_t * ) pContext;
+    uint64_t iteration = 0U;
+    int32_t received = 0;
+
+    for( iteration = 0U; iteration < iterations; iteration++ )
+    {
+        ( void ) Loopback_Send( &pBenchmark->sender, message, pBenchmark->messageSize );
+        received = Loopback_Recv( &pBenchmark->receiver, receiveBuffer, pBenchmark->messageSize );
+        Benchmark_Consume( &received );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_Transport( void )
+{
+    static TransportBenchmark_t benchmark;
+    const size_t messageSizes[] = TRANSPORT_MESSAGE_SIZES;
+    char name[ 64 ];
+    size_t index = 0U;
+
+    ( void ) memset( message, 'x', sizeof( message ) );
+    ( void ) memset( &benchmark, 0x00, sizeof( benchmark ) );
+
+    /* Without shaping and with no timeouts, the transport never waits. */
+    ( void ) Loopback_Init( &forwardRing, forwardStorage, sizeof( forwardStorage ), NULL );
+    ( void ) Loopback_Init( &backwardRing, backwardStorage, sizeof( backwardStorage ), NULL );
+    ( void ) Loopback_Connect( &benchmark.sender, &backwardRing, &forwardRing, 0U, 0U );
+    ( void ) Loopback_Connect( &benchmark.receiver, &forwardRing, &backwardRing, 0U, 0U );
+
+    for( index = 0U; index < ( sizeof( messageSizes ) / sizeof( messageSizes[ 0 ] ) ); index++ )
+    {
+        benchmark.messageSize = messageSizes[ index ];
+        ( void ) snprintf( name, sizeof( name ), "loopback_send_recv/%lu", ( unsigned long ) messageSizes[ index ] );
+        Benchmark_Run( name, sendAndReceive, &benchmark );
+    }
+
+    ( void ) Loopback_Disconnect( &benchmark.sender );
+    ( void ) Loopback_Disconnect( &benchmark.receiver );
+}
@@ -0,0 +1,363 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file benchmark.c
+ * @brief Implementation of the harness of the microbenchmarks.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Include clock for timer. */
+#include "clock.h"
+
+#include "benchmark.h"
+
+/**
+ * @brief Version of the SDK recorded with every result.
+ */
+#ifndef SDK_VERSION
+    #define SDK_VERSION    "unknown"
+#endif
+
+/**
+ * @brief Allocations are counted by replacing the allocation functions of
+ * the C library, which only glibc allows through its internal entry points.
+ * Elsewhere, 0 allocations are reported.
+ */
+#if defined( __GLIBC__ )
+    #define BENCHMARK_COUNT_ALLOCATIONS    1
+#else
+    #define BENCHMARK_COUNT_ALLOCATIONS    0
+#endif
+
+/**
+ * @brief Largest factor the iteration count grows by between calibration runs.
+ */
+#define MAX_CALIBRATION_GROWTH    ( 100ULL )
+
+/**
+ * @brief A measured run of a benchmark.
+ */
+typedef struct BenchmarkSample
+{
+    uint64_t timeNs;         /**< @brief Elapsed time of the run. */
+    uint64_t allocations;    /**< @brief Heap allocations of the run. */
+    uint64_t allocatedBytes; /**< @brief Bytes requested by the allocations. */
+} BenchmarkSample_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Heap allocations of the calling thread, so that threads serving a
+ * benchmark, such as a TLS server, are not counted.
+ */
+static __thread uint64_t allocationCount = 0U;
+static __thread uint64_t allocatedBytes = 0U;
+
+/**
+ * @brief Only benchmarks whose name contains this string run, or NULL.
+ */
+static const char * pNameFilter = NULL;
+
+/**
+ * @brief The results file.
+ */
+static FILE * pResultsFile = NULL;
+
+/**
+ * @brief Results passed to #Benchmark_Consume.
+ */
+static const void * volatile pSink = NULL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Run a benchmark once.
+ *
+ * @param[in] function The benchmarked operation.
+ * @param[in] pContext Context passed to @p function.
+ * @param[in] iterations Number of operations.
+ * @param[out] pSample The measurements of the run.
+ */
+static void runOnce( BenchmarkFunction_t function,
+                     void * pContext,
+                     uint64_t iterations,
+                     BenchmarkSample_t * pSample );
+
+/**
+ * @brief Find an iteration count whose run takes at least
+ * #BENCHMARK_MIN_TIME_NS. The calibration runs also warm up caches.
+ *
+ * @param[in] function The benchmarked operation.
+ * @param[in] pContext Context passed to @p function.
+ *
+ * @return The iteration count.
+ */
+static uint64_t calibrate( BenchmarkFunction_t function,
+                           void * pContext );
+
+/**
+ * @brief qsort comparison of the times of two samples.
+ *
+ * @param[in] pFirst The first sample.
+ * @param[in] pSecond The second sample.
+ *
+ * @return Negative, zero or positive as the first time is smaller than,
+ * equal to or larger than the second.
+ */
+static int compareSamples( const void * pFirst,
+                           const void * pSecond );
+
+/*-----------------------------------------------------------*/
+
+#if ( BENCHMARK_COUNT_ALLOCATIONS == 1 )
+
+    extern void * __libc_malloc( size_t size );
+    extern void * __libc_calloc( size_t count,
+                                 size_t size );
+    extern void * __libc_realloc( void * pPointer,
+                                  size_t size );
+
+    void * malloc( size_t size )
+    {
+        allocationCount++;
+        allocatedBytes += size;
+
+        return __libc_malloc( size );
+    }
+
+    void * calloc( size_t count,
+                   size_t size )
+    {
+        allocationCount++;
+        allocatedBytes += count * size;
+
+        return __libc_calloc( count, size );
+    }
+
+    void * realloc( void * pPointer,
+                    size_t size )
+    {
+        allocationCount++;
+        allocatedBytes += size;
+
+        return __libc_realloc( pPointer, size );
+    }
+
+#endif /* if ( BENCHMARK_COUNT_ALLOCATIONS == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static void runOnce( BenchmarkFunction_t function,
+                     void * pContext,
+                     uint64_t iterations,
+                     BenchmarkSample_t * pSample )
+{
+    uint64_t startNs = 0U;
+    uint64_t startAllocations = allocationCount;
+    uint64_t startBytes = allocatedBytes;
+
+    startNs = Clock_GetTimeNs();
+    function( pContext, iterations );
+    pSample->timeNs = Clock_GetTimeNs() - startNs;
+
+    pSample->allocations = allocationCount - startAllocations;
+    pSample->allocatedBytes = allocatedBytes - startBytes;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t calibrate( BenchmarkFunction_t function,
+                           void * pContext )
+{
+    BenchmarkSample_t sample;
+    uint64_t iterations = 1U;
+    uint64_t nextIterations = 0U;
+
+    runOnce( function, pContext, iterations, &sample );
+
+    while( sample.timeNs < BENCHMARK_MIN_TIME_NS )
+    {
+        /* Aim 20% past the minimum time, as short runs are noisy. */
+        if( sample.timeNs == 0U )
+        {
+            nextIterations = iterations * MAX_CALIBRATION_GROWTH;
+        }
+        else
+        {
+            nextIterations = ( iterations * ( ( BENCHMARK_MIN_TIME_NS * 6U ) / 5U ) ) / sample.timeNs;
+        }
+
+        if( nextIterations > ( iterations * MAX_CALIBRATION_GROWTH ) )
+        {
+            nextIterations = iterations * MAX_CALIBRATION_GROWTH;
+        }
+        else if( nextIterations <= iterations )
+        {
+            nextIterations = iterations + 1U;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        iterations = nextIterations;
+        runOnce( function, pContext, iterations, &sample );
+    }
+
+    return iterations;
+}
+
+/*-----------------------------------------------------------*/
+
+static int compareSamples( const void * pFirst,
+                           const void * pSecond )
+{
+    uint64_t first = ( ( const BenchmarkSample_t * ) pFirst )->timeNs;
+    uint64_t second = ( ( const BenchmarkSample_t * ) pSecond )->timeNs;
+
+    return ( first > second ) - ( first < second );
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_Run( const char * pName,
+                    BenchmarkFunction_t function,
+                    void * pContext )
+{
+    BenchmarkSample_t samples[ BENCHMARK_REPETITIONS ];
+    const BenchmarkSample_t * pMedian = NULL;
+    uint64_t iterations = 0U;
+    uint32_t repetition = 0U;
+    double nsPerOp = 0.0;
+    double minNsPerOp = 0.0;
+    double allocsPerOp = 0.0;
+    double bytesPerOp = 0.0;
+
+    if( ( pNameFilter == NULL ) || ( strstr( pName, pNameFilter ) != NULL ) )
+    {
+        iterations = calibrate( function, pContext );
+
+        for( repetition = 0U; repetition < BENCHMARK_REPETITIONS; repetition++ )
+        {
+            runOnce( function, pContext, iterations, &samples[ repetition ] );
+        }
+
+        qsort( samples, BENCHMARK_REPETITIONS, sizeof( samples[ 0 ] ), compareSamples );
+        pMedian = &samples[ BENCHMARK_REPETITIONS / 2U ];
+
+        nsPerOp = ( double ) pMedian->timeNs / ( double ) iterations;
+        minNsPerOp = ( double ) samples[ 0 ].timeNs / ( double ) iterations;
+        allocsPerOp = ( double ) pMedian->allocations / ( double ) iterations;
+        bytesPerOp = ( double ) pMedian->allocatedBytes / ( double ) iterations;
+
+        printf( "%-48s %14.1f ns/op %10.2f allocs/op %12.1f B/op\n",
+                pName,
+                nsPerOp,
+                allocsPerOp,
+                bytesPerOp );
+
+        if( pResultsFile != NULL )
+        {
+            fprintf( pResultsFile,
+                     "{\"sdkVersion\":\"%s\",\"benchmark\":\"%s\",\"iterations\":%llu,"
+                     "\"nsPerOp\":%.1f,\"minNsPerOp\":%.1f,\"allocsPerOp\":%.2f,\"bytesPerOp\":%.1f}\n",
+                     SDK_VERSION,
+                     pName,
+                     ( unsigned long long ) iterations,
+                     nsPerOp,
+                     minNsPerOp,
+                     allocsPerOp,
+                     bytesPerOp );
+            ( void ) fflush( pResultsFile );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_Consume( const void * pValue )
+{
+    pSink = pValue;
+}
+
+/*-----------------------------------------------------------*/
+
+int Benchmark_Init( const char * pFilter )
+{
+    int status = 0;
+
+    pNameFilter = pFilter;
+    pResultsFile = fopen( BENCHMARK_RESULTS_PATH, "w" );
+
+    if( pResultsFile == NULL )
+    {
+        fprintf( stderr, "Cannot create %s.\n", BENCHMARK_RESULTS_PATH );
+        status = -1;
+    }
+    else if( BENCHMARK_COUNT_ALLOCATIONS == 0 )
+    {
+        printf( "Allocations are not counted with this C library.\n" );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void Benchmark_Cleanup( void )
+{
+    if( pResultsFile != NULL )
+    {
+        ( void ) fclose( pResultsFile );
+        pResultsFile = NULL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int status = Benchmark_Init( ( argc > 1 ) ? argv[ 1 ] : NULL );
+
+    if( status == 0 )
+    {
+        Benchmark_Transport();
+        Benchmark_SubscriptionManager();
+        Benchmark_Json();
+        Benchmark_Serializer();
+        Benchmark_Tls();
+
+        Benchmark_Cleanup();
+    }
+
+    return ( status == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+/**
+ * @file benchmark.h
+ * @brief Harness of the microbenchmarks of the SDK.
+ *
+ * A benchmark is a function that runs an operation a given number of times.
+ * #Benchmark_Run finds an iteration count that runs for at least
+ * #BENCHMARK_MIN_TIME_NS, repeats the run #BENCHMARK_REPETITIONS times, and
+ * reports the median time per operation together with the heap allocations
+ * per operation of the calling thread.
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Shortest time in nanoseconds of a measured run.
+ */
+#ifndef BENCHMARK_MIN_TIME_NS
+    #define BENCHMARK_MIN_TIME_NS    ( 200000000ULL )
+#endif
+
+/**
+ * @brief Number of measured runs of every benchmark. The median is reported.
+ */
+#ifndef BENCHMARK_REPETITIONS
+    #define BENCHMARK_REPETITIONS    ( 5U )
+#endif
+
+/**
+ * @brief File the results are written to, one JSON object per line. It is
+ * replaced by every run.
+ */
+#ifndef BENCHMARK_RESULTS_PATH
+    #define BENCHMARK_RESULTS_PATH    "benchmark_results.jsonl"
+#endif
+
+/**
+ * @brief A benchmarked operation.
+ *
+ * @param[in] pContext The context passed to #Benchmark_Run.
+ * @param[in] iterations Number of times to run the operation.
+ */
+typedef void ( * BenchmarkFunction_t )( void * pContext,
+                                        uint64_t iterations );
+
+/**
+ * @brief Measure and report a benchmark, unless it is excluded by the
+ * filter passed to #Benchmark_Init.
+ *
+ * @param[in] pName Name of the benchmark, such as "json_search/4096".
+ * @param[in] function The benchmarked operation.
+ * @param[in] pContext Context passed to @p function.
+ */
+void Benchmark_Run( const char * pName,
+                    BenchmarkFunction_t function,
+                    void * pContext );
+
+/**
+ * @brief Keep the compiler from optimizing away a result.
+ *
+ * @param[in] pValue The result.
+ */
+void Benchmark_Consume( const void * pValue );
+
+/**
+ * @brief Set up the harness.
+ *
+ * @param[in] pFilter Only benchmarks whose name contains this string run, or
+ * NULL to run all.
+ *
+ * @return 0 on success; -1 if the results file cannot be created.
+ */
+int Benchmark_Init( const char * pFilter );
+
+/**
+ * @brief Close the results file.
+ */
+void Benchmark_Cleanup( void );
+
+/**
+ * @brief The benchmark suites.
+ */
+void Benchmark_Transport( void );
+void Benchmark_SubscriptionManager( void );
+void Benchmark_Json( void );
+void Benchmark_Serializer( void );
+void Benchmark_Tls( void );
+
+#endif /* ifndef BENCHMARK_H_ */
@@ -0,0 +1,143 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_header_template.h
+ * @brief Request headers that are formatted once and reused for requests
+ * that differ only in their method, path, Content-Length and Range.
+ *
+ * #HTTPClient_InitializeRequestHeaders formats every header of a request from
+ * scratch, though the host, the path prefix, the User-Agent and the
+ * Connection header stay the same across the requests of a demo. A template
+ * holds these headers already formatted. #HttpTemplate_Build writes the
+ * request line, copies the constant headers and appends the variable ones,
+ * so a request costs a copy of its headers.
+ */
+
+#ifndef HTTP_HEADER_TEMPLATE_H_
+#define HTTP_HEADER_TEMPLATE_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/**
+ * @brief Return codes of the header template functions.
+ */
+typedef enum HttpTemplateStatus
+{
+    HttpTemplateSuccess,           /**< @brief The headers were written. */
+    HttpTemplateBadParameter,      /**< @brief A parameter was NULL or zero. */
+    HttpTemplateInsufficientMemory /**< @brief The headers do not fit the buffer. */
+} HttpTemplateStatus_t;
+
+/**
+ * @brief The constant headers of a series of requests.
+ */
+typedef struct HttpHeaderTemplate
+{
+    HTTPRequestHeaders_t headers; /**< @brief The formatted headers, behind the request line of the template. */
+    size_t methodLength;          /**< @brief The length of the method of the template, at the start of the headers. */
+    size_t versionOffset;         /**< @brief The offset of the space before the HTTP version in the request line. */
+    size_t requestLineLength;     /**< @brief The length of the request line of the template, with its line break. */
+    const char * pPathPrefix;     /**< @brief The start of the path of every request. */
+    size_t pathPrefixLength;      /**< @brief The length of #HttpHeaderTemplate_t.pPathPrefix. */
+} HttpHeaderTemplate_t;
+
+/**
+ * @brief The variable fields of one request.
+ */
+typedef struct HttpTemplateFields
+{
+    const char * pMethod;  /**< @brief The method, or NULL for the method of the template. */
+    size_t methodLength;   /**< @brief The length of the method. */
+    const char * pPath;    /**< @brief The rest of the path after the prefix of the template, or NULL. */
+    size_t pathLength;     /**< @brief The length of the rest of the path. */
+    bool hasContentLength; /**< @brief Whether to add a Content-Length header. */
+    size_t contentLength;  /**< @brief The value of the Content-Length header. */
+    bool hasRange;         /**< @brief Whether to add a Range header. */
+    size_t rangeStart;     /**< @brief The first byte of the range. */
+    size_t rangeEnd;       /**< @brief The last byte of the range, included. */
+} HttpTemplateFields_t;
+
+/**
+ * @brief Format the constant headers of a template.
+ *
+ * @param[out] pTemplate The template.
+ * @param[in] pBuffer The memory of the template, which must stay valid as
+ * long as the template is used.
+ * @param[in] bufferLength The size of @p pBuffer.
+ * @param[in] pRequestInfo The host and flags of every request, its default
+ * method, and the path prefix. The path must stay valid as long as the
+ * template is used.
+ *
+ * @return #HttpTemplateSuccess, #HttpTemplateBadParameter or
+ * #HttpTemplateInsufficientMemory.
+ */
+HttpTemplateStatus_t HttpTemplate_Init( HttpHeaderTemplate_t * pTemplate,
+                                        uint8_t * pBuffer,
+                                        size_t bufferLength,
+                                        const HTTPRequestInfo_t * pRequestInfo );
+
+/**
+ * @brief Add a constant header to a template.
+ *
+ * @param[in] pTemplate The template.
+ * @param[in] pField The name of the header.
+ * @param[in] fieldLength The length of the name.
+ * @param[in] pValue The value of the header.
+ * @param[in] valueLength The length of the value.
+ *
+ * @return #HttpTemplateSuccess, #HttpTemplateBadParameter or
+ * #HttpTemplateInsufficientMemory.
+ */
+HttpTemplateStatus_t HttpTemplate_AddHeader( HttpHeaderTemplate_t * pTemplate,
+                                             const char * pField,
+                                             size_t fieldLength,
+                                             const char * pValue,
+                                             size_t valueLength );
+
+/**
+ * @brief Write the headers of a request from a template.
+ *
+ * The template is only read, so threads may build requests from one template
+ * at the same time.
+ *
+ * @param[in] pTemplate The template.
+ * @param[in] pFields The variable fields of the request.
+ * @param[in,out] pRequestHeaders The request headers, whose buffer receives
+ * the headers and whose length is set. The headers may be passed to
+ * #HTTPClient_Send, which adds the Content-Length of a body itself, so
+ * #HttpTemplateFields_t.hasContentLength is for bodies sent by other means.
+ *
+ * @return #HttpTemplateSuccess, #HttpTemplateBadParameter or
+ * #HttpTemplateInsufficientMemory.
+ */
+HttpTemplateStatus_t HttpTemplate_Build( const HttpHeaderTemplate_t * pTemplate,
+                                         const HttpTemplateFields_t * pFields,
+                                         HTTPRequestHeaders_t * pRequestHeaders );
+
+#endif /* ifndef HTTP_HEADER_TEMPLATE_H_ */
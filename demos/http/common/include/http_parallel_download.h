@@ -0,0 +1,117 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_parallel_download.h
+ * @brief Download of a large object in ranges, fetched concurrently over a
+ * pool of connections and written straight to their offsets in a file.
+ *
+ * A single connection is capped by its TCP window on links with a large
+ * bandwidth-delay product. Each connection of the pool is served by a thread
+ * that requests the next missing range with a Range header and writes the
+ * response body at the offset of the range, so no buffer holds more than one
+ * range. A range whose request fails is given to the next free connection,
+ * after the connection it failed on is re-established.
+ *
+ * The download requires POSIX threads.
+ */
+
+#ifndef HTTP_PARALLEL_DOWNLOAD_H_
+#define HTTP_PARALLEL_DOWNLOAD_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Common HTTP demo utilities. */
+#include "http_demo_utils.h"
+
+/**
+ * @brief The largest number of connections of a download.
+ */
+#ifndef HTTP_DOWNLOAD_MAX_CONNECTIONS
+    #define HTTP_DOWNLOAD_MAX_CONNECTIONS    ( 8U )
+#endif
+
+/**
+ * @brief The size of the buffer of each connection, which holds the request
+ * headers, then the response headers and the body of one range.
+ */
+#ifndef HTTP_DOWNLOAD_BUFFER_LENGTH
+    #define HTTP_DOWNLOAD_BUFFER_LENGTH    ( 32768U )
+#endif
+
+/**
+ * @brief The space of #HTTP_DOWNLOAD_BUFFER_LENGTH kept for the response
+ * headers. A range may use the rest.
+ */
+#ifndef HTTP_DOWNLOAD_HEADER_SPACE
+    #define HTTP_DOWNLOAD_HEADER_SPACE    ( 1024U )
+#endif
+
+/**
+ * @brief Return codes from #HttpDownload_Run.
+ */
+typedef enum HttpDownloadStatus
+{
+    HttpDownloadSuccess,            /**< @brief The object was written to the file. */
+    HttpDownloadBadParameter,       /**< @brief A parameter was NULL, zero, or out of range. */
+    HttpDownloadConnectFailed,      /**< @brief No connection to the server could be made. */
+    HttpDownloadRangeFailed,        /**< @brief A range failed on every attempt. */
+    HttpDownloadUnexpectedResponse, /**< @brief The server answered without the object or its size. */
+    HttpDownloadFileError,          /**< @brief A range could not be written to the file. */
+    HttpDownloadThreadError         /**< @brief A connection thread could not be created. */
+} HttpDownloadStatus_t;
+
+/**
+ * @brief The object to download and how to fetch it.
+ */
+typedef struct HttpDownloadConfig
+{
+    const char * pHost;          /**< @brief Host of the server, for the Host header. */
+    size_t hostLength;           /**< @brief Length of the host. */
+    const char * pPath;          /**< @brief Path of the object. */
+    size_t pathLength;           /**< @brief Length of the path. */
+    TransportConnect_t connect;  /**< @brief Establishes a TLS connection to the server with #Openssl_Connect. */
+    int fileDescriptor;          /**< @brief The file the object is written to, open for writing. */
+    size_t connectionCount;      /**< @brief Number of connections, from 1 to #HTTP_DOWNLOAD_MAX_CONNECTIONS. */
+    size_t rangeLength;          /**< @brief Bytes per range, up to #HTTP_DOWNLOAD_BUFFER_LENGTH
+                                  * minus #HTTP_DOWNLOAD_HEADER_SPACE. */
+    uint32_t maxRangeAttempts;   /**< @brief Requests of a range before the download fails. */
+} HttpDownloadConfig_t;
+
+/**
+ * @brief Download an object into a file.
+ *
+ * The first range is requested on one connection to learn the size of the
+ * object from its Content-Range header. The other connections are then opened
+ * and the remaining ranges are shared between them.
+ *
+ * @param[in] pConfig The object and how to fetch it.
+ * @param[out] pObjectLength The size of the object, or NULL.
+ *
+ * @return #HttpDownloadSuccess, or the first failure of the download.
+ */
+HttpDownloadStatus_t HttpDownload_Run( const HttpDownloadConfig_t * pConfig,
+                                       size_t * pObjectLength );
+
+#endif /* ifndef HTTP_PARALLEL_DOWNLOAD_H_ */
@@ -0,0 +1,294 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_response_stream.h
+ * @brief Sending of an HTTP request whose response body is handed to a sink
+ * in chunks, instead of being received whole into one buffer.
+ *
+ * #HTTPClient_Send needs a buffer for the complete response, so it must be
+ * sized for the largest body expected. Here, the response is received into a
+ * small buffer and parsed as it arrives by the stream itself, as the HTTP
+ * library only parses complete responses. Each piece of the body is passed
+ * to a sink, such as a file, a memory-mapped region or a hash, before the
+ * buffer is reused. Peak memory is the receive buffer, whatever the size of
+ * the body. Bodies with a Content-Length, chunked bodies, and bodies ended by
+ * closing the connection are supported.
+ *
+ * #HttpStream_SendPipelined sends several requests on one keep-alive
+ * connection without waiting for each response, so that a series of small
+ * requests costs one round trip instead of one per request.
+ *
+ * #HttpStream_Upload sends a request body read from a source as it is sent,
+ * so that the body, such as a log bundle, may be larger than memory.
+ */
+
+#ifndef HTTP_RESPONSE_STREAM_H_
+#define HTTP_RESPONSE_STREAM_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <sys/types.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/**
+ * @brief The number of receives in a row that may return no data before the
+ * response is given up. Each waits for the receive timeout of the transport.
+ */
+#ifndef HTTP_STREAM_MAX_EMPTY_RECVS
+    #define HTTP_STREAM_MAX_EMPTY_RECVS    ( 5U )
+#endif
+
+/**
+ * @brief The characters kept of each line of the status line, the headers and
+ * the chunk sizes. Only the start of longer lines is read, which holds
+ * everything the stream needs.
+ */
+#ifndef HTTP_STREAM_MAX_LINE_LENGTH
+    #define HTTP_STREAM_MAX_LINE_LENGTH    ( 128U )
+#endif
+
+/**
+ * @brief The bytes of a body chunk that are not body: the size line and the
+ * line break after the data.
+ */
+#define HTTP_STREAM_CHUNK_FRAMING_LENGTH    ( 20U )
+
+/**
+ * @brief Return codes from #HttpStream_Send.
+ */
+typedef enum HttpStreamStatus
+{
+    HttpStreamSuccess,       /**< @brief The whole response was received. */
+    HttpStreamBadParameter,  /**< @brief A parameter was NULL or zero. */
+    HttpStreamSendFailed,    /**< @brief The request could not be sent. */
+    HttpStreamNetworkError,  /**< @brief The connection failed or timed out before the end of the response. */
+    HttpStreamParseError,    /**< @brief The response is not valid HTTP. */
+    HttpStreamSinkError,     /**< @brief The sink asked to stop. */
+    HttpStreamSourceError    /**< @brief The request body could not be read, or ended before its length. */
+} HttpStreamStatus_t;
+
+/**
+ * @brief Callback type that takes the next piece of a response body.
+ *
+ * @param[in] pSinkContext The context given to #HttpStream_Send.
+ * @param[in] pData The piece of the body, valid only during the call.
+ * @param[in] length The size of the piece.
+ *
+ * @return 0 to continue; any other value stops the response with
+ * #HttpStreamSinkError.
+ */
+typedef int32_t ( * HttpBodySink_t )( void * pSinkContext,
+                                      const uint8_t * pData,
+                                      size_t length );
+
+/**
+ * @brief Callback type that reads the next piece of a request body.
+ *
+ * @param[in] pSourceContext The context of the request body.
+ * @param[out] pBuffer The buffer to read into.
+ * @param[in] bufferLength The size of @p pBuffer.
+ *
+ * @return The number of bytes read, 0 at the end of the body, or a negative
+ * value on error.
+ */
+typedef int32_t ( * HttpBodySource_t )( void * pSourceContext,
+                                        uint8_t * pBuffer,
+                                        size_t bufferLength );
+
+/**
+ * @brief Function type of a transport that sends part of a file without
+ * copying it through user space, such as #Plaintext_SendFile, or
+ * #Openssl_SendFile with kernel TLS.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] fileDescriptor The file.
+ * @param[in] offset The offset in the file of the first byte to send.
+ * @param[in] bytesToSend The number of bytes to send.
+ *
+ * @return The number of bytes sent, 0 if none could be, or a negative value
+ * on error.
+ */
+typedef int32_t ( * HttpSendFile_t )( const NetworkContext_t * pNetworkContext,
+                                      int32_t fileDescriptor,
+                                      off_t offset,
+                                      size_t bytesToSend );
+
+/**
+ * @brief A request body that is read as it is sent.
+ *
+ * The body is read from @p source, or from the file @p fileDescriptor when
+ * there is no source. A file of known length is passed to @p sendFile when
+ * it is set, so that it goes from the file to the socket without a copy.
+ */
+typedef struct HttpRequestBody
+{
+    HttpBodySource_t source; /**< @brief The source of the body, or NULL to send a file. */
+    void * pSourceContext;   /**< @brief Context passed to the source. */
+    int32_t fileDescriptor;  /**< @brief The file of the body when there is no source. */
+    off_t fileOffset;        /**< @brief The offset of the body in the file. */
+    HttpSendFile_t sendFile; /**< @brief Sends the file without copying it, or NULL to read it. */
+    bool chunked;            /**< @brief Send the body with Transfer-Encoding: chunked, for a body of unknown length. */
+    size_t length;           /**< @brief The length of the body, when it is not chunked. */
+} HttpRequestBody_t;
+
+/**
+ * @brief What is known of the response once it is received.
+ */
+typedef struct HttpStreamResponse
+{
+    uint16_t statusCode;  /**< @brief The status code. */
+    size_t bodyLength;    /**< @brief The bytes passed to the sink. */
+    bool connectionClose; /**< @brief Whether the server closes the connection, which must then be re-established. */
+} HttpStreamResponse_t;
+
+/**
+ * @brief A request of #HttpStream_SendPipelined, and its response.
+ */
+typedef struct HttpPipelineRequest
+{
+    HTTPRequestHeaders_t * pRequestHeaders; /**< @brief The request headers, each in its own buffer. */
+    const uint8_t * pRequestBody;           /**< @brief The request body, or NULL. */
+    size_t requestBodyLength;               /**< @brief The size of the request body. */
+    HttpBodySink_t sink;                    /**< @brief The sink of the response body. */
+    void * pSinkContext;                    /**< @brief Context passed to the sink. */
+    HttpStreamResponse_t response;          /**< @brief The response, once received. */
+} HttpPipelineRequest_t;
+
+/**
+ * @brief Send a request and stream its response body to a sink.
+ *
+ * @param[in] pTransport The transport interface of the connection.
+ * @param[in] pRequestHeaders Headers set up by
+ * #HTTPClient_InitializeRequestHeaders. A Content-Length header is added when
+ * there is a request body.
+ * @param[in] pRequestBody The request body, or NULL.
+ * @param[in] requestBodyLength The size of the request body.
+ * @param[in] pReceiveBuffer The buffer the response is received into. It may
+ * be the buffer of @p pRequestHeaders.
+ * @param[in] receiveBufferLength The size of @p pReceiveBuffer.
+ * @param[in] sink The sink of the body.
+ * @param[in] pSinkContext Context passed to @p sink.
+ * @param[out] pResponse The status and size of the response.
+ *
+ * @return #HttpStreamSuccess or the reason the response is incomplete.
+ */
+HttpStreamStatus_t HttpStream_Send( const TransportInterface_t * pTransport,
+                                    HTTPRequestHeaders_t * pRequestHeaders,
+                                    const uint8_t * pRequestBody,
+                                    size_t requestBodyLength,
+                                    uint8_t * pReceiveBuffer,
+                                    size_t receiveBufferLength,
+                                    HttpBodySink_t sink,
+                                    void * pSinkContext,
+                                    HttpStreamResponse_t * pResponse );
+
+/**
+ * @brief Send requests on one keep-alive connection without waiting for the
+ * response to each, then receive the responses in order.
+ *
+ * Requests with an idempotent method are written back to back, and their
+ * responses parsed as they arrive, bytes of the next response included. A
+ * POST, PATCH or CONNECT request is sent only once every earlier response is
+ * in, and is answered before the next request is sent, so that it is never
+ * lost with a connection closed under a pipeline.
+ *
+ * A response that closes the connection stops the pipeline. The requests from
+ * @p pCompletedCount on were then not answered, and may be sent again on a new
+ * connection.
+ *
+ * @param[in] pTransport The transport interface of the connection.
+ * @param[in,out] pRequests The requests, whose responses are filled in.
+ * @param[in] requestCount The number of requests.
+ * @param[in] pReceiveBuffer The buffer responses are received into. Unlike
+ * #HttpStream_Send, it must not be a request header buffer, as requests are
+ * still sent once responses arrive.
+ * @param[in] receiveBufferLength The size of @p pReceiveBuffer.
+ * @param[out] pCompletedCount The number of requests, from the first, whose
+ * response was fully received.
+ *
+ * @return #HttpStreamSuccess if every request was answered,
+ * #HttpStreamNetworkError if the connection closed before, or the status of
+ * the request that failed.
+ */
+HttpStreamStatus_t HttpStream_SendPipelined( const TransportInterface_t * pTransport,
+                                             HttpPipelineRequest_t * pRequests,
+                                             size_t requestCount,
+                                             uint8_t * pReceiveBuffer,
+                                             size_t receiveBufferLength,
+                                             size_t * pCompletedCount );
+
+/**
+ * @brief Send a request whose body is read as it is sent, and stream its
+ * response body to a sink.
+ *
+ * Peak memory is the receive buffer, which the body is read into before it is
+ * sent, whatever the size of the body. A chunked body ends when its source
+ * does; a body with a length fails with #HttpStreamSourceError if its source
+ * ends first.
+ *
+ * @param[in] pTransport The transport interface of the connection.
+ * @param[in] pRequestHeaders Headers set up by
+ * #HTTPClient_InitializeRequestHeaders. A Content-Length or a
+ * Transfer-Encoding header is added.
+ * @param[in] pBody The request body.
+ * @param[in] pReceiveBuffer The buffer the body is read into, then the
+ * response is received into. It may be the buffer of @p pRequestHeaders.
+ * @param[in] receiveBufferLength The size of @p pReceiveBuffer, which must
+ * be larger than #HTTP_STREAM_CHUNK_FRAMING_LENGTH for a chunked body.
+ * @param[in] sink The sink of the response body.
+ * @param[in] pSinkContext Context passed to @p sink.
+ * @param[out] pResponse The status and size of the response.
+ *
+ * @return #HttpStreamSuccess if the whole response was received, or the
+ * reason it was not.
+ */
+HttpStreamStatus_t HttpStream_Upload( const TransportInterface_t * pTransport,
+                                      HTTPRequestHeaders_t * pRequestHeaders,
+                                      const HttpRequestBody_t * pBody,
+                                      uint8_t * pReceiveBuffer,
+                                      size_t receiveBufferLength,
+                                      HttpBodySink_t sink,
+                                      void * pSinkContext,
+                                      HttpStreamResponse_t * pResponse );
+
+/**
+ * @brief A sink that writes the body to a file.
+ *
+ * @param[in] pSinkContext Pointer to the int file descriptor of a file open
+ * for writing.
+ * @param[in] pData The piece of the body.
+ * @param[in] length The size of the piece.
+ *
+ * @return 0, or -1 if the file could not be written.
+ */
+int32_t HttpStream_FileSink( void * pSinkContext,
+                             const uint8_t * pData,
+                             size_t length );
+
+#endif /* ifndef HTTP_RESPONSE_STREAM_H_ */
@@ -31,6 +31,30 @@
 /* Retry utilities. */
 #include "retry_utils.h"
 
+/**
+ * @brief The number of reconnect attempts that may start at once.
+ */
+#define RECONNECT_BUDGET_CAPACITY       ( 4U )
+
+/**
+ * @brief The interval in milliseconds at which the reconnect budget gains
+ * back one attempt.
+ */
+#define RECONNECT_BUDGET_REFILL_MS      ( 1000U )
+
+/**
+ * @brief The number of connection attempts that may be in progress at once.
+ */
+#define RECONNECT_BUDGET_MAX_IN_PROGRESS    ( 1U )
+
+/**
+ * @brief The retry budget that the connection attempts of the process draw
+ * from, so that they are spread over time after an outage.
+ */
+static RetryUtilsBudget_t reconnectBudget = RETRY_UTILS_BUDGET_INITIALIZER( RECONNECT_BUDGET_CAPACITY,
+                                                                            RECONNECT_BUDGET_REFILL_MS,
+                                                                            RECONNECT_BUDGET_MAX_IN_PROGRESS );
+
 int32_t connectToServerWithBackoffRetries( TransportConnect_t connectFunction,
                                            NetworkContext_t * pNetworkContext )
 {
@@ -45,6 +69,11 @@ int32_t connectToServerWithBackoffRetries( TransportConnect_t connectFunction,
     /* Initialize reconnect attempts and interval */
     RetryUtils_ParamsReset( &reconnectParams );
 
+    /* Take the first attempt from the reconnect budget. The attempts that
+     * fail are released, and the retries taken, by RetryUtils_BackoffAndSleep. */
+    reconnectParams.pBudget = &reconnectBudget;
+    ( void ) RetryUtils_BudgetAcquireAndSleep( reconnectParams.pBudget );
+
     /* Attempt to connect to HTTP server. If connection fails, retry after
      * a timeout. Timeout value will exponentially increase until maximum
      * attempts are reached. */
@@ -65,5 +94,11 @@ int32_t connectToServerWithBackoffRetries( TransportConnect_t connectFunction,
         LogError( ( "Connection to the server failed, all attempts exhausted." ) );
     }
 
+    /* The attempt that succeeded is complete. */
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        ( void ) RetryUtils_BudgetRelease( &reconnectBudget );
+    }
+
     return returnStatus;
 }
@@ -0,0 +1,316 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_header_template.c
+ * @brief Implementation of the request header templates.
+ *
+ * The template is formatted by #HTTPClient_InitializeRequestHeaders, with a
+ * request line for the default method and the path prefix. A request is
+ * written as its own request line, the header lines of the template, its
+ * variable header lines and the blank line ending the headers.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+#include "http_header_template.h"
+
+/**
+ * @brief The start of a Content-Length header line.
+ */
+#define CONTENT_LENGTH_PREFIX    "Content-Length: "
+
+/**
+ * @brief The start of a Range header line.
+ */
+#define RANGE_PREFIX             "Range: bytes="
+
+/**
+ * @brief The end of a header line.
+ */
+#define LINE_BREAK               "\r\n"
+
+/**
+ * @brief The length of #LINE_BREAK.
+ */
+#define LINE_BREAK_LENGTH        ( sizeof( LINE_BREAK ) - 1U )
+
+/**
+ * @brief Space for the digits of a size in decimal.
+ */
+#define SIZE_DIGITS_LENGTH       ( 24U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append bytes to the request headers, if they fit.
+ *
+ * @param[in,out] pRequestHeaders The request headers.
+ * @param[in] pData The bytes.
+ * @param[in] length The number of bytes.
+ *
+ * @return true if the bytes fit the buffer.
+ */
+static bool appendBytes( HTTPRequestHeaders_t * pRequestHeaders,
+                         const void * pData,
+                         size_t length );
+
+/**
+ * @brief Append a size in decimal to the request headers, if it fits.
+ *
+ * @param[in,out] pRequestHeaders The request headers.
+ * @param[in] value The size.
+ *
+ * @return true if the digits fit the buffer.
+ */
+static bool appendDecimal( HTTPRequestHeaders_t * pRequestHeaders,
+                           size_t value );
+
+/**
+ * @brief Convert a status of the HTTP library.
+ *
+ * @param[in] httpStatus The status of the HTTP library.
+ *
+ * @return The status of the template.
+ */
+static HttpTemplateStatus_t convertStatus( HTTPStatus_t httpStatus );
+
+/*-----------------------------------------------------------*/
+
+static bool appendBytes( HTTPRequestHeaders_t * pRequestHeaders,
+                         const void * pData,
+                         size_t length )
+{
+    bool fits = ( length <= ( pRequestHeaders->bufferLen - pRequestHeaders->headersLen ) );
+
+    if( ( fits == true ) && ( length > 0U ) )
+    {
+        ( void ) memcpy( &pRequestHeaders->pBuffer[ pRequestHeaders->headersLen ], pData, length );
+        pRequestHeaders->headersLen += length;
+    }
+
+    return fits;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool appendDecimal( HTTPRequestHeaders_t * pRequestHeaders,
+                           size_t value )
+{
+    char digits[ SIZE_DIGITS_LENGTH ];
+    size_t digitsLength = 0U;
+
+    /* Write the digits from the end of the buffer. */
+    do
+    {
+        digitsLength++;
+        digits[ SIZE_DIGITS_LENGTH - digitsLength ] = ( char ) ( '0' + ( value % 10U ) );
+        value /= 10U;
+    } while( value > 0U );
+
+    return appendBytes( pRequestHeaders, &digits[ SIZE_DIGITS_LENGTH - digitsLength ], digitsLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpTemplateStatus_t convertStatus( HTTPStatus_t httpStatus )
+{
+    HttpTemplateStatus_t status = HttpTemplateBadParameter;
+
+    if( httpStatus == HTTP_SUCCESS )
+    {
+        status = HttpTemplateSuccess;
+    }
+    else if( httpStatus == HTTP_INSUFFICIENT_MEMORY )
+    {
+        status = HttpTemplateInsufficientMemory;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpTemplateStatus_t HttpTemplate_Init( HttpHeaderTemplate_t * pTemplate,
+                                        uint8_t * pBuffer,
+                                        size_t bufferLength,
+                                        const HTTPRequestInfo_t * pRequestInfo )
+{
+    HttpTemplateStatus_t status = HttpTemplateSuccess;
+    const uint8_t * pLineEnd = NULL;
+    size_t i = 0U;
+
+    if( ( pTemplate == NULL ) || ( pBuffer == NULL ) || ( bufferLength == 0U ) ||
+        ( pRequestInfo == NULL ) )
+    {
+        status = HttpTemplateBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pTemplate, 0, sizeof( HttpHeaderTemplate_t ) );
+        pTemplate->headers.pBuffer = pBuffer;
+        pTemplate->headers.bufferLen = bufferLength;
+
+        status = convertStatus( HTTPClient_InitializeRequestHeaders( &pTemplate->headers,
+                                                                     pRequestInfo ) );
+    }
+
+    if( status == HttpTemplateSuccess )
+    {
+        pTemplate->methodLength = pRequestInfo->methodLen;
+        pTemplate->pPathPrefix = pRequestInfo->pPath;
+        pTemplate->pathPrefixLength = ( pRequestInfo->pPath != NULL ) ? pRequestInfo->pathLen : 0U;
+
+        /* The request line ends with the HTTP version, after its last space. */
+        for( i = 0U; ( pLineEnd == NULL ) && ( ( i + LINE_BREAK_LENGTH ) <= pTemplate->headers.headersLen ); i++ )
+        {
+            if( memcmp( &pBuffer[ i ], LINE_BREAK, LINE_BREAK_LENGTH ) == 0 )
+            {
+                pLineEnd = &pBuffer[ i ];
+                pTemplate->requestLineLength = i + LINE_BREAK_LENGTH;
+            }
+            else if( pBuffer[ i ] == ( uint8_t ) ' ' )
+            {
+                pTemplate->versionOffset = i;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+
+        if( ( pLineEnd == NULL ) || ( pTemplate->versionOffset <= pTemplate->methodLength ) )
+        {
+            status = HttpTemplateBadParameter;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpTemplateStatus_t HttpTemplate_AddHeader( HttpHeaderTemplate_t * pTemplate,
+                                             const char * pField,
+                                             size_t fieldLength,
+                                             const char * pValue,
+                                             size_t valueLength )
+{
+    HttpTemplateStatus_t status = HttpTemplateBadParameter;
+
+    if( ( pTemplate != NULL ) && ( pTemplate->requestLineLength > 0U ) )
+    {
+        /* The header goes before the blank line, after the request line. */
+        status = convertStatus( HTTPClient_AddHeader( &pTemplate->headers,
+                                                      pField,
+                                                      fieldLength,
+                                                      pValue,
+                                                      valueLength ) );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpTemplateStatus_t HttpTemplate_Build( const HttpHeaderTemplate_t * pTemplate,
+                                         const HttpTemplateFields_t * pFields,
+                                         HTTPRequestHeaders_t * pRequestHeaders )
+{
+    HttpTemplateStatus_t status = HttpTemplateSuccess;
+    const uint8_t * pTemplateBuffer = NULL;
+    bool fits = true;
+
+    if( ( pTemplate == NULL ) || ( pTemplate->requestLineLength == 0U ) || ( pFields == NULL ) ||
+        ( pRequestHeaders == NULL ) || ( pRequestHeaders->pBuffer == NULL ) ||
+        ( pRequestHeaders->pBuffer == pTemplate->headers.pBuffer ) ||
+        ( ( pFields->pMethod != NULL ) && ( pFields->methodLength == 0U ) ) ||
+        ( ( pFields->pPath == NULL ) && ( pFields->pathLength > 0U ) ) ||
+        ( ( pFields->hasRange == true ) && ( pFields->rangeEnd < pFields->rangeStart ) ) )
+    {
+        status = HttpTemplateBadParameter;
+    }
+    else
+    {
+        pTemplateBuffer = pTemplate->headers.pBuffer;
+        pRequestHeaders->headersLen = 0U;
+
+        if( pFields->pMethod != NULL )
+        {
+            fits = appendBytes( pRequestHeaders, pFields->pMethod, pFields->methodLength );
+        }
+        else
+        {
+            fits = appendBytes( pRequestHeaders, pTemplateBuffer, pTemplate->methodLength );
+        }
+
+        fits = fits && appendBytes( pRequestHeaders, " ", 1U ) &&
+               appendBytes( pRequestHeaders, pTemplate->pPathPrefix, pTemplate->pathPrefixLength ) &&
+               appendBytes( pRequestHeaders, pFields->pPath, pFields->pathLength );
+
+        /* An empty path requests the root, as the HTTP library does. */
+        if( ( fits == true ) && ( ( pTemplate->pathPrefixLength + pFields->pathLength ) == 0U ) )
+        {
+            fits = appendBytes( pRequestHeaders, "/", 1U );
+        }
+
+        /* The HTTP version and the constant headers, without the blank line. */
+        fits = fits && appendBytes( pRequestHeaders,
+                                    &pTemplateBuffer[ pTemplate->versionOffset ],
+                                    pTemplate->headers.headersLen - pTemplate->versionOffset - LINE_BREAK_LENGTH );
+
+        if( ( fits == true ) && ( pFields->hasContentLength == true ) )
+        {
+            fits = appendBytes( pRequestHeaders, CONTENT_LENGTH_PREFIX, sizeof( CONTENT_LENGTH_PREFIX ) - 1U ) &&
+                   appendDecimal( pRequestHeaders, pFields->contentLength ) &&
+                   appendBytes( pRequestHeaders, LINE_BREAK, LINE_BREAK_LENGTH );
+        }
+
+        if( ( fits == true ) && ( pFields->hasRange == true ) )
+        {
+            fits = appendBytes( pRequestHeaders, RANGE_PREFIX, sizeof( RANGE_PREFIX ) - 1U ) &&
+                   appendDecimal( pRequestHeaders, pFields->rangeStart ) &&
+                   appendBytes( pRequestHeaders, "-", 1U ) &&
+                   appendDecimal( pRequestHeaders, pFields->rangeEnd ) &&
+                   appendBytes( pRequestHeaders, LINE_BREAK, LINE_BREAK_LENGTH );
+        }
+
+        fits = fits && appendBytes( pRequestHeaders, LINE_BREAK, LINE_BREAK_LENGTH );
+
+        if( fits == false )
+        {
+            status = HttpTemplateInsufficientMemory;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
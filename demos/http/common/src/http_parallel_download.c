@@ -0,0 +1,825 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_parallel_download.c
+ * @brief Implementation of the download of an object in ranges over a pool of
+ * connections.
+ *
+ * The ranges are handed out in order from a cursor. A range whose request
+ * fails is pushed on a stack of ranges to retry, which is served before the
+ * cursor, so that the file is filled from the start. Each connection holds at
+ * most one range, so the stack never holds more ranges than there are
+ * connections.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+#include <unistd.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+#include "http_parallel_download.h"
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/* Request headers formatted once for every range. */
+#include "http_header_template.h"
+
+/* OpenSSL transport header. */
+#include "openssl_posix.h"
+
+/**
+ * @brief The name of the header with the range of a partial response and the
+ * size of the object.
+ */
+#define CONTENT_RANGE_FIELD              "Content-Range"
+
+/**
+ * @brief The length of #CONTENT_RANGE_FIELD.
+ */
+#define CONTENT_RANGE_FIELD_LENGTH       ( sizeof( CONTENT_RANGE_FIELD ) - 1U )
+
+/**
+ * @brief The status code of a response with the whole object.
+ */
+#define HTTP_STATUS_OK                   ( 200U )
+
+/**
+ * @brief The status code of a response with a range of the object.
+ */
+#define HTTP_STATUS_PARTIAL_CONTENT      ( 206U )
+
+/**
+ * @brief The largest offset that a Range header of the HTTP library can hold.
+ */
+#define HTTP_DOWNLOAD_MAX_OFFSET         ( 0x7FFFFFFFU )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A range to request again, with the number of its failed attempts.
+ */
+typedef struct RetryRange
+{
+    size_t index;      /**< @brief Index of the range. */
+    uint32_t attempts; /**< @brief Failed requests of the range. */
+} RetryRange_t;
+
+/**
+ * @brief The progress of a download, shared by its connections.
+ */
+typedef struct DownloadState
+{
+    const HttpDownloadConfig_t * pConfig;                   /**< @brief The download. */
+    HttpHeaderTemplate_t headerTemplate;                    /**< @brief The headers of every range request. */
+    uint8_t templateBuffer[ HTTP_DOWNLOAD_HEADER_SPACE ];   /**< @brief The memory of #DownloadState_t.headerTemplate. */
+    size_t objectLength;                                    /**< @brief Size of the object. */
+    size_t rangeCount;                                      /**< @brief Number of ranges of the object. */
+    size_t nextRange;                                       /**< @brief The first range not handed out yet. */
+    size_t completedCount;                                  /**< @brief Ranges written to the file. */
+    RetryRange_t retryRanges[ HTTP_DOWNLOAD_MAX_CONNECTIONS ]; /**< @brief Stack of ranges to request again. */
+    size_t retryCount;                                      /**< @brief Ranges on the stack. */
+    HttpDownloadStatus_t status;                            /**< @brief The first failure, which stops the download. */
+    pthread_mutex_t lock;                                   /**< @brief Guards the fields above. */
+} DownloadState_t;
+
+/**
+ * @brief A connection of the pool, served by its own thread.
+ */
+typedef struct DownloadConnection
+{
+    DownloadState_t * pState;                       /**< @brief The download. */
+    NetworkContext_t networkContext;                /**< @brief The TLS connection. */
+    bool connected;                                 /**< @brief Whether the connection is established. */
+    pthread_t thread;                               /**< @brief The thread serving the connection. */
+    uint8_t buffer[ HTTP_DOWNLOAD_BUFFER_LENGTH ];  /**< @brief Request and response buffer. */
+} DownloadConnection_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The connections of the pool.
+ */
+static DownloadConnection_t connections[ HTTP_DOWNLOAD_MAX_CONNECTIONS ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Establish the connection, retrying with backoff.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if the connection is established.
+ */
+static bool openConnection( DownloadConnection_t * pConnection );
+
+/**
+ * @brief Close the connection, if it is established.
+ *
+ * @param[in] pConnection The connection.
+ */
+static void closeConnection( DownloadConnection_t * pConnection );
+
+/**
+ * @brief Send a GET request for a range of the object.
+ *
+ * @param[in] pConnection The connection the request is sent on.
+ * @param[in] offset The first byte of the range.
+ * @param[in] length The size of the range.
+ * @param[out] pResponse The response, in the buffer of the connection.
+ *
+ * @return #HttpDownloadSuccess if a response was received;
+ * #HttpDownloadRangeFailed otherwise.
+ */
+static HttpDownloadStatus_t requestRange( DownloadConnection_t * pConnection,
+                                          size_t offset,
+                                          size_t length,
+                                          HTTPResponse_t * pResponse );
+
+/**
+ * @brief Read the size of the object from the Content-Range header of a
+ * partial response, such as "bytes 0-1023/146515".
+ *
+ * @param[in] pResponse The response.
+ * @param[out] pObjectLength The size of the object.
+ *
+ * @return true if the header holds a size that a Range header can address.
+ */
+static bool readObjectLength( const HTTPResponse_t * pResponse,
+                              size_t * pObjectLength );
+
+/**
+ * @brief Write a range to its offset in the file.
+ *
+ * @param[in] fileDescriptor The file.
+ * @param[in] pData The range.
+ * @param[in] length The size of the range.
+ * @param[in] offset The offset of the range in the object.
+ *
+ * @return #HttpDownloadSuccess or #HttpDownloadFileError.
+ */
+static HttpDownloadStatus_t writeRange( int fileDescriptor,
+                                        const uint8_t * pData,
+                                        size_t length,
+                                        size_t offset );
+
+/**
+ * @brief Request a range and write it to the file.
+ *
+ * @param[in] pConnection The connection the request is sent on.
+ * @param[in] index The index of the range.
+ *
+ * @return #HttpDownloadSuccess; #HttpDownloadRangeFailed if the request
+ * failed or the response was cut short, so that the range may be requested
+ * again; #HttpDownloadUnexpectedResponse or #HttpDownloadFileError, which
+ * stop the download.
+ */
+static HttpDownloadStatus_t fetchRange( DownloadConnection_t * pConnection,
+                                        size_t index );
+
+/**
+ * @brief Request the first range, learn the size of the object from it, and
+ * write it to the file.
+ *
+ * @param[in] pConnection The connection the request is sent on.
+ *
+ * @return #HttpDownloadSuccess; #HttpDownloadRangeFailed if the request
+ * failed or the response was cut short; #HttpDownloadUnexpectedResponse if
+ * the response holds neither the object nor its size; #HttpDownloadFileError.
+ */
+static HttpDownloadStatus_t fetchFirstRange( DownloadConnection_t * pConnection );
+
+/**
+ * @brief Take the next range to request, from the retry stack first.
+ *
+ * @param[in] pState The download.
+ * @param[out] pIndex The index of the range.
+ * @param[out] pAttempts The failed requests of the range.
+ *
+ * @return false if no range is left, or the download has failed.
+ */
+static bool takeRange( DownloadState_t * pState,
+                       size_t * pIndex,
+                       uint32_t * pAttempts );
+
+/**
+ * @brief Hand a range back to be requested again on any connection, or fail
+ * the download if the range has no attempts left.
+ *
+ * @param[in] pState The download.
+ * @param[in] index The index of the range.
+ * @param[in] attempts The failed requests of the range.
+ */
+static void returnRange( DownloadState_t * pState,
+                         size_t index,
+                         uint32_t attempts );
+
+/**
+ * @brief Record the first failure of the download, which stops the other
+ * connections after their current range.
+ *
+ * @param[in] pState The download.
+ * @param[in] status The failure.
+ */
+static void failDownload( DownloadState_t * pState,
+                          HttpDownloadStatus_t status );
+
+/**
+ * @brief The thread serving a connection, which fetches ranges until none is
+ * left.
+ *
+ * @param[in] pArgument The connection.
+ *
+ * @return NULL.
+ */
+static void * connectionThread( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static bool openConnection( DownloadConnection_t * pConnection )
+{
+    ( void ) memset( &pConnection->networkContext, 0, sizeof( NetworkContext_t ) );
+
+    pConnection->connected =
+        ( connectToServerWithBackoffRetries( pConnection->pState->pConfig->connect,
+                                             &pConnection->networkContext ) == EXIT_SUCCESS );
+
+    return pConnection->connected;
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeConnection( DownloadConnection_t * pConnection )
+{
+    if( pConnection->connected == true )
+    {
+        ( void ) Openssl_Disconnect( &pConnection->networkContext );
+        pConnection->connected = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpDownloadStatus_t requestRange( DownloadConnection_t * pConnection,
+                                          size_t offset,
+                                          size_t length,
+                                          HTTPResponse_t * pResponse )
+{
+    HttpDownloadStatus_t status = HttpDownloadSuccess;
+    HTTPStatus_t httpStatus = HTTP_SUCCESS;
+    HTTPRequestHeaders_t requestHeaders;
+    HttpTemplateFields_t fields;
+    TransportInterface_t transportInterface;
+
+    ( void ) memset( &fields, 0, sizeof( fields ) );
+    ( void ) memset( pResponse, 0, sizeof( HTTPResponse_t ) );
+
+    /* Only the range differs from the headers of the template. */
+    fields.hasRange = true;
+    fields.rangeStart = offset;
+    fields.rangeEnd = offset + length - 1U;
+
+    requestHeaders.pBuffer = pConnection->buffer;
+    requestHeaders.bufferLen = HTTP_DOWNLOAD_BUFFER_LENGTH;
+    requestHeaders.headersLen = 0U;
+
+    transportInterface.recv = Openssl_Recv;
+    transportInterface.send = Openssl_Send;
+    transportInterface.pNetworkContext = &pConnection->networkContext;
+
+    if( HttpTemplate_Build( &pConnection->pState->headerTemplate,
+                            &fields,
+                            &requestHeaders ) != HttpTemplateSuccess )
+    {
+        httpStatus = HTTP_INSUFFICIENT_MEMORY;
+    }
+
+    if( httpStatus == HTTP_SUCCESS )
+    {
+        /* The response reuses the buffer of the request headers. */
+        pResponse->pBuffer = pConnection->buffer;
+        pResponse->bufferLen = HTTP_DOWNLOAD_BUFFER_LENGTH;
+
+        httpStatus = HTTPClient_Send( &transportInterface,
+                                      &requestHeaders,
+                                      NULL,
+                                      0U,
+                                      pResponse,
+                                      0U );
+    }
+
+    if( httpStatus != HTTP_SUCCESS )
+    {
+        LogWarn( ( "Request for bytes %lu-%lu failed: Error=%s.",
+                   ( unsigned long ) offset,
+                   ( unsigned long ) ( offset + length - 1U ),
+                   HTTPClient_strerror( httpStatus ) ) );
+        status = HttpDownloadRangeFailed;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool readObjectLength( const HTTPResponse_t * pResponse,
+                              size_t * pObjectLength )
+{
+    bool found = false;
+    const char * pValue = NULL;
+    size_t valueLength = 0U, i = 0U, objectLength = 0U;
+
+    if( HTTPClient_ReadHeader( pResponse,
+                               CONTENT_RANGE_FIELD,
+                               CONTENT_RANGE_FIELD_LENGTH,
+                               &pValue,
+                               &valueLength ) == HTTP_SUCCESS )
+    {
+        /* The size follows the last '/', and is '*' when it is unknown. */
+        i = valueLength;
+
+        while( ( i > 0U ) && ( pValue[ i - 1U ] != '/' ) )
+        {
+            i--;
+        }
+
+        found = ( i > 0U ) && ( i < valueLength );
+
+        for( ; ( found == true ) && ( i < valueLength ); i++ )
+        {
+            if( ( pValue[ i ] < '0' ) || ( pValue[ i ] > '9' ) ||
+                ( objectLength > ( ( size_t ) HTTP_DOWNLOAD_MAX_OFFSET / 10U ) ) )
+            {
+                found = false;
+            }
+            else
+            {
+                objectLength = ( objectLength * 10U ) + ( size_t ) ( pValue[ i ] - '0' );
+            }
+        }
+    }
+
+    /* The last byte of the object must fit a Range header. */
+    if( objectLength > ( ( size_t ) HTTP_DOWNLOAD_MAX_OFFSET + 1U ) )
+    {
+        found = false;
+    }
+
+    if( found == true )
+    {
+        *pObjectLength = objectLength;
+    }
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpDownloadStatus_t writeRange( int fileDescriptor,
+                                        const uint8_t * pData,
+                                        size_t length,
+                                        size_t offset )
+{
+    HttpDownloadStatus_t status = HttpDownloadSuccess;
+    size_t written = 0U;
+    ssize_t result = 0;
+
+    while( ( status == HttpDownloadSuccess ) && ( written < length ) )
+    {
+        result = pwrite( fileDescriptor,
+                         &pData[ written ],
+                         length - written,
+                         ( off_t ) ( offset + written ) );
+
+        if( result > 0 )
+        {
+            written += ( size_t ) result;
+        }
+        else if( ( result < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before writing anything; write again. */
+        }
+        else
+        {
+            LogError( ( "Failed to write bytes at offset %lu: errno=%d.",
+                        ( unsigned long ) ( offset + written ),
+                        errno ) );
+            status = HttpDownloadFileError;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpDownloadStatus_t fetchRange( DownloadConnection_t * pConnection,
+                                        size_t index )
+{
+    HttpDownloadStatus_t status = HttpDownloadSuccess;
+    HTTPResponse_t response;
+    DownloadState_t * pState = pConnection->pState;
+    size_t offset = index * pState->pConfig->rangeLength;
+    size_t length = pState->objectLength - offset;
+
+    if( length > pState->pConfig->rangeLength )
+    {
+        length = pState->pConfig->rangeLength;
+    }
+
+    status = requestRange( pConnection, offset, length, &response );
+
+    if( status == HttpDownloadSuccess )
+    {
+        if( response.statusCode != HTTP_STATUS_PARTIAL_CONTENT )
+        {
+            LogError( ( "Server answered bytes %lu-%lu with status %u.",
+                        ( unsigned long ) offset,
+                        ( unsigned long ) ( offset + length - 1U ),
+                        ( unsigned int ) response.statusCode ) );
+            status = HttpDownloadUnexpectedResponse;
+        }
+        else if( response.bodyLen != length )
+        {
+            LogWarn( ( "Received %lu of %lu bytes at offset %lu.",
+                       ( unsigned long ) response.bodyLen,
+                       ( unsigned long ) length,
+                       ( unsigned long ) offset ) );
+            status = HttpDownloadRangeFailed;
+        }
+        else
+        {
+            status = writeRange( pState->pConfig->fileDescriptor,
+                                 response.pBody,
+                                 length,
+                                 offset );
+        }
+
+        /* The server may close the connection after any response. */
+        if( ( response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U )
+        {
+            closeConnection( pConnection );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpDownloadStatus_t fetchFirstRange( DownloadConnection_t * pConnection )
+{
+    HttpDownloadStatus_t status = HttpDownloadSuccess;
+    HTTPResponse_t response;
+    DownloadState_t * pState = pConnection->pState;
+    size_t rangeLength = pState->pConfig->rangeLength;
+    size_t objectLength = 0U;
+
+    status = requestRange( pConnection, 0U, rangeLength, &response );
+
+    if( status != HttpDownloadSuccess )
+    {
+        /* No response to read. */
+    }
+    else if( response.statusCode == HTTP_STATUS_OK )
+    {
+        /* The server ignores ranges; the body is the whole object. */
+        pState->objectLength = response.bodyLen;
+        status = writeRange( pState->pConfig->fileDescriptor, response.pBody, response.bodyLen, 0U );
+    }
+    else if( ( response.statusCode != HTTP_STATUS_PARTIAL_CONTENT ) ||
+             ( readObjectLength( &response, &objectLength ) == false ) )
+    {
+        LogError( ( "Server answered the first range with status %u, "
+                    "without the size of the object.",
+                    ( unsigned int ) response.statusCode ) );
+        status = HttpDownloadUnexpectedResponse;
+    }
+    else if( response.bodyLen != ( ( objectLength < rangeLength ) ? objectLength : rangeLength ) )
+    {
+        LogWarn( ( "Received %lu bytes of the first range.",
+                   ( unsigned long ) response.bodyLen ) );
+        status = HttpDownloadRangeFailed;
+    }
+    else
+    {
+        pState->objectLength = objectLength;
+        status = writeRange( pState->pConfig->fileDescriptor, response.pBody, response.bodyLen, 0U );
+    }
+
+    /* The server may close the connection after any response. */
+    if( ( status != HttpDownloadRangeFailed ) &&
+        ( ( response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U ) )
+    {
+        closeConnection( pConnection );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool takeRange( DownloadState_t * pState,
+                       size_t * pIndex,
+                       uint32_t * pAttempts )
+{
+    bool taken = false;
+
+    ( void ) pthread_mutex_lock( &pState->lock );
+
+    if( pState->status != HttpDownloadSuccess )
+    {
+        /* The download has failed; stop. */
+    }
+    else if( pState->retryCount > 0U )
+    {
+        pState->retryCount--;
+        *pIndex = pState->retryRanges[ pState->retryCount ].index;
+        *pAttempts = pState->retryRanges[ pState->retryCount ].attempts;
+        taken = true;
+    }
+    else if( pState->nextRange < pState->rangeCount )
+    {
+        *pIndex = pState->nextRange;
+        *pAttempts = 0U;
+        pState->nextRange++;
+        taken = true;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    ( void ) pthread_mutex_unlock( &pState->lock );
+
+    return taken;
+}
+
+/*-----------------------------------------------------------*/
+
+static void returnRange( DownloadState_t * pState,
+                         size_t index,
+                         uint32_t attempts )
+{
+    ( void ) pthread_mutex_lock( &pState->lock );
+
+    if( attempts >= pState->pConfig->maxRangeAttempts )
+    {
+        LogError( ( "Range %lu failed %u times.",
+                    ( unsigned long ) index,
+                    ( unsigned int ) attempts ) );
+
+        if( pState->status == HttpDownloadSuccess )
+        {
+            pState->status = HttpDownloadRangeFailed;
+        }
+    }
+    else
+    {
+        /* Each connection holds at most one range, so the stack has room. */
+        assert( pState->retryCount < HTTP_DOWNLOAD_MAX_CONNECTIONS );
+        pState->retryRanges[ pState->retryCount ].index = index;
+        pState->retryRanges[ pState->retryCount ].attempts = attempts;
+        pState->retryCount++;
+    }
+
+    ( void ) pthread_mutex_unlock( &pState->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+static void failDownload( DownloadState_t * pState,
+                          HttpDownloadStatus_t status )
+{
+    ( void ) pthread_mutex_lock( &pState->lock );
+
+    if( pState->status == HttpDownloadSuccess )
+    {
+        pState->status = status;
+    }
+
+    ( void ) pthread_mutex_unlock( &pState->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * connectionThread( void * pArgument )
+{
+    DownloadConnection_t * pConnection = ( DownloadConnection_t * ) pArgument;
+    DownloadState_t * pState = pConnection->pState;
+    HttpDownloadStatus_t status = HttpDownloadSuccess;
+    size_t index = 0U;
+    uint32_t attempts = 0U;
+    bool running = true;
+
+    while( ( running == true ) && ( takeRange( pState, &index, &attempts ) == true ) )
+    {
+        if( ( pConnection->connected == false ) && ( openConnection( pConnection ) == false ) )
+        {
+            /* Leave the range to the connections that are still up. */
+            returnRange( pState, index, attempts );
+            running = false;
+        }
+        else
+        {
+            status = fetchRange( pConnection, index );
+
+            if( status == HttpDownloadSuccess )
+            {
+                ( void ) pthread_mutex_lock( &pState->lock );
+                pState->completedCount++;
+                ( void ) pthread_mutex_unlock( &pState->lock );
+            }
+            else if( status == HttpDownloadRangeFailed )
+            {
+                /* The connection may be broken; the range goes to the next
+                 * free connection while this one is re-established. */
+                closeConnection( pConnection );
+                returnRange( pState, index, attempts + 1U );
+            }
+            else
+            {
+                failDownload( pState, status );
+                running = false;
+            }
+        }
+    }
+
+    closeConnection( pConnection );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpDownloadStatus_t HttpDownload_Run( const HttpDownloadConfig_t * pConfig,
+                                       size_t * pObjectLength )
+{
+    HttpDownloadStatus_t status = HttpDownloadSuccess;
+    DownloadState_t state;
+    HTTPRequestInfo_t requestInfo;
+    DownloadConnection_t * pFirst = &connections[ 0 ];
+    size_t i = 0U, threadCount = 0U;
+    uint32_t attempts = 0U;
+
+    if( ( pConfig == NULL ) || ( pConfig->pHost == NULL ) || ( pConfig->pPath == NULL ) ||
+        ( pConfig->connect == NULL ) || ( pConfig->connectionCount == 0U ) ||
+        ( pConfig->connectionCount > HTTP_DOWNLOAD_MAX_CONNECTIONS ) ||
+        ( pConfig->rangeLength == 0U ) ||
+        ( pConfig->rangeLength > ( HTTP_DOWNLOAD_BUFFER_LENGTH - HTTP_DOWNLOAD_HEADER_SPACE ) ) ||
+        ( pConfig->maxRangeAttempts == 0U ) )
+    {
+        status = HttpDownloadBadParameter;
+    }
+    else
+    {
+        ( void ) memset( &state, 0, sizeof( state ) );
+        state.pConfig = pConfig;
+        ( void ) pthread_mutex_init( &state.lock, NULL );
+
+        ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+        requestInfo.pHost = pConfig->pHost;
+        requestInfo.hostLen = pConfig->hostLength;
+        requestInfo.method = HTTP_METHOD_GET;
+        requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1U;
+        requestInfo.pPath = pConfig->pPath;
+        requestInfo.pathLen = pConfig->pathLength;
+
+        /* Keep the connection open for the next range. */
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        /* The headers are formatted once, and copied for each range. */
+        if( HttpTemplate_Init( &state.headerTemplate,
+                               state.templateBuffer,
+                               sizeof( state.templateBuffer ),
+                               &requestInfo ) != HttpTemplateSuccess )
+        {
+            LogError( ( "The request headers do not fit HTTP_DOWNLOAD_HEADER_SPACE." ) );
+            status = HttpDownloadBadParameter;
+        }
+
+        for( i = 0U; i < pConfig->connectionCount; i++ )
+        {
+            connections[ i ].pState = &state;
+            connections[ i ].connected = false;
+        }
+
+        if( status == HttpDownloadSuccess )
+        {
+            /* Request the first range on one connection, to learn the size of the
+             * object before sharing out the others. */
+            do
+            {
+                if( ( pFirst->connected == false ) && ( openConnection( pFirst ) == false ) )
+                {
+                    status = HttpDownloadConnectFailed;
+                }
+                else
+                {
+                    status = fetchFirstRange( pFirst );
+                    attempts++;
+
+                    if( status == HttpDownloadRangeFailed )
+                    {
+                        closeConnection( pFirst );
+                    }
+                }
+            } while( ( status == HttpDownloadRangeFailed ) && ( attempts < pConfig->maxRangeAttempts ) );
+        }
+
+        if( ( status == HttpDownloadSuccess ) && ( state.objectLength > pConfig->rangeLength ) )
+        {
+            state.rangeCount = ( state.objectLength + pConfig->rangeLength - 1U ) / pConfig->rangeLength;
+            state.nextRange = 1U;
+            state.completedCount = 1U;
+
+            LogInfo( ( "Downloading %lu bytes in %lu ranges over %lu connections.",
+                       ( unsigned long ) state.objectLength,
+                       ( unsigned long ) state.rangeCount,
+                       ( unsigned long ) pConfig->connectionCount ) );
+
+            /* More connections than remaining ranges would stay idle. */
+            for( i = 0U; ( i < pConfig->connectionCount ) && ( i < ( state.rangeCount - 1U ) ); i++ )
+            {
+                if( pthread_create( &connections[ i ].thread, NULL,
+                                    connectionThread, &connections[ i ] ) == 0 )
+                {
+                    threadCount = i + 1U;
+                }
+                else
+                {
+                    LogWarn( ( "Failed to create the thread of connection %lu.",
+                               ( unsigned long ) i ) );
+                    break;
+                }
+            }
+
+            for( i = 0U; i < threadCount; i++ )
+            {
+                ( void ) pthread_join( connections[ i ].thread, NULL );
+            }
+
+            if( threadCount == 0U )
+            {
+                status = HttpDownloadThreadError;
+            }
+            else if( state.status != HttpDownloadSuccess )
+            {
+                status = state.status;
+            }
+            else if( state.completedCount != state.rangeCount )
+            {
+                /* Every connection was lost with ranges left. */
+                status = HttpDownloadConnectFailed;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+
+        for( i = threadCount; i < pConfig->connectionCount; i++ )
+        {
+            closeConnection( &connections[ i ] );
+        }
+
+        ( void ) pthread_mutex_destroy( &state.lock );
+
+        if( pObjectLength != NULL )
+        {
+            *pObjectLength = state.objectLength;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
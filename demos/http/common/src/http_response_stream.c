@@ -0,0 +1,1280 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_response_stream.c
+ * @brief Implementation of the streaming of HTTP response bodies to a sink.
+ *
+ * The response is parsed by a state machine that is fed whatever each receive
+ * returns, so a line or a chunk may be split across receives. Lines are
+ * collected in a small buffer of the parser; body bytes are passed to the sink
+ * straight from the receive buffer.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+#include "http_response_stream.h"
+
+/**
+ * @brief The name of the header with the size of a request body.
+ */
+#define CONTENT_LENGTH_FIELD    "Content-Length"
+
+/**
+ * @brief The length of #CONTENT_LENGTH_FIELD.
+ */
+#define CONTENT_LENGTH_FIELD_LENGTH    ( sizeof( CONTENT_LENGTH_FIELD ) - 1U )
+
+/**
+ * @brief Space for the digits of a size in decimal.
+ */
+#define SIZE_DIGITS_LENGTH      ( 24U )
+
+/**
+ * @brief The header that announces a chunked request body.
+ */
+#define TRANSFER_ENCODING_FIELD           "Transfer-Encoding"
+
+/**
+ * @brief The value of #TRANSFER_ENCODING_FIELD for a chunked body.
+ */
+#define TRANSFER_ENCODING_CHUNKED         "chunked"
+
+/**
+ * @brief Space for the size line of a chunk: the size in hexadecimal and a
+ * line break.
+ */
+#define CHUNK_SIZE_LINE_LENGTH            ( 18U )
+
+/**
+ * @brief The last chunk and the empty trailer that end a chunked body.
+ */
+#define LAST_CHUNK                        "0\r\n\r\n"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The part of the response the parser is in.
+ */
+typedef enum ParseState
+{
+    ParseStatusLine, /**< @brief Reading the status line. */
+    ParseHeaderLine, /**< @brief Reading header lines, up to an empty line. */
+    ParseBodyLength, /**< @brief Reading a body of known size. */
+    ParseBodyClose,  /**< @brief Reading a body that ends when the connection closes. */
+    ParseChunkSize,  /**< @brief Reading the size line of a chunk. */
+    ParseChunkData,  /**< @brief Reading the data of a chunk. */
+    ParseChunkEnd,   /**< @brief Reading the line break after the data of a chunk. */
+    ParseTrailer,    /**< @brief Reading trailer lines after the last chunk. */
+    ParseDone        /**< @brief The response is complete. */
+} ParseState_t;
+
+/**
+ * @brief The state of the parser of a response.
+ */
+typedef struct ResponseParser
+{
+    ParseState_t state;                        /**< @brief The part of the response being read. */
+    char line[ HTTP_STREAM_MAX_LINE_LENGTH ];  /**< @brief The start of the current line. */
+    size_t lineLength;                         /**< @brief Characters kept in @ref line. */
+    size_t remaining;                          /**< @brief Bytes left of the body or chunk. */
+    bool chunked;                              /**< @brief Whether the body is chunked. */
+    bool hasContentLength;                     /**< @brief Whether the body size is known. */
+    bool noBody;                               /**< @brief Whether the response has no body, as for HEAD. */
+    HttpBodySink_t sink;                       /**< @brief The sink of the body. */
+    void * pSinkContext;                       /**< @brief Context of the sink. */
+    HttpStreamResponse_t * pResponse;          /**< @brief The response. */
+} ResponseParser_t;
+
+/**
+ * @brief The buffer responses are received into, with the bytes received but
+ * not parsed yet, which belong to the next response.
+ */
+typedef struct ReceiveBuffer
+{
+    uint8_t * pBuffer; /**< @brief The buffer. */
+    size_t length;     /**< @brief The size of the buffer. */
+    size_t offset;     /**< @brief The first unparsed byte. */
+    size_t pending;    /**< @brief The number of unparsed bytes. */
+} ReceiveBuffer_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send all of a buffer over the transport.
+ *
+ * @param[in] pTransport The transport interface.
+ * @param[in] pData The data.
+ * @param[in] length The size of the data.
+ *
+ * @return true if all of it was sent.
+ */
+static bool sendAll( const TransportInterface_t * pTransport,
+                     const uint8_t * pData,
+                     size_t length );
+
+/**
+ * @brief Find the value of a header in a header line, if the line is that
+ * header.
+ *
+ * @param[in] pLine The header line.
+ * @param[in] lineLength The length of the line.
+ * @param[in] pName The header name, in lower case.
+ * @param[out] ppValue The value, after leading spaces.
+ * @param[out] pValueLength The length of the value, without trailing spaces.
+ *
+ * @return true if the line holds the header.
+ */
+static bool matchHeader( const char * pLine,
+                         size_t lineLength,
+                         const char * pName,
+                         const char ** ppValue,
+                         size_t * pValueLength );
+
+/**
+ * @brief Whether a header value holds a token, ignoring case.
+ *
+ * @param[in] pValue The value.
+ * @param[in] valueLength The length of the value.
+ * @param[in] pToken The token, in lower case.
+ *
+ * @return true if the token is found.
+ */
+static bool containsToken( const char * pValue,
+                           size_t valueLength,
+                           const char * pToken );
+
+/**
+ * @brief Read a number at the start of a string.
+ *
+ * @param[in] pText The string.
+ * @param[in] length The length of the string.
+ * @param[in] base 10 or 16.
+ * @param[out] pNumber The number.
+ *
+ * @return true if the string starts with a digit and the number fits.
+ */
+static bool readNumber( const char * pText,
+                        size_t length,
+                        size_t base,
+                        size_t * pNumber );
+
+/**
+ * @brief Handle the status line, a header line or the end of the headers.
+ *
+ * @param[in] pParser The parser.
+ *
+ * @return #HttpStreamSuccess or #HttpStreamParseError.
+ */
+static HttpStreamStatus_t parseHeaderLine( ResponseParser_t * pParser );
+
+/**
+ * @brief Handle a complete line of the parser.
+ *
+ * @param[in] pParser The parser.
+ *
+ * @return #HttpStreamSuccess or #HttpStreamParseError.
+ */
+static HttpStreamStatus_t parseLine( ResponseParser_t * pParser );
+
+/**
+ * @brief Parse received bytes, passing the body to the sink.
+ *
+ * @param[in] pParser The parser.
+ * @param[in] pData The received bytes.
+ * @param[in] length The number of received bytes.
+ * @param[out] pConsumed The bytes parsed, which are fewer than @p length
+ * when the response ends before them.
+ *
+ * @return #HttpStreamSuccess, #HttpStreamParseError or #HttpStreamSinkError.
+ */
+static HttpStreamStatus_t parseBytes( ResponseParser_t * pParser,
+                                      const uint8_t * pData,
+                                      size_t length,
+                                      size_t * pConsumed );
+
+/**
+ * @brief Whether a request may be pipelined, from the method at the start of
+ * its headers. Non-idempotent methods are not.
+ *
+ * @param[in] pRequestHeaders The request headers.
+ *
+ * @return true if the method is idempotent.
+ */
+static bool isIdempotent( const HTTPRequestHeaders_t * pRequestHeaders );
+
+/**
+ * @brief Add the header that gives the framing of a request body: its
+ * Content-Length, or Transfer-Encoding chunked.
+ *
+ * @param[in] pRequestHeaders The request headers.
+ * @param[in] chunked Whether the body is chunked.
+ * @param[in] length The length of a body that is not chunked. No header is
+ * added for an empty body.
+ *
+ * @return #HttpStreamSuccess or #HttpStreamSendFailed.
+ */
+static HttpStreamStatus_t addBodyHeader( HTTPRequestHeaders_t * pRequestHeaders,
+                                         bool chunked,
+                                         size_t length );
+
+/**
+ * @brief Read the next piece of a request body from its source or its file.
+ *
+ * @param[in] pBody The request body.
+ * @param[in] bodyOffset The bytes of the body read so far.
+ * @param[out] pBuffer The buffer to read into.
+ * @param[in] bufferLength The size of @p pBuffer.
+ *
+ * @return The number of bytes read, 0 at the end of the body, or a negative
+ * value on error.
+ */
+static int32_t readBody( const HttpRequestBody_t * pBody,
+                         size_t bodyOffset,
+                         uint8_t * pBuffer,
+                         size_t bufferLength );
+
+/**
+ * @brief Send a request body read from its source, in chunks or up to its
+ * length.
+ *
+ * @param[in] pTransport The transport interface.
+ * @param[in] pBody The request body.
+ * @param[in] pBuffer The buffer the body is read into.
+ * @param[in] bufferLength The size of @p pBuffer.
+ *
+ * @return #HttpStreamSuccess, #HttpStreamSendFailed or #HttpStreamSourceError.
+ */
+static HttpStreamStatus_t sendBody( const TransportInterface_t * pTransport,
+                                    const HttpRequestBody_t * pBody,
+                                    uint8_t * pBuffer,
+                                    size_t bufferLength );
+
+/**
+ * @brief Add the Content-Length header of a request body, then send the
+ * request.
+ *
+ * @param[in] pTransport The transport interface.
+ * @param[in] pRequestHeaders The request headers.
+ * @param[in] pRequestBody The request body, or NULL.
+ * @param[in] requestBodyLength The size of the request body.
+ *
+ * @return #HttpStreamSuccess or #HttpStreamSendFailed.
+ */
+static HttpStreamStatus_t sendRequest( const TransportInterface_t * pTransport,
+                                       HTTPRequestHeaders_t * pRequestHeaders,
+                                       const uint8_t * pRequestBody,
+                                       size_t requestBodyLength );
+
+/**
+ * @brief Receive and parse one response, starting with the bytes left in the
+ * receive buffer by the previous response.
+ *
+ * @param[in] pTransport The transport interface.
+ * @param[in] noBody Whether the response has no body, as for a HEAD request,
+ * whatever its headers say.
+ * @param[in] pReceive The receive buffer and its unparsed bytes.
+ * @param[in] sink The sink of the body.
+ * @param[in] pSinkContext Context passed to @p sink.
+ * @param[out] pResponse The response.
+ *
+ * @return #HttpStreamSuccess or the reason the response is incomplete.
+ */
+static HttpStreamStatus_t receiveResponse( const TransportInterface_t * pTransport,
+                                           bool noBody,
+                                           ReceiveBuffer_t * pReceive,
+                                           HttpBodySink_t sink,
+                                           void * pSinkContext,
+                                           HttpStreamResponse_t * pResponse );
+
+/**
+ * @brief Whether a request is a HEAD request, whose response has no body.
+ *
+ * @param[in] pRequestHeaders The request headers, before their buffer is
+ * reused.
+ *
+ * @return true for a HEAD request.
+ */
+static bool isHeadRequest( const HTTPRequestHeaders_t * pRequestHeaders );
+
+/*-----------------------------------------------------------*/
+
+static bool sendAll( const TransportInterface_t * pTransport,
+                     const uint8_t * pData,
+                     size_t length )
+{
+    size_t sent = 0U;
+    uint32_t emptySends = 0U;
+    int32_t result = 0;
+
+    while( ( sent < length ) && ( emptySends <= HTTP_STREAM_MAX_EMPTY_RECVS ) )
+    {
+        result = pTransport->send( pTransport->pNetworkContext, &pData[ sent ], length - sent );
+
+        if( result > 0 )
+        {
+            sent += ( size_t ) result;
+            emptySends = 0U;
+        }
+        else if( result == 0 )
+        {
+            emptySends++;
+        }
+        else
+        {
+            /* The connection failed; stop. */
+            emptySends = HTTP_STREAM_MAX_EMPTY_RECVS + 1U;
+        }
+    }
+
+    return sent == length;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool matchHeader( const char * pLine,
+                         size_t lineLength,
+                         const char * pName,
+                         const char ** ppValue,
+                         size_t * pValueLength )
+{
+    size_t nameLength = strlen( pName ), i = 0U;
+    bool matches = ( lineLength > nameLength ) && ( pLine[ nameLength ] == ':' );
+
+    for( i = 0U; ( matches == true ) && ( i < nameLength ); i++ )
+    {
+        matches = ( ( pLine[ i ] | 0x20 ) == pName[ i ] );
+    }
+
+    if( matches == true )
+    {
+        i = nameLength + 1U;
+
+        while( ( i < lineLength ) && ( ( pLine[ i ] == ' ' ) || ( pLine[ i ] == '\t' ) ) )
+        {
+            i++;
+        }
+
+        while( ( lineLength > i ) && ( ( pLine[ lineLength - 1U ] == ' ' ) || ( pLine[ lineLength - 1U ] == '\t' ) ) )
+        {
+            lineLength--;
+        }
+
+        *ppValue = &pLine[ i ];
+        *pValueLength = lineLength - i;
+    }
+
+    return matches;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool containsToken( const char * pValue,
+                           size_t valueLength,
+                           const char * pToken )
+{
+    size_t tokenLength = strlen( pToken ), i = 0U, j = 0U;
+    bool found = false;
+
+    for( i = 0U; ( found == false ) && ( ( i + tokenLength ) <= valueLength ); i++ )
+    {
+        for( j = 0U; ( j < tokenLength ) && ( ( pValue[ i + j ] | 0x20 ) == pToken[ j ] ); j++ )
+        {
+        }
+
+        found = ( j == tokenLength );
+    }
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool readNumber( const char * pText,
+                        size_t length,
+                        size_t base,
+                        size_t * pNumber )
+{
+    size_t number = 0U, digit = 0U, i = 0U;
+    bool valid = true;
+    char c = '\0';
+
+    while( ( valid == true ) && ( i < length ) )
+    {
+        c = ( char ) ( pText[ i ] | 0x20 );
+
+        if( ( pText[ i ] >= '0' ) && ( pText[ i ] <= '9' ) )
+        {
+            digit = ( size_t ) ( pText[ i ] - '0' );
+        }
+        else if( ( base == 16U ) && ( c >= 'a' ) && ( c <= 'f' ) )
+        {
+            digit = ( size_t ) ( c - 'a' ) + 10U;
+        }
+        else
+        {
+            /* The number ends here. */
+            break;
+        }
+
+        if( number > ( ( SIZE_MAX - digit ) / base ) )
+        {
+            valid = false;
+        }
+        else
+        {
+            number = ( number * base ) + digit;
+            i++;
+        }
+    }
+
+    /* At least one digit is needed. */
+    if( ( valid == true ) && ( i > 0U ) )
+    {
+        *pNumber = number;
+    }
+    else
+    {
+        valid = false;
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpStreamStatus_t parseHeaderLine( ResponseParser_t * pParser )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    const char * pValue = NULL;
+    size_t valueLength = 0U, statusCode = 0U;
+    HttpStreamResponse_t * pResponse = pParser->pResponse;
+
+    if( pParser->state == ParseStatusLine )
+    {
+        /* "HTTP/1.1 200 OK" */
+        if( ( pParser->lineLength < 12U ) || ( strncmp( pParser->line, "HTTP/1.", 7U ) != 0 ) ||
+            ( pParser->line[ 8 ] != ' ' ) ||
+            ( readNumber( &pParser->line[ 9 ], 3U, 10U, &statusCode ) == false ) )
+        {
+            status = HttpStreamParseError;
+        }
+        else
+        {
+            pResponse->statusCode = ( uint16_t ) statusCode;
+
+            /* HTTP/1.0 closes the connection unless asked not to. */
+            pResponse->connectionClose = ( pParser->line[ 7 ] == '0' );
+            pParser->state = ParseHeaderLine;
+        }
+    }
+    else if( pParser->lineLength > 0U )
+    {
+        if( matchHeader( pParser->line, pParser->lineLength, "content-length", &pValue, &valueLength ) == true )
+        {
+            if( readNumber( pValue, valueLength, 10U, &pParser->remaining ) == false )
+            {
+                status = HttpStreamParseError;
+            }
+
+            pParser->hasContentLength = true;
+        }
+        else if( matchHeader( pParser->line, pParser->lineLength, "transfer-encoding", &pValue, &valueLength ) == true )
+        {
+            pParser->chunked = containsToken( pValue, valueLength, "chunked" );
+        }
+        else if( matchHeader( pParser->line, pParser->lineLength, "connection", &pValue, &valueLength ) == true )
+        {
+            if( containsToken( pValue, valueLength, "close" ) == true )
+            {
+                pResponse->connectionClose = true;
+            }
+            else if( containsToken( pValue, valueLength, "keep-alive" ) == true )
+            {
+                pResponse->connectionClose = false;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+        else
+        {
+            /* Other headers are not needed. */
+        }
+    }
+    else if( ( pResponse->statusCode >= 100U ) && ( pResponse->statusCode < 200U ) )
+    {
+        /* An interim response; the final one follows. */
+        pParser->state = ParseStatusLine;
+        pParser->chunked = false;
+        pParser->hasContentLength = false;
+    }
+    else if( ( pParser->noBody == true ) || ( pResponse->statusCode == 204U ) ||
+             ( pResponse->statusCode == 304U ) )
+    {
+        pParser->state = ParseDone;
+    }
+    else if( pParser->chunked == true )
+    {
+        pParser->state = ParseChunkSize;
+    }
+    else if( pParser->hasContentLength == true )
+    {
+        pParser->state = ( pParser->remaining > 0U ) ? ParseBodyLength : ParseDone;
+    }
+    else
+    {
+        /* The body ends when the server closes the connection. */
+        pResponse->connectionClose = true;
+        pParser->state = ParseBodyClose;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpStreamStatus_t parseLine( ResponseParser_t * pParser )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+
+    switch( pParser->state )
+    {
+        case ParseStatusLine:
+        case ParseHeaderLine:
+            status = parseHeaderLine( pParser );
+            break;
+
+        case ParseChunkSize:
+
+            /* The size may be followed by extensions, which are ignored. */
+            if( readNumber( pParser->line, pParser->lineLength, 16U, &pParser->remaining ) == false )
+            {
+                status = HttpStreamParseError;
+            }
+            else
+            {
+                pParser->state = ( pParser->remaining > 0U ) ? ParseChunkData : ParseTrailer;
+            }
+
+            break;
+
+        case ParseChunkEnd:
+
+            if( pParser->lineLength != 0U )
+            {
+                status = HttpStreamParseError;
+            }
+            else
+            {
+                pParser->state = ParseChunkSize;
+            }
+
+            break;
+
+        case ParseTrailer:
+
+            /* Trailer headers are ignored, up to the empty line. */
+            if( pParser->lineLength == 0U )
+            {
+                pParser->state = ParseDone;
+            }
+
+            break;
+
+        default:
+            /* Body states do not read lines. */
+            break;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpStreamStatus_t parseBytes( ResponseParser_t * pParser,
+                                      const uint8_t * pData,
+                                      size_t length,
+                                      size_t * pConsumed )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    size_t offset = 0U, pieceLength = 0U;
+    char c = '\0';
+
+    while( ( status == HttpStreamSuccess ) && ( offset < length ) && ( pParser->state != ParseDone ) )
+    {
+        if( ( pParser->state == ParseBodyLength ) || ( pParser->state == ParseChunkData ) ||
+            ( pParser->state == ParseBodyClose ) )
+        {
+            pieceLength = length - offset;
+
+            if( ( pParser->state != ParseBodyClose ) && ( pieceLength > pParser->remaining ) )
+            {
+                pieceLength = pParser->remaining;
+            }
+
+            if( pParser->sink( pParser->pSinkContext, &pData[ offset ], pieceLength ) != 0 )
+            {
+                status = HttpStreamSinkError;
+            }
+
+            pParser->pResponse->bodyLength += pieceLength;
+            offset += pieceLength;
+
+            if( pParser->state != ParseBodyClose )
+            {
+                pParser->remaining -= pieceLength;
+
+                if( pParser->remaining == 0U )
+                {
+                    pParser->state = ( pParser->state == ParseChunkData ) ? ParseChunkEnd : ParseDone;
+                }
+            }
+        }
+        else
+        {
+            c = ( char ) pData[ offset ];
+            offset++;
+
+            if( c == '\n' )
+            {
+                /* Drop the carriage return of a CRLF line break. */
+                if( ( pParser->lineLength > 0U ) && ( pParser->line[ pParser->lineLength - 1U ] == '\r' ) )
+                {
+                    pParser->lineLength--;
+                }
+
+                status = parseLine( pParser );
+                pParser->lineLength = 0U;
+            }
+            else if( pParser->lineLength < HTTP_STREAM_MAX_LINE_LENGTH )
+            {
+                pParser->line[ pParser->lineLength ] = c;
+                pParser->lineLength++;
+            }
+            else
+            {
+                /* Only the start of a long line is kept. */
+            }
+        }
+    }
+
+    *pConsumed = offset;
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isIdempotent( const HTTPRequestHeaders_t * pRequestHeaders )
+{
+    static const char * const pNonIdempotentMethods[] = { "POST ", "PATCH ", "CONNECT " };
+    bool idempotent = true;
+    size_t i = 0U, methodLength = 0U;
+
+    for( i = 0U; i < ( sizeof( pNonIdempotentMethods ) / sizeof( pNonIdempotentMethods[ 0 ] ) ); i++ )
+    {
+        methodLength = strlen( pNonIdempotentMethods[ i ] );
+
+        if( ( pRequestHeaders->headersLen >= methodLength ) &&
+            ( memcmp( pRequestHeaders->pBuffer, pNonIdempotentMethods[ i ], methodLength ) == 0 ) )
+        {
+            idempotent = false;
+        }
+    }
+
+    return idempotent;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpStreamStatus_t addBodyHeader( HTTPRequestHeaders_t * pRequestHeaders,
+                                         bool chunked,
+                                         size_t length )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    HTTPStatus_t httpStatus = HTTP_SUCCESS;
+    char lengthDigits[ SIZE_DIGITS_LENGTH ];
+    size_t digitsLength = 0U, value = length;
+
+    if( chunked == true )
+    {
+        httpStatus = HTTPClient_AddHeader( pRequestHeaders,
+                                           TRANSFER_ENCODING_FIELD,
+                                           sizeof( TRANSFER_ENCODING_FIELD ) - 1U,
+                                           TRANSFER_ENCODING_CHUNKED,
+                                           sizeof( TRANSFER_ENCODING_CHUNKED ) - 1U );
+    }
+    else if( length > 0U )
+    {
+        /* Write the digits from the end of the buffer. */
+        do
+        {
+            digitsLength++;
+            lengthDigits[ SIZE_DIGITS_LENGTH - digitsLength ] = ( char ) ( '0' + ( value % 10U ) );
+            value /= 10U;
+        } while( value > 0U );
+
+        httpStatus = HTTPClient_AddHeader( pRequestHeaders,
+                                           CONTENT_LENGTH_FIELD,
+                                           CONTENT_LENGTH_FIELD_LENGTH,
+                                           &lengthDigits[ SIZE_DIGITS_LENGTH - digitsLength ],
+                                           digitsLength );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( httpStatus != HTTP_SUCCESS )
+    {
+        LogError( ( "Failed to add the body header of the HTTP request." ) );
+        status = HttpStreamSendFailed;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t readBody( const HttpRequestBody_t * pBody,
+                         size_t bodyOffset,
+                         uint8_t * pBuffer,
+                         size_t bufferLength )
+{
+    int32_t bytesRead = -1;
+    ssize_t fileBytes = 0;
+
+    if( bufferLength > ( size_t ) INT32_MAX )
+    {
+        bufferLength = ( size_t ) INT32_MAX;
+    }
+
+    if( pBody->source != NULL )
+    {
+        bytesRead = pBody->source( pBody->pSourceContext, pBuffer, bufferLength );
+    }
+    else
+    {
+        do
+        {
+            fileBytes = pread( pBody->fileDescriptor,
+                               pBuffer,
+                               bufferLength,
+                               pBody->fileOffset + ( off_t ) bodyOffset );
+        } while( ( fileBytes < 0 ) && ( errno == EINTR ) );
+
+        bytesRead = ( int32_t ) fileBytes;
+    }
+
+    return bytesRead;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpStreamStatus_t sendBody( const TransportInterface_t * pTransport,
+                                    const HttpRequestBody_t * pBody,
+                                    uint8_t * pBuffer,
+                                    size_t bufferLength )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    size_t sent = 0U, capacity = 0U, start = 0U, value = 0U;
+    uint32_t emptySends = 0U;
+    int32_t result = 0;
+    bool done = false;
+
+    while( ( status == HttpStreamSuccess ) && ( done == false ) )
+    {
+        if( ( pBody->chunked == false ) && ( sent == pBody->length ) )
+        {
+            done = true;
+        }
+        else if( ( pBody->chunked == false ) && ( pBody->source == NULL ) && ( pBody->sendFile != NULL ) )
+        {
+            /* The transport sends the file straight from the page cache. */
+            result = pBody->sendFile( pTransport->pNetworkContext,
+                                      pBody->fileDescriptor,
+                                      pBody->fileOffset + ( off_t ) sent,
+                                      pBody->length - sent );
+
+            if( result > 0 )
+            {
+                sent += ( size_t ) result;
+                emptySends = 0U;
+            }
+            else if( ( result == 0 ) && ( emptySends < HTTP_STREAM_MAX_EMPTY_RECVS ) )
+            {
+                emptySends++;
+            }
+            else
+            {
+                LogError( ( "Failed to send the file of the HTTP request body after %lu bytes.",
+                            ( unsigned long ) sent ) );
+                status = HttpStreamSendFailed;
+            }
+        }
+        else
+        {
+            /* A chunk is read behind the space for its size line, so that it
+             * is sent with its framing in one piece. */
+            start = ( pBody->chunked == true ) ? CHUNK_SIZE_LINE_LENGTH : 0U;
+            capacity = ( pBody->chunked == true ) ? ( bufferLength - HTTP_STREAM_CHUNK_FRAMING_LENGTH ) : bufferLength;
+
+            if( ( pBody->chunked == false ) && ( capacity > ( pBody->length - sent ) ) )
+            {
+                capacity = pBody->length - sent;
+            }
+
+            result = readBody( pBody, sent, &pBuffer[ start ], capacity );
+
+            if( result < 0 )
+            {
+                LogError( ( "Failed to read the HTTP request body after %lu bytes.",
+                            ( unsigned long ) sent ) );
+                status = HttpStreamSourceError;
+            }
+            else if( result == 0 )
+            {
+                if( pBody->chunked == true )
+                {
+                    if( sendAll( pTransport, ( const uint8_t * ) LAST_CHUNK, sizeof( LAST_CHUNK ) - 1U ) == false )
+                    {
+                        status = HttpStreamSendFailed;
+                    }
+
+                    done = true;
+                }
+                else
+                {
+                    LogError( ( "The HTTP request body ended after %lu of %lu bytes.",
+                                ( unsigned long ) sent,
+                                ( unsigned long ) pBody->length ) );
+                    status = HttpStreamSourceError;
+                }
+            }
+            else
+            {
+                if( pBody->chunked == true )
+                {
+                    /* Write the size in hexadecimal backwards from the line
+                     * break in front of the data. */
+                    start -= 2U;
+                    pBuffer[ start ] = ( uint8_t ) '\r';
+                    pBuffer[ start + 1U ] = ( uint8_t ) '\n';
+                    value = ( size_t ) result;
+
+                    do
+                    {
+                        start--;
+                        pBuffer[ start ] = ( uint8_t ) "0123456789abcdef"[ value & 0xFU ];
+                        value >>= 4;
+                    } while( value > 0U );
+
+                    pBuffer[ CHUNK_SIZE_LINE_LENGTH + ( size_t ) result ] = ( uint8_t ) '\r';
+                    pBuffer[ CHUNK_SIZE_LINE_LENGTH + ( size_t ) result + 1U ] = ( uint8_t ) '\n';
+
+                    if( sendAll( pTransport, &pBuffer[ start ],
+                                 ( CHUNK_SIZE_LINE_LENGTH - start ) + ( size_t ) result + 2U ) == false )
+                    {
+                        status = HttpStreamSendFailed;
+                    }
+                }
+                else if( sendAll( pTransport, pBuffer, ( size_t ) result ) == false )
+                {
+                    status = HttpStreamSendFailed;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+
+                sent += ( size_t ) result;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpStreamStatus_t sendRequest( const TransportInterface_t * pTransport,
+                                       HTTPRequestHeaders_t * pRequestHeaders,
+                                       const uint8_t * pRequestBody,
+                                       size_t requestBodyLength )
+{
+    HttpStreamStatus_t status = addBodyHeader( pRequestHeaders, false, requestBodyLength );
+
+    if( ( status == HttpStreamSuccess ) &&
+        ( ( sendAll( pTransport, pRequestHeaders->pBuffer, pRequestHeaders->headersLen ) == false ) ||
+          ( sendAll( pTransport, pRequestBody, requestBodyLength ) == false ) ) )
+    {
+        LogError( ( "Failed to send the HTTP request." ) );
+        status = HttpStreamSendFailed;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isHeadRequest( const HTTPRequestHeaders_t * pRequestHeaders )
+{
+    return ( pRequestHeaders->headersLen >= 5U ) &&
+           ( memcmp( pRequestHeaders->pBuffer, "HEAD ", 5U ) == 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static HttpStreamStatus_t receiveResponse( const TransportInterface_t * pTransport,
+                                           bool noBody,
+                                           ReceiveBuffer_t * pReceive,
+                                           HttpBodySink_t sink,
+                                           void * pSinkContext,
+                                           HttpStreamResponse_t * pResponse )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    ResponseParser_t parser;
+    size_t consumed = 0U;
+    uint32_t emptyRecvs = 0U;
+    int32_t received = 0;
+
+    ( void ) memset( pResponse, 0, sizeof( HttpStreamResponse_t ) );
+    ( void ) memset( &parser, 0, sizeof( parser ) );
+    parser.state = ParseStatusLine;
+    parser.sink = sink;
+    parser.pSinkContext = pSinkContext;
+    parser.pResponse = pResponse;
+    parser.noBody = noBody;
+
+    while( ( status == HttpStreamSuccess ) && ( parser.state != ParseDone ) )
+    {
+        if( pReceive->pending > 0U )
+        {
+            status = parseBytes( &parser,
+                                 &pReceive->pBuffer[ pReceive->offset ],
+                                 pReceive->pending,
+                                 &consumed );
+            pReceive->offset += consumed;
+            pReceive->pending -= consumed;
+        }
+        else
+        {
+            received = pTransport->recv( pTransport->pNetworkContext, pReceive->pBuffer, pReceive->length );
+
+            if( received > 0 )
+            {
+                emptyRecvs = 0U;
+                pReceive->offset = 0U;
+                pReceive->pending = ( size_t ) received;
+            }
+            else if( received < 0 )
+            {
+                /* A closed connection ends a body without a size. */
+                pResponse->connectionClose = true;
+
+                if( parser.state == ParseBodyClose )
+                {
+                    parser.state = ParseDone;
+                }
+                else
+                {
+                    status = HttpStreamNetworkError;
+                }
+            }
+            else if( emptyRecvs < HTTP_STREAM_MAX_EMPTY_RECVS )
+            {
+                emptyRecvs++;
+            }
+            else
+            {
+                status = HttpStreamNetworkError;
+            }
+        }
+    }
+
+    if( status != HttpStreamSuccess )
+    {
+        LogError( ( "HTTP response stream stopped: status=%d, bodyLength=%lu.",
+                    ( int ) status,
+                    ( unsigned long ) pResponse->bodyLength ) );
+
+        /* The rest of the response may still arrive on the connection. */
+        pResponse->connectionClose = true;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpStreamStatus_t HttpStream_Send( const TransportInterface_t * pTransport,
+                                    HTTPRequestHeaders_t * pRequestHeaders,
+                                    const uint8_t * pRequestBody,
+                                    size_t requestBodyLength,
+                                    uint8_t * pReceiveBuffer,
+                                    size_t receiveBufferLength,
+                                    HttpBodySink_t sink,
+                                    void * pSinkContext,
+                                    HttpStreamResponse_t * pResponse )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    ReceiveBuffer_t receive;
+    bool noBody = false;
+
+    if( ( pTransport == NULL ) || ( pRequestHeaders == NULL ) || ( pReceiveBuffer == NULL ) ||
+        ( receiveBufferLength == 0U ) || ( sink == NULL ) || ( pResponse == NULL ) ||
+        ( ( pRequestBody == NULL ) && ( requestBodyLength > 0U ) ) )
+    {
+        status = HttpStreamBadParameter;
+    }
+    else
+    {
+        /* The response to a HEAD request has headers but no body. */
+        noBody = isHeadRequest( pRequestHeaders );
+
+        /* The request headers are sent before their buffer may be reused for
+         * the response. */
+        status = sendRequest( pTransport, pRequestHeaders, pRequestBody, requestBodyLength );
+
+        if( status != HttpStreamSuccess )
+        {
+            ( void ) memset( pResponse, 0, sizeof( HttpStreamResponse_t ) );
+            pResponse->connectionClose = true;
+        }
+    }
+
+    if( status == HttpStreamSuccess )
+    {
+        receive.pBuffer = pReceiveBuffer;
+        receive.length = receiveBufferLength;
+        receive.offset = 0U;
+        receive.pending = 0U;
+
+        status = receiveResponse( pTransport, noBody, &receive,
+                                  sink, pSinkContext, pResponse );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpStreamStatus_t HttpStream_SendPipelined( const TransportInterface_t * pTransport,
+                                             HttpPipelineRequest_t * pRequests,
+                                             size_t requestCount,
+                                             uint8_t * pReceiveBuffer,
+                                             size_t receiveBufferLength,
+                                             size_t * pCompletedCount )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    ReceiveBuffer_t receive;
+    size_t sentCount = 0U, completedCount = 0U, i = 0U;
+    bool connectionClosed = false;
+
+    if( ( pTransport == NULL ) || ( pRequests == NULL ) || ( requestCount == 0U ) ||
+        ( pReceiveBuffer == NULL ) || ( receiveBufferLength == 0U ) || ( pCompletedCount == NULL ) )
+    {
+        status = HttpStreamBadParameter;
+    }
+    else
+    {
+        for( i = 0U; i < requestCount; i++ )
+        {
+            if( ( pRequests[ i ].pRequestHeaders == NULL ) || ( pRequests[ i ].sink == NULL ) ||
+                ( ( pRequests[ i ].pRequestBody == NULL ) && ( pRequests[ i ].requestBodyLength > 0U ) ) )
+            {
+                status = HttpStreamBadParameter;
+            }
+        }
+    }
+
+    if( status == HttpStreamSuccess )
+    {
+        receive.pBuffer = pReceiveBuffer;
+        receive.length = receiveBufferLength;
+        receive.offset = 0U;
+        receive.pending = 0U;
+    }
+
+    while( ( status == HttpStreamSuccess ) && ( completedCount < requestCount ) &&
+           ( connectionClosed == false ) )
+    {
+        /* Send the next batch: idempotent requests back to back, or a single
+         * non-idempotent request once every earlier response is in, so that
+         * it is never sent on a connection that may drop it unanswered. */
+        if( sentCount == completedCount )
+        {
+            do
+            {
+                status = sendRequest( pTransport,
+                                      pRequests[ sentCount ].pRequestHeaders,
+                                      pRequests[ sentCount ].pRequestBody,
+                                      pRequests[ sentCount ].requestBodyLength );
+                sentCount++;
+            } while( ( status == HttpStreamSuccess ) && ( sentCount < requestCount ) &&
+                     ( isIdempotent( pRequests[ sentCount - 1U ].pRequestHeaders ) == true ) &&
+                     ( isIdempotent( pRequests[ sentCount ].pRequestHeaders ) == true ) );
+        }
+
+        /* The responses come in the order of the requests. */
+        while( ( status == HttpStreamSuccess ) && ( completedCount < sentCount ) &&
+               ( connectionClosed == false ) )
+        {
+            status = receiveResponse( pTransport,
+                                      isHeadRequest( pRequests[ completedCount ].pRequestHeaders ),
+                                      &receive,
+                                      pRequests[ completedCount ].sink,
+                                      pRequests[ completedCount ].pSinkContext,
+                                      &pRequests[ completedCount ].response );
+
+            if( status == HttpStreamSuccess )
+            {
+                /* The requests after a closing response are not answered. */
+                connectionClosed = pRequests[ completedCount ].response.connectionClose;
+                completedCount++;
+            }
+        }
+    }
+
+    if( pCompletedCount != NULL )
+    {
+        *pCompletedCount = completedCount;
+    }
+
+    if( ( status == HttpStreamSuccess ) && ( completedCount < requestCount ) )
+    {
+        LogWarn( ( "The server closed the connection after %lu of %lu requests.",
+                   ( unsigned long ) completedCount,
+                   ( unsigned long ) requestCount ) );
+        status = HttpStreamNetworkError;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpStreamStatus_t HttpStream_Upload( const TransportInterface_t * pTransport,
+                                      HTTPRequestHeaders_t * pRequestHeaders,
+                                      const HttpRequestBody_t * pBody,
+                                      uint8_t * pReceiveBuffer,
+                                      size_t receiveBufferLength,
+                                      HttpBodySink_t sink,
+                                      void * pSinkContext,
+                                      HttpStreamResponse_t * pResponse )
+{
+    HttpStreamStatus_t status = HttpStreamSuccess;
+    ReceiveBuffer_t receive;
+    bool noBody = false;
+
+    if( ( pTransport == NULL ) || ( pRequestHeaders == NULL ) || ( pBody == NULL ) ||
+        ( pReceiveBuffer == NULL ) || ( receiveBufferLength == 0U ) || ( sink == NULL ) ||
+        ( pResponse == NULL ) ||
+        ( ( pBody->source == NULL ) && ( pBody->fileDescriptor < 0 ) ) ||
+        ( ( pBody->chunked == true ) && ( receiveBufferLength <= HTTP_STREAM_CHUNK_FRAMING_LENGTH ) ) )
+    {
+        status = HttpStreamBadParameter;
+    }
+    else
+    {
+        /* The body may overwrite the request headers. */
+        noBody = isHeadRequest( pRequestHeaders );
+        status = addBodyHeader( pRequestHeaders, pBody->chunked, pBody->length );
+
+        if( ( status == HttpStreamSuccess ) &&
+            ( sendAll( pTransport, pRequestHeaders->pBuffer, pRequestHeaders->headersLen ) == false ) )
+        {
+            LogError( ( "Failed to send the HTTP request headers." ) );
+            status = HttpStreamSendFailed;
+        }
+
+        /* The headers are sent, so their buffer may hold the body. */
+        if( status == HttpStreamSuccess )
+        {
+            status = sendBody( pTransport, pBody, pReceiveBuffer, receiveBufferLength );
+        }
+
+        if( status != HttpStreamSuccess )
+        {
+            /* The server still waits for the rest of the body. */
+            ( void ) memset( pResponse, 0, sizeof( HttpStreamResponse_t ) );
+            pResponse->connectionClose = true;
+        }
+    }
+
+    if( status == HttpStreamSuccess )
+    {
+        receive.pBuffer = pReceiveBuffer;
+        receive.length = receiveBufferLength;
+        receive.offset = 0U;
+        receive.pending = 0U;
+
+        status = receiveResponse( pTransport, noBody, &receive,
+                                  sink, pSinkContext, pResponse );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t HttpStream_FileSink( void * pSinkContext,
+                             const uint8_t * pData,
+                             size_t length )
+{
+    int32_t result = 0;
+    int fileDescriptor = *( ( const int * ) pSinkContext );
+    size_t written = 0U;
+    ssize_t bytesWritten = 0;
+
+    while( ( result == 0 ) && ( written < length ) )
+    {
+        bytesWritten = write( fileDescriptor, &pData[ written ], length - written );
+
+        if( bytesWritten > 0 )
+        {
+            written += ( size_t ) bytesWritten;
+        }
+        else if( ( bytesWritten < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before writing anything; write again. */
+        }
+        else
+        {
+            result = -1;
+        }
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
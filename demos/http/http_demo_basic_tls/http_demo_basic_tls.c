@@ -37,6 +37,9 @@
 /* HTTP API header. */
 #include "core_http_client.h"
 
+/* Streaming of response bodies. */
+#include "http_response_stream.h"
+
 /* OpenSSL transport header. */
 #include "openssl_posix.h"
 
@@ -210,6 +213,34 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
                                 const char * pPath,
                                 size_t pathLen );
 
+/**
+ * @brief The sink of a streamed response body, which logs each piece of the
+ * body as it arrives.
+ *
+ * @param[in] pSinkContext Pointer to the count of pieces received.
+ * @param[in] pData The piece of the body.
+ * @param[in] length The size of the piece.
+ *
+ * @return 0 to receive the rest of the body.
+ */
+static int32_t logBodySink( void * pSinkContext,
+                            const uint8_t * pData,
+                            size_t length );
+
+/**
+ * @brief Send an HTTP GET request and stream the response body to
+ * #logBodySink, so that the body may be larger than #userBuffer.
+ *
+ * @param[in] pTransportInterface The transport interface for making network calls.
+ * @param[in] pPath The Request-URI to the objects of interest.
+ * @param[in] pathLen The length of the Request-URI.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on success.
+ */
+static int32_t streamHttpGet( const TransportInterface_t * pTransportInterface,
+                              const char * pPath,
+                              size_t pathLen );
+
 /*-----------------------------------------------------------*/
 
 static int32_t connectToServer( NetworkContext_t * pNetworkContext )
@@ -367,6 +398,100 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
 
 /*-----------------------------------------------------------*/
 
+static int32_t logBodySink( void * pSinkContext,
+                            const uint8_t * pData,
+                            size_t length )
+{
+    uint32_t * pPieceCount = ( uint32_t * ) pSinkContext;
+
+    ( *pPieceCount )++;
+    LogDebug( ( "Response body piece %u:\n%.*s\n",
+                ( unsigned int ) *pPieceCount,
+                ( int32_t ) length, ( const char * ) pData ) );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t streamHttpGet( const TransportInterface_t * pTransportInterface,
+                              const char * pPath,
+                              size_t pathLen )
+{
+    /* Return value of this method. */
+    int32_t returnStatus = EXIT_SUCCESS;
+    /* Configurations of the initial request headers. */
+    HTTPRequestInfo_t requestInfo;
+    /* Represents header data that will be sent in an HTTP request. */
+    HTTPRequestHeaders_t requestHeaders;
+    /* The status and size of the streamed response. */
+    HttpStreamResponse_t response;
+    /* Status returned by the stream. */
+    HttpStreamStatus_t streamStatus = HttpStreamSuccess;
+    /* Number of pieces the body arrived in. */
+    uint32_t pieceCount = 0U;
+
+    assert( pPath != NULL );
+
+    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+
+    requestInfo.pHost = SERVER_HOST;
+    requestInfo.hostLen = SERVER_HOST_LENGTH;
+    requestInfo.method = HTTP_METHOD_GET;
+    requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
+    requestInfo.pPath = pPath;
+    requestInfo.pathLen = pathLen;
+    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    requestHeaders.pBuffer = userBuffer;
+    requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+
+    if( HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                             &requestInfo ) != HTTP_SUCCESS )
+    {
+        LogError( ( "Failed to initialize HTTP request headers." ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        LogInfo( ( "Streaming the response of HTTP GET %.*s%.*s...",
+                   ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST,
+                   ( int32_t ) pathLen, pPath ) );
+
+        /* The response is received into the buffer of the request headers
+         * once they are sent. */
+        streamStatus = HttpStream_Send( pTransportInterface,
+                                        &requestHeaders,
+                                        NULL,
+                                        0U,
+                                        userBuffer,
+                                        USER_BUFFER_LENGTH,
+                                        logBodySink,
+                                        &pieceCount,
+                                        &response );
+
+        if( streamStatus == HttpStreamSuccess )
+        {
+            LogInfo( ( "Received status %u and a body of %lu bytes in %u pieces.",
+                       ( unsigned int ) response.statusCode,
+                       ( unsigned long ) response.bodyLength,
+                       ( unsigned int ) pieceCount ) );
+        }
+        else
+        {
+            LogError( ( "Failed to stream HTTP GET %.*s: status=%d.",
+                        ( int32_t ) pathLen, pPath,
+                        ( int ) streamStatus ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Entry point of demo.
  *
@@ -375,7 +500,8 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
  * then finally performs a TLS handshake with the HTTP server so that all communication
  * is encrypted. After which, HTTP Client library API is used to send a GET, HEAD,
  * PUT, and POST request in that order. For each request, the HTTP response from the
- * server (or an error code) is logged.
+ * server (or an error code) is logged. A last GET request streams its response
+ * body in pieces, so that the body is not limited by the size of the buffer.
  *
  * @note This example is single-threaded and uses statically allocated memory.
  *
@@ -388,7 +514,7 @@ int main( int argc,
     /* The transport layer interface used by the HTTP Client library. */
     TransportInterface_t transportInterface;
     /* The network context for the transport layer interface. */
-    NetworkContext_t networkContext;
+    NetworkContext_t networkContext = { 0 };
     /* An array of HTTP paths to request. */
     const httpPathStrings_t httpMethodPaths[] =
     {
@@ -465,6 +591,15 @@ int main( int argc,
             }
         }
 
+        /* Send GET again, with a response body that may be larger than the
+         * buffer. */
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            returnStatus = streamHttpGet( &transportInterface,
+                                          GET_PATH,
+                                          GET_PATH_LENGTH );
+        }
+
         if( returnStatus == EXIT_SUCCESS )
         {
             /* Log message indicating an iteration completed successfully. */
@@ -0,0 +1,229 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+/* Common HTTP demo utilities. */
+#include "http_demo_utils.h"
+
+/* Parallel download header. */
+#include "http_parallel_download.h"
+
+/* OpenSSL transport header. */
+#include "openssl_posix.h"
+
+/* Check that hostname of the server is defined. */
+#ifndef SERVER_HOST
+    #error "Please define a SERVER_HOST."
+#endif
+
+/* Check that TLS port of the server is defined. */
+#ifndef HTTPS_PORT
+    #error "Please define a HTTPS_PORT."
+#endif
+
+/* Check that a path for Root CA Certificate is defined. */
+#ifndef ROOT_CA_CERT_PATH
+    #error "Please define a ROOT_CA_CERT_PATH."
+#endif
+
+/* Check that a path of the object to download is defined. */
+#ifndef GET_PATH
+    #error "Please define a GET_PATH."
+#endif
+
+/* Check that the file to download to is defined. */
+#ifndef DOWNLOAD_FILE_PATH
+    #error "Please define a DOWNLOAD_FILE_PATH."
+#endif
+
+/* Check that the number of connections is defined. */
+#ifndef DOWNLOAD_CONNECTION_COUNT
+    #define DOWNLOAD_CONNECTION_COUNT    ( 4U )
+#endif
+
+/* Check that the size of a range is defined. */
+#ifndef DOWNLOAD_RANGE_LENGTH
+    #define DOWNLOAD_RANGE_LENGTH    ( 16384U )
+#endif
+
+/* Check that the attempts of a range are defined. */
+#ifndef DOWNLOAD_MAX_RANGE_ATTEMPTS
+    #define DOWNLOAD_MAX_RANGE_ATTEMPTS    ( 3U )
+#endif
+
+/* Check that transport timeout for transport send and receive is defined. */
+#ifndef TRANSPORT_SEND_RECV_TIMEOUT_MS
+    #define TRANSPORT_SEND_RECV_TIMEOUT_MS    ( 1000 )
+#endif
+
+/**
+ * @brief The length of the HTTP server host name.
+ */
+#define SERVER_HOST_LENGTH    ( sizeof( SERVER_HOST ) - 1 )
+
+/**
+ * @brief The length of the HTTP GET path.
+ */
+#define GET_PATH_LENGTH       ( sizeof( GET_PATH ) - 1 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect to HTTP server. It is called for each connection of the
+ * download, and again when a connection is lost.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on successful connection.
+ */
+static int32_t connectToServer( NetworkContext_t * pNetworkContext );
+
+/*-----------------------------------------------------------*/
+
+static int32_t connectToServer( NetworkContext_t * pNetworkContext )
+{
+    int32_t returnStatus = EXIT_FAILURE;
+    /* Status returned by OpenSSL transport implementation. */
+    OpensslStatus_t opensslStatus;
+    /* Credentials to establish the TLS connection. */
+    OpensslCredentials_t opensslCredentials;
+    /* Information about the server to send the HTTP requests. */
+    ServerInfo_t serverInfo;
+
+    /* Initialize TLS credentials. */
+    ( void ) memset( &opensslCredentials, 0, sizeof( opensslCredentials ) );
+    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+
+    /* Initialize server information. */
+    serverInfo.pHostName = SERVER_HOST;
+    serverInfo.hostNameLength = SERVER_HOST_LENGTH;
+    serverInfo.port = HTTPS_PORT;
+
+    LogInfo( ( "Establishing a TLS session to %.*s:%d.",
+               ( int32_t ) SERVER_HOST_LENGTH,
+               SERVER_HOST,
+               HTTPS_PORT ) );
+    opensslStatus = Openssl_Connect( pNetworkContext,
+                                     &serverInfo,
+                                     &opensslCredentials,
+                                     TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                     TRANSPORT_SEND_RECV_TIMEOUT_MS );
+
+    if( opensslStatus == OPENSSL_SUCCESS )
+    {
+        returnStatus = EXIT_SUCCESS;
+    }
+    else
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry point of demo.
+ *
+ * This example downloads the object at GET_PATH into DOWNLOAD_FILE_PATH. It
+ * requests the first range of the object to learn its size, then splits the
+ * rest into ranges of DOWNLOAD_RANGE_LENGTH bytes, which are requested over
+ * DOWNLOAD_CONNECTION_COUNT TLS connections at once. Each range is written
+ * to its offset in the file as it arrives. A range whose request fails is
+ * requested again on another connection, while the failed connection is
+ * re-established.
+ *
+ * @note This example uses a thread per connection.
+ */
+int main( int argc,
+          char ** argv )
+{
+    /* Return value of main. */
+    int32_t returnStatus = EXIT_SUCCESS;
+    /* The download of the object. */
+    HttpDownloadConfig_t downloadConfig;
+    /* Status returned by the download. */
+    HttpDownloadStatus_t downloadStatus = HttpDownloadSuccess;
+    /* The size of the downloaded object. */
+    size_t objectLength = 0U;
+    /* The file the object is written to. */
+    int fileDescriptor = -1;
+
+    ( void ) argc;
+    ( void ) argv;
+
+    fileDescriptor = open( DOWNLOAD_FILE_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+    if( fileDescriptor < 0 )
+    {
+        LogError( ( "Failed to open %s for writing.", DOWNLOAD_FILE_PATH ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        ( void ) memset( &downloadConfig, 0, sizeof( downloadConfig ) );
+        downloadConfig.pHost = SERVER_HOST;
+        downloadConfig.hostLength = SERVER_HOST_LENGTH;
+        downloadConfig.pPath = GET_PATH;
+        downloadConfig.pathLength = GET_PATH_LENGTH;
+        downloadConfig.connect = connectToServer;
+        downloadConfig.fileDescriptor = fileDescriptor;
+        downloadConfig.connectionCount = DOWNLOAD_CONNECTION_COUNT;
+        downloadConfig.rangeLength = DOWNLOAD_RANGE_LENGTH;
+        downloadConfig.maxRangeAttempts = DOWNLOAD_MAX_RANGE_ATTEMPTS;
+
+        downloadStatus = HttpDownload_Run( &downloadConfig, &objectLength );
+
+        if( downloadStatus == HttpDownloadSuccess )
+        {
+            LogInfo( ( "Downloaded %lu bytes of %.*s%.*s to %s.",
+                       ( unsigned long ) objectLength,
+                       ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST,
+                       ( int32_t ) GET_PATH_LENGTH, GET_PATH,
+                       DOWNLOAD_FILE_PATH ) );
+            LogInfo( ( "Demo completed successfully." ) );
+        }
+        else
+        {
+            LogError( ( "Failed to download %.*s%.*s: status=%d.",
+                        ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST,
+                        ( int32_t ) GET_PATH_LENGTH, GET_PATH,
+                        ( int ) downloadStatus ) );
+            returnStatus = EXIT_FAILURE;
+        }
+
+        ( void ) close( fileDescriptor );
+    }
+
+    return returnStatus;
+}
@@ -92,4 +92,13 @@
  */
 #define REQUEST_BODY                      "Hello, world!"
 
+/**
+ * @brief Path of a file to upload with PUT to #PUT_PATH in each iteration of
+ * the demo.
+ *
+ * The file is sent from the file system to the socket with sendfile, and may
+ * be larger than memory. Uncomment to upload a file.
+ */
+/* #define UPLOAD_FILE_PATH                  "/var/log/syslog" */
+
 #endif /* ifndef DEMO_CONFIG_H */
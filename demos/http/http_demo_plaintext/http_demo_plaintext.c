@@ -37,9 +37,21 @@
 /* HTTP API header. */
 #include "core_http_client.h"
 
+/* Streaming and pipelining of HTTP responses. */
+#include "http_response_stream.h"
+
+/* Request headers formatted once for every request. */
+#include "http_header_template.h"
+
 /* Plaintext sockets transport header. */
 #include "plaintext_posix.h"
 
+#ifdef UPLOAD_FILE_PATH
+    /* POSIX includes. */
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#endif
+
 /* Check that hostname of the server is defined. */
 #ifndef SERVER_HOST
     #error "Please define a SERVER_HOST."
@@ -85,6 +97,11 @@
     #define USER_BUFFER_LENGTH    ( 1024 )
 #endif
 
+/* Check that size of the header template buffer is defined. */
+#ifndef HEADER_TEMPLATE_LENGTH
+    #define HEADER_TEMPLATE_LENGTH    ( 256 )
+#endif
+
 /**
  * @brief The length of the HTTP server host name.
  */
@@ -168,6 +185,23 @@ typedef struct httpMethodStrings
  */
 static uint8_t userBuffer[ USER_BUFFER_LENGTH ];
 
+/**
+ * @brief The buffers of the request headers of the pipelined requests, one
+ * per request, as all are sent before their responses are received into
+ * #userBuffer.
+ */
+static uint8_t pipelineBuffers[ NUMBER_HTTP_PATHS ][ USER_BUFFER_LENGTH ];
+
+/**
+ * @brief The headers shared by every request of the demo, formatted once.
+ */
+static HttpHeaderTemplate_t headerTemplate;
+
+/**
+ * @brief The memory of #headerTemplate.
+ */
+static uint8_t headerTemplateBuffer[ HEADER_TEMPLATE_LENGTH ];
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -179,6 +213,14 @@ static uint8_t userBuffer[ USER_BUFFER_LENGTH ];
  */
 static int32_t connectToServer( NetworkContext_t * pNetworkContext );
 
+/**
+ * @brief Format the headers that every request of the demo shares into
+ * #headerTemplate.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on success.
+ */
+static int32_t initializeHeaderTemplate( void );
+
 /**
  * @brief Send an HTTP request based on a specified method and path, then
  * print the response received from the server.
@@ -197,6 +239,50 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
                                 const char * pPath,
                                 size_t pathLen );
 
+/**
+ * @brief The sink of a streamed response body, which logs each piece of the
+ * body as it arrives.
+ *
+ * @param[in] pSinkContext The method of the request, as a string.
+ * @param[in] pData The piece of the body.
+ * @param[in] length The size of the piece.
+ *
+ * @return 0 to receive the rest of the body.
+ */
+static int32_t logBodySink( void * pSinkContext,
+                            const uint8_t * pData,
+                            size_t length );
+
+/**
+ * @brief Send HTTP requests on the connection without waiting for the
+ * response to each, then log the responses.
+ *
+ * The idempotent requests go out together, which saves a round trip each,
+ * while a POST is sent once the earlier responses are in.
+ *
+ * @param[in] pTransportInterface The transport interface for making network calls.
+ * @param[in] pMethods The methods of the requests.
+ * @param[in] pPaths The Request-URI of each request.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on success.
+ */
+static int32_t sendPipelinedRequests( const TransportInterface_t * pTransportInterface,
+                                      const httpMethodStrings_t * pMethods,
+                                      const httpPathStrings_t * pPaths );
+
+#ifdef UPLOAD_FILE_PATH
+
+/**
+ * @brief Upload #UPLOAD_FILE_PATH with a PUT request, sending the file to the
+ * socket without reading it into memory.
+ *
+ * @param[in] pTransportInterface The transport interface for making network calls.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on success.
+ */
+    static int32_t uploadFile( const TransportInterface_t * pTransportInterface );
+#endif
+
 /*-----------------------------------------------------------*/
 
 static int32_t connectToServer( NetworkContext_t * pNetworkContext )
@@ -238,6 +324,39 @@ static int32_t connectToServer( NetworkContext_t * pNetworkContext )
 
 /*-----------------------------------------------------------*/
 
+static int32_t initializeHeaderTemplate( void )
+{
+    /* Return value of this method. */
+    int32_t returnStatus = EXIT_SUCCESS;
+    /* Configurations of the headers shared by every request. */
+    HTTPRequestInfo_t requestInfo;
+
+    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+
+    /* The method and path are replaced in each request. */
+    requestInfo.pHost = SERVER_HOST;
+    requestInfo.hostLen = SERVER_HOST_LENGTH;
+    requestInfo.method = HTTP_METHOD_GET;
+    requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
+
+    /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
+     * can be sent over the same established TCP connection. */
+    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    if( HttpTemplate_Init( &headerTemplate,
+                           headerTemplateBuffer,
+                           HEADER_TEMPLATE_LENGTH,
+                           &requestInfo ) != HttpTemplateSuccess )
+    {
+        LogError( ( "Failed to initialize the HTTP header template." ) );
+        returnStatus = EXIT_FAILURE;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface,
                                 const char * pMethod,
                                 size_t methodLen,
@@ -247,11 +366,10 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
     /* Return value of this method. */
     int32_t returnStatus = EXIT_SUCCESS;
 
-    /* Configurations of the initial request headers that are passed to
-     * #HTTPClient_InitializeRequestHeaders. */
-    HTTPRequestInfo_t requestInfo;
+    /* The method and path of the request, patched into the template. */
+    HttpTemplateFields_t fields = { 0 };
     /* Represents a response returned from an HTTP server. */
-    HTTPResponse_t response;
+    HTTPResponse_t response = { 0 };
     /* Represents header data that will be sent in an HTTP request. */
     HTTPRequestHeaders_t requestHeaders;
 
@@ -261,29 +379,21 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
     assert( pMethod != NULL );
     assert( pPath != NULL );
 
-    /* Initialize all HTTP Client library API structs to 0. */
-    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
-    ( void ) memset( &response, 0, sizeof( response ) );
-    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
-
-    /* Initialize the request object. */
-    requestInfo.pHost = SERVER_HOST;
-    requestInfo.hostLen = SERVER_HOST_LENGTH;
-    requestInfo.method = pMethod;
-    requestInfo.methodLen = methodLen;
-    requestInfo.pPath = pPath;
-    requestInfo.pathLen = pathLen;
-
-    /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
-     * can be sent over the same established TCP connection. */
-    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+    fields.pMethod = pMethod;
+    fields.methodLength = methodLen;
+    fields.pPath = pPath;
+    fields.pathLength = pathLen;
 
     /* Set the buffer used for storing request headers. */
     requestHeaders.pBuffer = userBuffer;
     requestHeaders.bufferLen = USER_BUFFER_LENGTH;
 
-    httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
-                                                      &requestInfo );
+    /* The host, User-Agent and Connection headers come formatted from the
+     * template. */
+    if( HttpTemplate_Build( &headerTemplate, &fields, &requestHeaders ) != HttpTemplateSuccess )
+    {
+        httpStatus = HTTP_INSUFFICIENT_MEMORY;
+    }
 
     if( httpStatus == HTTP_SUCCESS )
     {
@@ -293,9 +403,9 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
         response.bufferLen = USER_BUFFER_LENGTH;
 
         LogInfo( ( "Sending HTTP %.*s request to %.*s%.*s...",
-                   ( int32_t ) requestInfo.methodLen, requestInfo.method,
+                   ( int32_t ) methodLen, pMethod,
                    ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST,
-                   ( int32_t ) requestInfo.pathLen, requestInfo.pPath ) );
+                   ( int32_t ) pathLen, pPath ) );
         LogDebug( ( "Request Headers:\n%.*s\n"
                     "Request Body:\n%.*s\n",
                     ( int32_t ) requestHeaders.headersLen,
@@ -312,7 +422,7 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
     }
     else
     {
-        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+        LogError( ( "Failed to build HTTP request headers: Error=%s.",
                     HTTPClient_strerror( httpStatus ) ) );
     }
 
@@ -323,7 +433,7 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
                    "Response Status:\n%u\n"
                    "Response Body:\n%.*s\n",
                    ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST,
-                   ( int32_t ) requestInfo.pathLen, requestInfo.pPath,
+                   ( int32_t ) pathLen, pPath,
                    ( int32_t ) response.headersLen, response.pHeaders,
                    response.statusCode,
                    ( int32_t ) response.bodyLen, response.pBody ) );
@@ -331,9 +441,9 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
     else
     {
         LogError( ( "Failed to send HTTP %.*s request to %.*s%.*s: Error=%s.",
-                    ( int32_t ) requestInfo.methodLen, requestInfo.method,
+                    ( int32_t ) methodLen, pMethod,
                     ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST,
-                    ( int32_t ) requestInfo.pathLen, requestInfo.pPath,
+                    ( int32_t ) pathLen, pPath,
                     HTTPClient_strerror( httpStatus ) ) );
     }
 
@@ -347,6 +457,193 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
 
 /*-----------------------------------------------------------*/
 
+static int32_t logBodySink( void * pSinkContext,
+                            const uint8_t * pData,
+                            size_t length )
+{
+    const char * pMethod = ( const char * ) pSinkContext;
+
+    /* Unused when debug logging is disabled. */
+    ( void ) pMethod;
+
+    LogDebug( ( "Response body piece of HTTP %s:\n%.*s\n",
+                pMethod, ( int32_t ) length, ( const char * ) pData ) );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t sendPipelinedRequests( const TransportInterface_t * pTransportInterface,
+                                      const httpMethodStrings_t * pMethods,
+                                      const httpPathStrings_t * pPaths )
+{
+    /* Return value of this method. */
+    int32_t returnStatus = EXIT_SUCCESS;
+    /* The method and path of each request, patched into the template. */
+    HttpTemplateFields_t fields;
+    /* The header data of each request. */
+    HTTPRequestHeaders_t requestHeaders[ NUMBER_HTTP_PATHS ];
+    /* The requests and their responses. */
+    HttpPipelineRequest_t requests[ NUMBER_HTTP_PATHS ];
+    /* Status returned by the pipeline. */
+    HttpStreamStatus_t streamStatus = HttpStreamSuccess;
+    size_t i = 0U, completedCount = 0U;
+
+    ( void ) memset( requestHeaders, 0, sizeof( requestHeaders ) );
+    ( void ) memset( requests, 0, sizeof( requests ) );
+
+    for( i = 0U; ( i < NUMBER_HTTP_PATHS ) && ( returnStatus == EXIT_SUCCESS ); i++ )
+    {
+        ( void ) memset( &fields, 0, sizeof( fields ) );
+        fields.pMethod = pMethods[ i ].httpMethod;
+        fields.methodLength = pMethods[ i ].httpMethodLength;
+        fields.pPath = pPaths[ i ].httpPath;
+        fields.pathLength = pPaths[ i ].httpPathLength;
+
+        requestHeaders[ i ].pBuffer = pipelineBuffers[ i ];
+        requestHeaders[ i ].bufferLen = USER_BUFFER_LENGTH;
+
+        if( HttpTemplate_Build( &headerTemplate, &fields, &requestHeaders[ i ] ) != HttpTemplateSuccess )
+        {
+            LogError( ( "Failed to build HTTP request headers." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+
+        requests[ i ].pRequestHeaders = &requestHeaders[ i ];
+        requests[ i ].pRequestBody = ( const uint8_t * ) REQUEST_BODY;
+        requests[ i ].requestBodyLength = REQUEST_BODY_LENGTH;
+        requests[ i ].sink = logBodySink;
+        requests[ i ].pSinkContext = ( void * ) pMethods[ i ].httpMethod;
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        LogInfo( ( "Pipelining %u HTTP requests to %.*s...",
+                   ( unsigned int ) NUMBER_HTTP_PATHS,
+                   ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST ) );
+
+        streamStatus = HttpStream_SendPipelined( pTransportInterface,
+                                                 requests,
+                                                 NUMBER_HTTP_PATHS,
+                                                 userBuffer,
+                                                 USER_BUFFER_LENGTH,
+                                                 &completedCount );
+
+        for( i = 0U; i < completedCount; i++ )
+        {
+            LogInfo( ( "Received status %u and a body of %lu bytes for HTTP %.*s %.*s.",
+                       ( unsigned int ) requests[ i ].response.statusCode,
+                       ( unsigned long ) requests[ i ].response.bodyLength,
+                       ( int32_t ) pMethods[ i ].httpMethodLength, pMethods[ i ].httpMethod,
+                       ( int32_t ) pPaths[ i ].httpPathLength, pPaths[ i ].httpPath ) );
+        }
+
+        if( streamStatus != HttpStreamSuccess )
+        {
+            /* The requests from completedCount on may be sent again on a new
+             * connection. */
+            LogError( ( "Only %lu of %u pipelined requests were answered: status=%d.",
+                        ( unsigned long ) completedCount,
+                        ( unsigned int ) NUMBER_HTTP_PATHS,
+                        ( int ) streamStatus ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+#ifdef UPLOAD_FILE_PATH
+    static int32_t uploadFile( const TransportInterface_t * pTransportInterface )
+    {
+        /* Return value of this method. */
+        int32_t returnStatus = EXIT_SUCCESS;
+        /* The method and path of the upload, patched into the template. */
+        HttpTemplateFields_t fields = { 0 };
+        /* Represents header data that will be sent in an HTTP request. */
+        HTTPRequestHeaders_t requestHeaders;
+        /* The file, sent as the request body. */
+        HttpRequestBody_t body = { 0 };
+        /* The status and size of the streamed response. */
+        HttpStreamResponse_t response;
+        /* Status returned by the stream. */
+        HttpStreamStatus_t streamStatus = HttpStreamSuccess;
+        struct stat fileStatus;
+        int fileDescriptor = open( UPLOAD_FILE_PATH, O_RDONLY );
+
+        if( ( fileDescriptor < 0 ) || ( fstat( fileDescriptor, &fileStatus ) != 0 ) )
+        {
+            LogError( ( "Failed to open the file to upload: %s.", UPLOAD_FILE_PATH ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            fields.pMethod = HTTP_METHOD_PUT;
+            fields.methodLength = HTTP_METHOD_PUT_LENGTH;
+            fields.pPath = PUT_PATH;
+            fields.pathLength = PUT_PATH_LENGTH;
+
+            requestHeaders.pBuffer = userBuffer;
+            requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+
+            if( HttpTemplate_Build( &headerTemplate, &fields, &requestHeaders ) != HttpTemplateSuccess )
+            {
+                LogError( ( "Failed to build HTTP request headers." ) );
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            /* The kernel copies the file to the socket. */
+            body.fileDescriptor = fileDescriptor;
+            body.length = ( size_t ) fileStatus.st_size;
+            body.sendFile = Plaintext_SendFile;
+
+            LogInfo( ( "Uploading %lu bytes of %s to %.*s%.*s...",
+                       ( unsigned long ) body.length,
+                       UPLOAD_FILE_PATH,
+                       ( int32_t ) SERVER_HOST_LENGTH, SERVER_HOST,
+                       ( int32_t ) PUT_PATH_LENGTH, PUT_PATH ) );
+
+            streamStatus = HttpStream_Upload( pTransportInterface,
+                                              &requestHeaders,
+                                              &body,
+                                              userBuffer,
+                                              USER_BUFFER_LENGTH,
+                                              logBodySink,
+                                              ( void * ) HTTP_METHOD_PUT,
+                                              &response );
+
+            if( streamStatus == HttpStreamSuccess )
+            {
+                LogInfo( ( "Received status %u and a body of %lu bytes for the upload.",
+                           ( unsigned int ) response.statusCode,
+                           ( unsigned long ) response.bodyLength ) );
+            }
+            else
+            {
+                LogError( ( "Failed to upload %s: status=%d.",
+                            UPLOAD_FILE_PATH,
+                            ( int ) streamStatus ) );
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+
+        if( fileDescriptor >= 0 )
+        {
+            ( void ) close( fileDescriptor );
+        }
+
+        return returnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+#endif /* ifdef UPLOAD_FILE_PATH */
+
 /**
  * @brief Entry point of demo.
  *
@@ -355,6 +652,8 @@ static int32_t sendHttpRequest( const TransportInterface_t * pTransportInterface
  * an encrypted channel (i.e. without TLS). After which, HTTP Client library API
  * is used to send a GET, HEAD, PUT, and POST request in that order. For each
  * request, the HTTP response from the server (or an error code) is logged.
+ * The same requests are then pipelined on the connection, and the file at
+ * UPLOAD_FILE_PATH is uploaded if it is defined.
  *
  * @note This example is single-threaded and uses statically allocated memory.
  *
@@ -367,7 +666,7 @@ int main( int argc,
     /* The transport layer interface used by the HTTP Client library. */
     TransportInterface_t transportInterface;
     /* The network context for the transport layer interface. */
-    NetworkContext_t networkContext;
+    NetworkContext_t networkContext = { 0 };
     /* An array of HTTP paths to request. */
     const httpPathStrings_t httpMethodPaths[] =
     {
@@ -388,6 +687,9 @@ int main( int argc,
     ( void ) argc;
     ( void ) argv;
 
+    /* The headers shared by every request are formatted once. */
+    returnStatus = initializeHeaderTemplate();
+
     for( ; ; )
     {
         int i = 0;
@@ -442,6 +744,24 @@ int main( int argc,
             }
         }
 
+        /******************** Pipeline HTTP requests. ***********************/
+
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            returnStatus = sendPipelinedRequests( &transportInterface,
+                                                  httpMethods,
+                                                  httpMethodPaths );
+        }
+
+        #ifdef UPLOAD_FILE_PATH
+            /************************** Upload a file. **************************/
+
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                returnStatus = uploadFile( &transportInterface );
+            }
+        #endif
+
         if( returnStatus == EXIT_SUCCESS )
         {
             /* Log message indicating an iteration completed successfully. */
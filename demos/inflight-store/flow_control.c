@@ -0,0 +1,307 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file flow_control.c
+ * @brief Implementation of the adaptive window of in-flight PUBLISH messages.
+ *
+ * The round trip is smoothed as in RFC 6298, with gains of 1/8 for the
+ * average and 1/4 for the variation.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "flow_control.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Halve the window after an error, down to the minimum, and grow it
+ * by one message per window of acknowledgements from then on.
+ *
+ * @param[in] pFlowControl The window.
+ */
+static void reduceWindow( FlowControl_t * pFlowControl );
+
+/**
+ * @brief Restore the window saved when measuring the smallest round trip
+ * started.
+ *
+ * @param[in] pFlowControl The window.
+ */
+static void endProbe( FlowControl_t * pFlowControl );
+
+/**
+ * @brief Adapt the window to the smoothed round trip after an
+ * acknowledgement.
+ *
+ * @param[in] pFlowControl The window.
+ */
+static void adaptWindow( FlowControl_t * pFlowControl );
+
+/**
+ * @brief Update the smoothed round trip and its variation with a sample.
+ *
+ * @param[in] pFlowControl The window.
+ * @param[in] rttUs The round trip of an acknowledgement.
+ */
+static void updateRtt( FlowControl_t * pFlowControl,
+                       uint64_t rttUs );
+
+/*-----------------------------------------------------------*/
+
+static void endProbe( FlowControl_t * pFlowControl )
+{
+    if( pFlowControl->probeWindow != 0U )
+    {
+        pFlowControl->window = pFlowControl->probeWindow;
+        pFlowControl->probeWindow = 0U;
+        pFlowControl->probeSent = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void reduceWindow( FlowControl_t * pFlowControl )
+{
+    endProbe( pFlowControl );
+
+    pFlowControl->errorCount++;
+    pFlowControl->window /= 2U;
+
+    if( pFlowControl->window < pFlowControl->config.minWindow )
+    {
+        pFlowControl->window = pFlowControl->config.minWindow;
+    }
+
+    pFlowControl->growthThreshold = pFlowControl->window;
+    pFlowControl->ackCredit = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static void adaptWindow( FlowControl_t * pFlowControl )
+{
+    if( ( pFlowControl->smoothedRttUs > ( FLOW_CONTROL_QUEUING_FACTOR * pFlowControl->minRttUs ) ) &&
+        ( pFlowControl->smoothedRttUs > ( pFlowControl->minRttUs + FLOW_CONTROL_QUEUING_SLACK_US ) ) )
+    {
+        /* Messages are queuing, so a larger window would only add delay.
+         * Shrink by one message per window of acknowledgements. */
+        pFlowControl->ackCredit++;
+
+        if( pFlowControl->ackCredit >= pFlowControl->window )
+        {
+            pFlowControl->ackCredit = 0U;
+
+            if( pFlowControl->window > pFlowControl->config.minWindow )
+            {
+                pFlowControl->window--;
+            }
+
+            pFlowControl->growthThreshold = pFlowControl->window;
+        }
+    }
+    else if( pFlowControl->window < pFlowControl->growthThreshold )
+    {
+        pFlowControl->window++;
+    }
+    else
+    {
+        pFlowControl->ackCredit++;
+
+        if( pFlowControl->ackCredit >= pFlowControl->window )
+        {
+            pFlowControl->ackCredit = 0U;
+            pFlowControl->window++;
+        }
+    }
+
+    if( pFlowControl->window > pFlowControl->config.maxWindow )
+    {
+        pFlowControl->window = pFlowControl->config.maxWindow;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void updateRtt( FlowControl_t * pFlowControl,
+                       uint64_t rttUs )
+{
+    uint64_t deviationUs = 0U;
+
+    if( pFlowControl->ackCount == 0U )
+    {
+        pFlowControl->minRttUs = rttUs;
+        pFlowControl->smoothedRttUs = rttUs;
+        pFlowControl->rttVariationUs = rttUs / 2U;
+    }
+    else
+    {
+        if( rttUs < pFlowControl->minRttUs )
+        {
+            pFlowControl->minRttUs = rttUs;
+        }
+
+        deviationUs = ( rttUs > pFlowControl->smoothedRttUs ) ?
+                      ( rttUs - pFlowControl->smoothedRttUs ) :
+                      ( pFlowControl->smoothedRttUs - rttUs );
+
+        pFlowControl->rttVariationUs = ( ( 3U * pFlowControl->rttVariationUs ) + deviationUs ) / 4U;
+        pFlowControl->smoothedRttUs = ( ( 7U * pFlowControl->smoothedRttUs ) + rttUs ) / 8U;
+    }
+
+    pFlowControl->ackCount++;
+}
+
+/*-----------------------------------------------------------*/
+
+FlowControlStatus_t FlowControl_Init( FlowControl_t * pFlowControl,
+                                      const FlowControlConfig_t * pConfig )
+{
+    FlowControlStatus_t status = FlowControlSuccess;
+
+    if( ( pFlowControl == NULL ) || ( pConfig == NULL ) || ( pConfig->minWindow == 0U ) ||
+        ( pConfig->minWindow > pConfig->maxWindow ) )
+    {
+        status = FlowControlBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pFlowControl, 0x00, sizeof( FlowControl_t ) );
+        pFlowControl->config = *pConfig;
+        pFlowControl->window = pConfig->initialWindow;
+
+        if( pFlowControl->window < pConfig->minWindow )
+        {
+            pFlowControl->window = pConfig->minWindow;
+        }
+        else if( pFlowControl->window > pConfig->maxWindow )
+        {
+            pFlowControl->window = pConfig->maxWindow;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        /* Grow quickly until the first error. */
+        pFlowControl->growthThreshold = pConfig->maxWindow;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+bool FlowControl_IsOpen( const FlowControl_t * pFlowControl )
+{
+    return ( pFlowControl != NULL ) && ( pFlowControl->inFlight < pFlowControl->window );
+}
+
+/*-----------------------------------------------------------*/
+
+void FlowControl_OnSend( FlowControl_t * pFlowControl )
+{
+    if( pFlowControl != NULL )
+    {
+        if( ( pFlowControl->probeWindow != 0U ) && ( pFlowControl->inFlight == 0U ) )
+        {
+            pFlowControl->probeSent = true;
+        }
+
+        pFlowControl->inFlight++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void FlowControl_OnAck( FlowControl_t * pFlowControl,
+                        uint64_t rttUs )
+{
+    if( ( pFlowControl != NULL ) && ( pFlowControl->inFlight > 0U ) )
+    {
+        pFlowControl->inFlight--;
+
+        if( pFlowControl->probeSent == true )
+        {
+            /* The only message in flight measured the round trip of an
+             * empty window. */
+            pFlowControl->minRttUs = rttUs;
+            updateRtt( pFlowControl, rttUs );
+            endProbe( pFlowControl );
+        }
+        else
+        {
+            updateRtt( pFlowControl, rttUs );
+
+            if( pFlowControl->probeWindow == 0U )
+            {
+                adaptWindow( pFlowControl );
+            }
+        }
+
+        if( ( pFlowControl->probeWindow == 0U ) &&
+            ( ( pFlowControl->ackCount % FLOW_CONTROL_MIN_RTT_PERIOD ) == 0U ) )
+        {
+            /* Drain the window to measure the smallest round trip afresh. */
+            pFlowControl->probeWindow = pFlowControl->window;
+            pFlowControl->window = pFlowControl->config.minWindow;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void FlowControl_OnTimeout( FlowControl_t * pFlowControl )
+{
+    if( pFlowControl != NULL )
+    {
+        reduceWindow( pFlowControl );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void FlowControl_OnDrop( FlowControl_t * pFlowControl )
+{
+    if( ( pFlowControl != NULL ) && ( pFlowControl->inFlight > 0U ) )
+    {
+        pFlowControl->inFlight--;
+        reduceWindow( pFlowControl );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t FlowControl_GetAckTimeoutUs( const FlowControl_t * pFlowControl )
+{
+    uint64_t timeoutUs = FLOW_CONTROL_MIN_ACK_TIMEOUT_US;
+
+    if( ( pFlowControl != NULL ) &&
+        ( ( pFlowControl->smoothedRttUs + ( 4U * pFlowControl->rttVariationUs ) ) > timeoutUs ) )
+    {
+        timeoutUs = pFlowControl->smoothedRttUs + ( 4U * pFlowControl->rttVariationUs );
+    }
+
+    return timeoutUs;
+}
@@ -0,0 +1,189 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file flow_control.h
+ * @brief An adaptive window for outgoing QoS 1 and QoS 2 PUBLISH messages,
+ * sized from the measured acknowledgement round trip and error rate.
+ *
+ * The window works like a TCP congestion window. It grows by one message per
+ * acknowledgement until it first meets trouble, and after that by one
+ * message per window of acknowledgements. It stops growing, and then
+ * shrinks, while the smoothed round trip is well above the smallest one
+ * measured recently, as that means messages are queuing at the broker or on
+ * the link. It is halved when an acknowledgement times out or a message is
+ * dropped. A producer sends only while #FlowControl_IsOpen returns true, and
+ * otherwise keeps its messages queued, so that the connection neither idles
+ * on a fast link nor overflows the broker on a slow one.
+ */
+
+#ifndef FLOW_CONTROL_H_
+#define FLOW_CONTROL_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief How many times the smallest round trip the smoothed round trip may
+ * be before the window stops growing and starts to shrink.
+ */
+#ifndef FLOW_CONTROL_QUEUING_FACTOR
+    #define FLOW_CONTROL_QUEUING_FACTOR    ( 2U )
+#endif
+
+/**
+ * @brief Queuing delay in microseconds that is always tolerated, so that the
+ * jitter of a link with a round trip of a few hundred microseconds is not
+ * taken for queuing.
+ */
+#ifndef FLOW_CONTROL_QUEUING_SLACK_US
+    #define FLOW_CONTROL_QUEUING_SLACK_US    ( 5000U )
+#endif
+
+/**
+ * @brief Number of acknowledgements after which the smallest round trip is
+ * measured afresh, so that the window follows a link that became slower.
+ *
+ * The window is then drained to a single message, whose round trip is free of
+ * the queuing caused by the window itself, and restored once it is
+ * acknowledged.
+ */
+#ifndef FLOW_CONTROL_MIN_RTT_PERIOD
+    #define FLOW_CONTROL_MIN_RTT_PERIOD    ( 1024U )
+#endif
+
+/**
+ * @brief Lower bound of the acknowledgement timeout in microseconds, so that
+ * the scheduling jitter of a fast link is not taken for an error.
+ */
+#ifndef FLOW_CONTROL_MIN_ACK_TIMEOUT_US
+    #define FLOW_CONTROL_MIN_ACK_TIMEOUT_US    ( 200000U )
+#endif
+
+/**
+ * @brief Return codes from the flow control functions.
+ */
+typedef enum FlowControlStatus
+{
+    FlowControlSuccess,     /**< @brief The function completed successfully. */
+    FlowControlBadParameter /**< @brief A parameter was NULL, zero, or out of range. */
+} FlowControlStatus_t;
+
+/**
+ * @brief Bounds of the window.
+ */
+typedef struct FlowControlConfig
+{
+    uint32_t minWindow;     /**< @brief Smallest window, at least 1. */
+    uint32_t maxWindow;     /**< @brief Largest window, for instance the number of in-flight records of the MQTT context. */
+    uint32_t initialWindow; /**< @brief Window before the first acknowledgement. */
+} FlowControlConfig_t;
+
+/**
+ * @brief The state of a window, set up by #FlowControl_Init.
+ */
+typedef struct FlowControl
+{
+    FlowControlConfig_t config; /**< @brief Bounds of the window. */
+    uint32_t window;            /**< @brief Number of messages that may be in flight. */
+    uint32_t inFlight;          /**< @brief Number of messages in flight. */
+    uint32_t growthThreshold;   /**< @brief Window up to which it grows by one message per acknowledgement. */
+    uint32_t ackCredit;         /**< @brief Acknowledgements counted towards the next change of a large window. */
+    uint32_t probeWindow;       /**< @brief Window to restore after measuring the smallest round trip, or 0. */
+    bool probeSent;             /**< @brief Whether the message measuring the smallest round trip is in flight. */
+    uint64_t minRttUs;          /**< @brief Smallest round trip since it was last measured afresh. */
+    uint64_t smoothedRttUs;     /**< @brief Smoothed round trip. */
+    uint64_t rttVariationUs;    /**< @brief Smoothed variation of the round trip. */
+    uint64_t ackCount;          /**< @brief Number of acknowledgements. */
+    uint64_t errorCount;        /**< @brief Number of timeouts and dropped messages. */
+} FlowControl_t;
+
+/**
+ * @brief Set up a window.
+ *
+ * @param[out] pFlowControl The window.
+ * @param[in] pConfig The bounds of the window. The initial window is clamped
+ * to them.
+ *
+ * @return #FlowControlSuccess, or #FlowControlBadParameter if a parameter is
+ * NULL or the minimum is 0 or above the maximum.
+ */
+FlowControlStatus_t FlowControl_Init( FlowControl_t * pFlowControl,
+                                      const FlowControlConfig_t * pConfig );
+
+/**
+ * @brief Check whether another message may be sent.
+ *
+ * @param[in] pFlowControl The window.
+ *
+ * @return true if fewer messages than the window are in flight.
+ */
+bool FlowControl_IsOpen( const FlowControl_t * pFlowControl );
+
+/**
+ * @brief Count a message that was sent and waits for its acknowledgement.
+ *
+ * @param[in] pFlowControl The window.
+ */
+void FlowControl_OnSend( FlowControl_t * pFlowControl );
+
+/**
+ * @brief Count the acknowledgement of a message, and adapt the window to its
+ * round trip.
+ *
+ * @param[in] pFlowControl The window.
+ * @param[in] rttUs Time from sending the message to its PUBACK, or to its
+ * PUBCOMP at QoS 2.
+ */
+void FlowControl_OnAck( FlowControl_t * pFlowControl,
+                        uint64_t rttUs );
+
+/**
+ * @brief Halve the window because an acknowledgement has not arrived within
+ * #FlowControl_GetAckTimeoutUs. The message stays in flight.
+ *
+ * @param[in] pFlowControl The window.
+ */
+void FlowControl_OnTimeout( FlowControl_t * pFlowControl );
+
+/**
+ * @brief Count a message that left flight without an acknowledgement, for
+ * instance because it failed to send, and halve the window.
+ *
+ * @param[in] pFlowControl The window.
+ */
+void FlowControl_OnDrop( FlowControl_t * pFlowControl );
+
+/**
+ * @brief Get the time after which an acknowledgement is overdue: the smoothed
+ * round trip plus four times its variation, as for a TCP retransmission
+ * timeout, and at least #FLOW_CONTROL_MIN_ACK_TIMEOUT_US.
+ *
+ * @param[in] pFlowControl The window.
+ *
+ * @return The timeout in microseconds.
+ */
+uint64_t FlowControl_GetAckTimeoutUs( const FlowControl_t * pFlowControl );
+
+#endif /* ifndef FLOW_CONTROL_H_ */
@@ -0,0 +1,759 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file inflight_journal.c
+ * @brief Implementation of the memory-mapped journal of in-flight publishes.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "inflight_journal.h"
+
+/**
+ * @brief Identifies a journal file.
+ */
+#define JOURNAL_FILE_MAGIC         ( 0x4A464C49UL )
+
+/**
+ * @brief Version of the journal file layout.
+ */
+#define JOURNAL_FILE_VERSION       ( 1UL )
+
+/**
+ * @brief Identifies a record.
+ */
+#define JOURNAL_RECORD_MAGIC       ( 0x4352464CUL )
+
+/**
+ * @brief Size of the file header. The halves follow it.
+ */
+#define JOURNAL_HEADER_SIZE        ( 4096U )
+
+/**
+ * @brief Records are aligned to this many bytes.
+ */
+#define JOURNAL_RECORD_ALIGNMENT   ( 8U )
+
+/**
+ * @brief Record type of a PUBLISH.
+ */
+#define JOURNAL_RECORD_PUBLISH     ( 1U )
+
+/**
+ * @brief Record type of the release of a packet identifier.
+ */
+#define JOURNAL_RECORD_RELEASE     ( 2U )
+
+/**
+ * @brief The header at the start of the file.
+ */
+typedef struct JournalFileHeader
+{
+    uint32_t magic;    /**< @brief #JOURNAL_FILE_MAGIC. */
+    uint32_t version;  /**< @brief #JOURNAL_FILE_VERSION. */
+    uint64_t halfSize; /**< @brief Size of each half. */
+    uint64_t state;    /**< @brief The epoch shifted left by one, or'ed with the active half, written at once. */
+} JournalFileHeader_t;
+
+/**
+ * @brief The header of a record, followed by the topic name and the payload.
+ */
+typedef struct JournalRecord
+{
+    uint32_t magic;         /**< @brief #JOURNAL_RECORD_MAGIC. */
+    uint32_t epoch;         /**< @brief The epoch of the half when the record was written. */
+    uint32_t checksum;      /**< @brief FNV-1a of the record, with this field zero. */
+    uint32_t payloadLength; /**< @brief Length of the payload. */
+    uint16_t packetId;      /**< @brief Packet identifier. */
+    uint16_t topicLength;   /**< @brief Length of the topic name. */
+    uint8_t type;           /**< @brief #JOURNAL_RECORD_PUBLISH or #JOURNAL_RECORD_RELEASE. */
+    uint8_t qos;            /**< @brief QoS of the PUBLISH. */
+    uint8_t retain;         /**< @brief Retain flag of the PUBLISH. */
+    uint8_t reserved;       /**< @brief Zero. */
+} JournalRecord_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the start of a half of the journal.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] half The half.
+ *
+ * @return The start of the half.
+ */
+static uint8_t * halfStart( const InflightJournal_t * pJournal,
+                            uint32_t half );
+
+/**
+ * @brief Get the space a record takes in the journal.
+ *
+ * @param[in] topicLength Length of the topic name.
+ * @param[in] payloadLength Length of the payload.
+ *
+ * @return The size of the record, aligned.
+ */
+static size_t recordSize( size_t topicLength,
+                          size_t payloadLength );
+
+/**
+ * @brief Compute the checksum of a record.
+ *
+ * @param[in] pRecord The record, with its lengths set.
+ *
+ * @return The checksum.
+ */
+static uint32_t recordChecksum( const JournalRecord_t * pRecord );
+
+/**
+ * @brief Write a record into a half, if it fits.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] half The half to write to.
+ * @param[in] offset Offset of the record in the half.
+ * @param[in] epoch Epoch of the half.
+ * @param[in] type Record type.
+ * @param[in] packetId Packet identifier.
+ * @param[in] pPubInfo The PUBLISH, or NULL for a release.
+ *
+ * @return The size of the record, or 0 if it does not fit.
+ */
+static size_t writeRecord( InflightJournal_t * pJournal,
+                           uint32_t half,
+                           size_t offset,
+                           uint32_t epoch,
+                           uint8_t type,
+                           uint16_t packetId,
+                           const MQTTPublishInfo_t * pPubInfo );
+
+/**
+ * @brief Get the record at an offset of the active half, if it is complete
+ * and belongs to the current epoch.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] half The half.
+ * @param[in] offset Offset of the record.
+ * @param[in] epoch The epoch of the half.
+ *
+ * @return The record, or NULL.
+ */
+static const JournalRecord_t * readRecord( const InflightJournal_t * pJournal,
+                                           uint32_t half,
+                                           size_t offset,
+                                           uint32_t epoch );
+
+/**
+ * @brief Point the publish info of a store entry at the topic name and
+ * payload of its record.
+ *
+ * @param[in] pPubInfo The publish info.
+ * @param[in] pRecord The record.
+ */
+static void pointAtRecord( MQTTPublishInfo_t * pPubInfo,
+                           const JournalRecord_t * pRecord );
+
+/**
+ * @brief Force a range of the file to disk.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] pStart Start of the range.
+ * @param[in] length Length of the range.
+ *
+ * @return true if the range was synced.
+ */
+static bool syncRange( const InflightJournal_t * pJournal,
+                       const uint8_t * pStart,
+                       size_t length );
+
+/**
+ * @brief Apply the sync policy after a record was appended.
+ *
+ * @param[in] pJournal The journal.
+ *
+ * @return #InflightJournalSuccess, or #InflightJournalFileError.
+ */
+static InflightJournalStatus_t afterAppend( InflightJournal_t * pJournal );
+
+/**
+ * @brief Replay the active half into the store.
+ *
+ * @param[in] pJournal The journal.
+ *
+ * @return #InflightJournalSuccess, or #InflightJournalStoreError.
+ */
+static InflightJournalStatus_t replay( InflightJournal_t * pJournal );
+
+/*-----------------------------------------------------------*/
+
+static uint8_t * halfStart( const InflightJournal_t * pJournal,
+                            uint32_t half )
+{
+    return &pJournal->pMapping[ JOURNAL_HEADER_SIZE + ( ( size_t ) half * pJournal->halfSize ) ];
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t recordSize( size_t topicLength,
+                          size_t payloadLength )
+{
+    size_t size = sizeof( JournalRecord_t ) + topicLength + payloadLength;
+
+    return ( size + ( JOURNAL_RECORD_ALIGNMENT - 1U ) ) & ~( ( size_t ) JOURNAL_RECORD_ALIGNMENT - 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t recordChecksum( const JournalRecord_t * pRecord )
+{
+    JournalRecord_t header;
+    const uint8_t * pBytes = ( const uint8_t * ) &header;
+    uint32_t hash = 2166136261UL;
+    size_t i = 0U, dataLength = 0U;
+
+    header = *pRecord;
+    header.checksum = 0U;
+
+    for( i = 0U; i < sizeof( header ); i++ )
+    {
+        hash = ( hash ^ pBytes[ i ] ) * 16777619UL;
+    }
+
+    pBytes = ( const uint8_t * ) &pRecord[ 1 ];
+    dataLength = ( size_t ) pRecord->topicLength + pRecord->payloadLength;
+
+    for( i = 0U; i < dataLength; i++ )
+    {
+        hash = ( hash ^ pBytes[ i ] ) * 16777619UL;
+    }
+
+    return hash;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t writeRecord( InflightJournal_t * pJournal,
+                           uint32_t half,
+                           size_t offset,
+                           uint32_t epoch,
+                           uint8_t type,
+                           uint16_t packetId,
+                           const MQTTPublishInfo_t * pPubInfo )
+{
+    JournalRecord_t * pRecord = NULL;
+    uint8_t * pData = NULL;
+    size_t size = 0U, topicLength = 0U, payloadLength = 0U;
+
+    if( pPubInfo != NULL )
+    {
+        topicLength = pPubInfo->topicNameLength;
+        payloadLength = pPubInfo->payloadLength;
+    }
+
+    size = recordSize( topicLength, payloadLength );
+
+    if( ( payloadLength > UINT32_MAX ) || ( offset > pJournal->halfSize ) ||
+        ( size > ( pJournal->halfSize - offset ) ) )
+    {
+        size = 0U;
+    }
+    else
+    {
+        pRecord = ( JournalRecord_t * ) &halfStart( pJournal, half )[ offset ];
+        pData = ( uint8_t * ) &pRecord[ 1 ];
+
+        /* The data goes first; the checksum makes the record valid only once
+         * all of it is written. */
+        if( topicLength > 0U )
+        {
+            ( void ) memmove( pData, pPubInfo->pTopicName, topicLength );
+        }
+
+        if( payloadLength > 0U )
+        {
+            ( void ) memmove( &pData[ topicLength ], pPubInfo->pPayload, payloadLength );
+        }
+
+        pRecord->epoch = epoch;
+        pRecord->payloadLength = ( uint32_t ) payloadLength;
+        pRecord->packetId = packetId;
+        pRecord->topicLength = ( uint16_t ) topicLength;
+        pRecord->type = type;
+        pRecord->qos = ( pPubInfo != NULL ) ? ( uint8_t ) pPubInfo->qos : 0U;
+        pRecord->retain = ( ( pPubInfo != NULL ) && ( pPubInfo->retain == true ) ) ? 1U : 0U;
+        pRecord->reserved = 0U;
+        pRecord->magic = JOURNAL_RECORD_MAGIC;
+        pRecord->checksum = recordChecksum( pRecord );
+    }
+
+    return size;
+}
+
+/*-----------------------------------------------------------*/
+
+static const JournalRecord_t * readRecord( const InflightJournal_t * pJournal,
+                                           uint32_t half,
+                                           size_t offset,
+                                           uint32_t epoch )
+{
+    const JournalRecord_t * pRecord = NULL;
+
+    if( ( pJournal->halfSize - offset ) >= sizeof( JournalRecord_t ) )
+    {
+        pRecord = ( const JournalRecord_t * ) &halfStart( pJournal, half )[ offset ];
+
+        /* Records beyond the last one are left over from an earlier epoch, or
+         * were torn by a crash. */
+        if( ( pRecord->magic != JOURNAL_RECORD_MAGIC ) ||
+            ( pRecord->epoch != epoch ) ||
+            ( recordSize( pRecord->topicLength, pRecord->payloadLength ) > ( pJournal->halfSize - offset ) ) ||
+            ( recordChecksum( pRecord ) != pRecord->checksum ) )
+        {
+            pRecord = NULL;
+        }
+    }
+
+    return pRecord;
+}
+
+/*-----------------------------------------------------------*/
+
+static void pointAtRecord( MQTTPublishInfo_t * pPubInfo,
+                           const JournalRecord_t * pRecord )
+{
+    const char * pData = ( const char * ) &pRecord[ 1 ];
+
+    pPubInfo->pTopicName = pData;
+    pPubInfo->topicNameLength = pRecord->topicLength;
+    pPubInfo->pPayload = &pData[ pRecord->topicLength ];
+    pPubInfo->payloadLength = pRecord->payloadLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool syncRange( const InflightJournal_t * pJournal,
+                       const uint8_t * pStart,
+                       size_t length )
+{
+    size_t pageSize = ( size_t ) sysconf( _SC_PAGESIZE );
+    size_t start = ( size_t ) ( pStart - pJournal->pMapping );
+    size_t alignedStart = start - ( start % pageSize );
+
+    /* msync needs a page-aligned start; the mapping itself is aligned. */
+    return msync( &pJournal->pMapping[ alignedStart ], ( start - alignedStart ) + length, MS_SYNC ) == 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static InflightJournalStatus_t afterAppend( InflightJournal_t * pJournal )
+{
+    InflightJournalStatus_t status = InflightJournalSuccess;
+    bool sync = false;
+
+    pJournal->unsyncedRecords++;
+
+    if( pJournal->policy == InflightJournalSyncAlways )
+    {
+        sync = true;
+    }
+    else if( pJournal->policy == InflightJournalSyncPeriodic )
+    {
+        sync = ( pJournal->unsyncedRecords >= pJournal->syncInterval );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( sync == true )
+    {
+        if( syncRange( pJournal,
+                       &halfStart( pJournal, pJournal->activeHalf )[ pJournal->syncedOffset ],
+                       pJournal->appendOffset - pJournal->syncedOffset ) == true )
+        {
+            pJournal->syncedOffset = pJournal->appendOffset;
+            pJournal->unsyncedRecords = 0U;
+        }
+        else
+        {
+            status = InflightJournalFileError;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static InflightJournalStatus_t replay( InflightJournal_t * pJournal )
+{
+    InflightJournalStatus_t status = InflightJournalSuccess;
+    const JournalRecord_t * pRecord = NULL;
+    InflightPublish_t * pPublish = NULL;
+    size_t offset = 0U;
+
+    pRecord = readRecord( pJournal, pJournal->activeHalf, offset, pJournal->epoch );
+
+    while( ( status == InflightJournalSuccess ) && ( pRecord != NULL ) )
+    {
+        /* A later record of a packet identifier replaces an earlier one. */
+        ( void ) InflightStore_Release( pJournal->pStore, pRecord->packetId );
+
+        if( pRecord->type == JOURNAL_RECORD_PUBLISH )
+        {
+            if( InflightStore_Allocate( pJournal->pStore, pRecord->packetId, &pPublish ) == InflightStoreSuccess )
+            {
+                pPublish->pubInfo.qos = ( MQTTQoS_t ) pRecord->qos;
+                pPublish->pubInfo.retain = ( pRecord->retain != 0U );
+                pointAtRecord( &pPublish->pubInfo, pRecord );
+            }
+            else
+            {
+                status = InflightJournalStoreError;
+            }
+        }
+
+        offset += recordSize( pRecord->topicLength, pRecord->payloadLength );
+        pRecord = readRecord( pJournal, pJournal->activeHalf, offset, pJournal->epoch );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+InflightJournalStatus_t InflightJournal_Open( InflightJournal_t * pJournal,
+                                              InflightStore_t * pStore,
+                                              const char * pPath,
+                                              size_t halfSize,
+                                              InflightJournalSyncPolicy_t policy,
+                                              uint32_t syncInterval )
+{
+    InflightJournalStatus_t status = InflightJournalSuccess;
+    JournalFileHeader_t * pHeader = NULL;
+    struct stat fileStatus;
+    bool created = false;
+    void * pMapping = MAP_FAILED;
+
+    if( ( pJournal == NULL ) || ( pStore == NULL ) || ( pPath == NULL ) ||
+        ( halfSize < JOURNAL_HEADER_SIZE ) ||
+        ( ( policy == InflightJournalSyncPeriodic ) && ( syncInterval == 0U ) ) )
+    {
+        status = InflightJournalBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pJournal, 0x00, sizeof( InflightJournal_t ) );
+        pJournal->pStore = pStore;
+        pJournal->policy = policy;
+        pJournal->syncInterval = syncInterval;
+        pJournal->fileDescriptor = open( pPath, O_RDWR | O_CREAT, 0600 );
+
+        if( ( pJournal->fileDescriptor < 0 ) || ( fstat( pJournal->fileDescriptor, &fileStatus ) != 0 ) )
+        {
+            status = InflightJournalFileError;
+        }
+        else if( fileStatus.st_size == 0 )
+        {
+            /* A new journal: both halves start empty, of epoch 0. */
+            pJournal->halfSize = halfSize & ~( ( size_t ) JOURNAL_RECORD_ALIGNMENT - 1U );
+            pJournal->mappingSize = JOURNAL_HEADER_SIZE + ( 2U * pJournal->halfSize );
+            created = true;
+
+            if( ftruncate( pJournal->fileDescriptor, ( off_t ) pJournal->mappingSize ) != 0 )
+            {
+                status = InflightJournalFileError;
+            }
+        }
+        else
+        {
+            pJournal->mappingSize = ( size_t ) fileStatus.st_size;
+        }
+    }
+
+    if( status == InflightJournalSuccess )
+    {
+        pMapping = mmap( NULL, pJournal->mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         pJournal->fileDescriptor, 0 );
+
+        if( pMapping == MAP_FAILED )
+        {
+            status = InflightJournalFileError;
+        }
+        else
+        {
+            pJournal->pMapping = ( uint8_t * ) pMapping;
+        }
+    }
+
+    if( status == InflightJournalSuccess )
+    {
+        pHeader = ( JournalFileHeader_t * ) pJournal->pMapping;
+
+        if( created == true )
+        {
+            pHeader->version = JOURNAL_FILE_VERSION;
+            pHeader->halfSize = pJournal->halfSize;
+            pHeader->state = 0U;
+            pHeader->magic = JOURNAL_FILE_MAGIC;
+        }
+        else if( ( pJournal->mappingSize < JOURNAL_HEADER_SIZE ) ||
+                 ( pHeader->magic != JOURNAL_FILE_MAGIC ) ||
+                 ( pHeader->version != JOURNAL_FILE_VERSION ) ||
+                 ( ( JOURNAL_HEADER_SIZE + ( 2U * pHeader->halfSize ) ) != pJournal->mappingSize ) )
+        {
+            /* Not a journal; leave the file alone. */
+            status = InflightJournalFileError;
+        }
+        else
+        {
+            pJournal->halfSize = ( size_t ) pHeader->halfSize;
+        }
+    }
+
+    if( status == InflightJournalSuccess )
+    {
+        pJournal->activeHalf = ( uint32_t ) ( pHeader->state & 1U );
+        pJournal->epoch = ( uint32_t ) ( pHeader->state >> 1 );
+        status = replay( pJournal );
+
+        /* Records after a torn one may still be intact, and appending over
+         * the torn one could let replay reach them again. Starting on a fresh
+         * epoch in the other half leaves no such records behind. */
+        if( status == InflightJournalSuccess )
+        {
+            status = InflightJournal_Compact( pJournal );
+        }
+
+        if( status != InflightJournalSuccess )
+        {
+            InflightJournal_Close( pJournal );
+        }
+    }
+    else if( status != InflightJournalBadParameter )
+    {
+        if( pJournal->pMapping != NULL )
+        {
+            ( void ) munmap( pJournal->pMapping, pJournal->mappingSize );
+            pJournal->pMapping = NULL;
+        }
+
+        if( pJournal->fileDescriptor >= 0 )
+        {
+            ( void ) close( pJournal->fileDescriptor );
+            pJournal->fileDescriptor = -1;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+InflightJournalStatus_t InflightJournal_RecordPublish( InflightJournal_t * pJournal,
+                                                       InflightPublish_t * pPublish )
+{
+    InflightJournalStatus_t status = InflightJournalSuccess;
+    size_t size = 0U;
+
+    if( ( pJournal == NULL ) || ( pJournal->pMapping == NULL ) || ( pPublish == NULL ) )
+    {
+        status = InflightJournalBadParameter;
+    }
+    else
+    {
+        size = writeRecord( pJournal, pJournal->activeHalf, pJournal->appendOffset, pJournal->epoch,
+                            JOURNAL_RECORD_PUBLISH, pPublish->packetId, &pPublish->pubInfo );
+
+        if( size > 0U )
+        {
+            pointAtRecord( &pPublish->pubInfo,
+                           ( const JournalRecord_t * ) &halfStart( pJournal, pJournal->activeHalf )[ pJournal->appendOffset ] );
+            pJournal->appendOffset += size;
+            status = afterAppend( pJournal );
+        }
+        else
+        {
+            /* The entry is already in the store, so compacting writes it and
+             * points it into the journal. */
+            status = InflightJournal_Compact( pJournal );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+InflightJournalStatus_t InflightJournal_RecordRelease( InflightJournal_t * pJournal,
+                                                       uint16_t packetId )
+{
+    InflightJournalStatus_t status = InflightJournalSuccess;
+    size_t size = 0U;
+
+    if( ( pJournal == NULL ) || ( pJournal->pMapping == NULL ) )
+    {
+        status = InflightJournalBadParameter;
+    }
+    else
+    {
+        size = writeRecord( pJournal, pJournal->activeHalf, pJournal->appendOffset, pJournal->epoch,
+                            JOURNAL_RECORD_RELEASE, packetId, NULL );
+
+        if( size > 0U )
+        {
+            pJournal->appendOffset += size;
+            status = afterAppend( pJournal );
+        }
+        else
+        {
+            /* The entry is already gone from the store, so compacting drops
+             * it. */
+            status = InflightJournal_Compact( pJournal );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+InflightJournalStatus_t InflightJournal_Compact( InflightJournal_t * pJournal )
+{
+    InflightJournalStatus_t status = InflightJournalSuccess;
+    JournalFileHeader_t * pHeader = NULL;
+    InflightPublish_t * pPublish = NULL;
+    const JournalRecord_t * pRecord = NULL;
+    JournalRecord_t * pWritten = NULL;
+    uint32_t half = 0U, epoch = 0U;
+    size_t cursor = 0U, offset = 0U, size = 0U;
+
+    if( ( pJournal == NULL ) || ( pJournal->pMapping == NULL ) )
+    {
+        status = InflightJournalBadParameter;
+    }
+    else
+    {
+        half = 1U - pJournal->activeHalf;
+        epoch = pJournal->epoch + 1U;
+
+        /* Write the publishes in flight to the other half. Until the header
+         * switches to it, a crash replays the active half. */
+        for( pPublish = InflightStore_Next( pJournal->pStore, &cursor );
+             ( pPublish != NULL ) && ( status == InflightJournalSuccess );
+             pPublish = InflightStore_Next( pJournal->pStore, &cursor ) )
+        {
+            size = writeRecord( pJournal, half, offset, epoch,
+                                JOURNAL_RECORD_PUBLISH, pPublish->packetId, &pPublish->pubInfo );
+
+            if( size == 0U )
+            {
+                status = InflightJournalFull;
+            }
+
+            offset += size;
+        }
+
+        if( status != InflightJournalSuccess )
+        {
+            /* Invalidate the records written, so that a later compaction to
+             * this half, of the same epoch, cannot be followed by them. */
+            size = offset;
+
+            for( offset = 0U; offset < size; offset += recordSize( pWritten->topicLength, pWritten->payloadLength ) )
+            {
+                pWritten = ( JournalRecord_t * ) &halfStart( pJournal, half )[ offset ];
+                pWritten->magic = 0U;
+            }
+        }
+        else if( ( pJournal->policy != InflightJournalSyncNone ) &&
+                 ( syncRange( pJournal, halfStart( pJournal, half ), offset ) == false ) )
+        {
+            status = InflightJournalFileError;
+        }
+        else
+        {
+            /* Any record left at the end of the half is of an older epoch, so
+             * replay stops there. */
+            pHeader = ( JournalFileHeader_t * ) pJournal->pMapping;
+            pHeader->state = ( ( uint64_t ) epoch << 1 ) | half;
+
+            if( ( pJournal->policy != InflightJournalSyncNone ) &&
+                ( syncRange( pJournal, pJournal->pMapping, sizeof( JournalFileHeader_t ) ) == false ) )
+            {
+                status = InflightJournalFileError;
+            }
+
+            pJournal->activeHalf = half;
+            pJournal->epoch = epoch;
+            pJournal->appendOffset = offset;
+            pJournal->syncedOffset = offset;
+            pJournal->unsyncedRecords = 0U;
+
+            /* Point the store at the new copies. */
+            offset = 0U;
+            pRecord = readRecord( pJournal, half, offset, epoch );
+
+            while( pRecord != NULL )
+            {
+                pPublish = InflightStore_Find( pJournal->pStore, pRecord->packetId );
+
+                if( pPublish != NULL )
+                {
+                    pointAtRecord( &pPublish->pubInfo, pRecord );
+                }
+
+                offset += recordSize( pRecord->topicLength, pRecord->payloadLength );
+                pRecord = readRecord( pJournal, half, offset, epoch );
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void InflightJournal_Close( InflightJournal_t * pJournal )
+{
+    if( ( pJournal != NULL ) && ( pJournal->pMapping != NULL ) )
+    {
+        ( void ) msync( pJournal->pMapping, pJournal->mappingSize, MS_SYNC );
+        ( void ) munmap( pJournal->pMapping, pJournal->mappingSize );
+        ( void ) close( pJournal->fileDescriptor );
+        pJournal->pMapping = NULL;
+        pJournal->fileDescriptor = -1;
+    }
+}
+
+/*-----------------------------------------------------------*/
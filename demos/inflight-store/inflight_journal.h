@@ -0,0 +1,168 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file inflight_journal.h
+ * @brief An optional memory-mapped journal of the PUBLISH messages in an
+ * #InflightStore_t, so that they survive a restart of the process and can be
+ * resent when the broker resumes the session.
+ *
+ * Each PUBLISH, with its topic name and payload, is appended to the journal as
+ * a checksummed record, and each acknowledgement as a release record. The
+ * stored publish info then points at the copies in the journal. Opening the
+ * journal replays the records into the store, and stops at the first record
+ * that is torn or incomplete, then compacts the journal.
+ *
+ * The file holds two halves. Records are appended to the active half; when it
+ * is full, the publishes still in flight are written to the other half, which
+ * is then made active by a single write to the file header. A crash at any
+ * point leaves one complete half to replay.
+ *
+ * The journal requires POSIX mmap.
+ */
+
+#ifndef INFLIGHT_JOURNAL_H_
+#define INFLIGHT_JOURNAL_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "inflight_store.h"
+
+/**
+ * @brief When the journal forces its records to disk.
+ *
+ * Without a sync, appended records are in the page cache and survive a crash
+ * of the process, but not of the system.
+ */
+typedef enum InflightJournalSyncPolicy
+{
+    InflightJournalSyncNone,     /**< @brief Leave writeback to the operating system. */
+    InflightJournalSyncPeriodic, /**< @brief Sync after every syncInterval records. */
+    InflightJournalSyncAlways    /**< @brief Sync after every record. */
+} InflightJournalSyncPolicy_t;
+
+/**
+ * @brief Return codes from the journal functions.
+ */
+typedef enum InflightJournalStatus
+{
+    InflightJournalSuccess,      /**< @brief The function completed successfully. */
+    InflightJournalBadParameter, /**< @brief A parameter was NULL or out of range. */
+    InflightJournalFileError,    /**< @brief The file could not be opened, sized, mapped or synced. */
+    InflightJournalFull,         /**< @brief The publishes in flight do not fit in a half of the journal. */
+    InflightJournalStoreError    /**< @brief A replayed publish did not fit in the store. */
+} InflightJournalStatus_t;
+
+/**
+ * @brief An open journal.
+ */
+typedef struct InflightJournal
+{
+    uint8_t * pMapping;                 /**< @brief The mapped file. */
+    size_t mappingSize;                 /**< @brief Size of the file. */
+    size_t halfSize;                    /**< @brief Size of each half. */
+    size_t appendOffset;                /**< @brief Offset of the next record in the active half. */
+    size_t syncedOffset;                /**< @brief Offset up to which the active half was synced. */
+    uint32_t activeHalf;                /**< @brief The half records are appended to. */
+    uint32_t epoch;                     /**< @brief The generation of the active half's records. */
+    InflightJournalSyncPolicy_t policy; /**< @brief When to sync. */
+    uint32_t syncInterval;              /**< @brief Records between syncs for #InflightJournalSyncPeriodic. */
+    uint32_t unsyncedRecords;           /**< @brief Records appended since the last sync. */
+    InflightStore_t * pStore;           /**< @brief The store the journal mirrors. */
+    int fileDescriptor;                 /**< @brief The journal file. */
+} InflightJournal_t;
+
+/**
+ * @brief Open or create a journal, and replay its records into a store.
+ *
+ * @param[out] pJournal The journal.
+ * @param[in] pStore The store to replay into and mirror. It should be empty.
+ * @param[in] pPath The journal file.
+ * @param[in] halfSize Size of each half of the file, in bytes. An existing
+ * file keeps the size it was created with.
+ * @param[in] policy When to force records to disk.
+ * @param[in] syncInterval Records between syncs for #InflightJournalSyncPeriodic.
+ *
+ * @return #InflightJournalSuccess; #InflightJournalFileError if the file could
+ * not be opened or mapped; #InflightJournalStoreError if the journal holds
+ * more publishes than the store; #InflightJournalBadParameter otherwise.
+ */
+InflightJournalStatus_t InflightJournal_Open( InflightJournal_t * pJournal,
+                                              InflightStore_t * pStore,
+                                              const char * pPath,
+                                              size_t halfSize,
+                                              InflightJournalSyncPolicy_t policy,
+                                              uint32_t syncInterval );
+
+/**
+ * @brief Append a PUBLISH allocated in the store, and point its publish info
+ * at the copies of its topic name and payload in the journal.
+ *
+ * The caller's topic name and payload are no longer needed afterwards.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] pPublish The store entry, with its publish info filled in.
+ *
+ * @return #InflightJournalSuccess; #InflightJournalFull if it does not fit
+ * even after compacting; #InflightJournalFileError if a sync failed;
+ * #InflightJournalBadParameter if a parameter is NULL.
+ */
+InflightJournalStatus_t InflightJournal_RecordPublish( InflightJournal_t * pJournal,
+                                                       InflightPublish_t * pPublish );
+
+/**
+ * @brief Append the release of a packet identifier, once its PUBLISH is
+ * acknowledged. Call it after #InflightStore_Release.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return #InflightJournalSuccess; #InflightJournalFull if it does not fit
+ * even after compacting; #InflightJournalFileError if a sync failed;
+ * #InflightJournalBadParameter if @p pJournal is NULL.
+ */
+InflightJournalStatus_t InflightJournal_RecordRelease( InflightJournal_t * pJournal,
+                                                       uint16_t packetId );
+
+/**
+ * @brief Rewrite the journal with only the publishes in the store, for
+ * instance after it was cleared for a clean session.
+ *
+ * @param[in] pJournal The journal.
+ *
+ * @return #InflightJournalSuccess; #InflightJournalFull if the publishes do not
+ * fit in a half; #InflightJournalFileError if a sync failed;
+ * #InflightJournalBadParameter if @p pJournal is NULL.
+ */
+InflightJournalStatus_t InflightJournal_Compact( InflightJournal_t * pJournal );
+
+/**
+ * @brief Sync and close the journal. The store must not be used with the
+ * publishes it replayed afterwards, as they point into the journal.
+ *
+ * @param[in] pJournal The journal.
+ */
+void InflightJournal_Close( InflightJournal_t * pJournal );
+
+#endif /* ifndef INFLIGHT_JOURNAL_H_ */
@@ -0,0 +1,304 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file inflight_store.c
+ * @brief Implementation of the store of unacknowledged PUBLISH messages.
+ *
+ * The entries are found through an open-addressed table with linear probing,
+ * at least twice as large as the window. Packet identifiers are handed out in
+ * sequence, so the identifiers in flight fall into consecutive slots and a
+ * lookup usually takes a single probe. Removal shifts the following entries of
+ * a probe sequence back, so the table needs no tombstones. Free entries are
+ * kept on a stack.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "inflight_store.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the number of table slots for a window: the smallest power of
+ * two of at least twice its size.
+ *
+ * @param[in] windowSize The window size.
+ *
+ * @return The table size.
+ */
+static size_t tableSizeFor( size_t windowSize );
+
+/**
+ * @brief Find the table slot of a packet identifier, or the empty slot where
+ * it would go.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return The slot.
+ */
+static size_t findSlot( const InflightStore_t * pStore,
+                        uint16_t packetId );
+
+/*-----------------------------------------------------------*/
+
+static size_t tableSizeFor( size_t windowSize )
+{
+    size_t tableSize = 2U;
+
+    while( tableSize < ( 2U * windowSize ) )
+    {
+        tableSize *= 2U;
+    }
+
+    return tableSize;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t findSlot( const InflightStore_t * pStore,
+                        uint16_t packetId )
+{
+    size_t slot = ( size_t ) packetId & pStore->tableMask;
+    uint16_t entry = pStore->pTable[ slot ];
+
+    /* The table is never more than half full, so an empty slot exists. */
+    while( ( entry != 0U ) && ( pStore->pEntries[ entry - 1U ].packetId != packetId ) )
+    {
+        slot = ( slot + 1U ) & pStore->tableMask;
+        entry = pStore->pTable[ slot ];
+    }
+
+    return slot;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t InflightStore_GetArenaSize( size_t windowSize )
+{
+    /* The entries, then the table and the free stack, plus slack to align the
+     * start. */
+    return ( windowSize * sizeof( InflightPublish_t ) ) +
+           ( ( tableSizeFor( windowSize ) + windowSize ) * sizeof( uint16_t ) ) +
+           sizeof( void * );
+}
+
+/*-----------------------------------------------------------*/
+
+InflightStoreStatus_t InflightStore_Init( InflightStore_t * pStore,
+                                          void * pArena,
+                                          size_t arenaSize,
+                                          size_t windowSize )
+{
+    InflightStoreStatus_t status = InflightStoreSuccess;
+    uint8_t * pStart = ( uint8_t * ) pArena;
+    size_t padding = 0U, tableSize = 0U;
+
+    if( ( pStore == NULL ) || ( pArena == NULL ) || ( windowSize == 0U ) ||
+        ( windowSize > INFLIGHT_STORE_MAX_WINDOW ) ||
+        ( arenaSize < InflightStore_GetArenaSize( windowSize ) ) )
+    {
+        status = InflightStoreBadParameter;
+    }
+    else
+    {
+        padding = ( sizeof( void * ) - ( ( uintptr_t ) pStart % sizeof( void * ) ) ) % sizeof( void * );
+        tableSize = tableSizeFor( windowSize );
+
+        /* The entries come first, as they need the alignment. */
+        pStore->pEntries = ( InflightPublish_t * ) &pStart[ padding ];
+        pStore->pTable = ( uint16_t * ) &pStore->pEntries[ windowSize ];
+        pStore->pFreeEntries = &pStore->pTable[ tableSize ];
+        pStore->windowSize = windowSize;
+        pStore->tableMask = tableSize - 1U;
+
+        InflightStore_Clear( pStore );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+InflightStoreStatus_t InflightStore_Allocate( InflightStore_t * pStore,
+                                              uint16_t packetId,
+                                              InflightPublish_t ** ppEntry )
+{
+    InflightStoreStatus_t status = InflightStoreSuccess;
+    size_t slot = 0U;
+    uint16_t index = 0U;
+
+    if( ( pStore == NULL ) || ( ppEntry == NULL ) || ( packetId == 0U ) )
+    {
+        status = InflightStoreBadParameter;
+    }
+    else if( pStore->freeCount == 0U )
+    {
+        status = InflightStoreFull;
+    }
+    else
+    {
+        slot = findSlot( pStore, packetId );
+
+        if( pStore->pTable[ slot ] != 0U )
+        {
+            status = InflightStoreExists;
+        }
+        else
+        {
+            pStore->freeCount--;
+            index = pStore->pFreeEntries[ pStore->freeCount ];
+            pStore->pTable[ slot ] = ( uint16_t ) ( index + 1U );
+
+            ( void ) memset( &pStore->pEntries[ index ], 0x00, sizeof( InflightPublish_t ) );
+            pStore->pEntries[ index ].packetId = packetId;
+            *ppEntry = &pStore->pEntries[ index ];
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+InflightPublish_t * InflightStore_Find( const InflightStore_t * pStore,
+                                        uint16_t packetId )
+{
+    InflightPublish_t * pEntry = NULL;
+    uint16_t entry = 0U;
+
+    if( ( pStore != NULL ) && ( packetId != 0U ) )
+    {
+        entry = pStore->pTable[ findSlot( pStore, packetId ) ];
+
+        if( entry != 0U )
+        {
+            pEntry = &pStore->pEntries[ entry - 1U ];
+        }
+    }
+
+    return pEntry;
+}
+
+/*-----------------------------------------------------------*/
+
+InflightStoreStatus_t InflightStore_Release( InflightStore_t * pStore,
+                                             uint16_t packetId )
+{
+    InflightStoreStatus_t status = InflightStoreSuccess;
+    size_t slot = 0U, next = 0U, home = 0U;
+    uint16_t entry = 0U;
+
+    if( pStore == NULL )
+    {
+        status = InflightStoreBadParameter;
+    }
+    else if( packetId == 0U )
+    {
+        status = InflightStoreNotFound;
+    }
+    else
+    {
+        slot = findSlot( pStore, packetId );
+        entry = pStore->pTable[ slot ];
+
+        if( entry == 0U )
+        {
+            status = InflightStoreNotFound;
+        }
+        else
+        {
+            pStore->pEntries[ entry - 1U ].packetId = 0U;
+            pStore->pFreeEntries[ pStore->freeCount ] = ( uint16_t ) ( entry - 1U );
+            pStore->freeCount++;
+
+            /* Shift back each following entry of the probe sequence whose home
+             * slot is not between the hole and it. */
+            next = ( slot + 1U ) & pStore->tableMask;
+
+            while( pStore->pTable[ next ] != 0U )
+            {
+                home = ( size_t ) pStore->pEntries[ pStore->pTable[ next ] - 1U ].packetId & pStore->tableMask;
+
+                if( ( ( next - home ) & pStore->tableMask ) >= ( ( next - slot ) & pStore->tableMask ) )
+                {
+                    pStore->pTable[ slot ] = pStore->pTable[ next ];
+                    slot = next;
+                }
+
+                next = ( next + 1U ) & pStore->tableMask;
+            }
+
+            pStore->pTable[ slot ] = 0U;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void InflightStore_Clear( InflightStore_t * pStore )
+{
+    size_t i = 0U;
+
+    if( pStore != NULL )
+    {
+        ( void ) memset( pStore->pEntries, 0x00, pStore->windowSize * sizeof( InflightPublish_t ) );
+        ( void ) memset( pStore->pTable, 0x00, ( pStore->tableMask + 1U ) * sizeof( uint16_t ) );
+
+        /* Hand out the entries from the first, as the linear scans did. */
+        for( i = 0U; i < pStore->windowSize; i++ )
+        {
+            pStore->pFreeEntries[ i ] = ( uint16_t ) ( pStore->windowSize - 1U - i );
+        }
+
+        pStore->freeCount = pStore->windowSize;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+InflightPublish_t * InflightStore_Next( const InflightStore_t * pStore,
+                                        size_t * pCursor )
+{
+    InflightPublish_t * pEntry = NULL;
+
+    if( ( pStore != NULL ) && ( pCursor != NULL ) )
+    {
+        while( ( pEntry == NULL ) && ( *pCursor < pStore->windowSize ) )
+        {
+            if( pStore->pEntries[ *pCursor ].packetId != 0U )
+            {
+                pEntry = &pStore->pEntries[ *pCursor ];
+            }
+
+            ( *pCursor )++;
+        }
+    }
+
+    return pEntry;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,14 @@
+# Configuration for the store of in-flight PUBLISH messages.
+set( INFLIGHT_STORE_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
+set( INFLIGHT_STORE_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/inflight_store.c )
+
+# Sources of the optional journal of in-flight PUBLISH messages, which
+# requires POSIX mmap.
+set( INFLIGHT_JOURNAL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/inflight_journal.c )
+
+# Sources of the adaptive window of in-flight PUBLISH messages.
+set( FLOW_CONTROL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/flow_control.c )
@@ -0,0 +1,185 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file inflight_store.h
+ * @brief A store for the outgoing QoS 1 and QoS 2 PUBLISH messages that have
+ * not been acknowledged yet, indexed by packet identifier.
+ *
+ * Allocating an entry, finding it by packet identifier, and releasing it take
+ * constant time, so the window of unacknowledged messages can be made large
+ * for links with a long round trip. The window size is chosen at run time by
+ * the arena given to #InflightStore_Init.
+ */
+
+#ifndef INFLIGHT_STORE_H_
+#define INFLIGHT_STORE_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/**
+ * @brief The largest window an in-flight store can hold, which is half the
+ * packet identifiers.
+ */
+#define INFLIGHT_STORE_MAX_WINDOW    ( 32768U )
+
+/**
+ * @brief A size of arena for #InflightStore_Init that holds a window of a
+ * given size, usable to size a static array. It may exceed the size returned
+ * by #InflightStore_GetArenaSize.
+ *
+ * Besides an entry, each message of the window needs up to four table slots
+ * and a place on the free stack.
+ */
+#define INFLIGHT_STORE_ARENA_SIZE( windowSize )                  \
+    ( ( ( windowSize ) * sizeof( InflightPublish_t ) ) +         \
+      ( ( 5U * ( windowSize ) ) * sizeof( uint16_t ) ) + sizeof( void * ) )
+
+/**
+ * @brief Return codes from the in-flight store functions.
+ */
+typedef enum InflightStoreStatus
+{
+    InflightStoreSuccess,      /**< @brief The function completed successfully. */
+    InflightStoreBadParameter, /**< @brief A parameter was NULL, zero, or out of range. */
+    InflightStoreFull,         /**< @brief All entries of the window are in use. */
+    InflightStoreExists,       /**< @brief An entry already has the packet identifier. */
+    InflightStoreNotFound      /**< @brief No entry has the packet identifier. */
+} InflightStoreStatus_t;
+
+/**
+ * @brief An outgoing PUBLISH kept until it is acknowledged, so that it can be
+ * sent again after a reconnect.
+ */
+typedef struct InflightPublish
+{
+    uint16_t packetId;         /**< @brief Packet identifier, or 0 when the entry is free. */
+    MQTTPublishInfo_t pubInfo; /**< @brief The PUBLISH. */
+} InflightPublish_t;
+
+/**
+ * @brief An in-flight store, set up by #InflightStore_Init.
+ */
+typedef struct InflightStore
+{
+    InflightPublish_t * pEntries; /**< @brief The entries of the window. */
+    uint16_t * pTable;            /**< @brief Open-addressed table of entry index + 1 by packet identifier, 0 when empty. */
+    uint16_t * pFreeEntries;      /**< @brief Stack of the indexes of free entries. */
+    size_t windowSize;            /**< @brief Number of entries. */
+    size_t tableMask;             /**< @brief Table size minus one; the table size is a power of two. */
+    size_t freeCount;             /**< @brief Number of free entries. */
+} InflightStore_t;
+
+/**
+ * @brief Get the size of an arena for #InflightStore_Init that holds a window
+ * of a given size.
+ *
+ * @param[in] windowSize The number of PUBLISH messages in flight.
+ *
+ * @return The arena size in bytes.
+ */
+size_t InflightStore_GetArenaSize( size_t windowSize );
+
+/**
+ * @brief Set up an empty store in an arena.
+ *
+ * @param[out] pStore The store.
+ * @param[in] pArena Memory for the store. It must stay valid while the store is
+ * used.
+ * @param[in] arenaSize The size of @p pArena, from #InflightStore_GetArenaSize.
+ * @param[in] windowSize The number of PUBLISH messages in flight, from 1 to
+ * #INFLIGHT_STORE_MAX_WINDOW.
+ *
+ * @return #InflightStoreSuccess, or #InflightStoreBadParameter if a parameter
+ * is NULL or out of range, or the arena is too small.
+ */
+InflightStoreStatus_t InflightStore_Init( InflightStore_t * pStore,
+                                          void * pArena,
+                                          size_t arenaSize,
+                                          size_t windowSize );
+
+/**
+ * @brief Allocate the entry for a packet identifier.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId The packet identifier, which must not be 0.
+ * @param[out] ppEntry The entry, with @p packetId set and the publish info
+ * cleared.
+ *
+ * @return #InflightStoreSuccess; #InflightStoreFull if the window is full;
+ * #InflightStoreExists if @p packetId is already in flight;
+ * #InflightStoreBadParameter if a parameter is NULL or 0.
+ */
+InflightStoreStatus_t InflightStore_Allocate( InflightStore_t * pStore,
+                                              uint16_t packetId,
+                                              InflightPublish_t ** ppEntry );
+
+/**
+ * @brief Find the entry of a packet identifier.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return The entry, or NULL if @p packetId is not in flight.
+ */
+InflightPublish_t * InflightStore_Find( const InflightStore_t * pStore,
+                                        uint16_t packetId );
+
+/**
+ * @brief Release the entry of a packet identifier, once it is acknowledged.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return #InflightStoreSuccess; #InflightStoreNotFound if @p packetId is not
+ * in flight; #InflightStoreBadParameter if @p pStore is NULL.
+ */
+InflightStoreStatus_t InflightStore_Release( InflightStore_t * pStore,
+                                             uint16_t packetId );
+
+/**
+ * @brief Release every entry, for instance when the broker has no session.
+ *
+ * @param[in] pStore The store.
+ */
+void InflightStore_Clear( InflightStore_t * pStore );
+
+/**
+ * @brief Iterate over the entries in flight, for instance to send them again.
+ *
+ * Set @p pCursor to 0 to get the first entry. The entries may be released
+ * while iterating.
+ *
+ * @param[in] pStore The store.
+ * @param[in,out] pCursor The position of the iteration.
+ *
+ * @return The next entry in flight, or NULL when there is none.
+ */
+InflightPublish_t * InflightStore_Next( const InflightStore_t * pStore,
+                                        size_t * pCursor );
+
+#endif /* ifndef INFLIGHT_STORE_H_ */
@@ -0,0 +1,449 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file async_log.c
+ * @brief Implementation of the asynchronous logging backend in async_log.h.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "async_log.h"
+
+/**
+ * @brief Mask to convert a ring position into a slot index.
+ */
+#define RING_INDEX_MASK    ( ( size_t ) ASYNC_LOG_RING_SIZE - 1U )
+
+/**
+ * @brief Time that #AsyncLog_Flush sleeps between checks of the writer's
+ * progress.
+ */
+#define FLUSH_POLL_MS      ( 1U )
+
+/**
+ * @brief Number of nanoseconds in one millisecond.
+ */
+#define ONE_MS_TO_NS       ( 1000000L )
+
+/**
+ * @brief One line in the ring buffer.
+ *
+ * The sequence number tells producers and the writer who owns the slot: it is
+ * equal to the ring position when the slot is free for that position, and
+ * equal to the position plus one once a line has been published into it.
+ */
+typedef struct LogSlot
+{
+    size_t sequence;                   /**< @brief Ownership sequence number. */
+    size_t length;                     /**< @brief Length of the line in data. */
+    char data[ ASYNC_LOG_LINE_SIZE ];  /**< @brief The formatted line. */
+} LogSlot_t;
+
+/**
+ * @brief A line being formatted by one thread.
+ */
+typedef struct LineBuffer
+{
+    size_t length;                     /**< @brief Bytes formatted so far. */
+    char data[ ASYNC_LOG_LINE_SIZE ];  /**< @brief The partially formatted line. */
+} LineBuffer_t;
+
+/**
+ * @brief The ring buffer of published lines.
+ */
+static LogSlot_t ringSlots[ ASYNC_LOG_RING_SIZE ];
+
+/**
+ * @brief Next ring position to be claimed by a producer.
+ */
+static size_t enqueuePosition = 0U;
+
+/**
+ * @brief Ring position up to which lines have been written out. Only the
+ * writer thread updates this.
+ */
+static size_t dequeuePosition = 0U;
+
+/**
+ * @brief Number of lines dropped because the ring was full.
+ */
+static uint32_t droppedLines = 0U;
+
+/**
+ * @brief Set while producers should publish into the ring rather than
+ * writing synchronously.
+ */
+static int acceptingLines = 0;
+
+/**
+ * @brief Set to ask the writer thread to exit once the ring is empty.
+ */
+static int stopRequested = 0;
+
+/**
+ * @brief Set while the writer thread exists. Only changed by #AsyncLog_Init
+ * and #AsyncLog_Cleanup.
+ */
+static int writerStarted = 0;
+
+/**
+ * @brief File descriptor that log lines are written to.
+ */
+static int outputFd = STDOUT_FILENO;
+
+/**
+ * @brief The writer thread.
+ */
+static pthread_t writerThread;
+
+/**
+ * @brief The line being formatted by the calling thread.
+ */
+static __thread LineBuffer_t threadLine;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sleep for a number of milliseconds.
+ *
+ * @param[in] sleepMs Time to sleep.
+ */
+static void sleepMs( uint32_t sleepMs );
+
+/**
+ * @brief Write a buffer to the output file descriptor, retrying on partial
+ * writes and interrupts.
+ *
+ * @param[in] pBuffer Bytes to write.
+ * @param[in] length Number of bytes to write.
+ */
+static void writeAll( const char * pBuffer,
+                      size_t length );
+
+/**
+ * @brief Publish a complete line into the ring, or write it directly when
+ * the writer thread is not running.
+ *
+ * @param[in] pLine The line to publish.
+ * @param[in] length Length of the line.
+ */
+static void publishLine( const char * pLine,
+                         size_t length );
+
+/**
+ * @brief Entry point of the writer thread. Drains the ring in batches.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * writerLoop( void * pArgs );
+
+/*-----------------------------------------------------------*/
+
+static void sleepMs( uint32_t sleepMs )
+{
+    struct timespec sleepTime;
+
+    sleepTime.tv_sec = ( time_t ) ( sleepMs / 1000U );
+    sleepTime.tv_nsec = ( long ) ( sleepMs % 1000U ) * ONE_MS_TO_NS;
+
+    ( void ) nanosleep( &sleepTime, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeAll( const char * pBuffer,
+                      size_t length )
+{
+    size_t bytesWritten = 0U;
+    ssize_t result = 0;
+
+    while( bytesWritten < length )
+    {
+        result = write( outputFd, &pBuffer[ bytesWritten ], length - bytesWritten );
+
+        if( result > 0 )
+        {
+            bytesWritten += ( size_t ) result;
+        }
+        else if( ( result < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before anything was written; try again. */
+        }
+        else
+        {
+            /* There is nowhere to report a failure to log, so give up on
+             * the rest of this buffer. */
+            break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void publishLine( const char * pLine,
+                         size_t length )
+{
+    LogSlot_t * pSlot = NULL;
+    size_t position = 0U, sequence = 0U;
+    long difference = 0;
+    int claimed = 0;
+
+    if( __atomic_load_n( &acceptingLines, __ATOMIC_ACQUIRE ) == 0 )
+    {
+        writeAll( pLine, length );
+    }
+    else
+    {
+        position = __atomic_load_n( &enqueuePosition, __ATOMIC_RELAXED );
+
+        for( ; ; )
+        {
+            pSlot = &ringSlots[ position & RING_INDEX_MASK ];
+            sequence = __atomic_load_n( &pSlot->sequence, __ATOMIC_ACQUIRE );
+            difference = ( long ) ( sequence - position );
+
+            if( difference == 0 )
+            {
+                /* The slot is free for this position; try to claim it. On
+                 * failure, position is reloaded with the current value. */
+                if( __atomic_compare_exchange_n( &enqueuePosition, &position, position + 1U,
+                                                 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+                {
+                    claimed = 1;
+                    break;
+                }
+            }
+            else if( difference < 0 )
+            {
+                /* The writer has not freed this slot yet, so the ring is
+                 * full. */
+                break;
+            }
+            else
+            {
+                /* Another producer claimed this position first. */
+                position = __atomic_load_n( &enqueuePosition, __ATOMIC_RELAXED );
+            }
+        }
+
+        if( claimed == 1 )
+        {
+            ( void ) memcpy( pSlot->data, pLine, length );
+            pSlot->length = length;
+            __atomic_store_n( &pSlot->sequence, position + 1U, __ATOMIC_RELEASE );
+        }
+        else
+        {
+            ( void ) __atomic_add_fetch( &droppedLines, 1U, __ATOMIC_RELAXED );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * writerLoop( void * pArgs )
+{
+    static char batch[ ASYNC_LOG_BATCH_SIZE ];
+    LogSlot_t * pSlot = NULL;
+    size_t position = __atomic_load_n( &dequeuePosition, __ATOMIC_RELAXED );
+    size_t batchLength = 0U;
+
+    ( void ) pArgs;
+
+    for( ; ; )
+    {
+        batchLength = 0U;
+
+        /* Coalesce as many consecutive published lines as fit. */
+        while( ( batchLength + ASYNC_LOG_LINE_SIZE ) <= ASYNC_LOG_BATCH_SIZE )
+        {
+            pSlot = &ringSlots[ position & RING_INDEX_MASK ];
+
+            if( __atomic_load_n( &pSlot->sequence, __ATOMIC_ACQUIRE ) != ( position + 1U ) )
+            {
+                break;
+            }
+
+            ( void ) memcpy( &batch[ batchLength ], pSlot->data, pSlot->length );
+            batchLength += pSlot->length;
+
+            /* Hand the slot back to producers for its next lap. */
+            __atomic_store_n( &pSlot->sequence, position + ASYNC_LOG_RING_SIZE, __ATOMIC_RELEASE );
+            position++;
+        }
+
+        if( batchLength > 0U )
+        {
+            writeAll( batch, batchLength );
+            __atomic_store_n( &dequeuePosition, position, __ATOMIC_RELEASE );
+        }
+        else if( __atomic_load_n( &stopRequested, __ATOMIC_ACQUIRE ) != 0 )
+        {
+            break;
+        }
+        else
+        {
+            sleepMs( ASYNC_LOG_IDLE_SLEEP_MS );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+AsyncLogStatus_t AsyncLog_Init( int fd )
+{
+    AsyncLogStatus_t returnStatus = AsyncLogSuccess;
+    size_t i = 0U;
+
+    if( fd < 0 )
+    {
+        returnStatus = AsyncLogBadParameter;
+    }
+    else if( writerStarted != 0 )
+    {
+        returnStatus = AsyncLogAlreadyRunning;
+    }
+    else
+    {
+        for( i = 0U; i < ASYNC_LOG_RING_SIZE; i++ )
+        {
+            ringSlots[ i ].sequence = i;
+        }
+
+        enqueuePosition = 0U;
+        dequeuePosition = 0U;
+        droppedLines = 0U;
+        stopRequested = 0;
+        outputFd = fd;
+
+        if( pthread_create( &writerThread, NULL, writerLoop, NULL ) != 0 )
+        {
+            returnStatus = AsyncLogThreadError;
+        }
+        else
+        {
+            writerStarted = 1;
+            __atomic_store_n( &acceptingLines, 1, __ATOMIC_RELEASE );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void AsyncLog_Printf( const char * pFormat,
+                      ... )
+{
+    va_list args;
+    size_t remaining = ASYNC_LOG_LINE_SIZE - threadLine.length;
+    size_t formatLength = strlen( pFormat );
+    int written = 0, lineComplete = 0;
+
+    va_start( args, pFormat );
+    written = vsnprintf( &threadLine.data[ threadLine.length ], remaining, pFormat, args );
+    va_end( args );
+
+    if( written < 0 )
+    {
+        /* Nothing was formatted. */
+    }
+    else if( ( size_t ) written < remaining )
+    {
+        threadLine.length += ( size_t ) written;
+        lineComplete = ( ( threadLine.length > 0U ) &&
+                         ( threadLine.data[ threadLine.length - 1U ] == '\n' ) ) ? 1 : 0;
+    }
+    else
+    {
+        /* The line was truncated. Keep it open until the format that ends
+         * it, so the rest of the message does not start a new line. */
+        threadLine.length = ASYNC_LOG_LINE_SIZE - 1U;
+        lineComplete = ( ( formatLength > 0U ) && ( pFormat[ formatLength - 1U ] == '\n' ) ) ? 1 : 0;
+
+        if( lineComplete == 1 )
+        {
+            threadLine.data[ threadLine.length - 2U ] = '\r';
+            threadLine.data[ threadLine.length - 1U ] = '\n';
+        }
+    }
+
+    if( lineComplete == 1 )
+    {
+        publishLine( threadLine.data, threadLine.length );
+        threadLine.length = 0U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void AsyncLog_Flush( void )
+{
+    size_t target = __atomic_load_n( &enqueuePosition, __ATOMIC_ACQUIRE );
+
+    if( writerStarted != 0 )
+    {
+        while( ( long ) ( target - __atomic_load_n( &dequeuePosition, __ATOMIC_ACQUIRE ) ) > 0 )
+        {
+            sleepMs( FLUSH_POLL_MS );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void AsyncLog_Cleanup( void )
+{
+    if( writerStarted != 0 )
+    {
+        /* New lines go straight to the file descriptor from here on. */
+        __atomic_store_n( &acceptingLines, 0, __ATOMIC_RELEASE );
+        AsyncLog_Flush();
+
+        __atomic_store_n( &stopRequested, 1, __ATOMIC_RELEASE );
+        ( void ) pthread_join( writerThread, NULL );
+        writerStarted = 0;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t AsyncLog_GetDropCount( void )
+{
+    return __atomic_load_n( &droppedLines, __ATOMIC_RELAXED );
+}
+
+/*-----------------------------------------------------------*/
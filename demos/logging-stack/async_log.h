@@ -0,0 +1,132 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file async_log.h
+ * @brief Optional asynchronous backend for the logging stack.
+ *
+ * When @ref LOGGING_ASYNC is defined, #SdkLog in logging_stack.h is routed to
+ * #AsyncLog_Printf. Each call appends to a per-thread line buffer, and a line
+ * is published to a lock-free multi-producer ring buffer once its terminating
+ * newline has been formatted. A single background thread drains the ring and
+ * writes contiguous lines to the output file descriptor with one `write()`
+ * call per batch, so logging threads never block on stdio or terminal I/O.
+ *
+ * Lines are dropped, and counted, when the ring is full. Before
+ * #AsyncLog_Init and after #AsyncLog_Cleanup, lines are written directly to
+ * the file descriptor from the calling thread.
+ */
+
+#ifndef ASYNC_LOG_H_
+#define ASYNC_LOG_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum length, in bytes, of a single log line including the
+ * metadata prefix and the terminating "\r\n". Longer lines are truncated.
+ */
+#ifndef ASYNC_LOG_LINE_SIZE
+    #define ASYNC_LOG_LINE_SIZE    ( 256U )
+#endif
+
+/**
+ * @brief Number of lines the ring buffer can hold. Must be a power of 2.
+ */
+#ifndef ASYNC_LOG_RING_SIZE
+    #define ASYNC_LOG_RING_SIZE    ( 256U )
+#endif
+
+/**
+ * @brief Size, in bytes, of the buffer the background thread coalesces lines
+ * into before each `write()`. Must be at least #ASYNC_LOG_LINE_SIZE.
+ */
+#ifndef ASYNC_LOG_BATCH_SIZE
+    #define ASYNC_LOG_BATCH_SIZE    ( 4096U )
+#endif
+
+/**
+ * @brief Time, in milliseconds, the background thread sleeps when the ring
+ * buffer is empty.
+ */
+#ifndef ASYNC_LOG_IDLE_SLEEP_MS
+    #define ASYNC_LOG_IDLE_SLEEP_MS    ( 5U )
+#endif
+
+/**
+ * @brief Return codes from asynchronous logging functions.
+ */
+typedef enum AsyncLogStatus
+{
+    AsyncLogSuccess = 0,     /**< Function successfully completed. */
+    AsyncLogBadParameter,    /**< The file descriptor was invalid. */
+    AsyncLogAlreadyRunning,  /**< The background thread is already running. */
+    AsyncLogThreadError      /**< The background thread could not be created. */
+} AsyncLogStatus_t;
+
+/**
+ * @brief Start the background writer thread.
+ *
+ * @param[in] fd File descriptor that log lines are written to, usually
+ * `STDOUT_FILENO`.
+ *
+ * @return #AsyncLogSuccess if the thread was started;
+ * #AsyncLogBadParameter if @p fd is negative;
+ * #AsyncLogAlreadyRunning if the backend was already initialized;
+ * #AsyncLogThreadError if the thread could not be created.
+ */
+AsyncLogStatus_t AsyncLog_Init( int fd );
+
+/**
+ * @brief Format into the calling thread's line buffer.
+ *
+ * The buffered line is published when the formatted text ends with a
+ * newline, or when the line buffer fills up. This has the same calling
+ * convention as `printf` so that it can back #SdkLog directly.
+ *
+ * @param[in] pFormat printf-style format string.
+ */
+void AsyncLog_Printf( const char * pFormat,
+                      ... );
+
+/**
+ * @brief Block until every line published before this call has been written.
+ */
+void AsyncLog_Flush( void );
+
+/**
+ * @brief Write any pending lines and stop the background writer thread.
+ *
+ * Logging after this call falls back to synchronous writes.
+ */
+void AsyncLog_Cleanup( void );
+
+/**
+ * @brief Get the number of lines dropped because the ring buffer was full.
+ *
+ * @return The number of dropped lines since #AsyncLog_Init.
+ */
+uint32_t AsyncLog_GetDropCount( void );
+
+#endif /* ifndef ASYNC_LOG_H_ */
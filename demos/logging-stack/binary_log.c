@@ -0,0 +1,548 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file binary_log.c
+ * @brief Implementation of the binary logging backend in binary_log.h.
+ */
+
+/* Standard includes. */
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+#include "binary_log.h"
+#include "clock.h"
+
+/**
+ * @brief Size of an encoded 4-byte argument.
+ */
+#define NARROW_ARG_SIZE    ( 4U )
+
+/**
+ * @brief Size of an encoded 8-byte argument.
+ */
+#define WIDE_ARG_SIZE      ( 8U )
+
+/**
+ * @brief Size of the length prefix of an encoded string argument.
+ */
+#define STRING_LENGTH_SIZE ( 2U )
+
+/**
+ * @brief Integer length modifiers of a conversion specification.
+ */
+typedef enum LengthModifier
+{
+    LengthNone = 0, /**< No modifier, or `h`/`hh`, which promote to int. */
+    LengthLong,     /**< `l`. */
+    LengthLongLong, /**< `ll`. */
+    LengthSize,     /**< `z`. */
+    LengthMax,      /**< `j`. */
+    LengthPtrDiff,  /**< `t`. */
+    LengthLongDouble /**< `L`. */
+} LengthModifier_t;
+
+/**
+ * @brief The call site of the line being recorded by one thread.
+ */
+typedef struct LogSite
+{
+    uint8_t level;              /**< @brief Log level. */
+    const char * pLibraryName;  /**< @brief LIBRARY_LOG_NAME of the call site. */
+    const char * pFileName;     /**< @brief __FILE__ of the call site. */
+    uint32_t lineNumber;        /**< @brief __LINE__ of the call site. */
+} LogSite_t;
+
+const char BinLog_Anchor[] = "binlog";
+
+/**
+ * @brief Records waiting to be drained.
+ */
+static uint8_t ringBuffer[ BINLOG_BUFFER_SIZE ];
+
+/**
+ * @brief Total number of bytes ever written into the ring.
+ */
+static size_t ringHead = 0U;
+
+/**
+ * @brief Total number of bytes ever drained from the ring.
+ */
+static size_t ringTail = 0U;
+
+/**
+ * @brief Number of records dropped because the ring was full.
+ */
+static uint32_t droppedRecords = 0U;
+
+/**
+ * @brief Protects the ring and the drop counter.
+ */
+static pthread_mutex_t ringMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The call site passed to #BinLog_Begin by the calling thread.
+ */
+static __thread LogSite_t threadSite;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Store an integer in little-endian order.
+ *
+ * @param[out] pDest Where to store the value.
+ * @param[in] value The value to store.
+ * @param[in] size Number of low-order bytes of @p value to store.
+ */
+static void putLittleEndian( uint8_t * pDest,
+                             uint64_t value,
+                             size_t size );
+
+/**
+ * @brief Encode the offset of a string from #BinLog_Anchor.
+ *
+ * @param[in] pString The string.
+ *
+ * @return The offset, truncated to 32 bits.
+ */
+static uint32_t stringOffset( const char * pString );
+
+/**
+ * @brief Encode the arguments of a format string after the record header.
+ *
+ * Encoding stops at the first argument that does not fit, or at a
+ * conversion that is not understood.
+ *
+ * @param[out] pRecord The record being built, of #BINLOG_MAX_RECORD_SIZE bytes.
+ * @param[in] pFormat The format string.
+ * @param[in] args The arguments of the format string.
+ *
+ * @return The length of the record, including the header.
+ */
+static size_t encodeArguments( uint8_t * pRecord,
+                               const char * pFormat,
+                               va_list args );
+
+/**
+ * @brief Copy a record into the ring if it has room.
+ *
+ * @param[in] pRecord The record.
+ * @param[in] length Length of the record.
+ */
+static void appendRecord( const uint8_t * pRecord,
+                          size_t length );
+
+/*-----------------------------------------------------------*/
+
+static void putLittleEndian( uint8_t * pDest,
+                             uint64_t value,
+                             size_t size )
+{
+    size_t i = 0U;
+
+    for( i = 0U; i < size; i++ )
+    {
+        pDest[ i ] = ( uint8_t ) ( value >> ( 8U * i ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t stringOffset( const char * pString )
+{
+    return ( uint32_t ) ( ( uintptr_t ) pString - ( uintptr_t ) BinLog_Anchor );
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t encodeArguments( uint8_t * pRecord,
+                               const char * pFormat,
+                               va_list args )
+{
+    size_t length = BINLOG_HEADER_SIZE, argSize = 0U, stringLength = 0U;
+    const char * pCursor = pFormat;
+    const char * pString = NULL;
+    LengthModifier_t modifier = LengthNone;
+    uint64_t value = 0U;
+    double floatValue = 0.0;
+    int precision = -1, encoding = 1;
+
+    while( ( encoding == 1 ) && ( *pCursor != '\0' ) )
+    {
+        if( *pCursor != '%' )
+        {
+            pCursor++;
+            continue;
+        }
+
+        pCursor++;
+
+        if( *pCursor == '%' )
+        {
+            pCursor++;
+            continue;
+        }
+
+        precision = -1;
+        modifier = LengthNone;
+
+        while( ( *pCursor != '\0' ) && ( strchr( "-+ #0", *pCursor ) != NULL ) )
+        {
+            pCursor++;
+        }
+
+        /* A '*' width or precision is an int argument of its own. */
+        if( *pCursor == '*' )
+        {
+            if( ( length + NARROW_ARG_SIZE ) > BINLOG_MAX_RECORD_SIZE )
+            {
+                break;
+            }
+
+            putLittleEndian( &pRecord[ length ], ( uint64_t ) ( int64_t ) va_arg( args, int ), NARROW_ARG_SIZE );
+            length += NARROW_ARG_SIZE;
+            pCursor++;
+        }
+
+        while( ( *pCursor >= '0' ) && ( *pCursor <= '9' ) )
+        {
+            pCursor++;
+        }
+
+        if( *pCursor == '.' )
+        {
+            pCursor++;
+            precision = 0;
+
+            if( *pCursor == '*' )
+            {
+                if( ( length + NARROW_ARG_SIZE ) > BINLOG_MAX_RECORD_SIZE )
+                {
+                    break;
+                }
+
+                precision = va_arg( args, int );
+                putLittleEndian( &pRecord[ length ], ( uint64_t ) ( int64_t ) precision, NARROW_ARG_SIZE );
+                length += NARROW_ARG_SIZE;
+                pCursor++;
+            }
+
+            while( ( *pCursor >= '0' ) && ( *pCursor <= '9' ) )
+            {
+                precision = ( precision * 10 ) + ( *pCursor - '0' );
+                pCursor++;
+            }
+        }
+
+        switch( *pCursor )
+        {
+            case 'h':
+                pCursor += ( pCursor[ 1 ] == 'h' ) ? 2 : 1;
+                break;
+
+            case 'l':
+                modifier = ( pCursor[ 1 ] == 'l' ) ? LengthLongLong : LengthLong;
+                pCursor += ( pCursor[ 1 ] == 'l' ) ? 2 : 1;
+                break;
+
+            case 'z':
+                modifier = LengthSize;
+                pCursor++;
+                break;
+
+            case 'j':
+                modifier = LengthMax;
+                pCursor++;
+                break;
+
+            case 't':
+                modifier = LengthPtrDiff;
+                pCursor++;
+                break;
+
+            case 'L':
+                modifier = LengthLongDouble;
+                pCursor++;
+                break;
+
+            default:
+                /* No length modifier. */
+                break;
+        }
+
+        switch( *pCursor )
+        {
+            case 'd':
+            case 'i':
+            case 'c':
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+
+                /* Signed values are sign extended and unsigned values zero
+                 * extended, so the decoder only needs the conversion. */
+                if( ( *pCursor == 'd' ) || ( *pCursor == 'i' ) )
+                {
+                    value = ( modifier == LengthLong ) ? ( uint64_t ) ( int64_t ) va_arg( args, long ) :
+                            ( modifier == LengthLongLong ) ? ( uint64_t ) va_arg( args, long long ) :
+                            ( modifier == LengthSize ) ? ( uint64_t ) va_arg( args, size_t ) :
+                            ( modifier == LengthMax ) ? ( uint64_t ) va_arg( args, intmax_t ) :
+                            ( modifier == LengthPtrDiff ) ? ( uint64_t ) ( int64_t ) va_arg( args, ptrdiff_t ) :
+                            ( uint64_t ) ( int64_t ) va_arg( args, int );
+                }
+                else
+                {
+                    value = ( modifier == LengthLong ) ? ( uint64_t ) va_arg( args, unsigned long ) :
+                            ( modifier == LengthLongLong ) ? ( uint64_t ) va_arg( args, unsigned long long ) :
+                            ( modifier == LengthSize ) ? ( uint64_t ) va_arg( args, size_t ) :
+                            ( modifier == LengthMax ) ? ( uint64_t ) va_arg( args, uintmax_t ) :
+                            ( modifier == LengthPtrDiff ) ? ( uint64_t ) va_arg( args, ptrdiff_t ) :
+                            ( uint64_t ) va_arg( args, unsigned int );
+                }
+
+                argSize = ( ( modifier == LengthNone ) || ( modifier == LengthLongDouble ) ) ?
+                          NARROW_ARG_SIZE : WIDE_ARG_SIZE;
+
+                if( ( length + argSize ) > BINLOG_MAX_RECORD_SIZE )
+                {
+                    encoding = 0;
+                }
+                else
+                {
+                    putLittleEndian( &pRecord[ length ], value, argSize );
+                    length += argSize;
+                }
+
+                break;
+
+            case 'p':
+
+                value = ( uint64_t ) ( uintptr_t ) va_arg( args, void * );
+
+                if( ( length + WIDE_ARG_SIZE ) > BINLOG_MAX_RECORD_SIZE )
+                {
+                    encoding = 0;
+                }
+                else
+                {
+                    putLittleEndian( &pRecord[ length ], value, WIDE_ARG_SIZE );
+                    length += WIDE_ARG_SIZE;
+                }
+
+                break;
+
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+
+                floatValue = ( modifier == LengthLongDouble ) ? ( double ) va_arg( args, long double ) :
+                             va_arg( args, double );
+                ( void ) memcpy( &value, &floatValue, sizeof( value ) );
+
+                if( ( length + WIDE_ARG_SIZE ) > BINLOG_MAX_RECORD_SIZE )
+                {
+                    encoding = 0;
+                }
+                else
+                {
+                    putLittleEndian( &pRecord[ length ], value, WIDE_ARG_SIZE );
+                    length += WIDE_ARG_SIZE;
+                }
+
+                break;
+
+            case 's':
+
+                pString = va_arg( args, const char * );
+                pString = ( pString == NULL ) ? "(null)" : pString;
+
+                /* Honor the precision without reading past it, as %.*s
+                 * arguments are often not NUL-terminated. */
+                stringLength = 0U;
+
+                while( ( ( precision < 0 ) || ( stringLength < ( size_t ) precision ) ) &&
+                       ( pString[ stringLength ] != '\0' ) )
+                {
+                    stringLength++;
+                }
+
+                if( ( length + STRING_LENGTH_SIZE ) >= BINLOG_MAX_RECORD_SIZE )
+                {
+                    encoding = 0;
+                }
+                else
+                {
+                    if( stringLength > ( BINLOG_MAX_RECORD_SIZE - length - STRING_LENGTH_SIZE ) )
+                    {
+                        stringLength = BINLOG_MAX_RECORD_SIZE - length - STRING_LENGTH_SIZE;
+                    }
+
+                    putLittleEndian( &pRecord[ length ], ( uint64_t ) stringLength, STRING_LENGTH_SIZE );
+                    ( void ) memcpy( &pRecord[ length + STRING_LENGTH_SIZE ], pString, stringLength );
+                    length += STRING_LENGTH_SIZE + stringLength;
+                }
+
+                break;
+
+            case 'n':
+                /* Nothing is written back when decoding offline. */
+                ( void ) va_arg( args, void * );
+                break;
+
+            default:
+                /* Unknown conversion; the remaining arguments cannot be
+                 * located. */
+                encoding = 0;
+                break;
+        }
+
+        if( *pCursor != '\0' )
+        {
+            pCursor++;
+        }
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+static void appendRecord( const uint8_t * pRecord,
+                          size_t length )
+{
+    size_t offset = 0U, firstPart = 0U;
+
+    ( void ) pthread_mutex_lock( &ringMutex );
+
+    if( ( BINLOG_BUFFER_SIZE - ( ringHead - ringTail ) ) < length )
+    {
+        droppedRecords++;
+    }
+    else
+    {
+        offset = ringHead % BINLOG_BUFFER_SIZE;
+        firstPart = BINLOG_BUFFER_SIZE - offset;
+        firstPart = ( firstPart < length ) ? firstPart : length;
+
+        ( void ) memcpy( &ringBuffer[ offset ], pRecord, firstPart );
+        ( void ) memcpy( ringBuffer, &pRecord[ firstPart ], length - firstPart );
+        ringHead += length;
+    }
+
+    ( void ) pthread_mutex_unlock( &ringMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+void BinLog_Begin( uint8_t level,
+                   const char * pLibraryName,
+                   const char * pFileName,
+                   uint32_t lineNumber )
+{
+    threadSite.level = level;
+    threadSite.pLibraryName = pLibraryName;
+    threadSite.pFileName = pFileName;
+    threadSite.lineNumber = lineNumber;
+}
+
+/*-----------------------------------------------------------*/
+
+void BinLog_Record( const char * pFormat,
+                    ... )
+{
+    uint8_t record[ BINLOG_MAX_RECORD_SIZE ];
+    size_t length = 0U;
+    va_list args;
+
+    va_start( args, pFormat );
+    length = encodeArguments( record, pFormat, args );
+    va_end( args );
+
+    putLittleEndian( &record[ 0 ], ( uint64_t ) length, 2U );
+    record[ 2 ] = threadSite.level;
+    record[ 3 ] = 0U;
+    putLittleEndian( &record[ 4 ], Clock_GetTimeMs(), 4U );
+    putLittleEndian( &record[ 8 ], threadSite.lineNumber, 4U );
+    putLittleEndian( &record[ 12 ], stringOffset( pFormat ), 4U );
+    putLittleEndian( &record[ 16 ], stringOffset( threadSite.pFileName ), 4U );
+    putLittleEndian( &record[ 20 ], stringOffset( threadSite.pLibraryName ), 4U );
+
+    appendRecord( record, length );
+}
+
+/*-----------------------------------------------------------*/
+
+size_t BinLog_Read( uint8_t * pBuffer,
+                    size_t bufferSize )
+{
+    size_t copied = 0U, recordLength = 0U, i = 0U;
+
+    ( void ) pthread_mutex_lock( &ringMutex );
+
+    while( ( ringHead - ringTail ) >= BINLOG_HEADER_SIZE )
+    {
+        recordLength = ( size_t ) ringBuffer[ ringTail % BINLOG_BUFFER_SIZE ] |
+                       ( ( size_t ) ringBuffer[ ( ringTail + 1U ) % BINLOG_BUFFER_SIZE ] << 8U );
+
+        if( ( copied + recordLength ) > bufferSize )
+        {
+            break;
+        }
+
+        for( i = 0U; i < recordLength; i++ )
+        {
+            pBuffer[ copied + i ] = ringBuffer[ ( ringTail + i ) % BINLOG_BUFFER_SIZE ];
+        }
+
+        copied += recordLength;
+        ringTail += recordLength;
+    }
+
+    ( void ) pthread_mutex_unlock( &ringMutex );
+
+    return copied;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t BinLog_GetDropCount( void )
+{
+    uint32_t dropCount = 0U;
+
+    ( void ) pthread_mutex_lock( &ringMutex );
+    dropCount = droppedRecords;
+    ( void ) pthread_mutex_unlock( &ringMutex );
+
+    return dropCount;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,137 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file binary_log.h
+ * @brief Optional deferred binary backend for the logging stack.
+ *
+ * When @ref LOGGING_BINARY is defined, log call sites do not format any text.
+ * Each line is recorded as a compact binary record holding the log level, a
+ * millisecond timestamp, the line number, the location of the format string,
+ * file name and library name within the binary, and the raw argument values.
+ * Records are kept in a RAM ring buffer until the application drains them
+ * with #BinLog_Read, for example into a file or flash.
+ *
+ * The `tools/binlog/binlog_decode.py` script rebuilds the text offline from
+ * the drained records and the unstripped executable that produced them.
+ *
+ * Record layout, all fields little-endian:
+ *
+ * | Offset | Size | Field                                               |
+ * |--------|------|-----------------------------------------------------|
+ * | 0      | 2    | Total record length, including this header          |
+ * | 2      | 1    | Log level (#LOG_ERROR to #LOG_DEBUG)                |
+ * | 3      | 1    | Reserved, zero                                      |
+ * | 4      | 4    | Timestamp in milliseconds, CLOCK_MONOTONIC          |
+ * | 8      | 4    | Line number                                         |
+ * | 12     | 4    | Format string offset from #BinLog_Anchor            |
+ * | 16     | 4    | File name offset from #BinLog_Anchor                |
+ * | 20     | 4    | Library name offset from #BinLog_Anchor             |
+ * | 24     | -    | Arguments, in the order of the format conversions   |
+ *
+ * Integer conversions without a length modifier, and `*` widths and
+ * precisions, are stored in 4 bytes. `l`, `ll`, `z`, `j` and `t` integer
+ * conversions, `%p`, and floating point conversions are stored in 8 bytes.
+ * Strings are stored as a 2-byte length followed by the characters, which
+ * honors any precision in the conversion.
+ */
+
+#ifndef BINARY_LOG_H_
+#define BINARY_LOG_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Size, in bytes, of the RAM ring buffer holding undrained records.
+ */
+#ifndef BINLOG_BUFFER_SIZE
+    #define BINLOG_BUFFER_SIZE        ( 8192U )
+#endif
+
+/**
+ * @brief Maximum size, in bytes, of a single record. Arguments that do not
+ * fit are truncated, strings first.
+ */
+#ifndef BINLOG_MAX_RECORD_SIZE
+    #define BINLOG_MAX_RECORD_SIZE    ( 128U )
+#endif
+
+/**
+ * @brief Size, in bytes, of the fixed record header.
+ */
+#define BINLOG_HEADER_SIZE            ( 24U )
+
+/**
+ * @brief Reference symbol that string locations are recorded relative to.
+ *
+ * Recording offsets rather than addresses keeps the records decodable when
+ * the executable is loaded at a randomized address.
+ */
+extern const char BinLog_Anchor[];
+
+/**
+ * @brief Record the metadata of the next line logged by the calling thread.
+ *
+ * @param[in] level The log level of the line.
+ * @param[in] pLibraryName The LIBRARY_LOG_NAME of the call site.
+ * @param[in] pFileName The __FILE__ of the call site.
+ * @param[in] lineNumber The __LINE__ of the call site.
+ */
+void BinLog_Begin( uint8_t level,
+                   const char * pLibraryName,
+                   const char * pFileName,
+                   uint32_t lineNumber );
+
+/**
+ * @brief Encode the arguments of the line started by #BinLog_Begin and
+ * append the record to the ring buffer.
+ *
+ * The record is dropped, and counted, if the ring buffer does not have room.
+ *
+ * @param[in] pFormat The printf-style format string of the call site. It must
+ * be a string literal, as only its location is recorded.
+ */
+void BinLog_Record( const char * pFormat,
+                    ... );
+
+/**
+ * @brief Copy whole records out of the ring buffer.
+ *
+ * @param[out] pBuffer Buffer to copy records into.
+ * @param[in] bufferSize Size of @p pBuffer.
+ *
+ * @return The number of bytes copied, always a whole number of records.
+ * This is zero if the ring buffer is empty or the next record does not fit.
+ */
+size_t BinLog_Read( uint8_t * pBuffer,
+                    size_t bufferSize );
+
+/**
+ * @brief Get the number of records dropped because the ring buffer was full.
+ *
+ * @return The number of dropped records.
+ */
+uint32_t BinLog_GetDropCount( void );
+
+#endif /* ifndef BINARY_LOG_H_ */
@@ -0,0 +1,225 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file log_level_table.c
+ * @brief Implementation of the runtime log level table in log_level_table.h.
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+#include "log_level_table.h"
+
+/**
+ * @brief One library's runtime level.
+ */
+typedef struct LogLevelEntry
+{
+    volatile uint8_t level;                  /**< @brief Current level. */
+    char name[ LOG_LEVEL_TABLE_NAME_SIZE ];  /**< @brief LIBRARY_LOG_NAME. */
+} LogLevelEntry_t;
+
+/**
+ * @brief The level table. Entries are never removed, so pointers to them can
+ * be cached by call sites.
+ */
+static LogLevelEntry_t levelTable[ LOG_LEVEL_TABLE_MAX_LIBRARIES ];
+
+/**
+ * @brief Number of entries in use in #levelTable.
+ */
+static size_t entryCount = 0U;
+
+/**
+ * @brief Serializes changes to the table.
+ */
+static pthread_mutex_t tableMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find a library's entry, optionally creating it. Must be called with
+ * #tableMutex held.
+ *
+ * @param[in] pLibraryName The library name.
+ * @param[in] create Non-zero to create the entry if it does not exist.
+ * @param[in] defaultLevel The level to create the entry with.
+ *
+ * @return The entry, or NULL if it does not exist and was not created.
+ */
+static LogLevelEntry_t * findEntry( const char * pLibraryName,
+                                    int create,
+                                    uint8_t defaultLevel );
+
+/*-----------------------------------------------------------*/
+
+static LogLevelEntry_t * findEntry( const char * pLibraryName,
+                                    int create,
+                                    uint8_t defaultLevel )
+{
+    LogLevelEntry_t * pEntry = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; i < entryCount; i++ )
+    {
+        if( strncmp( levelTable[ i ].name, pLibraryName, LOG_LEVEL_TABLE_NAME_SIZE - 1U ) == 0 )
+        {
+            pEntry = &levelTable[ i ];
+            break;
+        }
+    }
+
+    if( ( pEntry == NULL ) && ( create != 0 ) && ( entryCount < LOG_LEVEL_TABLE_MAX_LIBRARIES ) )
+    {
+        pEntry = &levelTable[ entryCount ];
+        ( void ) strncpy( pEntry->name, pLibraryName, LOG_LEVEL_TABLE_NAME_SIZE - 1U );
+        pEntry->level = defaultLevel;
+        entryCount++;
+    }
+
+    return pEntry;
+}
+
+/*-----------------------------------------------------------*/
+
+int LogLevelTable_Resolve( const volatile uint8_t ** ppLevelCache,
+                           const char * pLibraryName,
+                           uint8_t defaultLevel,
+                           uint8_t level )
+{
+    LogLevelEntry_t * pEntry = NULL;
+    int enabled = 0;
+
+    ( void ) pthread_mutex_lock( &tableMutex );
+    pEntry = findEntry( pLibraryName, 1, defaultLevel );
+
+    if( pEntry != NULL )
+    {
+        enabled = ( pEntry->level >= level ) ? 1 : 0;
+        *ppLevelCache = &pEntry->level;
+    }
+    else
+    {
+        enabled = ( defaultLevel >= level ) ? 1 : 0;
+    }
+
+    ( void ) pthread_mutex_unlock( &tableMutex );
+
+    return enabled;
+}
+
+/*-----------------------------------------------------------*/
+
+LogLevelTableStatus_t LogLevelTable_Set( const char * pLibraryName,
+                                         uint8_t level )
+{
+    LogLevelTableStatus_t returnStatus = LogLevelTableSuccess;
+    LogLevelEntry_t * pEntry = NULL;
+
+    if( ( pLibraryName == NULL ) || ( level > LOG_DEBUG ) )
+    {
+        returnStatus = LogLevelTableBadParameter;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &tableMutex );
+        pEntry = findEntry( pLibraryName, 1, level );
+
+        if( pEntry == NULL )
+        {
+            returnStatus = LogLevelTableFull;
+        }
+        else
+        {
+            pEntry->level = level;
+        }
+
+        ( void ) pthread_mutex_unlock( &tableMutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+LogLevelTableStatus_t LogLevelTable_SetAll( uint8_t level )
+{
+    LogLevelTableStatus_t returnStatus = LogLevelTableSuccess;
+    size_t i = 0U;
+
+    if( level > LOG_DEBUG )
+    {
+        returnStatus = LogLevelTableBadParameter;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &tableMutex );
+
+        for( i = 0U; i < entryCount; i++ )
+        {
+            levelTable[ i ].level = level;
+        }
+
+        ( void ) pthread_mutex_unlock( &tableMutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+LogLevelTableStatus_t LogLevelTable_Get( const char * pLibraryName,
+                                         uint8_t * pLevel )
+{
+    LogLevelTableStatus_t returnStatus = LogLevelTableSuccess;
+    LogLevelEntry_t * pEntry = NULL;
+
+    if( ( pLibraryName == NULL ) || ( pLevel == NULL ) )
+    {
+        returnStatus = LogLevelTableBadParameter;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &tableMutex );
+        pEntry = findEntry( pLibraryName, 0, LOG_NONE );
+
+        if( pEntry == NULL )
+        {
+            returnStatus = LogLevelTableNotFound;
+        }
+        else
+        {
+            *pLevel = pEntry->level;
+        }
+
+        ( void ) pthread_mutex_unlock( &tableMutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,162 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file log_level_table.h
+ * @brief Runtime per-library log levels for the logging stack.
+ *
+ * When @ref LOGGING_RUNTIME_LEVELS is defined, every log call up to
+ * #LOGGING_MAX_LEVEL is compiled in, and whether it prints is decided at
+ * runtime from a table keyed by LIBRARY_LOG_NAME. A library's entry starts at
+ * the LIBRARY_LOG_LEVEL it was compiled with, and can be changed with
+ * #LogLevelTable_Set without a rebuild.
+ *
+ * Each call site caches a pointer to its library's level after its first
+ * call, so the check is one load and one compare ahead of any argument
+ * evaluation. The level is read without locking; a change made by
+ * #LogLevelTable_Set is seen by other threads shortly after, not instantly.
+ */
+
+#ifndef LOG_LEVEL_TABLE_H_
+#define LOG_LEVEL_TABLE_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* Include header for logging level macros. */
+#include "logging_levels.h"
+
+/**
+ * @brief The most verbose level compiled in when runtime levels are enabled.
+ * Log calls above this level still compile out completely.
+ */
+#ifndef LOGGING_MAX_LEVEL
+    #define LOGGING_MAX_LEVEL               LOG_DEBUG
+#endif
+
+/**
+ * @brief Maximum number of libraries in the level table.
+ */
+#ifndef LOG_LEVEL_TABLE_MAX_LIBRARIES
+    #define LOG_LEVEL_TABLE_MAX_LIBRARIES   ( 32U )
+#endif
+
+/**
+ * @brief Size of the buffer holding each library name, including the NUL
+ * terminator. Longer names are truncated.
+ */
+#ifndef LOG_LEVEL_TABLE_NAME_SIZE
+    #define LOG_LEVEL_TABLE_NAME_SIZE       ( 32U )
+#endif
+
+/**
+ * @brief Tell the compiler which way a branch usually goes.
+ */
+#if defined( __GNUC__ )
+    #define LOG_LEVEL_TABLE_LIKELY( x )    __builtin_expect( !!( x ), 1 )
+#else
+    #define LOG_LEVEL_TABLE_LIKELY( x )    ( x )
+#endif
+
+/**
+ * @brief Evaluate to non-zero if a call site may log at a level.
+ *
+ * @param[in,out] pLevelCache A `const volatile uint8_t *` lvalue, private to
+ * the call site and initially NULL, that caches the library's table entry.
+ * @param[in] libraryName The LIBRARY_LOG_NAME of the call site.
+ * @param[in] defaultLevel The LIBRARY_LOG_LEVEL of the call site.
+ * @param[in] level The level of the log call.
+ */
+#define LOG_LEVEL_TABLE_ENABLED( pLevelCache, libraryName, defaultLevel, level ) \
+    ( LOG_LEVEL_TABLE_LIKELY( ( pLevelCache ) != NULL ) ?                        \
+      ( *( pLevelCache ) >= ( uint8_t ) ( level ) ) :                            \
+      LogLevelTable_Resolve( &( pLevelCache ), libraryName, defaultLevel, level ) )
+
+/**
+ * @brief Return codes from log level table functions.
+ */
+typedef enum LogLevelTableStatus
+{
+    LogLevelTableSuccess = 0,   /**< Function successfully completed. */
+    LogLevelTableBadParameter,  /**< A parameter was NULL or the level was invalid. */
+    LogLevelTableFull,          /**< The library is new and the table has no room for it. */
+    LogLevelTableNotFound       /**< The library has no entry in the table. */
+} LogLevelTableStatus_t;
+
+/**
+ * @brief Look up or create a library's entry and cache it for a call site.
+ *
+ * This is the slow path of #LOG_LEVEL_TABLE_ENABLED and only runs on the
+ * first call from each call site. If the table is full, the cache is left
+ * NULL and the compile-time level is used.
+ *
+ * @param[out] ppLevelCache The call site's cache.
+ * @param[in] pLibraryName The library name.
+ * @param[in] defaultLevel The level to create the entry with.
+ * @param[in] level The level of the log call.
+ *
+ * @return Non-zero if the call site should log.
+ */
+int LogLevelTable_Resolve( const volatile uint8_t ** ppLevelCache,
+                           const char * pLibraryName,
+                           uint8_t defaultLevel,
+                           uint8_t level );
+
+/**
+ * @brief Set the runtime level of one library.
+ *
+ * The entry is created if the library has not logged yet, so levels can be
+ * configured before the library starts.
+ *
+ * @param[in] pLibraryName The LIBRARY_LOG_NAME of the library.
+ * @param[in] level One of #LOG_NONE, #LOG_ERROR, #LOG_WARN, #LOG_INFO or
+ * #LOG_DEBUG. Levels above #LOGGING_MAX_LEVEL have no further effect.
+ *
+ * @return #LogLevelTableSuccess, #LogLevelTableBadParameter or
+ * #LogLevelTableFull.
+ */
+LogLevelTableStatus_t LogLevelTable_Set( const char * pLibraryName,
+                                         uint8_t level );
+
+/**
+ * @brief Set the runtime level of every library in the table.
+ *
+ * @param[in] level One of #LOG_NONE, #LOG_ERROR, #LOG_WARN, #LOG_INFO or
+ * #LOG_DEBUG.
+ *
+ * @return #LogLevelTableSuccess or #LogLevelTableBadParameter.
+ */
+LogLevelTableStatus_t LogLevelTable_SetAll( uint8_t level );
+
+/**
+ * @brief Get the runtime level of one library.
+ *
+ * @param[in] pLibraryName The LIBRARY_LOG_NAME of the library.
+ * @param[out] pLevel The library's current level.
+ *
+ * @return #LogLevelTableSuccess, #LogLevelTableBadParameter or
+ * #LogLevelTableNotFound.
+ */
+LogLevelTableStatus_t LogLevelTable_Get( const char * pLibraryName,
+                                         uint8_t * pLevel );
+
+#endif /* ifndef LOG_LEVEL_TABLE_H_ */
@@ -1,3 +1,25 @@
 # Configuration for logging.
 set( LOGGING_INCLUDE_DIRS
-     ${CMAKE_CURRENT_LIST_DIR} )
\ No newline at end of file
+     ${CMAKE_CURRENT_LIST_DIR} )
+# Sources for the optional asynchronous logging backend. Compile them into the
+# application and define LOGGING_ASYNC to enable it; they require Threads.
+set( LOGGING_ASYNC_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/async_log.c )
+
+# Sources for the optional binary logging backend. Compile them into the
+# application and define LOGGING_BINARY to enable it; they require Threads
+# and the clock_posix library.
+set( LOGGING_BINARY_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/binary_log.c )
+
+# Sources for the optional runtime log level table. Compile them into the
+# application and define LOGGING_RUNTIME_LEVELS to enable it; they require
+# Threads.
+set( LOGGING_RUNTIME_LEVELS_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/log_level_table.c )
+
+# Sources for the optional structured logging backend. Compile them into the
+# application and define LOGGING_STRUCTURED to enable it; they require the
+# clock_posix library.
+set( LOGGING_STRUCTURED_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/structured_log.c )
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 /* The macro definition for LIBRARY_LOG_NAME is for Doxygen
  * documentation only. This macro is typically defined in only the
@@ -69,8 +70,88 @@
 #define LOG_METADATA_FORMAT    "[%s] [%s:%d] "                      /**< @brief Format of metadata prefix in log messages as `[<Logging-Level>] [<Library-Name>] [<File-Name>:<Line-Number>]` */
 #define LOG_METADATA_ARGS      LIBRARY_LOG_NAME, FILENAME, __LINE__ /**< @brief Arguments into the metadata logging prefix format. */
 
+/**
+ * @brief Define to route log messages through the asynchronous backend in
+ * async_log.h instead of calling `printf` on the logging thread.
+ *
+ * The application must link the sources in `LOGGING_ASYNC_SOURCES` and call
+ * #AsyncLog_Init before logging. Until then, lines are written synchronously.
+ */
+#ifdef DOXYGEN
+    #define LOGGING_ASYNC
+#endif
+
+/**
+ * @brief Define to record log lines as compact binary records with the
+ * backend in binary_log.h instead of formatting them as text.
+ *
+ * No formatting happens at the call site; the application drains records
+ * with #BinLog_Read and `tools/binlog/binlog_decode.py` rebuilds the text
+ * offline. The application must link the sources in `LOGGING_BINARY_SOURCES`
+ * and the `clock_posix` library.
+ */
+#ifdef DOXYGEN
+    #define LOGGING_BINARY
+#endif
+
+/**
+ * @brief Define to make each library's level adjustable at runtime with the
+ * table in log_level_table.h.
+ *
+ * Levels up to #LOGGING_MAX_LEVEL are compiled in, and LIBRARY_LOG_LEVEL
+ * becomes the initial runtime level. The application must link the sources
+ * in `LOGGING_RUNTIME_LEVELS_SOURCES`.
+ */
+#ifdef DOXYGEN
+    #define LOGGING_RUNTIME_LEVELS
+#endif
+
+/**
+ * @brief Define to build each line, with a timestamp and thread ID, in one
+ * buffer and emit it with a single `write()` using the backend in
+ * structured_log.h.
+ *
+ * #StructuredLog_Configure selects plain text, key=value or JSON output. The
+ * application must link the sources in `LOGGING_STRUCTURED_SOURCES` and the
+ * `clock_posix` library.
+ */
+#ifdef DOXYGEN
+    #define LOGGING_STRUCTURED
+#endif
+
 #if !defined( DISABLE_LOGGING )
 
+    #if defined( LOGGING_BINARY )
+        #include "binary_log.h"
+
+/**
+ * @brief Common macro that maps all the logging interfaces,
+ * (#LogDebug, #LogInfo, #LogWarn, #LogError) to a binary record of the call
+ * site and arguments.
+ */
+        #define SdkLogLine( level, levelString, message ) \
+    BinLog_Begin( level, LIBRARY_LOG_NAME, __FILE__, __LINE__ ); BinLog_Record message
+    #elif defined( LOGGING_STRUCTURED )
+        #include "structured_log.h"
+
+/**
+ * @brief Common macro that maps all the logging interfaces,
+ * (#LogDebug, #LogInfo, #LogWarn, #LogError) to the structured backend,
+ * which emits each line with a single write.
+ */
+        #define SdkLogLine( level, levelString, message ) \
+    StructuredLog_Begin( level, LIBRARY_LOG_NAME, __FILE__, __LINE__ ); StructuredLog_Printf message
+    #elif defined( LOGGING_ASYNC )
+        #include "async_log.h"
+
+/**
+ * @brief Common macro that maps all the logging interfaces,
+ * (#LogDebug, #LogInfo, #LogWarn, #LogError) to the asynchronous backend,
+ * which publishes each complete line to a background writer thread.
+ */
+        #define SdkLog( string )    AsyncLog_Printf string
+    #else
+
 /**
  * @brief Common macro that maps all the logging interfaces,
  * (#LogDebug, #LogInfo, #LogWarn, #LogError) to the platform-specific logging
@@ -79,11 +160,83 @@
  * `printf` from the standard C library is the POSIX platform implementation used
  * for logging functionality.
  */
-    #define SdkLog( string )    printf string
+        #define SdkLog( string )    printf string
+    #endif
 #else
     #define SdkLog( string )
 #endif
 
+#if !defined( SdkLogLine )
+
+/**
+ * @brief Log one line as the level prefix and metadata, the message and a
+ * line terminator through #SdkLog.
+ */
+    #define SdkLogLine( level, levelString, message ) \
+    SdkLog( ( levelString LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+#endif
+
+/**
+ * @brief Number of times a rate-limited call site logs in each
+ * #LOG_RATE_LIMIT_INTERVAL_S window before further messages are suppressed.
+ */
+#ifndef LOG_RATE_LIMIT_BURST
+    #define LOG_RATE_LIMIT_BURST         ( 5U )
+#endif
+
+/**
+ * @brief Length, in seconds, of the window of a rate-limited call site.
+ */
+#ifndef LOG_RATE_LIMIT_INTERVAL_S
+    #define LOG_RATE_LIMIT_INTERVAL_S    ( 10 )
+#endif
+
+/**
+ * @brief Log through @p logMacro at most #LOG_RATE_LIMIT_BURST times per
+ * #LOG_RATE_LIMIT_INTERVAL_S window from this call site.
+ *
+ * The window starts with the first message logged. Messages past the burst
+ * are counted instead of logged. The first message after the window ends is
+ * logged after a line with the number of messages suppressed, and starts a
+ * new window. The clock is only read once the burst is used up, so sites
+ * that rarely log pay nothing for it.
+ *
+ * The counters are per call site and are not synchronized, so under
+ * concurrent use the limits are approximate.
+ */
+#define LogRateLimited( logMacro, message )                                                   \
+    do {                                                                                      \
+        static uint32_t logOccurrences = 0U, logSuppressed = 0U;                              \
+        static time_t logWindowStart = 0;                                                     \
+        time_t logNow = 0;                                                                    \
+        if( logOccurrences < LOG_RATE_LIMIT_BURST )                                           \
+        {                                                                                     \
+            logWindowStart = ( logOccurrences == 0U ) ? time( NULL ) : logWindowStart;        \
+            logOccurrences++;                                                                 \
+            logMacro( message );                                                              \
+        }                                                                                     \
+        else                                                                                  \
+        {                                                                                     \
+            logNow = time( NULL );                                                            \
+            if( difftime( logNow, logWindowStart ) >= ( double ) LOG_RATE_LIMIT_INTERVAL_S )  \
+            {                                                                                 \
+                if( logSuppressed > 0U )                                                      \
+                {                                                                             \
+                    logMacro( ( "Suppressed %lu messages from this site.",                    \
+                                ( unsigned long ) logSuppressed ) );                          \
+                }                                                                             \
+                logWindowStart = logNow;                                                      \
+                logOccurrences = 1U;                                                          \
+                logSuppressed = 0U;                                                           \
+                logMacro( message );                                                          \
+            }                                                                                 \
+            else                                                                              \
+            {                                                                                 \
+                logSuppressed++;                                                              \
+            }                                                                                 \
+        }                                                                                     \
+    } while( 0 )
+
 /**
  * Disable definition of logging interface macros when generating doxygen output,
  * to avoid conflict with documentation of macros at the end of the file.
@@ -99,42 +252,91 @@
     )
     #error "Please define LIBRARY_LOG_LEVEL as either LOG_NONE, LOG_ERROR, LOG_WARN, LOG_INFO, or LOG_DEBUG."
 #else
-    #if LIBRARY_LOG_LEVEL == LOG_DEBUG
+    #if defined( LOGGING_RUNTIME_LEVELS ) && !defined( DISABLE_LOGGING )
+        #include "log_level_table.h"
+
+        /* Compile in every level up to the maximum and decide at runtime. */
+        #define LOG_COMPILED_LEVEL                           LOGGING_MAX_LEVEL
+        #define SdkLogChecked( level, levelString, message )                                      \
+    do {                                                                                          \
+        static const volatile uint8_t * pLogLevelCache = NULL;                                    \
+        if( LOG_LEVEL_TABLE_ENABLED( pLogLevelCache, LIBRARY_LOG_NAME, LIBRARY_LOG_LEVEL, level ) ) \
+        {                                                                                         \
+            SdkLogLine( level, levelString, message );                                            \
+        }                                                                                         \
+    } while( 0 )
+    #else
+        #define LOG_COMPILED_LEVEL                           LIBRARY_LOG_LEVEL
+        #define SdkLogChecked( level, levelString, message ) SdkLogLine( level, levelString, message )
+    #endif
+
+    #if LOG_COMPILED_LEVEL == LOG_DEBUG
         /* All log level messages will logged. */
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )     SdkLog( ( "[WARN] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogInfo( message )     SdkLog( ( "[INFO] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogDebug( message )    SdkLog( ( "[DEBUG] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogChecked( LOG_ERROR, "[ERROR] ", message )
+        #define LogWarn( message )     SdkLogChecked( LOG_WARN, "[WARN] ", message )
+        #define LogInfo( message )     SdkLogChecked( LOG_INFO, "[INFO] ", message )
+        #define LogDebug( message )    SdkLogChecked( LOG_DEBUG, "[DEBUG] ", message )
 
-    #elif LIBRARY_LOG_LEVEL == LOG_INFO
+    #elif LOG_COMPILED_LEVEL == LOG_INFO
         /* Only INFO, WARNING and ERROR messages will be logged. */
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )     SdkLog( ( "[WARN] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogInfo( message )     SdkLog( ( "[INFO] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogChecked( LOG_ERROR, "[ERROR] ", message )
+        #define LogWarn( message )     SdkLogChecked( LOG_WARN, "[WARN] ", message )
+        #define LogInfo( message )     SdkLogChecked( LOG_INFO, "[INFO] ", message )
         #define LogDebug( message )
 
-    #elif LIBRARY_LOG_LEVEL == LOG_WARN
+    #elif LOG_COMPILED_LEVEL == LOG_WARN
         /* Only WARNING and ERROR messages will be logged.*/
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )     SdkLog( ( "[WARN] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogChecked( LOG_ERROR, "[ERROR] ", message )
+        #define LogWarn( message )     SdkLogChecked( LOG_WARN, "[WARN] ", message )
         #define LogInfo( message )
         #define LogDebug( message )
 
-    #elif LIBRARY_LOG_LEVEL == LOG_ERROR
+    #elif LOG_COMPILED_LEVEL == LOG_ERROR
         /* Only ERROR messages will be logged. */
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogChecked( LOG_ERROR, "[ERROR] ", message )
         #define LogWarn( message )
         #define LogInfo( message )
         #define LogDebug( message )
 
-    #else /* if LIBRARY_LOG_LEVEL == LOG_ERROR */
+    #else /* if LOG_COMPILED_LEVEL == LOG_ERROR */
 
         #define LogError( message )
         #define LogWarn( message )
         #define LogInfo( message )
         #define LogDebug( message )
 
-    #endif /* if LIBRARY_LOG_LEVEL == LOG_ERROR */
+    #endif /* if LOG_COMPILED_LEVEL == LOG_ERROR */
+
+    /* Rate-limited variants compile out together with their level. */
+    #if defined( DISABLE_LOGGING )
+        #define LOG_RATE_LIMITED_LEVEL    LOG_NONE
+    #else
+        #define LOG_RATE_LIMITED_LEVEL    LOG_COMPILED_LEVEL
+    #endif
+
+    #if LOG_RATE_LIMITED_LEVEL >= LOG_ERROR
+        #define LogErrorRateLimited( message )    LogRateLimited( LogError, message )
+    #else
+        #define LogErrorRateLimited( message )
+    #endif
+
+    #if LOG_RATE_LIMITED_LEVEL >= LOG_WARN
+        #define LogWarnRateLimited( message )     LogRateLimited( LogWarn, message )
+    #else
+        #define LogWarnRateLimited( message )
+    #endif
+
+    #if LOG_RATE_LIMITED_LEVEL >= LOG_INFO
+        #define LogInfoRateLimited( message )     LogRateLimited( LogInfo, message )
+    #else
+        #define LogInfoRateLimited( message )
+    #endif
+
+    #if LOG_RATE_LIMITED_LEVEL >= LOG_DEBUG
+        #define LogDebugRateLimited( message )    LogRateLimited( LogDebug, message )
+    #else
+        #define LogDebugRateLimited( message )
+    #endif
 #endif /* if !defined( LIBRARY_LOG_LEVEL ) || ( ( LIBRARY_LOG_LEVEL != LOG_NONE ) && ( LIBRARY_LOG_LEVEL != LOG_ERROR ) && ( LIBRARY_LOG_LEVEL != LOG_WARN ) && ( LIBRARY_LOG_LEVEL != LOG_INFO ) && ( LIBRARY_LOG_LEVEL != LOG_DEBUG ) ) */
 /** @endcond */
 
@@ -148,7 +350,7 @@
  * This macro is only enabled for #LOG_DEBUG level configuration in this
  * logging stack implementation.
  */
-    #define LogDebug( message )    SdkLog( ( "[DEBUG] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+    #define LogDebug( message )    SdkLogLine( LOG_DEBUG, "[DEBUG] ", message )
 
 /**
  * @brief Definition of logging interface macro that logs messages at the "Info"
@@ -157,7 +359,7 @@
  * This macro is only enabled for #LOG_DEBUG and #LOG_INFO level configurations
  * in this logging stack implementation.
  */
-    #define LogInfo( message )     SdkLog( ( "[INFO] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+    #define LogInfo( message )     SdkLogLine( LOG_INFO, "[INFO] ", message )
 
 /**
  * @brief Definition of logging interface macro that logs messages at the "Warning"
@@ -166,7 +368,7 @@
  * This macro is only enabled for #LOG_DEBUG, #LOG_INFO and #LOG_WARN level
  * configurations in this logging stack implementation.
  */
-    #define LogWarn( message )     SdkLog( ( "[WARN] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+    #define LogWarn( message )     SdkLogLine( LOG_WARN, "[WARN] ", message )
 
 /**
  * @brief Definition of logging interface macro that logs messages at the "Error"
@@ -175,7 +377,17 @@
  * This macro is only enabled for all logging level configurations
  * unless except the #LOG_NONE configuration.
  */
-    #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+    #define LogError( message )    SdkLogLine( LOG_ERROR, "[ERROR] ", message )
+
+/**
+ * @brief Rate-limited variant of #LogError for call sites that can fail
+ * repeatedly, such as transport receive and send errors.
+ *
+ * Refer to #LogRateLimited for the suppression policy. #LogWarnRateLimited,
+ * #LogInfoRateLimited and #LogDebugRateLimited are defined likewise, and each
+ * compiles out together with its level.
+ */
+    #define LogErrorRateLimited( message )    LogRateLimited( LogError, message )
 
 #endif /* ifdef DOXYGEN */
 
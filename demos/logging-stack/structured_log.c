@@ -0,0 +1,338 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file structured_log.c
+ * @brief Implementation of the structured logging backend in structured_log.h.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined( __linux__ )
+    #include <sys/syscall.h>
+#endif
+
+/* Include header for logging level macros. */
+#include "logging_levels.h"
+
+#include "structured_log.h"
+#include "clock.h"
+
+/**
+ * @brief Number of microseconds in one second.
+ */
+#define ONE_SEC_TO_US    ( 1000000U )
+
+/**
+ * @brief The call site of the line being logged by one thread.
+ */
+typedef struct LogSite
+{
+    uint8_t level;              /**< @brief Log level. */
+    const char * pLibraryName;  /**< @brief LIBRARY_LOG_NAME of the call site. */
+    const char * pFileName;     /**< @brief __FILE__ of the call site. */
+    uint32_t lineNumber;        /**< @brief __LINE__ of the call site. */
+} LogSite_t;
+
+/**
+ * @brief Names of the log levels, indexed by level.
+ */
+static const char * const levelNames[] = { "NONE", "ERROR", "WARN", "INFO", "DEBUG" };
+
+/**
+ * @brief The configured output format.
+ */
+static StructuredLogFormat_t outputFormat = StructuredLogText;
+
+/**
+ * @brief The configured output file descriptor.
+ */
+static int outputFd = STDOUT_FILENO;
+
+/**
+ * @brief The call site passed to #StructuredLog_Begin by the calling thread.
+ */
+static __thread LogSite_t threadSite;
+
+/**
+ * @brief The calling thread's ID, or 0 before it has been looked up.
+ */
+static __thread unsigned long threadId = 0UL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the ID of the calling thread, as shown by tools like `top`
+ * where the system provides one.
+ *
+ * @return The thread ID.
+ */
+static unsigned long getThreadId( void );
+
+/**
+ * @brief Copy a message, escaping it for a quoted key=value or JSON string.
+ *
+ * Escape sequences are never split when the destination fills up.
+ *
+ * @param[out] pDest Destination buffer.
+ * @param[in] destSize Space available in @p pDest.
+ * @param[in] pSource NUL-terminated message.
+ * @param[in] json Non-zero to escape as JSON, which also requires control
+ * characters to be escaped.
+ *
+ * @return Number of bytes written to @p pDest.
+ */
+static size_t escapeMessage( char * pDest,
+                             size_t destSize,
+                             const char * pSource,
+                             int json );
+
+/**
+ * @brief Write a whole line to the output file descriptor.
+ *
+ * @param[in] pLine The line.
+ * @param[in] length Length of the line.
+ */
+static void writeLine( const char * pLine,
+                       size_t length );
+
+/*-----------------------------------------------------------*/
+
+static unsigned long getThreadId( void )
+{
+    if( threadId == 0UL )
+    {
+        #if defined( __linux__ ) && defined( SYS_gettid )
+            threadId = ( unsigned long ) syscall( SYS_gettid );
+        #else
+            threadId = ( unsigned long ) pthread_self();
+        #endif
+    }
+
+    return threadId;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t escapeMessage( char * pDest,
+                             size_t destSize,
+                             const char * pSource,
+                             int json )
+{
+    char escaped[ 7 ];
+    size_t written = 0U, escapedLength = 0U;
+    unsigned char character = 0U;
+
+    for( ; *pSource != '\0'; pSource++ )
+    {
+        character = ( unsigned char ) *pSource;
+
+        if( ( character == ( unsigned char ) '"' ) || ( character == ( unsigned char ) '\\' ) )
+        {
+            escaped[ 0 ] = '\\';
+            escaped[ 1 ] = ( char ) character;
+            escapedLength = 2U;
+        }
+        else if( character == ( unsigned char ) '\n' )
+        {
+            ( void ) memcpy( escaped, "\\n", 2U );
+            escapedLength = 2U;
+        }
+        else if( character == ( unsigned char ) '\r' )
+        {
+            ( void ) memcpy( escaped, "\\r", 2U );
+            escapedLength = 2U;
+        }
+        else if( character == ( unsigned char ) '\t' )
+        {
+            ( void ) memcpy( escaped, "\\t", 2U );
+            escapedLength = 2U;
+        }
+        else if( ( json != 0 ) && ( character < 0x20U ) )
+        {
+            ( void ) snprintf( escaped, sizeof( escaped ), "\\u%04x", ( unsigned int ) character );
+            escapedLength = 6U;
+        }
+        else
+        {
+            escaped[ 0 ] = ( char ) character;
+            escapedLength = 1U;
+        }
+
+        if( ( written + escapedLength ) > destSize )
+        {
+            break;
+        }
+
+        ( void ) memcpy( &pDest[ written ], escaped, escapedLength );
+        written += escapedLength;
+    }
+
+    return written;
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeLine( const char * pLine,
+                       size_t length )
+{
+    size_t bytesWritten = 0U;
+    ssize_t result = 0;
+
+    /* A single write keeps the line whole; the loop only matters if the
+     * descriptor accepts part of it. */
+    while( bytesWritten < length )
+    {
+        result = write( outputFd, &pLine[ bytesWritten ], length - bytesWritten );
+
+        if( result > 0 )
+        {
+            bytesWritten += ( size_t ) result;
+        }
+        else if( ( result < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before anything was written; try again. */
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void StructuredLog_Configure( StructuredLogFormat_t format,
+                              int fd )
+{
+    outputFormat = format;
+    outputFd = fd;
+}
+
+/*-----------------------------------------------------------*/
+
+void StructuredLog_Begin( uint8_t level,
+                          const char * pLibraryName,
+                          const char * pFileName,
+                          uint32_t lineNumber )
+{
+    threadSite.level = level;
+    threadSite.pLibraryName = pLibraryName;
+    threadSite.pFileName = pFileName;
+    threadSite.lineNumber = lineNumber;
+}
+
+/*-----------------------------------------------------------*/
+
+void StructuredLog_Printf( const char * pFormat,
+                           ... )
+{
+    char message[ STRUCTURED_LOG_LINE_SIZE ];
+    char line[ STRUCTURED_LOG_LINE_SIZE ];
+    const char * pFileName = strrchr( threadSite.pFileName, '/' );
+    const char * pLevelName = "NONE";
+    const char * pSuffix = "\r\n";
+    uint64_t nowUs = 0U;
+    size_t length = 0U, suffixLength = 0U, messageLength = 0U;
+    int formatted = 0;
+    va_list args;
+
+    va_start( args, pFormat );
+    formatted = vsnprintf( message, sizeof( message ), pFormat, args );
+    va_end( args );
+
+    if( formatted < 0 )
+    {
+        message[ 0 ] = '\0';
+    }
+
+    nowUs = Clock_GetTimeUs();
+    pFileName = ( pFileName != NULL ) ? ( pFileName + 1 ) : threadSite.pFileName;
+
+    if( threadSite.level < ( sizeof( levelNames ) / sizeof( levelNames[ 0 ] ) ) )
+    {
+        pLevelName = levelNames[ threadSite.level ];
+    }
+
+    if( outputFormat == StructuredLogKeyValue )
+    {
+        formatted = snprintf( line, sizeof( line ),
+                              "ts=%lu.%06lu tid=%lu level=%s lib=%s file=%s line=%lu msg=\"",
+                              ( unsigned long ) ( nowUs / ONE_SEC_TO_US ), ( unsigned long ) ( nowUs % ONE_SEC_TO_US ),
+                              getThreadId(), pLevelName, threadSite.pLibraryName, pFileName,
+                              ( unsigned long ) threadSite.lineNumber );
+        pSuffix = "\"\n";
+    }
+    else if( outputFormat == StructuredLogJson )
+    {
+        formatted = snprintf( line, sizeof( line ),
+                              "{\"ts\":%lu.%06lu,\"tid\":%lu,\"level\":\"%s\",\"lib\":\"%s\","
+                              "\"file\":\"%s\",\"line\":%lu,\"msg\":\"",
+                              ( unsigned long ) ( nowUs / ONE_SEC_TO_US ), ( unsigned long ) ( nowUs % ONE_SEC_TO_US ),
+                              getThreadId(), pLevelName, threadSite.pLibraryName, pFileName,
+                              ( unsigned long ) threadSite.lineNumber );
+        pSuffix = "\"}\n";
+    }
+    else
+    {
+        formatted = snprintf( line, sizeof( line ),
+                              "%lu.%06lu [%lu] [%s] [%s] [%s:%lu] ",
+                              ( unsigned long ) ( nowUs / ONE_SEC_TO_US ), ( unsigned long ) ( nowUs % ONE_SEC_TO_US ),
+                              getThreadId(), pLevelName, threadSite.pLibraryName, pFileName,
+                              ( unsigned long ) threadSite.lineNumber );
+    }
+
+    suffixLength = strlen( pSuffix );
+
+    /* Keep room for the suffix even if the prefix was truncated. */
+    length = ( formatted < 0 ) ? 0U : ( size_t ) formatted;
+    length = ( length > ( sizeof( line ) - 1U - suffixLength ) ) ? ( sizeof( line ) - 1U - suffixLength ) : length;
+
+    if( outputFormat == StructuredLogText )
+    {
+        messageLength = strlen( message );
+        messageLength = ( messageLength > ( sizeof( line ) - length - suffixLength ) ) ?
+                        ( sizeof( line ) - length - suffixLength ) : messageLength;
+        ( void ) memcpy( &line[ length ], message, messageLength );
+    }
+    else
+    {
+        messageLength = escapeMessage( &line[ length ], sizeof( line ) - length - suffixLength,
+                                       message, ( outputFormat == StructuredLogJson ) ? 1 : 0 );
+    }
+
+    length += messageLength;
+    ( void ) memcpy( &line[ length ], pSuffix, suffixLength );
+    length += suffixLength;
+
+    writeLine( line, length );
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,110 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file structured_log.h
+ * @brief Optional single-write structured backend for the logging stack.
+ *
+ * When @ref LOGGING_STRUCTURED is defined, each log line is built in one
+ * bounded buffer, with a monotonic timestamp, the thread ID, the level, the
+ * library name, the file and line and the message, and is then emitted with
+ * a single `write()`. Lines from different threads therefore do not
+ * interleave, as long as a line fits in `PIPE_BUF` when writing to a pipe.
+ *
+ * Lines can be written as plain text, as key=value pairs, or as one JSON
+ * object per line, so log shippers can ingest them without parsing.
+ */
+
+#ifndef STRUCTURED_LOG_H_
+#define STRUCTURED_LOG_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/**
+ * @brief Maximum length, in bytes, of a single log line including the line
+ * terminator. Longer messages are truncated.
+ */
+#ifndef STRUCTURED_LOG_LINE_SIZE
+    #define STRUCTURED_LOG_LINE_SIZE    ( 512U )
+#endif
+
+/**
+ * @brief Output formats of the structured backend.
+ */
+typedef enum StructuredLogFormat
+{
+    /**
+     * @brief `<sec>.<usec> [<tid>] [<LEVEL>] [<library>] [<file>:<line>] <message>`
+     */
+    StructuredLogText = 0,
+
+    /**
+     * @brief `ts=<sec>.<usec> tid=<tid> level=<LEVEL> lib=<library>
+     * file=<file> line=<line> msg="<message>"`, with `"` and `\` in the
+     * message escaped.
+     */
+    StructuredLogKeyValue,
+
+    /**
+     * @brief `{"ts":<sec>.<usec>,"tid":<tid>,"level":"<LEVEL>",
+     * "lib":"<library>","file":"<file>","line":<line>,"msg":"<message>"}`,
+     * with the message escaped as a JSON string.
+     */
+    StructuredLogJson
+} StructuredLogFormat_t;
+
+/**
+ * @brief Select the output format and file descriptor.
+ *
+ * The default is #StructuredLogText on `STDOUT_FILENO`. This is not
+ * synchronized with concurrent logging and should be called at startup.
+ *
+ * @param[in] format The output format.
+ * @param[in] fd The file descriptor to write lines to.
+ */
+void StructuredLog_Configure( StructuredLogFormat_t format,
+                              int fd );
+
+/**
+ * @brief Record the metadata of the next line logged by the calling thread.
+ *
+ * @param[in] level The log level of the line.
+ * @param[in] pLibraryName The LIBRARY_LOG_NAME of the call site.
+ * @param[in] pFileName The __FILE__ of the call site.
+ * @param[in] lineNumber The __LINE__ of the call site.
+ */
+void StructuredLog_Begin( uint8_t level,
+                          const char * pLibraryName,
+                          const char * pFileName,
+                          uint32_t lineNumber );
+
+/**
+ * @brief Format the message of the line started by #StructuredLog_Begin and
+ * write the whole line.
+ *
+ * @param[in] pFormat printf-style format string of the message.
+ */
+void StructuredLog_Printf( const char * pFormat,
+                           ... );
+
+#endif /* ifndef STRUCTURED_LOG_H_ */
@@ -0,0 +1,164 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_idle.c
+ * @brief Implementation of the wait for MQTT work.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stddef.h>
+
+/* POSIX includes. */
+#include <poll.h>
+
+#include "mqtt_idle.h"
+
+/**
+ * @brief Longest timeout poll takes, as an int of milliseconds.
+ */
+#define POLL_MAX_TIMEOUT_MS    ( 0x7FFFFFFF )
+
+/*-----------------------------------------------------------*/
+
+uint32_t MQTTIdle_GetKeepAliveWaitMs( const MQTTContext_t * pContext )
+{
+    uint32_t waitMs = MQTT_IDLE_WAIT_FOREVER;
+    uint32_t elapsedMs = 0U;
+    uint32_t intervalMs = 0U;
+
+    if( pContext->waitingForPingResp == true )
+    {
+        /* The process loop reports a timeout once more than this has passed
+         * since the PINGREQ. */
+        elapsedMs = pContext->getTime() - pContext->pingReqSendTimeMs;
+        intervalMs = pContext->pingRespTimeoutMs;
+    }
+    else if( pContext->keepAliveIntervalSec != 0U )
+    {
+        /* The process loop sends a PINGREQ once more than the interval has
+         * passed since the last packet was sent. */
+        elapsedMs = pContext->getTime() - pContext->lastPacketTime;
+        intervalMs = ( uint32_t ) pContext->keepAliveIntervalSec * 1000U;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( intervalMs != 0U )
+    {
+        waitMs = ( elapsedMs > intervalMs ) ? 0U : ( intervalMs - elapsedMs + 1U );
+    }
+
+    return waitMs;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTIdleStatus_t MQTTIdle_WaitForWork( const MQTTContext_t * pContext,
+                                       int socketDescriptor,
+                                       int wakeDescriptor,
+                                       uint32_t maxWaitMs,
+                                       uint32_t * pEvents )
+{
+    MQTTIdleStatus_t status = MQTTIdleSuccess;
+    struct pollfd descriptors[ 2 ];
+    nfds_t descriptorCount = 1U;
+    uint32_t keepAliveWaitMs = 0U;
+    uint32_t waitMs = 0U;
+    int timeoutMs = 0;
+    int pollStatus = 0;
+
+    if( ( pContext == NULL ) || ( socketDescriptor < 0 ) || ( pEvents == NULL ) )
+    {
+        status = MQTTIdleBadParameter;
+    }
+    else
+    {
+        *pEvents = 0U;
+
+        descriptors[ 0 ].fd = socketDescriptor;
+        descriptors[ 0 ].events = POLLIN;
+        descriptors[ 0 ].revents = 0;
+
+        if( wakeDescriptor >= 0 )
+        {
+            descriptors[ 1 ].fd = wakeDescriptor;
+            descriptors[ 1 ].events = POLLIN;
+            descriptors[ 1 ].revents = 0;
+            descriptorCount = 2U;
+        }
+
+        /* Recompute the deadline after a signal, as time has passed. */
+        do
+        {
+            keepAliveWaitMs = MQTTIdle_GetKeepAliveWaitMs( pContext );
+            waitMs = ( keepAliveWaitMs < maxWaitMs ) ? keepAliveWaitMs : maxWaitMs;
+
+            if( waitMs == MQTT_IDLE_WAIT_FOREVER )
+            {
+                timeoutMs = -1;
+            }
+            else
+            {
+                timeoutMs = ( waitMs > ( uint32_t ) POLL_MAX_TIMEOUT_MS ) ?
+                            POLL_MAX_TIMEOUT_MS : ( int ) waitMs;
+            }
+
+            pollStatus = poll( descriptors, descriptorCount, timeoutMs );
+        } while( ( pollStatus < 0 ) && ( errno == EINTR ) );
+
+        if( pollStatus < 0 )
+        {
+            status = MQTTIdleSystemError;
+        }
+        else if( pollStatus == 0 )
+        {
+            /* A wait cut short by the keep-alive deadline is an event; one
+             * that reached the caller's maximum is not. */
+            if( keepAliveWaitMs <= maxWaitMs )
+            {
+                *pEvents = MQTT_IDLE_EVENT_KEEP_ALIVE;
+            }
+        }
+        else
+        {
+            /* Errors and hang-ups are reported as readable, so that the
+             * process loop finds them when it reads. */
+            if( descriptors[ 0 ].revents != 0 )
+            {
+                *pEvents |= MQTT_IDLE_EVENT_SOCKET;
+            }
+
+            if( ( descriptorCount == 2U ) && ( descriptors[ 1 ].revents != 0 ) )
+            {
+                *pEvents |= MQTT_IDLE_EVENT_WAKE;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
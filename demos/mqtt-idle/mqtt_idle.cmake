@@ -0,0 +1,6 @@
+# Configuration for the wait for MQTT work that replaces polling the process
+# loop with a fixed timeout.
+set( MQTT_IDLE_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
+set( MQTT_IDLE_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/mqtt_idle.c )
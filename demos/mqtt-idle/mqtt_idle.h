@@ -0,0 +1,110 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_idle.h
+ * @brief Wait without polling for the next reason to run MQTT_ProcessLoop:
+ * an incoming packet, work queued by another thread, or a keep-alive deadline.
+ *
+ * Instead of calling MQTT_ProcessLoop with a fixed timeout, which wakes an
+ * idle device every time the timeout expires, an application calls
+ * #MQTTIdle_WaitForWork and then MQTT_ProcessLoop with a timeout of 0 for
+ * the events it reports. An idle connection then wakes only when the
+ * keep-alive interval requires a PINGREQ, or a PINGRESP is overdue.
+ */
+
+#ifndef MQTT_IDLE_H_
+#define MQTT_IDLE_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/**
+ * @brief A wait without a deadline.
+ */
+#define MQTT_IDLE_WAIT_FOREVER       ( UINT32_MAX )
+
+/**
+ * @brief The socket of the connection is readable.
+ */
+#define MQTT_IDLE_EVENT_SOCKET       ( 1U << 0 )
+
+/**
+ * @brief The wake descriptor is readable.
+ */
+#define MQTT_IDLE_EVENT_WAKE         ( 1U << 1 )
+
+/**
+ * @brief The process loop must run for the keep-alive mechanism.
+ */
+#define MQTT_IDLE_EVENT_KEEP_ALIVE    ( 1U << 2 )
+
+/**
+ * @brief Return codes from the idle functions.
+ */
+typedef enum MQTTIdleStatus
+{
+    MQTTIdleSuccess,      /**< @brief The wait ended with events, or at its maximum time. */
+    MQTTIdleBadParameter, /**< @brief A parameter was NULL or a descriptor invalid. */
+    MQTTIdleSystemError   /**< @brief poll failed. */
+} MQTTIdleStatus_t;
+
+/**
+ * @brief Get the time until MQTT_ProcessLoop next has to run to send a
+ * PINGREQ, or to find that the PINGRESP has not arrived in time.
+ *
+ * @param[in] pContext The MQTT context, connected.
+ *
+ * @return The time in milliseconds, 0 if it is due already, or
+ * #MQTT_IDLE_WAIT_FOREVER if keep-alive is disabled.
+ */
+uint32_t MQTTIdle_GetKeepAliveWaitMs( const MQTTContext_t * pContext );
+
+/**
+ * @brief Sleep until the socket or the wake descriptor is readable, the
+ * keep-alive deadline arrives, or @p maxWaitMs passes.
+ *
+ * @param[in] pContext The MQTT context, connected.
+ * @param[in] socketDescriptor The socket of the connection.
+ * @param[in] wakeDescriptor A descriptor other threads make readable to wake
+ * the waiting thread, such as the read end of a pipe or an eventfd, or -1.
+ * The caller drains it.
+ * @param[in] maxWaitMs Longest time to wait, or #MQTT_IDLE_WAIT_FOREVER.
+ * @param[out] pEvents The MQTT_IDLE_EVENT_* bits of what ended the wait; 0
+ * if @p maxWaitMs passed.
+ *
+ * @note A TLS transport may already hold received bytes the socket no longer
+ * reports, for example after MQTT_ProcessLoop read one of several packets of a
+ * TLS record. Only wait when it holds none, such as when SSL_pending is 0.
+ *
+ * @return #MQTTIdleSuccess, #MQTTIdleBadParameter or #MQTTIdleSystemError.
+ */
+MQTTIdleStatus_t MQTTIdle_WaitForWork( const MQTTContext_t * pContext,
+                                       int socketDescriptor,
+                                       int wakeDescriptor,
+                                       uint32_t maxWaitMs,
+                                       uint32_t * pEvents );
+
+#endif /* ifndef MQTT_IDLE_H_ */
@@ -0,0 +1,924 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_agent.c
+ * @brief Implements the MQTT agent declared in mqtt_agent.h.
+ *
+ * The command queue is a bounded array of slots, each with a sequence
+ * number. A producer claims a queue position with a compare-and-swap on the
+ * enqueue position, writes the command into the slot, and then publishes it
+ * by storing the next sequence number. The agent thread is the only consumer,
+ * so it reads slots in order without any atomic read-modify-write.
+ *
+ * A producer writes a byte to a pipe only if the agent has no wakeup pending
+ * yet, so a burst of commands costs one wakeup.
+ *
+ * The agent takes commands from the queue only while a pending slot is free
+ * and the flow control window is open, so the queue fills up and pushes back
+ * on producers when the broker acknowledges publishes slower than they are
+ * queued.
+ */
+
+/* Include demo_config.h first for logging and other configuration */
+#include "demo_config.h"
+
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <unistd.h>
+
+/* MQTT agent include. */
+#include "mqtt_agent.h"
+
+/* Clock for the round trips of acknowledgements. */
+#include "clock.h"
+
+/* Keep-alive deadline of the connection. */
+#include "mqtt_idle.h"
+
+/**
+ * @brief Mask of a queue position that gives its slot.
+ */
+#define MQTT_AGENT_QUEUE_MASK    ( MQTT_AGENT_QUEUE_LENGTH - 1U )
+
+/**
+ * @brief Number of events the agent waits for: the socket and the pipe.
+ */
+#define MQTT_AGENT_EVENT_COUNT    ( 2U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Event callback of the MQTT context of every agent.
+ *
+ * @param[in] pMqttContext The MQTT context, which is the first member of its agent.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Queue a command and wake the agent if needed.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command to copy into the queue.
+ *
+ * @return #MQTTAgentSuccess if queued; #MQTTAgentQueueFull or
+ * #MQTTAgentApiError otherwise.
+ */
+static MQTTAgentStatus_t enqueueCommand( MQTTAgentContext_t * pAgent,
+                                         const MQTTAgentCommand_t * pCommand );
+
+/**
+ * @brief Take the oldest queued command. Only the agent thread calls this.
+ *
+ * @param[in] pAgent The agent.
+ * @param[out] pCommand The command.
+ *
+ * @return true if a command was taken; false if the queue is empty.
+ */
+static bool dequeueCommand( MQTTAgentContext_t * pAgent,
+                            MQTTAgentCommand_t * pCommand );
+
+/**
+ * @brief Wake the agent thread unless a wakeup is already pending.
+ *
+ * @param[in] pAgent The agent.
+ *
+ * @return #MQTTAgentSuccess if successful; #MQTTAgentApiError otherwise.
+ */
+static MQTTAgentStatus_t wakeAgent( MQTTAgentContext_t * pAgent );
+
+/**
+ * @brief Empty the wakeup pipe, so that commands queued from now on wake the
+ * agent again.
+ *
+ * @param[in] pAgent The agent.
+ */
+static void clearWakeup( MQTTAgentContext_t * pAgent );
+
+/**
+ * @brief Send a command with the MQTT library.
+ *
+ * A command that waits for an acknowledgement is kept in a pending slot,
+ * otherwise it is completed.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command.
+ *
+ * @return The status of the MQTT API called.
+ */
+static MQTTStatus_t sendCommand( MQTTAgentContext_t * pAgent,
+                                 const MQTTAgentCommand_t * pCommand );
+
+/**
+ * @brief Send the queued commands, as long as a pending slot is free for
+ * each of them.
+ *
+ * @param[in] pAgent The agent.
+ *
+ * @return #MQTTSuccess, or the status of the first command that failed to send.
+ */
+static MQTTStatus_t sendQueuedCommands( MQTTAgentContext_t * pAgent );
+
+/**
+ * @brief Check whether a command is a publish that waits for an
+ * acknowledgement and so counts against the flow control window.
+ *
+ * @param[in] pCommand The command.
+ *
+ * @return true for a QoS 1 or QoS 2 publish.
+ */
+static bool isWindowedPublish( const MQTTAgentCommand_t * pCommand );
+
+/**
+ * @brief Report acknowledgements that have become overdue to flow control,
+ * once each.
+ *
+ * @param[in] pAgent The agent.
+ */
+static void checkOverdueAcks( MQTTAgentContext_t * pAgent );
+
+/**
+ * @brief Get how long the agent can wait for events before the process loop
+ * has to run for keep-alive, or an acknowledgement becomes overdue.
+ *
+ * @param[in] pAgent The agent.
+ *
+ * @return The time in milliseconds, or EVENT_LOOP_WAIT_FOREVER.
+ */
+static uint32_t getWaitTimeMs( const MQTTAgentContext_t * pAgent );
+
+/**
+ * @brief Complete the pending command of an acknowledgement.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] packetIdentifier Packet identifier of the acknowledgement.
+ * @param[in] status The status to complete the command with.
+ */
+static void completePendingAck( MQTTAgentContext_t * pAgent,
+                                uint16_t packetIdentifier,
+                                MQTTAgentStatus_t status );
+
+/**
+ * @brief Invoke the completion callback of a command.
+ *
+ * @param[in] pCommand The command.
+ * @param[in] status The status to complete the command with.
+ */
+static void completeCommand( const MQTTAgentCommand_t * pCommand,
+                             MQTTAgentStatus_t status );
+
+/*-----------------------------------------------------------*/
+
+static void completeCommand( const MQTTAgentCommand_t * pCommand,
+                             MQTTAgentStatus_t status )
+{
+    if( pCommand->completionCallback != NULL )
+    {
+        pCommand->completionCallback( pCommand->pCallbackContext, status );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isWindowedPublish( const MQTTAgentCommand_t * pCommand )
+{
+    return ( pCommand->type == MQTTAgentPublish ) &&
+           ( pCommand->pPublishInfo->qos != MQTTQoS0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkOverdueAcks( MQTTAgentContext_t * pAgent )
+{
+    size_t index = 0U;
+    uint64_t nowUs = Clock_GetTimeUs();
+    uint64_t timeoutUs = FlowControl_GetAckTimeoutUs( &pAgent->flowControl );
+    MQTTAgentPendingAck_t * pPendingAck = NULL;
+
+    for( index = 0U; index < MQTT_AGENT_MAX_PENDING_ACKS; index++ )
+    {
+        pPendingAck = &pAgent->pendingAcks[ index ];
+
+        if( ( pPendingAck->packetIdentifier != 0U ) &&
+            ( pPendingAck->overdue == false ) &&
+            ( isWindowedPublish( &pPendingAck->command ) == true ) &&
+            ( ( nowUs - pPendingAck->sentTimeUs ) > timeoutUs ) )
+        {
+            LogWarn( ( "Acknowledgement of packet %u is overdue; reducing the window.",
+                       ( unsigned int ) pPendingAck->packetIdentifier ) );
+            pPendingAck->overdue = true;
+            FlowControl_OnTimeout( &pAgent->flowControl );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getWaitTimeMs( const MQTTAgentContext_t * pAgent )
+{
+    size_t index = 0U;
+    uint32_t waitMs = MQTTIdle_GetKeepAliveWaitMs( &pAgent->mqttContext );
+    uint64_t nowUs = Clock_GetTimeUs();
+    uint64_t timeoutUs = FlowControl_GetAckTimeoutUs( &pAgent->flowControl );
+    uint64_t elapsedUs = 0U;
+    uint64_t ackWaitMs = 0U;
+    const MQTTAgentPendingAck_t * pPendingAck = NULL;
+
+    for( index = 0U; index < MQTT_AGENT_MAX_PENDING_ACKS; index++ )
+    {
+        pPendingAck = &pAgent->pendingAcks[ index ];
+
+        if( ( pPendingAck->packetIdentifier != 0U ) &&
+            ( pPendingAck->overdue == false ) &&
+            ( isWindowedPublish( &pPendingAck->command ) == true ) )
+        {
+            elapsedUs = nowUs - pPendingAck->sentTimeUs;
+            ackWaitMs = ( elapsedUs > timeoutUs ) ? 0U : ( ( ( timeoutUs - elapsedUs ) / 1000U ) + 1U );
+
+            if( ackWaitMs < waitMs )
+            {
+                waitMs = ( uint32_t ) ackWaitMs;
+            }
+        }
+    }
+
+    return waitMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void completePendingAck( MQTTAgentContext_t * pAgent,
+                                uint16_t packetIdentifier,
+                                MQTTAgentStatus_t status )
+{
+    size_t index = 0U;
+    MQTTAgentCommand_t command;
+
+    for( index = 0U; index < MQTT_AGENT_MAX_PENDING_ACKS; index++ )
+    {
+        if( pAgent->pendingAcks[ index ].packetIdentifier == packetIdentifier )
+        {
+            if( isWindowedPublish( &pAgent->pendingAcks[ index ].command ) == false )
+            {
+                /* Subscribes and unsubscribes are not flow controlled. */
+            }
+            else if( status == MQTTAgentSuccess )
+            {
+                FlowControl_OnAck( &pAgent->flowControl,
+                                   Clock_GetTimeUs() - pAgent->pendingAcks[ index ].sentTimeUs );
+            }
+            else
+            {
+                FlowControl_OnDrop( &pAgent->flowControl );
+            }
+
+            /* Free the slot before the callback, so that the callback sees
+             * the agent as it will be when it returns. */
+            command = pAgent->pendingAcks[ index ].command;
+            pAgent->pendingAcks[ index ].packetIdentifier = 0U;
+            pAgent->pendingAckCount--;
+
+            completeCommand( &command, status );
+            break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    MQTTAgentContext_t * pAgent = ( MQTTAgentContext_t * ) pMqttContext;
+    MQTTAgentStatus_t status = MQTTAgentSuccess;
+    uint8_t * pStatusCodes = NULL;
+    size_t statusCount = 0U, index = 0U;
+
+    assert( pMqttContext != NULL );
+    assert( pPacketInfo != NULL );
+    assert( pDeserializedInfo != NULL );
+
+    if( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+    {
+        if( pAgent->incomingPublishCallback != NULL )
+        {
+            pAgent->incomingPublishCallback( pAgent->pIncomingPublishContext,
+                                             pDeserializedInfo->pPublishInfo );
+        }
+    }
+    else
+    {
+        switch( pPacketInfo->type )
+        {
+            case MQTT_PACKET_TYPE_SUBACK:
+
+                if( MQTT_GetSubAckStatusCodes( pPacketInfo, &pStatusCodes, &statusCount ) == MQTTSuccess )
+                {
+                    for( index = 0U; index < statusCount; index++ )
+                    {
+                        if( pStatusCodes[ index ] == ( uint8_t ) MQTTSubAckFailure )
+                        {
+                            status = MQTTAgentRejected;
+                        }
+                    }
+                }
+
+                completePendingAck( pAgent, pDeserializedInfo->packetIdentifier, status );
+                break;
+
+            case MQTT_PACKET_TYPE_UNSUBACK:
+            case MQTT_PACKET_TYPE_PUBACK:
+            case MQTT_PACKET_TYPE_PUBCOMP:
+                completePendingAck( pAgent, pDeserializedInfo->packetIdentifier, MQTTAgentSuccess );
+                break;
+
+            default:
+                /* PUBREC, PUBREL and PINGRESP are handled by the library. */
+                break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentStatus_t wakeAgent( MQTTAgentContext_t * pAgent )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+    uint8_t wakeup = 1U;
+
+    /* Only the producer that sets the flag writes to the pipe. The agent
+     * clears the flag before it reads the queue, so a command queued after
+     * that is either seen by this wakeup or causes a new one. */
+    if( __atomic_exchange_n( &pAgent->wakeupPending, 1U, __ATOMIC_ACQ_REL ) == 0U )
+    {
+        if( write( pAgent->wakeupDescriptors[ 1 ], &wakeup, sizeof( wakeup ) ) < 0 )
+        {
+            /* A full pipe already wakes the agent. */
+            if( errno != EAGAIN )
+            {
+                LogError( ( "Failed to wake the MQTT agent: errno=%d.", errno ) );
+                returnStatus = MQTTAgentApiError;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void clearWakeup( MQTTAgentContext_t * pAgent )
+{
+    uint8_t wakeups[ 16 ];
+
+    __atomic_store_n( &pAgent->wakeupPending, 0U, __ATOMIC_SEQ_CST );
+
+    while( read( pAgent->wakeupDescriptors[ 0 ], wakeups, sizeof( wakeups ) ) > 0 )
+    {
+        /* Discard every byte written since the last wakeup. */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentStatus_t enqueueCommand( MQTTAgentContext_t * pAgent,
+                                         const MQTTAgentCommand_t * pCommand )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+    MQTTAgentQueueSlot_t * pSlot = NULL;
+    uint32_t position = __atomic_load_n( &pAgent->enqueuePosition, __ATOMIC_RELAXED );
+    uint32_t sequence = 0U;
+    bool claimed = false;
+
+    while( ( claimed == false ) && ( returnStatus == MQTTAgentSuccess ) )
+    {
+        pSlot = &pAgent->queue[ position & MQTT_AGENT_QUEUE_MASK ];
+        sequence = __atomic_load_n( &pSlot->sequence, __ATOMIC_ACQUIRE );
+
+        if( sequence == position )
+        {
+            /* The slot is free for this position. On failure, another
+             * producer took the position, and position is reloaded. */
+            claimed = __atomic_compare_exchange_n( &pAgent->enqueuePosition,
+                                                   &position,
+                                                   position + 1U,
+                                                   true,
+                                                   __ATOMIC_RELAXED,
+                                                   __ATOMIC_RELAXED );
+        }
+        else if( ( int32_t ) ( sequence - position ) < 0 )
+        {
+            /* The agent has not read the command queued one lap ago. */
+            returnStatus = MQTTAgentQueueFull;
+        }
+        else
+        {
+            /* Another producer took the position since it was loaded. */
+            position = __atomic_load_n( &pAgent->enqueuePosition, __ATOMIC_RELAXED );
+        }
+    }
+
+    if( claimed == true )
+    {
+        pSlot->command = *pCommand;
+
+        /* Make the command visible to the agent. */
+        __atomic_store_n( &pSlot->sequence, position + 1U, __ATOMIC_RELEASE );
+
+        returnStatus = wakeAgent( pAgent );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool dequeueCommand( MQTTAgentContext_t * pAgent,
+                            MQTTAgentCommand_t * pCommand )
+{
+    bool dequeued = false;
+    uint32_t position = pAgent->dequeuePosition;
+    MQTTAgentQueueSlot_t * pSlot = &pAgent->queue[ position & MQTT_AGENT_QUEUE_MASK ];
+
+    if( __atomic_load_n( &pSlot->sequence, __ATOMIC_ACQUIRE ) == ( position + 1U ) )
+    {
+        *pCommand = pSlot->command;
+
+        /* Free the slot for the position one lap ahead. */
+        __atomic_store_n( &pSlot->sequence, position + MQTT_AGENT_QUEUE_LENGTH, __ATOMIC_RELEASE );
+        pAgent->dequeuePosition = position + 1U;
+        dequeued = true;
+    }
+
+    return dequeued;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t sendCommand( MQTTAgentContext_t * pAgent,
+                                 const MQTTAgentCommand_t * pCommand )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    uint16_t packetIdentifier = 0U;
+    size_t index = 0U;
+
+    if( ( pCommand->type != MQTTAgentPublish ) ||
+        ( pCommand->pPublishInfo->qos != MQTTQoS0 ) )
+    {
+        packetIdentifier = MQTT_GetPacketId( &pAgent->mqttContext );
+    }
+
+    switch( pCommand->type )
+    {
+        case MQTTAgentPublish:
+            mqttStatus = MQTT_Publish( &pAgent->mqttContext,
+                                       pCommand->pPublishInfo,
+                                       packetIdentifier );
+            break;
+
+        case MQTTAgentSubscribe:
+            mqttStatus = MQTT_Subscribe( &pAgent->mqttContext,
+                                         pCommand->pSubscriptionList,
+                                         pCommand->subscriptionCount,
+                                         packetIdentifier );
+            break;
+
+        case MQTTAgentUnsubscribe:
+        default:
+            mqttStatus = MQTT_Unsubscribe( &pAgent->mqttContext,
+                                           pCommand->pSubscriptionList,
+                                           pCommand->subscriptionCount,
+                                           packetIdentifier );
+            break;
+    }
+
+    if( mqttStatus != MQTTSuccess )
+    {
+        LogError( ( "MQTT agent failed to send a command: Status=%s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
+
+        /* A publish that failed to send counts as dropped. */
+        if( isWindowedPublish( pCommand ) == true )
+        {
+            FlowControl_OnSend( &pAgent->flowControl );
+            FlowControl_OnDrop( &pAgent->flowControl );
+        }
+
+        completeCommand( pCommand, MQTTAgentSendFailed );
+    }
+    else if( packetIdentifier == 0U )
+    {
+        /* A QoS 0 publish is complete once it is sent. */
+        completeCommand( pCommand, MQTTAgentSuccess );
+    }
+    else
+    {
+        /* The caller made sure that a slot is free. */
+        while( pAgent->pendingAcks[ index ].packetIdentifier != 0U )
+        {
+            index++;
+        }
+
+        assert( index < MQTT_AGENT_MAX_PENDING_ACKS );
+
+        pAgent->pendingAcks[ index ].packetIdentifier = packetIdentifier;
+        pAgent->pendingAcks[ index ].command = *pCommand;
+        pAgent->pendingAcks[ index ].sentTimeUs = Clock_GetTimeUs();
+        pAgent->pendingAcks[ index ].overdue = false;
+        pAgent->pendingAckCount++;
+
+        if( isWindowedPublish( pCommand ) == true )
+        {
+            FlowControl_OnSend( &pAgent->flowControl );
+        }
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t sendQueuedCommands( MQTTAgentContext_t * pAgent )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTAgentCommand_t command;
+
+    /* Commands beyond the free pending slots or the flow control window
+     * stay queued until acknowledgements free their slots, which pushes back
+     * on producers. The queue is taken in order, so a command that is not
+     * flow controlled also waits behind a publish that is. */
+    while( ( mqttStatus != MQTTSendFailed ) &&
+           ( pAgent->pendingAckCount < MQTT_AGENT_MAX_PENDING_ACKS ) &&
+           ( FlowControl_IsOpen( &pAgent->flowControl ) == true ) &&
+           ( dequeueCommand( pAgent, &command ) == true ) )
+    {
+        mqttStatus = sendCommand( pAgent, &command );
+    }
+
+    return ( mqttStatus == MQTTSendFailed ) ? MQTTSendFailed : MQTTSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentStatus_t MQTTAgent_Init( MQTTAgentContext_t * pAgent,
+                                  const TransportInterface_t * pTransport,
+                                  int32_t socketDescriptor,
+                                  MQTTGetCurrentTimeFunc_t getTimeFunction,
+                                  const MQTTFixedBuffer_t * pNetworkBuffer,
+                                  MQTTAgentIncomingPublishCallback_t incomingPublishCallback,
+                                  void * pIncomingPublishContext )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    FlowControlConfig_t flowControlConfig;
+    uint32_t index = 0U;
+
+    /* The queue position selects a slot by masking, so the length must be a
+     * power of two. */
+    assert( ( MQTT_AGENT_QUEUE_LENGTH & MQTT_AGENT_QUEUE_MASK ) == 0U );
+
+    if( ( pAgent == NULL ) || ( pTransport == NULL ) || ( socketDescriptor < 0 ) )
+    {
+        LogError( ( "Invalid parameter: pAgent=%p, pTransport=%p, socketDescriptor=%d.",
+                    ( void * ) pAgent,
+                    ( const void * ) pTransport,
+                    ( int ) socketDescriptor ) );
+        returnStatus = MQTTAgentBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pAgent, 0x00, sizeof( MQTTAgentContext_t ) );
+        pAgent->socketDescriptor = socketDescriptor;
+        pAgent->wakeupDescriptors[ 0 ] = -1;
+        pAgent->wakeupDescriptors[ 1 ] = -1;
+        pAgent->incomingPublishCallback = incomingPublishCallback;
+        pAgent->pIncomingPublishContext = pIncomingPublishContext;
+
+        for( index = 0U; index < MQTT_AGENT_QUEUE_LENGTH; index++ )
+        {
+            pAgent->queue[ index ].sequence = index;
+        }
+
+        /* The window never exceeds the outgoing publish records of the MQTT
+         * context. */
+        flowControlConfig.minWindow = 1U;
+        flowControlConfig.maxWindow = MQTT_AGENT_MAX_PENDING_ACKS;
+        flowControlConfig.initialWindow = MQTT_AGENT_INITIAL_WINDOW;
+        ( void ) FlowControl_Init( &pAgent->flowControl, &flowControlConfig );
+
+        mqttStatus = MQTT_Init( &pAgent->mqttContext,
+                                pTransport,
+                                getTimeFunction,
+                                eventCallback,
+                                pNetworkBuffer );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "MQTT_Init failed: Status=%s.", MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = MQTTAgentBadParameter;
+        }
+    }
+
+    if( returnStatus == MQTTAgentSuccess )
+    {
+        /* Neither end of the pipe may block: the agent empties it and a
+         * producer never waits for the agent. */
+        if( ( pipe( pAgent->wakeupDescriptors ) != 0 ) ||
+            ( fcntl( pAgent->wakeupDescriptors[ 0 ], F_SETFL, O_NONBLOCK ) != 0 ) ||
+            ( fcntl( pAgent->wakeupDescriptors[ 1 ], F_SETFL, O_NONBLOCK ) != 0 ) )
+        {
+            LogError( ( "Failed to create the wakeup pipe of the MQTT agent: errno=%d.", errno ) );
+            returnStatus = MQTTAgentApiError;
+        }
+        else if( EventLoop_Init( &pAgent->eventLoop ) != EVENT_LOOP_SUCCESS )
+        {
+            returnStatus = MQTTAgentApiError;
+        }
+        else if( ( EventLoop_Add( &pAgent->eventLoop,
+                                  pAgent->wakeupDescriptors[ 0 ],
+                                  NULL,
+                                  EVENT_LOOP_READABLE ) != EVENT_LOOP_SUCCESS ) ||
+                 ( EventLoop_Add( &pAgent->eventLoop,
+                                  socketDescriptor,
+                                  pTransport->pNetworkContext,
+                                  EVENT_LOOP_READABLE ) != EVENT_LOOP_SUCCESS ) )
+        {
+            ( void ) EventLoop_Deinit( &pAgent->eventLoop );
+            returnStatus = MQTTAgentApiError;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        if( returnStatus != MQTTAgentSuccess )
+        {
+            if( pAgent->wakeupDescriptors[ 0 ] >= 0 )
+            {
+                ( void ) close( pAgent->wakeupDescriptors[ 0 ] );
+                ( void ) close( pAgent->wakeupDescriptors[ 1 ] );
+            }
+
+            pAgent->wakeupDescriptors[ 0 ] = -1;
+            pAgent->wakeupDescriptors[ 1 ] = -1;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentStatus_t MQTTAgent_Run( MQTTAgentContext_t * pAgent )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    EventLoopEvent_t events[ MQTT_AGENT_EVENT_COUNT ];
+    size_t eventCount = 0U, index = 0U;
+    bool socketReadable = false;
+
+    if( ( pAgent == NULL ) || ( pAgent->wakeupDescriptors[ 0 ] < 0 ) )
+    {
+        LogError( ( "Invalid parameter: pAgent=%p.", ( void * ) pAgent ) );
+        returnStatus = MQTTAgentBadParameter;
+    }
+
+    while( ( returnStatus == MQTTAgentSuccess ) &&
+           ( __atomic_load_n( &pAgent->stopRequested, __ATOMIC_ACQUIRE ) == 0U ) )
+    {
+        /* Sleep until there is work: an incoming packet, a queued command,
+         * a keep-alive ping to send or an acknowledgement becoming overdue.
+         * An idle connection wakes only for its keep-alive pings. */
+        if( EventLoop_Wait( &pAgent->eventLoop,
+                            events,
+                            MQTT_AGENT_EVENT_COUNT,
+                            getWaitTimeMs( pAgent ),
+                            &eventCount ) != EVENT_LOOP_SUCCESS )
+        {
+            returnStatus = MQTTAgentApiError;
+            break;
+        }
+
+        /* Without events the wait reached a deadline, and the process loop
+         * runs to send a keep-alive ping or report an overdue PINGRESP. */
+        socketReadable = ( eventCount == 0U );
+
+        for( index = 0U; index < eventCount; index++ )
+        {
+            if( events[ index ].socketDescriptor == pAgent->wakeupDescriptors[ 0 ] )
+            {
+                clearWakeup( pAgent );
+            }
+            else
+            {
+                socketReadable = true;
+            }
+        }
+
+        /* Every command queued since the last wakeup is sent before the
+         * incoming packets are processed. */
+        mqttStatus = sendQueuedCommands( pAgent );
+
+        if( ( mqttStatus == MQTTSuccess ) && ( socketReadable == true ) )
+        {
+            mqttStatus = MQTT_ProcessLoop( &pAgent->mqttContext, 0U );
+
+            /* Acknowledgements may have freed pending slots for commands
+             * that are still queued. */
+            if( mqttStatus == MQTTSuccess )
+            {
+                checkOverdueAcks( pAgent );
+                mqttStatus = sendQueuedCommands( pAgent );
+            }
+        }
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "MQTT agent lost its connection: Status=%s.",
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = MQTTAgentDisconnected;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentStatus_t MQTTAgent_Stop( MQTTAgentContext_t * pAgent )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+
+    if( pAgent == NULL )
+    {
+        LogError( ( "Invalid parameter: pAgent=%p.", ( void * ) pAgent ) );
+        returnStatus = MQTTAgentBadParameter;
+    }
+    else
+    {
+        __atomic_store_n( &pAgent->stopRequested, 1U, __ATOMIC_RELEASE );
+        returnStatus = wakeAgent( pAgent );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentStatus_t MQTTAgent_Publish( MQTTAgentContext_t * pAgent,
+                                     const MQTTPublishInfo_t * pPublishInfo,
+                                     MQTTAgentCompletionCallback_t completionCallback,
+                                     void * pCallbackContext )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+    MQTTAgentCommand_t command;
+
+    if( ( pAgent == NULL ) || ( pPublishInfo == NULL ) )
+    {
+        LogError( ( "Invalid parameter: pAgent=%p, pPublishInfo=%p.",
+                    ( void * ) pAgent,
+                    ( const void * ) pPublishInfo ) );
+        returnStatus = MQTTAgentBadParameter;
+    }
+    else
+    {
+        ( void ) memset( &command, 0x00, sizeof( command ) );
+        command.type = MQTTAgentPublish;
+        command.pPublishInfo = pPublishInfo;
+        command.completionCallback = completionCallback;
+        command.pCallbackContext = pCallbackContext;
+
+        returnStatus = enqueueCommand( pAgent, &command );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentStatus_t MQTTAgent_Subscribe( MQTTAgentContext_t * pAgent,
+                                       const MQTTSubscribeInfo_t * pSubscriptionList,
+                                       size_t subscriptionCount,
+                                       MQTTAgentCompletionCallback_t completionCallback,
+                                       void * pCallbackContext )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+    MQTTAgentCommand_t command;
+
+    if( ( pAgent == NULL ) || ( pSubscriptionList == NULL ) || ( subscriptionCount == 0U ) )
+    {
+        LogError( ( "Invalid parameter: pAgent=%p, pSubscriptionList=%p, subscriptionCount=%lu.",
+                    ( void * ) pAgent,
+                    ( const void * ) pSubscriptionList,
+                    ( unsigned long ) subscriptionCount ) );
+        returnStatus = MQTTAgentBadParameter;
+    }
+    else
+    {
+        ( void ) memset( &command, 0x00, sizeof( command ) );
+        command.type = MQTTAgentSubscribe;
+        command.pSubscriptionList = pSubscriptionList;
+        command.subscriptionCount = subscriptionCount;
+        command.completionCallback = completionCallback;
+        command.pCallbackContext = pCallbackContext;
+
+        returnStatus = enqueueCommand( pAgent, &command );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentStatus_t MQTTAgent_Unsubscribe( MQTTAgentContext_t * pAgent,
+                                         const MQTTSubscribeInfo_t * pSubscriptionList,
+                                         size_t subscriptionCount,
+                                         MQTTAgentCompletionCallback_t completionCallback,
+                                         void * pCallbackContext )
+{
+    MQTTAgentStatus_t returnStatus = MQTTAgentSuccess;
+    MQTTAgentCommand_t command;
+
+    if( ( pAgent == NULL ) || ( pSubscriptionList == NULL ) || ( subscriptionCount == 0U ) )
+    {
+        LogError( ( "Invalid parameter: pAgent=%p, pSubscriptionList=%p, subscriptionCount=%lu.",
+                    ( void * ) pAgent,
+                    ( const void * ) pSubscriptionList,
+                    ( unsigned long ) subscriptionCount ) );
+        returnStatus = MQTTAgentBadParameter;
+    }
+    else
+    {
+        ( void ) memset( &command, 0x00, sizeof( command ) );
+        command.type = MQTTAgentUnsubscribe;
+        command.pSubscriptionList = pSubscriptionList;
+        command.subscriptionCount = subscriptionCount;
+        command.completionCallback = completionCallback;
+        command.pCallbackContext = pCallbackContext;
+
+        returnStatus = enqueueCommand( pAgent, &command );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTAgent_Deinit( MQTTAgentContext_t * pAgent )
+{
+    MQTTAgentCommand_t command;
+    size_t index = 0U;
+
+    if( ( pAgent != NULL ) && ( pAgent->wakeupDescriptors[ 0 ] >= 0 ) )
+    {
+        for( index = 0U; index < MQTT_AGENT_MAX_PENDING_ACKS; index++ )
+        {
+            if( pAgent->pendingAcks[ index ].packetIdentifier != 0U )
+            {
+                completePendingAck( pAgent,
+                                    pAgent->pendingAcks[ index ].packetIdentifier,
+                                    MQTTAgentCancelled );
+            }
+        }
+
+        while( dequeueCommand( pAgent, &command ) == true )
+        {
+            completeCommand( &command, MQTTAgentCancelled );
+        }
+
+        ( void ) EventLoop_Deinit( &pAgent->eventLoop );
+        ( void ) close( pAgent->wakeupDescriptors[ 0 ] );
+        ( void ) close( pAgent->wakeupDescriptors[ 1 ] );
+        pAgent->wakeupDescriptors[ 0 ] = -1;
+        pAgent->wakeupDescriptors[ 1 ] = -1;
+    }
+}
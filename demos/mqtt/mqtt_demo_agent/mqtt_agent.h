@@ -0,0 +1,309 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_agent.h
+ * @brief An agent that lets any number of threads share one MQTT connection.
+ *
+ * One thread owns the MQTT context and runs #MQTTAgent_Run. Every other
+ * thread publishes, subscribes and unsubscribes by queuing commands with
+ * #MQTTAgent_Publish, #MQTTAgent_Subscribe and #MQTTAgent_Unsubscribe, which
+ * never block and never take a lock. The agent thread sends all the commands
+ * queued since it last woke before it processes incoming packets again, and
+ * reports the outcome of each command to its completion callback.
+ *
+ * The number of QoS 1 and QoS 2 publishes waiting for their acknowledgement
+ * is limited by an adaptive window from flow_control.h. While the window is
+ * full, commands stay queued, and producers that fill the queue are told so
+ * with #MQTTAgentQueueFull rather than having their messages dropped.
+ */
+
+#ifndef MQTT_AGENT_H_
+#define MQTT_AGENT_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* Event loop for waiting on the connection and the wakeups of the agent. */
+#include "event_loop_posix.h"
+
+/* Adaptive window of in-flight publishes. */
+#include "flow_control.h"
+
+/**
+ * @brief Number of commands that can be queued for the agent. It must be a
+ * power of two.
+ */
+#ifndef MQTT_AGENT_QUEUE_LENGTH
+    #define MQTT_AGENT_QUEUE_LENGTH    ( 32U )
+#endif
+
+/**
+ * @brief Number of commands that can wait for an acknowledgement from the
+ * broker at a time. QoS 1 and QoS 2 publishes also use an outgoing publish
+ * record of the MQTT context, so this is the same as the number of records.
+ */
+#define MQTT_AGENT_MAX_PENDING_ACKS    MQTT_STATE_ARRAY_MAX_COUNT
+
+/**
+ * @brief Number of QoS 1 and QoS 2 publishes that may wait for an
+ * acknowledgement before the first acknowledgement is received.
+ */
+#ifndef MQTT_AGENT_INITIAL_WINDOW
+    #define MQTT_AGENT_INITIAL_WINDOW    ( 2U )
+#endif
+
+/**
+ * @brief Return and completion status of the agent.
+ */
+typedef enum MQTTAgentStatus
+{
+    MQTTAgentSuccess = 0,    /**< The function or command completed successfully. */
+    MQTTAgentBadParameter,   /**< At least one parameter was invalid. */
+    MQTTAgentQueueFull,      /**< The command queue is full; try again later. */
+    MQTTAgentSendFailed,     /**< The MQTT library failed to send the command. */
+    MQTTAgentRejected,       /**< The broker rejected at least one subscription. */
+    MQTTAgentCancelled,      /**< The agent stopped before the command completed. */
+    MQTTAgentDisconnected,   /**< The connection was lost while running the agent. */
+    MQTTAgentApiError        /**< A call to a system API resulted in an internal error. */
+} MQTTAgentStatus_t;
+
+/**
+ * @brief Type of a queued command.
+ */
+typedef enum MQTTAgentCommandType
+{
+    MQTTAgentPublish = 0, /**< Send a PUBLISH. */
+    MQTTAgentSubscribe,   /**< Send a SUBSCRIBE. */
+    MQTTAgentUnsubscribe  /**< Send an UNSUBSCRIBE. */
+} MQTTAgentCommandType_t;
+
+/**
+ * @brief Callback invoked on the agent thread when a command completes.
+ *
+ * A QoS 0 publish completes when it is sent, a QoS 1 publish when its PUBACK
+ * is received, a QoS 2 publish when its PUBCOMP is received, and a subscribe
+ * or unsubscribe when its SUBACK or UNSUBACK is received.
+ *
+ * @param[in] pCallbackContext The context given with the command.
+ * @param[in] status #MQTTAgentSuccess, #MQTTAgentSendFailed,
+ * #MQTTAgentRejected or #MQTTAgentCancelled.
+ */
+typedef void ( * MQTTAgentCompletionCallback_t )( void * pCallbackContext,
+                                                  MQTTAgentStatus_t status );
+
+/**
+ * @brief Callback invoked on the agent thread for every incoming PUBLISH.
+ *
+ * @param[in] pCallbackContext The context given to #MQTTAgent_Init.
+ * @param[in] pPublishInfo The incoming PUBLISH. It is only valid during the
+ * callback.
+ */
+typedef void ( * MQTTAgentIncomingPublishCallback_t )( void * pCallbackContext,
+                                                       MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief A command for the agent.
+ *
+ * The publish information, the payload and the subscription list are not
+ * copied, and must remain valid until the command completes.
+ */
+typedef struct MQTTAgentCommand
+{
+    MQTTAgentCommandType_t type;                      /**< @brief Type of the command. */
+    const MQTTPublishInfo_t * pPublishInfo;           /**< @brief Publish to send for #MQTTAgentPublish. */
+    const MQTTSubscribeInfo_t * pSubscriptionList;    /**< @brief Topic filters for #MQTTAgentSubscribe and #MQTTAgentUnsubscribe. */
+    size_t subscriptionCount;                         /**< @brief Number of topic filters in pSubscriptionList. */
+    MQTTAgentCompletionCallback_t completionCallback; /**< @brief Callback invoked on completion; may be NULL. */
+    void * pCallbackContext;                          /**< @brief Context passed to completionCallback. */
+} MQTTAgentCommand_t;
+
+/**
+ * @brief A slot of the command queue.
+ */
+typedef struct MQTTAgentQueueSlot
+{
+    uint32_t sequence;          /**< @brief Queue position for which the slot can be written or read. */
+    MQTTAgentCommand_t command; /**< @brief The queued command. */
+} MQTTAgentQueueSlot_t;
+
+/**
+ * @brief A command waiting for an acknowledgement from the broker.
+ */
+typedef struct MQTTAgentPendingAck
+{
+    uint16_t packetIdentifier;  /**< @brief Packet identifier of the command, or 0 for an unused slot. */
+    MQTTAgentCommand_t command; /**< @brief The command. */
+    uint64_t sentTimeUs;        /**< @brief Time the command was sent. */
+    bool overdue;               /**< @brief Whether the acknowledgement was reported to flow control as overdue. */
+} MQTTAgentPendingAck_t;
+
+/**
+ * @brief The agent object.
+ *
+ * @note The MQTT context is the first member, so that the agent can be found
+ * from the context given to the event callback. Only the agent thread may use
+ * the MQTT context once #MQTTAgent_Run has started. The other members are
+ * private to the agent.
+ */
+typedef struct MQTTAgentContext
+{
+    MQTTContext_t mqttContext;                                        /**< @brief The MQTT context owned by the agent thread. */
+    int32_t socketDescriptor;                                         /**< @brief Socket of the MQTT connection. */
+    int32_t wakeupDescriptors[ 2 ];                                   /**< @brief Pipe written by producers to wake the agent. */
+    EventLoop_t eventLoop;                                            /**< @brief Waits on the socket and the wakeup pipe. */
+    MQTTAgentQueueSlot_t queue[ MQTT_AGENT_QUEUE_LENGTH ];            /**< @brief Bounded multi-producer, single-consumer command queue. */
+    uint32_t enqueuePosition;                                         /**< @brief Next queue position to write; shared by the producers. */
+    uint32_t dequeuePosition;                                         /**< @brief Next queue position to read; used only by the agent thread. */
+    uint32_t wakeupPending;                                           /**< @brief Non-zero while a wakeup is written but not yet handled. */
+    uint32_t stopRequested;                                           /**< @brief Non-zero once #MQTTAgent_Stop is called. */
+    MQTTAgentPendingAck_t pendingAcks[ MQTT_AGENT_MAX_PENDING_ACKS ]; /**< @brief Commands waiting for an acknowledgement. */
+    size_t pendingAckCount;                                           /**< @brief Number of slots in use in pendingAcks. */
+    FlowControl_t flowControl;                                        /**< @brief Window of the publishes waiting for an acknowledgement. */
+    MQTTAgentIncomingPublishCallback_t incomingPublishCallback;       /**< @brief Callback for incoming publishes; may be NULL. */
+    void * pIncomingPublishContext;                                   /**< @brief Context passed to incomingPublishCallback. */
+} MQTTAgentContext_t;
+
+/**
+ * @brief Initialize an agent and its MQTT context.
+ *
+ * The MQTT context is initialized with #MQTT_Init and an event callback of
+ * the agent. The application then calls #MQTT_Connect on the MQTT context of
+ * the agent before it starts #MQTTAgent_Run.
+ *
+ * @param[out] pAgent The agent to initialize.
+ * @param[in] pTransport Transport interface of the connection.
+ * @param[in] socketDescriptor Socket of the connection, which the agent waits
+ * on for incoming packets.
+ * @param[in] getTimeFunction Function that returns the current time in
+ * milliseconds.
+ * @param[in] pNetworkBuffer Buffer for the MQTT context.
+ * @param[in] incomingPublishCallback Callback for incoming publishes; may be NULL.
+ * @param[in] pIncomingPublishContext Context passed to @p incomingPublishCallback.
+ *
+ * @return #MQTTAgentSuccess if successful; #MQTTAgentBadParameter or
+ * #MQTTAgentApiError on error.
+ */
+MQTTAgentStatus_t MQTTAgent_Init( MQTTAgentContext_t * pAgent,
+                                  const TransportInterface_t * pTransport,
+                                  int32_t socketDescriptor,
+                                  MQTTGetCurrentTimeFunc_t getTimeFunction,
+                                  const MQTTFixedBuffer_t * pNetworkBuffer,
+                                  MQTTAgentIncomingPublishCallback_t incomingPublishCallback,
+                                  void * pIncomingPublishContext );
+
+/**
+ * @brief Run the agent on the calling thread until #MQTTAgent_Stop is called
+ * or the connection is lost.
+ *
+ * @param[in] pAgent The agent.
+ *
+ * @return #MQTTAgentSuccess when stopped; #MQTTAgentDisconnected if the
+ * connection was lost; #MQTTAgentBadParameter or #MQTTAgentApiError on error.
+ */
+MQTTAgentStatus_t MQTTAgent_Run( MQTTAgentContext_t * pAgent );
+
+/**
+ * @brief Ask the agent to return from #MQTTAgent_Run. It can be called from
+ * any thread.
+ *
+ * @param[in] pAgent The agent.
+ *
+ * @return #MQTTAgentSuccess if successful; #MQTTAgentBadParameter or
+ * #MQTTAgentApiError on error.
+ */
+MQTTAgentStatus_t MQTTAgent_Stop( MQTTAgentContext_t * pAgent );
+
+/**
+ * @brief Queue a publish. It can be called from any thread.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pPublishInfo The publish. It and its payload must remain valid
+ * until the completion callback is invoked.
+ * @param[in] completionCallback Callback invoked when the publish completes;
+ * may be NULL.
+ * @param[in] pCallbackContext Context passed to @p completionCallback.
+ *
+ * @return #MQTTAgentSuccess if queued; #MQTTAgentQueueFull,
+ * #MQTTAgentBadParameter or #MQTTAgentApiError otherwise.
+ */
+MQTTAgentStatus_t MQTTAgent_Publish( MQTTAgentContext_t * pAgent,
+                                     const MQTTPublishInfo_t * pPublishInfo,
+                                     MQTTAgentCompletionCallback_t completionCallback,
+                                     void * pCallbackContext );
+
+/**
+ * @brief Queue a subscribe. It can be called from any thread.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pSubscriptionList Topic filters to subscribe to. They must
+ * remain valid until the completion callback is invoked.
+ * @param[in] subscriptionCount Number of topic filters.
+ * @param[in] completionCallback Callback invoked when the SUBACK is received;
+ * may be NULL.
+ * @param[in] pCallbackContext Context passed to @p completionCallback.
+ *
+ * @return #MQTTAgentSuccess if queued; #MQTTAgentQueueFull,
+ * #MQTTAgentBadParameter or #MQTTAgentApiError otherwise.
+ */
+MQTTAgentStatus_t MQTTAgent_Subscribe( MQTTAgentContext_t * pAgent,
+                                       const MQTTSubscribeInfo_t * pSubscriptionList,
+                                       size_t subscriptionCount,
+                                       MQTTAgentCompletionCallback_t completionCallback,
+                                       void * pCallbackContext );
+
+/**
+ * @brief Queue an unsubscribe. It can be called from any thread.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pSubscriptionList Topic filters to unsubscribe from. They must
+ * remain valid until the completion callback is invoked.
+ * @param[in] subscriptionCount Number of topic filters.
+ * @param[in] completionCallback Callback invoked when the UNSUBACK is
+ * received; may be NULL.
+ * @param[in] pCallbackContext Context passed to @p completionCallback.
+ *
+ * @return #MQTTAgentSuccess if queued; #MQTTAgentQueueFull,
+ * #MQTTAgentBadParameter or #MQTTAgentApiError otherwise.
+ */
+MQTTAgentStatus_t MQTTAgent_Unsubscribe( MQTTAgentContext_t * pAgent,
+                                         const MQTTSubscribeInfo_t * pSubscriptionList,
+                                         size_t subscriptionCount,
+                                         MQTTAgentCompletionCallback_t completionCallback,
+                                         void * pCallbackContext );
+
+/**
+ * @brief Release the resources of an agent. The commands that have not
+ * completed are completed with #MQTTAgentCancelled.
+ *
+ * It must be called after #MQTTAgent_Run has returned, and after every
+ * producer has stopped queuing commands. The MQTT connection is not closed.
+ *
+ * @param[in] pAgent The agent.
+ */
+void MQTTAgent_Deinit( MQTTAgentContext_t * pAgent );
+
+#endif /* ifndef MQTT_AGENT_H_ */
@@ -0,0 +1,773 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Demo for showing how several threads can share one MQTT connection
+ * through the MQTT agent in mqtt_agent.h.
+ *
+ * The main thread connects to the broker over plaintext TCP, as in the
+ * plaintext demo, and hands the MQTT context to an agent thread. It then
+ * subscribes to a topic through the agent and starts a number of publisher
+ * threads, which publish to the topic at QoS 1 without waiting for each
+ * other or for the agent. Each publish completes on the agent thread when
+ * its PUBACK is received, and the echoes of the publishes are counted as
+ * incoming publishes. Finally the main thread unsubscribes, stops the agent
+ * and disconnects.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* MQTT agent header. */
+#include "mqtt_agent.h"
+
+/* Plaintext sockets transport implementation. */
+#include "plaintext_posix.h"
+
+/* Retry parameters. */
+#include "retry_utils.h"
+
+/* Clock for timer. */
+#include "clock.h"
+
+/**
+ * These configuration settings are required to run the agent demo.
+ * Throw compilation error if the below configs are not defined.
+ */
+#ifndef BROKER_ENDPOINT
+    #error "Please define an MQTT broker endpoint, BROKER_ENDPOINT, in demo_config.h."
+#endif
+#ifndef CLIENT_IDENTIFIER
+    #error "Please define a unique CLIENT_IDENTIFIER in demo_config.h."
+#endif
+
+/**
+ * Provide default values for undefined configuration settings.
+ */
+#ifndef BROKER_PORT
+    #define BROKER_PORT    ( 1883 )
+#endif
+
+#ifndef NETWORK_BUFFER_SIZE
+    #define NETWORK_BUFFER_SIZE    ( 1024U )
+#endif
+
+#ifndef DEMO_PUBLISHER_THREAD_COUNT
+    #define DEMO_PUBLISHER_THREAD_COUNT    ( 4U )
+#endif
+
+#ifndef DEMO_PUBLISH_COUNT_PER_THREAD
+    #define DEMO_PUBLISH_COUNT_PER_THREAD    ( 100U )
+#endif
+
+/**
+ * @brief Length of client identifier.
+ */
+#define CLIENT_IDENTIFIER_LENGTH            ( ( uint16_t ) ( sizeof( CLIENT_IDENTIFIER ) - 1 ) )
+
+/**
+ * @brief Length of MQTT server host name.
+ */
+#define BROKER_ENDPOINT_LENGTH              ( ( uint16_t ) ( sizeof( BROKER_ENDPOINT ) - 1 ) )
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milli seconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS             ( 1000U )
+
+/**
+ * @brief The topic the publisher threads publish to and the demo subscribes to.
+ */
+#define MQTT_EXAMPLE_TOPIC                  CLIENT_IDENTIFIER "/example/agent"
+
+/**
+ * @brief Length of the topic.
+ */
+#define MQTT_EXAMPLE_TOPIC_LENGTH           ( ( uint16_t ) ( sizeof( MQTT_EXAMPLE_TOPIC ) - 1 ) )
+
+/**
+ * @brief Size of the buffer for the payload of a publish.
+ */
+#define DEMO_PAYLOAD_BUFFER_SIZE            ( 32U )
+
+/**
+ * @brief The maximum time interval in seconds which is allowed to elapse
+ * between two Control Packets. The agent sends a PINGREQ when it is idle
+ * for this long.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS    ( 60U )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ *
+ * The agent only receives once the socket is readable, so this only bounds
+ * the wait for the rest of a packet that has partly arrived.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS      ( 20 )
+
+/**
+ * @brief Timeout in milliseconds for establishing the TCP connection to the
+ * broker.
+ */
+#define TRANSPORT_CONNECT_TIMEOUT_MS        ( 2000U )
+
+/**
+ * @brief Time in milliseconds a publisher thread waits before it retries a
+ * publish that found the command queue full.
+ */
+#define QUEUE_FULL_RETRY_DELAY_MS           ( 1U )
+
+/**
+ * @brief Longest time in milliseconds to wait for commands to complete.
+ */
+#define COMMAND_COMPLETION_TIMEOUT_MS       ( 10000U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Completion of a command that a thread waits for.
+ */
+typedef struct DemoCompletion
+{
+    pthread_mutex_t mutex;    /**< @brief Protects the other members. */
+    pthread_cond_t condition; /**< @brief Signalled when the command completes. */
+    bool completed;           /**< @brief Whether the command has completed. */
+    MQTTAgentStatus_t status; /**< @brief Status the command completed with. */
+} DemoCompletion_t;
+
+/**
+ * @brief A thread that publishes through the agent.
+ *
+ * Each publish has its own publish information and payload, because they
+ * must remain valid until the publish completes.
+ */
+typedef struct PublisherThread
+{
+    pthread_t thread;                                                           /**< @brief The thread. */
+    uint32_t threadIndex;                                                       /**< @brief Index of the thread, included in the payloads. */
+    MQTTPublishInfo_t publishInfo[ DEMO_PUBLISH_COUNT_PER_THREAD ];             /**< @brief The publishes of the thread. */
+    char payloads[ DEMO_PUBLISH_COUNT_PER_THREAD ][ DEMO_PAYLOAD_BUFFER_SIZE ]; /**< @brief The payloads of the publishes. */
+    bool started;                                                               /**< @brief Whether the thread was created. */
+} PublisherThread_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The network buffer must remain valid for the lifetime of the MQTT context.
+ */
+static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
+
+/**
+ * @brief The agent that owns the MQTT context.
+ */
+static MQTTAgentContext_t agent;
+
+/**
+ * @brief The publisher threads.
+ */
+static PublisherThread_t publishers[ DEMO_PUBLISHER_THREAD_COUNT ];
+
+/**
+ * @brief The topic the demo subscribes to.
+ */
+static MQTTSubscribeInfo_t subscription;
+
+/**
+ * @brief Number of publishes that completed successfully. It is updated on
+ * the agent thread and read by the main thread.
+ */
+static uint32_t publishSuccessCount = 0U;
+
+/**
+ * @brief Number of publishes that failed.
+ */
+static uint32_t publishFailureCount = 0U;
+
+/**
+ * @brief Number of incoming publishes. It is only used on the agent thread.
+ */
+static uint32_t incomingPublishCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect to MQTT broker with reconnection retries.
+ *
+ * If connection fails, retry is attempted after a timeout.
+ * Timeout value will exponentially increased till maximum
+ * timeout value is reached or the number of attempts are exhausted.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on successful connection.
+ */
+static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Send CONNECT on the MQTT context of the agent and wait for CONNACK.
+ *
+ * @return EXIT_SUCCESS if an MQTT session is established;
+ * EXIT_FAILURE otherwise.
+ */
+static int establishMqttSession( void );
+
+/**
+ * @brief Completion callback that signals a #DemoCompletion_t.
+ *
+ * @param[in] pCallbackContext The #DemoCompletion_t.
+ * @param[in] status Status the command completed with.
+ */
+static void signalCompletion( void * pCallbackContext,
+                              MQTTAgentStatus_t status );
+
+/**
+ * @brief Wait for a #DemoCompletion_t to be signalled.
+ *
+ * @param[in] pCompletion The completion.
+ *
+ * @return Status the command completed with.
+ */
+static MQTTAgentStatus_t waitForCompletion( DemoCompletion_t * pCompletion );
+
+/**
+ * @brief Completion callback of the publishes.
+ *
+ * @param[in] pCallbackContext Unused.
+ * @param[in] status Status the publish completed with.
+ */
+static void publishCompleted( void * pCallbackContext,
+                              MQTTAgentStatus_t status );
+
+/**
+ * @brief Callback of the agent for incoming publishes.
+ *
+ * @param[in] pCallbackContext Unused.
+ * @param[in] pPublishInfo The incoming publish.
+ */
+static void handleIncomingPublish( void * pCallbackContext,
+                                   MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Entry point of the agent thread.
+ *
+ * @param[in] pArgument Unused.
+ *
+ * @return NULL.
+ */
+static void * runAgent( void * pArgument );
+
+/**
+ * @brief Entry point of a publisher thread.
+ *
+ * @param[in] pArgument The #PublisherThread_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * runPublisher( void * pArgument );
+
+/**
+ * @brief Subscribe, publish from several threads, and unsubscribe through
+ * the running agent.
+ *
+ * @return EXIT_SUCCESS if every command succeeded; EXIT_FAILURE otherwise.
+ */
+static int publishFromThreads( void );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The number of reconnect attempts that may start at once.
+ */
+#define RECONNECT_BUDGET_CAPACITY       ( 4U )
+
+/**
+ * @brief The interval in milliseconds at which the reconnect budget gains
+ * back one attempt.
+ */
+#define RECONNECT_BUDGET_REFILL_MS      ( 1000U )
+
+/**
+ * @brief The number of connection attempts that may be in progress at once.
+ */
+#define RECONNECT_BUDGET_MAX_IN_PROGRESS    ( 1U )
+
+/**
+ * @brief The retry budget that the connection attempts of the process draw
+ * from, so that they are spread over time after an outage.
+ */
+static RetryUtilsBudget_t reconnectBudget = RETRY_UTILS_BUDGET_INITIALIZER( RECONNECT_BUDGET_CAPACITY,
+                                                                            RECONNECT_BUDGET_REFILL_MS,
+                                                                            RECONNECT_BUDGET_MAX_IN_PROGRESS );
+
+static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext )
+{
+    int returnStatus = EXIT_SUCCESS;
+    RetryUtilsStatus_t retryUtilsStatus = RetryUtilsSuccess;
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    RetryUtilsParams_t reconnectParams;
+    ServerInfo_t serverInfo;
+    SocketsConfig_t socketsConfig;
+
+    /* Initialize information to connect to the MQTT broker. */
+    serverInfo.pHostName = BROKER_ENDPOINT;
+    serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
+    serverInfo.port = BROKER_PORT;
+
+    /* Initialize the timeouts of the connection. */
+    ( void ) memset( &socketsConfig, 0x00, sizeof( socketsConfig ) );
+    socketsConfig.sendTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    socketsConfig.recvTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    socketsConfig.connectTimeoutMs = TRANSPORT_CONNECT_TIMEOUT_MS;
+
+    /* Initialize reconnect attempts and interval */
+    RetryUtils_ParamsReset( &reconnectParams );
+
+    /* Take the first attempt from the reconnect budget. The attempts that
+     * fail are released, and the retries taken, by RetryUtils_BackoffAndSleep. */
+    reconnectParams.pBudget = &reconnectBudget;
+    ( void ) RetryUtils_BudgetAcquireAndSleep( reconnectParams.pBudget );
+
+    /* Attempt to connect to MQTT broker. If connection fails, retry after
+     * a timeout. Timeout value will exponentially increase till maximum
+     * attempts are reached.
+     */
+    do
+    {
+        LogInfo( ( "Creating a TCP connection to %.*s:%d.",
+                   BROKER_ENDPOINT_LENGTH,
+                   BROKER_ENDPOINT,
+                   BROKER_PORT ) );
+        socketStatus = Plaintext_ConnectWithConfig( pNetworkContext,
+                                                    &serverInfo,
+                                                    &socketsConfig );
+
+        if( socketStatus != SOCKETS_SUCCESS )
+        {
+            LogWarn( ( "Connection to the broker failed. Retrying connection with backoff and jitter." ) );
+            retryUtilsStatus = RetryUtils_BackoffAndSleep( &reconnectParams );
+        }
+
+        if( retryUtilsStatus == RetryUtilsRetriesExhausted )
+        {
+            LogError( ( "Connection to the broker failed, all attempts exhausted." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    } while( ( socketStatus != SOCKETS_SUCCESS ) && ( retryUtilsStatus == RetryUtilsSuccess ) );
+
+    /* The attempt that succeeded is complete. */
+    if( socketStatus == SOCKETS_SUCCESS )
+    {
+        ( void ) RetryUtils_BudgetRelease( &reconnectBudget );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int establishMqttSession( void )
+{
+    int returnStatus = EXIT_SUCCESS;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTConnectInfo_t connectInfo;
+    bool sessionPresent = false;
+
+    ( void ) memset( &connectInfo, 0x00, sizeof( connectInfo ) );
+
+    /* Start with a clean session, so that no acknowledgements of an earlier
+     * session arrive without a pending command of the agent. */
+    connectInfo.cleanSession = true;
+    connectInfo.pClientIdentifier = CLIENT_IDENTIFIER;
+    connectInfo.clientIdentifierLength = CLIENT_IDENTIFIER_LENGTH;
+    connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+
+    /* The agent thread is not running yet, so this thread may use the MQTT
+     * context of the agent. */
+    mqttStatus = MQTT_Connect( &agent.mqttContext,
+                               &connectInfo,
+                               NULL,
+                               CONNACK_RECV_TIMEOUT_MS,
+                               &sessionPresent );
+
+    if( mqttStatus != MQTTSuccess )
+    {
+        LogError( ( "Connection with MQTT broker failed with status %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        LogInfo( ( "MQTT connection successfully established with broker.\n\n" ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void signalCompletion( void * pCallbackContext,
+                              MQTTAgentStatus_t status )
+{
+    DemoCompletion_t * pCompletion = ( DemoCompletion_t * ) pCallbackContext;
+
+    ( void ) pthread_mutex_lock( &pCompletion->mutex );
+    pCompletion->completed = true;
+    pCompletion->status = status;
+    ( void ) pthread_cond_signal( &pCompletion->condition );
+    ( void ) pthread_mutex_unlock( &pCompletion->mutex );
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentStatus_t waitForCompletion( DemoCompletion_t * pCompletion )
+{
+    MQTTAgentStatus_t status = MQTTAgentSuccess;
+
+    ( void ) pthread_mutex_lock( &pCompletion->mutex );
+
+    while( pCompletion->completed == false )
+    {
+        ( void ) pthread_cond_wait( &pCompletion->condition, &pCompletion->mutex );
+    }
+
+    status = pCompletion->status;
+    pCompletion->completed = false;
+    ( void ) pthread_mutex_unlock( &pCompletion->mutex );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void publishCompleted( void * pCallbackContext,
+                              MQTTAgentStatus_t status )
+{
+    ( void ) pCallbackContext;
+
+    if( status == MQTTAgentSuccess )
+    {
+        ( void ) __atomic_add_fetch( &publishSuccessCount, 1U, __ATOMIC_RELEASE );
+    }
+    else
+    {
+        ( void ) __atomic_add_fetch( &publishFailureCount, 1U, __ATOMIC_RELEASE );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void handleIncomingPublish( void * pCallbackContext,
+                                   MQTTPublishInfo_t * pPublishInfo )
+{
+    assert( pPublishInfo != NULL );
+
+    ( void ) pCallbackContext;
+
+    incomingPublishCount++;
+
+    LogDebug( ( "Incoming publish on %.*s: %.*s.",
+                pPublishInfo->topicNameLength,
+                pPublishInfo->pTopicName,
+                ( int ) pPublishInfo->payloadLength,
+                ( const char * ) pPublishInfo->pPayload ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * runAgent( void * pArgument )
+{
+    MQTTAgentStatus_t agentStatus = MQTTAgentSuccess;
+
+    ( void ) pArgument;
+
+    agentStatus = MQTTAgent_Run( &agent );
+
+    if( agentStatus != MQTTAgentSuccess )
+    {
+        LogError( ( "MQTT agent stopped with status %d.", ( int ) agentStatus ) );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * runPublisher( void * pArgument )
+{
+    PublisherThread_t * pPublisher = ( PublisherThread_t * ) pArgument;
+    MQTTAgentStatus_t agentStatus = MQTTAgentSuccess;
+    uint32_t index = 0U;
+    int payloadLength = 0;
+
+    for( index = 0U; index < DEMO_PUBLISH_COUNT_PER_THREAD; index++ )
+    {
+        payloadLength = snprintf( pPublisher->payloads[ index ],
+                                  DEMO_PAYLOAD_BUFFER_SIZE,
+                                  "Thread %u message %u",
+                                  ( unsigned int ) pPublisher->threadIndex,
+                                  ( unsigned int ) index );
+
+        ( void ) memset( &pPublisher->publishInfo[ index ], 0x00, sizeof( MQTTPublishInfo_t ) );
+        pPublisher->publishInfo[ index ].qos = MQTTQoS1;
+        pPublisher->publishInfo[ index ].pTopicName = MQTT_EXAMPLE_TOPIC;
+        pPublisher->publishInfo[ index ].topicNameLength = MQTT_EXAMPLE_TOPIC_LENGTH;
+        pPublisher->publishInfo[ index ].pPayload = pPublisher->payloads[ index ];
+        pPublisher->publishInfo[ index ].payloadLength = ( size_t ) payloadLength;
+
+        /* Queuing never blocks. When the agent is behind, wait briefly and
+         * try again rather than dropping the message. */
+        do
+        {
+            agentStatus = MQTTAgent_Publish( &agent,
+                                             &pPublisher->publishInfo[ index ],
+                                             publishCompleted,
+                                             NULL );
+
+            if( agentStatus == MQTTAgentQueueFull )
+            {
+                Clock_SleepMs( QUEUE_FULL_RETRY_DELAY_MS );
+            }
+        } while( agentStatus == MQTTAgentQueueFull );
+
+        if( agentStatus != MQTTAgentSuccess )
+        {
+            LogError( ( "Publisher thread %u failed to queue a publish.",
+                        ( unsigned int ) pPublisher->threadIndex ) );
+            ( void ) __atomic_add_fetch( &publishFailureCount, 1U, __ATOMIC_RELEASE );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static int publishFromThreads( void )
+{
+    int returnStatus = EXIT_SUCCESS;
+    DemoCompletion_t completion;
+    uint32_t index = 0U, completedCount = 0U;
+    uint32_t publishCount = DEMO_PUBLISHER_THREAD_COUNT * DEMO_PUBLISH_COUNT_PER_THREAD;
+    uint32_t entryTimeMs = 0U;
+
+    ( void ) memset( &completion, 0x00, sizeof( completion ) );
+    ( void ) pthread_mutex_init( &completion.mutex, NULL );
+    ( void ) pthread_cond_init( &completion.condition, NULL );
+
+    ( void ) memset( &subscription, 0x00, sizeof( subscription ) );
+    subscription.qos = MQTTQoS1;
+    subscription.pTopicFilter = MQTT_EXAMPLE_TOPIC;
+    subscription.topicFilterLength = MQTT_EXAMPLE_TOPIC_LENGTH;
+
+    if( ( MQTTAgent_Subscribe( &agent, &subscription, 1U, signalCompletion, &completion ) != MQTTAgentSuccess ) ||
+        ( waitForCompletion( &completion ) != MQTTAgentSuccess ) )
+    {
+        LogError( ( "Failed to subscribe to %.*s.",
+                    MQTT_EXAMPLE_TOPIC_LENGTH,
+                    MQTT_EXAMPLE_TOPIC ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        LogInfo( ( "Subscribed to %.*s through the agent.",
+                   MQTT_EXAMPLE_TOPIC_LENGTH,
+                   MQTT_EXAMPLE_TOPIC ) );
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        for( index = 0U; index < DEMO_PUBLISHER_THREAD_COUNT; index++ )
+        {
+            publishers[ index ].threadIndex = index;
+            publishers[ index ].started =
+                ( pthread_create( &publishers[ index ].thread, NULL, runPublisher, &publishers[ index ] ) == 0 );
+
+            if( publishers[ index ].started == false )
+            {
+                LogError( ( "Failed to start publisher thread %u.", ( unsigned int ) index ) );
+                publishCount -= DEMO_PUBLISH_COUNT_PER_THREAD;
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+
+        for( index = 0U; index < DEMO_PUBLISHER_THREAD_COUNT; index++ )
+        {
+            if( publishers[ index ].started == true )
+            {
+                ( void ) pthread_join( publishers[ index ].thread, NULL );
+            }
+        }
+
+        /* Every publish has been queued, but some may still wait for their
+         * PUBACK. */
+        entryTimeMs = Clock_GetTimeMs();
+
+        do
+        {
+            completedCount = __atomic_load_n( &publishSuccessCount, __ATOMIC_ACQUIRE ) +
+                             __atomic_load_n( &publishFailureCount, __ATOMIC_ACQUIRE );
+
+            if( completedCount < publishCount )
+            {
+                Clock_SleepMs( QUEUE_FULL_RETRY_DELAY_MS );
+            }
+        } while( ( completedCount < publishCount ) &&
+                 ( ( Clock_GetTimeMs() - entryTimeMs ) < COMMAND_COMPLETION_TIMEOUT_MS ) );
+
+        LogInfo( ( "%u threads published %u messages through the agent: %u acknowledged, %u failed.",
+                   ( unsigned int ) DEMO_PUBLISHER_THREAD_COUNT,
+                   ( unsigned int ) publishCount,
+                   ( unsigned int ) __atomic_load_n( &publishSuccessCount, __ATOMIC_ACQUIRE ),
+                   ( unsigned int ) __atomic_load_n( &publishFailureCount, __ATOMIC_ACQUIRE ) ) );
+
+        if( __atomic_load_n( &publishSuccessCount, __ATOMIC_ACQUIRE ) != publishCount )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+
+        if( ( MQTTAgent_Unsubscribe( &agent, &subscription, 1U, signalCompletion, &completion ) != MQTTAgentSuccess ) ||
+            ( waitForCompletion( &completion ) != MQTTAgentSuccess ) )
+        {
+            LogError( ( "Failed to unsubscribe from %.*s.",
+                        MQTT_EXAMPLE_TOPIC_LENGTH,
+                        MQTT_EXAMPLE_TOPIC ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    ( void ) pthread_cond_destroy( &completion.condition );
+    ( void ) pthread_mutex_destroy( &completion.mutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry point of demo.
+ *
+ * The example shown below connects to the broker, starts the agent thread,
+ * publishes from several threads through the agent, and then stops the
+ * agent and disconnects.
+ */
+int main( int argc,
+          char ** argv )
+{
+    int returnStatus = EXIT_SUCCESS;
+    NetworkContext_t networkContext = { 0 };
+    TransportInterface_t transport;
+    MQTTFixedBuffer_t networkBuffer;
+    pthread_t agentThread;
+    bool agentStarted = false;
+
+    ( void ) argc;
+    ( void ) argv;
+
+    returnStatus = connectToServerWithBackoffRetries( &networkContext );
+
+    if( returnStatus == EXIT_FAILURE )
+    {
+        LogError( ( "Failed to connect to MQTT broker %.*s.",
+                    BROKER_ENDPOINT_LENGTH,
+                    BROKER_ENDPOINT ) );
+    }
+    else
+    {
+        transport.pNetworkContext = &networkContext;
+        transport.send = Plaintext_Send;
+        transport.recv = Plaintext_Recv;
+
+        networkBuffer.pBuffer = buffer;
+        networkBuffer.size = NETWORK_BUFFER_SIZE;
+
+        if( MQTTAgent_Init( &agent,
+                            &transport,
+                            networkContext.socketDescriptor,
+                            Clock_GetTimeMs,
+                            &networkBuffer,
+                            handleIncomingPublish,
+                            NULL ) != MQTTAgentSuccess )
+        {
+            LogError( ( "Failed to initialize the MQTT agent." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            returnStatus = establishMqttSession();
+
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                agentStarted = ( pthread_create( &agentThread, NULL, runAgent, NULL ) == 0 );
+
+                if( agentStarted == false )
+                {
+                    LogError( ( "Failed to start the agent thread." ) );
+                    returnStatus = EXIT_FAILURE;
+                }
+            }
+
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                returnStatus = publishFromThreads();
+            }
+
+            if( agentStarted == true )
+            {
+                ( void ) MQTTAgent_Stop( &agent );
+                ( void ) pthread_join( agentThread, NULL );
+
+                LogInfo( ( "Received %u publishes on the subscribed topic.",
+                           ( unsigned int ) incomingPublishCount ) );
+
+                /* The agent thread has returned, so this thread owns the MQTT
+                 * context again. */
+                ( void ) MQTT_Disconnect( &agent.mqttContext );
+            }
+
+            MQTTAgent_Deinit( &agent );
+        }
+
+        /* Close the TCP connection.  */
+        ( void ) Plaintext_Disconnect( &networkContext );
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        LogInfo( ( "Demo completed successfully." ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
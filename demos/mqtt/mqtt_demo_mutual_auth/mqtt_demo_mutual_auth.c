@@ -74,6 +74,12 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Store of outgoing publishes waiting for an ack. */
+#include "inflight_store.h"
+
+/* Optional measurements of memory use. */
+#include "memory_stats.h"
+
 /**
  * These configuration settings are required to run the mutual auth demo.
  * Throw compilation error if the below configs are not defined.
@@ -201,9 +207,12 @@
 
 /**
  * @brief Maximum number of outgoing publishes maintained in the application
- * until an ack is received from the broker.
+ * until an ack is received from the broker. Raise it to keep more QoS1
+ * publishes in flight on links with a long round trip.
  */
-#define MAX_OUTGOING_PUBLISHES              ( 5U )
+#ifndef MAX_OUTGOING_PUBLISHES
+    #define MAX_OUTGOING_PUBLISHES          ( 5U )
+#endif
 
 /**
  * @brief Invalid packet identifier for the MQTT packets. Zero is always an
@@ -271,25 +280,6 @@
 
 /*-----------------------------------------------------------*/
 
-/**
- * @brief Structure to keep the MQTT publish packets until an ack is received
- * for QoS1 publishes.
- */
-typedef struct PublishPackets
-{
-    /**
-     * @brief Packet identifier of the publish packet.
-     */
-    uint16_t packetId;
-
-    /**
-     * @brief Publish info of the publish packet.
-     */
-    MQTTPublishInfo_t pubInfo;
-} PublishPackets_t;
-
-/*-----------------------------------------------------------*/
-
 /**
  * @brief Packet Identifier generated when Subscribe request was sent to the broker;
  * it is used to match received Subscribe ACK to the transmitted subscribe.
@@ -304,11 +294,15 @@ static uint16_t globalSubscribePacketIdentifier = 0U;
 static uint16_t globalUnsubscribePacketIdentifier = 0U;
 
 /**
- * @brief Array to keep the outgoing publish messages.
- * These stored outgoing publish messages are kept until a successful ack
- * is received.
+ * @brief The outgoing publish messages, kept by packet id until a successful
+ * ack is received.
+ */
+static InflightStore_t outgoingPublishes;
+
+/**
+ * @brief The memory of #outgoingPublishes.
  */
-static PublishPackets_t outgoingPublishPackets[ MAX_OUTGOING_PUBLISHES ] = { 0 };
+static uint8_t outgoingPublishArena[ INFLIGHT_STORE_ARENA_SIZE( MAX_OUTGOING_PUBLISHES ) ];
 
 /**
  * @brief Array to keep subscription topics.
@@ -451,40 +445,6 @@ static int unsubscribeFromTopic( MQTTContext_t * pMqttContext );
  */
 static int publishToTopic( MQTTContext_t * pMqttContext );
 
-/**
- * @brief Function to get the free index at which an outgoing publish
- * can be stored.
- *
- * @param[out] pIndex The output parameter to return the index at which an
- * outgoing publish message can be stored.
- *
- * @return EXIT_FAILURE if no more publishes can be stored;
- * EXIT_SUCCESS if an index to store the next outgoing publish is obtained.
- */
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex );
-
-/**
- * @brief Function to clean up an outgoing publish at given index from the
- * #outgoingPublishPackets array.
- *
- * @param[in] index The index at which a publish message has to be cleaned up.
- */
-static void cleanupOutgoingPublishAt( uint8_t index );
-
-/**
- * @brief Function to clean up all the outgoing publishes maintained in the
- * array.
- */
-static void cleanupOutgoingPublishes( void );
-
-/**
- * @brief Function to clean up the publish packet with the given packet id.
- *
- * @param[in] packetId Packet identifier of the packet to be cleaned up from
- * the array.
- */
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId );
-
 /**
  * @brief Function to resend the publishes if a session is re-established with
  * the broker. This function handles the resending of the QoS1 publish packets,
@@ -513,6 +473,30 @@ static int handleResubscribe( MQTTContext_t * pMqttContext );
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief The number of reconnect attempts that may start at once.
+ */
+#define RECONNECT_BUDGET_CAPACITY       ( 4U )
+
+/**
+ * @brief The interval in milliseconds at which the reconnect budget gains
+ * back one attempt.
+ */
+#define RECONNECT_BUDGET_REFILL_MS      ( 1000U )
+
+/**
+ * @brief The number of connection attempts that may be in progress at once.
+ */
+#define RECONNECT_BUDGET_MAX_IN_PROGRESS    ( 1U )
+
+/**
+ * @brief The retry budget that the connection attempts of the process draw
+ * from, so that they are spread over time after an outage.
+ */
+static RetryUtilsBudget_t reconnectBudget = RETRY_UTILS_BUDGET_INITIALIZER( RECONNECT_BUDGET_CAPACITY,
+                                                                            RECONNECT_BUDGET_REFILL_MS,
+                                                                            RECONNECT_BUDGET_MAX_IN_PROGRESS );
+
 static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext )
 {
     int returnStatus = EXIT_SUCCESS;
@@ -569,6 +553,11 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     /* Initialize reconnect attempts and interval */
     RetryUtils_ParamsReset( &reconnectParams );
 
+    /* Take the first attempt from the reconnect budget. The attempts that
+     * fail are released, and the retries taken, by RetryUtils_BackoffAndSleep. */
+    reconnectParams.pBudget = &reconnectBudget;
+    ( void ) RetryUtils_BudgetAcquireAndSleep( reconnectParams.pBudget );
+
     /* Attempt to connect to MQTT broker. If connection fails, retry after
      * a timeout. Timeout value will exponentially increase until maximum
      * attempts are reached.
@@ -601,79 +590,14 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
         }
     } while( ( opensslStatus != OPENSSL_SUCCESS ) && ( retryUtilsStatus == RetryUtilsSuccess ) );
 
-    return returnStatus;
-}
-
-/*-----------------------------------------------------------*/
-
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex )
-{
-    int returnStatus = EXIT_FAILURE;
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( pIndex != NULL );
-
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
+    /* The attempt that succeeded is complete. */
+    if( opensslStatus == OPENSSL_SUCCESS )
     {
-        /* A free index is marked by invalid packet id.
-         * Check if the the index has a free slot. */
-        if( outgoingPublishPackets[ index ].packetId == MQTT_PACKET_ID_INVALID )
-        {
-            returnStatus = EXIT_SUCCESS;
-            break;
-        }
+        ( void ) RetryUtils_BudgetRelease( &reconnectBudget );
     }
 
-    /* Copy the available index into the output param. */
-    *pIndex = index;
-
     return returnStatus;
 }
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishAt( uint8_t index )
-{
-    assert( outgoingPublishPackets != NULL );
-    assert( index < MAX_OUTGOING_PUBLISHES );
-
-    /* Clear the outgoing publish packet. */
-    ( void ) memset( &( outgoingPublishPackets[ index ] ),
-                     0x00,
-                     sizeof( outgoingPublishPackets[ index ] ) );
-}
-
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishes( void )
-{
-    assert( outgoingPublishPackets != NULL );
-
-    /* Clean up all the outgoing publish packets. */
-    ( void ) memset( outgoingPublishPackets, 0x00, sizeof( outgoingPublishPackets ) );
-}
-
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId )
-{
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( packetId != MQTT_PACKET_ID_INVALID );
-
-    /* Clean up all the saved outgoing publishes. */
-    for( ; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        if( outgoingPublishPackets[ index ].packetId == packetId )
-        {
-            cleanupOutgoingPublishAt( index );
-            LogInfo( ( "Cleaned up outgoing publish packet with packet id %u.\n\n",
-                       packetId ) );
-            break;
-        }
-    }
-}
 
 /*-----------------------------------------------------------*/
 
@@ -681,70 +605,57 @@ static int handlePublishResend( MQTTContext_t * pMqttContext )
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t index = 0U;
     MQTTStateCursor_t cursor = MQTT_STATE_CURSOR_INITIALIZER;
     uint16_t packetIdToResend = MQTT_PACKET_ID_INVALID;
-    bool foundPacketId = false;
+    InflightPublish_t * pPublish = NULL;
 
     assert( pMqttContext != NULL );
-    assert( outgoingPublishPackets != NULL );
 
     /* MQTT_PublishToResend() provides a packet ID of the next PUBLISH packet
      * that should be resent. In accordance with the MQTT v3.1.1 spec,
      * MQTT_PublishToResend() preserves the ordering of when the original
-     * PUBLISH packets were sent. The outgoingPublishPackets array is searched
-     * through for the associated packet ID. If the application requires
-     * increased efficiency in the look up of the packet ID, then a hashmap of
-     * packetId key and PublishPacket_t values may be used instead. */
+     * PUBLISH packets were sent. The store finds the PUBLISH of each packet
+     * ID in constant time. */
     packetIdToResend = MQTT_PublishToResend( pMqttContext, &cursor );
 
     while( packetIdToResend != MQTT_PACKET_ID_INVALID )
     {
-        foundPacketId = false;
+        pPublish = InflightStore_Find( &outgoingPublishes, packetIdToResend );
 
-        for( index = 0U; index < MAX_OUTGOING_PUBLISHES; index++ )
+        if( pPublish == NULL )
         {
-            if( outgoingPublishPackets[ index ].packetId == packetIdToResend )
-            {
-                foundPacketId = true;
-                outgoingPublishPackets[ index ].pubInfo.dup = true;
+            LogError( ( "Packet id %u requires resend, but was not found in "
+                        "outgoingPublishes.",
+                        packetIdToResend ) );
+            returnStatus = EXIT_FAILURE;
+            break;
+        }
 
-                LogInfo( ( "Sending duplicate PUBLISH with packet id %u.",
-                           outgoingPublishPackets[ index ].packetId ) );
-                mqttStatus = MQTT_Publish( pMqttContext,
-                                           &outgoingPublishPackets[ index ].pubInfo,
-                                           outgoingPublishPackets[ index ].packetId );
+        pPublish->pubInfo.dup = true;
 
-                if( mqttStatus != MQTTSuccess )
-                {
-                    LogError( ( "Sending duplicate PUBLISH for packet id %u "
-                                " failed with status %s.",
-                                outgoingPublishPackets[ index ].packetId,
-                                MQTT_Status_strerror( mqttStatus ) ) );
-                    returnStatus = EXIT_FAILURE;
-                    break;
-                }
-                else
-                {
-                    LogInfo( ( "Sent duplicate PUBLISH successfully for packet id %u.\n\n",
-                               outgoingPublishPackets[ index ].packetId ) );
-                }
-            }
-        }
+        LogInfo( ( "Sending duplicate PUBLISH with packet id %u.",
+                   pPublish->packetId ) );
+        mqttStatus = MQTT_Publish( pMqttContext,
+                                   &pPublish->pubInfo,
+                                   pPublish->packetId );
 
-        if( foundPacketId == false )
+        if( mqttStatus != MQTTSuccess )
         {
-            LogError( ( "Packet id %u requires resend, but was not found in "
-                        "outgoingPublishPackets.",
-                        packetIdToResend ) );
+            LogError( ( "Sending duplicate PUBLISH for packet id %u "
+                        " failed with status %s.",
+                        pPublish->packetId,
+                        MQTT_Status_strerror( mqttStatus ) ) );
             returnStatus = EXIT_FAILURE;
             break;
         }
         else
         {
-            /* Get the next packetID to be resent. */
-            packetIdToResend = MQTT_PublishToResend( pMqttContext, &cursor );
+            LogInfo( ( "Sent duplicate PUBLISH successfully for packet id %u.\n\n",
+                       pPublish->packetId ) );
         }
+
+        /* Get the next packetID to be resent. */
+        packetIdToResend = MQTT_PublishToResend( pMqttContext, &cursor );
     }
 
     return returnStatus;
@@ -945,7 +856,11 @@ static void eventCallback( MQTTContext_t * pMqttContext,
                 LogInfo( ( "PUBACK received for packet id %u.\n\n",
                            packetIdentifier ) );
                 /* Cleanup publish packet when a PUBACK is received. */
-                cleanupOutgoingPublishWithPacketID( packetIdentifier );
+                if( InflightStore_Release( &outgoingPublishes, packetIdentifier ) == InflightStoreSuccess )
+                {
+                    LogInfo( ( "Cleaned up outgoing publish packet with packet id %u.\n\n",
+                               packetIdentifier ) );
+                }
                 break;
 
             /* Any other packet type is invalid. */
@@ -1150,42 +1065,40 @@ static int publishToTopic( MQTTContext_t * pMqttContext )
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t publishIndex = MAX_OUTGOING_PUBLISHES;
+    InflightPublish_t * pPublish = NULL;
 
     assert( pMqttContext != NULL );
 
-    /* Get the next free index for the outgoing publish. All QoS1 outgoing
+    /* Store the outgoing publish under a new packet id. All QoS1 outgoing
      * publishes are stored until a PUBACK is received. These messages are
      * stored for supporting a resend if a network connection is broken before
      * receiving a PUBACK. */
-    returnStatus = getNextFreeIndexForOutgoingPublishes( &publishIndex );
-
-    if( returnStatus == EXIT_FAILURE )
+    if( InflightStore_Allocate( &outgoingPublishes,
+                                MQTT_GetPacketId( pMqttContext ),
+                                &pPublish ) != InflightStoreSuccess )
     {
         LogError( ( "Unable to find a free spot for outgoing PUBLISH message.\n\n" ) );
+        returnStatus = EXIT_FAILURE;
     }
     else
     {
         /* This example publishes to only one topic and uses QOS1. */
-        outgoingPublishPackets[ publishIndex ].pubInfo.qos = MQTTQoS1;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pTopicName = MQTT_EXAMPLE_TOPIC;
-        outgoingPublishPackets[ publishIndex ].pubInfo.topicNameLength = MQTT_EXAMPLE_TOPIC_LENGTH;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pPayload = MQTT_EXAMPLE_MESSAGE;
-        outgoingPublishPackets[ publishIndex ].pubInfo.payloadLength = MQTT_EXAMPLE_MESSAGE_LENGTH;
-
-        /* Get a new packet id. */
-        outgoingPublishPackets[ publishIndex ].packetId = MQTT_GetPacketId( pMqttContext );
+        pPublish->pubInfo.qos = MQTTQoS1;
+        pPublish->pubInfo.pTopicName = MQTT_EXAMPLE_TOPIC;
+        pPublish->pubInfo.topicNameLength = MQTT_EXAMPLE_TOPIC_LENGTH;
+        pPublish->pubInfo.pPayload = MQTT_EXAMPLE_MESSAGE;
+        pPublish->pubInfo.payloadLength = MQTT_EXAMPLE_MESSAGE_LENGTH;
 
         /* Send PUBLISH packet. */
         mqttStatus = MQTT_Publish( pMqttContext,
-                                   &outgoingPublishPackets[ publishIndex ].pubInfo,
-                                   outgoingPublishPackets[ publishIndex ].packetId );
+                                   &pPublish->pubInfo,
+                                   pPublish->packetId );
 
         if( mqttStatus != MQTTSuccess )
         {
             LogError( ( "Failed to send PUBLISH packet to broker with error = %s.",
                         MQTT_Status_strerror( mqttStatus ) ) );
-            cleanupOutgoingPublishAt( publishIndex );
+            ( void ) InflightStore_Release( &outgoingPublishes, pPublish->packetId );
             returnStatus = EXIT_FAILURE;
         }
         else
@@ -1193,7 +1106,7 @@ static int publishToTopic( MQTTContext_t * pMqttContext )
             LogInfo( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.\n\n",
                        MQTT_EXAMPLE_TOPIC_LENGTH,
                        MQTT_EXAMPLE_TOPIC,
-                       outgoingPublishPackets[ publishIndex ].packetId ) );
+                       pPublish->packetId ) );
         }
     }
 
@@ -1236,6 +1149,19 @@ static int initializeMqtt( MQTTContext_t * pMqttContext,
         returnStatus = EXIT_FAILURE;
         LogError( ( "MQTT init failed: Status = %s.", MQTT_Status_strerror( mqttStatus ) ) );
     }
+    else if( InflightStore_Init( &outgoingPublishes,
+                                 outgoingPublishArena,
+                                 sizeof( outgoingPublishArena ),
+                                 MAX_OUTGOING_PUBLISHES ) != InflightStoreSuccess )
+    {
+        returnStatus = EXIT_FAILURE;
+        LogError( ( "Failed to set up the store of %u outgoing publishes.",
+                    ( unsigned int ) MAX_OUTGOING_PUBLISHES ) );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
 
     return returnStatus;
 }
@@ -1298,7 +1224,7 @@ static int subscribePublishLoop( MQTTContext_t * pMqttContext,
 
             /* Clean up the outgoing publishes waiting for ack as this new
              * connection doesn't re-establish an existing session. */
-            cleanupOutgoingPublishes();
+            InflightStore_Clear( &outgoingPublishes );
         }
     }
 
@@ -1460,6 +1386,10 @@ int main( int argc,
     ( void ) argc;
     ( void ) argv;
 
+    /* Measure memory from here when built with BUILD_MEMORY_INSTRUMENTATION,
+     * before OpenSSL allocates anything. */
+    MEMORY_STATS_INIT();
+
     /* Initialize MQTT library. Initialization of the MQTT library needs to be
      * done only once in this demo. */
     returnStatus = initializeMqtt( &mqttContext, &networkContext );
@@ -1498,6 +1428,8 @@ int main( int argc,
             /* End TLS session, then close TCP connection. */
             ( void ) Openssl_Disconnect( &networkContext );
 
+            MEMORY_STATS_LOG( "mqtt_demo_mutual_auth" );
+
             LogInfo( ( "Short delay before starting the next iteration....\n" ) );
             sleep( MQTT_SUBPUB_LOOP_DELAY_SECONDS );
         }
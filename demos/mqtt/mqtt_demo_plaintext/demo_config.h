@@ -68,6 +68,16 @@
  */
 #define BROKER_PORT    ( 1883 )
 
+/**
+ * @brief Path of a Unix domain socket on which a broker on the same host
+ * listens, such as one set up with the Mosquitto "listener 0 <path>" option.
+ *
+ * When this is defined, the demo connects to this socket instead of to
+ * BROKER_ENDPOINT and BROKER_PORT, which skips DNS and the TCP/IP stack.
+ *
+ * #define BROKER_SOCKET_PATH    "/var/run/mosquitto.sock"
+ */
+
 /**
  * @brief MQTT client identifier.
  *
@@ -55,6 +55,9 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Wait for MQTT work without polling. */
+#include "mqtt_idle.h"
+
 /**
  * These configuration settings are required to run the plaintext demo.
  * Throw compilation error if the below configs are not defined.
@@ -151,6 +154,13 @@
  */
 #define TRANSPORT_SEND_RECV_TIMEOUT_MS      ( 20 )
 
+/**
+ * @brief Time in milliseconds allowed for each attempt at establishing the
+ * TCP connection, so that an unreachable broker fails fast and is retried
+ * with backoff.
+ */
+#define TRANSPORT_CONNECT_TIMEOUT_MS        ( 2000U )
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -304,8 +314,47 @@ static void updateSubAckStatus( MQTTPacketInfo_t * pPacketInfo );
  */
 static int handleResubscribe( MQTTContext_t * pMqttContext );
 
+/**
+ * @brief Keep the connection served for some time, sleeping until a packet
+ * arrives or a keep-alive ping is due instead of polling the process loop.
+ *
+ * @param[in] pMqttContext MQTT context pointer.
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] durationMs How long to serve the connection.
+ *
+ * @return The status of the last MQTT_ProcessLoop call, or MQTTRecvFailed if
+ * the wait failed.
+ */
+static MQTTStatus_t processIncomingFor( MQTTContext_t * pMqttContext,
+                                        const NetworkContext_t * pNetworkContext,
+                                        uint32_t durationMs );
+
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief The number of reconnect attempts that may start at once.
+ */
+#define RECONNECT_BUDGET_CAPACITY       ( 4U )
+
+/**
+ * @brief The interval in milliseconds at which the reconnect budget gains
+ * back one attempt.
+ */
+#define RECONNECT_BUDGET_REFILL_MS      ( 1000U )
+
+/**
+ * @brief The number of connection attempts that may be in progress at once.
+ */
+#define RECONNECT_BUDGET_MAX_IN_PROGRESS    ( 1U )
+
+/**
+ * @brief The retry budget that the connection attempts of the process draw
+ * from, so that they are spread over time after an outage.
+ */
+static RetryUtilsBudget_t reconnectBudget = RETRY_UTILS_BUDGET_INITIALIZER( RECONNECT_BUDGET_CAPACITY,
+                                                                            RECONNECT_BUDGET_REFILL_MS,
+                                                                            RECONNECT_BUDGET_MAX_IN_PROGRESS );
+
 static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext )
 {
     int returnStatus = EXIT_SUCCESS;
@@ -313,32 +362,55 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     SocketStatus_t socketStatus = SOCKETS_SUCCESS;
     RetryUtilsParams_t reconnectParams;
     ServerInfo_t serverInfo;
+    SocketsConfig_t socketsConfig;
 
     /* Initialize information to connect to the MQTT broker. */
     serverInfo.pHostName = BROKER_ENDPOINT;
     serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
     serverInfo.port = BROKER_PORT;
 
+    /* Initialize the timeouts of the connection. */
+    ( void ) memset( &socketsConfig, 0x00, sizeof( socketsConfig ) );
+    socketsConfig.sendTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    socketsConfig.recvTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    socketsConfig.connectTimeoutMs = TRANSPORT_CONNECT_TIMEOUT_MS;
+
     /* Initialize reconnect attempts and interval */
     RetryUtils_ParamsReset( &reconnectParams );
 
+    /* Take the first attempt from the reconnect budget. The attempts that
+     * fail are released, and the retries taken, by RetryUtils_BackoffAndSleep. */
+    reconnectParams.pBudget = &reconnectBudget;
+    ( void ) RetryUtils_BudgetAcquireAndSleep( reconnectParams.pBudget );
+
     /* Attempt to connect to MQTT broker. If connection fails, retry after
      * a timeout. Timeout value will exponentially increase till maximum
      * attempts are reached.
      */
     do
     {
-        /* Establish a TCP connection with the MQTT broker. This example connects
-         * to the MQTT broker as specified in BROKER_ENDPOINT and BROKER_PORT
-         * at the demo config header. */
-        LogInfo( ( "Creating a TCP connection to %.*s:%d.",
-                   BROKER_ENDPOINT_LENGTH,
-                   BROKER_ENDPOINT,
-                   BROKER_PORT ) );
-        socketStatus = Plaintext_Connect( pNetworkContext,
-                                          &serverInfo,
-                                          TRANSPORT_SEND_RECV_TIMEOUT_MS,
-                                          TRANSPORT_SEND_RECV_TIMEOUT_MS );
+        #ifdef BROKER_SOCKET_PATH
+            /* Connect to a broker on the same host through its Unix domain
+             * socket, so the host name and port are not used. */
+            ( void ) serverInfo;
+            LogInfo( ( "Connecting to the Unix domain socket %s.",
+                       BROKER_SOCKET_PATH ) );
+            socketStatus = Plaintext_ConnectUnix( pNetworkContext,
+                                                  BROKER_SOCKET_PATH,
+                                                  sizeof( BROKER_SOCKET_PATH ) - 1U,
+                                                  &socketsConfig );
+        #else
+            /* Establish a TCP connection with the MQTT broker. This example connects
+             * to the MQTT broker as specified in BROKER_ENDPOINT and BROKER_PORT
+             * at the demo config header. */
+            LogInfo( ( "Creating a TCP connection to %.*s:%d.",
+                       BROKER_ENDPOINT_LENGTH,
+                       BROKER_ENDPOINT,
+                       BROKER_PORT ) );
+            socketStatus = Plaintext_ConnectWithConfig( pNetworkContext,
+                                                        &serverInfo,
+                                                        &socketsConfig );
+        #endif /* ifdef BROKER_SOCKET_PATH */
 
         if( socketStatus != SOCKETS_SUCCESS )
         {
@@ -353,6 +425,12 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
         }
     } while( ( socketStatus != SOCKETS_SUCCESS ) && ( retryUtilsStatus == RetryUtilsSuccess ) );
 
+    /* The attempt that succeeded is complete. */
+    if( socketStatus == SOCKETS_SUCCESS )
+    {
+        ( void ) RetryUtils_BudgetRelease( &reconnectBudget );
+    }
+
     return returnStatus;
 }
 
@@ -792,6 +870,43 @@ static int publishToTopic( MQTTContext_t * pMqttContext )
 
 /*-----------------------------------------------------------*/
 
+static MQTTStatus_t processIncomingFor( MQTTContext_t * pMqttContext,
+                                        const NetworkContext_t * pNetworkContext,
+                                        uint32_t durationMs )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    uint32_t startTimeMs = Clock_GetTimeMs();
+    uint32_t elapsedMs = 0U;
+    uint32_t events = 0U;
+
+    while( ( mqttStatus == MQTTSuccess ) && ( elapsedMs < durationMs ) )
+    {
+        if( MQTTIdle_WaitForWork( pMqttContext,
+                                  pNetworkContext->socketDescriptor,
+                                  -1,
+                                  durationMs - elapsedMs,
+                                  &events ) != MQTTIdleSuccess )
+        {
+            mqttStatus = MQTTRecvFailed;
+        }
+        else if( events != 0U )
+        {
+            /* Receive one packet, or send the keep-alive ping. */
+            mqttStatus = MQTT_ProcessLoop( pMqttContext, 0U );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        elapsedMs = Clock_GetTimeMs() - startTimeMs;
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 static int subscribePublishLoop( NetworkContext_t * pNetworkContext )
 {
     int returnStatus = EXIT_SUCCESS;
@@ -891,8 +1006,18 @@ static int subscribePublishLoop( NetworkContext_t * pNetworkContext )
 
             LogInfo( ( "Delay before continuing to next iteration.\n\n" ) );
 
-            /* Leave connection idle for some time. */
-            sleep( DELAY_BETWEEN_PUBLISHES_SECONDS );
+            /* Leave connection idle for some time, while still receiving
+             * packets and sending keep-alive pings, without waking up
+             * unless there is something to do. */
+            mqttStatus = processIncomingFor( &mqttContext,
+                                             pNetworkContext,
+                                             DELAY_BETWEEN_PUBLISHES_SECONDS * 1000U );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogWarn( ( "MQTT_ProcessLoop returned with status = %s.",
+                           MQTT_Status_strerror( mqttStatus ) ) );
+            }
         }
     }
 
@@ -55,6 +55,15 @@
 /* Plaintext transport implementation. */
 #include "plaintext_posix.h"
 
+/* Batches PUBLISH packets into one transport write. */
+#include "publish_batcher.h"
+
+/* Packet receiver include. */
+#include "packet_receiver.h"
+
+/* Clock for the batch flush delay. */
+#include "clock.h"
+
 /* Retry parameters. */
 #include "retry_utils.h"
 
@@ -98,6 +107,28 @@
  */
 #define MQTT_EXAMPLE_MESSAGE                 "Hello World!"
 
+/**
+ * @brief Number of messages published together in each publish burst.
+ *
+ * The burst is serialized into one batch and sent with one transport write.
+ */
+#define MQTT_PUBLISH_BURST_COUNT             ( 3U )
+
+/**
+ * @brief Number of I/O vectors describing a batch of PUBLISH packets.
+ */
+#define PUBLISH_BATCH_IO_VECTORS             ( 8U )
+
+/**
+ * @brief Queued PUBLISH bytes that trigger sending the batch.
+ */
+#define PUBLISH_BATCH_FLUSH_BYTES            ( NETWORK_BUFFER_SIZE / 2U )
+
+/**
+ * @brief Time in milliseconds a queued PUBLISH waits before the batch is sent.
+ */
+#define PUBLISH_BATCH_FLUSH_DELAY_MS         ( 20U )
+
 /**
  * @brief Keep alive period in seconds for MQTT connection.
  */
@@ -159,15 +190,16 @@ static void mqttSubscribeToTopic( NetworkContext_t * pNetworkContext,
                                   MQTTFixedBuffer_t * pFixedBuffer );
 
 /**
- * @brief  Publishes a message MQTT_EXAMPLE_MESSAGE on MQTT_EXAMPLE_TOPIC topic.
+ * @brief Publishes MQTT_PUBLISH_BURST_COUNT messages MQTT_EXAMPLE_MESSAGE on
+ * MQTT_EXAMPLE_TOPIC topic.
  *
- * @param[in] pNetworkContext Pointer to the network context created using Plaintext_Connect.
- * @param[in] pFixedBuffer Pointer to a structure containing fixed buffer and its length.
- * The buffer is used for serializing PUBLISH packet.
+ * The PUBLISH packets are serialized back to back into a batch, which is sent
+ * with one transport write instead of a header and a payload write for each.
+ *
+ * @param[in] pBatcher Pointer to the publish batcher of the connection.
  *
  */
-static void mqttPublishToTopic( NetworkContext_t * pNetworkContext,
-                                MQTTFixedBuffer_t * pFixedBuffer );
+static void mqttPublishToTopic( PublishBatcher_t * pBatcher );
 
 /**
  * @brief Unsubscribes from the previously subscribed topic as specified
@@ -205,13 +237,11 @@ static void mqttKeepAlive( NetworkContext_t * pNetworkContext,
  * @brief Receive and validate MQTT packet from the broker, determine the type
  * of the packet and process the packet based on the type.
  *
- * @param[in] pNetworkContext Pointer to the network context created using Plaintext_Connect.
- * @param[in] pFixedBuffer Pointer to a structure containing fixed buffer and its length.
- * The buffer is used to deserialize incoming MQTT packet.
+ * @param[in] pReceiver Pointer to the packet receiver of the connection. The
+ * packet is deserialized in place in the buffer of the receiver.
  *
  */
-static void mqttProcessIncomingPacket( NetworkContext_t * pNetworkContext,
-                                       MQTTFixedBuffer_t * pFixedBuffer );
+static void mqttProcessIncomingPacket( PacketReceiver_t * pReceiver );
 
 /**
  * @brief Process a response or ack to an MQTT request (PING, SUBSCRIBE
@@ -290,6 +320,22 @@ static uint16_t unsubscribePacketIdentifier;
  */
 static bool globalSubAckStatus = false;
 
+/**
+ * @brief Static buffer the PUBLISH headers and small payloads of a batch are
+ * serialized into.
+ */
+static uint8_t publishBatchBuffer[ NETWORK_BUFFER_SIZE ];
+
+/**
+ * @brief I/O vectors describing a batch of PUBLISH packets.
+ */
+static struct iovec publishBatchVectors[ PUBLISH_BATCH_IO_VECTORS ];
+
+/**
+ * @brief Static buffer incoming packets after the CONNACK are received into.
+ */
+static uint8_t receiveBuffer[ NETWORK_BUFFER_SIZE ];
+
 /*-----------------------------------------------------------*/
 
 static uint16_t getNextPacketIdentifier( void )
@@ -310,6 +356,30 @@ static uint16_t getNextPacketIdentifier( void )
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief The number of reconnect attempts that may start at once.
+ */
+#define RECONNECT_BUDGET_CAPACITY       ( 4U )
+
+/**
+ * @brief The interval in milliseconds at which the reconnect budget gains
+ * back one attempt.
+ */
+#define RECONNECT_BUDGET_REFILL_MS      ( 1000U )
+
+/**
+ * @brief The number of connection attempts that may be in progress at once.
+ */
+#define RECONNECT_BUDGET_MAX_IN_PROGRESS    ( 1U )
+
+/**
+ * @brief The retry budget that the connection attempts of the process draw
+ * from, so that they are spread over time after an outage.
+ */
+static RetryUtilsBudget_t reconnectBudget = RETRY_UTILS_BUDGET_INITIALIZER( RECONNECT_BUDGET_CAPACITY,
+                                                                            RECONNECT_BUDGET_REFILL_MS,
+                                                                            RECONNECT_BUDGET_MAX_IN_PROGRESS );
+
 static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext )
 {
     int returnStatus = EXIT_SUCCESS;
@@ -326,6 +396,11 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     /* Initialize reconnect attempts and interval */
     RetryUtils_ParamsReset( &reconnectParams );
 
+    /* Take the first attempt from the reconnect budget. The attempts that
+     * fail are released, and the retries taken, by RetryUtils_BackoffAndSleep. */
+    reconnectParams.pBudget = &reconnectBudget;
+    ( void ) RetryUtils_BudgetAcquireAndSleep( reconnectParams.pBudget );
+
     /* Attempt to connect to MQTT broker. If connection fails, retry after
      * a timeout. Timeout value will exponentially increase till maximum
      * attempts are reached.
@@ -357,6 +432,12 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
         }
     } while( ( socketStatus != SOCKETS_SUCCESS ) && ( retryUtilsStatus == RetryUtilsSuccess ) );
 
+    /* The attempt that succeeded is complete. */
+    if( socketStatus == SOCKETS_SUCCESS )
+    {
+        ( void ) RetryUtils_BudgetRelease( &reconnectBudget );
+    }
+
     return returnStatus;
 }
 
@@ -437,7 +518,7 @@ static int createMQTTConnectionWithBroker( NetworkContext_t * pNetworkContext,
     assert( incomingPacket.remainingLength <= pFixedBuffer->size );
 
     /* Now receive the remaining packet into statically allocated buffer. */
-    returnStatus = Plaintext_Recv( pNetworkContext, ( void * ) pFixedBuffer->pBuffer, incomingPacket.remainingLength );
+    returnStatus = Plaintext_RecvAll( pNetworkContext, ( void * ) pFixedBuffer->pBuffer, incomingPacket.remainingLength );
     assert( returnStatus == ( int ) incomingPacket.remainingLength );
 
     incomingPacket.pRemainingData = pFixedBuffer->pBuffer;
@@ -513,19 +594,14 @@ static void mqttSubscribeToTopic( NetworkContext_t * pNetworkContext,
 }
 /*-----------------------------------------------------------*/
 
-static void mqttPublishToTopic( NetworkContext_t * pNetworkContext,
-                                MQTTFixedBuffer_t * pFixedBuffer )
+static void mqttPublishToTopic( PublishBatcher_t * pBatcher )
 {
-    MQTTStatus_t result;
+    PublishBatcherStatus_t status;
     MQTTPublishInfo_t mqttPublishInfo;
-    size_t remainingLength;
-    size_t packetSize = 0;
-    size_t headerSize = 0;
-    int status;
+    uint32_t messageCount;
 
     /* Suppress unused variable warnings when asserts are disabled in build. */
     ( void ) status;
-    ( void ) result;
 
     /***
      * For readability, error handling in this function is restricted to the use of
@@ -543,30 +619,23 @@ static void mqttPublishToTopic( NetworkContext_t * pNetworkContext,
     mqttPublishInfo.pPayload = MQTT_EXAMPLE_MESSAGE;
     mqttPublishInfo.payloadLength = strlen( MQTT_EXAMPLE_MESSAGE );
 
-    /* Find out length of Publish packet size. */
-    result = MQTT_GetPublishPacketSize( &mqttPublishInfo, &remainingLength, &packetSize );
-    assert( result == MQTTSuccess );
+    /* Serialize each PUBLISH packet into the batch. The batch is sent when it
+     * reaches PUBLISH_BATCH_FLUSH_BYTES, or its oldest packet has waited for
+     * PUBLISH_BATCH_FLUSH_DELAY_MS. QOS0 does not make use of packet
+     * identifier, therefore value of 0 is used. */
+    for( messageCount = 0U; messageCount < MQTT_PUBLISH_BURST_COUNT; messageCount++ )
+    {
+        status = PublishBatcher_Add( pBatcher, &mqttPublishInfo, 0U, Clock_GetTimeMs() );
+        assert( status == PublishBatcherSuccess );
 
-    /* Make sure the packet size is less than static buffer size. */
-    assert( packetSize < pFixedBuffer->size );
+        status = PublishBatcher_Poll( pBatcher, Clock_GetTimeMs() );
+        assert( status == PublishBatcherSuccess );
+    }
 
-    /* Serialize MQTT Publish packet header. The publish message payload will
-     * be sent directly in order to avoid copying it into the buffer.
-     * QOS0 does not make use of packet identifier, therefore value of 0 is used */
-    result = MQTT_SerializePublishHeader( &mqttPublishInfo,
-                                          0,
-                                          remainingLength,
-                                          pFixedBuffer,
-                                          &headerSize );
-    LogDebug( ( "Serialized PUBLISH header size is %lu.",
-                ( unsigned long ) headerSize ) );
-    assert( result == MQTTSuccess );
-    /* Send Publish header to the broker. */
-    status = Plaintext_Send( pNetworkContext, ( void * ) pFixedBuffer->pBuffer, headerSize );
-    assert( status == ( int ) headerSize );
-    /* Send Publish payload to the broker */
-    status = Plaintext_Send( pNetworkContext, ( void * ) mqttPublishInfo.pPayload, mqttPublishInfo.payloadLength );
-    assert( status == ( int ) mqttPublishInfo.payloadLength );
+    /* The burst is complete, so send what is still queued rather than wait
+     * for more messages. */
+    status = PublishBatcher_Flush( pBatcher );
+    assert( status == PublishBatcherSuccess );
 }
 /*-----------------------------------------------------------*/
 
@@ -745,20 +814,16 @@ static void mqttProcessIncomingPublish( MQTTPublishInfo_t * pPubInfo,
 
 /*-----------------------------------------------------------*/
 
-static void mqttProcessIncomingPacket( NetworkContext_t * pNetworkContext,
-                                       MQTTFixedBuffer_t * pFixedBuffer )
+static void mqttProcessIncomingPacket( PacketReceiver_t * pReceiver )
 {
     MQTTStatus_t result;
     MQTTPacketInfo_t incomingPacket;
     MQTTPublishInfo_t publishInfo;
     uint16_t packetId = 0;
-    int status;
+    PacketReceiverStatus_t status;
     bool sessionPresent = false;
     uint16_t receiveAttempts = 0;
 
-    /* Suppress unused variable warning when asserts are disabled in build. */
-    ( void ) status;
-
     /***
      * For readability, error handling in this function is restricted to the use of
      * asserts().
@@ -766,31 +831,21 @@ static void mqttProcessIncomingPacket( NetworkContext_t * pNetworkContext,
 
     memset( ( void * ) &incomingPacket, 0x00, sizeof( MQTTPacketInfo_t ) );
 
-    /* Determine incoming packet type and remaining length. */
+    /* Get the next complete packet. The receiver reads only when no complete
+     * packet is buffered, and one read may return several packets, such as
+     * the echoes of a publish burst. */
     do
     {
         /* Retry till data is available */
-        result = MQTT_GetIncomingPacketTypeAndLength( Plaintext_Recv, pNetworkContext, &incomingPacket );
+        status = PacketReceiver_Next( pReceiver, &incomingPacket );
         receiveAttempts++;
-    } while( ( result == MQTTNoDataAvailable ) && ( receiveAttempts < MQTT_MAX_RECV_ATTEMPTS ) );
+    } while( ( status == PacketReceiverNoDataAvailable ) && ( receiveAttempts < MQTT_MAX_RECV_ATTEMPTS ) );
 
-    assert( result == MQTTSuccess );
-    assert( incomingPacket.remainingLength <= pFixedBuffer->size );
+    assert( status == PacketReceiverSuccess );
 
     /* Current implementation expects an incoming Publish and three different
      * responses ( SUBACK, PINGRESP and UNSUBACK ). */
 
-    /* Transport read is required only if remaining length is greater than 0.
-     * Remaining length for PINGRESP will be 0. */
-    if( incomingPacket.remainingLength > 0 )
-    {
-        /* Receive the remaining bytes. */
-        status = Plaintext_Recv( pNetworkContext, ( void * ) pFixedBuffer->pBuffer, incomingPacket.remainingLength );
-        assert( status == ( int ) incomingPacket.remainingLength );
-    }
-
-    incomingPacket.pRemainingData = pFixedBuffer->pBuffer;
-
     if( ( incomingPacket.type & 0xf0 ) == MQTT_PACKET_TYPE_PUBLISH )
     {
         result = MQTT_DeserializePublish( &incomingPacket, &packetId, &publishInfo );
@@ -852,6 +907,12 @@ int main( int argc,
     NetworkContext_t networkContext = { 0 };
     RetryUtilsStatus_t retryUtilsStatus = RetryUtilsSuccess;
     RetryUtilsParams_t retryParams;
+    PublishBatcher_t publishBatcher;
+    PublishBatcherConfig_t publishBatcherConfig;
+    PublishBatcherStatus_t publishBatcherStatus;
+    uint32_t incomingPacketCount = 0U;
+    PacketReceiver_t packetReceiver;
+    PacketReceiverStatus_t packetReceiverStatus;
 
     ( void ) argc;
     ( void ) argv;
@@ -864,6 +925,22 @@ int main( int argc,
     fixedBuffer.pBuffer = buffer;
     fixedBuffer.size = NETWORK_BUFFER_SIZE;
 
+    /* Suppress unused variable warning when asserts are disabled in build. */
+    ( void ) publishBatcherStatus;
+    ( void ) packetReceiverStatus;
+
+    /* Set up the publish batcher, which serializes PUBLISH packets into its
+     * own buffer, so that received packets can be processed in fixedBuffer
+     * while publishes are queued. */
+    publishBatcherConfig.pNetworkContext = &networkContext;
+    publishBatcherConfig.writev = Plaintext_Writev;
+    publishBatcherConfig.pBuffer = publishBatchBuffer;
+    publishBatcherConfig.bufferSize = NETWORK_BUFFER_SIZE;
+    publishBatcherConfig.pIoVectors = publishBatchVectors;
+    publishBatcherConfig.ioVectorCount = PUBLISH_BATCH_IO_VECTORS;
+    publishBatcherConfig.flushBytes = PUBLISH_BATCH_FLUSH_BYTES;
+    publishBatcherConfig.flushDelayMs = PUBLISH_BATCH_FLUSH_DELAY_MS;
+
     for( demoIterations = 0; demoIterations < maxDemoIterations; demoIterations++ )
     {
         /* Establish a TCP connection with the MQTT broker. This example connects to
@@ -880,6 +957,18 @@ int main( int argc,
             returnStatus = createMQTTConnectionWithBroker( &networkContext, &fixedBuffer );
             assert( returnStatus == EXIT_SUCCESS );
 
+            /* Start the connection with an empty batch. */
+            publishBatcherStatus = PublishBatcher_Init( &publishBatcher, &publishBatcherConfig );
+            assert( publishBatcherStatus == PublishBatcherSuccess );
+
+            /* Receive every packet after the CONNACK through the packet receiver. */
+            packetReceiverStatus = PacketReceiver_Init( &packetReceiver,
+                                                        &networkContext,
+                                                        Plaintext_Recv,
+                                                        receiveBuffer,
+                                                        NETWORK_BUFFER_SIZE );
+            assert( packetReceiverStatus == PacketReceiverSuccess );
+
             /**************************** Subscribe, Re-subscribe, and Keep-Alive ******************************/
 
             /* Initialize retry attempts and interval. */
@@ -912,7 +1001,7 @@ int main( int argc,
                  * receiving Publish message before subscribe ack is zero; but application
                  * must be ready to receive any packet.  This demo uses the generic packet
                  * processing function everywhere to highlight this fact. */
-                mqttProcessIncomingPacket( &networkContext, &fixedBuffer );
+                mqttProcessIncomingPacket( &packetReceiver );
 
                 /* Check status of suback sent from broker. If server rejected the subscription
                  * request, attempt resubscription to the topic filter. */
@@ -932,7 +1021,7 @@ int main( int argc,
                     lastControlPacketSentTimeStamp = currentTimeStamp.tv_sec;
 
                     /* Process incoming PINGRESP from the broker */
-                    mqttProcessIncomingPacket( &networkContext, &fixedBuffer );
+                    mqttProcessIncomingPacket( &packetReceiver );
 
                     LogWarn( ( "Server rejected subscription request. Retrying subscribe with backoff and jitter." ) );
                     retryUtilsStatus = RetryUtils_BackoffAndSleep( &retryParams );
@@ -957,7 +1046,10 @@ int main( int argc,
                 if( publishPacketSent == false )
                 {
                     LogInfo( ( "Publish to the MQTT topic %s\r\n", MQTT_EXAMPLE_TOPIC ) );
-                    mqttPublishToTopic( &networkContext, &fixedBuffer );
+                    mqttPublishToTopic( &publishBatcher );
+
+                    /* Expect an echo of each message in the burst. */
+                    incomingPacketCount = MQTT_PUBLISH_BURST_COUNT;
 
                     /* Set control packet sent flag to true so that the lastControlPacketSent
                      * timestamp will be updated. */
@@ -977,6 +1069,7 @@ int main( int argc,
                         LogInfo( ( "Sending PINGREQ to the broker\n " ) );
                         mqttKeepAlive( &networkContext, &fixedBuffer );
                         controlPacketSent = true;
+                        incomingPacketCount = 1U;
                     }
 
                     /* Since PUBLISH packet is not sent for this iteration, set publishPacketSent to false
@@ -994,8 +1087,11 @@ int main( int argc,
 
                     /* Since the application is subscribed publishing messages to the same topic,
                      * the broker will send the same message back to the application.
-                     * Process incoming PUBLISH echo or PINGRESP. */
-                    mqttProcessIncomingPacket( &networkContext, &fixedBuffer );
+                     * Process incoming PUBLISH echoes or PINGRESP. */
+                    for( ; incomingPacketCount > 0U; incomingPacketCount-- )
+                    {
+                        mqttProcessIncomingPacket( &packetReceiver );
+                    }
                 }
 
                 /* Sleep until keep alive time period, so that for the next iteration this
@@ -1009,7 +1105,7 @@ int main( int argc,
             LogInfo( ( "Unsubscribe from the MQTT topic %s.\r\n", MQTT_EXAMPLE_TOPIC ) );
             mqttUnsubscribeFromTopic( &networkContext, &fixedBuffer );
             /* Process Incoming unsubscribe ack from the broker. */
-            mqttProcessIncomingPacket( &networkContext, &fixedBuffer );
+            mqttProcessIncomingPacket( &packetReceiver );
 
             /* Reset global SUBACK status variable after completion of subscription request cycle. */
             globalSubAckStatus = false;
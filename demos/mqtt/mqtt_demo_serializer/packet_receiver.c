@@ -0,0 +1,210 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file packet_receiver.c
+ * @brief Implements the packet receiver declared in packet_receiver.h.
+ */
+
+/* Include demo_config.h first for logging and other configuration */
+#include "demo_config.h"
+
+/* Standard includes. */
+#include <string.h>
+
+/* Packet receiver include. */
+#include "packet_receiver.h"
+
+/**
+ * @brief Maximum number of bytes of an encoded remaining length.
+ */
+#define MAX_REMAINING_LENGTH_BYTES    ( 4U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Frame the first packet of the received bytes that have not been
+ * framed yet.
+ *
+ * @param[in] pReceiver The receiver.
+ * @param[out] pPacket The framed packet.
+ *
+ * @return #PacketReceiverSuccess if a complete packet was framed;
+ * #PacketReceiverNoDataAvailable if more bytes are needed;
+ * #PacketReceiverNoMemory or #PacketReceiverBadResponse if the packet
+ * cannot be framed.
+ */
+static PacketReceiverStatus_t framePacket( PacketReceiver_t * pReceiver,
+                                           MQTTPacketInfo_t * pPacket );
+
+/*-----------------------------------------------------------*/
+
+static PacketReceiverStatus_t framePacket( PacketReceiver_t * pReceiver,
+                                           MQTTPacketInfo_t * pPacket )
+{
+    PacketReceiverStatus_t status = PacketReceiverNoDataAvailable;
+    const uint8_t * pStart = &pReceiver->pBuffer[ pReceiver->readOffset ];
+    size_t available = pReceiver->writeOffset - pReceiver->readOffset;
+    size_t index = 1U;
+    size_t remainingLength = 0U;
+    size_t multiplier = 1U;
+    size_t packetLength = 0U;
+    bool lengthDecoded = false;
+
+    /* Decode the remaining length that follows the packet type byte. */
+    while( ( lengthDecoded == false ) &&
+           ( status == PacketReceiverNoDataAvailable ) &&
+           ( index < available ) )
+    {
+        remainingLength += ( size_t ) ( pStart[ index ] & 0x7FU ) * multiplier;
+        multiplier *= 128U;
+        lengthDecoded = ( ( pStart[ index ] & 0x80U ) == 0U );
+        index++;
+
+        if( ( lengthDecoded == false ) && ( index > MAX_REMAINING_LENGTH_BYTES ) )
+        {
+            LogError( ( "Incoming packet has a malformed remaining length." ) );
+            status = PacketReceiverBadResponse;
+        }
+    }
+
+    if( lengthDecoded == true )
+    {
+        packetLength = index + remainingLength;
+
+        if( packetLength > pReceiver->bufferSize )
+        {
+            LogError( ( "Incoming packet of %lu bytes does not fit the receive "
+                        "buffer of %lu bytes.",
+                        ( unsigned long ) packetLength,
+                        ( unsigned long ) pReceiver->bufferSize ) );
+            status = PacketReceiverNoMemory;
+        }
+        else if( packetLength <= available )
+        {
+            pPacket->type = pStart[ 0 ];
+            pPacket->remainingLength = remainingLength;
+            pPacket->pRemainingData = &pReceiver->pBuffer[ pReceiver->readOffset + index ];
+            pReceiver->readOffset += packetLength;
+            status = PacketReceiverSuccess;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PacketReceiverStatus_t PacketReceiver_Init( PacketReceiver_t * pReceiver,
+                                            NetworkContext_t * pNetworkContext,
+                                            TransportRecv_t recv,
+                                            uint8_t * pBuffer,
+                                            size_t bufferSize )
+{
+    PacketReceiverStatus_t status = PacketReceiverSuccess;
+
+    if( ( pReceiver == NULL ) || ( recv == NULL ) ||
+        ( pBuffer == NULL ) || ( bufferSize <= MAX_REMAINING_LENGTH_BYTES ) )
+    {
+        LogError( ( "Invalid parameter: pReceiver=%p, pBuffer=%p, bufferSize=%lu.",
+                    ( void * ) pReceiver,
+                    ( void * ) pBuffer,
+                    ( unsigned long ) bufferSize ) );
+        status = PacketReceiverBadParameter;
+    }
+    else
+    {
+        pReceiver->pNetworkContext = pNetworkContext;
+        pReceiver->recv = recv;
+        pReceiver->pBuffer = pBuffer;
+        pReceiver->bufferSize = bufferSize;
+        pReceiver->readOffset = 0U;
+        pReceiver->writeOffset = 0U;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PacketReceiverStatus_t PacketReceiver_Next( PacketReceiver_t * pReceiver,
+                                            MQTTPacketInfo_t * pPacket )
+{
+    PacketReceiverStatus_t status = PacketReceiverSuccess;
+    size_t pending = 0U;
+    int32_t bytesReceived = 0;
+
+    if( ( pReceiver == NULL ) || ( pPacket == NULL ) )
+    {
+        status = PacketReceiverBadParameter;
+    }
+    else
+    {
+        status = framePacket( pReceiver, pPacket );
+    }
+
+    if( status == PacketReceiverNoDataAvailable )
+    {
+        /* Every complete packet has been returned, so no view refers to the
+         * buffer any more. Move the start of a partly received packet to the
+         * front, to receive the rest after it. */
+        pending = pReceiver->writeOffset - pReceiver->readOffset;
+
+        if( ( pReceiver->readOffset > 0U ) && ( pending > 0U ) )
+        {
+            ( void ) memmove( pReceiver->pBuffer,
+                              &pReceiver->pBuffer[ pReceiver->readOffset ],
+                              pending );
+        }
+
+        pReceiver->readOffset = 0U;
+        pReceiver->writeOffset = pending;
+
+        bytesReceived = pReceiver->recv( pReceiver->pNetworkContext,
+                                         &pReceiver->pBuffer[ pending ],
+                                         pReceiver->bufferSize - pending );
+
+        if( bytesReceived < 0 )
+        {
+            LogError( ( "Failed to receive from the network: Status=%ld.",
+                        ( long ) bytesReceived ) );
+            status = PacketReceiverRecvFailed;
+        }
+        else if( bytesReceived > 0 )
+        {
+            pReceiver->writeOffset += ( size_t ) bytesReceived;
+            status = framePacket( pReceiver, pPacket );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
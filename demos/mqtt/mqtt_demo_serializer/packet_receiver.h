@@ -0,0 +1,119 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file packet_receiver.h
+ * @brief Receives MQTT packets in large reads and frames them in place.
+ *
+ * Reading a packet with #MQTT_GetIncomingPacketTypeAndLength takes a read for
+ * the type and for each byte of the remaining length, then another read for
+ * the rest of the packet. The packet receiver instead reads as many bytes as
+ * its buffer has room for, and frames every complete packet in them. Each
+ * packet is returned as a view of the buffer rather than a copy, so that a
+ * burst of incoming packets costs a single read.
+ */
+
+#ifndef PACKET_RECEIVER_H_
+#define PACKET_RECEIVER_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* MQTT Serializer API header. */
+#include "core_mqtt_serializer.h"
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/**
+ * @brief Return codes of the packet receiver.
+ */
+typedef enum PacketReceiverStatus
+{
+    PacketReceiverSuccess = 0,      /**< @brief A complete packet was returned. */
+    PacketReceiverBadParameter,     /**< @brief An argument was invalid. */
+    PacketReceiverNoDataAvailable,  /**< @brief No complete packet has been received yet. */
+    PacketReceiverNoMemory,         /**< @brief The next packet is larger than the buffer. */
+    PacketReceiverBadResponse,      /**< @brief The remaining length of the next packet is malformed. */
+    PacketReceiverRecvFailed        /**< @brief The transport failed to receive. */
+} PacketReceiverStatus_t;
+
+/**
+ * @brief Buffer and read offsets of a packet receiver.
+ *
+ * The members are private to the packet receiver.
+ */
+typedef struct PacketReceiver
+{
+    NetworkContext_t * pNetworkContext; /**< @brief The connection to receive from. */
+    TransportRecv_t recv;               /**< @brief The function that reads from the connection. */
+    uint8_t * pBuffer;                  /**< @brief Buffer received bytes are stored in. */
+    size_t bufferSize;                  /**< @brief Size of #PacketReceiver_t.pBuffer in bytes. */
+    size_t readOffset;                  /**< @brief Offset of the first byte not yet framed. */
+    size_t writeOffset;                 /**< @brief Offset one past the last received byte. */
+} PacketReceiver_t;
+
+/**
+ * @brief Initialize a packet receiver with an empty buffer.
+ *
+ * @param[out] pReceiver The receiver to initialize.
+ * @param[in] pNetworkContext The connection to receive from.
+ * @param[in] recv The function that reads from the connection, such as
+ * #Plaintext_Recv.
+ * @param[in] pBuffer Buffer to receive into. It must stay valid while the
+ * receiver is used, and be able to hold the largest expected packet.
+ * @param[in] bufferSize Size of @p pBuffer in bytes.
+ *
+ * @return #PacketReceiverSuccess, or #PacketReceiverBadParameter if a pointer
+ * is NULL or the buffer cannot hold a fixed header of five bytes.
+ */
+PacketReceiverStatus_t PacketReceiver_Init( PacketReceiver_t * pReceiver,
+                                            NetworkContext_t * pNetworkContext,
+                                            TransportRecv_t recv,
+                                            uint8_t * pBuffer,
+                                            size_t bufferSize );
+
+/**
+ * @brief Get the next complete packet, reading from the connection only when
+ * none is buffered.
+ *
+ * At most one read is made per call, for all the free space of the buffer.
+ * The packet type, remaining length and remaining data of the packet are
+ * set in @p pPacket, ready for #MQTT_DeserializePublish or
+ * #MQTT_DeserializeAck.
+ *
+ * @param[in] pReceiver The receiver.
+ * @param[out] pPacket The next packet. Its remaining data points into the
+ * buffer of the receiver, and stays valid until the next call.
+ *
+ * @return #PacketReceiverSuccess if a packet was returned;
+ * #PacketReceiverNoDataAvailable if no complete packet has arrived yet, in
+ * which case the call may be repeated; #PacketReceiverNoMemory or
+ * #PacketReceiverBadResponse if the next packet cannot be framed, after
+ * which the connection should be closed; #PacketReceiverRecvFailed if the
+ * transport failed; #PacketReceiverBadParameter if a pointer is NULL.
+ */
+PacketReceiverStatus_t PacketReceiver_Next( PacketReceiver_t * pReceiver,
+                                            MQTTPacketInfo_t * pPacket );
+
+#endif /* ifndef PACKET_RECEIVER_H_ */
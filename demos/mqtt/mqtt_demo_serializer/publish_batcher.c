@@ -0,0 +1,361 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_batcher.c
+ * @brief Implements the publish batcher declared in publish_batcher.h.
+ */
+
+/* Include demo_config.h first for logging and other configuration */
+#include "demo_config.h"
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* Publish batcher include. */
+#include "publish_batcher.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append bytes at the end of the used buffer to the batch, extending
+ * the last I/O vector when it ends where they start.
+ *
+ * @param[in] pBatcher The batcher.
+ * @param[in] length Number of bytes written at the end of the used buffer.
+ */
+static void appendBuffer( PublishBatcher_t * pBatcher,
+                          size_t length );
+
+/**
+ * @brief Advance the I/O vectors of the batch past bytes that were sent.
+ *
+ * @param[in] pIoVectors The I/O vectors left to send.
+ * @param[in] ioVectorCount Number of @p pIoVectors.
+ * @param[in] bytesSent Number of bytes sent from the I/O vectors.
+ *
+ * @return Number of leading I/O vectors that were sent completely.
+ */
+static size_t advanceVectors( struct iovec * pIoVectors,
+                              size_t ioVectorCount,
+                              size_t bytesSent );
+
+/**
+ * @brief Empty the batch.
+ *
+ * @param[in] pBatcher The batcher.
+ */
+static void resetBatch( PublishBatcher_t * pBatcher );
+
+/*-----------------------------------------------------------*/
+
+static void appendBuffer( PublishBatcher_t * pBatcher,
+                          size_t length )
+{
+    uint8_t * pStart = &pBatcher->config.pBuffer[ pBatcher->bufferUsed ];
+    struct iovec * pLast = NULL;
+
+    if( pBatcher->vectorsUsed > 0U )
+    {
+        pLast = &pBatcher->config.pIoVectors[ pBatcher->vectorsUsed - 1U ];
+    }
+
+    if( ( pLast != NULL ) &&
+        ( ( ( uint8_t * ) pLast->iov_base + pLast->iov_len ) == pStart ) )
+    {
+        pLast->iov_len += length;
+    }
+    else
+    {
+        assert( pBatcher->vectorsUsed < pBatcher->config.ioVectorCount );
+        pLast = &pBatcher->config.pIoVectors[ pBatcher->vectorsUsed ];
+        pLast->iov_base = pStart;
+        pLast->iov_len = length;
+        pBatcher->vectorsUsed++;
+    }
+
+    pBatcher->bufferUsed += length;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t advanceVectors( struct iovec * pIoVectors,
+                              size_t ioVectorCount,
+                              size_t bytesSent )
+{
+    size_t index = 0U;
+    size_t remaining = bytesSent;
+
+    while( ( index < ioVectorCount ) && ( remaining >= pIoVectors[ index ].iov_len ) )
+    {
+        remaining -= pIoVectors[ index ].iov_len;
+        index++;
+    }
+
+    if( ( index < ioVectorCount ) && ( remaining > 0U ) )
+    {
+        pIoVectors[ index ].iov_base = ( uint8_t * ) pIoVectors[ index ].iov_base + remaining;
+        pIoVectors[ index ].iov_len -= remaining;
+    }
+
+    return index;
+}
+
+/*-----------------------------------------------------------*/
+
+static void resetBatch( PublishBatcher_t * pBatcher )
+{
+    pBatcher->bufferUsed = 0U;
+    pBatcher->vectorsUsed = 0U;
+    pBatcher->queuedBytes = 0U;
+    pBatcher->packetCount = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishBatcherStatus_t PublishBatcher_Init( PublishBatcher_t * pBatcher,
+                                            const PublishBatcherConfig_t * pConfig )
+{
+    PublishBatcherStatus_t status = PublishBatcherSuccess;
+
+    if( ( pBatcher == NULL ) || ( pConfig == NULL ) ||
+        ( pConfig->writev == NULL ) || ( pConfig->pBuffer == NULL ) ||
+        ( pConfig->pIoVectors == NULL ) || ( pConfig->ioVectorCount < 2U ) )
+    {
+        LogError( ( "Invalid parameter: pBatcher=%p, pConfig=%p.",
+                    ( void * ) pBatcher,
+                    ( const void * ) pConfig ) );
+        status = PublishBatcherBadParameter;
+    }
+    else
+    {
+        pBatcher->config = *pConfig;
+        pBatcher->firstQueuedMs = 0U;
+        resetBatch( pBatcher );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishBatcherStatus_t PublishBatcher_Add( PublishBatcher_t * pBatcher,
+                                           const MQTTPublishInfo_t * pPublishInfo,
+                                           uint16_t packetId,
+                                           uint32_t nowMs )
+{
+    PublishBatcherStatus_t status = PublishBatcherSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTFixedBuffer_t fixedBuffer;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+    size_t headerSize = 0U;
+    size_t bufferNeeded = 0U;
+    size_t vectorsNeeded = 0U;
+    bool copyPayload = false;
+
+    if( ( pBatcher == NULL ) || ( pPublishInfo == NULL ) )
+    {
+        status = PublishBatcherBadParameter;
+    }
+    else if( MQTT_GetPublishPacketSize( pPublishInfo, &remainingLength, &packetSize ) != MQTTSuccess )
+    {
+        LogError( ( "Failed to get the size of a PUBLISH packet." ) );
+        status = PublishBatcherBadParameter;
+    }
+    else
+    {
+        headerSize = packetSize - pPublishInfo->payloadLength;
+        copyPayload = ( pPublishInfo->payloadLength <= PUBLISH_BATCHER_COPY_THRESHOLD ) &&
+                      ( packetSize <= pBatcher->config.bufferSize );
+        bufferNeeded = copyPayload ? packetSize : headerSize;
+
+        /* The header may start a new I/O vector, and a payload that is not
+         * copied takes one more. */
+        vectorsNeeded = copyPayload ? 1U : 2U;
+
+        if( headerSize > pBatcher->config.bufferSize )
+        {
+            LogError( ( "PUBLISH header of %lu bytes does not fit the batch buffer.",
+                        ( unsigned long ) headerSize ) );
+            status = PublishBatcherNoMemory;
+        }
+        else if( ( ( pBatcher->bufferUsed + bufferNeeded ) > pBatcher->config.bufferSize ) ||
+                 ( ( pBatcher->vectorsUsed + vectorsNeeded ) > pBatcher->config.ioVectorCount ) )
+        {
+            status = PublishBatcher_Flush( pBatcher );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( status == PublishBatcherSuccess )
+    {
+        fixedBuffer.pBuffer = &pBatcher->config.pBuffer[ pBatcher->bufferUsed ];
+        fixedBuffer.size = pBatcher->config.bufferSize - pBatcher->bufferUsed;
+        mqttStatus = MQTT_SerializePublishHeader( pPublishInfo,
+                                                  packetId,
+                                                  remainingLength,
+                                                  &fixedBuffer,
+                                                  &headerSize );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Failed to serialize a PUBLISH header: Status=%d.",
+                        ( int ) mqttStatus ) );
+            status = PublishBatcherBadParameter;
+        }
+    }
+
+    if( status == PublishBatcherSuccess )
+    {
+        appendBuffer( pBatcher, headerSize );
+
+        if( copyPayload == true )
+        {
+            if( pPublishInfo->payloadLength > 0U )
+            {
+                ( void ) memcpy( &pBatcher->config.pBuffer[ pBatcher->bufferUsed ],
+                                 pPublishInfo->pPayload,
+                                 pPublishInfo->payloadLength );
+                appendBuffer( pBatcher, pPublishInfo->payloadLength );
+            }
+        }
+        else
+        {
+            pBatcher->config.pIoVectors[ pBatcher->vectorsUsed ].iov_base = ( void * ) pPublishInfo->pPayload;
+            pBatcher->config.pIoVectors[ pBatcher->vectorsUsed ].iov_len = pPublishInfo->payloadLength;
+            pBatcher->vectorsUsed++;
+        }
+
+        if( pBatcher->packetCount == 0U )
+        {
+            pBatcher->firstQueuedMs = nowMs;
+        }
+
+        pBatcher->packetCount++;
+        pBatcher->queuedBytes += headerSize + pPublishInfo->payloadLength;
+
+        if( pBatcher->queuedBytes >= pBatcher->config.flushBytes )
+        {
+            status = PublishBatcher_Flush( pBatcher );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishBatcherStatus_t PublishBatcher_Poll( PublishBatcher_t * pBatcher,
+                                            uint32_t nowMs )
+{
+    PublishBatcherStatus_t status = PublishBatcherSuccess;
+
+    if( pBatcher == NULL )
+    {
+        status = PublishBatcherBadParameter;
+    }
+    else if( ( pBatcher->packetCount > 0U ) &&
+             ( ( nowMs - pBatcher->firstQueuedMs ) >= pBatcher->config.flushDelayMs ) )
+    {
+        status = PublishBatcher_Flush( pBatcher );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishBatcherStatus_t PublishBatcher_Flush( PublishBatcher_t * pBatcher )
+{
+    PublishBatcherStatus_t status = PublishBatcherSuccess;
+    size_t index = 0U;
+    size_t bytesLeft = 0U;
+    uint32_t emptySends = 0U;
+    int32_t bytesSent = 0;
+
+    if( pBatcher == NULL )
+    {
+        status = PublishBatcherBadParameter;
+    }
+    else
+    {
+        bytesLeft = pBatcher->queuedBytes;
+
+        while( ( status == PublishBatcherSuccess ) && ( bytesLeft > 0U ) )
+        {
+            bytesSent = pBatcher->config.writev( pBatcher->config.pNetworkContext,
+                                                 &pBatcher->config.pIoVectors[ index ],
+                                                 pBatcher->vectorsUsed - index );
+
+            if( bytesSent < 0 )
+            {
+                LogError( ( "Failed to send a batch of %lu PUBLISH packets: "
+                            "BytesLeft=%lu.",
+                            ( unsigned long ) pBatcher->packetCount,
+                            ( unsigned long ) bytesLeft ) );
+                status = PublishBatcherSendFailed;
+            }
+            else if( bytesSent == 0 )
+            {
+                emptySends++;
+
+                if( emptySends >= PUBLISH_BATCHER_MAX_EMPTY_SENDS )
+                {
+                    LogError( ( "Timed out sending a batch of PUBLISH packets: "
+                                "BytesLeft=%lu.",
+                                ( unsigned long ) bytesLeft ) );
+                    status = PublishBatcherSendFailed;
+                }
+            }
+            else
+            {
+                emptySends = 0U;
+                bytesLeft -= ( size_t ) bytesSent;
+                index += advanceVectors( &pBatcher->config.pIoVectors[ index ],
+                                         pBatcher->vectorsUsed - index,
+                                         ( size_t ) bytesSent );
+            }
+        }
+
+        if( ( status == PublishBatcherSuccess ) && ( pBatcher->packetCount > 0U ) )
+        {
+            LogDebug( ( "Sent a batch of %lu PUBLISH packets in %lu bytes.",
+                        ( unsigned long ) pBatcher->packetCount,
+                        ( unsigned long ) pBatcher->queuedBytes ) );
+        }
+
+        resetBatch( pBatcher );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
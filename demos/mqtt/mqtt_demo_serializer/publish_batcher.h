@@ -0,0 +1,188 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_batcher.h
+ * @brief Batches serialized MQTT PUBLISH packets into one transport write.
+ *
+ * Each PUBLISH header is serialized back to back into one buffer, and small
+ * payloads are copied after their header. Larger payloads are not copied; an
+ * I/O vector refers to them instead. The queued packets are sent with one
+ * vectored write once they total a size threshold, the I/O vectors run out,
+ * or the oldest packet has waited for a time threshold. A burst of small
+ * publishes then costs one system call, and fills TCP segments, instead of
+ * two writes per packet.
+ */
+
+#ifndef PUBLISH_BATCHER_H_
+#define PUBLISH_BATCHER_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <sys/uio.h>
+
+/* MQTT Serializer API header. */
+#include "core_mqtt_serializer.h"
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/**
+ * @brief Payloads up to this many bytes are copied into the batch buffer after
+ * their header, so that they do not take an I/O vector of their own.
+ */
+#ifndef PUBLISH_BATCHER_COPY_THRESHOLD
+    #define PUBLISH_BATCHER_COPY_THRESHOLD    ( 64U )
+#endif
+
+/**
+ * @brief Number of consecutive writes that may send no bytes before a flush
+ * gives up.
+ */
+#ifndef PUBLISH_BATCHER_MAX_EMPTY_SENDS
+    #define PUBLISH_BATCHER_MAX_EMPTY_SENDS    ( 10U )
+#endif
+
+/**
+ * @brief Return codes of the publish batcher.
+ */
+typedef enum PublishBatcherStatus
+{
+    PublishBatcherSuccess = 0, /**< @brief The function completed successfully. */
+    PublishBatcherBadParameter,/**< @brief An argument was invalid. */
+    PublishBatcherNoMemory,    /**< @brief The packet header cannot fit an empty batch buffer. */
+    PublishBatcherSendFailed   /**< @brief The transport failed to send the batch. */
+} PublishBatcherStatus_t;
+
+/**
+ * @brief Transport function that sends an array of buffers with one write,
+ * such as #Plaintext_Writev.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] pIoVectors Array of the buffers to send.
+ * @param[in] ioVectorCount Number of buffers in @p pIoVectors.
+ *
+ * @return Number of bytes sent, which may be fewer than requested; negative
+ * value on error.
+ */
+typedef int32_t ( * PublishBatcherWritev_t )( const NetworkContext_t * pNetworkContext,
+                                              const struct iovec * pIoVectors,
+                                              size_t ioVectorCount );
+
+/**
+ * @brief Memory and thresholds of a publish batcher.
+ */
+typedef struct PublishBatcherConfig
+{
+    NetworkContext_t * pNetworkContext; /**< @brief The connection to publish on. */
+    PublishBatcherWritev_t writev;      /**< @brief The function that sends a batch. */
+    uint8_t * pBuffer;                  /**< @brief Buffer for headers and copied payloads. */
+    size_t bufferSize;                  /**< @brief Size of #PublishBatcherConfig_t.pBuffer in bytes. */
+    struct iovec * pIoVectors;          /**< @brief I/O vectors describing the batch. At least two. */
+    size_t ioVectorCount;               /**< @brief Number of #PublishBatcherConfig_t.pIoVectors. */
+    size_t flushBytes;                  /**< @brief Queued bytes that trigger a flush. */
+    uint32_t flushDelayMs;              /**< @brief Time the oldest packet waits before a flush. */
+} PublishBatcherConfig_t;
+
+/**
+ * @brief A batch of serialized PUBLISH packets waiting to be sent.
+ *
+ * The members are private to the publish batcher.
+ */
+typedef struct PublishBatcher
+{
+    PublishBatcherConfig_t config; /**< @brief The memory and thresholds passed to #PublishBatcher_Init. */
+    size_t bufferUsed;             /**< @brief Bytes of the buffer holding queued data. */
+    size_t vectorsUsed;            /**< @brief Number of I/O vectors describing queued data. */
+    size_t queuedBytes;            /**< @brief Total length of the queued packets. */
+    size_t packetCount;            /**< @brief Number of queued packets. */
+    uint32_t firstQueuedMs;        /**< @brief Time the oldest queued packet was added. */
+} PublishBatcher_t;
+
+/**
+ * @brief Initialize an empty publish batcher.
+ *
+ * @param[out] pBatcher The batcher to initialize.
+ * @param[in] pConfig The memory and thresholds of the batcher. The buffer and
+ * I/O vectors must stay valid while the batcher is used.
+ *
+ * @return #PublishBatcherSuccess, or #PublishBatcherBadParameter if a
+ * parameter is NULL, or fewer than two I/O vectors are given.
+ */
+PublishBatcherStatus_t PublishBatcher_Init( PublishBatcher_t * pBatcher,
+                                            const PublishBatcherConfig_t * pConfig );
+
+/**
+ * @brief Serialize a PUBLISH packet into the batch.
+ *
+ * Queued packets are flushed first when the packet would not fit the buffer
+ * or the I/O vectors, and the batch is flushed after the packet is added
+ * when it totals #PublishBatcherConfig_t.flushBytes.
+ *
+ * @param[in] pBatcher The batcher.
+ * @param[in] pPublishInfo The PUBLISH packet to serialize.
+ * @param[in] packetId Packet identifier of a QoS 1 or 2 PUBLISH, else 0.
+ * @param[in] nowMs The current time, usually from #Clock_GetTimeMs.
+ *
+ * @note A payload larger than #PUBLISH_BATCHER_COPY_THRESHOLD is not copied,
+ * and must stay valid until the batch is flushed.
+ *
+ * @return #PublishBatcherSuccess if the packet was queued or sent;
+ * #PublishBatcherBadParameter if the packet cannot be serialized;
+ * #PublishBatcherNoMemory if its header does not fit an empty buffer;
+ * #PublishBatcherSendFailed if a flush failed, in which case the packet may
+ * not have been queued.
+ */
+PublishBatcherStatus_t PublishBatcher_Add( PublishBatcher_t * pBatcher,
+                                           const MQTTPublishInfo_t * pPublishInfo,
+                                           uint16_t packetId,
+                                           uint32_t nowMs );
+
+/**
+ * @brief Flush the batch if its oldest packet has waited for
+ * #PublishBatcherConfig_t.flushDelayMs.
+ *
+ * @param[in] pBatcher The batcher.
+ * @param[in] nowMs The current time, usually from #Clock_GetTimeMs.
+ *
+ * @return #PublishBatcherSuccess if nothing was due or the batch was sent;
+ * #PublishBatcherSendFailed otherwise.
+ */
+PublishBatcherStatus_t PublishBatcher_Poll( PublishBatcher_t * pBatcher,
+                                            uint32_t nowMs );
+
+/**
+ * @brief Send all queued packets with as few writes as the transport allows.
+ *
+ * @param[in] pBatcher The batcher.
+ *
+ * @return #PublishBatcherSuccess if the batch was sent, or was empty;
+ * #PublishBatcherBadParameter if @p pBatcher is NULL;
+ * #PublishBatcherSendFailed if the transport failed. The batch is emptied in
+ * either case, since a partly sent packet cannot be resent on the connection.
+ */
+PublishBatcherStatus_t PublishBatcher_Flush( PublishBatcher_t * pBatcher );
+
+#endif /* ifndef PUBLISH_BATCHER_H_ */
@@ -0,0 +1,518 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Demo for running many MQTT sessions at once with the session runtime.
+ *
+ * Each session keeps its state in its own MqttSession_t rather than in
+ * globals. The runtime spreads the sessions across one worker thread per
+ * core, each with its own event loop, timer wheel and network buffer pool.
+ * The main thread connects the sessions, then asks the worker thread of each
+ * session to publish to the topic the session is subscribed to, and counts
+ * the messages that come back. The example uses plaintext TCP and QoS 0.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* Plaintext sockets transport implementation. */
+#include "plaintext_posix.h"
+
+/* Clock for timer. */
+#include "clock.h"
+
+/* Runs the sessions on one thread per core. */
+#include "session_runtime.h"
+
+/**
+ * These configuration settings are required to run the sessions demo.
+ * Throw compilation error if the below configs are not defined.
+ */
+#ifndef BROKER_ENDPOINT
+    #error "Please define an MQTT broker endpoint, BROKER_ENDPOINT, in demo_config.h."
+#endif
+#ifndef CLIENT_IDENTIFIER
+    #error "Please define a unique CLIENT_IDENTIFIER in demo_config.h."
+#endif
+
+/**
+ * Provide default values for undefined configuration settings.
+ */
+#ifndef BROKER_PORT
+    #define BROKER_PORT    ( 1883 )
+#endif
+
+#ifndef DEMO_SESSION_COUNT
+    #define DEMO_SESSION_COUNT    ( 8U )
+#endif
+
+/**
+ * @brief Length of MQTT server host name.
+ */
+#define BROKER_ENDPOINT_LENGTH              ( ( uint16_t ) ( sizeof( BROKER_ENDPOINT ) - 1 ) )
+
+/**
+ * @brief Size of the buffers holding the client identifier and topic of a
+ * session.
+ */
+#define SESSION_NAME_BUFFER_SIZE            ( 128U )
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milli seconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS             ( 1000U )
+
+/**
+ * @brief Timeout for connecting the socket, and for sending or receiving the
+ * rest of a packet once part of it has been transferred, in milliseconds.
+ */
+#define TRANSPORT_TIMEOUT_MS                ( 1000U )
+
+/**
+ * @brief The MQTT message each session publishes.
+ */
+#define MQTT_EXAMPLE_MESSAGE                "Hello World!"
+
+/**
+ * @brief The length of the MQTT message each session publishes.
+ */
+#define MQTT_EXAMPLE_MESSAGE_LENGTH         ( ( uint16_t ) ( sizeof( MQTT_EXAMPLE_MESSAGE ) - 1 ) )
+
+/**
+ * @brief The maximum time interval in seconds which is allowed to elapse
+ * between two Control Packets.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS    ( 60U )
+
+/**
+ * @brief Number of times each session publishes.
+ */
+#define PUBLISH_COUNT                       ( 5U )
+
+/**
+ * @brief Delay between publishes in milliseconds.
+ */
+#define DELAY_BETWEEN_PUBLISHES_MS          ( 1000U )
+
+/**
+ * @brief Time to wait for the last messages to come back, in milliseconds.
+ */
+#define RECEIVE_TIMEOUT_MS                  ( 2000U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The state the demo keeps for each session, next to the state of
+ * the runtime.
+ */
+typedef struct DemoSession
+{
+    MqttSession_t session;                                /**< @brief The session run by the runtime. */
+    NetworkContext_t networkContext;                      /**< @brief The plaintext connection. */
+    TransportInterface_t transport;                       /**< @brief Transport of the connection. */
+    char clientIdentifier[ SESSION_NAME_BUFFER_SIZE ];    /**< @brief Client identifier of the session. */
+    uint16_t clientIdentifierLength;                      /**< @brief Length of the client identifier. */
+    char topic[ SESSION_NAME_BUFFER_SIZE ];               /**< @brief Topic the session publishes and subscribes to. */
+    uint16_t topicLength;                                 /**< @brief Length of the topic. */
+    bool connected;                                       /**< @brief Whether the transport is connected. */
+    bool running;                                         /**< @brief Whether the runtime runs the session, updated atomically. */
+} DemoSession_t;
+
+/**
+ * @brief The runtime, which is too large for the stack.
+ */
+static SessionRuntime_t runtime;
+
+/**
+ * @brief The sessions of the demo.
+ */
+static DemoSession_t demoSessions[ DEMO_SESSION_COUNT ];
+
+/**
+ * @brief Number of messages received by all sessions, updated atomically.
+ */
+static uint32_t receiveCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect the transport of a session, establish its MQTT session,
+ * subscribe to its topic, and hand it to the runtime.
+ *
+ * @param[in] pDemoSession The session.
+ * @param[in] index Index of the session, which makes its client identifier
+ * and topic unique.
+ *
+ * @return EXIT_SUCCESS if the runtime runs the session; EXIT_FAILURE
+ * otherwise.
+ */
+static int startDemoSession( DemoSession_t * pDemoSession,
+                             uint32_t index );
+
+/**
+ * @brief Packet callback of the sessions, which counts the messages that
+ * come back.
+ *
+ * @param[in] pSession The session.
+ * @param[in] pPacketInfo The received packet.
+ * @param[in] pDeserializedInfo The deserialized fields of the packet.
+ */
+static void packetCallback( MqttSession_t * pSession,
+                            MQTTPacketInfo_t * pPacketInfo,
+                            MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Work callback of the sessions, which publishes a message on the
+ * worker thread of the session.
+ *
+ * @param[in] pSession The session.
+ */
+static void publishWork( MqttSession_t * pSession );
+
+/**
+ * @brief Closed callback of the sessions.
+ *
+ * @param[in] pSession The session.
+ * @param[in] status Status of the process loop that failed.
+ */
+static void sessionClosed( MqttSession_t * pSession,
+                           MQTTStatus_t status );
+
+/*-----------------------------------------------------------*/
+
+static int startDemoSession( DemoSession_t * pDemoSession,
+                             uint32_t index )
+{
+    int returnStatus = EXIT_SUCCESS;
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    ServerInfo_t serverInfo;
+    SocketsConfig_t socketsConfig;
+    MqttSessionConfig_t sessionConfig;
+    MQTTConnectInfo_t connectInfo;
+    MQTTSubscribeInfo_t subscribeInfo;
+    bool sessionPresent = false;
+
+    pDemoSession->clientIdentifierLength = ( uint16_t ) snprintf( pDemoSession->clientIdentifier,
+                                                                  sizeof( pDemoSession->clientIdentifier ),
+                                                                  "%s-%u",
+                                                                  CLIENT_IDENTIFIER,
+                                                                  ( unsigned int ) index );
+    pDemoSession->topicLength = ( uint16_t ) snprintf( pDemoSession->topic,
+                                                       sizeof( pDemoSession->topic ),
+                                                       "%s/example/topic",
+                                                       pDemoSession->clientIdentifier );
+
+    serverInfo.pHostName = BROKER_ENDPOINT;
+    serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
+    serverInfo.port = BROKER_PORT;
+
+    /* The socket is non-blocking, so that a receive only waits when part of
+     * a packet has arrived and a worker thread is never held up by one
+     * session. */
+    ( void ) memset( &socketsConfig, 0x00, sizeof( socketsConfig ) );
+    socketsConfig.sendTimeoutMs = TRANSPORT_TIMEOUT_MS;
+    socketsConfig.recvTimeoutMs = TRANSPORT_TIMEOUT_MS;
+    socketsConfig.connectTimeoutMs = TRANSPORT_TIMEOUT_MS;
+    socketsConfig.nonBlocking = true;
+
+    ( void ) memset( &pDemoSession->networkContext, 0x00, sizeof( NetworkContext_t ) );
+    socketStatus = Plaintext_ConnectWithConfig( &pDemoSession->networkContext,
+                                                &serverInfo,
+                                                &socketsConfig );
+
+    if( socketStatus != SOCKETS_SUCCESS )
+    {
+        LogError( ( "Session %s failed to connect to %.*s:%d: Status=%d.",
+                    pDemoSession->clientIdentifier,
+                    BROKER_ENDPOINT_LENGTH,
+                    BROKER_ENDPOINT,
+                    BROKER_PORT,
+                    ( int ) socketStatus ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        pDemoSession->connected = true;
+
+        pDemoSession->transport.pNetworkContext = &pDemoSession->networkContext;
+        pDemoSession->transport.send = Plaintext_Send;
+        pDemoSession->transport.recv = Plaintext_Recv;
+
+        ( void ) memset( &sessionConfig, 0x00, sizeof( sessionConfig ) );
+        sessionConfig.pTransport = &pDemoSession->transport;
+        sessionConfig.socketDescriptor = pDemoSession->networkContext.socketDescriptor;
+        sessionConfig.packetCallback = packetCallback;
+        sessionConfig.workCallback = publishWork;
+        sessionConfig.closedCallback = sessionClosed;
+        sessionConfig.pUserContext = pDemoSession;
+
+        if( SessionRuntime_InitSession( &runtime,
+                                        &pDemoSession->session,
+                                        &sessionConfig ) != SessionRuntimeSuccess )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    /* Until the session is started, this thread calls coreMQTT for it. */
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        ( void ) memset( &connectInfo, 0x00, sizeof( connectInfo ) );
+        connectInfo.cleanSession = true;
+        connectInfo.pClientIdentifier = pDemoSession->clientIdentifier;
+        connectInfo.clientIdentifierLength = pDemoSession->clientIdentifierLength;
+        connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+
+        mqttStatus = MQTT_Connect( &pDemoSession->session.mqttContext,
+                                   &connectInfo,
+                                   NULL,
+                                   CONNACK_RECV_TIMEOUT_MS,
+                                   &sessionPresent );
+
+        if( mqttStatus == MQTTSuccess )
+        {
+            /* The SUBACK is received by the worker thread of the session. */
+            ( void ) memset( &subscribeInfo, 0x00, sizeof( subscribeInfo ) );
+            subscribeInfo.qos = MQTTQoS0;
+            subscribeInfo.pTopicFilter = pDemoSession->topic;
+            subscribeInfo.topicFilterLength = pDemoSession->topicLength;
+
+            mqttStatus = MQTT_Subscribe( &pDemoSession->session.mqttContext,
+                                         &subscribeInfo,
+                                         1U,
+                                         MQTT_GetPacketId( &pDemoSession->session.mqttContext ) );
+        }
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Session %s failed to establish its MQTT session: Status=%s.",
+                        pDemoSession->clientIdentifier,
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        __atomic_store_n( &pDemoSession->running, true, __ATOMIC_RELEASE );
+
+        if( SessionRuntime_StartSession( &pDemoSession->session ) != SessionRuntimeSuccess )
+        {
+            __atomic_store_n( &pDemoSession->running, false, __ATOMIC_RELEASE );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    if( ( returnStatus == EXIT_FAILURE ) && ( pDemoSession->connected == true ) )
+    {
+        ( void ) Plaintext_Disconnect( &pDemoSession->networkContext );
+        pDemoSession->connected = false;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void packetCallback( MqttSession_t * pSession,
+                            MQTTPacketInfo_t * pPacketInfo,
+                            MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    DemoSession_t * pDemoSession = ( DemoSession_t * ) pSession->pUserContext;
+
+    ( void ) pDeserializedInfo;
+
+    if( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+    {
+        LogDebug( ( "Session %s received its message.",
+                    pDemoSession->clientIdentifier ) );
+        ( void ) __atomic_add_fetch( &receiveCount, 1U, __ATOMIC_RELAXED );
+    }
+    else if( pPacketInfo->type == MQTT_PACKET_TYPE_SUBACK )
+    {
+        LogInfo( ( "Session %s subscribed to %.*s.",
+                   pDemoSession->clientIdentifier,
+                   pDemoSession->topicLength,
+                   pDemoSession->topic ) );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void publishWork( MqttSession_t * pSession )
+{
+    DemoSession_t * pDemoSession = ( DemoSession_t * ) pSession->pUserContext;
+    MQTTPublishInfo_t publishInfo;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS0;
+    publishInfo.pTopicName = pDemoSession->topic;
+    publishInfo.topicNameLength = pDemoSession->topicLength;
+    publishInfo.pPayload = MQTT_EXAMPLE_MESSAGE;
+    publishInfo.payloadLength = MQTT_EXAMPLE_MESSAGE_LENGTH;
+
+    mqttStatus = MQTT_Publish( &pSession->mqttContext, &publishInfo, 0U );
+
+    if( mqttStatus != MQTTSuccess )
+    {
+        LogError( ( "Session %s failed to publish: Status=%s.",
+                    pDemoSession->clientIdentifier,
+                    MQTT_Status_strerror( mqttStatus ) ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void sessionClosed( MqttSession_t * pSession,
+                           MQTTStatus_t status )
+{
+    DemoSession_t * pDemoSession = ( DemoSession_t * ) pSession->pUserContext;
+
+    LogError( ( "Session %s lost its connection: Status=%s.",
+                pDemoSession->clientIdentifier,
+                MQTT_Status_strerror( status ) ) );
+
+    /* The main thread disconnects the transport once the runtime stops. */
+    __atomic_store_n( &pDemoSession->running, false, __ATOMIC_RELEASE );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry point of demo.
+ *
+ * The example shown below connects #DEMO_SESSION_COUNT sessions to the
+ * broker, hands them to the session runtime, and has each of them publish
+ * #PUBLISH_COUNT messages to its own topic from its worker thread.
+ *
+ * @return EXIT_SUCCESS if every message came back; EXIT_FAILURE otherwise.
+ */
+int main( int argc,
+          char ** argv )
+{
+    int returnStatus = EXIT_SUCCESS;
+    uint32_t index = 0U, round = 0U, startedCount = 0U, expectedCount = 0U;
+    uint32_t entryTimeMs = 0U;
+
+    ( void ) argc;
+    ( void ) argv;
+
+    if( SessionRuntime_Init( &runtime, 0U ) != SessionRuntimeSuccess )
+    {
+        LogError( ( "Failed to start the session runtime." ) );
+        returnStatus = EXIT_FAILURE;
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        for( index = 0U; index < DEMO_SESSION_COUNT; index++ )
+        {
+            if( startDemoSession( &demoSessions[ index ], index ) == EXIT_SUCCESS )
+            {
+                startedCount++;
+            }
+        }
+
+        LogInfo( ( "Started %u of %u sessions on %u threads.",
+                   ( unsigned int ) startedCount,
+                   ( unsigned int ) DEMO_SESSION_COUNT,
+                   ( unsigned int ) runtime.shardCount ) );
+
+        if( startedCount < DEMO_SESSION_COUNT )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+
+        /* Each publish happens on the worker thread of its session. */
+        for( round = 0U; round < PUBLISH_COUNT; round++ )
+        {
+            for( index = 0U; index < DEMO_SESSION_COUNT; index++ )
+            {
+                if( __atomic_load_n( &demoSessions[ index ].running, __ATOMIC_ACQUIRE ) == true )
+                {
+                    ( void ) SessionRuntime_WakeSession( &demoSessions[ index ].session );
+                    expectedCount++;
+                }
+            }
+
+            Clock_SleepMs( DELAY_BETWEEN_PUBLISHES_MS );
+        }
+
+        entryTimeMs = Clock_GetTimeMs();
+
+        while( ( __atomic_load_n( &receiveCount, __ATOMIC_RELAXED ) < expectedCount ) &&
+               ( ( Clock_GetTimeMs() - entryTimeMs ) < RECEIVE_TIMEOUT_MS ) )
+        {
+            Clock_SleepMs( 100U );
+        }
+
+        LogInfo( ( "Received %u of %u messages.",
+                   ( unsigned int ) __atomic_load_n( &receiveCount, __ATOMIC_RELAXED ),
+                   ( unsigned int ) expectedCount ) );
+
+        if( __atomic_load_n( &receiveCount, __ATOMIC_RELAXED ) < expectedCount )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+
+        /* Once the runtime stops, this thread calls coreMQTT for the sessions
+         * again. */
+        SessionRuntime_Stop( &runtime );
+
+        for( index = 0U; index < DEMO_SESSION_COUNT; index++ )
+        {
+            if( demoSessions[ index ].running == true )
+            {
+                ( void ) MQTT_Disconnect( &demoSessions[ index ].session.mqttContext );
+            }
+
+            if( demoSessions[ index ].connected == true )
+            {
+                ( void ) Plaintext_Disconnect( &demoSessions[ index ].networkContext );
+                demoSessions[ index ].connected = false;
+            }
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        LogInfo( ( "Demo completed successfully." ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -100,4 +100,16 @@
  */
 #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
 
+/**
+ * @brief The algorithm to compress PUBLISH payloads with.
+ *
+ * Set to PayloadCodecZlib or PayloadCodecLz4 to send payloads compressed with
+ * a dictionary of common JSON keys, when compression makes them shorter. The
+ * algorithm must have been found by CMake. Compressed payloads start with a
+ * zero byte, and the subscription manager decompresses them before invoking
+ * the callbacks. The default PayloadCodecNone sends payloads as they are.
+ *
+ * #define DEMO_PAYLOAD_CODEC    PayloadCodecZlib
+ */
+
 #endif /* ifndef DEMO_CONFIG_H */
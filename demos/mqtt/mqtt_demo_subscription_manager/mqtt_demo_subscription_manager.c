@@ -218,6 +218,15 @@
  */
 #define TRANSPORT_SEND_RECV_TIMEOUT_MS          ( 200 )
 
+/**
+ * @brief The algorithm the demo compresses its PUBLISH payloads with, or
+ * PayloadCodecNone to send them as they are. It is only used when the
+ * subscription manager is built with SUBSCRIPTION_MANAGER_PAYLOAD_CODEC.
+ */
+#ifndef DEMO_PAYLOAD_CODEC
+    #define DEMO_PAYLOAD_CODEC    PayloadCodecNone
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -257,6 +266,22 @@ static uint16_t lastUnsubscribePacketIdentifier = 0U;
  */
 static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
+#if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+
+/**
+ * @brief The codec compressing outgoing payloads and decompressing incoming
+ * ones, when #DEMO_PAYLOAD_CODEC selects one.
+ */
+    static PayloadCodec_t payloadCodec;
+
+/**
+ * @brief Buffer for the compressed payload of an outgoing PUBLISH. It only
+ * needs to stay valid until #MQTT_Publish returns, as the demo does not resend
+ * PUBLISH messages.
+ */
+    static uint8_t compressBuffer[ NETWORK_BUFFER_SIZE ];
+#endif /* if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 ) */
+
 /**
  * @brief Flag to represent whether that the temperature callback has been invoked with
  * incoming PUBLISH message for high temperature data.
@@ -479,6 +504,30 @@ static int publishToTopicAndProcessIncomingMessage( MQTTContext_t * pMqttContext
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief The number of reconnect attempts that may start at once.
+ */
+#define RECONNECT_BUDGET_CAPACITY       ( 4U )
+
+/**
+ * @brief The interval in milliseconds at which the reconnect budget gains
+ * back one attempt.
+ */
+#define RECONNECT_BUDGET_REFILL_MS      ( 1000U )
+
+/**
+ * @brief The number of connection attempts that may be in progress at once.
+ */
+#define RECONNECT_BUDGET_MAX_IN_PROGRESS    ( 1U )
+
+/**
+ * @brief The retry budget that the connection attempts of the process draw
+ * from, so that they are spread over time after an outage.
+ */
+static RetryUtilsBudget_t reconnectBudget = RETRY_UTILS_BUDGET_INITIALIZER( RECONNECT_BUDGET_CAPACITY,
+                                                                            RECONNECT_BUDGET_REFILL_MS,
+                                                                            RECONNECT_BUDGET_MAX_IN_PROGRESS );
+
 static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext )
 {
     int returnStatus = EXIT_SUCCESS;
@@ -500,6 +549,11 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     /* Initialize reconnect attempts and interval. */
     RetryUtils_ParamsReset( &reconnectParams );
 
+    /* Take the first attempt from the reconnect budget. The attempts that
+     * fail are released, and the retries taken, by RetryUtils_BackoffAndSleep. */
+    reconnectParams.pBudget = &reconnectBudget;
+    ( void ) RetryUtils_BudgetAcquireAndSleep( reconnectParams.pBudget );
+
     /* Attempt to connect to MQTT broker. If connection fails, retry after
      * a timeout. Timeout value will exponentially increase until maximum
      * attempts are reached.
@@ -532,6 +586,12 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
         }
     } while( ( opensslStatus != OPENSSL_SUCCESS ) && ( retryUtilsStatus == RetryUtilsSuccess ) );
 
+    /* The attempt that succeeded is complete. */
+    if( opensslStatus == OPENSSL_SUCCESS )
+    {
+        ( void ) RetryUtils_BudgetRelease( &reconnectBudget );
+    }
+
     return returnStatus;
 }
 
@@ -953,6 +1013,10 @@ static int publishToTopicAndProcessIncomingMessage( MQTTContext_t * pMqttContext
     MQTTPublishInfo_t publishInfo = { 0 };
     uint16_t pubPacketId = MQTT_PACKET_ID_INVALID;
 
+    #if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+        size_t compressedLength = 0U;
+    #endif
+
     assert( pMqttContext != NULL );
 
     if( returnStatus == EXIT_FAILURE )
@@ -968,6 +1032,24 @@ static int publishToTopicAndProcessIncomingMessage( MQTTContext_t * pMqttContext
         publishInfo.pPayload = pMessage;
         publishInfo.payloadLength = strlen( pMessage );
 
+        /* Send the compressed payload when it is shorter; the subscription
+         * manager restores the original before invoking the callbacks. */
+        #if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+            if( PayloadCodec_Compress( &payloadCodec,
+                                       ( const uint8_t * ) pMessage,
+                                       publishInfo.payloadLength,
+                                       compressBuffer,
+                                       sizeof( compressBuffer ),
+                                       &compressedLength ) == PayloadCodecSuccess )
+            {
+                LogDebug( ( "Compressed PUBLISH payload: OriginalLength=%lu, CompressedLength=%lu",
+                            ( unsigned long ) publishInfo.payloadLength,
+                            ( unsigned long ) compressedLength ) );
+                publishInfo.pPayload = compressBuffer;
+                publishInfo.payloadLength = compressedLength;
+            }
+        #endif
+
         /* Get a new packet ID for the publish. */
         pubPacketId = MQTT_GetPacketId( pMqttContext );
 
@@ -1270,11 +1352,29 @@ int main( int argc,
           char ** argv )
 {
     int returnStatus = EXIT_SUCCESS;
-    NetworkContext_t networkContext;
+    NetworkContext_t networkContext = { 0 };
 
     ( void ) argc;
     ( void ) argv;
 
+    /* Compressed payloads are decompressed with the same dictionary for
+     * every algorithm, so only the algorithm used to publish is configured. */
+    #if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+        if( PayloadCodec_Init( &payloadCodec,
+                               DEMO_PAYLOAD_CODEC,
+                               ( const uint8_t * ) PAYLOAD_CODEC_DEFAULT_DICTIONARY,
+                               sizeof( PAYLOAD_CODEC_DEFAULT_DICTIONARY ) - 1U,
+                               PAYLOAD_CODEC_DEFAULT_DICTIONARY_ID ) == PayloadCodecSuccess )
+        {
+            SubscriptionManager_SetPayloadCodec( &payloadCodec );
+        }
+        else
+        {
+            LogWarn( ( "Payload compression is not available in this build; "
+                       "sending payloads as they are." ) );
+        }
+    #endif /* if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 ) */
+
     for( ; ; )
     {
         /* Attempt to connect to the MQTT broker. If connection fails, retry after
@@ -24,144 +24,1780 @@
  * @file mqtt_subscription_manager.c
  * @brief Implementation of the API of a subscription manager for handling subscription callbacks
  * to topic filters in MQTT operations.
+ *
+ * Registered topic filters are stored in a trie with one node per topic level.
+ * Exact levels are found through a hash table keyed by the parent node and the
+ * level string, while `+` and `#` levels hang off dedicated links of their parent
+ * node. Dispatching a PUBLISH therefore walks the levels of its topic name, and
+ * its cost does not grow with the number of registered topic filters. The same
+ * walk over the levels of a topic filter detects duplicate registrations.
+ *
+ * The nodes come from a statically allocated pool sized by
+ * #MAX_SUBSCRIPTION_TRIE_NODES, or from an arena supplied with
+ * #SubscriptionManager_Init. Free nodes are kept on a list and every node is
+ * linked to its children, so registering and removing a topic filter take time
+ * proportional to its number of levels.
+ *
+ * Topic filters without wildcards only ever match a topic name equal to them,
+ * so they bypass the trie: each is a single node keyed in the same hash table
+ * by its whole string. Dispatching looks the topic name up there with a single
+ * probe, and only walks the trie when wildcard topic filters are registered.
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <assert.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the subscription manager. */
+#include "mqtt_subscription_manager.h"
+
+/* Optional static tracepoints. */
+#include "trace_probes.h"
+
+/**
+ * @brief The default value for the maximum size of the callback registry in the
+ * subscription manager.
+ */
+#ifndef MAX_SUBSCRIPTION_CALLBACK_RECORDS
+    #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
+#endif
+
+/**
+ * @brief The maximum number of topic levels stored across all registered topic
+ * filters. Topic filters that share leading levels share trie nodes.
+ */
+#ifndef MAX_SUBSCRIPTION_TRIE_NODES
+    #define MAX_SUBSCRIPTION_TRIE_NODES    ( MAX_SUBSCRIPTION_CALLBACK_RECORDS * 8 )
+#endif
+
+/**
+ * @brief Set to 1 to allow registering and removing callbacks from other threads
+ * while #SubscriptionManager_DispatchHandler runs. Dispatch then never blocks,
+ * at the cost of keeping two copies of the registry.
+ */
+#ifndef SUBSCRIPTION_MANAGER_CONCURRENT
+    #define SUBSCRIPTION_MANAGER_CONCURRENT    0
+#endif
+
+/**
+ * @brief Maximum number of worker threads #SubscriptionManager_StartWorkers
+ * can start.
+ */
+#ifndef SUBSCRIPTION_MANAGER_MAX_WORKERS
+    #define SUBSCRIPTION_MANAGER_MAX_WORKERS    4
+#endif
+
+/**
+ * @brief Number of messages each worker can queue before dispatch waits.
+ */
+#ifndef SUBSCRIPTION_WORKER_QUEUE_DEPTH
+    #define SUBSCRIPTION_WORKER_QUEUE_DEPTH    4
+#endif
+
+/**
+ * @brief Space for the topic name and payload of a queued message. Larger
+ * messages are delivered on the dispatching thread.
+ */
+#ifndef SUBSCRIPTION_WORKER_BUFFER_SIZE
+    #define SUBSCRIPTION_WORKER_BUFFER_SIZE    512
+#endif
+
+/**
+ * @brief Maximum number of callbacks a queued message is delivered to.
+ */
+#ifndef SUBSCRIPTION_WORKER_MAX_CALLBACKS
+    #define SUBSCRIPTION_WORKER_MAX_CALLBACKS    8
+#endif
+
+/**
+ * @brief Size of the buffer compressed PUBLISH payloads are decompressed into,
+ * on the stack of the dispatching thread.
+ */
+#ifndef SUBSCRIPTION_MANAGER_DECOMPRESS_BUFFER_SIZE
+    #define SUBSCRIPTION_MANAGER_DECOMPRESS_BUFFER_SIZE    4096
+#endif
+
+#if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+    /* POSIX includes. */
+    #include <pthread.h>
+    #include <sched.h>
+#elif ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+    #error "SUBSCRIPTION_MANAGER_CONCURRENT needs SUBSCRIPTION_MANAGER_THREADS set to 1."
+#endif
+
+/**
+ * @brief Number of slots in the hash table of exact topic levels. Keeping it
+ * at least twice the number of nodes keeps probe sequences short.
+ */
+#define TRIE_TABLE_SIZE                    ( ( 2 * MAX_SUBSCRIPTION_TRIE_NODES ) + 1 )
+
+/**
+ * @brief Index of the root node, which represents the empty topic prefix.
+ */
+#define TRIE_ROOT                          ( 0U )
+
+/**
+ * @brief Marker for an absent node link, and for an empty hash table slot.
+ * The root is never a child, so index 0 is free to use for this.
+ */
+#define TRIE_NONE                          ( 0U )
+
+/**
+ * @brief Parent key of the nodes of topic filters without wildcards, which are
+ * stored outside the trie. No node has this index, as arenas are clamped to
+ * #TRIE_MAX_ARENA_NODES nodes.
+ */
+#define TRIE_EXACT_PARENT                  ( UINT16_MAX )
+
+/**
+ * @brief Separator between topic levels.
+ */
+#define TOPIC_LEVEL_SEPARATOR              '/'
+
+/**
+ * @brief Represents one topic level of a registered topic filter, and the
+ * callback of the topic filter that ends at this level, if any.
+ */
+typedef struct TopicTrieNode
+{
+    const char * pLevel;                    /**< @brief The topic level, pointing into a registered topic filter. */
+    uint16_t levelLength;                   /**< @brief Length of the topic level. */
+    uint16_t parent;                        /**< @brief Index of the parent node. */
+    uint16_t firstChild;                    /**< @brief Index of the first child of any kind, or #TRIE_NONE. */
+    uint16_t nextSibling;                   /**< @brief Next child of the parent, or next free node. */
+    uint16_t previousSibling;               /**< @brief Previous child of the parent, or #TRIE_NONE. */
+    uint16_t singleLevelChild;              /**< @brief Index of the `+` child, or #TRIE_NONE. */
+    uint16_t multiLevelChild;               /**< @brief Index of the `#` child, or #TRIE_NONE. */
+    const char * pTopicFilter;              /**< @brief Topic filter ending at this node, or NULL. */
+    uint16_t topicFilterLength;             /**< @brief Length of the topic filter. */
+    SubscriptionManagerCallback_t callback; /**< @brief Callback of the topic filter. */
+} TopicTrieNode_t;
+
+/**
+ * @brief Largest number of nodes an arena can hold, as nodes are addressed
+ * with 16-bit indices and #TRIE_NONE is reserved.
+ */
+#define TRIE_MAX_ARENA_NODES               ( UINT16_MAX )
+
+/**
+ * @brief The state of one copy of the registry.
+ */
+typedef struct SubscriptionRegistry
+{
+    TopicTrieNode_t * pNodes; /**< @brief The trie nodes. Node #TRIE_ROOT is always in use. */
+    uint16_t * pTable;        /**< @brief Hash table of exact topic level nodes keyed by parent and level, using linear probing. Each slot holds a node index or #TRIE_NONE. */
+    size_t nodeCapacity;      /**< @brief Number of nodes in pNodes, including the root. */
+    size_t tableSize;         /**< @brief Number of slots in pTable. */
+    size_t maxRecords;        /**< @brief Maximum number of topic filters that can be registered. */
+    uint16_t freeList;        /**< @brief Head of the list of free nodes, linked through their nextSibling field, or #TRIE_NONE. */
+    size_t recordCount;       /**< @brief Number of topic filters registered. */
+    size_t wildcardCount;     /**< @brief Number of registered topic filters that are stored in the trie. */
+} SubscriptionRegistry_t;
+
+/**
+ * @brief Number of copies of the registry. In concurrent mode, dispatch reads
+ * one copy while registration and removal update the other.
+ */
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+    #define SUBSCRIPTION_REGISTRY_COPIES    ( 2U )
+#else
+    #define SUBSCRIPTION_REGISTRY_COPIES    ( 1U )
+#endif
+
+/**
+ * @brief The statically allocated trie nodes used until
+ * #SubscriptionManager_Init supplies an arena.
+ */
+static TopicTrieNode_t defaultTrieNodes[ SUBSCRIPTION_REGISTRY_COPIES * MAX_SUBSCRIPTION_TRIE_NODES ];
+
+/**
+ * @brief The statically allocated hash tables used with #defaultTrieNodes.
+ */
+static uint16_t defaultChildTable[ SUBSCRIPTION_REGISTRY_COPIES * TRIE_TABLE_SIZE ];
+
+/**
+ * @brief The copies of the registry.
+ */
+static SubscriptionRegistry_t registries[ SUBSCRIPTION_REGISTRY_COPIES ];
+
+/**
+ * @brief Whether the registries have been set up for the current storage.
+ */
+static bool storageReady = false;
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+
+/**
+ * @brief Serializes registration, removal and #SubscriptionManager_Init.
+ */
+    static pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Index of the registry copy that dispatch reads. The other copy is
+ * only accessed by the writer holding #writerMutex.
+ */
+    static uint32_t publishedRegistry = 0U;
+
+/**
+ * @brief Number of dispatches reading each registry copy.
+ */
+    static uint32_t readerCounts[ SUBSCRIPTION_REGISTRY_COPIES ] = { 0U };
+
+    #define LOCK_REGISTRY_WRITER()      ( void ) pthread_mutex_lock( &writerMutex )
+    #define UNLOCK_REGISTRY_WRITER()    ( void ) pthread_mutex_unlock( &writerMutex )
+    #define WRITABLE_REGISTRY()         ( &registries[ 1U - publishedRegistry ] )
+#else
+    #define LOCK_REGISTRY_WRITER()
+    #define UNLOCK_REGISTRY_WRITER()
+    #define WRITABLE_REGISTRY()         ( &registries[ 0 ] )
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 ) */
+
+/**
+ * @brief The callbacks of the topic filters matching a PUBLISH, collected for
+ * delivery on a worker.
+ */
+typedef struct SubscriptionMatches
+{
+    SubscriptionManagerCallback_t callbacks[ SUBSCRIPTION_WORKER_MAX_CALLBACKS ]; /**< @brief The matching callbacks, in dispatch order. */
+    size_t count;                                                                 /**< @brief Number of callbacks. */
+} SubscriptionMatches_t;
+
+#if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+
+/**
+ * @brief A PUBLISH queued for a worker, with its own copy of the topic name
+ * and payload.
+ */
+    typedef struct SubscriptionWorkerMessage
+    {
+        MQTTContext_t * pContext;                         /**< @brief The context the PUBLISH was received on. */
+        MQTTPublishInfo_t publishInfo;                    /**< @brief The PUBLISH, pointing into buffer. */
+        SubscriptionMatches_t matches;                    /**< @brief The callbacks to deliver it to. */
+        char buffer[ SUBSCRIPTION_WORKER_BUFFER_SIZE ];   /**< @brief The topic name, followed by the payload. */
+    } SubscriptionWorkerMessage_t;
+
+/**
+ * @brief A worker thread and its queue. All PUBLISH messages on one topic name
+ * go to the same worker, which delivers them in order.
+ */
+    typedef struct SubscriptionWorker
+    {
+        pthread_t thread;                                                    /**< @brief The worker thread. */
+        pthread_mutex_t mutex;                                               /**< @brief Protects the fields below. */
+        pthread_cond_t notEmpty;                                             /**< @brief Signalled when a message is queued or the worker stops. */
+        pthread_cond_t notFull;                                              /**< @brief Signalled when a message has been delivered. */
+        size_t head;                                                         /**< @brief Index of the oldest queued message. */
+        size_t count;                                                        /**< @brief Number of queued messages, including the one being delivered. */
+        bool stopping;                                                       /**< @brief Set to make the worker exit once its queue is empty. */
+        size_t queuedTotal;                                                  /**< @brief Number of messages queued since the worker started. */
+        size_t deliveredTotal;                                               /**< @brief Number of messages delivered since the worker started. */
+        SubscriptionWorkerMessage_t queue[ SUBSCRIPTION_WORKER_QUEUE_DEPTH ]; /**< @brief The queued messages. */
+    } SubscriptionWorker_t;
+
+/**
+ * @brief The workers started by #SubscriptionManager_StartWorkers.
+ */
+    static SubscriptionWorker_t workers[ SUBSCRIPTION_MANAGER_MAX_WORKERS ];
+
+/**
+ * @brief Number of running workers, or 0 to invoke callbacks on the
+ * dispatching thread.
+ */
+    static size_t workerCount = 0u;
+#endif /* if ( SUBSCRIPTION_MANAGER_THREADS == 1 ) */
+
+#if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+
+/**
+ * @brief The codec set by #SubscriptionManager_SetPayloadCodec, or NULL.
  */
+    static PayloadCodec_t * pPayloadCodec = NULL;
+#endif /* if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reset the trie to empty and link every node but the root into the
+ * free list.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ */
+static void resetStorage( SubscriptionRegistry_t * pRegistry );
+
+/**
+ * @brief Find the hash table slot a child would be placed in first.
+ *
+ * @param[in] pRegistry The registry copy to read.
+ * @param[in] parent Index of the parent node.
+ * @param[in] pLevel The topic level.
+ * @param[in] levelLength Length of the topic level.
+ *
+ * @return The home slot of the child.
+ */
+static size_t homeSlot( const SubscriptionRegistry_t * pRegistry,
+                        uint16_t parent,
+                        const char * pLevel,
+                        uint16_t levelLength );
+
+/**
+ * @brief Find the child of a node for a topic level, without wildcard matching.
+ *
+ * @param[in] pRegistry The registry copy to read.
+ * @param[in] parent Index of the parent node.
+ * @param[in] pLevel The topic level; `+` and `#` select the wildcard children.
+ * @param[in] levelLength Length of the topic level.
+ *
+ * @return Index of the child, or #TRIE_NONE.
+ */
+static uint16_t findChild( const SubscriptionRegistry_t * pRegistry,
+                           uint16_t parent,
+                           const char * pLevel,
+                           uint16_t levelLength );
+
+/**
+ * @brief Find a node in the hash table.
+ *
+ * @param[in] pRegistry The registry copy to read.
+ * @param[in] parent Index of the parent node, or #TRIE_EXACT_PARENT.
+ * @param[in] pKey The topic level, or the whole topic filter.
+ * @param[in] keyLength Length of @p pKey.
+ *
+ * @return Index of the node, or #TRIE_NONE.
+ */
+static uint16_t findInTable( const SubscriptionRegistry_t * pRegistry,
+                             uint16_t parent,
+                             const char * pKey,
+                             uint16_t keyLength );
+
+/**
+ * @brief Add a node to the hash table under its parent and level.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ * @param[in] node Index of the node.
+ */
+static void insertInTable( SubscriptionRegistry_t * pRegistry,
+                           uint16_t node );
+
+/**
+ * @brief Remove a node from the hash table.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ * @param[in] node Index of the node, which must be in the table.
+ */
+static void removeFromTable( SubscriptionRegistry_t * pRegistry,
+                             uint16_t node );
+
+/**
+ * @brief Take a node from the free list and initialize it.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ * @param[in] pLevel The topic level.
+ * @param[in] levelLength Length of the topic level.
+ * @param[in] parent Index of the parent node, or #TRIE_EXACT_PARENT.
+ *
+ * @return Index of the node, or #TRIE_NONE if no node is free.
+ */
+static uint16_t allocateNode( SubscriptionRegistry_t * pRegistry,
+                              const char * pLevel,
+                              uint16_t levelLength,
+                              uint16_t parent );
+
+/**
+ * @brief Return a node to the free list.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ * @param[in] node Index of the node.
+ */
+static void freeNode( SubscriptionRegistry_t * pRegistry,
+                      uint16_t node );
+
+/**
+ * @brief Check whether a topic filter contains a wildcard character.
+ *
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of the topic filter.
+ *
+ * @return true if the topic filter must be stored in the trie.
+ */
+static bool hasWildcard( const char * pTopicFilter,
+                         uint16_t topicFilterLength );
+
+/**
+ * @brief Allocate a child node for a topic level and link it to its parent.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ * @param[in] parent Index of the parent node.
+ * @param[in] pLevel The topic level.
+ * @param[in] levelLength Length of the topic level.
+ *
+ * @return Index of the new child, or #TRIE_NONE if no node is free.
+ */
+static uint16_t addChild( SubscriptionRegistry_t * pRegistry,
+                          uint16_t parent,
+                          const char * pLevel,
+                          uint16_t levelLength );
+
+/**
+ * @brief Free nodes that no longer lead to a registered topic filter, starting
+ * at @p node and walking up towards the root.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ * @param[in] node Index of the first node to consider.
+ *
+ * @return Index of the first node that was kept.
+ */
+static uint16_t pruneBranch( SubscriptionRegistry_t * pRegistry,
+                             uint16_t node );
+
+/**
+ * @brief Repoint the levels of @p node and its ancestors away from the memory
+ * of a topic filter being removed.
+ *
+ * Nodes shared by several topic filters point into the memory of one of them.
+ * The application may free a topic filter once it is removed, so the levels
+ * are moved to the same offset within a topic filter that is still registered
+ * below the node, which has the same leading levels.
+ *
+ * @param[in] pRegistry The registry copy to update.
+ * @param[in] node Index of the deepest node kept after removal.
+ * @param[in] pTopicFilter The registered memory of the topic filter being removed.
+ * @param[in] topicFilterLength Length of the topic filter.
+ */
+static void repairLevels( SubscriptionRegistry_t * pRegistry,
+                          uint16_t node,
+                          const char * pTopicFilter,
+                          uint16_t topicFilterLength );
+
+/**
+ * @brief Find the node of a topic filter.
+ *
+ * @param[in] pRegistry The registry copy to read.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of the topic filter.
+ *
+ * @return Index of the node of the topic filter's last level, or #TRIE_NONE if
+ * the path is not in the trie.
+ */
+static uint16_t findTopicFilter( const SubscriptionRegistry_t * pRegistry,
+                                 const char * pTopicFilter,
+                                 uint16_t topicFilterLength );
+
+/**
+ * @brief Invoke the callback of a node, if a topic filter ends at it.
+ *
+ * @param[in] pRegistry The registry copy to read.
+ * @param[in] node Index of the node.
+ * @param[in] pContext The context associated with the MQTT connection.
+ * @param[in] pPublishInfo The incoming PUBLISH message information.
+ * @param[out] pMatches Collects the callback for a worker, or NULL to invoke it
+ * right away.
+ */
+static void invokeCallback( const SubscriptionRegistry_t * pRegistry,
+                            uint16_t node,
+                            MQTTContext_t * pContext,
+                            MQTTPublishInfo_t * pPublishInfo,
+                            SubscriptionMatches_t * pMatches );
+
+/**
+ * @brief Invoke the callbacks of all topic filters under @p node that match
+ * the rest of the topic name.
+ *
+ * @param[in] pRegistry The registry copy to read.
+ * @param[in] node The node matched by the topic levels before @p levelStart.
+ * @param[in] levelStart Offset into the topic name of the next topic level, or
+ * one past the end of the topic name if all levels have been matched.
+ * @param[in] pContext The context associated with the MQTT connection.
+ * @param[in] pPublishInfo The incoming PUBLISH message information.
+ * @param[out] pMatches Collects the callbacks for a worker, or NULL to invoke
+ * them right away.
+ */
+static void dispatchLevel( const SubscriptionRegistry_t * pRegistry,
+                           uint16_t node,
+                           size_t levelStart,
+                           MQTTContext_t * pContext,
+                           MQTTPublishInfo_t * pPublishInfo,
+                           SubscriptionMatches_t * pMatches );
+
+/**
+ * @brief Invoke, or queue for the workers, the callbacks of the topic filters
+ * matching the topic name of a PUBLISH.
+ *
+ * @param[in] pContext The context associated with the MQTT connection.
+ * @param[in] pPublishInfo The PUBLISH message information.
+ */
+static void dispatchToCallbacks( MQTTContext_t * pContext,
+                                 MQTTPublishInfo_t * pPublishInfo );
+
+#if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+
+/**
+ * @brief Pick the worker for a topic name.
+ *
+ * @param[in] pTopicName The topic name.
+ * @param[in] topicNameLength Length of the topic name.
+ *
+ * @return Index of the worker.
+ */
+    static size_t workerForTopic( const char * pTopicName,
+                                  uint16_t topicNameLength );
+
+/**
+ * @brief Invoke collected callbacks.
+ *
+ * @param[in] pContext The context associated with the MQTT connection.
+ * @param[in] pPublishInfo The PUBLISH message information.
+ * @param[in] pMatches The callbacks.
+ */
+    static void invokeMatches( MQTTContext_t * pContext,
+                               MQTTPublishInfo_t * pPublishInfo,
+                               const SubscriptionMatches_t * pMatches );
+
+/**
+ * @brief Queue a PUBLISH for the worker of its topic name, waiting while the
+ * queue is full.
+ *
+ * @param[in] pContext The context associated with the MQTT connection.
+ * @param[in] pPublishInfo The PUBLISH message information, copied into the queue.
+ * @param[in] pMatches The callbacks to deliver it to.
+ */
+    static void submitToWorker( MQTTContext_t * pContext,
+                                const MQTTPublishInfo_t * pPublishInfo,
+                                const SubscriptionMatches_t * pMatches );
+
+/**
+ * @brief Deliver the queued messages of a worker until it is stopped.
+ *
+ * @param[in] pArgument The #SubscriptionWorker_t of the thread.
+ *
+ * @return NULL.
+ */
+    static void * workerThread( void * pArgument );
+
+/**
+ * @brief Wait until the workers have delivered every message queued before
+ * the call.
+ */
+    static void waitForWorkers( void );
+#endif /* if ( SUBSCRIPTION_MANAGER_THREADS == 1 ) */
+
+/**
+ * @brief Point every registry copy at its share of some storage, and reset it.
+ *
+ * In concurrent mode, each copy is published once it is reset, so that dispatch
+ * never reads a copy being set up.
+ *
+ * @param[in] pNodes The nodes of all copies.
+ * @param[in] pTables The hash tables of all copies.
+ * @param[in] nodeCount Number of nodes per copy.
+ * @param[in] maxRecords Maximum number of topic filters per copy.
+ */
+static void setUpStorage( TopicTrieNode_t * pNodes,
+                          uint16_t * pTables,
+                          size_t nodeCount,
+                          size_t maxRecords );
+
+/**
+ * @brief Register a callback in one registry copy.
+ *
+ * @param[in] pRegistry The registry copy.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of the topic filter.
+ * @param[in] callback The callback to register.
+ *
+ * @return #SUBSCRIPTION_MANAGER_SUCCESS, #SUBSCRIPTION_MANAGER_REGISTRY_FULL or
+ * #SUBSCRIPTION_MANAGER_RECORD_EXISTS.
+ */
+static SubscriptionManagerStatus_t registerCallback( SubscriptionRegistry_t * pRegistry,
+                                                     const char * pTopicFilter,
+                                                     uint16_t topicFilterLength,
+                                                     SubscriptionManagerCallback_t callback );
+
+/**
+ * @brief Remove the callback of a topic filter from one registry copy.
+ *
+ * @param[in] pRegistry The registry copy.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of the topic filter.
+ *
+ * @return true if a callback was registered for the topic filter.
+ */
+static bool removeCallback( SubscriptionRegistry_t * pRegistry,
+                            const char * pTopicFilter,
+                            uint16_t topicFilterLength );
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+
+/**
+ * @brief Start reading the published registry copy.
+ *
+ * @return Index of the registry copy, to pass to #releaseRegistry.
+ */
+    static uint32_t acquireRegistry( void );
+
+/**
+ * @brief Stop reading a registry copy.
+ *
+ * @param[in] index Index returned by #acquireRegistry.
+ */
+    static void releaseRegistry( uint32_t index );
+
+/**
+ * @brief Publish the updated registry copy to dispatch, and wait until no
+ * dispatch reads the previous one.
+ *
+ * Once this returns, the previous copy no longer references removed topic
+ * filters through any reader, and the writer must replay the same update on it
+ * so that both copies are equal again.
+ *
+ * @return The previous registry copy.
+ */
+    static SubscriptionRegistry_t * publishRegistry( void );
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static size_t homeSlot( const SubscriptionRegistry_t * pRegistry,
+                        uint16_t parent,
+                        const char * pLevel,
+                        uint16_t levelLength )
+{
+    /* FNV-1a over the parent index and the level. */
+    uint32_t hash = 2166136261UL;
+    uint16_t i = 0u;
+
+    hash = ( hash ^ ( uint32_t ) ( parent & 0xFFU ) ) * 16777619UL;
+    hash = ( hash ^ ( uint32_t ) ( parent >> 8 ) ) * 16777619UL;
+
+    for( i = 0u; i < levelLength; i++ )
+    {
+        hash = ( hash ^ ( uint32_t ) ( uint8_t ) pLevel[ i ] ) * 16777619UL;
+    }
+
+    return ( size_t ) ( hash % ( uint32_t ) pRegistry->tableSize );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t findChild( const SubscriptionRegistry_t * pRegistry,
+                           uint16_t parent,
+                           const char * pLevel,
+                           uint16_t levelLength )
+{
+    uint16_t child = TRIE_NONE;
+
+    if( ( levelLength == 1u ) && ( pLevel[ 0 ] == '+' ) )
+    {
+        child = pRegistry->pNodes[ parent ].singleLevelChild;
+    }
+    else if( ( levelLength == 1u ) && ( pLevel[ 0 ] == '#' ) )
+    {
+        child = pRegistry->pNodes[ parent ].multiLevelChild;
+    }
+    else
+    {
+        child = findInTable( pRegistry, parent, pLevel, levelLength );
+    }
+
+    return child;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t findInTable( const SubscriptionRegistry_t * pRegistry,
+                             uint16_t parent,
+                             const char * pKey,
+                             uint16_t keyLength )
+{
+    uint16_t node = TRIE_NONE;
+    size_t slot = 0u;
+    const TopicTrieNode_t * pNode = NULL;
+
+    for( slot = homeSlot( pRegistry, parent, pKey, keyLength );
+         pRegistry->pTable[ slot ] != TRIE_NONE;
+         slot = ( slot + 1u ) % pRegistry->tableSize )
+    {
+        pNode = &pRegistry->pNodes[ pRegistry->pTable[ slot ] ];
+
+        if( ( pNode->parent == parent ) &&
+            ( pNode->levelLength == keyLength ) &&
+            ( memcmp( pNode->pLevel, pKey, keyLength ) == 0 ) )
+        {
+            node = pRegistry->pTable[ slot ];
+            break;
+        }
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void insertInTable( SubscriptionRegistry_t * pRegistry,
+                           uint16_t node )
+{
+    const TopicTrieNode_t * pNode = &pRegistry->pNodes[ node ];
+    size_t slot = homeSlot( pRegistry, pNode->parent, pNode->pLevel, pNode->levelLength );
+
+    /* There is always a free slot, as the table has more slots than there
+     * are nodes. */
+    while( pRegistry->pTable[ slot ] != TRIE_NONE )
+    {
+        slot = ( slot + 1u ) % pRegistry->tableSize;
+    }
+
+    pRegistry->pTable[ slot ] = node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeFromTable( SubscriptionRegistry_t * pRegistry,
+                             uint16_t node )
+{
+    const TopicTrieNode_t * pNode = &pRegistry->pNodes[ node ];
+    size_t slot = homeSlot( pRegistry, pNode->parent, pNode->pLevel, pNode->levelLength );
+    size_t next = 0u, home = 0u;
+
+    while( pRegistry->pTable[ slot ] != node )
+    {
+        slot = ( slot + 1u ) % pRegistry->tableSize;
+    }
+
+    /* Remove the slot, then shift back any later entry of the probe sequence
+     * that could no longer be reached past the hole. */
+    pRegistry->pTable[ slot ] = TRIE_NONE;
+    next = ( slot + 1u ) % pRegistry->tableSize;
+
+    while( pRegistry->pTable[ next ] != TRIE_NONE )
+    {
+        pNode = &pRegistry->pNodes[ pRegistry->pTable[ next ] ];
+        home = homeSlot( pRegistry, pNode->parent, pNode->pLevel, pNode->levelLength );
+
+        if( ( ( next > slot ) && ( ( home <= slot ) || ( home > next ) ) ) ||
+            ( ( next < slot ) && ( home <= slot ) && ( home > next ) ) )
+        {
+            pRegistry->pTable[ slot ] = pRegistry->pTable[ next ];
+            pRegistry->pTable[ next ] = TRIE_NONE;
+            slot = next;
+        }
+
+        next = ( next + 1u ) % pRegistry->tableSize;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t allocateNode( SubscriptionRegistry_t * pRegistry,
+                              const char * pLevel,
+                              uint16_t levelLength,
+                              uint16_t parent )
+{
+    uint16_t node = pRegistry->freeList;
+    TopicTrieNode_t * pNode = NULL;
+
+    if( node != TRIE_NONE )
+    {
+        pNode = &pRegistry->pNodes[ node ];
+        pRegistry->freeList = pNode->nextSibling;
+
+        ( void ) memset( pNode, 0x00, sizeof( TopicTrieNode_t ) );
+        pNode->pLevel = pLevel;
+        pNode->levelLength = levelLength;
+        pNode->parent = parent;
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void freeNode( SubscriptionRegistry_t * pRegistry,
+                      uint16_t node )
+{
+    pRegistry->pNodes[ node ].nextSibling = pRegistry->freeList;
+    pRegistry->freeList = node;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool hasWildcard( const char * pTopicFilter,
+                         uint16_t topicFilterLength )
+{
+    uint16_t i = 0u;
+
+    for( i = 0u; i < topicFilterLength; i++ )
+    {
+        if( ( pTopicFilter[ i ] == '+' ) || ( pTopicFilter[ i ] == '#' ) )
+        {
+            break;
+        }
+    }
+
+    return ( i < topicFilterLength ) ? true : false;
+}
+
+/*-----------------------------------------------------------*/
+
+static void resetStorage( SubscriptionRegistry_t * pRegistry )
+{
+    size_t index = 0u;
+
+    ( void ) memset( pRegistry->pNodes, 0x00, pRegistry->nodeCapacity * sizeof( TopicTrieNode_t ) );
+    ( void ) memset( pRegistry->pTable, 0x00, pRegistry->tableSize * sizeof( uint16_t ) );
+
+    /* Link nodes in index order so that allocation starts at the front. */
+    pRegistry->freeList = TRIE_NONE;
+
+    for( index = pRegistry->nodeCapacity - 1u; index > TRIE_ROOT; index-- )
+    {
+        pRegistry->pNodes[ index ].nextSibling = pRegistry->freeList;
+        pRegistry->freeList = ( uint16_t ) index;
+    }
+
+    pRegistry->recordCount = 0u;
+    pRegistry->wildcardCount = 0u;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t addChild( SubscriptionRegistry_t * pRegistry,
+                          uint16_t parent,
+                          const char * pLevel,
+                          uint16_t levelLength )
+{
+    uint16_t child = allocateNode( pRegistry, pLevel, levelLength, parent );
+    TopicTrieNode_t * pChild = NULL;
+
+    if( child != TRIE_NONE )
+    {
+        pChild = &pRegistry->pNodes[ child ];
+
+        /* Every child is on its parent's sibling list, so that a registered
+         * topic filter below any node can be found by walking down. */
+        pChild->nextSibling = pRegistry->pNodes[ parent ].firstChild;
+
+        if( pChild->nextSibling != TRIE_NONE )
+        {
+            pRegistry->pNodes[ pChild->nextSibling ].previousSibling = child;
+        }
+
+        pRegistry->pNodes[ parent ].firstChild = child;
+
+        if( ( levelLength == 1u ) && ( pLevel[ 0 ] == '+' ) )
+        {
+            pRegistry->pNodes[ parent ].singleLevelChild = child;
+        }
+        else if( ( levelLength == 1u ) && ( pLevel[ 0 ] == '#' ) )
+        {
+            pRegistry->pNodes[ parent ].multiLevelChild = child;
+        }
+        else
+        {
+            insertInTable( pRegistry, child );
+        }
+    }
+
+    return child;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t pruneBranch( SubscriptionRegistry_t * pRegistry,
+                             uint16_t node )
+{
+    TopicTrieNode_t * pNode = NULL;
+    uint16_t parent = TRIE_ROOT;
+
+    while( node != TRIE_ROOT )
+    {
+        pNode = &pRegistry->pNodes[ node ];
+
+        if( ( pNode->callback != NULL ) || ( pNode->firstChild != TRIE_NONE ) )
+        {
+            break;
+        }
+
+        parent = pNode->parent;
+
+        if( pRegistry->pNodes[ parent ].singleLevelChild == node )
+        {
+            pRegistry->pNodes[ parent ].singleLevelChild = TRIE_NONE;
+        }
+        else if( pRegistry->pNodes[ parent ].multiLevelChild == node )
+        {
+            pRegistry->pNodes[ parent ].multiLevelChild = TRIE_NONE;
+        }
+        else
+        {
+            removeFromTable( pRegistry, node );
+        }
+
+        /* Unlink from the parent's sibling list and return to the free list. */
+        if( pNode->previousSibling != TRIE_NONE )
+        {
+            pRegistry->pNodes[ pNode->previousSibling ].nextSibling = pNode->nextSibling;
+        }
+        else
+        {
+            pRegistry->pNodes[ parent ].firstChild = pNode->nextSibling;
+        }
+
+        if( pNode->nextSibling != TRIE_NONE )
+        {
+            pRegistry->pNodes[ pNode->nextSibling ].previousSibling = pNode->previousSibling;
+        }
+
+        freeNode( pRegistry, node );
+        node = parent;
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void repairLevels( SubscriptionRegistry_t * pRegistry,
+                          uint16_t node,
+                          const char * pTopicFilter,
+                          uint16_t topicFilterLength )
+{
+    uint16_t descendant = TRIE_NONE;
+    size_t offset = 0u;
+
+    for( ; node != TRIE_ROOT; node = pRegistry->pNodes[ node ].parent )
+    {
+        /* An empty last level points just past the end of the topic filter. */
+        if( ( pRegistry->pNodes[ node ].pLevel >= pTopicFilter ) &&
+            ( pRegistry->pNodes[ node ].pLevel <= &pTopicFilter[ topicFilterLength ] ) )
+        {
+            offset = ( size_t ) ( pRegistry->pNodes[ node ].pLevel - pTopicFilter );
+
+            /* Every kept node without a callback has children, and every
+             * leaf has a callback, so walking down first children finds a
+             * registered topic filter. */
+            descendant = node;
+
+            while( pRegistry->pNodes[ descendant ].callback == NULL )
+            {
+                descendant = pRegistry->pNodes[ descendant ].firstChild;
+            }
+
+            pRegistry->pNodes[ node ].pLevel = &pRegistry->pNodes[ descendant ].pTopicFilter[ offset ];
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t findTopicFilter( const SubscriptionRegistry_t * pRegistry,
+                                 const char * pTopicFilter,
+                                 uint16_t topicFilterLength )
+{
+    uint16_t node = TRIE_ROOT;
+    size_t levelStart = 0u, levelEnd = 0u;
+
+    /* The root shares its index with TRIE_NONE, so the walk must take at
+     * least one step before checking for a missing level. */
+    while( levelStart <= topicFilterLength )
+    {
+        levelEnd = levelStart;
+
+        while( ( levelEnd < topicFilterLength ) && ( pTopicFilter[ levelEnd ] != TOPIC_LEVEL_SEPARATOR ) )
+        {
+            levelEnd++;
+        }
+
+        node = findChild( pRegistry, node, &pTopicFilter[ levelStart ], ( uint16_t ) ( levelEnd - levelStart ) );
+        levelStart = levelEnd + 1u;
+
+        if( node == TRIE_NONE )
+        {
+            break;
+        }
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void invokeCallback( const SubscriptionRegistry_t * pRegistry,
+                            uint16_t node,
+                            MQTTContext_t * pContext,
+                            MQTTPublishInfo_t * pPublishInfo,
+                            SubscriptionMatches_t * pMatches )
+{
+    const TopicTrieNode_t * pNode = &pRegistry->pNodes[ node ];
+
+    if( pNode->callback == NULL )
+    {
+        /* No topic filter ends at this node. */
+    }
+    else if( pMatches != NULL )
+    {
+        if( pMatches->count < SUBSCRIPTION_WORKER_MAX_CALLBACKS )
+        {
+            pMatches->callbacks[ pMatches->count ] = pNode->callback;
+            pMatches->count++;
+        }
+        else
+        {
+            LogError( ( "Dropping delivery to a matching topic filter: Too many callbacks match: "
+                        "TopicFilter=%.*s, TopicName=%.*s, MaxCallbacks=%u",
+                        pNode->topicFilterLength,
+                        pNode->pTopicFilter,
+                        pPublishInfo->topicNameLength,
+                        pPublishInfo->pTopicName,
+                        ( unsigned int ) SUBSCRIPTION_WORKER_MAX_CALLBACKS ) );
+        }
+    }
+    else
+    {
+        LogInfo( ( "Invoking subscription callback of matching topic filter: "
+                   "TopicFilter=%.*s, TopicName=%.*s",
+                   pNode->topicFilterLength,
+                   pNode->pTopicFilter,
+                   pPublishInfo->topicNameLength,
+                   pPublishInfo->pTopicName ) );
+
+        /* Invoke the callback associated with the record as the topics match. */
+        pNode->callback( pContext, pPublishInfo );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void dispatchLevel( const SubscriptionRegistry_t * pRegistry,
+                           uint16_t node,
+                           size_t levelStart,
+                           MQTTContext_t * pContext,
+                           MQTTPublishInfo_t * pPublishInfo,
+                           SubscriptionMatches_t * pMatches )
+{
+    const char * pTopicName = pPublishInfo->pTopicName;
+    size_t topicNameLength = pPublishInfo->topicNameLength;
+    size_t levelEnd = levelStart;
+    uint16_t child = TRIE_NONE;
+    bool wildcardsAllowed = true;
+
+    /* Topic names starting with '$' are not matched by filters starting with
+     * a wildcard. */
+    if( ( node == TRIE_ROOT ) && ( topicNameLength > 0u ) && ( pTopicName[ 0 ] == '$' ) )
+    {
+        wildcardsAllowed = false;
+    }
+
+    /* A '#' matches the remaining levels, including none at all, so that
+     * "a/#" matches "a". */
+    if( ( wildcardsAllowed == true ) && ( pRegistry->pNodes[ node ].multiLevelChild != TRIE_NONE ) )
+    {
+        invokeCallback( pRegistry, pRegistry->pNodes[ node ].multiLevelChild, pContext, pPublishInfo, pMatches );
+    }
+
+    if( levelStart > topicNameLength )
+    {
+        /* Every level of the topic name has been matched. */
+        invokeCallback( pRegistry, node, pContext, pPublishInfo, pMatches );
+    }
+    else
+    {
+        while( ( levelEnd < topicNameLength ) && ( pTopicName[ levelEnd ] != TOPIC_LEVEL_SEPARATOR ) )
+        {
+            levelEnd++;
+        }
+
+        /* Topic names cannot contain wildcards, so this only finds exact
+         * levels unless the level is literally "+" or "#". Skip those, as
+         * they would select the wildcard children. */
+        if( !( ( ( levelEnd - levelStart ) == 1u ) &&
+               ( ( pTopicName[ levelStart ] == '+' ) || ( pTopicName[ levelStart ] == '#' ) ) ) )
+        {
+            child = findChild( pRegistry, node, &pTopicName[ levelStart ], ( uint16_t ) ( levelEnd - levelStart ) );
+        }
+
+        if( child != TRIE_NONE )
+        {
+            dispatchLevel( pRegistry, child, levelEnd + 1u, pContext, pPublishInfo, pMatches );
+        }
+
+        if( ( wildcardsAllowed == true ) && ( pRegistry->pNodes[ node ].singleLevelChild != TRIE_NONE ) )
+        {
+            dispatchLevel( pRegistry, pRegistry->pNodes[ node ].singleLevelChild, levelEnd + 1u, pContext, pPublishInfo, pMatches );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void setUpStorage( TopicTrieNode_t * pNodes,
+                          uint16_t * pTables,
+                          size_t nodeCount,
+                          size_t maxRecords )
+{
+    SubscriptionRegistry_t * pRegistry = NULL;
+    size_t copy = 0u, index = 0u;
+
+    for( copy = 0u; copy < SUBSCRIPTION_REGISTRY_COPIES; copy++ )
+    {
+        pRegistry = WRITABLE_REGISTRY();
+        index = ( size_t ) ( pRegistry - registries );
+
+        pRegistry->nodeCapacity = nodeCount;
+        pRegistry->tableSize = ( 2u * nodeCount ) + 1u;
+        pRegistry->pNodes = &pNodes[ index * nodeCount ];
+        pRegistry->pTable = &pTables[ index * pRegistry->tableSize ];
+        pRegistry->maxRecords = maxRecords;
+        resetStorage( pRegistry );
+
+        #if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+            ( void ) publishRegistry();
+        #endif
+    }
+
+    storageReady = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionManagerStatus_t registerCallback( SubscriptionRegistry_t * pRegistry,
+                                                     const char * pTopicFilter,
+                                                     uint16_t topicFilterLength,
+                                                     SubscriptionManagerCallback_t callback )
+{
+    SubscriptionManagerStatus_t returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    uint16_t node = TRIE_ROOT, child = TRIE_NONE;
+    size_t levelStart = 0u, levelEnd = 0u;
+    bool isWildcard = hasWildcard( pTopicFilter, topicFilterLength );
+
+    if( isWildcard == true )
+    {
+        node = findTopicFilter( pRegistry, pTopicFilter, topicFilterLength );
+    }
+    else
+    {
+        node = findInTable( pRegistry, TRIE_EXACT_PARENT, pTopicFilter, topicFilterLength );
+    }
+
+    /* An existing record is reported even when the registry is full. */
+    if( ( node != TRIE_NONE ) && ( pRegistry->pNodes[ node ].callback != NULL ) )
+    {
+        returnStatus = SUBSCRIPTION_MANAGER_RECORD_EXISTS;
+    }
+    else if( pRegistry->recordCount >= pRegistry->maxRecords )
+    {
+        returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+    }
+    else if( isWildcard == false )
+    {
+        /* The whole topic filter is the key of a node outside the trie. */
+        node = allocateNode( pRegistry, pTopicFilter, topicFilterLength, TRIE_EXACT_PARENT );
+
+        if( node == TRIE_NONE )
+        {
+            returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+        }
+        else
+        {
+            insertInTable( pRegistry, node );
+        }
+    }
+    else
+    {
+        /* Walk down the trie one topic level at a time, adding the levels that
+         * are not there yet. */
+        node = TRIE_ROOT;
+
+        while( levelStart <= topicFilterLength )
+        {
+            levelEnd = levelStart;
+
+            while( ( levelEnd < topicFilterLength ) && ( pTopicFilter[ levelEnd ] != TOPIC_LEVEL_SEPARATOR ) )
+            {
+                levelEnd++;
+            }
+
+            child = findChild( pRegistry, node, &pTopicFilter[ levelStart ], ( uint16_t ) ( levelEnd - levelStart ) );
+
+            if( child == TRIE_NONE )
+            {
+                child = addChild( pRegistry, node, &pTopicFilter[ levelStart ], ( uint16_t ) ( levelEnd - levelStart ) );
+            }
+
+            if( child == TRIE_NONE )
+            {
+                /* Out of nodes; release the levels added for this filter. */
+                ( void ) pruneBranch( pRegistry, node );
+                returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+                break;
+            }
+
+            node = child;
+            levelStart = levelEnd + 1u;
+        }
+    }
+
+    if( returnStatus == SUBSCRIPTION_MANAGER_SUCCESS )
+    {
+        pRegistry->pNodes[ node ].pTopicFilter = pTopicFilter;
+        pRegistry->pNodes[ node ].topicFilterLength = topicFilterLength;
+        pRegistry->pNodes[ node ].callback = callback;
+        pRegistry->recordCount++;
+
+        if( isWildcard == true )
+        {
+            pRegistry->wildcardCount++;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool removeCallback( SubscriptionRegistry_t * pRegistry,
+                            const char * pTopicFilter,
+                            uint16_t topicFilterLength )
+{
+    const char * pRegisteredFilter = NULL;
+    uint16_t node = TRIE_NONE;
+    bool isWildcard = hasWildcard( pTopicFilter, topicFilterLength );
+    bool removed = false;
+
+    if( isWildcard == true )
+    {
+        node = findTopicFilter( pRegistry, pTopicFilter, topicFilterLength );
+    }
+    else
+    {
+        node = findInTable( pRegistry, TRIE_EXACT_PARENT, pTopicFilter, topicFilterLength );
+    }
+
+    if( ( node != TRIE_NONE ) && ( isWildcard == false ) )
+    {
+        /* Nothing else points into the memory of the topic filter. */
+        removeFromTable( pRegistry, node );
+        freeNode( pRegistry, node );
+        pRegistry->recordCount--;
+        removed = true;
+    }
+
+    /* Delete the record by clearing the callback of the topic filter's node,
+     * and release the levels no other topic filter uses. */
+    else if( ( node != TRIE_NONE ) && ( pRegistry->pNodes[ node ].callback != NULL ) )
+    {
+        /* The nodes point into the registered copy of the topic filter, which
+         * need not be the memory passed in. */
+        pRegisteredFilter = pRegistry->pNodes[ node ].pTopicFilter;
+
+        pRegistry->pNodes[ node ].pTopicFilter = NULL;
+        pRegistry->pNodes[ node ].topicFilterLength = 0u;
+        pRegistry->pNodes[ node ].callback = NULL;
+        pRegistry->recordCount--;
+        pRegistry->wildcardCount--;
+        repairLevels( pRegistry, pruneBranch( pRegistry, node ), pRegisteredFilter, topicFilterLength );
+        removed = true;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
 
-/* Standard includes. */
-#include <string.h>
-#include <assert.h>
+    return removed;
+}
 
-/* Include demo config. */
-#include "demo_config.h"
+/*-----------------------------------------------------------*/
 
-/* Include header for the subscription manager. */
-#include "mqtt_subscription_manager.h"
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
 
+    static uint32_t acquireRegistry( void )
+    {
+        uint32_t index = 0U;
+        bool acquired = false;
 
-/**
- * @brief Represents a registered record of the topic filter and its associated callback
- * in the subscription manager registry.
- */
-typedef struct SubscriptionManagerRecord
+        while( acquired == false )
+        {
+            index = __atomic_load_n( &publishedRegistry, __ATOMIC_SEQ_CST );
+            ( void ) __atomic_fetch_add( &readerCounts[ index ], 1U, __ATOMIC_SEQ_CST );
+
+            /* A writer may have published the other copy in between, and be
+             * about to update this one without seeing this reader. */
+            if( __atomic_load_n( &publishedRegistry, __ATOMIC_SEQ_CST ) == index )
+            {
+                acquired = true;
+            }
+            else
+            {
+                ( void ) __atomic_fetch_sub( &readerCounts[ index ], 1U, __ATOMIC_SEQ_CST );
+            }
+        }
+
+        return index;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void releaseRegistry( uint32_t index )
+    {
+        ( void ) __atomic_fetch_sub( &readerCounts[ index ], 1U, __ATOMIC_SEQ_CST );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static SubscriptionRegistry_t * publishRegistry( void )
+    {
+        uint32_t previous = publishedRegistry;
+
+        __atomic_store_n( &publishedRegistry, 1U - previous, __ATOMIC_SEQ_CST );
+
+        /* Wait for the dispatches that started on the previous copy. Updates are
+         * rare compared to dispatches, so yielding is enough. */
+        while( __atomic_load_n( &readerCounts[ previous ], __ATOMIC_SEQ_CST ) != 0U )
+        {
+            ( void ) sched_yield();
+        }
+
+        return &registries[ previous ];
+    }
+
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+
+    static size_t workerForTopic( const char * pTopicName,
+                                  uint16_t topicNameLength )
+    {
+        /* FNV-1a over the topic name. */
+        uint32_t hash = 2166136261UL;
+        uint16_t i = 0u;
+
+        for( i = 0u; i < topicNameLength; i++ )
+        {
+            hash = ( hash ^ ( uint32_t ) ( uint8_t ) pTopicName[ i ] ) * 16777619UL;
+        }
+
+        return ( size_t ) ( hash % ( uint32_t ) workerCount );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void invokeMatches( MQTTContext_t * pContext,
+                               MQTTPublishInfo_t * pPublishInfo,
+                               const SubscriptionMatches_t * pMatches )
+    {
+        size_t i = 0u;
+
+        for( i = 0u; i < pMatches->count; i++ )
+        {
+            pMatches->callbacks[ i ]( pContext, pPublishInfo );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void submitToWorker( MQTTContext_t * pContext,
+                                const MQTTPublishInfo_t * pPublishInfo,
+                                const SubscriptionMatches_t * pMatches )
+    {
+        SubscriptionWorker_t * pWorker = &workers[ workerForTopic( pPublishInfo->pTopicName,
+                                                                   pPublishInfo->topicNameLength ) ];
+        SubscriptionWorkerMessage_t * pMessage = NULL;
+        MQTTPublishInfo_t publishInfo;
+        bool deliverInline = false;
+
+        ( void ) pthread_mutex_lock( &pWorker->mutex );
+
+        if( ( ( size_t ) pPublishInfo->topicNameLength + pPublishInfo->payloadLength ) > SUBSCRIPTION_WORKER_BUFFER_SIZE )
+        {
+            /* Deliver the message here once the worker has delivered the earlier
+             * messages of its topics, so that their order is kept. */
+            while( pWorker->count > 0u )
+            {
+                ( void ) pthread_cond_wait( &pWorker->notFull, &pWorker->mutex );
+            }
+
+            deliverInline = true;
+        }
+        else
+        {
+            while( pWorker->count == SUBSCRIPTION_WORKER_QUEUE_DEPTH )
+            {
+                ( void ) pthread_cond_wait( &pWorker->notFull, &pWorker->mutex );
+            }
+
+            pMessage = &pWorker->queue[ ( pWorker->head + pWorker->count ) % SUBSCRIPTION_WORKER_QUEUE_DEPTH ];
+            pMessage->pContext = pContext;
+            pMessage->publishInfo = *pPublishInfo;
+            pMessage->matches = *pMatches;
+
+            ( void ) memcpy( pMessage->buffer, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+            pMessage->publishInfo.pTopicName = pMessage->buffer;
+
+            if( pPublishInfo->payloadLength > 0u )
+            {
+                ( void ) memcpy( &pMessage->buffer[ pPublishInfo->topicNameLength ],
+                                 pPublishInfo->pPayload,
+                                 pPublishInfo->payloadLength );
+            }
+
+            pMessage->publishInfo.pPayload = &pMessage->buffer[ pPublishInfo->topicNameLength ];
+
+            pWorker->count++;
+            pWorker->queuedTotal++;
+            ( void ) pthread_cond_signal( &pWorker->notEmpty );
+        }
+
+        ( void ) pthread_mutex_unlock( &pWorker->mutex );
+
+        if( deliverInline == true )
+        {
+            LogWarn( ( "Delivering PUBLISH on the dispatching thread as it does not fit a worker queue: "
+                       "TopicName=%.*s, PayloadLength=%lu, WorkerBufferSize=%u",
+                       pPublishInfo->topicNameLength,
+                       pPublishInfo->pTopicName,
+                       ( unsigned long ) pPublishInfo->payloadLength,
+                       ( unsigned int ) SUBSCRIPTION_WORKER_BUFFER_SIZE ) );
+
+            /* The callbacks take a non-const PUBLISH, so hand them a copy. */
+            publishInfo = *pPublishInfo;
+            invokeMatches( pContext, &publishInfo, pMatches );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * workerThread( void * pArgument )
+    {
+        SubscriptionWorker_t * pWorker = ( SubscriptionWorker_t * ) pArgument;
+        SubscriptionWorkerMessage_t * pMessage = NULL;
+        bool running = true;
+
+        ( void ) pthread_mutex_lock( &pWorker->mutex );
+
+        while( running == true )
+        {
+            while( ( pWorker->count == 0u ) && ( pWorker->stopping == false ) )
+            {
+                ( void ) pthread_cond_wait( &pWorker->notEmpty, &pWorker->mutex );
+            }
+
+            if( pWorker->count == 0u )
+            {
+                /* Stopped, and every queued message has been delivered. */
+                running = false;
+            }
+            else
+            {
+                /* The slot stays counted while it is delivered, so that dispatch
+                 * does not reuse it. */
+                pMessage = &pWorker->queue[ pWorker->head ];
+                ( void ) pthread_mutex_unlock( &pWorker->mutex );
+
+                invokeMatches( pMessage->pContext, &pMessage->publishInfo, &pMessage->matches );
+
+                ( void ) pthread_mutex_lock( &pWorker->mutex );
+                pWorker->head = ( pWorker->head + 1u ) % SUBSCRIPTION_WORKER_QUEUE_DEPTH;
+                pWorker->count--;
+                pWorker->deliveredTotal++;
+                ( void ) pthread_cond_broadcast( &pWorker->notFull );
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &pWorker->mutex );
+
+        return NULL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void waitForWorkers( void )
+    {
+        size_t index = 0u, queuedTotal = 0u;
+        SubscriptionWorker_t * pWorker = NULL;
+
+        for( index = 0u; index < workerCount; index++ )
+        {
+            pWorker = &workers[ index ];
+
+            ( void ) pthread_mutex_lock( &pWorker->mutex );
+
+            /* Messages queued after this point were matched without the removed
+             * callback, so only wait for the earlier ones. */
+            queuedTotal = pWorker->queuedTotal;
+
+            while( pWorker->deliveredTotal < queuedTotal )
+            {
+                ( void ) pthread_cond_wait( &pWorker->notFull, &pWorker->mutex );
+            }
+
+            ( void ) pthread_mutex_unlock( &pWorker->mutex );
+        }
+    }
+#endif /* if ( SUBSCRIPTION_MANAGER_THREADS == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+size_t SubscriptionManager_GetArenaSize( uint16_t topicLevelCount )
 {
-    const char * pTopicFilter;
-    uint16_t topicFilterLength;
-    SubscriptionManagerCallback_t callback;
-} SubscriptionManagerRecord_t;
+    size_t nodeCount = ( size_t ) topicLevelCount + 1u;
 
-/**
- * @brief The default value for the maximum size of the callback registry in the
- * subscription manager.
- */
-#ifndef MAX_SUBSCRIPTION_CALLBACK_RECORDS
-    #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
-#endif
+    /* The nodes, then the hash table, of each registry copy, plus slack to
+     * align the start. */
+    return ( SUBSCRIPTION_REGISTRY_COPIES *
+             ( ( nodeCount * sizeof( TopicTrieNode_t ) ) +
+               ( ( ( 2u * nodeCount ) + 1u ) * sizeof( uint16_t ) ) ) ) +
+           sizeof( void * );
+}
 
-/**
- * @brief The registry to store records of topic filters and their subscription callbacks.
- */
-static SubscriptionManagerRecord_t callbackRecordList[ MAX_SUBSCRIPTION_CALLBACK_RECORDS ] = { 0 };
+/*-----------------------------------------------------------*/
+
+SubscriptionManagerStatus_t SubscriptionManager_Init( void * pArena,
+                                                      size_t arenaSize )
+{
+    SubscriptionManagerStatus_t returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    size_t padding = 0u, nodeCount = 0u, fixedSize = 0u;
+    uint8_t * pStart = ( uint8_t * ) pArena;
+    TopicTrieNode_t * pNodes = NULL;
+    uint16_t * pTables = NULL;
+
+    LOCK_REGISTRY_WRITER();
+
+    if( pArena == NULL )
+    {
+        /* Return to the statically allocated registry. */
+        setUpStorage( defaultTrieNodes, defaultChildTable, MAX_SUBSCRIPTION_TRIE_NODES, MAX_SUBSCRIPTION_CALLBACK_RECORDS );
+    }
+    else
+    {
+        padding = ( sizeof( void * ) - ( ( uintptr_t ) pStart % sizeof( void * ) ) ) % sizeof( void * );
+        fixedSize = padding + ( SUBSCRIPTION_REGISTRY_COPIES * sizeof( uint16_t ) );
+
+        if( arenaSize > fixedSize )
+        {
+            /* Each node needs two hash table slots, and each table one more. */
+            nodeCount = ( arenaSize - fixedSize ) /
+                        ( SUBSCRIPTION_REGISTRY_COPIES * ( sizeof( TopicTrieNode_t ) + ( 2u * sizeof( uint16_t ) ) ) );
+            nodeCount = ( nodeCount > TRIE_MAX_ARENA_NODES ) ? TRIE_MAX_ARENA_NODES : nodeCount;
+        }
+
+        if( nodeCount < 2u )
+        {
+            LogError( ( "Subscription manager arena is too small: ArenaSize=%lu",
+                        ( unsigned long ) arenaSize ) );
+            returnStatus = SUBSCRIPTION_MANAGER_BAD_PARAMETER;
+        }
+        else
+        {
+            /* The nodes of every copy come first, as they need the alignment. */
+            pNodes = ( TopicTrieNode_t * ) &pStart[ padding ];
+            pTables = ( uint16_t * ) &pNodes[ SUBSCRIPTION_REGISTRY_COPIES * nodeCount ];
+
+            /* Every topic filter needs at least one node besides the root. */
+            setUpStorage( pNodes, pTables, nodeCount, nodeCount - 1u );
+
+            LogDebug( ( "Subscription manager registry is using an arena: MaxTopicLevels=%lu",
+                        ( unsigned long ) ( nodeCount - 1u ) ) );
+        }
+    }
+
+    UNLOCK_REGISTRY_WRITER();
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void dispatchToCallbacks( MQTTContext_t * pContext,
+                                 MQTTPublishInfo_t * pPublishInfo )
+{
+    const SubscriptionRegistry_t * pRegistry = NULL;
+    uint16_t node = TRIE_NONE;
+    SubscriptionMatches_t * pMatches = NULL;
+
+    #if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+        SubscriptionMatches_t matches;
+    #endif
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+        uint32_t index = acquireRegistry();
+
+        pRegistry = &registries[ index ];
+    #else
+        pRegistry = &registries[ 0 ];
+    #endif
+
+    /* With workers running, collect the callbacks to hand them the PUBLISH
+     * once the trie has been walked. */
+    #if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+        if( workerCount > 0u )
+        {
+            matches.count = 0u;
+            pMatches = &matches;
+        }
+    #endif
+
+    if( ( pRegistry->recordCount > 0u ) && ( pPublishInfo->pTopicName != NULL ) )
+    {
+        /* A topic filter without wildcards matches only a topic name equal to
+         * it. */
+        if( pRegistry->recordCount > pRegistry->wildcardCount )
+        {
+            node = findInTable( pRegistry, TRIE_EXACT_PARENT, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+        }
+
+        if( node != TRIE_NONE )
+        {
+            invokeCallback( pRegistry, node, pContext, pPublishInfo, pMatches );
+        }
+
+        /* Walk the trie along the levels of the topic name, and invoke the
+         * callbacks of matching wildcard topic filters. */
+        if( pRegistry->wildcardCount > 0u )
+        {
+            dispatchLevel( pRegistry, TRIE_ROOT, 0u, pContext, pPublishInfo, pMatches );
+        }
+    }
+
+    #if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+        if( ( pMatches != NULL ) && ( pMatches->count > 0u ) )
+        {
+            submitToWorker( pContext, pPublishInfo, pMatches );
+        }
+    #endif
+
+    /* The registry copy is held until the callbacks are queued, so that a
+     * removal waiting for this dispatch also sees them in the queues. */
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+        releaseRegistry( index );
+    #endif
+}
 
 /*-----------------------------------------------------------*/
 
 void SubscriptionManager_DispatchHandler( MQTTContext_t * pContext,
                                           MQTTPublishInfo_t * pPublishInfo )
 {
-    bool matchStatus = false;
-    size_t listIndex = 0u;
+    #if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+        MQTTPublishInfo_t decompressedInfo;
+        PayloadCodecStatus_t codecStatus = PayloadCodecSuccess;
+        size_t payloadLength = 0u;
+
+        /* Each dispatch decompresses into its own buffer, as dispatches may
+         * run on several threads. Workers copy the payload out of it. */
+        uint8_t decompressBuffer[ SUBSCRIPTION_MANAGER_DECOMPRESS_BUFFER_SIZE ];
+    #endif
 
     assert( pPublishInfo != NULL );
     assert( pContext != NULL );
 
-    /* Iterate through record list to find matching topics, and invoke their callbacks. */
-    for( listIndex = 0; listIndex < MAX_SUBSCRIPTION_CALLBACK_RECORDS; listIndex++ )
-    {
-        if( ( callbackRecordList[ listIndex ].pTopicFilter != NULL ) &&
-            ( MQTT_MatchTopic( pPublishInfo->pTopicName,
-                               pPublishInfo->topicNameLength,
-                               callbackRecordList[ listIndex ].pTopicFilter,
-                               callbackRecordList[ listIndex ].topicFilterLength,
-                               &matchStatus ) == MQTTSuccess ) &&
-            ( matchStatus == true ) )
-        {
-            LogInfo( ( "Invoking subscription callback of matching topic filter: "
-                       "TopicFilter=%.*s, TopicName=%.*s",
-                       callbackRecordList[ listIndex ].topicFilterLength,
-                       callbackRecordList[ listIndex ].pTopicFilter,
-                       pPublishInfo->topicNameLength,
-                       pPublishInfo->pTopicName ) );
+    TRACE_PROBE2( subscription_dispatch_start, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+
+    #if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+        /* Hand the callbacks the original payload of a compressed PUBLISH. */
+        if( ( pPayloadCodec != NULL ) &&
+            ( PayloadCodec_IsCompressed( pPublishInfo->pPayload, pPublishInfo->payloadLength, NULL ) == true ) )
+        {
+            codecStatus = PayloadCodec_Decompress( pPayloadCodec,
+                                                   pPublishInfo->pPayload,
+                                                   pPublishInfo->payloadLength,
+                                                   decompressBuffer,
+                                                   sizeof( decompressBuffer ),
+                                                   &payloadLength );
 
-            /* Invoke the callback associated with the record as the topics match. */
-            callbackRecordList[ listIndex ].callback( pContext, pPublishInfo );
+            if( codecStatus == PayloadCodecSuccess )
+            {
+                decompressedInfo = *pPublishInfo;
+                decompressedInfo.pPayload = decompressBuffer;
+                decompressedInfo.payloadLength = payloadLength;
+                dispatchToCallbacks( pContext, &decompressedInfo );
+            }
+            else
+            {
+                LogError( ( "Dropping PUBLISH with a payload that could not be decompressed: "
+                            "TopicName=%.*s, PayloadLength=%lu, CodecStatus=%d",
+                            pPublishInfo->topicNameLength,
+                            pPublishInfo->pTopicName,
+                            ( unsigned long ) pPublishInfo->payloadLength,
+                            ( int ) codecStatus ) );
+            }
         }
-    }
+        else
+        {
+            dispatchToCallbacks( pContext, pPublishInfo );
+        }
+    #else /* if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 ) */
+        dispatchToCallbacks( pContext, pPublishInfo );
+    #endif /* if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 ) */
+
+    TRACE_PROBE2( subscription_dispatch_end, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
 }
 
 /*-----------------------------------------------------------*/
 
+#if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+
+    void SubscriptionManager_SetPayloadCodec( PayloadCodec_t * pCodec )
+    {
+        pPayloadCodec = pCodec;
+    }
+#endif /* if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 ) */
+
+/*-----------------------------------------------------------*/
+
 SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * pTopicFilter,
                                                                   uint16_t topicFilterLength,
                                                                   SubscriptionManagerCallback_t callback )
 {
+    SubscriptionManagerStatus_t returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    SubscriptionRegistry_t * pRegistry = NULL;
+
     assert( pTopicFilter != NULL );
     assert( topicFilterLength != 0 );
     assert( callback != NULL );
 
-    SubscriptionManagerStatus_t returnStatus;
-    size_t availableIndex = MAX_SUBSCRIPTION_CALLBACK_RECORDS;
-    bool recordExists = false;
-    size_t index = 0u;
+    LOCK_REGISTRY_WRITER();
 
-    /* Search for the first available spot in the list to store the record, and also check if
-     * a record for the topic filter already exists. */
-    while( ( recordExists == false ) && ( index < MAX_SUBSCRIPTION_CALLBACK_RECORDS ) )
+    if( storageReady == false )
     {
-        /* Check if the index represents an empty spot in the registry. If we had already
-         * found an empty spot in the list, we will not update it. */
-        if( ( availableIndex == MAX_SUBSCRIPTION_CALLBACK_RECORDS ) &&
-            ( callbackRecordList[ index ].pTopicFilter == NULL ) )
-        {
-            availableIndex = index;
-        }
+        setUpStorage( defaultTrieNodes, defaultChildTable, MAX_SUBSCRIPTION_TRIE_NODES, MAX_SUBSCRIPTION_CALLBACK_RECORDS );
+    }
 
-        /* Check if the current record's topic filter in the registry matches the topic filter
-         * we are trying to register. */
-        else if( ( callbackRecordList[ index ].topicFilterLength == topicFilterLength ) &&
-                 ( strncmp( pTopicFilter, callbackRecordList[ index ].pTopicFilter, topicFilterLength )
-                   == 0 ) )
+    pRegistry = WRITABLE_REGISTRY();
+    returnStatus = registerCallback( pRegistry, pTopicFilter, topicFilterLength, callback );
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+        if( returnStatus == SUBSCRIPTION_MANAGER_SUCCESS )
         {
-            recordExists = true;
+            /* Both copies hold the same nodes, so the update has the same
+             * outcome on the previous one. */
+            ( void ) registerCallback( publishRegistry(), pTopicFilter, topicFilterLength, callback );
         }
+    #endif
 
-        index++;
-    }
+    UNLOCK_REGISTRY_WRITER();
 
-    if( recordExists == true )
+    if( returnStatus == SUBSCRIPTION_MANAGER_RECORD_EXISTS )
     {
         /* The record for the topic filter already exists. */
         LogError( ( "Failed to register callback: Record for topic filter already exists: TopicFilter=%.*s",
                     topicFilterLength,
                     pTopicFilter ) );
-
-        returnStatus = SUBSCRIPTION_MANAGER_RECORD_EXISTS;
     }
-    else if( availableIndex == MAX_SUBSCRIPTION_CALLBACK_RECORDS )
+    else if( returnStatus == SUBSCRIPTION_MANAGER_REGISTRY_FULL )
     {
         /* The registry is full. */
-        LogError( ( "Unable to register callback: Registry list is full: TopicFilter=%.*s, MaxRegistrySize=%u",
+        LogError( ( "Unable to register callback: Registry is full: TopicFilter=%.*s, MaxRegistrySize=%u, "
+                    "MaxTrieNodes=%u",
                     topicFilterLength,
                     pTopicFilter,
-                    MAX_SUBSCRIPTION_CALLBACK_RECORDS ) );
-
-        returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+                    ( unsigned int ) pRegistry->maxRecords,
+                    ( unsigned int ) pRegistry->nodeCapacity ) );
     }
     else
     {
-        callbackRecordList[ availableIndex ].pTopicFilter = pTopicFilter;
-        callbackRecordList[ availableIndex ].topicFilterLength = topicFilterLength;
-        callbackRecordList[ availableIndex ].callback = callback;
-
-        returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
-
         LogDebug( ( "Added callback to registry: TopicFilter=%.*s",
                     topicFilterLength,
                     pTopicFilter ) );
@@ -175,35 +1811,40 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
 void SubscriptionManager_RemoveCallback( const char * pTopicFilter,
                                          uint16_t topicFilterLength )
 {
+    bool removed = false;
+
     assert( pTopicFilter != NULL );
     assert( topicFilterLength != 0 );
 
-    size_t index;
-    SubscriptionManagerRecord_t * pRecord = NULL;
+    LOCK_REGISTRY_WRITER();
 
-    /* Iterate through the records list to find the matching record. */
-    for( index = 0; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+    if( storageReady == true )
     {
-        pRecord = &callbackRecordList[ index ];
+        removed = removeCallback( WRITABLE_REGISTRY(), pTopicFilter, topicFilterLength );
+    }
 
-        /* Only match the non-empty records. */
-        if( pRecord->pTopicFilter != NULL )
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT == 1 )
+        if( removed == true )
         {
-            if( ( topicFilterLength == pRecord->topicFilterLength ) &&
-                ( strncmp( pTopicFilter, pRecord->pTopicFilter, topicFilterLength ) == 0 ) )
-            {
-                break;
-            }
+            /* Once the previous copy is drained, no dispatch can still be using
+             * the topic filter, and the application may free it on return. */
+            ( void ) removeCallback( publishRegistry(), pTopicFilter, topicFilterLength );
         }
-    }
+    #endif
 
-    /* Delete the record by clearing the found entry in the records list. */
-    if( index < MAX_SUBSCRIPTION_CALLBACK_RECORDS )
-    {
-        pRecord->pTopicFilter = NULL;
-        pRecord->topicFilterLength = 0u;
-        pRecord->callback = NULL;
+    /* Workers may still hold the callback in messages queued before the
+     * removal. Wait for them, so that it is not invoked once this returns. */
+    #if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+        if( ( removed == true ) && ( workerCount > 0u ) )
+        {
+            waitForWorkers();
+        }
+    #endif
+
+    UNLOCK_REGISTRY_WRITER();
 
+    if( removed == true )
+    {
         LogDebug( ( "Deleted callback record for topic filter: TopicFilter=%.*s",
                     topicFilterLength,
                     pTopicFilter ) );
@@ -215,4 +1856,93 @@ void SubscriptionManager_RemoveCallback( const char * pTopicFilter,
                    pTopicFilter ) );
     }
 }
+
+/*-----------------------------------------------------------*/
+
+#if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+
+    SubscriptionManagerStatus_t SubscriptionManager_StartWorkers( size_t count )
+    {
+        SubscriptionManagerStatus_t returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+        size_t started = 0u;
+        SubscriptionWorker_t * pWorker = NULL;
+
+        if( ( count == 0u ) || ( count > SUBSCRIPTION_MANAGER_MAX_WORKERS ) || ( workerCount != 0u ) )
+        {
+            LogError( ( "Cannot start subscription workers: WorkerCount=%lu, MaxWorkers=%u, RunningWorkers=%lu",
+                        ( unsigned long ) count,
+                        ( unsigned int ) SUBSCRIPTION_MANAGER_MAX_WORKERS,
+                        ( unsigned long ) workerCount ) );
+            returnStatus = SUBSCRIPTION_MANAGER_BAD_PARAMETER;
+        }
+        else
+        {
+            for( started = 0u; started < count; started++ )
+            {
+                pWorker = &workers[ started ];
+                pWorker->head = 0u;
+                pWorker->count = 0u;
+                pWorker->stopping = false;
+                pWorker->queuedTotal = 0u;
+                pWorker->deliveredTotal = 0u;
+                ( void ) pthread_mutex_init( &pWorker->mutex, NULL );
+                ( void ) pthread_cond_init( &pWorker->notEmpty, NULL );
+                ( void ) pthread_cond_init( &pWorker->notFull, NULL );
+
+                if( pthread_create( &pWorker->thread, NULL, workerThread, pWorker ) != 0 )
+                {
+                    LogError( ( "Failed to create subscription worker thread: WorkerIndex=%lu",
+                                ( unsigned long ) started ) );
+                    ( void ) pthread_mutex_destroy( &pWorker->mutex );
+                    ( void ) pthread_cond_destroy( &pWorker->notEmpty );
+                    ( void ) pthread_cond_destroy( &pWorker->notFull );
+                    returnStatus = SUBSCRIPTION_MANAGER_THREAD_ERROR;
+                    break;
+                }
+            }
+
+            /* Stop the workers already started if one of them failed. */
+            workerCount = started;
+
+            if( returnStatus != SUBSCRIPTION_MANAGER_SUCCESS )
+            {
+                SubscriptionManager_StopWorkers();
+            }
+            else
+            {
+                LogInfo( ( "Started subscription workers: WorkerCount=%lu",
+                           ( unsigned long ) workerCount ) );
+            }
+        }
+
+        return returnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void SubscriptionManager_StopWorkers( void )
+    {
+        size_t index = 0u;
+        SubscriptionWorker_t * pWorker = NULL;
+
+        for( index = 0u; index < workerCount; index++ )
+        {
+            pWorker = &workers[ index ];
+
+            ( void ) pthread_mutex_lock( &pWorker->mutex );
+            pWorker->stopping = true;
+            ( void ) pthread_cond_signal( &pWorker->notEmpty );
+            ( void ) pthread_mutex_unlock( &pWorker->mutex );
+
+            /* The worker delivers its queued messages before it exits. */
+            ( void ) pthread_join( pWorker->thread, NULL );
+
+            ( void ) pthread_mutex_destroy( &pWorker->mutex );
+            ( void ) pthread_cond_destroy( &pWorker->notEmpty );
+            ( void ) pthread_cond_destroy( &pWorker->notFull );
+        }
+
+        workerCount = 0u;
+    }
+#endif /* if ( SUBSCRIPTION_MANAGER_THREADS == 1 ) */
 /*-----------------------------------------------------------*/
@@ -24,6 +24,21 @@
  * @file mqtt_subscription_manager.h
  * @brief The API of a subscription manager for handling subscription callbacks
  * to topic filters in MQTT operations.
+ *
+ * By default, the API must be called from a single thread. Defining
+ * SUBSCRIPTION_MANAGER_CONCURRENT to 1 in demo_config.h allows
+ * #SubscriptionManager_RegisterCallback, #SubscriptionManager_RemoveCallback and
+ * #SubscriptionManager_Init to be called from any thread while another thread
+ * runs #SubscriptionManager_DispatchHandler. Dispatch then reads a published
+ * copy of the registry without locking, while updates are made to a second
+ * copy, published atomically, and replayed on the first copy once no dispatch
+ * reads it. This doubles the registry memory, and requires POSIX threads.
+ *
+ * The worker threads of #SubscriptionManager_StartWorkers, and concurrent mode,
+ * are only built when SUBSCRIPTION_MANAGER_THREADS is 1. The decompression of
+ * PUBLISH payloads with #SubscriptionManager_SetPayloadCodec is only built when
+ * SUBSCRIPTION_MANAGER_PAYLOAD_CODEC is 1. The CMake options of the same names
+ * set them.
  */
 
 #ifndef MQTT_SUBSCRIPTION_MANAGER_H_
@@ -57,6 +72,26 @@
 /* Include MQTT library. */
 #include "core_mqtt.h"
 
+/**
+ * @brief Set to 1 to build the worker threads and concurrent mode, which use
+ * POSIX threads.
+ */
+#ifndef SUBSCRIPTION_MANAGER_THREADS
+    #define SUBSCRIPTION_MANAGER_THREADS    0
+#endif
+
+/**
+ * @brief Set to 1 to build the decompression of PUBLISH payloads.
+ */
+#ifndef SUBSCRIPTION_MANAGER_PAYLOAD_CODEC
+    #define SUBSCRIPTION_MANAGER_PAYLOAD_CODEC    0
+#endif
+
+#if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+    /* Include the payload codec, to decompress PUBLISH payloads. */
+    #include "payload_codec.h"
+#endif
+
 /* Enumeration type for return status value from Subscription Manager API. */
 typedef enum SubscriptionManagerStatus
 {
@@ -74,7 +109,18 @@ typedef enum SubscriptionManagerStatus
      * @brief Failure return value due to an already existing record in the
      * registry for a new callback registration's requested topic filter.
      */
-    SUBSCRIPTION_MANAGER_RECORD_EXISTS = 3
+    SUBSCRIPTION_MANAGER_RECORD_EXISTS = 3,
+
+    /**
+     * @brief Failure return value due to an arena too small to hold a registry.
+     */
+    SUBSCRIPTION_MANAGER_BAD_PARAMETER = 4,
+
+    /**
+     * @brief Failure return value due to a worker thread that could not be
+     * created.
+     */
+    SUBSCRIPTION_MANAGER_THREAD_ERROR = 5
 } SubscriptionManagerStatus_t;
 
 
@@ -90,6 +136,38 @@ typedef enum SubscriptionManagerStatus
 typedef void (* SubscriptionManagerCallback_t )( MQTTContext_t * pContext,
                                                  MQTTPublishInfo_t * pPublishInfo );
 
+/**
+ * @brief Get the size of an arena for #SubscriptionManager_Init that can hold
+ * a given number of topic levels.
+ *
+ * Topic filters that share leading levels share their storage, so a registry
+ * of N topic filters of up to D levels needs at most N * D topic levels.
+ * @param[in] topicLevelCount The number of topic levels to hold.
+ * @return The arena size in bytes.
+ */
+size_t SubscriptionManager_GetArenaSize( uint16_t topicLevelCount );
+
+/**
+ * @brief Move the registry into a caller-supplied arena, so that it can hold
+ * more topic filters than the statically allocated registry.
+ *
+ * In the arena, the number of topic filters is only limited by the space for
+ * their topic levels, up to 65534 levels. Passing a NULL arena returns to the
+ * statically allocated registry.
+ * @param[in] pArena Memory for the registry, or NULL. It must stay valid
+ * until the registry is moved again. In concurrent mode, the arena holds
+ * both copies of the registry, which #SubscriptionManager_GetArenaSize accounts
+ * for.
+ * @param[in] arenaSize The size of @a pArena in bytes.
+ * @note This discards all registered callbacks, and should be called before
+ * registering any.
+ * @return Returns one of the following:
+ * - #SUBSCRIPTION_MANAGER_SUCCESS if the registry now uses the arena.
+ * - #SUBSCRIPTION_MANAGER_BAD_PARAMETER if the arena cannot hold a topic level.
+ */
+SubscriptionManagerStatus_t SubscriptionManager_Init( void * pArena,
+                                                      size_t arenaSize );
+
 /**
  * @brief Dispatches the incoming PUBLISH message to the callbacks that have their
  * registered topic filters matching the incoming PUBLISH topic name. The dispatch
@@ -97,6 +175,9 @@ typedef void (* SubscriptionManagerCallback_t )( MQTTContext_t * pContext,
  *
  * @param[in] pContext The context associated with the MQTT connection.
  * @param[in] pPublishInfo The incoming PUBLISH message information.
+ *
+ * @note In concurrent mode, the callbacks must not register or remove
+ * callbacks, as those wait for running dispatches to finish.
  */
 void SubscriptionManager_DispatchHandler( MQTTContext_t * pContext,
                                           MQTTPublishInfo_t * pPublishInfo );
@@ -121,7 +202,7 @@ void SubscriptionManager_DispatchHandler( MQTTContext_t * pContext,
  * @return Returns one of the following:
  * - #SUBSCRIPTION_MANAGER_SUCCESS if registration of the callback is successful.
  * - #SUBSCRIPTION_MANAGER_REGISTRY_FULL if the registration failed due to registry
- * being already full.
+ * being already full, or having no room left for the topic levels of the topic filter.
  * - #SUBSCRIPTION_MANAGER_RECORD_EXISTS, if a registered callback already exists for
  * the requested topic filter in the subscription manager.
  */
@@ -135,9 +216,68 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
  *
  * @param[in] pTopicFilter The topic filter to remove from the subscription manager.
  * @param[in] topicFilterLength The length of the topic filter string.
+ *
+ * @note In concurrent mode, this returns once no dispatch can still invoke the
+ * callback, so the topic filter memory may be freed on return. With workers
+ * running, it also waits until the workers have delivered the PUBLISH messages
+ * queued before the removal, so the callback is not invoked once this returns.
+ * It must therefore not be called from a callback run by a worker.
  */
 void SubscriptionManager_RemoveCallback( const char * pTopicFilter,
                                          uint16_t topicFilterLength );
 
+#if ( SUBSCRIPTION_MANAGER_THREADS == 1 )
+
+/**
+ * @brief Start worker threads that invoke the callbacks of matching topic
+ * filters, instead of #SubscriptionManager_DispatchHandler invoking them.
+ *
+ * Dispatch then copies each PUBLISH into the queue of one worker, chosen by its
+ * topic name, and returns. PUBLISH messages on one topic name reach their
+ * callbacks in the order they were dispatched, while different topic names are
+ * delivered in parallel. A slow callback therefore delays only the topics of its
+ * worker, not the thread running the MQTT process loop. Dispatch waits when
+ * that worker's queue is full, and delivers a PUBLISH that does not fit a queue
+ * entry itself, after the worker has caught up.
+ *
+ * @param[in] count The number of workers, up to SUBSCRIPTION_MANAGER_MAX_WORKERS.
+ *
+ * @note Callbacks run on the workers may only use the MQTT context passed to
+ * them if the application serializes access to it. Start and stop the workers
+ * while no dispatch runs.
+ *
+ * @return Returns one of the following:
+ * - #SUBSCRIPTION_MANAGER_SUCCESS if the workers are running.
+ * - #SUBSCRIPTION_MANAGER_BAD_PARAMETER if @a count is out of range or workers
+ * are already running.
+ * - #SUBSCRIPTION_MANAGER_THREAD_ERROR if a worker could not be created.
+ */
+    SubscriptionManagerStatus_t SubscriptionManager_StartWorkers( size_t count );
+
+/**
+ * @brief Stop the workers started by #SubscriptionManager_StartWorkers once
+ * they have delivered their queued PUBLISH messages. Dispatch then invokes
+ * callbacks itself again.
+ */
+    void SubscriptionManager_StopWorkers( void );
+#endif /* if ( SUBSCRIPTION_MANAGER_THREADS == 1 ) */
+
+#if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 )
+
+/**
+ * @brief Set the codec with which #SubscriptionManager_DispatchHandler
+ * decompresses PUBLISH payloads compressed by #PayloadCodec_Compress, so
+ * that callbacks receive the original payload.
+ *
+ * Payloads are decompressed into a buffer of
+ * SUBSCRIPTION_MANAGER_DECOMPRESS_BUFFER_SIZE bytes on the stack of the
+ * dispatching thread. A payload that cannot be decompressed is dropped with an
+ * error log, as its callbacks could not make sense of it.
+ *
+ * @param[in] pCodec The codec, or NULL to deliver payloads as received. The
+ * codec must only be used on the thread running dispatch while it is set.
+ */
+    void SubscriptionManager_SetPayloadCodec( PayloadCodec_t * pCodec );
+#endif /* if ( SUBSCRIPTION_MANAGER_PAYLOAD_CODEC == 1 ) */
 
 #endif /* ifndef MQTT_SUBSCRIPTION_MANAGER_H_ */
@@ -0,0 +1,225 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "mqtt_subscription_manager.h"
+
+/* The topic filter of the callback under test, and a topic it matches. */
+#define TOPIC_FILTER           "sensors/+/temperature"
+#define TOPIC_NAME             "sensors/kitchen/temperature"
+
+/* Number of PUBLISH messages dispatched while the callback is blocked. It must
+ * fit the queue of a worker along with the one being delivered. */
+#define PUBLISH_COUNT          ( 3U )
+
+/* How long the removal is given to return while it must still wait. */
+#define REMOVAL_WAIT_NS        ( 100000000L )
+
+static MQTTContext_t context;
+static MQTTPublishInfo_t publishInfo;
+
+/* Protects the state below, shared with the callback and the removal thread. */
+static pthread_mutex_t stateMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stateChanged = PTHREAD_COND_INITIALIZER;
+
+/* Number of calls to #blockingCallback, and whether it may return. */
+static uint32_t callbackCount;
+static bool callbackReleased;
+
+/* Whether #SubscriptionManager_RemoveCallback returned, and whether the
+ * callback was invoked after that. */
+static bool removalReturned;
+static bool calledAfterRemoval;
+
+/* ========================================================================== */
+
+/**
+ * @brief Callback that blocks until #callbackReleased is set.
+ */
+static void blockingCallback( MQTTContext_t * pContext,
+                              MQTTPublishInfo_t * pPublishInfo )
+{
+    TEST_ASSERT_EQUAL_PTR( &context, pContext );
+    TEST_ASSERT_EQUAL_MEMORY( TOPIC_NAME, pPublishInfo->pTopicName, sizeof( TOPIC_NAME ) - 1U );
+
+    ( void ) pthread_mutex_lock( &stateMutex );
+
+    if( removalReturned == true )
+    {
+        calledAfterRemoval = true;
+    }
+
+    callbackCount++;
+    ( void ) pthread_cond_broadcast( &stateChanged );
+
+    while( callbackReleased == false )
+    {
+        ( void ) pthread_cond_wait( &stateChanged, &stateMutex );
+    }
+
+    ( void ) pthread_mutex_unlock( &stateMutex );
+}
+
+/**
+ * @brief Remove the callback under test, and record that the removal returned.
+ */
+static void * removeThread( void * pArgument )
+{
+    ( void ) pArgument;
+
+    SubscriptionManager_RemoveCallback( TOPIC_FILTER, sizeof( TOPIC_FILTER ) - 1U );
+
+    ( void ) pthread_mutex_lock( &stateMutex );
+    removalReturned = true;
+    ( void ) pthread_cond_broadcast( &stateChanged );
+    ( void ) pthread_mutex_unlock( &stateMutex );
+
+    return NULL;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    callbackCount = 0U;
+    callbackReleased = false;
+    removalReturned = false;
+    calledAfterRemoval = false;
+
+    memset( &context, 0, sizeof( context ) );
+    memset( &publishInfo, 0, sizeof( publishInfo ) );
+    publishInfo.pTopicName = TOPIC_NAME;
+    publishInfo.topicNameLength = ( uint16_t ) ( sizeof( TOPIC_NAME ) - 1U );
+    publishInfo.pPayload = "21.5";
+    publishInfo.payloadLength = 4U;
+
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, SubscriptionManager_Init( NULL, 0U ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* Let the workers drain, even when a test failed with the callback
+     * blocked. */
+    ( void ) pthread_mutex_lock( &stateMutex );
+    callbackReleased = true;
+    ( void ) pthread_cond_broadcast( &stateChanged );
+    ( void ) pthread_mutex_unlock( &stateMutex );
+
+    SubscriptionManager_StopWorkers();
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that removing a callback waits for the PUBLISH messages queued
+ * for it on a worker, and that the callback is not invoked once it returns.
+ */
+void test_SubscriptionManager_RemoveCallback_Waits_For_Workers( void )
+{
+    pthread_t thread;
+    struct timespec deadline;
+    uint32_t i = 0U, countBeforeRelease = 0U;
+    int waitResult = 0;
+    bool returnedBeforeRelease = false;
+
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS,
+                       SubscriptionManager_RegisterCallback( TOPIC_FILTER,
+                                                             sizeof( TOPIC_FILTER ) - 1U,
+                                                             blockingCallback ) );
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, SubscriptionManager_StartWorkers( 1U ) );
+
+    /* The first PUBLISH blocks the worker, and the others stay queued. */
+    for( i = 0U; i < PUBLISH_COUNT; i++ )
+    {
+        SubscriptionManager_DispatchHandler( &context, &publishInfo );
+    }
+
+    ( void ) pthread_mutex_lock( &stateMutex );
+
+    while( callbackCount == 0U )
+    {
+        ( void ) pthread_cond_wait( &stateChanged, &stateMutex );
+    }
+
+    ( void ) pthread_mutex_unlock( &stateMutex );
+
+    TEST_ASSERT_EQUAL( 0, pthread_create( &thread, NULL, removeThread, NULL ) );
+
+    /* The removal must not return while the worker still holds messages for
+     * the callback. */
+    ( void ) clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_nsec += REMOVAL_WAIT_NS;
+
+    if( deadline.tv_nsec >= 1000000000L )
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    ( void ) pthread_mutex_lock( &stateMutex );
+
+    while( ( removalReturned == false ) && ( waitResult == 0 ) )
+    {
+        waitResult = pthread_cond_timedwait( &stateChanged, &stateMutex, &deadline );
+    }
+
+    returnedBeforeRelease = removalReturned;
+    countBeforeRelease = callbackCount;
+    callbackReleased = true;
+    ( void ) pthread_cond_broadcast( &stateChanged );
+    ( void ) pthread_mutex_unlock( &stateMutex );
+
+    TEST_ASSERT_FALSE( returnedBeforeRelease );
+    TEST_ASSERT_EQUAL_UINT32( 1U, countBeforeRelease );
+    TEST_ASSERT_EQUAL( 0, pthread_join( thread, NULL ) );
+
+    /* Every queued message was delivered before the removal returned. */
+    TEST_ASSERT_TRUE( removalReturned );
+    TEST_ASSERT_EQUAL_UINT32( PUBLISH_COUNT, callbackCount );
+
+    /* A PUBLISH dispatched after the removal no longer reaches the callback. */
+    SubscriptionManager_DispatchHandler( &context, &publishInfo );
+    SubscriptionManager_StopWorkers();
+
+    TEST_ASSERT_EQUAL_UINT32( PUBLISH_COUNT, callbackCount );
+    TEST_ASSERT_FALSE( calledAfterRemoval );
+}
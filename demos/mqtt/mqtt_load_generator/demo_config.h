@@ -0,0 +1,141 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DEMO_CONFIG_H
+#define DEMO_CONFIG_H
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for DEMO.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for DEMO.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the Demo. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "LOADGEN"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief MQTT server host name.
+ *
+ * This load generator can be run against the open-source Mosquitto broker,
+ * or any other broker or gateway that is being sized. It can also be given
+ * at run time with the -h option.
+ *
+ * #define BROKER_ENDPOINT               "...insert here..."
+ */
+
+/**
+ * @brief MQTT server port number.
+ *
+ * In general, port 1883 is for unsecured MQTT connections, and port 8883 is
+ * for secured MQTT connections.
+ */
+#ifndef BROKER_PORT
+    #if ( LOAD_USE_TLS == 1 )
+        #define BROKER_PORT    ( 8883 )
+    #else
+        #define BROKER_PORT    ( 1883 )
+    #endif
+#endif
+
+/**
+ * @brief Path of the file containing the server's root CA certificate, used
+ * by the TLS load generator.
+ *
+ * This certificate should be PEM-encoded.
+ *
+ * #define ROOT_CA_CERT_PATH         ".....insert here...."
+ */
+
+/**
+ * @brief Paths of the client certificate and its private key, used by the
+ * TLS load generator when the broker requires client authentication. Every
+ * session uses the same credentials.
+ *
+ * These should be PEM-encoded.
+ *
+ * #define CLIENT_CERT_PATH           "...insert here..."
+ * #define CLIENT_PRIVATE_KEY_PATH    "...insert here..."
+ */
+
+/**
+ * @brief Prefix of the client identifier of each session. The index of the
+ * session is appended, so that no two sessions use the same identifier.
+ */
+#ifndef CLIENT_IDENTIFIER
+    #define CLIENT_IDENTIFIER    "loadgen"
+#endif
+
+/**
+ * @brief Default number of concurrent MQTT sessions, set with -n.
+ */
+#define LOAD_DEFAULT_SESSION_COUNT    ( 16U )
+
+/**
+ * @brief Default number of threads the sessions are spread across, set
+ * with -t.
+ */
+#define LOAD_DEFAULT_THREAD_COUNT     ( 2U )
+
+/**
+ * @brief Default number of messages each session publishes per second, set
+ * with -r.
+ */
+#define LOAD_DEFAULT_PUBLISH_RATE     ( 10U )
+
+/**
+ * @brief Default QoS of the publishes and echo subscriptions, set with -q.
+ */
+#define LOAD_DEFAULT_QOS              ( 0U )
+
+/**
+ * @brief Default payload size in bytes, set with -s.
+ */
+#define LOAD_DEFAULT_PAYLOAD_SIZE     ( 64U )
+
+/**
+ * @brief Default duration of the measurement in seconds, set with -d.
+ */
+#define LOAD_DEFAULT_DURATION_SEC     ( 10U )
+
+/**
+ * @brief Size of the network buffer of each session. It bounds the largest
+ * payload that can be published.
+ */
+#define NETWORK_BUFFER_SIZE           ( 4096U )
+
+#endif /* ifndef DEMO_CONFIG_H */
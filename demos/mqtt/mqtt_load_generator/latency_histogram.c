@@ -0,0 +1,218 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file latency_histogram.c
+ * @brief Implements the histogram declared in latency_histogram.h.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* Histogram include. */
+#include "latency_histogram.h"
+
+/**
+ * @brief Number of bits of a value that select its bucket within a power of
+ * two, after the leading bit.
+ */
+#define SUB_BUCKET_BITS    ( 4U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the index of the bucket a value is counted in.
+ *
+ * @param[in] valueUs The value.
+ *
+ * @return The index of the bucket.
+ */
+static uint32_t bucketIndex( uint64_t valueUs );
+
+/**
+ * @brief Get the highest value counted in a bucket.
+ *
+ * @param[in] index The index of the bucket.
+ *
+ * @return The highest value of the bucket.
+ */
+static uint64_t bucketHighestValue( uint32_t index );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t bucketIndex( uint64_t valueUs )
+{
+    uint32_t index = ( uint32_t ) valueUs;
+    uint32_t exponent = SUB_BUCKET_BITS;
+
+    if( valueUs >= LATENCY_HISTOGRAM_SUB_BUCKETS )
+    {
+        /* Find the position of the leading bit. */
+        while( ( exponent < 63U ) && ( ( valueUs >> ( exponent + 1U ) ) != 0U ) )
+        {
+            exponent++;
+        }
+
+        /* The bits after the leading bit select one of the buckets of this
+         * power of two. */
+        index = LATENCY_HISTOGRAM_SUB_BUCKETS +
+                ( ( exponent - SUB_BUCKET_BITS ) * LATENCY_HISTOGRAM_SUB_BUCKETS ) +
+                ( ( uint32_t ) ( valueUs >> ( exponent - SUB_BUCKET_BITS ) ) - LATENCY_HISTOGRAM_SUB_BUCKETS );
+    }
+
+    return index;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t bucketHighestValue( uint32_t index )
+{
+    uint64_t highestValue = index;
+    uint32_t shift = 0U;
+    uint64_t subBucket = 0U;
+
+    if( index >= LATENCY_HISTOGRAM_SUB_BUCKETS )
+    {
+        shift = ( index - LATENCY_HISTOGRAM_SUB_BUCKETS ) / LATENCY_HISTOGRAM_SUB_BUCKETS;
+        subBucket = ( index - LATENCY_HISTOGRAM_SUB_BUCKETS ) % LATENCY_HISTOGRAM_SUB_BUCKETS;
+        highestValue = ( ( LATENCY_HISTOGRAM_SUB_BUCKETS + subBucket ) << shift ) +
+                       ( ( ( uint64_t ) 1U << shift ) - 1U );
+    }
+
+    return highestValue;
+}
+
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Init( LatencyHistogram_t * pHistogram )
+{
+    assert( pHistogram != NULL );
+
+    ( void ) memset( pHistogram, 0x00, sizeof( LatencyHistogram_t ) );
+    pHistogram->minUs = UINT64_MAX;
+}
+
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Record( LatencyHistogram_t * pHistogram,
+                              uint64_t valueUs )
+{
+    assert( pHistogram != NULL );
+
+    pHistogram->buckets[ bucketIndex( valueUs ) ]++;
+    pHistogram->count++;
+    pHistogram->sumUs += valueUs;
+
+    if( valueUs < pHistogram->minUs )
+    {
+        pHistogram->minUs = valueUs;
+    }
+
+    if( valueUs > pHistogram->maxUs )
+    {
+        pHistogram->maxUs = valueUs;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Merge( LatencyHistogram_t * pDestination,
+                             const LatencyHistogram_t * pSource )
+{
+    uint32_t index = 0U;
+
+    assert( pDestination != NULL );
+    assert( pSource != NULL );
+
+    for( index = 0U; index < LATENCY_HISTOGRAM_BUCKETS; index++ )
+    {
+        pDestination->buckets[ index ] += pSource->buckets[ index ];
+    }
+
+    pDestination->count += pSource->count;
+    pDestination->sumUs += pSource->sumUs;
+
+    if( pSource->minUs < pDestination->minUs )
+    {
+        pDestination->minUs = pSource->minUs;
+    }
+
+    if( pSource->maxUs > pDestination->maxUs )
+    {
+        pDestination->maxUs = pSource->maxUs;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t LatencyHistogram_Percentile( const LatencyHistogram_t * pHistogram,
+                                      double percentile )
+{
+    uint64_t value = 0U;
+    uint64_t rank = 0U;
+    uint64_t seen = 0U;
+    uint32_t index = 0U;
+
+    assert( pHistogram != NULL );
+
+    if( pHistogram->count > 0U )
+    {
+        /* The rank of the percentile, counting from 1, rounded up. */
+        rank = ( uint64_t ) ( ( percentile / 100.0 ) * ( double ) pHistogram->count );
+
+        if( ( ( double ) rank ) < ( ( percentile / 100.0 ) * ( double ) pHistogram->count ) )
+        {
+            rank++;
+        }
+
+        if( rank == 0U )
+        {
+            rank = 1U;
+        }
+        else if( rank > pHistogram->count )
+        {
+            rank = pHistogram->count;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        while( seen < rank )
+        {
+            seen += pHistogram->buckets[ index ];
+            index++;
+        }
+
+        value = bucketHighestValue( index - 1U );
+
+        if( value > pHistogram->maxUs )
+        {
+            value = pHistogram->maxUs;
+        }
+    }
+
+    return value;
+}
+
+/*-----------------------------------------------------------*/
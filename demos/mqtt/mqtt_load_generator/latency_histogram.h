@@ -0,0 +1,103 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file latency_histogram.h
+ * @brief A fixed-size histogram of durations in microseconds, for reporting
+ * percentiles such as p50, p99 and p999.
+ *
+ * Values below 16 us have a bucket each. Every larger power of two is split
+ * into 16 buckets of equal width, so a percentile is reported to within
+ * 1/16 of its value across the whole range of a uint64_t, without storing
+ * every sample.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/**
+ * @brief Number of buckets per power of two, and of exact buckets below it.
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKETS    ( 16U )
+
+/**
+ * @brief Total number of buckets of a histogram.
+ *
+ * The exact buckets cover 0 to 15, and each of the powers of two from 2^4 to
+ * 2^63 has #LATENCY_HISTOGRAM_SUB_BUCKETS buckets.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS        ( LATENCY_HISTOGRAM_SUB_BUCKETS * 61U )
+
+/**
+ * @brief Counts of recorded durations.
+ */
+typedef struct LatencyHistogram
+{
+    uint64_t buckets[ LATENCY_HISTOGRAM_BUCKETS ]; /**< @brief Number of values recorded in each bucket. */
+    uint64_t count;                                /**< @brief Number of values recorded. */
+    uint64_t sumUs;                                /**< @brief Sum of the values recorded. */
+    uint64_t minUs;                                /**< @brief Smallest value recorded. */
+    uint64_t maxUs;                                /**< @brief Largest value recorded. */
+} LatencyHistogram_t;
+
+/**
+ * @brief Empty a histogram.
+ *
+ * @param[out] pHistogram The histogram to empty.
+ */
+void LatencyHistogram_Init( LatencyHistogram_t * pHistogram );
+
+/**
+ * @brief Record a duration.
+ *
+ * @param[in] pHistogram The histogram.
+ * @param[in] valueUs The duration in microseconds.
+ */
+void LatencyHistogram_Record( LatencyHistogram_t * pHistogram,
+                              uint64_t valueUs );
+
+/**
+ * @brief Add the values recorded in one histogram to another, such as to
+ * combine the histograms kept by several threads.
+ *
+ * @param[in] pDestination The histogram to add to.
+ * @param[in] pSource The histogram to add.
+ */
+void LatencyHistogram_Merge( LatencyHistogram_t * pDestination,
+                             const LatencyHistogram_t * pSource );
+
+/**
+ * @brief Get the value below which a given share of the recorded values lie.
+ *
+ * @param[in] pHistogram The histogram.
+ * @param[in] percentile The share in percent, such as 99.9 for p999.
+ *
+ * @return The highest value of the bucket holding the percentile, capped at
+ * the largest value recorded; 0 if the histogram is empty.
+ */
+uint64_t LatencyHistogram_Percentile( const LatencyHistogram_t * pHistogram,
+                                      double percentile );
+
+#endif /* ifndef LATENCY_HISTOGRAM_H_ */
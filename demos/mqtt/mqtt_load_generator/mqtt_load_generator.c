@@ -0,0 +1,1170 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Load generator for sizing MQTT brokers and gateways.
+ *
+ * It opens many concurrent MQTT sessions, spread across a number of threads,
+ * with the same transport as the plaintext demo or, when built with
+ * LOAD_USE_TLS set to 1, the same OpenSSL transport as the TLS demos. Each
+ * session subscribes to an echo topic of its own, then publishes to it at a
+ * configured rate, QoS and payload size for a configured duration.
+ *
+ * Every payload starts with the time it was published, so the end-to-end
+ * latency of each echo is measured when it is received. The throughput, the
+ * latency percentiles and the time taken to connect each session are
+ * reported when the run completes, so that transports, libraries and broker
+ * settings can be compared quantitatively.
+ *
+ * Each thread waits on the sockets of its sessions with an event loop, and
+ * processes only the sessions that have data to read.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+#include <unistd.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* Transport implementation. */
+#if ( LOAD_USE_TLS == 1 )
+    #include "openssl_posix.h"
+#else
+    #include "plaintext_posix.h"
+#endif
+
+/* Event loop for waiting on the sessions of a thread. */
+#include "event_loop_posix.h"
+
+/* Clock for timer. */
+#include "clock.h"
+
+/* Histogram of durations. */
+#include "latency_histogram.h"
+
+/**
+ * These configuration settings are required to run the TLS load generator.
+ * Throw compilation error if the below configs are not defined.
+ */
+#if ( LOAD_USE_TLS == 1 ) && !defined( ROOT_CA_CERT_PATH )
+    #error "Please define path to Root CA certificate of the MQTT broker, ROOT_CA_CERT_PATH, in demo_config.h."
+#endif
+#ifndef CLIENT_IDENTIFIER
+    #error "Please define a CLIENT_IDENTIFIER prefix in demo_config.h."
+#endif
+
+/**
+ * @brief The broker to connect to when -b is not given; NULL when it must be
+ * given.
+ */
+#ifdef BROKER_ENDPOINT
+    #define LOAD_DEFAULT_BROKER_ENDPOINT    BROKER_ENDPOINT
+#else
+    #define LOAD_DEFAULT_BROKER_ENDPOINT    NULL
+#endif
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milli seconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS             ( 5000U )
+
+/**
+ * @brief Timeout for receiving SUBACK packet in milli seconds.
+ */
+#define SUBACK_RECV_TIMEOUT_MS              ( 5000U )
+
+/**
+ * @brief The maximum time interval in seconds which is allowed to elapse
+ * between two Control Packets.
+ *
+ * The publishes of a session are its control packets, so every publish
+ * rate of at least one message per second keeps the session alive.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS    ( 60U )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ *
+ * A receive only waits once a socket has been reported readable, for the
+ * rest of a packet that has partly arrived.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS      ( 100U )
+
+/**
+ * @brief Time in milliseconds allowed for establishing each TCP connection.
+ */
+#define TRANSPORT_CONNECT_TIMEOUT_MS        ( 5000U )
+
+/**
+ * @brief Longest time in milliseconds a thread waits for incoming packets
+ * before it checks whether a session is due to publish.
+ */
+#define LOAD_EVENT_WAIT_MAX_MS              ( 10U )
+
+/**
+ * @brief Number of events returned by one wait of the event loop.
+ */
+#define LOAD_EVENTS_PER_WAIT                ( 16U )
+
+/**
+ * @brief Most publishes a session sends at once to catch up with its rate.
+ * Publishes it is further behind by are skipped, so that the reported
+ * throughput shows that the thread could not keep up.
+ */
+#define LOAD_MAX_PUBLISH_BURST              ( 16U )
+
+/**
+ * @brief Time in milliseconds to wait for the last echoes once the sessions
+ * stop publishing.
+ */
+#define LOAD_DRAIN_TIMEOUT_MS               ( 2000U )
+
+/**
+ * @brief Number of bytes at the start of each payload that hold the time it
+ * was published, which is the smallest payload size.
+ */
+#define LOAD_TIMESTAMP_LENGTH               ( sizeof( uint64_t ) )
+
+/**
+ * @brief Size of the buffer holding the client identifier of a session.
+ */
+#define LOAD_MAX_CLIENT_IDENTIFIER_LENGTH   ( 48U )
+
+/**
+ * @brief Size of the buffer holding the echo topic of a session, which is its
+ * client identifier followed by "/echo".
+ */
+#define LOAD_MAX_TOPIC_LENGTH               ( LOAD_MAX_CLIENT_IDENTIFIER_LENGTH + 8U )
+
+/**
+ * @brief Largest payload size, leaving room in the network buffer for the
+ * fixed header, topic and packet identifier of an incoming PUBLISH.
+ */
+#define LOAD_MAX_PAYLOAD_SIZE               ( NETWORK_BUFFER_SIZE - LOAD_MAX_TOPIC_LENGTH - 16U )
+
+/**
+ * @brief The transport functions of the sessions.
+ */
+#if ( LOAD_USE_TLS == 1 )
+    #define LOAD_TRANSPORT_SEND          Openssl_Send
+    #define LOAD_TRANSPORT_RECV          Openssl_Recv
+    #define LOAD_TRANSPORT_DISCONNECT    Openssl_Disconnect
+#else
+    #define LOAD_TRANSPORT_SEND          Plaintext_Send
+    #define LOAD_TRANSPORT_RECV          Plaintext_Recv
+    #define LOAD_TRANSPORT_DISCONNECT    Plaintext_Disconnect
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Parameters of a run, set from the command line.
+ */
+typedef struct LoadConfig
+{
+    const char * pHostName; /**< @brief Host name of the broker. */
+    uint16_t port;          /**< @brief Port of the broker. */
+    uint32_t sessionCount;  /**< @brief Number of concurrent sessions. */
+    uint32_t threadCount;   /**< @brief Number of threads the sessions are spread across. */
+    uint32_t publishRate;   /**< @brief Messages each session publishes per second. */
+    MQTTQoS_t qos;          /**< @brief QoS of the publishes and subscriptions. */
+    size_t payloadSize;     /**< @brief Size of each payload in bytes. */
+    uint32_t durationSec;   /**< @brief Duration of the measurement in seconds. */
+} LoadConfig_t;
+
+struct LoadWorker;
+
+/**
+ * @brief An MQTT session and its connection.
+ */
+typedef struct LoadSession
+{
+    /**
+     * @brief The MQTT context of the session. It is the first member, so
+     * that the event callback can find the session from the context.
+     */
+    MQTTContext_t mqttContext;
+    NetworkContext_t networkContext;                           /**< @brief The connection of the session. */
+    struct LoadWorker * pWorker;                               /**< @brief The thread that owns the session. */
+    uint8_t buffer[ NETWORK_BUFFER_SIZE ];                     /**< @brief Network buffer of the MQTT context. */
+    char clientIdentifier[ LOAD_MAX_CLIENT_IDENTIFIER_LENGTH ]; /**< @brief Client identifier of the session. */
+    uint16_t clientIdentifierLength;                           /**< @brief Length of #LoadSession_t.clientIdentifier. */
+    char topic[ LOAD_MAX_TOPIC_LENGTH ];                       /**< @brief The echo topic the session publishes to. */
+    uint16_t topicLength;                                      /**< @brief Length of #LoadSession_t.topic. */
+    uint16_t subscribePacketIdentifier;                        /**< @brief Packet identifier of the SUBSCRIBE. */
+    bool subAckReceived;                                       /**< @brief Whether the SUBACK was received. */
+    bool subscribed;                                           /**< @brief Whether the broker granted the subscription. */
+    bool connected;                                            /**< @brief Whether the connection is open. */
+    uint64_t nextPublishUs;                                    /**< @brief Time the next publish is due. */
+} LoadSession_t;
+
+/**
+ * @brief A thread, the sessions it owns and its measurements.
+ *
+ * Each thread records into its own histograms and counters, which are
+ * merged once every thread has completed, so recording needs no lock.
+ */
+typedef struct LoadWorker
+{
+    pthread_t thread;                  /**< @brief The thread. */
+    LoadSession_t * pSessions;         /**< @brief The sessions owned by the thread. */
+    uint32_t sessionCount;             /**< @brief Number of sessions in #LoadWorker_t.pSessions. */
+    uint32_t firstSessionIndex;        /**< @brief Index of the first session over all threads. */
+    EventLoop_t eventLoop;             /**< @brief Waits on the sockets of the sessions. */
+    uint8_t * pPayload;                /**< @brief Payload published by every session of the thread. */
+    LatencyHistogram_t latency;        /**< @brief Time from publishing a message to receiving its echo. */
+    LatencyHistogram_t connectTime;    /**< @brief Time to connect the transport, including any TLS handshake. */
+    LatencyHistogram_t handshakeTime;  /**< @brief Time from sending the CONNECT to receiving the CONNACK. */
+    uint64_t publishCount;             /**< @brief Number of messages published. */
+    uint64_t publishFailureCount;      /**< @brief Number of publishes that failed. */
+    uint64_t receiveCount;             /**< @brief Number of echoes received. */
+    uint64_t connectFailureCount;      /**< @brief Number of sessions that failed to connect or subscribe. */
+    uint64_t disconnectCount;          /**< @brief Number of sessions that lost their connection. */
+} LoadWorker_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Parameters of the run. They are set before the threads start and
+ * only read afterwards.
+ */
+static LoadConfig_t loadConfig;
+
+/**
+ * @brief Makes every thread start publishing once all of them have
+ * connected their sessions.
+ */
+static pthread_barrier_t startBarrier;
+
+#if ( LOAD_USE_TLS == 1 )
+
+/**
+ * @brief The TLS context shared by every session, so that the credentials
+ * are loaded once rather than on every connect.
+ */
+    static OpensslTlsContext_t tlsContext;
+
+/**
+ * @brief The credentials every session connects with.
+ */
+    static OpensslCredentials_t opensslCredentials;
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Parse the command line into #loadConfig.
+ *
+ * @param[in] argc Number of arguments.
+ * @param[in] argv The arguments.
+ *
+ * @return EXIT_SUCCESS if the options are valid; EXIT_FAILURE otherwise.
+ */
+static int parseOptions( int argc,
+                         char ** argv );
+
+/**
+ * @brief Connect the transport of a session, establish its MQTT session
+ * and subscribe to its echo topic.
+ *
+ * The times taken by the transport and by the CONNECT are recorded in the
+ * histograms of the thread.
+ *
+ * @param[in] pWorker The thread that owns the session.
+ * @param[in] pSession The session.
+ *
+ * @return EXIT_SUCCESS if the session is subscribed; EXIT_FAILURE otherwise.
+ */
+static int connectSession( LoadWorker_t * pWorker,
+                           LoadSession_t * pSession );
+
+/**
+ * @brief Close the connection of a session.
+ *
+ * @param[in] pWorker The thread that owns the session.
+ * @param[in] pSession The session.
+ * @param[in] sendDisconnect Whether to send a DISCONNECT before closing.
+ */
+static void closeSession( LoadWorker_t * pWorker,
+                          LoadSession_t * pSession,
+                          bool sendDisconnect );
+
+/**
+ * @brief Publish one message on a session, stamped with the current time.
+ *
+ * @param[in] pWorker The thread that owns the session.
+ * @param[in] pSession The session.
+ */
+static void publishMessage( LoadWorker_t * pWorker,
+                            LoadSession_t * pSession );
+
+/**
+ * @brief Wait for incoming packets on the sessions of a thread and process
+ * them.
+ *
+ * @param[in] pWorker The thread.
+ * @param[in] timeoutMs Longest time to wait for a packet.
+ */
+static void processEvents( LoadWorker_t * pWorker,
+                           uint32_t timeoutMs );
+
+/**
+ * @brief Process the packets that have arrived on a session.
+ *
+ * @param[in] pWorker The thread that owns the session.
+ * @param[in] pSession The session.
+ */
+static void processSession( LoadWorker_t * pWorker,
+                            LoadSession_t * pSession );
+
+/**
+ * @brief The thread function: connect the sessions, publish for the
+ * configured duration, wait for the last echoes and disconnect.
+ *
+ * @param[in] pArgument The #LoadWorker_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * runWorker( void * pArgument );
+
+/**
+ * @brief The callback of every MQTT context, which records the latency of
+ * each echo.
+ *
+ * @param[in] pMqttContext MQTT context of the session.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Print the count, mean and percentiles of a histogram.
+ *
+ * @param[in] pName Name of the measurement.
+ * @param[in] pHistogram The histogram.
+ */
+static void printHistogram( const char * pName,
+                            const LatencyHistogram_t * pHistogram );
+
+/*-----------------------------------------------------------*/
+
+static int parseOptions( int argc,
+                         char ** argv )
+{
+    int returnStatus = EXIT_SUCCESS;
+    int option = 0;
+    uint32_t sessionsPerThread = 0U;
+
+    loadConfig.pHostName = LOAD_DEFAULT_BROKER_ENDPOINT;
+    loadConfig.port = BROKER_PORT;
+    loadConfig.sessionCount = LOAD_DEFAULT_SESSION_COUNT;
+    loadConfig.threadCount = LOAD_DEFAULT_THREAD_COUNT;
+    loadConfig.publishRate = LOAD_DEFAULT_PUBLISH_RATE;
+    loadConfig.qos = ( MQTTQoS_t ) LOAD_DEFAULT_QOS;
+    loadConfig.payloadSize = LOAD_DEFAULT_PAYLOAD_SIZE;
+    loadConfig.durationSec = LOAD_DEFAULT_DURATION_SEC;
+
+    while( ( returnStatus == EXIT_SUCCESS ) &&
+           ( ( option = getopt( argc, argv, "b:p:n:t:r:q:s:d:" ) ) != -1 ) )
+    {
+        switch( option )
+        {
+            case 'b':
+                loadConfig.pHostName = optarg;
+                break;
+
+            case 'p':
+                loadConfig.port = ( uint16_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'n':
+                loadConfig.sessionCount = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 't':
+                loadConfig.threadCount = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'r':
+                loadConfig.publishRate = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'q':
+                loadConfig.qos = ( MQTTQoS_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 's':
+                loadConfig.payloadSize = ( size_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'd':
+                loadConfig.durationSec = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            default:
+                returnStatus = EXIT_FAILURE;
+                break;
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        if( ( loadConfig.threadCount > 0U ) && ( loadConfig.sessionCount >= loadConfig.threadCount ) )
+        {
+            sessionsPerThread = ( loadConfig.sessionCount + loadConfig.threadCount - 1U ) /
+                                loadConfig.threadCount;
+        }
+
+        if( loadConfig.pHostName == NULL )
+        {
+            LogError( ( "No broker was given with -b, and BROKER_ENDPOINT is not defined." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else if( ( sessionsPerThread == 0U ) || ( sessionsPerThread > EVENT_LOOP_MAX_CONNECTIONS ) )
+        {
+            LogError( ( "Every thread must own between 1 and %u sessions: sessions=%u, threads=%u.",
+                        ( unsigned int ) EVENT_LOOP_MAX_CONNECTIONS,
+                        ( unsigned int ) loadConfig.sessionCount,
+                        ( unsigned int ) loadConfig.threadCount ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else if( ( loadConfig.publishRate == 0U ) || ( loadConfig.publishRate > 1000000U ) )
+        {
+            LogError( ( "The publish rate must be between 1 and 1000000 messages per second." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else if( loadConfig.qos > MQTTQoS2 )
+        {
+            LogError( ( "The QoS must be 0, 1 or 2." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else if( ( loadConfig.payloadSize < LOAD_TIMESTAMP_LENGTH ) ||
+                 ( loadConfig.payloadSize > LOAD_MAX_PAYLOAD_SIZE ) )
+        {
+            LogError( ( "The payload size must be between %u and %u bytes.",
+                        ( unsigned int ) LOAD_TIMESTAMP_LENGTH,
+                        ( unsigned int ) LOAD_MAX_PAYLOAD_SIZE ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else if( loadConfig.durationSec == 0U )
+        {
+            LogError( ( "The duration must be at least one second." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( returnStatus == EXIT_FAILURE )
+    {
+        ( void ) fprintf( stderr,
+                          "Usage: %s [-b broker] [-p port] [-n sessions] [-t threads]\n"
+                          "       [-r messages per second per session] [-q qos]\n"
+                          "       [-s payload bytes] [-d duration seconds]\n",
+                          argv[ 0 ] );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int connectSession( LoadWorker_t * pWorker,
+                           LoadSession_t * pSession )
+{
+    int returnStatus = EXIT_SUCCESS;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    ServerInfo_t serverInfo;
+    MQTTFixedBuffer_t networkBuffer;
+    TransportInterface_t transport;
+    MQTTConnectInfo_t connectInfo;
+    MQTTSubscribeInfo_t subscribeInfo;
+    bool sessionPresent = false;
+    uint64_t startTimeUs = 0U, connectedTimeUs = 0U;
+    uint32_t entryTimeMs = 0U;
+
+    #if ( LOAD_USE_TLS == 1 )
+        OpensslStatus_t opensslStatus = OPENSSL_SUCCESS;
+    #else
+        SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+        SocketsConfig_t socketsConfig;
+    #endif
+
+    serverInfo.pHostName = loadConfig.pHostName;
+    serverInfo.hostNameLength = strlen( loadConfig.pHostName );
+    serverInfo.port = loadConfig.port;
+
+    ( void ) memset( &pSession->networkContext, 0x00, sizeof( NetworkContext_t ) );
+    pSession->subAckReceived = false;
+    pSession->subscribed = false;
+
+    startTimeUs = Clock_GetTimeUs();
+
+    #if ( LOAD_USE_TLS == 1 )
+        opensslStatus = Openssl_Connect( &pSession->networkContext,
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                         TRANSPORT_SEND_RECV_TIMEOUT_MS );
+
+        if( opensslStatus != OPENSSL_SUCCESS )
+        {
+            LogError( ( "Session %.*s failed to connect: Status=%d.",
+                        pSession->clientIdentifierLength,
+                        pSession->clientIdentifier,
+                        ( int ) opensslStatus ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    #else /* if ( LOAD_USE_TLS == 1 ) */
+        /* The socket is non-blocking, so that a receive only waits when part
+         * of a packet has arrived. */
+        ( void ) memset( &socketsConfig, 0x00, sizeof( socketsConfig ) );
+        socketsConfig.sendTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+        socketsConfig.recvTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+        socketsConfig.nonBlocking = true;
+        socketsConfig.connectTimeoutMs = TRANSPORT_CONNECT_TIMEOUT_MS;
+
+        socketStatus = Plaintext_ConnectWithConfig( &pSession->networkContext,
+                                                    &serverInfo,
+                                                    &socketsConfig );
+
+        if( socketStatus != SOCKETS_SUCCESS )
+        {
+            LogError( ( "Session %.*s failed to connect: Status=%d.",
+                        pSession->clientIdentifierLength,
+                        pSession->clientIdentifier,
+                        ( int ) socketStatus ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    #endif /* if ( LOAD_USE_TLS == 1 ) */
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        connectedTimeUs = Clock_GetTimeUs();
+        LatencyHistogram_Record( &pWorker->connectTime, connectedTimeUs - startTimeUs );
+        pSession->connected = true;
+
+        transport.pNetworkContext = &pSession->networkContext;
+        transport.send = LOAD_TRANSPORT_SEND;
+        transport.recv = LOAD_TRANSPORT_RECV;
+
+        networkBuffer.pBuffer = pSession->buffer;
+        networkBuffer.size = NETWORK_BUFFER_SIZE;
+
+        mqttStatus = MQTT_Init( &pSession->mqttContext,
+                                &transport,
+                                Clock_GetTimeMs,
+                                eventCallback,
+                                &networkBuffer );
+    }
+
+    if( ( returnStatus == EXIT_SUCCESS ) && ( mqttStatus == MQTTSuccess ) )
+    {
+        ( void ) memset( &connectInfo, 0x00, sizeof( connectInfo ) );
+        connectInfo.cleanSession = true;
+        connectInfo.pClientIdentifier = pSession->clientIdentifier;
+        connectInfo.clientIdentifierLength = pSession->clientIdentifierLength;
+        connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+
+        mqttStatus = MQTT_Connect( &pSession->mqttContext,
+                                   &connectInfo,
+                                   NULL,
+                                   CONNACK_RECV_TIMEOUT_MS,
+                                   &sessionPresent );
+
+        if( mqttStatus == MQTTSuccess )
+        {
+            LatencyHistogram_Record( &pWorker->handshakeTime, Clock_GetTimeUs() - connectedTimeUs );
+        }
+    }
+
+    if( ( returnStatus == EXIT_SUCCESS ) && ( mqttStatus == MQTTSuccess ) )
+    {
+        ( void ) memset( &subscribeInfo, 0x00, sizeof( subscribeInfo ) );
+        subscribeInfo.qos = loadConfig.qos;
+        subscribeInfo.pTopicFilter = pSession->topic;
+        subscribeInfo.topicFilterLength = pSession->topicLength;
+
+        pSession->subscribePacketIdentifier = MQTT_GetPacketId( &pSession->mqttContext );
+
+        mqttStatus = MQTT_Subscribe( &pSession->mqttContext,
+                                     &subscribeInfo,
+                                     1U,
+                                     pSession->subscribePacketIdentifier );
+
+        /* Wait for the SUBACK before the session starts publishing. */
+        entryTimeMs = Clock_GetTimeMs();
+
+        while( ( mqttStatus == MQTTSuccess ) &&
+               ( pSession->subAckReceived == false ) &&
+               ( ( Clock_GetTimeMs() - entryTimeMs ) < SUBACK_RECV_TIMEOUT_MS ) )
+        {
+            mqttStatus = MQTT_ProcessLoop( &pSession->mqttContext, 0U );
+        }
+    }
+
+    if( ( returnStatus == EXIT_SUCCESS ) && ( mqttStatus != MQTTSuccess ) )
+    {
+        LogError( ( "Session %.*s failed to establish its MQTT session: Status=%s.",
+                    pSession->clientIdentifierLength,
+                    pSession->clientIdentifier,
+                    MQTT_Status_strerror( mqttStatus ) ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else if( ( returnStatus == EXIT_SUCCESS ) && ( pSession->subscribed == false ) )
+    {
+        LogError( ( "Session %.*s was not subscribed to its echo topic.",
+                    pSession->clientIdentifierLength,
+                    pSession->clientIdentifier ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else if( returnStatus == EXIT_SUCCESS )
+    {
+        if( EventLoop_Add( &pWorker->eventLoop,
+                           pSession->networkContext.socketDescriptor,
+                           &pSession->networkContext,
+                           EVENT_LOOP_READABLE ) != EVENT_LOOP_SUCCESS )
+        {
+            LogError( ( "Failed to add session %.*s to the event loop.",
+                        pSession->clientIdentifierLength,
+                        pSession->clientIdentifier ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( returnStatus == EXIT_FAILURE )
+    {
+        pWorker->connectFailureCount++;
+
+        if( pSession->connected == true )
+        {
+            ( void ) LOAD_TRANSPORT_DISCONNECT( &pSession->networkContext );
+            pSession->connected = false;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeSession( LoadWorker_t * pWorker,
+                          LoadSession_t * pSession,
+                          bool sendDisconnect )
+{
+    if( pSession->connected == true )
+    {
+        if( sendDisconnect == true )
+        {
+            ( void ) MQTT_Disconnect( &pSession->mqttContext );
+        }
+
+        /* The socket must leave the event loop before it is closed. */
+        ( void ) EventLoop_Remove( &pWorker->eventLoop,
+                                   pSession->networkContext.socketDescriptor );
+        ( void ) LOAD_TRANSPORT_DISCONNECT( &pSession->networkContext );
+        pSession->connected = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void publishMessage( LoadWorker_t * pWorker,
+                            LoadSession_t * pSession )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTPublishInfo_t publishInfo;
+    uint16_t packetIdentifier = 0U;
+    uint64_t nowUs = Clock_GetTimeUs();
+
+    /* The payload is copied to the connection by MQTT_Publish, so every
+     * session of the thread can stamp and send the same buffer. */
+    ( void ) memcpy( pWorker->pPayload, &nowUs, LOAD_TIMESTAMP_LENGTH );
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = loadConfig.qos;
+    publishInfo.pTopicName = pSession->topic;
+    publishInfo.topicNameLength = pSession->topicLength;
+    publishInfo.pPayload = pWorker->pPayload;
+    publishInfo.payloadLength = loadConfig.payloadSize;
+
+    if( loadConfig.qos != MQTTQoS0 )
+    {
+        packetIdentifier = MQTT_GetPacketId( &pSession->mqttContext );
+    }
+
+    mqttStatus = MQTT_Publish( &pSession->mqttContext, &publishInfo, packetIdentifier );
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        pWorker->publishCount++;
+    }
+    else
+    {
+        pWorker->publishFailureCount++;
+
+        /* A publish that fails because every in-flight record is in use can
+         * be retried later, but a failed send means the connection is lost. */
+        if( mqttStatus == MQTTSendFailed )
+        {
+            LogError( ( "Session %.*s lost its connection while publishing.",
+                        pSession->clientIdentifierLength,
+                        pSession->clientIdentifier ) );
+            pWorker->disconnectCount++;
+            closeSession( pWorker, pSession, false );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void processSession( LoadWorker_t * pWorker,
+                            LoadSession_t * pSession )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    mqttStatus = MQTT_ProcessLoop( &pSession->mqttContext, 0U );
+
+    #if ( LOAD_USE_TLS == 1 )
+
+        /* Records that OpenSSL has already read from the socket do not make
+         * it readable again, so process them before waiting. */
+        while( ( mqttStatus == MQTTSuccess ) &&
+               ( SSL_pending( pSession->networkContext.pSsl ) > 0 ) )
+        {
+            mqttStatus = MQTT_ProcessLoop( &pSession->mqttContext, 0U );
+        }
+    #endif
+
+    if( mqttStatus != MQTTSuccess )
+    {
+        LogError( ( "Session %.*s lost its connection: Status=%s.",
+                    pSession->clientIdentifierLength,
+                    pSession->clientIdentifier,
+                    MQTT_Status_strerror( mqttStatus ) ) );
+        pWorker->disconnectCount++;
+        closeSession( pWorker, pSession, false );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void processEvents( LoadWorker_t * pWorker,
+                           uint32_t timeoutMs )
+{
+    EventLoopEvent_t events[ LOAD_EVENTS_PER_WAIT ];
+    size_t eventCount = 0U, index = 0U;
+    LoadSession_t * pSession = NULL;
+
+    if( EventLoop_Wait( &pWorker->eventLoop,
+                        events,
+                        LOAD_EVENTS_PER_WAIT,
+                        timeoutMs,
+                        &eventCount ) == EVENT_LOOP_SUCCESS )
+    {
+        for( index = 0U; index < eventCount; index++ )
+        {
+            /* The network context registered with the event loop is a member
+             * of its session. */
+            pSession = ( LoadSession_t * ) ( ( uint8_t * ) events[ index ].pNetworkContext -
+                                             offsetof( LoadSession_t, networkContext ) );
+
+            if( pSession->connected == true )
+            {
+                processSession( pWorker, pSession );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * runWorker( void * pArgument )
+{
+    LoadWorker_t * pWorker = ( LoadWorker_t * ) pArgument;
+    LoadSession_t * pSession = NULL;
+    uint32_t index = 0U, burst = 0U;
+    uint64_t intervalUs = 1000000U / loadConfig.publishRate;
+    uint64_t nowUs = 0U, endUs = 0U, nextDueUs = 0U;
+    uint32_t waitMs = 0U;
+
+    for( index = 0U; index < pWorker->sessionCount; index++ )
+    {
+        ( void ) connectSession( pWorker, &pWorker->pSessions[ index ] );
+    }
+
+    /* Start publishing once every thread has connected its sessions, so that
+     * connecting does not overlap with the measurement. */
+    ( void ) pthread_barrier_wait( &startBarrier );
+
+    nowUs = Clock_GetTimeUs();
+    endUs = nowUs + ( ( uint64_t ) loadConfig.durationSec * 1000000U );
+
+    /* Spread the first publishes of the sessions over one interval. */
+    for( index = 0U; index < pWorker->sessionCount; index++ )
+    {
+        pWorker->pSessions[ index ].nextPublishUs = nowUs +
+                                                    ( ( intervalUs * index ) / pWorker->sessionCount );
+    }
+
+    while( nowUs < endUs )
+    {
+        nextDueUs = endUs;
+
+        for( index = 0U; index < pWorker->sessionCount; index++ )
+        {
+            pSession = &pWorker->pSessions[ index ];
+
+            for( burst = 0U;
+                 ( pSession->connected == true ) && ( pSession->nextPublishUs <= nowUs ) &&
+                 ( burst < LOAD_MAX_PUBLISH_BURST );
+                 burst++ )
+            {
+                publishMessage( pWorker, pSession );
+                pSession->nextPublishUs += intervalUs;
+            }
+
+            if( pSession->nextPublishUs <= nowUs )
+            {
+                pSession->nextPublishUs = nowUs + intervalUs;
+            }
+
+            if( ( pSession->connected == true ) && ( pSession->nextPublishUs < nextDueUs ) )
+            {
+                nextDueUs = pSession->nextPublishUs;
+            }
+        }
+
+        /* Wait for echoes until the next publish is due. */
+        nowUs = Clock_GetTimeUs();
+        waitMs = 0U;
+
+        if( nextDueUs > nowUs )
+        {
+            waitMs = ( uint32_t ) ( ( nextDueUs - nowUs ) / 1000U );
+        }
+
+        if( waitMs > LOAD_EVENT_WAIT_MAX_MS )
+        {
+            waitMs = LOAD_EVENT_WAIT_MAX_MS;
+        }
+
+        processEvents( pWorker, waitMs );
+        nowUs = Clock_GetTimeUs();
+    }
+
+    /* Receive the echoes of the last publishes. */
+    endUs = nowUs + ( ( uint64_t ) LOAD_DRAIN_TIMEOUT_MS * 1000U );
+
+    while( ( nowUs < endUs ) && ( pWorker->receiveCount < pWorker->publishCount ) )
+    {
+        processEvents( pWorker, LOAD_EVENT_WAIT_MAX_MS );
+        nowUs = Clock_GetTimeUs();
+    }
+
+    for( index = 0U; index < pWorker->sessionCount; index++ )
+    {
+        closeSession( pWorker, &pWorker->pSessions[ index ], true );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    /* The MQTT context is the first member of its session. */
+    LoadSession_t * pSession = ( LoadSession_t * ) pMqttContext;
+    LoadWorker_t * pWorker = pSession->pWorker;
+    const MQTTPublishInfo_t * pPublishInfo = NULL;
+    uint64_t sentTimeUs = 0U;
+    uint8_t * pStatusCodes = NULL;
+    size_t statusCount = 0U;
+
+    assert( pPacketInfo != NULL );
+    assert( pDeserializedInfo != NULL );
+
+    if( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+    {
+        pPublishInfo = pDeserializedInfo->pPublishInfo;
+        assert( pPublishInfo != NULL );
+
+        if( pPublishInfo->payloadLength >= LOAD_TIMESTAMP_LENGTH )
+        {
+            ( void ) memcpy( &sentTimeUs, pPublishInfo->pPayload, LOAD_TIMESTAMP_LENGTH );
+            LatencyHistogram_Record( &pWorker->latency, Clock_GetTimeUs() - sentTimeUs );
+            pWorker->receiveCount++;
+        }
+    }
+    else if( ( pPacketInfo->type == MQTT_PACKET_TYPE_SUBACK ) &&
+             ( pDeserializedInfo->packetIdentifier == pSession->subscribePacketIdentifier ) )
+    {
+        pSession->subAckReceived = true;
+
+        if( ( MQTT_GetSubAckStatusCodes( pPacketInfo, &pStatusCodes, &statusCount ) == MQTTSuccess ) &&
+            ( statusCount == 1U ) &&
+            ( pStatusCodes[ 0 ] != ( uint8_t ) MQTTSubAckFailure ) )
+        {
+            pSession->subscribed = true;
+        }
+    }
+    else
+    {
+        /* The library completes the acknowledgements of QoS 1 and QoS 2
+         * publishes. */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void printHistogram( const char * pName,
+                            const LatencyHistogram_t * pHistogram )
+{
+    if( pHistogram->count == 0U )
+    {
+        ( void ) printf( "%-10s no samples\n", pName );
+    }
+    else
+    {
+        ( void ) printf( "%-10s count=%llu min=%llu mean=%llu p50=%llu p99=%llu p999=%llu max=%llu (us)\n",
+                         pName,
+                         ( unsigned long long ) pHistogram->count,
+                         ( unsigned long long ) pHistogram->minUs,
+                         ( unsigned long long ) ( pHistogram->sumUs / pHistogram->count ),
+                         ( unsigned long long ) LatencyHistogram_Percentile( pHistogram, 50.0 ),
+                         ( unsigned long long ) LatencyHistogram_Percentile( pHistogram, 99.0 ),
+                         ( unsigned long long ) LatencyHistogram_Percentile( pHistogram, 99.9 ),
+                         ( unsigned long long ) pHistogram->maxUs );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry point of the load generator.
+ *
+ * Run with -b to name the broker, and the other options to set the load.
+ */
+int main( int argc,
+          char ** argv )
+{
+    int returnStatus = EXIT_SUCCESS;
+    LoadSession_t * pSessions = NULL;
+    LoadWorker_t * pWorkers = NULL;
+    LoadWorker_t * pWorker = NULL;
+    LatencyHistogram_t * pTotals = NULL;
+    uint32_t threadIndex = 0U, sessionIndex = 0U;
+    uint64_t publishCount = 0U, publishFailureCount = 0U, receiveCount = 0U;
+    uint64_t connectFailureCount = 0U, disconnectCount = 0U;
+
+    returnStatus = parseOptions( argc, argv );
+
+    #if ( LOAD_USE_TLS == 1 )
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            ( void ) memset( &opensslCredentials, 0x00, sizeof( opensslCredentials ) );
+            opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+            #if defined( CLIENT_CERT_PATH ) && defined( CLIENT_PRIVATE_KEY_PATH )
+                opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
+                opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+            #endif
+
+            if( Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) != OPENSSL_SUCCESS )
+            {
+                LogError( ( "Failed to load the TLS credentials." ) );
+                returnStatus = EXIT_FAILURE;
+            }
+            else
+            {
+                opensslCredentials.sniHostName = loadConfig.pHostName;
+                opensslCredentials.pTlsContext = &tlsContext;
+            }
+        }
+    #endif /* if ( LOAD_USE_TLS == 1 ) */
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        pSessions = calloc( loadConfig.sessionCount, sizeof( LoadSession_t ) );
+        pWorkers = calloc( loadConfig.threadCount, sizeof( LoadWorker_t ) );
+        pTotals = calloc( 3U, sizeof( LatencyHistogram_t ) );
+
+        if( ( pSessions == NULL ) || ( pWorkers == NULL ) || ( pTotals == NULL ) )
+        {
+            LogError( ( "Failed to allocate %u sessions.", ( unsigned int ) loadConfig.sessionCount ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else if( pthread_barrier_init( &startBarrier, NULL, loadConfig.threadCount ) != 0 )
+        {
+            LogError( ( "Failed to create the start barrier." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        LatencyHistogram_Init( &pTotals[ 0 ] );
+        LatencyHistogram_Init( &pTotals[ 1 ] );
+        LatencyHistogram_Init( &pTotals[ 2 ] );
+
+        LogInfo( ( "Connecting %u sessions to %s:%u across %u threads.",
+                   ( unsigned int ) loadConfig.sessionCount,
+                   loadConfig.pHostName,
+                   ( unsigned int ) loadConfig.port,
+                   ( unsigned int ) loadConfig.threadCount ) );
+
+        for( sessionIndex = 0U; sessionIndex < loadConfig.sessionCount; sessionIndex++ )
+        {
+            pSessions[ sessionIndex ].clientIdentifierLength =
+                ( uint16_t ) snprintf( pSessions[ sessionIndex ].clientIdentifier,
+                                       LOAD_MAX_CLIENT_IDENTIFIER_LENGTH,
+                                       "%s-%u",
+                                       CLIENT_IDENTIFIER,
+                                       ( unsigned int ) sessionIndex );
+            pSessions[ sessionIndex ].topicLength =
+                ( uint16_t ) snprintf( pSessions[ sessionIndex ].topic,
+                                       LOAD_MAX_TOPIC_LENGTH,
+                                       "%s/echo",
+                                       pSessions[ sessionIndex ].clientIdentifier );
+        }
+
+        /* Split the sessions evenly between the threads. */
+        for( threadIndex = 0U; threadIndex < loadConfig.threadCount; threadIndex++ )
+        {
+            pWorker = &pWorkers[ threadIndex ];
+            pWorker->firstSessionIndex = ( threadIndex * loadConfig.sessionCount ) / loadConfig.threadCount;
+            pWorker->sessionCount = ( ( ( threadIndex + 1U ) * loadConfig.sessionCount ) / loadConfig.threadCount ) -
+                                    pWorker->firstSessionIndex;
+            pWorker->pSessions = &pSessions[ pWorker->firstSessionIndex ];
+            pWorker->pPayload = malloc( loadConfig.payloadSize );
+            LatencyHistogram_Init( &pWorker->latency );
+            LatencyHistogram_Init( &pWorker->connectTime );
+            LatencyHistogram_Init( &pWorker->handshakeTime );
+
+            for( sessionIndex = 0U; sessionIndex < pWorker->sessionCount; sessionIndex++ )
+            {
+                pWorker->pSessions[ sessionIndex ].pWorker = pWorker;
+            }
+
+            if( pWorker->pPayload != NULL )
+            {
+                ( void ) memset( pWorker->pPayload, 'x', loadConfig.payloadSize );
+            }
+
+            if( ( pWorker->pPayload == NULL ) ||
+                ( EventLoop_Init( &pWorker->eventLoop ) != EVENT_LOOP_SUCCESS ) ||
+                ( pthread_create( &pWorker->thread, NULL, runWorker, pWorker ) != 0 ) )
+            {
+                /* The threads that have started wait at the start barrier for
+                 * every thread, so the run cannot complete. */
+                LogError( ( "Failed to start thread %u.", ( unsigned int ) threadIndex ) );
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        for( threadIndex = 0U; threadIndex < loadConfig.threadCount; threadIndex++ )
+        {
+            pWorker = &pWorkers[ threadIndex ];
+            ( void ) pthread_join( pWorker->thread, NULL );
+            ( void ) EventLoop_Deinit( &pWorker->eventLoop );
+
+            LatencyHistogram_Merge( &pTotals[ 0 ], &pWorker->latency );
+            LatencyHistogram_Merge( &pTotals[ 1 ], &pWorker->connectTime );
+            LatencyHistogram_Merge( &pTotals[ 2 ], &pWorker->handshakeTime );
+            publishCount += pWorker->publishCount;
+            publishFailureCount += pWorker->publishFailureCount;
+            receiveCount += pWorker->receiveCount;
+            connectFailureCount += pWorker->connectFailureCount;
+            disconnectCount += pWorker->disconnectCount;
+            free( pWorker->pPayload );
+        }
+
+        ( void ) pthread_barrier_destroy( &startBarrier );
+
+        ( void ) printf( "Sessions   %u requested, %llu failed to connect, %llu disconnected\n",
+                         ( unsigned int ) loadConfig.sessionCount,
+                         ( unsigned long long ) connectFailureCount,
+                         ( unsigned long long ) disconnectCount );
+        ( void ) printf( "Load       %u threads, %u msg/s per session, QoS %u, %lu byte payloads, %u s\n",
+                         ( unsigned int ) loadConfig.threadCount,
+                         ( unsigned int ) loadConfig.publishRate,
+                         ( unsigned int ) loadConfig.qos,
+                         ( unsigned long ) loadConfig.payloadSize,
+                         ( unsigned int ) loadConfig.durationSec );
+        ( void ) printf( "Throughput published=%llu (%.1f msg/s) failed=%llu received=%llu (%.1f msg/s, %.1f KiB/s)\n",
+                         ( unsigned long long ) publishCount,
+                         ( double ) publishCount / ( double ) loadConfig.durationSec,
+                         ( unsigned long long ) publishFailureCount,
+                         ( unsigned long long ) receiveCount,
+                         ( double ) receiveCount / ( double ) loadConfig.durationSec,
+                         ( ( double ) receiveCount * ( double ) loadConfig.payloadSize ) /
+                         ( 1024.0 * ( double ) loadConfig.durationSec ) );
+        printHistogram( "Latency", &pTotals[ 0 ] );
+        printHistogram( "Connect", &pTotals[ 1 ] );
+        printHistogram( "Handshake", &pTotals[ 2 ] );
+
+        if( ( connectFailureCount > 0U ) || ( disconnectCount > 0U ) )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    #if ( LOAD_USE_TLS == 1 )
+        if( opensslCredentials.pTlsContext != NULL )
+        {
+            ( void ) Openssl_TlsContextCleanup( &tlsContext );
+        }
+    #endif
+
+    free( pTotals );
+    free( pWorkers );
+    free( pSessions );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,454 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file network_buffer.c
+ * @brief Implementation of the growable network buffer.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the network buffer. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "NetworkBuffer"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+#include "network_buffer.h"
+
+/**
+ * @brief The next byte received is the first byte of a packet.
+ */
+#define HEADER_STATE_TYPE             ( 0U )
+
+/**
+ * @brief The next byte received is part of the remaining length.
+ */
+#define HEADER_STATE_LENGTH           ( 1U )
+
+/**
+ * @brief The next byte received is part of the packet body.
+ */
+#define HEADER_STATE_BODY             ( 2U )
+
+/**
+ * @brief The remaining length takes at most 4 bytes of 7 bits each.
+ */
+#define REMAINING_LENGTH_MAX_SHIFT    ( 21U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a contiguous run of free blocks from a pool.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] blockCount Number of blocks to take.
+ * @param[out] pFirstBlock The first block of the run.
+ *
+ * @return true if the blocks were taken.
+ */
+static bool takeBlocks( NetworkBufferPool_t * pPool,
+                        size_t blockCount,
+                        size_t * pFirstBlock );
+
+/**
+ * @brief Return a run of blocks to a pool.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] firstBlock The first block of the run.
+ * @param[in] blockCount Number of blocks in the run.
+ */
+static void returnBlocks( NetworkBufferPool_t * pPool,
+                          size_t firstBlock,
+                          size_t blockCount );
+
+/**
+ * @brief Point the MQTT context at pool blocks large enough for a packet
+ * body, if the small buffer cannot hold it.
+ *
+ * @param[in] pNetworkBuffer The network buffer.
+ * @param[in] packetLength The remaining length of the packet.
+ */
+static void growFor( NetworkBuffer_t * pNetworkBuffer,
+                     size_t packetLength );
+
+/**
+ * @brief Return to the small buffer, and its pool blocks to the pool.
+ *
+ * @param[in] pNetworkBuffer The network buffer.
+ */
+static void shrink( NetworkBuffer_t * pNetworkBuffer );
+
+/**
+ * @brief Follow the packet framing over received bytes, and grow the buffer
+ * once the remaining length of a packet is known.
+ *
+ * @param[in] pNetworkBuffer The network buffer.
+ * @param[in] pBytes The received bytes.
+ * @param[in] byteCount Number of received bytes.
+ */
+static void trackReceived( NetworkBuffer_t * pNetworkBuffer,
+                           const uint8_t * pBytes,
+                           size_t byteCount );
+
+/*-----------------------------------------------------------*/
+
+static bool takeBlocks( NetworkBufferPool_t * pPool,
+                        size_t blockCount,
+                        size_t * pFirstBlock )
+{
+    bool taken = false;
+    size_t runStart = 0U;
+    size_t runLength = 0U;
+    size_t i = 0U;
+
+    ( void ) pthread_mutex_lock( &pPool->mutex );
+
+    /* Take the first run that is long enough. */
+    for( i = 0U; ( i < pPool->blockCount ) && ( taken == false ); i++ )
+    {
+        if( pPool->blockUsed[ i ] == true )
+        {
+            runStart = i + 1U;
+            runLength = 0U;
+        }
+        else
+        {
+            runLength++;
+
+            if( runLength == blockCount )
+            {
+                ( void ) memset( &pPool->blockUsed[ runStart ], 1, blockCount * sizeof( bool ) );
+                *pFirstBlock = runStart;
+                taken = true;
+            }
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &pPool->mutex );
+
+    return taken;
+}
+
+/*-----------------------------------------------------------*/
+
+static void returnBlocks( NetworkBufferPool_t * pPool,
+                          size_t firstBlock,
+                          size_t blockCount )
+{
+    size_t i = 0U;
+
+    ( void ) pthread_mutex_lock( &pPool->mutex );
+
+    for( i = firstBlock; i < ( firstBlock + blockCount ); i++ )
+    {
+        pPool->blockUsed[ i ] = false;
+    }
+
+    ( void ) pthread_mutex_unlock( &pPool->mutex );
+}
+
+/*-----------------------------------------------------------*/
+
+static void growFor( NetworkBuffer_t * pNetworkBuffer,
+                     size_t packetLength )
+{
+    NetworkBufferPool_t * pPool = pNetworkBuffer->pPool;
+    size_t blockCount = 0U;
+    size_t firstBlock = 0U;
+
+    if( packetLength > pNetworkBuffer->baseSize )
+    {
+        blockCount = ( packetLength + pPool->blockSize - 1U ) / pPool->blockSize;
+
+        if( ( blockCount <= pPool->blockCount ) &&
+            ( takeBlocks( pPool, blockCount, &firstBlock ) == true ) )
+        {
+            pNetworkBuffer->firstBlock = firstBlock;
+            pNetworkBuffer->grownBlocks = blockCount;
+            pNetworkBuffer->pMqttContext->networkBuffer.pBuffer = &pPool->pArena[ firstBlock * pPool->blockSize ];
+            pNetworkBuffer->pMqttContext->networkBuffer.size = blockCount * pPool->blockSize;
+
+            LogDebug( ( "Grew network buffer for a large packet: PacketLength=%lu, BufferSize=%lu",
+                        ( unsigned long ) packetLength,
+                        ( unsigned long ) ( blockCount * pPool->blockSize ) ) );
+        }
+        else
+        {
+            LogWarn( ( "No room in the network buffer pool for a large packet, which will be discarded: "
+                       "PacketLength=%lu, BlockSize=%lu, BlockCount=%lu",
+                       ( unsigned long ) packetLength,
+                       ( unsigned long ) pPool->blockSize,
+                       ( unsigned long ) pPool->blockCount ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void shrink( NetworkBuffer_t * pNetworkBuffer )
+{
+    if( pNetworkBuffer->grownBlocks > 0U )
+    {
+        returnBlocks( pNetworkBuffer->pPool,
+                      pNetworkBuffer->firstBlock,
+                      pNetworkBuffer->grownBlocks );
+        pNetworkBuffer->grownBlocks = 0U;
+        pNetworkBuffer->pMqttContext->networkBuffer.pBuffer = pNetworkBuffer->pBaseBuffer;
+        pNetworkBuffer->pMqttContext->networkBuffer.size = pNetworkBuffer->baseSize;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void trackReceived( NetworkBuffer_t * pNetworkBuffer,
+                           const uint8_t * pBytes,
+                           size_t byteCount )
+{
+    size_t i = 0U;
+    size_t bodyBytes = 0U;
+
+    while( i < byteCount )
+    {
+        if( pNetworkBuffer->headerState == HEADER_STATE_TYPE )
+        {
+            pNetworkBuffer->remainingLength = 0U;
+            pNetworkBuffer->lengthShift = 0U;
+            pNetworkBuffer->headerState = HEADER_STATE_LENGTH;
+            i++;
+        }
+        else if( pNetworkBuffer->headerState == HEADER_STATE_LENGTH )
+        {
+            pNetworkBuffer->remainingLength |= ( size_t ) ( pBytes[ i ] & 0x7FU ) << pNetworkBuffer->lengthShift;
+
+            if( ( pBytes[ i ] & 0x80U ) == 0U )
+            {
+                /* coreMQTT checks the length against its buffer next. */
+                growFor( pNetworkBuffer, pNetworkBuffer->remainingLength );
+
+                if( pNetworkBuffer->remainingLength > pNetworkBuffer->largestPacket )
+                {
+                    pNetworkBuffer->largestPacket = pNetworkBuffer->remainingLength;
+                }
+
+                pNetworkBuffer->bodyBytesLeft = pNetworkBuffer->remainingLength;
+                pNetworkBuffer->headerState = ( pNetworkBuffer->remainingLength > 0U ) ?
+                                              HEADER_STATE_BODY : HEADER_STATE_TYPE;
+            }
+            else if( pNetworkBuffer->lengthShift == REMAINING_LENGTH_MAX_SHIFT )
+            {
+                /* coreMQTT rejects the malformed length and the connection
+                 * is of no further use. */
+                pNetworkBuffer->headerState = HEADER_STATE_TYPE;
+            }
+            else
+            {
+                pNetworkBuffer->lengthShift += 7U;
+            }
+
+            i++;
+        }
+        else
+        {
+            bodyBytes = byteCount - i;
+
+            if( bodyBytes > pNetworkBuffer->bodyBytesLeft )
+            {
+                bodyBytes = pNetworkBuffer->bodyBytesLeft;
+            }
+
+            pNetworkBuffer->bodyBytesLeft -= bodyBytes;
+            i += bodyBytes;
+
+            if( pNetworkBuffer->bodyBytesLeft == 0U )
+            {
+                pNetworkBuffer->headerState = HEADER_STATE_TYPE;
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+NetworkBufferStatus_t NetworkBufferPool_Init( NetworkBufferPool_t * pPool,
+                                              void * pArena,
+                                              size_t arenaSize,
+                                              size_t blockSize )
+{
+    NetworkBufferStatus_t status = NetworkBufferSuccess;
+
+    if( ( pPool == NULL ) || ( pArena == NULL ) || ( blockSize == 0U ) ||
+        ( arenaSize < blockSize ) ||
+        ( ( arenaSize / blockSize ) > NETWORK_BUFFER_POOL_MAX_BLOCKS ) )
+    {
+        LogError( ( "Invalid network buffer pool: ArenaSize=%lu, BlockSize=%lu, MaxBlocks=%u",
+                    ( unsigned long ) arenaSize,
+                    ( unsigned long ) blockSize,
+                    ( unsigned int ) NETWORK_BUFFER_POOL_MAX_BLOCKS ) );
+        status = NetworkBufferBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pPool, 0x00, sizeof( NetworkBufferPool_t ) );
+        pPool->pArena = pArena;
+        pPool->blockSize = blockSize;
+        pPool->blockCount = arenaSize / blockSize;
+        ( void ) pthread_mutex_init( &pPool->mutex, NULL );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void NetworkBufferPool_Cleanup( NetworkBufferPool_t * pPool )
+{
+    if( pPool != NULL )
+    {
+        ( void ) pthread_mutex_destroy( &pPool->mutex );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+NetworkBufferStatus_t NetworkBuffer_Init( NetworkBuffer_t * pNetworkBuffer,
+                                          MQTTContext_t * pMqttContext,
+                                          NetworkBufferPool_t * pPool,
+                                          const TransportInterface_t * pTransport,
+                                          uint8_t * pBaseBuffer,
+                                          size_t baseSize,
+                                          TransportInterface_t * pWrappedTransport,
+                                          MQTTFixedBuffer_t * pFixedBuffer )
+{
+    NetworkBufferStatus_t status = NetworkBufferSuccess;
+
+    if( ( pNetworkBuffer == NULL ) || ( pMqttContext == NULL ) || ( pPool == NULL ) ||
+        ( pTransport == NULL ) || ( pBaseBuffer == NULL ) || ( baseSize == 0U ) ||
+        ( pWrappedTransport == NULL ) || ( pFixedBuffer == NULL ) )
+    {
+        status = NetworkBufferBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pNetworkBuffer, 0x00, sizeof( NetworkBuffer_t ) );
+        pNetworkBuffer->pMqttContext = pMqttContext;
+        pNetworkBuffer->pPool = pPool;
+        pNetworkBuffer->transport = *pTransport;
+        pNetworkBuffer->pBaseBuffer = pBaseBuffer;
+        pNetworkBuffer->baseSize = baseSize;
+        pNetworkBuffer->headerState = HEADER_STATE_TYPE;
+
+        /* The wrapper functions only ever cast the context back. */
+        pWrappedTransport->pNetworkContext = ( NetworkContext_t * ) pNetworkBuffer;
+        pWrappedTransport->recv = NetworkBuffer_Recv;
+        pWrappedTransport->send = NetworkBuffer_Send;
+
+        pFixedBuffer->pBuffer = pBaseBuffer;
+        pFixedBuffer->size = baseSize;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+NetworkBufferStatus_t NetworkBuffer_Shrink( NetworkBuffer_t * pNetworkBuffer )
+{
+    NetworkBufferStatus_t status = NetworkBufferSuccess;
+
+    if( pNetworkBuffer == NULL )
+    {
+        status = NetworkBufferBadParameter;
+    }
+    else if( pNetworkBuffer->headerState != HEADER_STATE_TYPE )
+    {
+        status = NetworkBufferBusy;
+    }
+    else
+    {
+        shrink( pNetworkBuffer );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t NetworkBuffer_Recv( const NetworkContext_t * pNetworkContext,
+                            void * pBuffer,
+                            size_t bytesToRecv )
+{
+    NetworkBuffer_t * pNetworkBuffer = ( NetworkBuffer_t * ) pNetworkContext;
+    int32_t bytesReceived = 0;
+
+    assert( pNetworkBuffer != NULL );
+
+    /* coreMQTT asks for the first byte of a packet once it is done with the
+     * previous one, so a grown buffer can go back to the pool. */
+    if( pNetworkBuffer->headerState == HEADER_STATE_TYPE )
+    {
+        shrink( pNetworkBuffer );
+    }
+
+    bytesReceived = pNetworkBuffer->transport.recv( pNetworkBuffer->transport.pNetworkContext,
+                                                    pBuffer,
+                                                    bytesToRecv );
+
+    if( bytesReceived > 0 )
+    {
+        trackReceived( pNetworkBuffer, pBuffer, ( size_t ) bytesReceived );
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t NetworkBuffer_Send( const NetworkContext_t * pNetworkContext,
+                            const void * pBuffer,
+                            size_t bytesToSend )
+{
+    const NetworkBuffer_t * pNetworkBuffer = ( const NetworkBuffer_t * ) pNetworkContext;
+
+    assert( pNetworkBuffer != NULL );
+
+    return pNetworkBuffer->transport.send( pNetworkBuffer->transport.pNetworkContext,
+                                           pBuffer,
+                                           bytesToSend );
+}
+
+/*-----------------------------------------------------------*/
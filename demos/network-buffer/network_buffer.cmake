@@ -0,0 +1,6 @@
+# Configuration for the network buffer that grows from a pool for large
+# incoming packets.
+set( NETWORK_BUFFER_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
+set( NETWORK_BUFFER_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/network_buffer.c )
@@ -0,0 +1,198 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file network_buffer.h
+ * @brief A network buffer for an MQTT connection that starts small and grows
+ * from a bounded pool for the occasional large incoming packet.
+ *
+ * The network buffer wraps the transport interface of the connection. As
+ * coreMQTT receives a packet, the wrapper reads the remaining length from the
+ * fixed header. When the packet does not fit the small buffer given to
+ * #NetworkBuffer_Init, the wrapper points the network buffer of the MQTT
+ * context at enough contiguous blocks of the pool before coreMQTT checks the
+ * length. The blocks return to the pool once coreMQTT asks for the next
+ * packet. A packet larger than the free part of the pool is discarded by
+ * coreMQTT as it would be without the pool.
+ *
+ * Only incoming packets grow the buffer: coreMQTT sends the payload of an
+ * outgoing PUBLISH straight from the application, so the network buffer only
+ * has to hold its header.
+ */
+
+#ifndef NETWORK_BUFFER_H_
+#define NETWORK_BUFFER_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/**
+ * @brief The most blocks a pool can be divided into.
+ */
+#ifndef NETWORK_BUFFER_POOL_MAX_BLOCKS
+    #define NETWORK_BUFFER_POOL_MAX_BLOCKS    ( 64U )
+#endif
+
+/**
+ * @brief Return codes from the network buffer functions.
+ */
+typedef enum NetworkBufferStatus
+{
+    NetworkBufferSuccess,      /**< @brief The function completed successfully. */
+    NetworkBufferBadParameter, /**< @brief A parameter was NULL, zero, or out of range. */
+    NetworkBufferBusy          /**< @brief The buffer holds a packet being received. */
+} NetworkBufferStatus_t;
+
+/**
+ * @brief A pool of equally sized blocks that grown network buffers take
+ * contiguous runs of. A pool may be shared by the connections of several
+ * threads.
+ */
+typedef struct NetworkBufferPool
+{
+    uint8_t * pArena;                                /**< @brief Memory of the blocks. */
+    size_t blockSize;                                /**< @brief Size of each block. */
+    size_t blockCount;                               /**< @brief Number of blocks. */
+    bool blockUsed[ NETWORK_BUFFER_POOL_MAX_BLOCKS ]; /**< @brief Whether each block is taken. */
+    pthread_mutex_t mutex;                           /**< @brief Serializes taking and returning blocks. */
+} NetworkBufferPool_t;
+
+/**
+ * @brief The network buffer of one MQTT connection, set up by
+ * #NetworkBuffer_Init.
+ */
+typedef struct NetworkBuffer
+{
+    MQTTContext_t * pMqttContext;   /**< @brief Context whose network buffer is managed. */
+    NetworkBufferPool_t * pPool;    /**< @brief Pool to grow from. */
+    TransportInterface_t transport; /**< @brief The wrapped transport. */
+    uint8_t * pBaseBuffer;          /**< @brief The small buffer used between large packets. */
+    size_t baseSize;                /**< @brief Size of @p pBaseBuffer. */
+    size_t firstBlock;              /**< @brief First pool block of the grown buffer. */
+    size_t grownBlocks;             /**< @brief Pool blocks held, 0 when not grown. */
+    uint8_t headerState;            /**< @brief Part of the packet the next byte belongs to. */
+    size_t remainingLength;         /**< @brief Remaining length decoded so far. */
+    size_t lengthShift;             /**< @brief Shift of the next remaining length byte. */
+    size_t bodyBytesLeft;           /**< @brief Bytes of the packet body still to come. */
+    size_t largestPacket;           /**< @brief Largest remaining length received since
+                                     * #NetworkBuffer_Init, to size the base buffer from. */
+} NetworkBuffer_t;
+
+/**
+ * @brief Set up a pool.
+ *
+ * @param[out] pPool The pool.
+ * @param[in] pArena Memory for the blocks, which must stay valid while the
+ * pool is used.
+ * @param[in] arenaSize Size of @p pArena, divided into blocks of @p blockSize
+ * bytes, at most #NETWORK_BUFFER_POOL_MAX_BLOCKS of them.
+ * @param[in] blockSize Size of each block. Larger blocks waste more of the
+ * last block of a packet; smaller ones make contiguous runs harder to find.
+ *
+ * @return #NetworkBufferSuccess, or #NetworkBufferBadParameter.
+ */
+NetworkBufferStatus_t NetworkBufferPool_Init( NetworkBufferPool_t * pPool,
+                                              void * pArena,
+                                              size_t arenaSize,
+                                              size_t blockSize );
+
+/**
+ * @brief Release the resources of a pool once no network buffer uses it.
+ *
+ * @param[in] pPool The pool.
+ */
+void NetworkBufferPool_Cleanup( NetworkBufferPool_t * pPool );
+
+/**
+ * @brief Set up the network buffer of a connection. Call it before MQTT_Init,
+ * and again for every new connection.
+ *
+ * @param[out] pNetworkBuffer The network buffer, which must stay valid while
+ * the MQTT context is used.
+ * @param[in] pMqttContext The MQTT context the network buffer is for.
+ * @param[in] pPool The pool to grow from.
+ * @param[in] pTransport The transport of the connection.
+ * @param[in] pBaseBuffer The buffer for packets that fit it.
+ * @param[in] baseSize Size of @p pBaseBuffer.
+ * @param[out] pWrappedTransport The transport interface to pass to MQTT_Init.
+ * @param[out] pFixedBuffer The network buffer to pass to MQTT_Init.
+ *
+ * @return #NetworkBufferSuccess, or #NetworkBufferBadParameter.
+ */
+NetworkBufferStatus_t NetworkBuffer_Init( NetworkBuffer_t * pNetworkBuffer,
+                                          MQTTContext_t * pMqttContext,
+                                          NetworkBufferPool_t * pPool,
+                                          const TransportInterface_t * pTransport,
+                                          uint8_t * pBaseBuffer,
+                                          size_t baseSize,
+                                          TransportInterface_t * pWrappedTransport,
+                                          MQTTFixedBuffer_t * pFixedBuffer );
+
+/**
+ * @brief Return the blocks of a grown buffer to the pool, if no packet is
+ * being received into it. Receiving the next packet also does this, so it is
+ * only needed to free the blocks of an idle connection early.
+ *
+ * @param[in] pNetworkBuffer The network buffer.
+ *
+ * @return #NetworkBufferSuccess; #NetworkBufferBusy if a packet is being
+ * received; #NetworkBufferBadParameter if @p pNetworkBuffer is NULL.
+ */
+NetworkBufferStatus_t NetworkBuffer_Shrink( NetworkBuffer_t * pNetworkBuffer );
+
+/**
+ * @brief The transport receive function of a network buffer, which follows
+ * the packets received through the wrapped transport.
+ *
+ * @param[in] pNetworkContext The #NetworkBuffer_t.
+ * @param[out] pBuffer Buffer for the received bytes.
+ * @param[in] bytesToRecv Number of bytes to receive.
+ *
+ * @return The result of the wrapped receive function.
+ */
+int32_t NetworkBuffer_Recv( const NetworkContext_t * pNetworkContext,
+                            void * pBuffer,
+                            size_t bytesToRecv );
+
+/**
+ * @brief The transport send function of a network buffer, which passes the
+ * bytes to the wrapped transport.
+ *
+ * @param[in] pNetworkContext The #NetworkBuffer_t.
+ * @param[in] pBuffer The bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return The result of the wrapped send function.
+ */
+int32_t NetworkBuffer_Send( const NetworkContext_t * pNetworkContext,
+                            const void * pBuffer,
+                            size_t bytesToSend );
+
+#endif /* ifndef NETWORK_BUFFER_H_ */
@@ -0,0 +1,605 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file payload_codec.c
+ * @brief Implementation of the compression of MQTT PUBLISH payloads.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+#include "payload_codec.h"
+
+/**
+ * @brief Offsets of the fields of the header of a compressed payload.
+ */
+#define HEADER_MARKER_OFFSET        ( 0U )
+#define HEADER_TYPE_OFFSET          ( 1U )
+#define HEADER_DICTIONARY_OFFSET    ( 2U )
+#define HEADER_LENGTH_OFFSET        ( 3U )
+
+/**
+ * @brief Raw deflate with a 32 KiB window, which has no zlib header or
+ * checksum of its own to spend bytes on.
+ */
+#define ZLIB_WINDOW_BITS            ( -15 )
+
+/**
+ * @brief Memory level of the deflate state.
+ */
+#define ZLIB_MEMORY_LEVEL           ( 8 )
+
+/**
+ * @brief LZ4 acceleration; 1 compresses the most.
+ */
+#define LZ4_ACCELERATION            ( 1 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the header of a compressed payload.
+ *
+ * @param[in] pCodec The codec.
+ * @param[in] type The algorithm the payload is compressed with.
+ * @param[in] originalLength Length of the original payload.
+ * @param[out] pBuffer The buffer for the compressed payload.
+ */
+static void writeHeader( const PayloadCodec_t * pCodec,
+                         PayloadCodecType_t type,
+                         size_t originalLength,
+                         uint8_t * pBuffer );
+
+/**
+ * @brief Check whether a codec type was built.
+ *
+ * @param[in] type The codec type.
+ *
+ * @return true if payloads of the type can be compressed and decompressed.
+ */
+static bool isTypeSupported( PayloadCodecType_t type );
+
+#if ( PAYLOAD_CODEC_ZLIB == 1 )
+
+/**
+ * @brief Compress a payload with raw deflate.
+ *
+ * @param[in] pCodec The codec.
+ * @param[in] pPayload The payload.
+ * @param[in] payloadLength Length of @p pPayload.
+ * @param[out] pBuffer Buffer for the compressed data.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[out] pCompressedLength Length of the compressed data.
+ *
+ * @return #PayloadCodecSuccess, #PayloadCodecIncompressible or
+ * #PayloadCodecLibraryError.
+ */
+    static PayloadCodecStatus_t compressZlib( PayloadCodec_t * pCodec,
+                                              const uint8_t * pPayload,
+                                              size_t payloadLength,
+                                              uint8_t * pBuffer,
+                                              size_t bufferSize,
+                                              size_t * pCompressedLength );
+
+/**
+ * @brief Decompress raw deflate data.
+ *
+ * @param[in] pCodec The codec.
+ * @param[in] pData The compressed data.
+ * @param[in] dataLength Length of @p pData.
+ * @param[out] pBuffer Buffer for the original payload.
+ * @param[in] originalLength Length of the original payload.
+ *
+ * @return #PayloadCodecSuccess, #PayloadCodecMalformed or
+ * #PayloadCodecLibraryError.
+ */
+    static PayloadCodecStatus_t decompressZlib( PayloadCodec_t * pCodec,
+                                                const uint8_t * pData,
+                                                size_t dataLength,
+                                                uint8_t * pBuffer,
+                                                size_t originalLength );
+#endif /* if ( PAYLOAD_CODEC_ZLIB == 1 ) */
+
+#if ( PAYLOAD_CODEC_LZ4 == 1 )
+
+/**
+ * @brief Compress a payload into an LZ4 block.
+ *
+ * @param[in] pCodec The codec.
+ * @param[in] pPayload The payload.
+ * @param[in] payloadLength Length of @p pPayload.
+ * @param[out] pBuffer Buffer for the compressed data.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[out] pCompressedLength Length of the compressed data.
+ *
+ * @return #PayloadCodecSuccess or #PayloadCodecIncompressible.
+ */
+    static PayloadCodecStatus_t compressLz4( PayloadCodec_t * pCodec,
+                                             const uint8_t * pPayload,
+                                             size_t payloadLength,
+                                             uint8_t * pBuffer,
+                                             size_t bufferSize,
+                                             size_t * pCompressedLength );
+
+/**
+ * @brief Decompress an LZ4 block.
+ *
+ * @param[in] pCodec The codec.
+ * @param[in] pData The compressed data.
+ * @param[in] dataLength Length of @p pData.
+ * @param[out] pBuffer Buffer for the original payload.
+ * @param[in] originalLength Length of the original payload.
+ *
+ * @return #PayloadCodecSuccess or #PayloadCodecMalformed.
+ */
+    static PayloadCodecStatus_t decompressLz4( const PayloadCodec_t * pCodec,
+                                               const uint8_t * pData,
+                                               size_t dataLength,
+                                               uint8_t * pBuffer,
+                                               size_t originalLength );
+#endif /* if ( PAYLOAD_CODEC_LZ4 == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static void writeHeader( const PayloadCodec_t * pCodec,
+                         PayloadCodecType_t type,
+                         size_t originalLength,
+                         uint8_t * pBuffer )
+{
+    pBuffer[ HEADER_MARKER_OFFSET ] = PAYLOAD_CODEC_MARKER;
+    pBuffer[ HEADER_TYPE_OFFSET ] = ( uint8_t ) type;
+    pBuffer[ HEADER_DICTIONARY_OFFSET ] = pCodec->dictionaryId;
+    pBuffer[ HEADER_LENGTH_OFFSET ] = ( uint8_t ) ( originalLength >> 24 );
+    pBuffer[ HEADER_LENGTH_OFFSET + 1U ] = ( uint8_t ) ( originalLength >> 16 );
+    pBuffer[ HEADER_LENGTH_OFFSET + 2U ] = ( uint8_t ) ( originalLength >> 8 );
+    pBuffer[ HEADER_LENGTH_OFFSET + 3U ] = ( uint8_t ) originalLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isTypeSupported( PayloadCodecType_t type )
+{
+    bool supported = false;
+
+    #if ( PAYLOAD_CODEC_ZLIB == 1 )
+        if( type == PayloadCodecZlib )
+        {
+            supported = true;
+        }
+    #endif
+
+    #if ( PAYLOAD_CODEC_LZ4 == 1 )
+        if( type == PayloadCodecLz4 )
+        {
+            supported = true;
+        }
+    #endif
+
+    ( void ) type;
+
+    return supported;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( PAYLOAD_CODEC_ZLIB == 1 )
+
+    static PayloadCodecStatus_t compressZlib( PayloadCodec_t * pCodec,
+                                              const uint8_t * pPayload,
+                                              size_t payloadLength,
+                                              uint8_t * pBuffer,
+                                              size_t bufferSize,
+                                              size_t * pCompressedLength )
+    {
+        PayloadCodecStatus_t status = PayloadCodecSuccess;
+        z_stream * pStream = &pCodec->deflateStream;
+        int zlibStatus = deflateReset( pStream );
+
+        if( ( zlibStatus == Z_OK ) && ( pCodec->pDictionary != NULL ) )
+        {
+            zlibStatus = deflateSetDictionary( pStream,
+                                               pCodec->pDictionary,
+                                               ( uInt ) pCodec->dictionaryLength );
+        }
+
+        if( zlibStatus == Z_OK )
+        {
+            /* zlib does not modify the input; its API predates const. */
+            pStream->next_in = ( Bytef * ) pPayload;
+            pStream->avail_in = ( uInt ) payloadLength;
+            pStream->next_out = pBuffer;
+            pStream->avail_out = ( uInt ) bufferSize;
+
+            zlibStatus = deflate( pStream, Z_FINISH );
+
+            if( zlibStatus == Z_STREAM_END )
+            {
+                *pCompressedLength = bufferSize - pStream->avail_out;
+            }
+            else if( ( zlibStatus == Z_OK ) || ( zlibStatus == Z_BUF_ERROR ) )
+            {
+                /* The buffer filled up before the end of the payload. */
+                status = PayloadCodecIncompressible;
+            }
+            else
+            {
+                status = PayloadCodecLibraryError;
+            }
+        }
+        else
+        {
+            status = PayloadCodecLibraryError;
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static PayloadCodecStatus_t decompressZlib( PayloadCodec_t * pCodec,
+                                                const uint8_t * pData,
+                                                size_t dataLength,
+                                                uint8_t * pBuffer,
+                                                size_t originalLength )
+    {
+        PayloadCodecStatus_t status = PayloadCodecSuccess;
+        z_stream * pStream = &pCodec->inflateStream;
+        int zlibStatus = inflateReset( pStream );
+
+        if( ( zlibStatus == Z_OK ) && ( pCodec->pDictionary != NULL ) )
+        {
+            /* Raw inflate takes the dictionary up front rather than waiting
+             * for Z_NEED_DICT, as there is no zlib header to ask for it. */
+            zlibStatus = inflateSetDictionary( pStream,
+                                               pCodec->pDictionary,
+                                               ( uInt ) pCodec->dictionaryLength );
+        }
+
+        if( zlibStatus == Z_OK )
+        {
+            pStream->next_in = ( Bytef * ) pData;
+            pStream->avail_in = ( uInt ) dataLength;
+            pStream->next_out = pBuffer;
+            pStream->avail_out = ( uInt ) originalLength;
+
+            zlibStatus = inflate( pStream, Z_FINISH );
+
+            /* The data must end exactly at the recorded length. */
+            if( ( zlibStatus != Z_STREAM_END ) ||
+                ( pStream->avail_out != 0U ) ||
+                ( pStream->avail_in != 0U ) )
+            {
+                status = PayloadCodecMalformed;
+            }
+        }
+        else
+        {
+            status = PayloadCodecLibraryError;
+        }
+
+        return status;
+    }
+
+#endif /* if ( PAYLOAD_CODEC_ZLIB == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( PAYLOAD_CODEC_LZ4 == 1 )
+
+    static PayloadCodecStatus_t compressLz4( PayloadCodec_t * pCodec,
+                                             const uint8_t * pPayload,
+                                             size_t payloadLength,
+                                             uint8_t * pBuffer,
+                                             size_t bufferSize,
+                                             size_t * pCompressedLength )
+    {
+        PayloadCodecStatus_t status = PayloadCodecSuccess;
+        int compressedLength = 0;
+
+        /* Loading the dictionary also resets the stream, so that every
+         * payload refers only to the dictionary and not to earlier payloads
+         * that a subscriber may not have received. */
+        ( void ) LZ4_loadDict( &pCodec->lz4Stream,
+                               ( const char * ) pCodec->pDictionary,
+                               ( int ) pCodec->dictionaryLength );
+
+        compressedLength = LZ4_compress_fast_continue( &pCodec->lz4Stream,
+                                                       ( const char * ) pPayload,
+                                                       ( char * ) pBuffer,
+                                                       ( int ) payloadLength,
+                                                       ( int ) bufferSize,
+                                                       LZ4_ACCELERATION );
+
+        if( compressedLength > 0 )
+        {
+            *pCompressedLength = ( size_t ) compressedLength;
+        }
+        else
+        {
+            status = PayloadCodecIncompressible;
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static PayloadCodecStatus_t decompressLz4( const PayloadCodec_t * pCodec,
+                                               const uint8_t * pData,
+                                               size_t dataLength,
+                                               uint8_t * pBuffer,
+                                               size_t originalLength )
+    {
+        PayloadCodecStatus_t status = PayloadCodecSuccess;
+        int decompressedLength = 0;
+
+        decompressedLength = LZ4_decompress_safe_usingDict( ( const char * ) pData,
+                                                            ( char * ) pBuffer,
+                                                            ( int ) dataLength,
+                                                            ( int ) originalLength,
+                                                            ( const char * ) pCodec->pDictionary,
+                                                            ( int ) pCodec->dictionaryLength );
+
+        if( ( decompressedLength < 0 ) ||
+            ( ( size_t ) decompressedLength != originalLength ) )
+        {
+            status = PayloadCodecMalformed;
+        }
+
+        return status;
+    }
+
+#endif /* if ( PAYLOAD_CODEC_LZ4 == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+PayloadCodecStatus_t PayloadCodec_Init( PayloadCodec_t * pCodec,
+                                        PayloadCodecType_t type,
+                                        const uint8_t * pDictionary,
+                                        size_t dictionaryLength,
+                                        uint8_t dictionaryId )
+{
+    PayloadCodecStatus_t status = PayloadCodecSuccess;
+
+    if( ( pCodec == NULL ) ||
+        ( ( pDictionary != NULL ) && ( ( dictionaryLength == 0U ) || ( dictionaryId == 0U ) ) ) )
+    {
+        status = PayloadCodecBadParameter;
+    }
+    else if( ( type != PayloadCodecNone ) && !isTypeSupported( type ) )
+    {
+        status = PayloadCodecUnsupported;
+    }
+    else
+    {
+        ( void ) memset( pCodec, 0x00, sizeof( PayloadCodec_t ) );
+        pCodec->type = type;
+        pCodec->pDictionary = pDictionary;
+        pCodec->dictionaryLength = ( pDictionary != NULL ) ? dictionaryLength : 0U;
+        pCodec->dictionaryId = ( pDictionary != NULL ) ? dictionaryId : 0U;
+
+        #if ( PAYLOAD_CODEC_ZLIB == 1 )
+            if( deflateInit2( &pCodec->deflateStream,
+                              Z_DEFAULT_COMPRESSION,
+                              Z_DEFLATED,
+                              ZLIB_WINDOW_BITS,
+                              ZLIB_MEMORY_LEVEL,
+                              Z_DEFAULT_STRATEGY ) != Z_OK )
+            {
+                status = PayloadCodecLibraryError;
+            }
+            else if( inflateInit2( &pCodec->inflateStream, ZLIB_WINDOW_BITS ) != Z_OK )
+            {
+                ( void ) deflateEnd( &pCodec->deflateStream );
+                status = PayloadCodecLibraryError;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        #endif /* if ( PAYLOAD_CODEC_ZLIB == 1 ) */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void PayloadCodec_Cleanup( PayloadCodec_t * pCodec )
+{
+    if( pCodec != NULL )
+    {
+        #if ( PAYLOAD_CODEC_ZLIB == 1 )
+            ( void ) deflateEnd( &pCodec->deflateStream );
+            ( void ) inflateEnd( &pCodec->inflateStream );
+        #endif
+
+        pCodec->type = PayloadCodecNone;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+PayloadCodecStatus_t PayloadCodec_Compress( PayloadCodec_t * pCodec,
+                                            const uint8_t * pPayload,
+                                            size_t payloadLength,
+                                            uint8_t * pBuffer,
+                                            size_t bufferSize,
+                                            size_t * pCompressedLength )
+{
+    PayloadCodecStatus_t status = PayloadCodecIncompressible;
+    size_t dataSize = 0U;
+    size_t dataLength = 0U;
+
+    if( ( pCodec == NULL ) || ( pPayload == NULL ) || ( payloadLength == 0U ) ||
+        ( pBuffer == NULL ) || ( pCompressedLength == NULL ) )
+    {
+        status = PayloadCodecBadParameter;
+    }
+    else if( ( pCodec->type == PayloadCodecNone ) ||
+             ( payloadLength > UINT32_MAX ) ||
+             ( bufferSize <= PAYLOAD_CODEC_HEADER_LENGTH ) ||
+             ( payloadLength <= PAYLOAD_CODEC_HEADER_LENGTH ) )
+    {
+        /* Leave status as incompressible. */
+    }
+    else
+    {
+        /* Only keep the result if it is shorter than the payload itself. */
+        dataSize = payloadLength - PAYLOAD_CODEC_HEADER_LENGTH - 1U;
+
+        if( dataSize > ( bufferSize - PAYLOAD_CODEC_HEADER_LENGTH ) )
+        {
+            dataSize = bufferSize - PAYLOAD_CODEC_HEADER_LENGTH;
+        }
+
+        #if ( PAYLOAD_CODEC_ZLIB == 1 )
+            if( pCodec->type == PayloadCodecZlib )
+            {
+                status = compressZlib( pCodec,
+                                       pPayload,
+                                       payloadLength,
+                                       &pBuffer[ PAYLOAD_CODEC_HEADER_LENGTH ],
+                                       dataSize,
+                                       &dataLength );
+            }
+        #endif
+
+        #if ( PAYLOAD_CODEC_LZ4 == 1 )
+            if( pCodec->type == PayloadCodecLz4 )
+            {
+                status = compressLz4( pCodec,
+                                      pPayload,
+                                      payloadLength,
+                                      &pBuffer[ PAYLOAD_CODEC_HEADER_LENGTH ],
+                                      dataSize,
+                                      &dataLength );
+            }
+        #endif
+
+        if( status == PayloadCodecSuccess )
+        {
+            writeHeader( pCodec, pCodec->type, payloadLength, pBuffer );
+            *pCompressedLength = PAYLOAD_CODEC_HEADER_LENGTH + dataLength;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+bool PayloadCodec_IsCompressed( const uint8_t * pPayload,
+                                size_t payloadLength,
+                                size_t * pOriginalLength )
+{
+    bool compressed = false;
+    uint8_t type = 0U;
+
+    if( ( pPayload != NULL ) && ( payloadLength > PAYLOAD_CODEC_HEADER_LENGTH ) &&
+        ( pPayload[ HEADER_MARKER_OFFSET ] == PAYLOAD_CODEC_MARKER ) )
+    {
+        type = pPayload[ HEADER_TYPE_OFFSET ];
+        compressed = ( type == ( uint8_t ) PayloadCodecZlib ) ||
+                     ( type == ( uint8_t ) PayloadCodecLz4 );
+    }
+
+    if( compressed && ( pOriginalLength != NULL ) )
+    {
+        *pOriginalLength = ( ( size_t ) pPayload[ HEADER_LENGTH_OFFSET ] << 24 ) |
+                           ( ( size_t ) pPayload[ HEADER_LENGTH_OFFSET + 1U ] << 16 ) |
+                           ( ( size_t ) pPayload[ HEADER_LENGTH_OFFSET + 2U ] << 8 ) |
+                           ( size_t ) pPayload[ HEADER_LENGTH_OFFSET + 3U ];
+    }
+
+    return compressed;
+}
+
+/*-----------------------------------------------------------*/
+
+PayloadCodecStatus_t PayloadCodec_Decompress( PayloadCodec_t * pCodec,
+                                              const uint8_t * pPayload,
+                                              size_t payloadLength,
+                                              uint8_t * pBuffer,
+                                              size_t bufferSize,
+                                              size_t * pOriginalLength )
+{
+    PayloadCodecStatus_t status = PayloadCodecUnsupported;
+    PayloadCodecType_t type = PayloadCodecNone;
+    size_t originalLength = 0U;
+
+    if( ( pCodec == NULL ) || ( pPayload == NULL ) ||
+        ( pBuffer == NULL ) || ( pOriginalLength == NULL ) )
+    {
+        status = PayloadCodecBadParameter;
+    }
+    else if( !PayloadCodec_IsCompressed( pPayload, payloadLength, &originalLength ) )
+    {
+        status = PayloadCodecMalformed;
+    }
+    else if( originalLength > bufferSize )
+    {
+        status = PayloadCodecBufferTooSmall;
+    }
+    else if( pPayload[ HEADER_DICTIONARY_OFFSET ] != pCodec->dictionaryId )
+    {
+        /* Leave status as unsupported. */
+    }
+    else
+    {
+        type = ( PayloadCodecType_t ) pPayload[ HEADER_TYPE_OFFSET ];
+
+        #if ( PAYLOAD_CODEC_ZLIB == 1 )
+            if( type == PayloadCodecZlib )
+            {
+                status = decompressZlib( pCodec,
+                                         &pPayload[ PAYLOAD_CODEC_HEADER_LENGTH ],
+                                         payloadLength - PAYLOAD_CODEC_HEADER_LENGTH,
+                                         pBuffer,
+                                         originalLength );
+            }
+        #endif
+
+        #if ( PAYLOAD_CODEC_LZ4 == 1 )
+            if( type == PayloadCodecLz4 )
+            {
+                status = decompressLz4( pCodec,
+                                        &pPayload[ PAYLOAD_CODEC_HEADER_LENGTH ],
+                                        payloadLength - PAYLOAD_CODEC_HEADER_LENGTH,
+                                        pBuffer,
+                                        originalLength );
+            }
+        #endif
+
+        ( void ) type;
+
+        if( status == PayloadCodecSuccess )
+        {
+            *pOriginalLength = originalLength;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
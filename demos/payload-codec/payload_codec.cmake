@@ -0,0 +1,23 @@
+# Configuration for the optional compression of MQTT PUBLISH payloads. Each
+# codec is built when its library is found.
+set( PAYLOAD_CODEC_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
+set( PAYLOAD_CODEC_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/payload_codec.c )
+set( PAYLOAD_CODEC_LIBRARIES "" )
+set( PAYLOAD_CODEC_DEFINITIONS "" )
+
+find_package( ZLIB QUIET )
+if( ZLIB_FOUND )
+    list( APPEND PAYLOAD_CODEC_INCLUDE_DIRS ${ZLIB_INCLUDE_DIRS} )
+    list( APPEND PAYLOAD_CODEC_LIBRARIES ${ZLIB_LIBRARIES} )
+    list( APPEND PAYLOAD_CODEC_DEFINITIONS PAYLOAD_CODEC_ZLIB=1 )
+endif()
+
+find_path( LZ4_INCLUDE_DIR lz4.h )
+find_library( LZ4_LIBRARY lz4 )
+if( LZ4_INCLUDE_DIR AND LZ4_LIBRARY )
+    list( APPEND PAYLOAD_CODEC_INCLUDE_DIRS ${LZ4_INCLUDE_DIR} )
+    list( APPEND PAYLOAD_CODEC_LIBRARIES ${LZ4_LIBRARY} )
+    list( APPEND PAYLOAD_CODEC_DEFINITIONS PAYLOAD_CODEC_LZ4=1 )
+endif()
@@ -0,0 +1,218 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file payload_codec.h
+ * @brief Optional compression of MQTT PUBLISH payloads with zlib or LZ4, using
+ * a dictionary preloaded with the strings common to the application's
+ * payloads.
+ *
+ * A compressed payload starts with a header whose first byte is 0, which no
+ * JSON or text payload starts with, so subscribers recognize compressed
+ * payloads by their content and the topics stay the same for subscriptions
+ * and policies. The header names the codec, the dictionary and the length of
+ * the original payload.
+ *
+ * Each codec is available when the build found its library: zlib defines
+ * PAYLOAD_CODEC_ZLIB to 1 and LZ4 defines PAYLOAD_CODEC_LZ4 to 1.
+ */
+
+#ifndef PAYLOAD_CODEC_H_
+#define PAYLOAD_CODEC_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef PAYLOAD_CODEC_ZLIB
+    #define PAYLOAD_CODEC_ZLIB    0
+#endif
+
+#ifndef PAYLOAD_CODEC_LZ4
+    #define PAYLOAD_CODEC_LZ4    0
+#endif
+
+#if ( PAYLOAD_CODEC_ZLIB == 1 )
+    #include <zlib.h>
+#endif
+
+#if ( PAYLOAD_CODEC_LZ4 == 1 )
+    #include <lz4.h>
+#endif
+
+/**
+ * @brief Length of the header of a compressed payload: the marker byte, the
+ * codec, the dictionary identifier and the 4-byte big-endian length of the
+ * original payload.
+ */
+#define PAYLOAD_CODEC_HEADER_LENGTH    ( 7U )
+
+/**
+ * @brief First byte of every compressed payload.
+ */
+#define PAYLOAD_CODEC_MARKER           ( 0x00U )
+
+/**
+ * @brief A dictionary of the strings common to the JSON documents of the
+ * device shadow and the telemetry of the demos. The strings that occur most
+ * often are at the end, where they are cheapest to refer to.
+ */
+#define PAYLOAD_CODEC_DEFAULT_DICTIONARY                                          \
+    "{\"metadata\":{\"timestamp\":,\"version\":\"temperature\":\"humidity\":" \
+    "\"precipitation\":\"desired\":{\"powerOn\":\"clientToken\":\""           \
+    "\"state\":{\"reported\":{"
+
+/**
+ * @brief Identifier of #PAYLOAD_CODEC_DEFAULT_DICTIONARY, recorded in the
+ * header so that a payload is never decompressed with another dictionary.
+ */
+#define PAYLOAD_CODEC_DEFAULT_DICTIONARY_ID    ( 1U )
+
+/**
+ * @brief Return codes from the payload codec functions.
+ */
+typedef enum PayloadCodecStatus
+{
+    PayloadCodecSuccess,        /**< @brief The function completed successfully. */
+    PayloadCodecBadParameter,   /**< @brief A parameter was NULL or zero. */
+    PayloadCodecUnsupported,    /**< @brief The codec was not built, or the dictionary differs. */
+    PayloadCodecIncompressible, /**< @brief The payload does not compress into fewer bytes, or into the buffer. */
+    PayloadCodecBufferTooSmall, /**< @brief The original payload does not fit the buffer. */
+    PayloadCodecMalformed,      /**< @brief The compressed payload is corrupt. */
+    PayloadCodecLibraryError    /**< @brief zlib or LZ4 failed. */
+} PayloadCodecStatus_t;
+
+/**
+ * @brief Compression algorithms.
+ */
+typedef enum PayloadCodecType
+{
+    PayloadCodecNone = 0,   /**< @brief Payloads are sent as they are. */
+    PayloadCodecZlib = 'z', /**< @brief Raw deflate, which compresses better. */
+    PayloadCodecLz4 = 'l'   /**< @brief LZ4 block format, which compresses faster. */
+} PayloadCodecType_t;
+
+/**
+ * @brief The state of a codec, set up by #PayloadCodec_Init. A codec must
+ * only be used by one thread at a time.
+ */
+typedef struct PayloadCodec
+{
+    PayloadCodecType_t type;     /**< @brief Algorithm used to compress. */
+    const uint8_t * pDictionary; /**< @brief The dictionary, or NULL. */
+    size_t dictionaryLength;     /**< @brief Length of the dictionary. */
+    uint8_t dictionaryId;        /**< @brief Identifier of the dictionary, 0 without one. */
+    #if ( PAYLOAD_CODEC_ZLIB == 1 )
+        z_stream deflateStream;  /**< @brief Compression state, reset for every payload. */
+        z_stream inflateStream;  /**< @brief Decompression state, reset for every payload. */
+    #endif
+    #if ( PAYLOAD_CODEC_LZ4 == 1 )
+        LZ4_stream_t lz4Stream;  /**< @brief Compression state, loaded with the dictionary for every payload. */
+    #endif
+} PayloadCodec_t;
+
+/**
+ * @brief Set up a codec.
+ *
+ * @param[out] pCodec The codec.
+ * @param[in] type The algorithm to compress with. Payloads compressed with
+ * any built algorithm can be decompressed.
+ * @param[in] pDictionary The dictionary, or NULL. It must stay valid while the
+ * codec is used, and be the same for publishers and subscribers.
+ * @param[in] dictionaryLength Length of @p pDictionary.
+ * @param[in] dictionaryId Identifier of the dictionary, from 1 to 255.
+ *
+ * @return #PayloadCodecSuccess; #PayloadCodecUnsupported if @p type was not
+ * built; #PayloadCodecBadParameter or #PayloadCodecLibraryError otherwise.
+ */
+PayloadCodecStatus_t PayloadCodec_Init( PayloadCodec_t * pCodec,
+                                        PayloadCodecType_t type,
+                                        const uint8_t * pDictionary,
+                                        size_t dictionaryLength,
+                                        uint8_t dictionaryId );
+
+/**
+ * @brief Release the resources of a codec.
+ *
+ * @param[in] pCodec The codec.
+ */
+void PayloadCodec_Cleanup( PayloadCodec_t * pCodec );
+
+/**
+ * @brief Compress a payload, including its header.
+ *
+ * @param[in] pCodec The codec.
+ * @param[in] pPayload The payload.
+ * @param[in] payloadLength Length of @p pPayload.
+ * @param[out] pBuffer Buffer for the compressed payload.
+ * @param[in] bufferSize Size of @p pBuffer. A buffer of @p payloadLength
+ * bytes holds every payload worth compressing.
+ * @param[out] pCompressedLength Length of the compressed payload.
+ *
+ * @return #PayloadCodecSuccess; #PayloadCodecIncompressible if the payload
+ * should be sent as it is; #PayloadCodecBadParameter or
+ * #PayloadCodecLibraryError otherwise.
+ */
+PayloadCodecStatus_t PayloadCodec_Compress( PayloadCodec_t * pCodec,
+                                            const uint8_t * pPayload,
+                                            size_t payloadLength,
+                                            uint8_t * pBuffer,
+                                            size_t bufferSize,
+                                            size_t * pCompressedLength );
+
+/**
+ * @brief Check whether a payload was compressed by #PayloadCodec_Compress,
+ * and get the length of the original payload.
+ *
+ * @param[in] pPayload The payload.
+ * @param[in] payloadLength Length of @p pPayload.
+ * @param[out] pOriginalLength Length of the original payload; may be NULL.
+ *
+ * @return true if the payload starts with a header of a known codec.
+ */
+bool PayloadCodec_IsCompressed( const uint8_t * pPayload,
+                                size_t payloadLength,
+                                size_t * pOriginalLength );
+
+/**
+ * @brief Decompress a payload compressed by #PayloadCodec_Compress.
+ *
+ * @param[in] pCodec The codec, with the dictionary the payload was compressed with.
+ * @param[in] pPayload The compressed payload.
+ * @param[in] payloadLength Length of @p pPayload.
+ * @param[out] pBuffer Buffer for the original payload.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[out] pOriginalLength Length of the original payload.
+ *
+ * @return #PayloadCodecSuccess; #PayloadCodecBufferTooSmall,
+ * #PayloadCodecUnsupported, #PayloadCodecMalformed,
+ * #PayloadCodecBadParameter or #PayloadCodecLibraryError otherwise.
+ */
+PayloadCodecStatus_t PayloadCodec_Decompress( PayloadCodec_t * pCodec,
+                                              const uint8_t * pPayload,
+                                              size_t payloadLength,
+                                              uint8_t * pBuffer,
+                                              size_t bufferSize,
+                                              size_t * pOriginalLength );
+
+#endif /* ifndef PAYLOAD_CODEC_H_ */
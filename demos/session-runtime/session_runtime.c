@@ -0,0 +1,893 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file session_runtime.c
+ * @brief Implementation of the sharded multi-session runtime.
+ */
+
+/* CPU affinity of threads is a GNU extension. */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the session runtime. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "SessionRuntime"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+#include "session_runtime.h"
+
+/* Clock for the MQTT contexts and timer wheels. */
+#include "clock.h"
+
+/* Time until keep-alive needs the process loop. */
+#include "mqtt_idle.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the core to pin the thread of a shard to.
+ *
+ * @param[in] pAllowedCpus The cores the process may run on.
+ * @param[in] allowedCount Number of cores in @p pAllowedCpus.
+ * @param[in] shardIndex Index of the shard.
+ *
+ * @return The core, or -1 if @p allowedCount is 0.
+ */
+static int32_t getShardCpu( const cpu_set_t * pAllowedCpus,
+                            size_t allowedCount,
+                            size_t shardIndex );
+
+/**
+ * @brief Create the event loop, pool and wake descriptor of a shard, and
+ * start its thread.
+ *
+ * @param[out] pShard The shard.
+ * @param[in] cpu The core to pin the thread to, or -1.
+ *
+ * @return #SessionRuntimeSuccess or #SessionRuntimeSystemError.
+ */
+static SessionRuntimeStatus_t initShard( SessionRuntimeShard_t * pShard,
+                                         int32_t cpu );
+
+/**
+ * @brief Release the resources of a shard whose thread has returned.
+ *
+ * @param[in] pShard The shard.
+ */
+static void cleanupShard( SessionRuntimeShard_t * pShard );
+
+/**
+ * @brief Make the thread of a shard drain its queue.
+ *
+ * @param[in] pShard The shard.
+ *
+ * @return #SessionRuntimeSuccess or #SessionRuntimeSystemError.
+ */
+static SessionRuntimeStatus_t wakeShard( SessionRuntimeShard_t * pShard );
+
+/**
+ * @brief Add a session to the queue of its shard and wake the shard.
+ *
+ * @param[in] pSession The session.
+ * @param[in] start Whether the shard must start waiting on the session,
+ * rather than run its work callback.
+ *
+ * @return #SessionRuntimeSuccess or #SessionRuntimeSystemError.
+ */
+static SessionRuntimeStatus_t queueSession( MqttSession_t * pSession,
+                                            bool start );
+
+/**
+ * @brief Start or run the work of the sessions in the queue of a shard.
+ *
+ * @param[in] pShard The shard.
+ */
+static void drainQueue( SessionRuntimeShard_t * pShard );
+
+/**
+ * @brief Make the shard of a session wait on its socket.
+ *
+ * @param[in] pSession The session.
+ */
+static void startSession( MqttSession_t * pSession );
+
+/**
+ * @brief Run the process loop of a session until it has handled all the
+ * bytes received, then arm its keep-alive timer.
+ *
+ * @param[in] pSession The session.
+ */
+static void processSession( MqttSession_t * pSession );
+
+/**
+ * @brief Arm the keep-alive timer of a session for when the process loop
+ * next has to run, or cancel it if keep-alive is disabled.
+ *
+ * @param[in] pSession The session.
+ */
+static void armKeepAlive( MqttSession_t * pSession );
+
+/**
+ * @brief Remove a session whose connection failed from its shard, and tell
+ * the application.
+ *
+ * @param[in] pSession The session.
+ * @param[in] mqttStatus The status of the process loop that failed.
+ */
+static void closeSession( MqttSession_t * pSession,
+                          MQTTStatus_t mqttStatus );
+
+/**
+ * @brief Timer wheel callback for the keep-alive timer of a session.
+ *
+ * @param[in] pTimer The keep-alive timer.
+ * @param[in] pContext The session.
+ */
+static void keepAliveExpired( TimerWheelTimer_t * pTimer,
+                              void * pContext );
+
+/**
+ * @brief The event callback of the MQTT context of every session, which
+ * passes the packet to the packet callback of the session.
+ *
+ * @param[in] pMqttContext The MQTT context.
+ * @param[in] pPacketInfo The received packet.
+ * @param[in] pDeserializedInfo The deserialized fields of the packet.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief The thread of a shard.
+ *
+ * @param[in] pArgument The shard.
+ *
+ * @return NULL.
+ */
+static void * runShard( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static int32_t getShardCpu( const cpu_set_t * pAllowedCpus,
+                            size_t allowedCount,
+                            size_t shardIndex )
+{
+    int32_t cpu = -1, candidate = 0;
+    size_t skip = 0U;
+
+    if( allowedCount > 0U )
+    {
+        /* With more shards than cores, shards share the cores in turn. */
+        skip = shardIndex % allowedCount;
+
+        for( candidate = 0; ( cpu < 0 ) && ( candidate < CPU_SETSIZE ); candidate++ )
+        {
+            if( CPU_ISSET( candidate, pAllowedCpus ) )
+            {
+                if( skip == 0U )
+                {
+                    cpu = candidate;
+                }
+                else
+                {
+                    skip--;
+                }
+            }
+        }
+    }
+
+    return cpu;
+}
+
+/*-----------------------------------------------------------*/
+
+static SessionRuntimeStatus_t initShard( SessionRuntimeShard_t * pShard,
+                                         int32_t cpu )
+{
+    SessionRuntimeStatus_t status = SessionRuntimeSystemError;
+    bool loopReady = false, poolReady = false, mutexReady = false;
+    cpu_set_t cpuSet;
+    int error = 0;
+
+    pShard->cpu = cpu;
+    pShard->wakeDescriptor = -1;
+    pShard->pQueueHead = NULL;
+    pShard->pQueueTail = NULL;
+    pShard->sessionCount = 0U;
+    pShard->stopping = false;
+
+    loopReady = ( EventLoop_Init( &pShard->eventLoop ) == EVENT_LOOP_SUCCESS );
+
+    if( loopReady == true )
+    {
+        ( void ) TimerWheel_Init( &pShard->timerWheel, Clock_GetTimeMs() );
+        poolReady = ( NetworkBufferPool_Init( &pShard->pool,
+                                              pShard->poolArena,
+                                              sizeof( pShard->poolArena ),
+                                              SESSION_RUNTIME_POOL_BLOCK_SIZE ) == NetworkBufferSuccess );
+    }
+
+    if( poolReady == true )
+    {
+        pShard->wakeDescriptor = eventfd( 0U, EFD_NONBLOCK | EFD_CLOEXEC );
+
+        if( pShard->wakeDescriptor < 0 )
+        {
+            LogError( ( "Failed to create the wake descriptor of a shard: %s.",
+                        strerror( errno ) ) );
+        }
+    }
+
+    /* The wake descriptor is the only one registered without a session. */
+    if( ( pShard->wakeDescriptor >= 0 ) &&
+        ( EventLoop_Add( &pShard->eventLoop,
+                         pShard->wakeDescriptor,
+                         NULL,
+                         EVENT_LOOP_READABLE ) == EVENT_LOOP_SUCCESS ) )
+    {
+        mutexReady = ( pthread_mutex_init( &pShard->queueMutex, NULL ) == 0 );
+    }
+
+    if( mutexReady == true )
+    {
+        error = pthread_create( &pShard->thread, NULL, runShard, pShard );
+
+        if( error == 0 )
+        {
+            status = SessionRuntimeSuccess;
+        }
+        else
+        {
+            LogError( ( "Failed to create the thread of a shard: %s.",
+                        strerror( error ) ) );
+        }
+    }
+
+    if( ( status == SessionRuntimeSuccess ) && ( cpu >= 0 ) )
+    {
+        CPU_ZERO( &cpuSet );
+        CPU_SET( cpu, &cpuSet );
+        error = pthread_setaffinity_np( pShard->thread, sizeof( cpuSet ), &cpuSet );
+
+        if( error != 0 )
+        {
+            LogWarn( ( "Failed to pin a shard to CPU %d, so it runs unpinned: %s.",
+                       ( int ) cpu,
+                       strerror( error ) ) );
+            pShard->cpu = -1;
+        }
+    }
+
+    if( status != SessionRuntimeSuccess )
+    {
+        if( mutexReady == true )
+        {
+            ( void ) pthread_mutex_destroy( &pShard->queueMutex );
+        }
+
+        if( pShard->wakeDescriptor >= 0 )
+        {
+            ( void ) close( pShard->wakeDescriptor );
+        }
+
+        if( poolReady == true )
+        {
+            NetworkBufferPool_Cleanup( &pShard->pool );
+        }
+
+        if( loopReady == true )
+        {
+            ( void ) EventLoop_Deinit( &pShard->eventLoop );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void cleanupShard( SessionRuntimeShard_t * pShard )
+{
+    ( void ) pthread_mutex_destroy( &pShard->queueMutex );
+    ( void ) close( pShard->wakeDescriptor );
+    NetworkBufferPool_Cleanup( &pShard->pool );
+    ( void ) EventLoop_Deinit( &pShard->eventLoop );
+}
+
+/*-----------------------------------------------------------*/
+
+static SessionRuntimeStatus_t wakeShard( SessionRuntimeShard_t * pShard )
+{
+    SessionRuntimeStatus_t status = SessionRuntimeSuccess;
+    uint64_t increment = 1U;
+
+    /* EAGAIN means the counter is full, so a wake is pending already. */
+    if( ( write( pShard->wakeDescriptor, &increment, sizeof( increment ) ) != ( ssize_t ) sizeof( increment ) ) &&
+        ( errno != EAGAIN ) )
+    {
+        LogError( ( "Failed to wake a shard: %s.",
+                    strerror( errno ) ) );
+        status = SessionRuntimeSystemError;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static SessionRuntimeStatus_t queueSession( MqttSession_t * pSession,
+                                            bool start )
+{
+    SessionRuntimeShard_t * pShard = pSession->pShard;
+
+    ( void ) pthread_mutex_lock( &pShard->queueMutex );
+
+    if( start == true )
+    {
+        pSession->startPending = true;
+    }
+    else
+    {
+        pSession->workPending = true;
+    }
+
+    if( pSession->queued == false )
+    {
+        pSession->pNextQueued = NULL;
+
+        if( pShard->pQueueTail == NULL )
+        {
+            pShard->pQueueHead = pSession;
+        }
+        else
+        {
+            pShard->pQueueTail->pNextQueued = pSession;
+        }
+
+        pShard->pQueueTail = pSession;
+        pSession->queued = true;
+    }
+
+    ( void ) pthread_mutex_unlock( &pShard->queueMutex );
+
+    return wakeShard( pShard );
+}
+
+/*-----------------------------------------------------------*/
+
+static void drainQueue( SessionRuntimeShard_t * pShard )
+{
+    MqttSession_t * pSession = NULL, * pNext = NULL;
+    uint64_t wakeCount = 0U;
+    bool start = false, work = false;
+
+    ( void ) read( pShard->wakeDescriptor, &wakeCount, sizeof( wakeCount ) );
+
+    /* Take the sessions queued so far. Sessions queued while they are
+     * handled wake the shard again, so the loop always ends. */
+    ( void ) pthread_mutex_lock( &pShard->queueMutex );
+    pSession = pShard->pQueueHead;
+    pShard->pQueueHead = NULL;
+    pShard->pQueueTail = NULL;
+    ( void ) pthread_mutex_unlock( &pShard->queueMutex );
+
+    while( pSession != NULL )
+    {
+        ( void ) pthread_mutex_lock( &pShard->queueMutex );
+        pNext = pSession->pNextQueued;
+        pSession->pNextQueued = NULL;
+        pSession->queued = false;
+        start = pSession->startPending;
+        work = pSession->workPending;
+        pSession->startPending = false;
+        pSession->workPending = false;
+        ( void ) pthread_mutex_unlock( &pShard->queueMutex );
+
+        if( start == true )
+        {
+            startSession( pSession );
+        }
+
+        /* Work queued for a session that has closed is dropped. */
+        if( ( work == true ) && ( pSession->running == true ) )
+        {
+            pSession->workCallback( pSession );
+
+            /* Sending a packet restarts the keep-alive interval. */
+            armKeepAlive( pSession );
+        }
+
+        pSession = pNext;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void startSession( MqttSession_t * pSession )
+{
+    SessionRuntimeShard_t * pShard = pSession->pShard;
+
+    /* The event loop only hands the network context back with the events of
+     * the socket, so it carries the session. */
+    if( EventLoop_Add( &pShard->eventLoop,
+                       pSession->socketDescriptor,
+                       ( NetworkContext_t * ) pSession,
+                       EVENT_LOOP_READABLE ) == EVENT_LOOP_SUCCESS )
+    {
+        pSession->running = true;
+        ( void ) TimerWheel_InitTimer( &pSession->keepAliveTimer, keepAliveExpired, pSession );
+
+        /* Handle the bytes that arrived since MQTT_Connect returned. */
+        processSession( pSession );
+    }
+    else
+    {
+        LogError( ( "Failed to wait on the socket of a session." ) );
+        ( void ) __atomic_sub_fetch( &pShard->sessionCount, 1U, __ATOMIC_ACQ_REL );
+
+        if( pSession->closedCallback != NULL )
+        {
+            pSession->closedCallback( pSession, MQTTNoMemory );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void processSession( MqttSession_t * pSession )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    mqttStatus = MQTT_ProcessLoop( &pSession->mqttContext, 0U );
+
+    /* Bytes the transport has already read from the socket do not make it
+     * readable again, so process them before waiting. */
+    while( ( mqttStatus == MQTTSuccess ) &&
+           ( pSession->bufferedCallback != NULL ) &&
+           ( pSession->bufferedCallback( pSession->pNetworkContext ) == true ) )
+    {
+        mqttStatus = MQTT_ProcessLoop( &pSession->mqttContext, 0U );
+    }
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        armKeepAlive( pSession );
+    }
+    else
+    {
+        closeSession( pSession, mqttStatus );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void armKeepAlive( MqttSession_t * pSession )
+{
+    TimerWheel_t * pTimerWheel = &pSession->pShard->timerWheel;
+    uint32_t waitMs = MQTTIdle_GetKeepAliveWaitMs( &pSession->mqttContext );
+
+    if( waitMs == MQTT_IDLE_WAIT_FOREVER )
+    {
+        ( void ) TimerWheel_Cancel( pTimerWheel, &pSession->keepAliveTimer );
+    }
+    else
+    {
+        ( void ) TimerWheel_Arm( pTimerWheel,
+                                 &pSession->keepAliveTimer,
+                                 Clock_GetTimeMs() + waitMs );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeSession( MqttSession_t * pSession,
+                          MQTTStatus_t mqttStatus )
+{
+    SessionRuntimeShard_t * pShard = pSession->pShard;
+    MqttSession_t * pCurrent = NULL, * pPrevious = NULL;
+
+    LogError( ( "A session lost its connection: Status=%s.",
+                MQTT_Status_strerror( mqttStatus ) ) );
+
+    ( void ) EventLoop_Remove( &pShard->eventLoop, pSession->socketDescriptor );
+    ( void ) TimerWheel_Cancel( &pShard->timerWheel, &pSession->keepAliveTimer );
+    pSession->running = false;
+
+    /* Drop work queued for the session, so the queue does not refer to it
+     * once the application reuses or frees it. */
+    ( void ) pthread_mutex_lock( &pShard->queueMutex );
+
+    if( pSession->queued == true )
+    {
+        for( pCurrent = pShard->pQueueHead;
+             ( pCurrent != NULL ) && ( pCurrent != pSession );
+             pCurrent = pCurrent->pNextQueued )
+        {
+            pPrevious = pCurrent;
+        }
+
+        /* A session being drained is no longer in the queue. */
+        if( pCurrent != NULL )
+        {
+            if( pPrevious == NULL )
+            {
+                pShard->pQueueHead = pSession->pNextQueued;
+            }
+            else
+            {
+                pPrevious->pNextQueued = pSession->pNextQueued;
+            }
+
+            if( pShard->pQueueTail == pSession )
+            {
+                pShard->pQueueTail = pPrevious;
+            }
+
+            pSession->pNextQueued = NULL;
+            pSession->queued = false;
+        }
+    }
+
+    pSession->workPending = false;
+    ( void ) pthread_mutex_unlock( &pShard->queueMutex );
+
+    ( void ) __atomic_sub_fetch( &pShard->sessionCount, 1U, __ATOMIC_ACQ_REL );
+
+    if( pSession->closedCallback != NULL )
+    {
+        pSession->closedCallback( pSession, mqttStatus );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void keepAliveExpired( TimerWheelTimer_t * pTimer,
+                              void * pContext )
+{
+    ( void ) pTimer;
+
+    processSession( ( MqttSession_t * ) pContext );
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    /* The MQTT context is the first member of its session. */
+    MqttSession_t * pSession = ( MqttSession_t * ) pMqttContext;
+
+    pSession->packetCallback( pSession, pPacketInfo, pDeserializedInfo );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * runShard( void * pArgument )
+{
+    SessionRuntimeShard_t * pShard = ( SessionRuntimeShard_t * ) pArgument;
+    EventLoopEvent_t events[ SESSION_RUNTIME_EVENTS_PER_WAIT ];
+    size_t eventCount = 0U, index = 0U;
+    uint32_t timeoutMs = 0U;
+    MqttSession_t * pSession = NULL;
+
+    while( __atomic_load_n( &pShard->stopping, __ATOMIC_ACQUIRE ) == false )
+    {
+        /* Sleep until a socket is readable, the shard is woken, or the
+         * keep-alive of a session is due. */
+        timeoutMs = TimerWheel_GetTimeoutMs( &pShard->timerWheel, Clock_GetTimeMs() );
+
+        if( EventLoop_Wait( &pShard->eventLoop,
+                            events,
+                            SESSION_RUNTIME_EVENTS_PER_WAIT,
+                            timeoutMs,
+                            &eventCount ) != EVENT_LOOP_SUCCESS )
+        {
+            LogError( ( "The event loop of a shard failed, so its sessions stop." ) );
+            break;
+        }
+
+        for( index = 0U; index < eventCount; index++ )
+        {
+            pSession = ( MqttSession_t * ) events[ index ].pNetworkContext;
+
+            if( pSession == NULL )
+            {
+                drainQueue( pShard );
+            }
+            else if( pSession->running == true )
+            {
+                processSession( pSession );
+            }
+            else
+            {
+                /* Empty else. */
+            }
+        }
+
+        ( void ) TimerWheel_Advance( &pShard->timerWheel, Clock_GetTimeMs() );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+SessionRuntimeStatus_t SessionRuntime_Init( SessionRuntime_t * pRuntime,
+                                            size_t shardCount )
+{
+    SessionRuntimeStatus_t status = SessionRuntimeSuccess;
+    cpu_set_t allowedCpus;
+    size_t allowedCount = 0U, index = 0U;
+
+    if( pRuntime == NULL )
+    {
+        LogError( ( "Parameter check failed: pRuntime is NULL." ) );
+        status = SessionRuntimeBadParameter;
+    }
+    else
+    {
+        pRuntime->shardCount = 0U;
+        CPU_ZERO( &allowedCpus );
+
+        if( sched_getaffinity( 0, sizeof( allowedCpus ), &allowedCpus ) == 0 )
+        {
+            allowedCount = ( size_t ) CPU_COUNT( &allowedCpus );
+        }
+        else
+        {
+            LogWarn( ( "Failed to get the CPUs the process may run on, so shards run unpinned: %s.",
+                       strerror( errno ) ) );
+        }
+
+        if( shardCount == 0U )
+        {
+            shardCount = ( allowedCount > 0U ) ? allowedCount : 1U;
+        }
+
+        if( shardCount > SESSION_RUNTIME_MAX_SHARDS )
+        {
+            shardCount = SESSION_RUNTIME_MAX_SHARDS;
+        }
+
+        for( index = 0U; ( status == SessionRuntimeSuccess ) && ( index < shardCount ); index++ )
+        {
+            status = initShard( &pRuntime->shards[ index ],
+                                getShardCpu( &allowedCpus, allowedCount, index ) );
+
+            if( status == SessionRuntimeSuccess )
+            {
+                pRuntime->shardCount++;
+            }
+        }
+
+        if( status == SessionRuntimeSuccess )
+        {
+            LogInfo( ( "Started %lu shards.",
+                       ( unsigned long ) pRuntime->shardCount ) );
+        }
+        else
+        {
+            SessionRuntime_Stop( pRuntime );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void SessionRuntime_Stop( SessionRuntime_t * pRuntime )
+{
+    size_t index = 0U;
+
+    if( pRuntime == NULL )
+    {
+        LogError( ( "Parameter check failed: pRuntime is NULL." ) );
+    }
+    else
+    {
+        for( index = 0U; index < pRuntime->shardCount; index++ )
+        {
+            __atomic_store_n( &pRuntime->shards[ index ].stopping, true, __ATOMIC_RELEASE );
+            ( void ) wakeShard( &pRuntime->shards[ index ] );
+        }
+
+        for( index = 0U; index < pRuntime->shardCount; index++ )
+        {
+            ( void ) pthread_join( pRuntime->shards[ index ].thread, NULL );
+            cleanupShard( &pRuntime->shards[ index ] );
+        }
+
+        pRuntime->shardCount = 0U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+SessionRuntimeStatus_t SessionRuntime_InitSession( SessionRuntime_t * pRuntime,
+                                                   MqttSession_t * pSession,
+                                                   const MqttSessionConfig_t * pConfig )
+{
+    SessionRuntimeStatus_t status = SessionRuntimeSuccess;
+    SessionRuntimeShard_t * pShard = NULL;
+    TransportInterface_t wrappedTransport;
+    MQTTFixedBuffer_t fixedBuffer;
+    size_t index = 0U, fewestSessions = SIZE_MAX, sessionCount = 0U;
+
+    if( ( pRuntime == NULL ) || ( pSession == NULL ) || ( pConfig == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pRuntime=%p, pSession=%p, pConfig=%p.",
+                    ( void * ) pRuntime,
+                    ( void * ) pSession,
+                    ( const void * ) pConfig ) );
+        status = SessionRuntimeBadParameter;
+    }
+    else if( ( pRuntime->shardCount == 0U ) || ( pConfig->pTransport == NULL ) ||
+             ( pConfig->packetCallback == NULL ) || ( pConfig->socketDescriptor < 0 ) )
+    {
+        LogError( ( "Parameter check failed: The runtime must be started, and the "
+                    "transport, packet callback and socket must be set." ) );
+        status = SessionRuntimeBadParameter;
+    }
+    else
+    {
+        /* Counts change as other shards close sessions, but an outdated count
+         * only makes the balance slightly uneven. */
+        for( index = 0U; index < pRuntime->shardCount; index++ )
+        {
+            sessionCount = __atomic_load_n( &pRuntime->shards[ index ].sessionCount, __ATOMIC_ACQUIRE );
+
+            if( sessionCount < fewestSessions )
+            {
+                fewestSessions = sessionCount;
+                pShard = &pRuntime->shards[ index ];
+            }
+        }
+
+        pSession->pUserContext = pConfig->pUserContext;
+        pSession->pShard = pShard;
+        pSession->pNetworkContext = pConfig->pTransport->pNetworkContext;
+        pSession->socketDescriptor = pConfig->socketDescriptor;
+        pSession->packetCallback = pConfig->packetCallback;
+        pSession->workCallback = pConfig->workCallback;
+        pSession->closedCallback = pConfig->closedCallback;
+        pSession->bufferedCallback = pConfig->bufferedCallback;
+        pSession->pNextQueued = NULL;
+        pSession->queued = false;
+        pSession->startPending = false;
+        pSession->workPending = false;
+        pSession->running = false;
+
+        /* The pool of the shard is shared only by the sessions of the shard,
+         * and by those being connected on other threads. */
+        if( NetworkBuffer_Init( &pSession->networkBuffer,
+                                &pSession->mqttContext,
+                                &pShard->pool,
+                                pConfig->pTransport,
+                                pSession->buffer,
+                                sizeof( pSession->buffer ),
+                                &wrappedTransport,
+                                &fixedBuffer ) != NetworkBufferSuccess )
+        {
+            LogError( ( "Failed to set up the network buffer of a session." ) );
+            status = SessionRuntimeSystemError;
+        }
+        else if( MQTT_Init( &pSession->mqttContext,
+                            &wrappedTransport,
+                            Clock_GetTimeMs,
+                            eventCallback,
+                            &fixedBuffer ) != MQTTSuccess )
+        {
+            LogError( ( "Failed to initialize the MQTT context of a session." ) );
+            status = SessionRuntimeSystemError;
+        }
+        else
+        {
+            /* Empty else. */
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+SessionRuntimeStatus_t SessionRuntime_StartSession( MqttSession_t * pSession )
+{
+    SessionRuntimeStatus_t status = SessionRuntimeSuccess;
+    SessionRuntimeShard_t * pShard = NULL;
+
+    if( ( pSession == NULL ) || ( pSession->pShard == NULL ) )
+    {
+        LogError( ( "Parameter check failed: The session must be initialized." ) );
+        status = SessionRuntimeBadParameter;
+    }
+    else
+    {
+        pShard = pSession->pShard;
+
+        if( __atomic_add_fetch( &pShard->sessionCount, 1U, __ATOMIC_ACQ_REL ) >
+            SESSION_RUNTIME_MAX_SESSIONS_PER_SHARD )
+        {
+            ( void ) __atomic_sub_fetch( &pShard->sessionCount, 1U, __ATOMIC_ACQ_REL );
+            LogError( ( "The shard of the session already runs %lu sessions.",
+                        ( unsigned long ) SESSION_RUNTIME_MAX_SESSIONS_PER_SHARD ) );
+            status = SessionRuntimeFull;
+        }
+        else
+        {
+            status = queueSession( pSession, true );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+SessionRuntimeStatus_t SessionRuntime_WakeSession( MqttSession_t * pSession )
+{
+    SessionRuntimeStatus_t status = SessionRuntimeSuccess;
+
+    if( ( pSession == NULL ) || ( pSession->pShard == NULL ) || ( pSession->workCallback == NULL ) )
+    {
+        LogError( ( "Parameter check failed: The session must be initialized "
+                    "with a work callback." ) );
+        status = SessionRuntimeBadParameter;
+    }
+    else
+    {
+        status = queueSession( pSession, false );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,6 @@
+# Configuration for the runtime that shards many MQTT sessions across
+# threads pinned to cores.
+set( SESSION_RUNTIME_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
+set( SESSION_RUNTIME_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/session_runtime.c )
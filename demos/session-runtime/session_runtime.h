@@ -0,0 +1,311 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file session_runtime.h
+ * @brief Run many MQTT sessions on worker threads pinned to cores, with the
+ * state of each session in its own object rather than in globals.
+ *
+ * Sessions are spread across shards. Each shard is a worker thread with its
+ * own event loop, timer wheel and network buffer pool, so sessions on
+ * different shards share no state and never contend for a lock.
+ *
+ * The application connects the transport of a session, initializes it with
+ * #SessionRuntime_InitSession and calls MQTT_Connect on its own thread, then
+ * hands it to its shard with #SessionRuntime_StartSession. From then on only
+ * the thread of the shard calls coreMQTT for the session: it runs
+ * MQTT_ProcessLoop when the socket is readable or keep-alive is due, and runs
+ * the work callback of the session when another thread asks for it with
+ * #SessionRuntime_WakeSession, for example to publish.
+ */
+
+#ifndef SESSION_RUNTIME_H_
+#define SESSION_RUNTIME_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/* Event loop, timer wheel and network buffer of each shard. */
+#include "event_loop_posix.h"
+#include "timer_wheel.h"
+#include "network_buffer.h"
+
+/**
+ * @brief The most shards, and so worker threads, a runtime can have.
+ */
+#ifndef SESSION_RUNTIME_MAX_SHARDS
+    #define SESSION_RUNTIME_MAX_SHARDS    ( 64U )
+#endif
+
+/**
+ * @brief Size of the buffer of each session. Packets that do not fit it are
+ * received into blocks of the pool of its shard.
+ */
+#ifndef SESSION_RUNTIME_BUFFER_SIZE
+    #define SESSION_RUNTIME_BUFFER_SIZE    ( 1024U )
+#endif
+
+/**
+ * @brief Size of the network buffer pool of each shard.
+ */
+#ifndef SESSION_RUNTIME_POOL_SIZE
+    #define SESSION_RUNTIME_POOL_SIZE    ( 16384U )
+#endif
+
+/**
+ * @brief Size of each block of the network buffer pool of a shard.
+ */
+#ifndef SESSION_RUNTIME_POOL_BLOCK_SIZE
+    #define SESSION_RUNTIME_POOL_BLOCK_SIZE    ( 1024U )
+#endif
+
+/**
+ * @brief Number of events a shard handles from one wait of its event loop.
+ */
+#ifndef SESSION_RUNTIME_EVENTS_PER_WAIT
+    #define SESSION_RUNTIME_EVENTS_PER_WAIT    ( 16U )
+#endif
+
+/**
+ * @brief The most sessions one shard runs. One slot of its event loop is
+ * taken by the descriptor that wakes it.
+ */
+#define SESSION_RUNTIME_MAX_SESSIONS_PER_SHARD    ( EVENT_LOOP_MAX_CONNECTIONS - 1U )
+
+/**
+ * @brief Return codes from the session runtime functions.
+ */
+typedef enum SessionRuntimeStatus
+{
+    SessionRuntimeSuccess,      /**< @brief The function succeeded. */
+    SessionRuntimeBadParameter, /**< @brief A parameter was NULL or invalid. */
+    SessionRuntimeFull,         /**< @brief The shard of the session runs as many sessions as it can. */
+    SessionRuntimeSystemError   /**< @brief A system call, or a library the runtime uses, failed. */
+} SessionRuntimeStatus_t;
+
+struct MqttSession;
+struct SessionRuntimeShard;
+
+/**
+ * @brief Function called for each packet a session receives.
+ *
+ * Once the session is started, it is called on the thread of its shard.
+ *
+ * @param[in] pSession The session.
+ * @param[in] pPacketInfo The received packet.
+ * @param[in] pDeserializedInfo The deserialized fields of the packet.
+ */
+typedef void ( * MqttSessionPacketCallback_t )( struct MqttSession * pSession,
+                                                MQTTPacketInfo_t * pPacketInfo,
+                                                MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Function called on the thread of the shard of a session after
+ * #SessionRuntime_WakeSession, to call coreMQTT for the session.
+ *
+ * @param[in] pSession The session.
+ */
+typedef void ( * MqttSessionWorkCallback_t )( struct MqttSession * pSession );
+
+/**
+ * @brief Function called on the thread of the shard of a session when its
+ * connection fails. The session has left the shard, so the function may
+ * disconnect its transport.
+ *
+ * @param[in] pSession The session.
+ * @param[in] status The status of the MQTT_ProcessLoop that failed.
+ */
+typedef void ( * MqttSessionClosedCallback_t )( struct MqttSession * pSession,
+                                                MQTTStatus_t status );
+
+/**
+ * @brief Function that tells whether the transport of a session holds
+ * received bytes that its socket no longer reports as readable, as
+ * SSL_pending does for TLS.
+ *
+ * @param[in] pNetworkContext The network context of the transport.
+ *
+ * @return true if MQTT_ProcessLoop must run again before waiting.
+ */
+typedef bool ( * MqttSessionBufferedCallback_t )( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief How to run a session, given to #SessionRuntime_InitSession.
+ */
+typedef struct MqttSessionConfig
+{
+    const TransportInterface_t * pTransport;        /**< @brief Transport of the connected session. */
+    int32_t socketDescriptor;                       /**< @brief Socket of the transport. */
+    MqttSessionPacketCallback_t packetCallback;     /**< @brief Called for each received packet. */
+    MqttSessionWorkCallback_t workCallback;         /**< @brief Called after #SessionRuntime_WakeSession, or NULL. */
+    MqttSessionClosedCallback_t closedCallback;     /**< @brief Called when the connection fails, or NULL. */
+    MqttSessionBufferedCallback_t bufferedCallback; /**< @brief Whether the transport holds received bytes, or NULL. */
+    void * pUserContext;                            /**< @brief Context of the application. */
+} MqttSessionConfig_t;
+
+/**
+ * @brief The state of one MQTT session.
+ *
+ * @note The application may use @ref MqttSession.mqttContext to call
+ * coreMQTT, on the threads allowed above, and @ref MqttSession.pUserContext.
+ * The other members are private to the runtime.
+ */
+typedef struct MqttSession
+{
+    MQTTContext_t mqttContext;                      /**< @brief The MQTT context. It is the first member, so the
+                                                     * event callback can find the session from it. */
+    void * pUserContext;                            /**< @brief Context of the application. */
+    struct SessionRuntimeShard * pShard;            /**< @brief The shard that runs the session. */
+    NetworkContext_t * pNetworkContext;             /**< @brief Network context of the transport. */
+    int32_t socketDescriptor;                       /**< @brief Socket of the transport. */
+    NetworkBuffer_t networkBuffer;                  /**< @brief Grows from the pool of the shard for large packets. */
+    uint8_t buffer[ SESSION_RUNTIME_BUFFER_SIZE ];  /**< @brief Holds the packets that fit it. */
+    TimerWheelTimer_t keepAliveTimer;               /**< @brief Expires when keep-alive needs MQTT_ProcessLoop. */
+    MqttSessionPacketCallback_t packetCallback;     /**< @brief Called for each received packet. */
+    MqttSessionWorkCallback_t workCallback;         /**< @brief Called after #SessionRuntime_WakeSession. */
+    MqttSessionClosedCallback_t closedCallback;     /**< @brief Called when the connection fails. */
+    MqttSessionBufferedCallback_t bufferedCallback; /**< @brief Whether the transport holds received bytes. */
+    struct MqttSession * pNextQueued;               /**< @brief Next session in the queue of the shard. */
+    bool queued;                                    /**< @brief Whether the session is in the queue of the shard. */
+    bool startPending;                              /**< @brief Whether the shard must start waiting on the session. */
+    bool workPending;                               /**< @brief Whether the work callback is due. */
+    bool running;                                   /**< @brief Whether the shard waits on the session. */
+} MqttSession_t;
+
+/**
+ * @brief A worker thread and the sessions it runs.
+ *
+ * @note Only the thread of the shard uses its event loop, timer wheel and
+ * running sessions. Other threads only add sessions to its queue.
+ */
+typedef struct SessionRuntimeShard
+{
+    pthread_t thread;                               /**< @brief The worker thread. */
+    int32_t cpu;                                    /**< @brief The core the thread is pinned to, or -1. */
+    EventLoop_t eventLoop;                          /**< @brief Waits on the sockets of the sessions. */
+    TimerWheel_t timerWheel;                        /**< @brief Keep-alive timers of the sessions. */
+    NetworkBufferPool_t pool;                       /**< @brief Large packets of the sessions are received into it. */
+    uint8_t poolArena[ SESSION_RUNTIME_POOL_SIZE ]; /**< @brief Memory of the blocks of the pool. */
+    int32_t wakeDescriptor;                         /**< @brief eventfd written to wake the thread for its queue. */
+    pthread_mutex_t queueMutex;                     /**< @brief Serializes access to the queue. */
+    MqttSession_t * pQueueHead;                     /**< @brief First session with work for the thread. */
+    MqttSession_t * pQueueTail;                     /**< @brief Last session with work for the thread. */
+    size_t sessionCount;                            /**< @brief Sessions started and not closed, updated atomically. */
+    bool stopping;                                  /**< @brief Whether the thread must return, updated atomically. */
+} SessionRuntimeShard_t;
+
+/**
+ * @brief A set of shards, one per core.
+ */
+typedef struct SessionRuntime
+{
+    SessionRuntimeShard_t shards[ SESSION_RUNTIME_MAX_SHARDS ]; /**< @brief The shards. */
+    size_t shardCount;                                          /**< @brief Number of shards in use. */
+} SessionRuntime_t;
+
+/**
+ * @brief Start the worker threads of a runtime, each pinned to one of the
+ * cores the process may run on.
+ *
+ * @param[out] pRuntime The runtime. It is large, so it is best not put on a
+ * stack.
+ * @param[in] shardCount Number of shards, or 0 for one per core the process
+ * may run on. At most #SESSION_RUNTIME_MAX_SHARDS are started.
+ *
+ * @note A thread that cannot be pinned runs on any of the cores.
+ *
+ * @return #SessionRuntimeSuccess; #SessionRuntimeBadParameter if @p pRuntime
+ * is NULL; #SessionRuntimeSystemError if a thread or its event loop could
+ * not be created.
+ */
+SessionRuntimeStatus_t SessionRuntime_Init( SessionRuntime_t * pRuntime,
+                                            size_t shardCount );
+
+/**
+ * @brief Stop the worker threads of a runtime and release its resources.
+ *
+ * Sessions that are still running are not disconnected. Once this returns,
+ * the application may call MQTT_Disconnect for them on its own thread, then
+ * disconnect their transports.
+ *
+ * @param[in] pRuntime The runtime, started with #SessionRuntime_Init.
+ */
+void SessionRuntime_Stop( SessionRuntime_t * pRuntime );
+
+/**
+ * @brief Assign a session to the shard that runs the fewest sessions, and
+ * initialize its MQTT context with the network buffer pool of the shard.
+ *
+ * Call it once the transport is connected, then MQTT_Connect on
+ * @ref MqttSession.mqttContext, then #SessionRuntime_StartSession.
+ *
+ * @param[in] pRuntime The runtime.
+ * @param[out] pSession The session, which must stay valid while it runs.
+ * @param[in] pConfig How to run the session.
+ *
+ * @return #SessionRuntimeSuccess; #SessionRuntimeBadParameter if a parameter,
+ * the transport or the packet callback is NULL; #SessionRuntimeSystemError if
+ * the network buffer or MQTT context could not be initialized.
+ */
+SessionRuntimeStatus_t SessionRuntime_InitSession( SessionRuntime_t * pRuntime,
+                                                   MqttSession_t * pSession,
+                                                   const MqttSessionConfig_t * pConfig );
+
+/**
+ * @brief Hand a connected session to its shard. From then on only the thread
+ * of the shard may call coreMQTT for the session.
+ *
+ * A session whose connection failed may be connected, initialized and
+ * started again.
+ *
+ * @param[in] pSession The session, initialized with #SessionRuntime_InitSession.
+ *
+ * @return #SessionRuntimeSuccess; #SessionRuntimeBadParameter if @p pSession
+ * is NULL; #SessionRuntimeFull if its shard already runs
+ * #SESSION_RUNTIME_MAX_SESSIONS_PER_SHARD sessions;
+ * #SessionRuntimeSystemError if the shard could not be woken.
+ */
+SessionRuntimeStatus_t SessionRuntime_StartSession( MqttSession_t * pSession );
+
+/**
+ * @brief Make the thread of the shard of a session run its work callback.
+ *
+ * This may be called from any thread. Calls made before the callback runs
+ * result in one call of the callback.
+ *
+ * @param[in] pSession The session, started with #SessionRuntime_StartSession.
+ *
+ * @return #SessionRuntimeSuccess; #SessionRuntimeBadParameter if @p pSession
+ * is NULL or has no work callback; #SessionRuntimeSystemError if the shard
+ * could not be woken.
+ */
+SessionRuntimeStatus_t SessionRuntime_WakeSession( MqttSession_t * pSession );
+
+#endif /* ifndef SESSION_RUNTIME_H_ */
@@ -124,9 +124,30 @@
 
 /**
  * @brief Size of the network buffer for MQTT packets.
+ *
+ * Incoming packets that do not fit it, such as large shadow documents, are
+ * received into blocks of NETWORK_BUFFER_POOL_BLOCK_SIZE bytes taken from a
+ * pool of NETWORK_BUFFER_POOL_SIZE bytes, which return to the pool once the
+ * packet has been processed. The pool bounds the largest packet received.
  */
 #define NETWORK_BUFFER_SIZE       ( 1024U )
 
+/**
+ * @brief Size of the pool the network buffer grows from.
+ */
+#define NETWORK_BUFFER_POOL_SIZE    ( 8192U )
+
+/**
+ * @brief Path of a file that journals the unacked outgoing publishes, so that
+ * they are resent after the demo restarts and resumes its MQTT session.
+ *
+ * The journal is disabled unless this is defined. The durability of the
+ * journal is set with OUTGOING_PUBLISH_JOURNAL_SYNC_POLICY, which defaults to
+ * InflightJournalSyncPeriodic.
+ *
+ * #define OUTGOING_PUBLISH_JOURNAL_PATH    "shadow_publish_journal.bin"
+ */
+
 /**
  * @brief The name of the operating system that the application is running on.
  * The current value is given as an example. Please update for your specific
@@ -52,6 +52,23 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Store of outgoing publishes waiting for an ack. */
+#include "inflight_store.h"
+
+/* Network buffer that grows for large incoming packets. */
+#include "network_buffer.h"
+
+/* Optional measurements of memory use. */
+#include "memory_stats.h"
+
+/* Optional static tracepoints. */
+#include "trace_probes.h"
+
+#ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+    /* Journal of the in-flight publishes. */
+    #include "inflight_journal.h"
+#endif
+
 
 /**
  * These configuration settings are required to run the shadow demo.
@@ -84,6 +101,14 @@
     #define NETWORK_BUFFER_SIZE    ( 1024U )
 #endif
 
+#ifndef NETWORK_BUFFER_POOL_SIZE
+    #define NETWORK_BUFFER_POOL_SIZE    ( 8192U )
+#endif
+
+#ifndef NETWORK_BUFFER_POOL_BLOCK_SIZE
+    #define NETWORK_BUFFER_POOL_BLOCK_SIZE    ( 512U )
+#endif
+
 /**
  * @brief Length of MQTT server host name.
  */
@@ -116,15 +141,55 @@
 
 /**
  * @brief Maximum number of outgoing publishes maintained in the application
- * until an ack is received from the broker.
+ * until an ack is received from the broker, unless #SetOutgoingPublishWindow
+ * supplies a larger window.
  */
 #define MAX_OUTGOING_PUBLISHES              ( 5U )
 
 /**
- * @brief Invalid packet identifier for the MQTT packets. Zero is always an
- * invalid packet identifier as per MQTT 3.1.1 spec.
+ * @brief Size of the buffer holding the compressed payload of each of the
+ * first #MAX_OUTGOING_PUBLISHES outgoing publishes. Payloads that do not
+ * compress into it are sent as they are.
+ */
+#ifndef COMPRESSED_PAYLOAD_BUFFER_SIZE
+    #define COMPRESSED_PAYLOAD_BUFFER_SIZE    ( 512U )
+#endif
+
+/**
+ * @brief Prefix of the reserved topics of AWS IoT, whose payloads are never
+ * compressed.
+ */
+#define AWS_RESERVED_TOPIC_PREFIX           "$aws/"
+
+/**
+ * @brief Length of #AWS_RESERVED_TOPIC_PREFIX.
+ */
+#define AWS_RESERVED_TOPIC_PREFIX_LENGTH    ( ( int32_t ) ( sizeof( AWS_RESERVED_TOPIC_PREFIX ) - 1 ) )
+
+#ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+
+/**
+ * @brief Size of each half of the journal file at
+ * OUTGOING_PUBLISH_JOURNAL_PATH, in bytes.
  */
-#define MQTT_PACKET_ID_INVALID              ( ( uint16_t ) 0U )
+    #ifndef OUTGOING_PUBLISH_JOURNAL_HALF_SIZE
+        #define OUTGOING_PUBLISH_JOURNAL_HALF_SIZE        ( 65536U )
+    #endif
+
+/**
+ * @brief When the journal forces its records to disk.
+ */
+    #ifndef OUTGOING_PUBLISH_JOURNAL_SYNC_POLICY
+        #define OUTGOING_PUBLISH_JOURNAL_SYNC_POLICY      InflightJournalSyncPeriodic
+    #endif
+
+/**
+ * @brief Records between syncs with #InflightJournalSyncPeriodic.
+ */
+    #ifndef OUTGOING_PUBLISH_JOURNAL_SYNC_INTERVAL
+        #define OUTGOING_PUBLISH_JOURNAL_SYNC_INTERVAL    ( 16U )
+    #endif
+#endif /* ifdef OUTGOING_PUBLISH_JOURNAL_PATH */
 
 /**
  * @brief Timeout for MQTT_ProcessLoop function in milliseconds.
@@ -159,25 +224,6 @@
 
 /*-----------------------------------------------------------*/
 
-/**
- * @brief Structure to keep the MQTT publish packets until an ack is received
- * for QoS1 publishes.
- */
-typedef struct PublishPackets
-{
-    /**
-     * @brief Packet identifier of the publish packet.
-     */
-    uint16_t packetId;
-
-    /**
-     * @brief Publish info of the publish packet.
-     */
-    MQTTPublishInfo_t pubInfo;
-} PublishPackets_t;
-
-/*-----------------------------------------------------------*/
-
 /**
  * @brief Packet Identifier generated when Subscribe request was sent to the broker;
  * it is used to match received Subscribe ACK to the transmitted subscribe.
@@ -192,17 +238,102 @@ static uint16_t globalSubscribePacketIdentifier = 0U;
 static uint16_t globalUnsubscribePacketIdentifier = 0U;
 
 /**
- * @brief Array to keep the outgoing publish messages.
- * These stored outgoing publish messages are kept until a successful ack
- * is received.
+ * @brief The topic filters of the outstanding SUBSCRIBE, in packet order, used
+ * to map the SUBACK return codes back to them.
+ */
+static const MQTTSubscribeInfo_t * pGlobalSubscriptionList = NULL;
+
+/**
+ * @brief Number of topic filters in #pGlobalSubscriptionList.
+ */
+static size_t globalSubscriptionCount = 0U;
+
+/**
+ * @brief Where to store the SUBACK return code of each topic filter of the
+ * outstanding SUBSCRIBE, or NULL.
  */
-static PublishPackets_t outgoingPublishPackets[ MAX_OUTGOING_PUBLISHES ] = { 0 };
+static MQTTSubAckStatus_t * pGlobalSubAckStatus = NULL;
+
+/**
+ * @brief Number of topic filters the broker refused in the last SUBACK.
+ */
+static size_t globalSubAckFailureCount = 0U;
+
+/**
+ * @brief Set when the SUBACK of the outstanding SUBSCRIBE is received.
+ */
+static bool globalSubAckReceived = false;
+
+/**
+ * @brief Set when the UNSUBACK of the outstanding UNSUBSCRIBE is received.
+ */
+static bool globalUnsubAckReceived = false;
+
+/**
+ * @brief The outgoing publish messages, kept by packet id until a successful
+ * ack is received.
+ */
+static InflightStore_t outgoingPublishes;
+
+/**
+ * @brief The statically allocated memory of #outgoingPublishes, used unless
+ * #SetOutgoingPublishWindow supplies an arena.
+ */
+static uint8_t defaultOutgoingPublishArena[ INFLIGHT_STORE_ARENA_SIZE( MAX_OUTGOING_PUBLISHES ) ];
+
+/**
+ * @brief The codec set by #SetPublishPayloadCodec, or NULL.
+ */
+static PayloadCodec_t * pPublishPayloadCodec = NULL;
+
+/**
+ * @brief The compressed payloads of outgoing publishes, by the index of their
+ * entry in #outgoingPublishes, so that they stay valid for resends until the
+ * PUBACK.
+ */
+static uint8_t compressedPayloads[ MAX_OUTGOING_PUBLISHES ][ COMPRESSED_PAYLOAD_BUFFER_SIZE ];
+
+#ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+
+/**
+ * @brief The journal of #outgoingPublishes, so that unacked publishes survive
+ * a restart of the demo and are resent to a resumed session.
+ */
+    static InflightJournal_t outgoingPublishJournal;
+
+/**
+ * @brief Set while #outgoingPublishJournal is open.
+ */
+    static bool outgoingPublishJournalOpen = false;
+#endif
 
 /**
  * @brief The network buffer must remain valid for the lifetime of the MQTT context.
  */
 static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
+/**
+ * @brief Memory that #buffer grows into for incoming packets that do not fit
+ * it, such as large shadow documents.
+ */
+static uint8_t networkBufferPoolArena[ NETWORK_BUFFER_POOL_SIZE ];
+
+/**
+ * @brief The pool of #networkBufferPoolArena.
+ */
+static NetworkBufferPool_t networkBufferPool;
+
+/**
+ * @brief Set once #networkBufferPool is set up.
+ */
+static bool networkBufferPoolReady = false;
+
+/**
+ * @brief The growable network buffer of the MQTT context, which wraps its
+ * transport.
+ */
+static NetworkBuffer_t growableNetworkBuffer;
+
 /**
  * @brief The MQTT context used for MQTT operation.
  */
@@ -218,6 +349,11 @@ static NetworkContext_t networkContext = { 0 };
  */
 static bool mqttSessionEstablished = false;
 
+/**
+ * @brief Times of the phases of the last attempt to connect.
+ */
+static ConnectTiming_t connectTiming;
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -234,50 +370,75 @@ static bool mqttSessionEstablished = false;
 static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext );
 
 /**
- * @brief Function to get the free index at which an outgoing publish
- * can be stored.
- *
- * @param[out] pIndex The output parameter to return the index at which an
- * outgoing publish message can be stored.
+ * @brief Function to resend the publishes if a session is re-established with
+ * the broker. This function handles the resending of the QoS1 publish packets,
+ * which are maintained locally.
  *
- * @return EXIT_FAILURE if no more publishes can be stored;
- * EXIT_SUCCESS if an index to store the next outgoing publish is obtained.
+ * @param[in] pMqttContext MQTT context pointer.
  */
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex );
+static int handlePublishResend( MQTTContext_t * pMqttContext );
 
 /**
- * @brief Function to clean up an outgoing publish at given index from the
- * #outgoingPublishPackets array.
+ * @brief Map the return codes of a SUBACK to the topic filters of the
+ * outstanding SUBSCRIBE.
  *
- * @param[in] index The index at which a publish message has to be cleaned up.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming SUBACK.
  */
-static void cleanupOutgoingPublishAt( uint8_t index );
+static void updateSubAckStatus( MQTTPacketInfo_t * pPacketInfo );
 
 /**
- * @brief Function to clean up all the outgoing publishes maintained in the
- * array.
+ * @brief Compress the payload of an outgoing publish into the buffer of its
+ * entry, if #SetPublishPayloadCodec set a codec and its topic allows it.
+ *
+ * @param[in,out] pPublish The stored publish, whose payload is replaced by
+ * the compressed payload.
  */
-static void cleanupOutgoingPublishes( void );
+static void compressPublishPayload( InflightPublish_t * pPublish );
 
 /**
- * @brief Function to clean up the publish packet with the given packet id.
+ * @brief Get the time between two phases of a connection.
  *
- * @param[in] packetId Packet identifier of the packet to be cleaned up from
- * the array.
+ * @param[in] fromUs Time at which the earlier phase completed.
+ * @param[in] toUs Time at which the later phase completed.
+ *
+ * @return The time in microseconds, or 0 if either phase was not reached.
  */
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId );
+static uint64_t getPhaseDurationUs( uint64_t fromUs,
+                                    uint64_t toUs );
 
 /**
- * @brief Function to resend the publishes if a session is re-established with
- * the broker. This function handles the resending of the QoS1 publish packets,
- * which are maintained locally.
+ * @brief Log the time taken by each phase of a connection.
  *
- * @param[in] pMqttContext MQTT context pointer.
+ * @param[in] pConnectTiming The times of the phases.
  */
-static int handlePublishResend( MQTTContext_t * pMqttContext );
+static void logConnectTiming( const ConnectTiming_t * pConnectTiming );
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief The number of reconnect attempts that may start at once.
+ */
+#define RECONNECT_BUDGET_CAPACITY       ( 4U )
+
+/**
+ * @brief The interval in milliseconds at which the reconnect budget gains
+ * back one attempt.
+ */
+#define RECONNECT_BUDGET_REFILL_MS      ( 1000U )
+
+/**
+ * @brief The number of connection attempts that may be in progress at once.
+ */
+#define RECONNECT_BUDGET_MAX_IN_PROGRESS    ( 1U )
+
+/**
+ * @brief The retry budget that the connection attempts of the process draw
+ * from, so that they are spread over time after an outage.
+ */
+static RetryUtilsBudget_t reconnectBudget = RETRY_UTILS_BUDGET_INITIALIZER( RECONNECT_BUDGET_CAPACITY,
+                                                                            RECONNECT_BUDGET_REFILL_MS,
+                                                                            RECONNECT_BUDGET_MAX_IN_PROGRESS );
+
 static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext )
 {
     int returnStatus = EXIT_SUCCESS;
@@ -312,6 +473,11 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     /* Initialize reconnect attempts and interval */
     RetryUtils_ParamsReset( &reconnectParams );
 
+    /* Take the first attempt from the reconnect budget. The attempts that
+     * fail are released, and the retries taken, by RetryUtils_BackoffAndSleep. */
+    reconnectParams.pBudget = &reconnectBudget;
+    ( void ) RetryUtils_BudgetAcquireAndSleep( reconnectParams.pBudget );
+
     /* Attempt to connect to MQTT broker. If connection fails, retry after
      * a timeout. Timeout value will exponentially increase until maximum
      * attempts are reached.
@@ -325,6 +491,9 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
                    AWS_IOT_ENDPOINT_LENGTH,
                    AWS_IOT_ENDPOINT,
                    AWS_MQTT_PORT ) );
+        ( void ) memset( &connectTiming, 0x00, sizeof( connectTiming ) );
+        pNetworkContext->pConnectTiming = &connectTiming;
+
         opensslStatus = Openssl_Connect( pNetworkContext,
                                          &serverInfo,
                                          &opensslCredentials,
@@ -344,78 +513,104 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
         }
     } while( ( opensslStatus != OPENSSL_SUCCESS ) && ( retryUtilsStatus == RetryUtilsSuccess ) );
 
+    /* The attempt that succeeded is complete. */
+    if( opensslStatus == OPENSSL_SUCCESS )
+    {
+        ( void ) RetryUtils_BudgetRelease( &reconnectBudget );
+    }
+
     return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex )
-{
-    int returnStatus = EXIT_FAILURE;
-    uint8_t index = 0;
+/*-----------------------------------------------------------*/
 
-    assert( outgoingPublishPackets != NULL );
-    assert( pIndex != NULL );
+static uint64_t getPhaseDurationUs( uint64_t fromUs,
+                                    uint64_t toUs )
+{
+    uint64_t durationUs = 0U;
 
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
+    if( ( fromUs != 0U ) && ( toUs >= fromUs ) )
     {
-        /* A free index is marked by invalid packet id.
-         * Check if the the index has a free slot. */
-        if( outgoingPublishPackets[ index ].packetId == MQTT_PACKET_ID_INVALID )
-        {
-            returnStatus = EXIT_SUCCESS;
-            break;
-        }
+        durationUs = toUs - fromUs;
     }
 
-    /* Copy the available index into the output param. */
-    *pIndex = index;
-
-    return returnStatus;
+    return durationUs;
 }
+
 /*-----------------------------------------------------------*/
 
-static void cleanupOutgoingPublishAt( uint8_t index )
+static void logConnectTiming( const ConnectTiming_t * pConnectTiming )
 {
-    assert( outgoingPublishPackets != NULL );
-    assert( index < MAX_OUTGOING_PUBLISHES );
-
-    /* Clear the outgoing publish packet. */
-    ( void ) memset( &( outgoingPublishPackets[ index ] ),
-                     0x00,
-                     sizeof( outgoingPublishPackets[ index ] ) );
+    /* Without a certificate, as when a session is resumed, the TLS phase is
+     * not split into certificate and verification times. */
+    LogInfo( ( "Connect timing (us): DNS=%lu (cache=%d), TCP=%lu, "
+               "TLS=%lu (certificate=%lu, verification=%lu, resumed=%d), "
+               "CONNACK=%lu, total=%lu.",
+               ( unsigned long ) getPhaseDurationUs( pConnectTiming->startUs,
+                                                     pConnectTiming->dnsResolvedUs ),
+               ( int ) pConnectTiming->dnsCacheUsed,
+               ( unsigned long ) getPhaseDurationUs( pConnectTiming->dnsResolvedUs,
+                                                     pConnectTiming->tcpConnectedUs ),
+               ( unsigned long ) getPhaseDurationUs( pConnectTiming->tcpConnectedUs,
+                                                     pConnectTiming->tlsHandshakeDoneUs ),
+               ( unsigned long ) getPhaseDurationUs( pConnectTiming->tcpConnectedUs,
+                                                     pConnectTiming->tlsCertificateReceivedUs ),
+               ( unsigned long ) getPhaseDurationUs( pConnectTiming->tlsCertificateReceivedUs,
+                                                     pConnectTiming->tlsCertificateVerifiedUs ),
+               ( int ) pConnectTiming->tlsSessionResumed,
+               ( unsigned long ) getPhaseDurationUs( pConnectTiming->tlsHandshakeDoneUs,
+                                                     pConnectTiming->connackReceivedUs ),
+               ( unsigned long ) getPhaseDurationUs( pConnectTiming->startUs,
+                                                     pConnectTiming->connackReceivedUs ) ) );
 }
 
 /*-----------------------------------------------------------*/
 
-static void cleanupOutgoingPublishes( void )
+static void updateSubAckStatus( MQTTPacketInfo_t * pPacketInfo )
 {
-    assert( outgoingPublishPackets != NULL );
+    uint8_t * pPayload = NULL;
+    size_t pSize = 0;
+    size_t index = 0U;
 
-    /* Clean up all the outgoing publish packets. */
-    ( void ) memset( outgoingPublishPackets, 0x00, sizeof( outgoingPublishPackets ) );
-}
+    MQTTStatus_t mqttStatus = MQTT_GetSubAckStatusCodes( pPacketInfo, &pPayload, &pSize );
 
-/*-----------------------------------------------------------*/
+    /* MQTT_GetSubAckStatusCodes always returns success if called with packet info
+     * from the event callback and non-NULL parameters. */
+    assert( mqttStatus == MQTTSuccess );
 
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId )
-{
-    uint8_t index = 0;
+    /* Suppress unused variable warning when asserts are disabled in build. */
+    ( void ) mqttStatus;
 
-    assert( outgoingPublishPackets != NULL );
-    assert( packetId != MQTT_PACKET_ID_INVALID );
+    /* The broker returns one code per topic filter, in the order of the
+     * SUBSCRIBE. */
+    globalSubAckFailureCount = ( pSize < globalSubscriptionCount ) ? ( globalSubscriptionCount - pSize ) : 0U;
 
-    /* Clean up all the saved outgoing publishes. */
-    for( ; index < MAX_OUTGOING_PUBLISHES; index++ )
+    for( index = 0U; ( index < pSize ) && ( index < globalSubscriptionCount ); index++ )
     {
-        if( outgoingPublishPackets[ index ].packetId == packetId )
+        if( pGlobalSubAckStatus != NULL )
         {
-            cleanupOutgoingPublishAt( index );
-            LogInfo( ( "Cleaned up outgoing publish packet with packet id %u.\n\n",
-                       packetId ) );
-            break;
+            pGlobalSubAckStatus[ index ] = ( MQTTSubAckStatus_t ) pPayload[ index ];
+        }
+
+        if( pPayload[ index ] == ( uint8_t ) MQTTSubAckFailure )
+        {
+            LogError( ( "Broker rejected subscription to %.*s.",
+                        pGlobalSubscriptionList[ index ].topicFilterLength,
+                        pGlobalSubscriptionList[ index ].pTopicFilter ) );
+            globalSubAckFailureCount++;
+        }
+        else
+        {
+            LogInfo( ( "Subscribed to %.*s with maximum QoS %u.",
+                       pGlobalSubscriptionList[ index ].topicFilterLength,
+                       pGlobalSubscriptionList[ index ].pTopicFilter,
+                       ( unsigned int ) pPayload[ index ] ) );
         }
     }
+
+    globalSubAckReceived = true;
 }
 
 /*-----------------------------------------------------------*/
@@ -430,12 +625,24 @@ void HandleOtherIncomingPacket( MQTTPacketInfo_t * pPacketInfo,
             LogInfo( ( "MQTT_PACKET_TYPE_SUBACK.\n\n" ) );
             /* Make sure ACK packet identifier matches with Request packet identifier. */
             assert( globalSubscribePacketIdentifier == packetIdentifier );
+
+            if( globalSubscribePacketIdentifier == packetIdentifier )
+            {
+                updateSubAckStatus( pPacketInfo );
+            }
+
             break;
 
         case MQTT_PACKET_TYPE_UNSUBACK:
             LogInfo( ( "MQTT_PACKET_TYPE_UNSUBACK.\n\n" ) );
             /* Make sure ACK packet identifier matches with Request packet identifier. */
             assert( globalUnsubscribePacketIdentifier == packetIdentifier );
+
+            if( globalUnsubscribePacketIdentifier == packetIdentifier )
+            {
+                globalUnsubAckReceived = true;
+            }
+
             break;
 
         case MQTT_PACKET_TYPE_PINGRESP:
@@ -447,10 +654,19 @@ void HandleOtherIncomingPacket( MQTTPacketInfo_t * pPacketInfo,
             break;
 
         case MQTT_PACKET_TYPE_PUBACK:
+            TRACE_PROBE1( publish_ack, packetIdentifier );
             LogInfo( ( "PUBACK received for packet id %u.\n\n",
                        packetIdentifier ) );
             /* Cleanup publish packet when a PUBACK is received. */
-            cleanupOutgoingPublishWithPacketID( packetIdentifier );
+            if( InflightStore_Release( &outgoingPublishes, packetIdentifier ) == InflightStoreSuccess )
+            {
+                #ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+                    ( void ) InflightJournal_RecordRelease( &outgoingPublishJournal,
+                                                            packetIdentifier );
+                #endif
+                LogInfo( ( "Cleaned up outgoing publish packet with packet id %u.\n\n",
+                           packetIdentifier ) );
+            }
             break;
 
         /* Any other packet type is invalid. */
@@ -466,40 +682,114 @@ static int handlePublishResend( MQTTContext_t * pMqttContext )
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t index = 0U;
+    InflightPublish_t * pPublish = NULL;
+    size_t cursor = 0U;
 
-    assert( outgoingPublishPackets != NULL );
-
-    /* Resend all the QoS1 publishes still in the array. These are the
+    /* Resend all the QoS1 publishes still in the store. These are the
      * publishes that hasn't received a PUBACK. When a PUBACK is
-     * received, the publish is removed from the array. */
-    for( index = 0U; index < MAX_OUTGOING_PUBLISHES; index++ )
+     * received, the publish is removed from the store. */
+    for( pPublish = InflightStore_Next( &outgoingPublishes, &cursor );
+         pPublish != NULL;
+         pPublish = InflightStore_Next( &outgoingPublishes, &cursor ) )
     {
-        if( outgoingPublishPackets[ index ].packetId != MQTT_PACKET_ID_INVALID )
+        pPublish->pubInfo.dup = true;
+
+        LogInfo( ( "Sending duplicate PUBLISH with packet id %u.",
+                   pPublish->packetId ) );
+        mqttStatus = MQTT_Publish( pMqttContext,
+                                   &pPublish->pubInfo,
+                                   pPublish->packetId );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Sending duplicate PUBLISH for packet id %u "
+                        " failed with status %u.",
+                        pPublish->packetId,
+                        mqttStatus ) );
+            returnStatus = EXIT_FAILURE;
+            break;
+        }
+        else
         {
-            outgoingPublishPackets[ index ].pubInfo.dup = true;
+            LogInfo( ( "Sent duplicate PUBLISH successfully for packet id %u.\n\n",
+                       pPublish->packetId ) );
+        }
+    }
 
-            LogInfo( ( "Sending duplicate PUBLISH with packet id %u.",
-                       outgoingPublishPackets[ index ].packetId ) );
-            mqttStatus = MQTT_Publish( pMqttContext,
-                                       &outgoingPublishPackets[ index ].pubInfo,
-                                       outgoingPublishPackets[ index ].packetId );
+    return returnStatus;
+}
 
-            if( mqttStatus != MQTTSuccess )
-            {
-                LogError( ( "Sending duplicate PUBLISH for packet id %u "
-                            " failed with status %u.",
-                            outgoingPublishPackets[ index ].packetId,
-                            mqttStatus ) );
-                returnStatus = EXIT_FAILURE;
-                break;
-            }
-            else
-            {
-                LogInfo( ( "Sent duplicate PUBLISH successfully for packet id %u.\n\n",
-                           outgoingPublishPackets[ index ].packetId ) );
-            }
+/*-----------------------------------------------------------*/
+
+static void compressPublishPayload( InflightPublish_t * pPublish )
+{
+    size_t index = ( size_t ) ( pPublish - outgoingPublishes.pEntries );
+    size_t compressedLength = 0U;
+    PayloadCodecStatus_t codecStatus = PayloadCodecSuccess;
+
+    /* Entries beyond the default window have no buffer of their own. */
+    if( ( pPublishPayloadCodec != NULL ) &&
+        ( index < MAX_OUTGOING_PUBLISHES ) &&
+        ( ( pPublish->pubInfo.topicNameLength < AWS_RESERVED_TOPIC_PREFIX_LENGTH ) ||
+          ( strncmp( pPublish->pubInfo.pTopicName,
+                     AWS_RESERVED_TOPIC_PREFIX,
+                     ( size_t ) AWS_RESERVED_TOPIC_PREFIX_LENGTH ) != 0 ) ) )
+    {
+        codecStatus = PayloadCodec_Compress( pPublishPayloadCodec,
+                                             pPublish->pubInfo.pPayload,
+                                             pPublish->pubInfo.payloadLength,
+                                             compressedPayloads[ index ],
+                                             sizeof( compressedPayloads[ index ] ),
+                                             &compressedLength );
+
+        if( codecStatus == PayloadCodecSuccess )
+        {
+            LogDebug( ( "Compressed PUBLISH payload: OriginalLength=%lu, CompressedLength=%lu",
+                        ( unsigned long ) pPublish->pubInfo.payloadLength,
+                        ( unsigned long ) compressedLength ) );
+            pPublish->pubInfo.pPayload = compressedPayloads[ index ];
+            pPublish->pubInfo.payloadLength = compressedLength;
         }
+        else if( codecStatus != PayloadCodecIncompressible )
+        {
+            LogWarn( ( "Sending PUBLISH payload uncompressed: CodecStatus=%d",
+                       ( int ) codecStatus ) );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SetOutgoingPublishWindow( void * pArena,
+                                  size_t arenaSize,
+                                  size_t windowSize )
+{
+    int32_t returnStatus = EXIT_SUCCESS;
+    InflightStoreStatus_t storeStatus = InflightStoreSuccess;
+
+    if( pArena == NULL )
+    {
+        /* Return to the statically allocated store. */
+        storeStatus = InflightStore_Init( &outgoingPublishes,
+                                          defaultOutgoingPublishArena,
+                                          sizeof( defaultOutgoingPublishArena ),
+                                          MAX_OUTGOING_PUBLISHES );
+    }
+    else
+    {
+        storeStatus = InflightStore_Init( &outgoingPublishes, pArena, arenaSize, windowSize );
+    }
+
+    if( storeStatus != InflightStoreSuccess )
+    {
+        LogError( ( "Failed to set up a window of %lu outgoing publishes in %lu bytes.",
+                    ( unsigned long ) windowSize,
+                    ( unsigned long ) arenaSize ) );
+        returnStatus = EXIT_FAILURE;
     }
 
     return returnStatus;
@@ -514,6 +804,7 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
     MQTTConnectInfo_t connectInfo;
     MQTTFixedBuffer_t networkBuffer;
     TransportInterface_t transport;
+    TransportInterface_t wrappedTransport;
     bool createCleanSession = false;
     MQTTContext_t * pMqttContext = &mqttContext;
     NetworkContext_t * pNetworkContext = &networkContext;
@@ -522,11 +813,44 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
     assert( pMqttContext != NULL );
     assert( pNetworkContext != NULL );
 
-    /* Initialize the mqtt context and network context. */
-    ( void ) memset( pMqttContext, 0U, sizeof( MQTTContext_t ) );
-    ( void ) memset( pMqttContext, 0U, sizeof( NetworkContext_t ) );
+    /* Set up the default store of outgoing publishes, unless a window was
+     * supplied. */
+    if( outgoingPublishes.pEntries == NULL )
+    {
+        ( void ) SetOutgoingPublishWindow( NULL, 0U, 0U );
+    }
+
+    #ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+        /* Restore the publishes left unacked by an earlier run. */
+        if( outgoingPublishJournalOpen == false )
+        {
+            if( InflightJournal_Open( &outgoingPublishJournal,
+                                      &outgoingPublishes,
+                                      OUTGOING_PUBLISH_JOURNAL_PATH,
+                                      OUTGOING_PUBLISH_JOURNAL_HALF_SIZE,
+                                      OUTGOING_PUBLISH_JOURNAL_SYNC_POLICY,
+                                      OUTGOING_PUBLISH_JOURNAL_SYNC_INTERVAL ) == InflightJournalSuccess )
+            {
+                outgoingPublishJournalOpen = true;
+            }
+            else
+            {
+                LogError( ( "Failed to open the journal of outgoing publishes %s.",
+                            OUTGOING_PUBLISH_JOURNAL_PATH ) );
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+
+    #endif /* ifdef OUTGOING_PUBLISH_JOURNAL_PATH */
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        /* Initialize the mqtt context and network context. */
+        ( void ) memset( pMqttContext, 0U, sizeof( MQTTContext_t ) );
+        ( void ) memset( pMqttContext, 0U, sizeof( NetworkContext_t ) );
 
-    returnStatus = connectToServerWithBackoffRetries( pNetworkContext );
+        returnStatus = connectToServerWithBackoffRetries( pNetworkContext );
+    }
 
     if( returnStatus != EXIT_SUCCESS )
     {
@@ -545,16 +869,44 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
         transport.send = Openssl_Send;
         transport.recv = Openssl_Recv;
 
-        /* Fill the values for network buffer. */
-        networkBuffer.pBuffer = buffer;
-        networkBuffer.size = NETWORK_BUFFER_SIZE;
+        if( networkBufferPoolReady == false )
+        {
+            networkBufferPoolReady = ( NetworkBufferPool_Init( &networkBufferPool,
+                                                               networkBufferPoolArena,
+                                                               sizeof( networkBufferPoolArena ),
+                                                               NETWORK_BUFFER_POOL_BLOCK_SIZE ) == NetworkBufferSuccess );
+        }
+
+        /* The network buffer starts as the small static buffer, and grows
+         * from the pool for the packets that do not fit it. The wrapper
+         * transport tells it the length of each incoming packet. */
+        if( ( networkBufferPoolReady == true ) &&
+            ( NetworkBuffer_Init( &growableNetworkBuffer,
+                                  pMqttContext,
+                                  &networkBufferPool,
+                                  &transport,
+                                  buffer,
+                                  NETWORK_BUFFER_SIZE,
+                                  &wrappedTransport,
+                                  &networkBuffer ) == NetworkBufferSuccess ) )
+        {
+            mqttStatus = MQTTSuccess;
+        }
+        else
+        {
+            LogError( ( "Failed to set up the network buffer." ) );
+            mqttStatus = MQTTBadParameter;
+        }
 
         /* Initialize MQTT library. */
-        mqttStatus = MQTT_Init( pMqttContext,
-                                &transport,
-                                Clock_GetTimeMs,
-                                eventCallback,
-                                &networkBuffer );
+        if( mqttStatus == MQTTSuccess )
+        {
+            mqttStatus = MQTT_Init( pMqttContext,
+                                    &wrappedTransport,
+                                    Clock_GetTimeMs,
+                                    eventCallback,
+                                    &networkBuffer );
+        }
 
         if( mqttStatus != MQTTSuccess )
         {
@@ -605,6 +957,9 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
             }
             else
             {
+                connectTiming.connackReceivedUs = Clock_GetTimeUs();
+                logConnectTiming( &connectTiming );
+
                 LogInfo( ( "MQTT connection successfully established with broker.\n\n" ) );
             }
         }
@@ -637,7 +992,11 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
 
                 /* Clean up the outgoing publishes waiting for ack as this new
                  * connection doesn't re-establish an existing session. */
-                cleanupOutgoingPublishes();
+                InflightStore_Clear( &outgoingPublishes );
+
+                #ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+                    ( void ) InflightJournal_Compact( &outgoingPublishJournal );
+                #endif
             }
         }
     }
@@ -673,38 +1032,57 @@ int32_t DisconnectMqttSession( void )
     /* End TLS session, then close TCP connection. */
     ( void ) Openssl_Disconnect( pNetworkContext );
 
+    #if ( MEMORY_STATS_ENABLED != 0 )
+        /* Packets larger than the base buffer were received into blocks of
+         * the pool. */
+        LogInfo( ( "Largest incoming packet had a remaining length of %lu bytes; "
+                   "NETWORK_BUFFER_SIZE is %lu bytes.",
+                   ( unsigned long ) growableNetworkBuffer.largestPacket,
+                   ( unsigned long ) NETWORK_BUFFER_SIZE ) );
+    #endif
+
+    #ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+        /* The stored publishes point into the journal, so they are dropped with
+         * it. The next session replays the ones still unacked. */
+        if( outgoingPublishJournalOpen == true )
+        {
+            InflightJournal_Close( &outgoingPublishJournal );
+            InflightStore_Clear( &outgoingPublishes );
+            outgoingPublishJournalOpen = false;
+        }
+    #endif
+
     return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-int32_t SubscribeToTopic( const char * pTopicFilter,
-                          uint16_t topicFilterLength )
+int32_t SubscribeToTopics( const MQTTSubscribeInfo_t * pSubscriptionList,
+                           size_t subscriptionCount,
+                           MQTTSubAckStatus_t * pSubAckStatus )
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus;
     MQTTContext_t * pMqttContext = &mqttContext;
-    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
 
     assert( pMqttContext != NULL );
-    assert( pTopicFilter != NULL );
-    assert( topicFilterLength > 0 );
+    assert( pSubscriptionList != NULL );
+    assert( subscriptionCount > 0U );
 
-    /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
-
-    /* This example subscribes to only one topic and uses QOS1. */
-    pSubscriptionList[ 0 ].qos = MQTTQoS1;
-    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+    /* Remember the topic filters to map the SUBACK return codes back to them. */
+    pGlobalSubscriptionList = pSubscriptionList;
+    globalSubscriptionCount = subscriptionCount;
+    pGlobalSubAckStatus = pSubAckStatus;
+    globalSubAckFailureCount = 0U;
+    globalSubAckReceived = false;
 
     /* Generate packet identifier for the SUBSCRIBE packet. */
     globalSubscribePacketIdentifier = MQTT_GetPacketId( pMqttContext );
 
-    /* Send SUBSCRIBE packet. */
+    /* Send a single SUBSCRIBE packet for all the topic filters. */
     mqttStatus = MQTT_Subscribe( pMqttContext,
                                  pSubscriptionList,
-                                 sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
+                                 subscriptionCount,
                                  globalSubscribePacketIdentifier );
 
     if( mqttStatus != MQTTSuccess )
@@ -715,9 +1093,8 @@ int32_t SubscribeToTopic( const char * pTopicFilter,
     }
     else
     {
-        LogInfo( ( "SUBSCRIBE topic %.*s to broker.\n\n",
-                   topicFilterLength,
-                   pTopicFilter ) );
+        LogInfo( ( "SUBSCRIBE sent for %lu topic filters to broker.\n\n",
+                   ( unsigned long ) subscriptionCount ) );
 
         /* Process incoming packet from the broker. Acknowledgment for subscription
          * ( SUBACK ) will be received here. However after sending the subscribe, the
@@ -734,40 +1111,54 @@ int32_t SubscribeToTopic( const char * pTopicFilter,
             LogError( ( "MQTT_ProcessLoop returned with status = %u.",
                         mqttStatus ) );
         }
+        else if( globalSubAckReceived == false )
+        {
+            returnStatus = EXIT_FAILURE;
+            LogError( ( "SUBACK was not received within %u ms.",
+                        ( unsigned int ) MQTT_PROCESS_LOOP_TIMEOUT_MS ) );
+        }
+        else if( globalSubAckFailureCount > 0U )
+        {
+            returnStatus = EXIT_FAILURE;
+            LogError( ( "Broker rejected %lu of %lu topic filters.",
+                        ( unsigned long ) globalSubAckFailureCount,
+                        ( unsigned long ) subscriptionCount ) );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
     }
 
+    pGlobalSubscriptionList = NULL;
+    globalSubscriptionCount = 0U;
+    pGlobalSubAckStatus = NULL;
+
     return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-int32_t UnsubscribeFromTopic( const char * pTopicFilter,
-                              uint16_t topicFilterLength )
+int32_t UnsubscribeFromTopics( const MQTTSubscribeInfo_t * pSubscriptionList,
+                               size_t subscriptionCount )
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus;
     MQTTContext_t * pMqttContext = &mqttContext;
-    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
 
     assert( pMqttContext != NULL );
-    assert( pTopicFilter != NULL );
-    assert( topicFilterLength > 0 );
+    assert( pSubscriptionList != NULL );
+    assert( subscriptionCount > 0U );
 
-    /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
-
-    /* This example subscribes to only one topic and uses QOS1. */
-    pSubscriptionList[ 0 ].qos = MQTTQoS1;
-    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+    globalUnsubAckReceived = false;
 
     /* Generate packet identifier for the UNSUBSCRIBE packet. */
     globalUnsubscribePacketIdentifier = MQTT_GetPacketId( pMqttContext );
 
-    /* Send UNSUBSCRIBE packet. */
+    /* Send a single UNSUBSCRIBE packet for all the topic filters. */
     mqttStatus = MQTT_Unsubscribe( pMqttContext,
                                    pSubscriptionList,
-                                   sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
+                                   subscriptionCount,
                                    globalUnsubscribePacketIdentifier );
 
     if( mqttStatus != MQTTSuccess )
@@ -778,17 +1169,11 @@ int32_t UnsubscribeFromTopic( const char * pTopicFilter,
     }
     else
     {
-        LogInfo( ( "UNSUBSCRIBE sent topic %.*s to broker.\n\n",
-                   topicFilterLength,
-                   pTopicFilter ) );
+        LogInfo( ( "UNSUBSCRIBE sent for %lu topic filters to broker.\n\n",
+                   ( unsigned long ) subscriptionCount ) );
 
-        /* Process incoming packet from the broker. Acknowledgment for subscription
-         * ( SUBACK ) will be received here. However after sending the subscribe, the
-         * client may receive a publish before it receives a subscribe ack. Since this
-         * demo is subscribing to the topic to which no one is publishing, probability
-         * of receiving publish message before subscribe ack is zero; but application
-         * must be ready to receive any packet. This demo uses MQTT_ProcessLoop to
-         * receive packet from network. */
+        /* Process incoming packet from the broker. Acknowledgment for
+         * unsubscription ( UNSUBACK ) will be received here. */
         mqttStatus = MQTT_ProcessLoop( pMqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
 
         if( mqttStatus != MQTTSuccess )
@@ -797,6 +1182,16 @@ int32_t UnsubscribeFromTopic( const char * pTopicFilter,
             LogError( ( "MQTT_ProcessLoop returned with status = %u.",
                         mqttStatus ) );
         }
+        else if( globalUnsubAckReceived == false )
+        {
+            returnStatus = EXIT_FAILURE;
+            LogError( ( "UNSUBACK was not received within %u ms.",
+                        ( unsigned int ) MQTT_PROCESS_LOOP_TIMEOUT_MS ) );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
     }
 
     return returnStatus;
@@ -804,6 +1199,47 @@ int32_t UnsubscribeFromTopic( const char * pTopicFilter,
 
 /*-----------------------------------------------------------*/
 
+int32_t SubscribeToTopic( const char * pTopicFilter,
+                          uint16_t topicFilterLength )
+{
+    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
+
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength > 0 );
+
+    /* Start with everything at 0. */
+    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
+
+    /* This example subscribes to only one topic and uses QOS1. */
+    pSubscriptionList[ 0 ].qos = MQTTQoS1;
+    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
+    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+
+    return SubscribeToTopics( pSubscriptionList, 1U, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t UnsubscribeFromTopic( const char * pTopicFilter,
+                              uint16_t topicFilterLength )
+{
+    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
+
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength > 0 );
+
+    /* Start with everything at 0. */
+    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
+
+    pSubscriptionList[ 0 ].qos = MQTTQoS1;
+    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
+    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+
+    return UnsubscribeFromTopics( pSubscriptionList, 1U );
+}
+
+/*-----------------------------------------------------------*/
+
 int32_t PublishToTopic( const char * pTopicFilter,
                         int32_t topicFilterLength,
                         const char * pPayload,
@@ -811,46 +1247,78 @@ int32_t PublishToTopic( const char * pTopicFilter,
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t publishIndex = MAX_OUTGOING_PUBLISHES;
+    InflightStoreStatus_t storeStatus = InflightStoreSuccess;
+    InflightPublish_t * pPublish = NULL;
+    size_t attempts = 0U;
+    uint16_t packetId = 0U;
     MQTTContext_t * pMqttContext = &mqttContext;
 
     assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
-    /* Get the next free index for the outgoing publish. All QoS1 outgoing
+    /* Store the outgoing publish under a new packet id. All QoS1 outgoing
      * publishes are stored until a PUBACK is received. These messages are
      * stored for supporting a resend if a network connection is broken before
-     * receiving a PUBACK. */
-    returnStatus = getNextFreeIndexForOutgoingPublishes( &publishIndex );
-
-    if( returnStatus == EXIT_FAILURE )
+     * receiving a PUBACK. Publishes restored from an earlier run may hold
+     * packet ids that the MQTT context hands out again, so those are skipped. */
+    do
+    {
+        storeStatus = InflightStore_Allocate( &outgoingPublishes,
+                                              MQTT_GetPacketId( pMqttContext ),
+                                              &pPublish );
+        attempts++;
+    } while( ( storeStatus == InflightStoreExists ) &&
+             ( attempts <= outgoingPublishes.windowSize ) );
+
+    if( storeStatus != InflightStoreSuccess )
     {
         LogError( ( "Unable to find a free spot for outgoing PUBLISH message.\n\n" ) );
+        returnStatus = EXIT_FAILURE;
     }
     else
     {
-        LogInfo( ( "the published payload:%s \r\n ", pPayload ) );
+        LogInfo( ( "the published payload:%.*s \r\n ", ( int ) payloadLength, pPayload ) );
         /* This example publishes to only one topic and uses QOS1. */
-        outgoingPublishPackets[ publishIndex ].pubInfo.qos = MQTTQoS1;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pTopicName = pTopicFilter;
-        outgoingPublishPackets[ publishIndex ].pubInfo.topicNameLength = topicFilterLength;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pPayload = pPayload;
-        outgoingPublishPackets[ publishIndex ].pubInfo.payloadLength = payloadLength;
-
-        /* Get a new packet id. */
-        outgoingPublishPackets[ publishIndex ].packetId = MQTT_GetPacketId( pMqttContext );
+        pPublish->pubInfo.qos = MQTTQoS1;
+        pPublish->pubInfo.pTopicName = pTopicFilter;
+        pPublish->pubInfo.topicNameLength = topicFilterLength;
+        pPublish->pubInfo.pPayload = pPayload;
+        pPublish->pubInfo.payloadLength = payloadLength;
+        compressPublishPayload( pPublish );
+        TRACE_PROBE3( publish_enqueue, pPublish->packetId, pTopicFilter, payloadLength );
+
+        #ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+            /* Journal the publish before it is sent, so that it is resent after
+             * a restart if its PUBACK is lost. */
+            if( InflightJournal_RecordPublish( &outgoingPublishJournal,
+                                               pPublish ) != InflightJournalSuccess )
+            {
+                LogError( ( "Failed to journal PUBLISH packet with packet ID %u.",
+                            pPublish->packetId ) );
+                mqttStatus = MQTTNoMemory;
+            }
+        #endif /* ifdef OUTGOING_PUBLISH_JOURNAL_PATH */
 
-        /* Send PUBLISH packet. */
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &outgoingPublishPackets[ publishIndex ].pubInfo,
-                                   outgoingPublishPackets[ publishIndex ].packetId );
+        if( mqttStatus == MQTTSuccess )
+        {
+            /* Send PUBLISH packet. */
+            mqttStatus = MQTT_Publish( pMqttContext,
+                                       &pPublish->pubInfo,
+                                       pPublish->packetId );
+        }
 
         if( mqttStatus != MQTTSuccess )
         {
             LogError( ( "Failed to send PUBLISH packet to broker with error = %u.",
                         mqttStatus ) );
-            cleanupOutgoingPublishAt( publishIndex );
+            packetId = pPublish->packetId;
+            ( void ) InflightStore_Release( &outgoingPublishes, packetId );
+
+            #ifdef OUTGOING_PUBLISH_JOURNAL_PATH
+                ( void ) InflightJournal_RecordRelease( &outgoingPublishJournal,
+                                                        packetId );
+            #endif
             returnStatus = EXIT_FAILURE;
         }
         else
@@ -858,7 +1326,7 @@ int32_t PublishToTopic( const char * pTopicFilter,
             LogInfo( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.\n\n",
                        topicFilterLength,
                        pTopicFilter,
-                       outgoingPublishPackets[ publishIndex ].packetId ) );
+                       pPublish->packetId ) );
 
             /* Calling MQTT_ProcessLoop to process incoming publish echo, since
              * application subscribed to the same topic the broker will send
@@ -879,3 +1347,19 @@ int32_t PublishToTopic( const char * pTopicFilter,
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
+
+void SetPublishPayloadCodec( PayloadCodec_t * pCodec )
+{
+    pPublishPayloadCodec = pCodec;
+}
+
+/*-----------------------------------------------------------*/
+
+void GetConnectTiming( ConnectTiming_t * pConnectTiming )
+{
+    assert( pConnectTiming != NULL );
+
+    *pConnectTiming = connectTiming;
+}
+
+/*-----------------------------------------------------------*/
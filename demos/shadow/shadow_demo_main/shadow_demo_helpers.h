@@ -29,6 +29,33 @@
 /* MQTT API header. */
 #include "core_mqtt.h"
 
+/* Compression of PUBLISH payloads. */
+#include "payload_codec.h"
+
+/* Timing of the phases of a connection. */
+#include "sockets_posix.h"
+
+/**
+ * @brief Move the store of outgoing publishes waiting for a PUBACK into a
+ * caller-supplied arena, to keep more of them in flight than the default
+ * window of 5.
+ *
+ * @param[in] pArena Memory for the store, of INFLIGHT_STORE_ARENA_SIZE( windowSize )
+ * bytes, or NULL to return to the default window. It must stay valid while
+ * the store uses it.
+ * @param[in] arenaSize The size of @p pArena in bytes.
+ * @param[in] windowSize The number of publishes to keep in flight.
+ *
+ * @note This discards the stored publishes, so call it before
+ * #EstablishMqttSession.
+ *
+ * @return EXIT_SUCCESS if the store uses the arena;
+ * EXIT_FAILURE if the arena is too small or the window out of range.
+ */
+int32_t SetOutgoingPublishWindow( void * pArena,
+                                  size_t arenaSize,
+                                  size_t windowSize );
+
 /**
  * @brief Establish a MQTT connection.
  *
@@ -64,12 +91,44 @@ int32_t DisconnectMqttSession( void );
  * @param[in] topicFilterLength Indicates the length of the shadow
  * topic buffer.
  *
- * @return EXIT_SUCCESS if SUBSCRIBE was successfully sent;
+ * @return EXIT_SUCCESS if the broker accepted the subscription;
  * EXIT_FAILURE otherwise.
  */
 int32_t SubscribeToTopic( const char * pTopicFilter,
                           uint16_t topicFilterLength );
 
+/**
+ * @brief Subscribe to several MQTT topic filters with a single SUBSCRIBE, and
+ * wait for its SUBACK.
+ *
+ * Setting up a shadow session then takes one round trip instead of one per
+ * topic filter.
+ *
+ * @param[in] pSubscriptionList The topic filters and their requested QoS.
+ * @param[in] subscriptionCount Number of entries in @p pSubscriptionList.
+ * @param[out] pSubAckStatus Receives the SUBACK return code of each topic
+ * filter, in the same order, if not NULL.
+ *
+ * @return EXIT_SUCCESS if the broker accepted every topic filter;
+ * EXIT_FAILURE otherwise.
+ */
+int32_t SubscribeToTopics( const MQTTSubscribeInfo_t * pSubscriptionList,
+                           size_t subscriptionCount,
+                           MQTTSubAckStatus_t * pSubAckStatus );
+
+/**
+ * @brief Unsubscribe from several MQTT topic filters with a single
+ * UNSUBSCRIBE, and wait for its UNSUBACK.
+ *
+ * @param[in] pSubscriptionList The topic filters.
+ * @param[in] subscriptionCount Number of entries in @p pSubscriptionList.
+ *
+ * @return EXIT_SUCCESS if the UNSUBACK was received;
+ * EXIT_FAILURE otherwise.
+ */
+int32_t UnsubscribeFromTopics( const MQTTSubscribeInfo_t * pSubscriptionList,
+                               size_t subscriptionCount );
+
 /**
  * @brief Sends an MQTT UNSUBSCRIBE to unsubscribe from the shadow
  * topic.
@@ -78,7 +137,7 @@ int32_t SubscribeToTopic( const char * pTopicFilter,
  * @param[in] topicFilterLength Indicates the length of the shadow
  * topic buffer.
  *
- * @return EXIT_SUCCESS if UNSUBSCRIBE was successfully sent;
+ * @return EXIT_SUCCESS if the UNSUBACK was received;
  * EXIT_FAILURE otherwise.
  */
 int32_t UnsubscribeFromTopic( const char * pTopicFilter,
@@ -100,4 +159,29 @@ int32_t PublishToTopic( const char * pTopicFilter,
                         const char * pPayload,
                         size_t payloadLength );
 
+/**
+ * @brief Set the codec with which #PublishToTopic compresses payloads.
+ *
+ * A payload is sent compressed when that makes it shorter and its topic is
+ * not a reserved "$aws/" topic, since AWS IoT services such as the Device
+ * Shadow parse those payloads. Subscribers decompress it with
+ * #PayloadCodec_Decompress, as the subscription manager does.
+ *
+ * @param[in] pCodec The codec, or NULL to send payloads as they are. It must
+ * stay valid while it is set.
+ */
+void SetPublishPayloadCodec( PayloadCodec_t * pCodec );
+
+/**
+ * @brief Get the times at which the DNS, TCP, TLS and MQTT phases of the last
+ * attempt of #EstablishMqttSession to connect completed, to find which phase
+ * makes connecting slow.
+ *
+ * The times are from #Clock_GetTimeUs and a time of zero means the attempt
+ * did not reach that phase, so a failed attempt shows where it stopped.
+ *
+ * @param[out] pConnectTiming The output parameter to return the times in.
+ */
+void GetConnectTiming( ConnectTiming_t * pConnectTiming );
+
 #endif /* ifndef SHADOW_DEMO_HELPERS_H_ */
@@ -59,23 +59,39 @@
 /* SHADOW API header. */
 #include "shadow.h"
 
-/* JSON API header. */
-#include "core_json.h"
+/* JSON index header. */
+#include "shadow_json_index.h"
+
+/* JSON writer header. */
+#include "shadow_json_writer.h"
+
+/* Reported state coalescer header. */
+#include "shadow_update_coalescer.h"
+
+/* Shadow state cache header. */
+#include "shadow_state_cache.h"
+
+/* Shadow manager header. */
+#include "shadow_manager.h"
 
 /* Clock for timer. */
 #include "clock.h"
 
+/* Optional measurements of memory use. */
+#include "memory_stats.h"
+
 /* shadow demo helpers header. */
 #include "shadow_demo_helpers.h"
 
 
 /**
- * @brief Format string representing a Shadow document with a "desired" state.
+ * @brief Size of the buffer the update documents are written to.
  *
- * The real json document will look like this:
+ * The documents of this demo look like this, with a "desired" or a "reported"
+ * state:
  * {
  *   "state": {
- *     "desired": {
+ *     "reported": {
  *       "powerOn": 1
  *     }
  *   },
@@ -85,68 +101,52 @@
  * Note the client token, which is optional for all Shadow updates. The client
  * token must be unique at any given time, but may be reused once the update is
  * completed. For this demo, a timestamp is used for a client token.
+ *
+ * The documents are written member by member, so that this only bounds their
+ * length, and an update with more members only needs a larger buffer.
  */
-#define SHADOW_DESIRED_JSON     \
-    "{"                         \
-    "\"state\":{"               \
-    "\"desired\":{"             \
-    "\"powerOn\":%01d"          \
-    "}"                         \
-    "},"                        \
-    "\"clientToken\":\"%06lu\"" \
-    "}"
+#define SHADOW_UPDATE_DOCUMENT_BUFFER_SIZE    ( 128U )
 
 /**
- * @brief The expected size of #SHADOW_DESIRED_JSON.
- *
- * Because all the format specifiers in #SHADOW_DESIRED_JSON include a length,
- * its full actual size is known by pre-calculation, here's the formula why
- * the length need to minus 3:
- * 1. The length of "%01d" is 4.
- * 2. The length of %06lu is 5.
- * 3. The actual length we will use in case 1. is 1 ( for the state of powerOn ).
- * 4. The actual length we will use in case 2. is 6 ( for the clientToken length ).
- * 5. Thus the additional size 3 = 4 + 5 - 1 - 6 + 1 (termination character).
- *
- * In your own application, you could calculate the size of the json doc in this way.
+ * @brief How long a change to a reported field waits for other changes to be
+ * merged into the same update.
  */
-#define SHADOW_DESIRED_JSON_LENGTH    ( sizeof( SHADOW_DESIRED_JSON ) - 3 )
+#define SHADOW_REPORTED_FLUSH_WINDOW_MS       ( 200U )
 
 /**
- * @brief Format string representing a Shadow document with a "reported" state.
- *
- * The real json document will look like this:
- * {
- *   "state": {
- *     "reported": {
- *       "powerOn": 1
- *     }
- *   },
- *   "clientToken": "021909"
- * }
+ * @brief The number of changed reported fields that makes an update due
+ * before the flush window has passed.
+ */
+#define SHADOW_REPORTED_MAX_FIELDS            ( 4U )
+
+/**
+ * @brief The interval at which main checks whether the reported fields are
+ * due to be published.
+ */
+#define SHADOW_REPORTED_POLL_INTERVAL_MS      ( 20U )
+
+/**
+ * @brief The file the shadow state cache is kept in between runs.
+ */
+#ifndef SHADOW_STATE_CACHE_PATH
+    #define SHADOW_STATE_CACHE_PATH    "shadow_state_cache.txt"
+#endif
+
+/**
+ * @brief The number of keys indexed in an incoming shadow document.
  *
- * Note the client token, which is required for all Shadow updates. The client
- * token must be unique at any given time, but may be reused once the update is
- * completed. For this demo, a timestamp is used for a client token.
+ * The delta and accepted documents of this demo have fewer keys than this.
  */
-#define SHADOW_REPORTED_JSON    \
-    "{"                         \
-    "\"state\":{"               \
-    "\"reported\":{"            \
-    "\"powerOn\":%01d"          \
-    "}"                         \
-    "},"                        \
-    "\"clientToken\":\"%06lu\"" \
-    "}"
+#define SHADOW_JSON_INDEX_ENTRIES    ( 32U )
 
 /**
- * @brief The expected size of #SHADOW_REPORTED_JSON.
+ * @brief The number of things whose shadows are served over the MQTT
+ * connection.
  *
- * Because all the format specifiers in #SHADOW_REPORTED_JSON include a length,
- * its full size is known at compile-time by pre-calculation. Users could refer to
- * the way how to calculate the actual length in #SHADOW_DESIRED_JSON_LENGTH.
+ * This demo serves the shadow of #THING_NAME only, while a gateway would
+ * register each of its devices with the shadow manager.
  */
-#define SHADOW_REPORTED_JSON_LENGTH    ( sizeof( SHADOW_REPORTED_JSON ) - 3 )
+#define SHADOW_MANAGED_THINGS        ( 1U )
 
 /*-----------------------------------------------------------*/
 
@@ -167,6 +167,29 @@ static bool stateChanged = false;
  */
 static uint32_t clientToken = 0U;
 
+/**
+ * @brief The reported fields changed since the last update was published,
+ * merged so that a burst of changes costs a single update.
+ */
+static ShadowCoalescer_t reportedUpdates;
+
+/**
+ * @brief The last shadow version and state seen, used to drop stale and
+ * duplicate deltas.
+ */
+static ShadowStateCache_t shadowCache;
+
+/**
+ * @brief The things served over the MQTT connection, which routes incoming
+ * shadow messages to their callbacks.
+ */
+static ShadowManager_t shadowManager;
+
+/**
+ * @brief The memory of #shadowManager.
+ */
+static uint8_t shadowManagerArena[ SHADOW_MANAGER_ARENA_SIZE( SHADOW_MANAGED_THINGS ) ];
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -205,16 +228,87 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo );
  */
 static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo );
 
+/**
+ * @brief Process the shadow messages of a thing, as routed by the shadow
+ * manager.
+ *
+ * @param[in] pThing The thing the message is for.
+ * @param[in] messageType The type of the message.
+ * @param[in] pPublishInfo Deserialized publish info pointer for the incoming
+ * packet.
+ */
+static void thingMessageHandler( ShadowThing_t * pThing,
+                                 ShadowMessageType_t messageType,
+                                 MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Write an update document with a powerOn state and a client token.
+ *
+ * @param[in] pBuffer The buffer to write the document to, which is then
+ * published from.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in] pStateName The state to update, "desired" or "reported".
+ * @param[in] stateNameLength Length of @p pStateName.
+ * @param[in] powerOnState The powerOn state.
+ * @param[in] token The client token.
+ * @param[out] pDocumentLength Length of the document.
+ *
+ * @return EXIT_SUCCESS if the document fits in the buffer, EXIT_FAILURE otherwise.
+ */
+static int32_t buildUpdateDocument( char * pBuffer,
+                                    size_t bufferSize,
+                                    const char * pStateName,
+                                    size_t stateNameLength,
+                                    uint32_t powerOnState,
+                                    uint32_t token,
+                                    size_t * pDocumentLength );
+
+/*-----------------------------------------------------------*/
+
+static int32_t buildUpdateDocument( char * pBuffer,
+                                    size_t bufferSize,
+                                    const char * pStateName,
+                                    size_t stateNameLength,
+                                    uint32_t powerOnState,
+                                    uint32_t token,
+                                    size_t * pDocumentLength )
+{
+    int32_t returnStatus = EXIT_SUCCESS;
+    JsonWriter_t writer;
+
+    /* Each call does nothing once the document has failed, so only the
+     * status of the document as a whole is checked. */
+    JsonWriter_Init( &writer, pBuffer, bufferSize );
+    ( void ) JsonWriter_StartObject( &writer, NULL, 0U );
+    ( void ) JsonWriter_StartObject( &writer, "state", sizeof( "state" ) - 1U );
+    ( void ) JsonWriter_StartObject( &writer, pStateName, stateNameLength );
+    ( void ) JsonWriter_AddUnsigned( &writer, "powerOn", sizeof( "powerOn" ) - 1U, powerOnState );
+    ( void ) JsonWriter_EndObject( &writer );
+    ( void ) JsonWriter_EndObject( &writer );
+    ( void ) JsonWriter_AddUnsignedString( &writer, "clientToken", sizeof( "clientToken" ) - 1U, token );
+    ( void ) JsonWriter_EndObject( &writer );
+
+    if( JsonWriter_Finish( &writer, pDocumentLength ) != JsonWriterSuccess )
+    {
+        LogError( ( "The update document does not fit in %lu bytes.",
+                    ( unsigned long ) bufferSize ) );
+        returnStatus = EXIT_FAILURE;
+    }
+
+    return returnStatus;
+}
+
 /*-----------------------------------------------------------*/
 
 static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
 {
-    static uint32_t currentVersion = 0; /* Remember the latestVersion # we've ever received */
     uint32_t version = 0U;
     uint32_t newState = 0U;
-    char * outValue = NULL;
-    uint32_t outValueLength = 0U;
-    JSONStatus_t result = JSONSuccess;
+    const char * outValue = NULL;
+    size_t outValueLength = 0U;
+    JsonIndexEntry_t entries[ SHADOW_JSON_INDEX_ENTRIES ];
+    JsonIndex_t jsonIndex;
+    JsonIndexStatus_t result = JsonIndexSuccess;
 
     assert( pPublishInfo != NULL );
     assert( pPublishInfo->pPayload != NULL );
@@ -237,30 +331,34 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
      *  }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pPublishInfo->pPayload,
-                            pPublishInfo->payloadLength );
+    /* Make sure the payload is a valid json document, and index its keys in
+     * the same pass, so that each value below is found without scanning the
+     * payload again. */
+    result = JsonIndex_Build( &jsonIndex,
+                              entries,
+                              SHADOW_JSON_INDEX_ENTRIES,
+                              ( const char * ) pPublishInfo->pPayload,
+                              pPublishInfo->payloadLength );
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              '.',
-                              &outValue,
-                              ( size_t * ) &outValueLength );
+        result = JsonIndex_Get( &jsonIndex,
+                                "version",
+                                sizeof( "version" ) - 1,
+                                '.',
+                                &outValue,
+                                &outValueLength );
     }
     else
     {
         LogError( ( "The json document is invalid!!\n\n" ) );
     }
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         LogInfo( ( "version: %.*s\n\n",
-                   outValueLength,
+                   ( int ) outValueLength,
                    outValue ) );
 
         /* Convert the extracted value to an unsigned integer value. */
@@ -271,23 +369,25 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
         LogError( ( "No version in json document!!\n\n" ) );
     }
 
-    LogInfo( ( "version:%d, currentVersion:%d \r\n", version, currentVersion ) );
+    LogInfo( ( "version:%u, cached version:%u \r\n",
+               ( unsigned int ) version, ( unsigned int ) shadowCache.version ) );
 
-    /* When the version is much newer than the on we retained, that means the powerOn
-     * state is valid for us. */
-    if( version > currentVersion )
+    /* When the version is newer than the one we cached, that means the powerOn
+     * state is valid for us. Recording it makes a duplicate of this delta
+     * stale. */
+    if( result != JsonIndexSuccess )
     {
-        /* Set to received version as the current version. */
-        currentVersion = version;
-
-        /* Get powerOn state from json documents. */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "state.powerOn",
-                              sizeof( "state.powerOn" ) - 1,
-                              '.',
-                              &outValue,
-                              ( size_t * ) &outValueLength );
+        /* Empty else MISRA 15.7 */
+    }
+    else if( ShadowCache_AcceptVersion( &shadowCache, version ) == true )
+    {
+        /* Get powerOn state from the index of the json document. */
+        result = JsonIndex_Get( &jsonIndex,
+                                "state.powerOn",
+                                sizeof( "state.powerOn" ) - 1,
+                                '.',
+                                &outValue,
+                                &outValueLength );
     }
     else
     {
@@ -296,13 +396,15 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
          * that we've received before. Your application may use a
          * different approach.
          */
-        LogWarn( ( "The received version is smaller than current one!!\n\n" ) );
+        LogWarn( ( "The received version is not newer than the cached one!!\n\n" ) );
+        result = JsonIndexNotFound;
     }
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         /* Convert the powerOn state value to an unsigned integer value. */
         newState = ( uint32_t ) strtoul( outValue, NULL, 10 );
+        shadowCache.powerOn = newState;
 
         LogInfo( ( "The new power on state newState:%d, currentPowerOnState:%d \r\n",
                    newState, currentPowerOnState ) );
@@ -316,8 +418,20 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
             /* State change will be handled in main(), where we will publish a "reported"
              * state to the device shadow. We do not do it here because we are inside of
              * a callback from the MQTT library, so that we don't re-enter
-             * the MQTT library. */
-            stateChanged = true;
+             * the MQTT library. Further changes until then are merged into
+             * the same update. */
+            if( ShadowCoalescer_Set( &reportedUpdates,
+                                     "powerOn",
+                                     sizeof( "powerOn" ) - 1U,
+                                     currentPowerOnState,
+                                     Clock_GetTimeMs() ) == ShadowCoalescerSuccess )
+            {
+                stateChanged = true;
+            }
+            else
+            {
+                LogError( ( "Failed to record the powerOn state to report." ) );
+            }
         }
     }
     else
@@ -330,10 +444,13 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
 
 static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
 {
-    char * outValue = NULL;
-    uint32_t outValueLength = 0U;
+    const char * outValue = NULL;
+    size_t outValueLength = 0U;
     uint32_t receivedToken = 0U;
-    JSONStatus_t result = JSONSuccess;
+    uint32_t version = 0U;
+    JsonIndexEntry_t entries[ SHADOW_JSON_INDEX_ENTRIES ];
+    JsonIndex_t jsonIndex;
+    JsonIndexStatus_t result = JsonIndexSuccess;
 
     assert( pPublishInfo != NULL );
     assert( pPublishInfo->pPayload != NULL );
@@ -363,29 +480,47 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
      *  }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pPublishInfo->pPayload,
-                            pPublishInfo->payloadLength );
+    /* Make sure the payload is a valid json document, and index its keys. */
+    result = JsonIndex_Build( &jsonIndex,
+                              entries,
+                              SHADOW_JSON_INDEX_ENTRIES,
+                              ( const char * ) pPublishInfo->pPayload,
+                              pPublishInfo->payloadLength );
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
-        /* Get clientToken from json documents. */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "clientToken",
-                              sizeof( "clientToken" ) - 1,
-                              '.',
-                              &outValue,
-                              ( size_t * ) &outValueLength );
+        /* The accepted document has the version our update made. */
+        if( JsonIndex_Get( &jsonIndex,
+                           "version",
+                           sizeof( "version" ) - 1,
+                           '.',
+                           &outValue,
+                           &outValueLength ) == JsonIndexSuccess )
+        {
+            version = ( uint32_t ) strtoul( outValue, NULL, 10 );
+
+            if( ShadowCache_AcceptVersion( &shadowCache, version ) == true )
+            {
+                shadowCache.powerOn = currentPowerOnState;
+            }
+        }
+
+        /* Get clientToken from the index of the json document. */
+        result = JsonIndex_Get( &jsonIndex,
+                                "clientToken",
+                                sizeof( "clientToken" ) - 1,
+                                '.',
+                                &outValue,
+                                &outValueLength );
     }
     else
     {
         LogError( ( "Invalid json documents !!\n\n" ) );
     }
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
-        LogInfo( ( "clientToken: %.*s\n\n", outValueLength,
+        LogInfo( ( "clientToken: %.*s\n\n", ( int ) outValueLength,
                    outValue ) );
 
         /* Convert the code to an unsigned integer value. */
@@ -415,18 +550,54 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
 
 /*-----------------------------------------------------------*/
 
+static void thingMessageHandler( ShadowThing_t * pThing,
+                                 ShadowMessageType_t messageType,
+                                 MQTTPublishInfo_t * pPublishInfo )
+{
+    assert( pThing != NULL );
+    assert( pPublishInfo != NULL );
+
+    LogDebug( ( "Shadow message for thing %.*s.",
+                pThing->thingNameLength,
+                pThing->pThingName ) );
+
+    if( messageType == ShadowMessageTypeUpdateDelta )
+    {
+        /* Handler function to process payload. */
+        updateDeltaHandler( pPublishInfo );
+    }
+    else if( messageType == ShadowMessageTypeUpdateAccepted )
+    {
+        /* Handler function to process payload. */
+        updateAcceptedHandler( pPublishInfo );
+    }
+    else if( messageType == ShadowMessageTypeUpdateDocuments )
+    {
+        LogInfo( ( "/update/documents json payload:%s.\n\n", ( const char * ) pPublishInfo->pPayload ) );
+    }
+    else if( messageType == ShadowMessageTypeUpdateRejected )
+    {
+        LogInfo( ( "/update/rejected json payload:%s.\n\n", ( const char * ) pPublishInfo->pPayload ) );
+    }
+    else
+    {
+        LogInfo( ( "Other message type:%d !!\n\n", messageType ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 /* This is the callback function invoked by the MQTT stack when it receives
- * incoming messages. This function demonstrates how to use the Shadow_MatchTopic
- * function to determine whether the incoming message is a device shadow message
- * or not. If it is, it handles the message depending on the message type.
+ * incoming messages. This function demonstrates how to route device shadow
+ * messages to the thing they are for with the shadow manager, which uses the
+ * Shadow_MatchTopic function to determine whether the incoming message is a
+ * device shadow message and which thing it belongs to.
  */
 static void eventCallback( MQTTContext_t * pMqttContext,
                            MQTTPacketInfo_t * pPacketInfo,
                            MQTTDeserializedInfo_t * pDeserializedInfo )
 {
-    ShadowMessageType_t messageType = ShadowMessageTypeMaxNum;
-    const char * pThingName = NULL;
-    uint16_t thingNameLength = 0U;
+    ShadowManagerStatus_t managerStatus = ShadowManagerSuccess;
     uint16_t packetIdentifier;
 
     ( void ) pMqttContext;
@@ -445,40 +616,21 @@ static void eventCallback( MQTTContext_t * pMqttContext,
         assert( pDeserializedInfo->pPublishInfo != NULL );
         LogInfo( ( "pPublishInfo->pTopicName:%s.\n\n", pDeserializedInfo->pPublishInfo->pTopicName ) );
 
-        /* Let the Device Shadow library tell us whether this is a device shadow message. */
-        if( SHADOW_SUCCESS == Shadow_MatchTopic( pDeserializedInfo->pPublishInfo->pTopicName,
-                                                 pDeserializedInfo->pPublishInfo->topicNameLength,
-                                                 &messageType,
-                                                 &pThingName,
-                                                 &thingNameLength ) )
+        /* Let the shadow manager invoke the handler of the thing. */
+        managerStatus = ShadowManager_Dispatch( &shadowManager,
+                                                pDeserializedInfo->pPublishInfo );
+
+        if( managerStatus == ShadowManagerNotShadowTopic )
         {
-            /* Upon successful return, the messageType has been filled in. */
-            if( messageType == ShadowMessageTypeUpdateDelta )
-            {
-                /* Handler function to process payload. */
-                updateDeltaHandler( pDeserializedInfo->pPublishInfo );
-            }
-            else if( messageType == ShadowMessageTypeUpdateAccepted )
-            {
-                /* Handler function to process payload. */
-                updateAcceptedHandler( pDeserializedInfo->pPublishInfo );
-            }
-            else if( messageType == ShadowMessageTypeUpdateDocuments )
-            {
-                LogInfo( ( "/update/documents json payload:%s.\n\n", ( const char * ) pDeserializedInfo->pPublishInfo->pPayload ) );
-            }
-            else if( messageType == ShadowMessageTypeUpdateRejected )
-            {
-                LogInfo( ( "/update/rejected json payload:%s.\n\n", ( const char * ) pDeserializedInfo->pPublishInfo->pPayload ) );
-            }
-            else
-            {
-                LogInfo( ( "Other message type:%d !!\n\n", messageType ) );
-            }
+            LogError( ( "Shadow_MatchTopic parse failed:%s !!\n\n", ( const char * ) pDeserializedInfo->pPublishInfo->pTopicName ) );
+        }
+        else if( managerStatus == ShadowManagerNotFound )
+        {
+            LogWarn( ( "Shadow message for an unknown thing:%s.\n\n", ( const char * ) pDeserializedInfo->pPublishInfo->pTopicName ) );
         }
         else
         {
-            LogError( ( "Shadow_MatchTopic parse failed:%s !!\n\n", ( const char * ) pDeserializedInfo->pPublishInfo->pTopicName ) );
+            /* Empty else MISRA 15.7 */
         }
     }
     else
@@ -514,12 +666,60 @@ int main( int argc,
     int returnStatus = EXIT_SUCCESS;
 
     /* A buffer containing the update document. It has static duration to prevent
-     * it from being placed on the call stack. */
-    static char updateDocument[ SHADOW_REPORTED_JSON_LENGTH + 1 ] = { 0 };
+     * it from being placed on the call stack, and to stay valid while the broker
+     * has not acknowledged the PUBLISH sent from it. */
+    static char updateDocument[ SHADOW_UPDATE_DOCUMENT_BUFFER_SIZE ] = { 0 };
+    size_t updateDocumentLength = 0U;
+
+    /* The shadow topics this demo subscribes to, sent in a single SUBSCRIBE. */
+    MQTTSubscribeInfo_t shadowSubscriptions[ 3 ];
 
     ( void ) argc;
     ( void ) argv;
 
+    /* Measure memory from here when built with BUILD_MEMORY_INSTRUMENTATION,
+     * before OpenSSL allocates anything. */
+    MEMORY_STATS_INIT();
+
+    /* Restore the version and state seen in the previous run. A flow that
+     * keeps the shadow across connections would skip its full get when the
+     * cache is valid, and apply only newer deltas. */
+    if( ShadowCache_Load( &shadowCache, SHADOW_STATE_CACHE_PATH ) == ShadowCacheSuccess )
+    {
+        LogInfo( ( "Cached shadow version %u with powerOn %u; no full get is needed.",
+                   ( unsigned int ) shadowCache.version,
+                   ( unsigned int ) shadowCache.powerOn ) );
+        currentPowerOnState = shadowCache.powerOn;
+    }
+
+    ( void ) ShadowCoalescer_Init( &reportedUpdates,
+                                   SHADOW_REPORTED_FLUSH_WINDOW_MS,
+                                   SHADOW_REPORTED_MAX_FIELDS );
+
+    /* Register the thing whose shadow messages this demo handles. A gateway
+     * would register each of its devices, and subscribe to their topics over
+     * the same connection. */
+    ( void ) ShadowManager_Init( &shadowManager,
+                                 shadowManagerArena,
+                                 sizeof( shadowManagerArena ),
+                                 SHADOW_MANAGED_THINGS );
+    ( void ) ShadowManager_AddThing( &shadowManager,
+                                     THING_NAME,
+                                     THING_NAME_LENGTH,
+                                     thingMessageHandler,
+                                     NULL );
+
+    ( void ) memset( ( void * ) shadowSubscriptions, 0x00, sizeof( shadowSubscriptions ) );
+    shadowSubscriptions[ 0 ].qos = MQTTQoS1;
+    shadowSubscriptions[ 0 ].pTopicFilter = SHADOW_TOPIC_STRING_UPDATE_DELTA( THING_NAME );
+    shadowSubscriptions[ 0 ].topicFilterLength = SHADOW_TOPIC_LENGTH_UPDATE_DELTA( THING_NAME_LENGTH );
+    shadowSubscriptions[ 1 ].qos = MQTTQoS1;
+    shadowSubscriptions[ 1 ].pTopicFilter = SHADOW_TOPIC_STRING_UPDATE_ACCEPTED( THING_NAME );
+    shadowSubscriptions[ 1 ].topicFilterLength = SHADOW_TOPIC_LENGTH_UPDATE_ACCEPTED( THING_NAME_LENGTH );
+    shadowSubscriptions[ 2 ].qos = MQTTQoS1;
+    shadowSubscriptions[ 2 ].pTopicFilter = SHADOW_TOPIC_STRING_UPDATE_REJECTED( THING_NAME );
+    shadowSubscriptions[ 2 ].topicFilterLength = SHADOW_TOPIC_LENGTH_UPDATE_REJECTED( THING_NAME_LENGTH );
+
     returnStatus = EstablishMqttSession( eventCallback );
 
     if( returnStatus == EXIT_FAILURE )
@@ -535,24 +735,17 @@ int main( int argc,
                                        updateDocument,
                                        0U );
 
-        /* Successfully connect to MQTT broker, the next step is
-         * to subscribe shadow topics. */
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            returnStatus = SubscribeToTopic( SHADOW_TOPIC_STRING_UPDATE_DELTA( THING_NAME ),
-                                             SHADOW_TOPIC_LENGTH_UPDATE_DELTA( THING_NAME_LENGTH ) );
-        }
-
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            returnStatus = SubscribeToTopic( SHADOW_TOPIC_STRING_UPDATE_ACCEPTED( THING_NAME ),
-                                             SHADOW_TOPIC_LENGTH_UPDATE_ACCEPTED( THING_NAME_LENGTH ) );
-        }
+        /* Deleting the shadow restarts its versions, so the cached version
+         * would make every new delta look stale. */
+        ShadowCache_Reset( &shadowCache );
 
+        /* Successfully connect to MQTT broker, the next step is
+         * to subscribe shadow topics, all in one round trip. */
         if( returnStatus == EXIT_SUCCESS )
         {
-            returnStatus = SubscribeToTopic( SHADOW_TOPIC_STRING_UPDATE_REJECTED( THING_NAME ),
-                                             SHADOW_TOPIC_LENGTH_UPDATE_REJECTED( THING_NAME_LENGTH ) );
+            returnStatus = SubscribeToTopics( shadowSubscriptions,
+                                              sizeof( shadowSubscriptions ) / sizeof( MQTTSubscribeInfo_t ),
+                                              NULL );
         }
 
         /* This demo uses a constant #THING_NAME known at compile time therefore we can use macros to
@@ -591,20 +784,22 @@ int main( int argc,
             /* desired power on state . */
             LogInfo( ( "Send desired power state with 1.\n\n" ) );
 
-            ( void ) memset( updateDocument,
-                             0x00,
-                             sizeof( updateDocument ) );
-
-            snprintf( updateDocument,
-                      SHADOW_DESIRED_JSON_LENGTH + 1,
-                      SHADOW_DESIRED_JSON,
-                      ( int ) 1,
-                      ( long unsigned ) ( Clock_GetTimeMs() % 1000000 ) );
+            /* The document is written in the buffer it is published from. */
+            returnStatus = buildUpdateDocument( updateDocument,
+                                                sizeof( updateDocument ),
+                                                "desired",
+                                                sizeof( "desired" ) - 1U,
+                                                1U,
+                                                ( uint32_t ) ( Clock_GetTimeMs() % 1000000 ),
+                                                &updateDocumentLength );
+        }
 
+        if( returnStatus == EXIT_SUCCESS )
+        {
             returnStatus = PublishToTopic( SHADOW_TOPIC_STRING_UPDATE( THING_NAME ),
                                            SHADOW_TOPIC_LENGTH_UPDATE( THING_NAME_LENGTH ),
                                            updateDocument,
-                                           ( SHADOW_DESIRED_JSON_LENGTH + 1 ) );
+                                           updateDocumentLength );
         }
 
         if( returnStatus == EXIT_SUCCESS )
@@ -619,24 +814,38 @@ int main( int argc,
             {
                 /* Report the latest power state back to device shadow. */
                 LogInfo( ( "Report to the state change: %d\n\n", currentPowerOnState ) );
-                ( void ) memset( updateDocument,
-                                 0x00,
-                                 sizeof( updateDocument ) );
+
+                /* Give the changes made in a burst the flush window to be
+                 * merged into one update. */
+                while( ShadowCoalescer_IsFlushDue( &reportedUpdates, Clock_GetTimeMs() ) == false )
+                {
+                    Clock_SleepMs( SHADOW_REPORTED_POLL_INTERVAL_MS );
+                }
 
                 /* Keep the client token in global variable used to compare if
-                 * the same token in /update/accepted. */
+                 * the same token in /update/accepted. It correlates the
+                 * response with all the fields merged into the update. */
                 clientToken = ( Clock_GetTimeMs() % 1000000 );
 
-                snprintf( updateDocument,
-                          SHADOW_REPORTED_JSON_LENGTH + 1,
-                          SHADOW_REPORTED_JSON,
-                          ( int ) currentPowerOnState,
-                          ( long unsigned ) clientToken );
-
-                returnStatus = PublishToTopic( SHADOW_TOPIC_STRING_UPDATE( THING_NAME ),
-                                               SHADOW_TOPIC_LENGTH_UPDATE( THING_NAME_LENGTH ),
-                                               updateDocument,
-                                               ( SHADOW_DESIRED_JSON_LENGTH + 1 ) );
+                if( ShadowCoalescer_Flush( &reportedUpdates,
+                                           updateDocument,
+                                           sizeof( updateDocument ),
+                                           clientToken,
+                                           &updateDocumentLength ) != ShadowCoalescerSuccess )
+                {
+                    LogError( ( "Failed to write the reported state update." ) );
+                    returnStatus = EXIT_FAILURE;
+                }
+
+                stateChanged = false;
+
+                if( returnStatus == EXIT_SUCCESS )
+                {
+                    returnStatus = PublishToTopic( SHADOW_TOPIC_STRING_UPDATE( THING_NAME ),
+                                                   SHADOW_TOPIC_LENGTH_UPDATE( THING_NAME_LENGTH ),
+                                                   updateDocument,
+                                                   updateDocumentLength );
+                }
             }
             else
             {
@@ -644,19 +853,20 @@ int main( int argc,
             }
         }
 
-        LogInfo( ( "Start to unsubscribe shadow topics and disconnect from MQTT. \r\n" ) );
-        UnsubscribeFromTopic( SHADOW_TOPIC_STRING_UPDATE_DELTA( THING_NAME ),
-                              SHADOW_TOPIC_LENGTH_UPDATE_DELTA( THING_NAME_LENGTH ) );
-
-        UnsubscribeFromTopic( SHADOW_TOPIC_STRING_UPDATE_ACCEPTED( THING_NAME ),
-                              SHADOW_TOPIC_LENGTH_UPDATE_ACCEPTED( THING_NAME_LENGTH ) );
+        if( ShadowCache_Save( &shadowCache, SHADOW_STATE_CACHE_PATH ) != ShadowCacheSuccess )
+        {
+            LogWarn( ( "Failed to save the shadow state cache to %s.", SHADOW_STATE_CACHE_PATH ) );
+        }
 
-        UnsubscribeFromTopic( SHADOW_TOPIC_STRING_UPDATE_REJECTED( THING_NAME ),
-                              SHADOW_TOPIC_LENGTH_UPDATE_REJECTED( THING_NAME_LENGTH ) );
+        LogInfo( ( "Start to unsubscribe shadow topics and disconnect from MQTT. \r\n" ) );
+        UnsubscribeFromTopics( shadowSubscriptions,
+                               sizeof( shadowSubscriptions ) / sizeof( MQTTSubscribeInfo_t ) );
 
         DisconnectMqttSession();
     }
 
+    MEMORY_STATS_LOG( "shadow_demo_main" );
+
     return returnStatus;
 }
 
@@ -0,0 +1,640 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_json_index.c
+ * @brief Implementation of the one-pass JSON key index used by the shadow demo.
+ *
+ * The document is validated by a recursive descent parser that records each
+ * object member it passes, with the index of the member of the enclosing
+ * object. Looking up a key path then only walks the entries, whose number is
+ * much smaller than the length of the document.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <string.h>
+
+#include "shadow_json_index.h"
+
+/**
+ * @brief Marker for a value whose members are not indexed.
+ */
+#define JSON_INDEX_NOT_INDEXED    ( -2 )
+
+/**
+ * @brief State of the parser.
+ */
+typedef struct JsonParser
+{
+    const char * pJson;  /**< @brief The document. */
+    size_t length;       /**< @brief Length of the document. */
+    size_t offset;       /**< @brief Offset of the next character to parse. */
+    JsonIndex_t * pIndex; /**< @brief The index being built. */
+    bool full;           /**< @brief Set once a key did not fit in the index. */
+} JsonParser_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Skip whitespace.
+ *
+ * @param[in] pParser The parser.
+ */
+static void skipSpace( JsonParser_t * pParser );
+
+/**
+ * @brief Parse a string, with the parser at its opening quote.
+ *
+ * @param[in] pParser The parser.
+ *
+ * @return true if the string is valid.
+ */
+static bool parseString( JsonParser_t * pParser );
+
+/**
+ * @brief Parse a number.
+ *
+ * @param[in] pParser The parser.
+ *
+ * @return true if the number is valid.
+ */
+static bool parseNumber( JsonParser_t * pParser );
+
+/**
+ * @brief Parse one of the literals true, false and null.
+ *
+ * @param[in] pParser The parser.
+ *
+ * @return true if a literal was parsed.
+ */
+static bool parseLiteral( JsonParser_t * pParser );
+
+/**
+ * @brief Parse an object, with the parser at its opening brace.
+ *
+ * @param[in] pParser The parser.
+ * @param[in] parent Index of the entry of the object, #JSON_INDEX_ROOT, or
+ * #JSON_INDEX_NOT_INDEXED.
+ * @param[in] depth Nesting depth of the object.
+ *
+ * @return true if the object is valid.
+ */
+static bool parseObject( JsonParser_t * pParser,
+                         int32_t parent,
+                         size_t depth );
+
+/**
+ * @brief Parse an array, with the parser at its opening bracket.
+ *
+ * @param[in] pParser The parser.
+ * @param[in] depth Nesting depth of the array.
+ *
+ * @return true if the array is valid.
+ */
+static bool parseArray( JsonParser_t * pParser,
+                        size_t depth );
+
+/**
+ * @brief Parse any value, and record its extent in an entry.
+ *
+ * @param[in] pParser The parser.
+ * @param[in] entry Index of the entry of the value, #JSON_INDEX_ROOT, or
+ * #JSON_INDEX_NOT_INDEXED.
+ * @param[in] depth Nesting depth of the value.
+ *
+ * @return true if the value is valid.
+ */
+static bool parseValue( JsonParser_t * pParser,
+                        int32_t entry,
+                        size_t depth );
+
+/*-----------------------------------------------------------*/
+
+static void skipSpace( JsonParser_t * pParser )
+{
+    char c;
+
+    while( pParser->offset < pParser->length )
+    {
+        c = pParser->pJson[ pParser->offset ];
+
+        if( ( c != ' ' ) && ( c != '\t' ) && ( c != '\n' ) && ( c != '\r' ) )
+        {
+            break;
+        }
+
+        pParser->offset++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseString( JsonParser_t * pParser )
+{
+    bool valid = false;
+    size_t i = 0U;
+    char c;
+
+    /* Skip the opening quote. */
+    pParser->offset++;
+
+    while( pParser->offset < pParser->length )
+    {
+        c = pParser->pJson[ pParser->offset ];
+        pParser->offset++;
+
+        if( c == '"' )
+        {
+            valid = true;
+            break;
+        }
+        else if( ( ( uint8_t ) c ) < 0x20U )
+        {
+            /* Control characters must be escaped. */
+            break;
+        }
+        else if( c == '\\' )
+        {
+            if( pParser->offset >= pParser->length )
+            {
+                break;
+            }
+
+            c = pParser->pJson[ pParser->offset ];
+            pParser->offset++;
+
+            if( c == 'u' )
+            {
+                for( i = 0U; ( i < 4U ) && ( pParser->offset < pParser->length ); i++ )
+                {
+                    c = pParser->pJson[ pParser->offset ];
+
+                    if( !( ( ( c >= '0' ) && ( c <= '9' ) ) ||
+                           ( ( c >= 'a' ) && ( c <= 'f' ) ) ||
+                           ( ( c >= 'A' ) && ( c <= 'F' ) ) ) )
+                    {
+                        break;
+                    }
+
+                    pParser->offset++;
+                }
+
+                if( i < 4U )
+                {
+                    break;
+                }
+            }
+            else if( strchr( "\"\\/bfnrt", c ) == NULL )
+            {
+                break;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseNumber( JsonParser_t * pParser )
+{
+    bool valid = true;
+    size_t digits = 0U;
+    const char * pJson = pParser->pJson;
+
+    if( ( pParser->offset < pParser->length ) && ( pJson[ pParser->offset ] == '-' ) )
+    {
+        pParser->offset++;
+    }
+
+    /* The integer part has no leading zeros. */
+    if( ( pParser->offset < pParser->length ) && ( pJson[ pParser->offset ] == '0' ) )
+    {
+        pParser->offset++;
+    }
+    else
+    {
+        for( digits = 0U; ( pParser->offset < pParser->length ) &&
+             ( pJson[ pParser->offset ] >= '0' ) && ( pJson[ pParser->offset ] <= '9' ); digits++ )
+        {
+            pParser->offset++;
+        }
+
+        valid = ( digits > 0U );
+    }
+
+    if( ( valid == true ) && ( pParser->offset < pParser->length ) && ( pJson[ pParser->offset ] == '.' ) )
+    {
+        pParser->offset++;
+
+        for( digits = 0U; ( pParser->offset < pParser->length ) &&
+             ( pJson[ pParser->offset ] >= '0' ) && ( pJson[ pParser->offset ] <= '9' ); digits++ )
+        {
+            pParser->offset++;
+        }
+
+        valid = ( digits > 0U );
+    }
+
+    if( ( valid == true ) && ( pParser->offset < pParser->length ) &&
+        ( ( pJson[ pParser->offset ] == 'e' ) || ( pJson[ pParser->offset ] == 'E' ) ) )
+    {
+        pParser->offset++;
+
+        if( ( pParser->offset < pParser->length ) &&
+            ( ( pJson[ pParser->offset ] == '+' ) || ( pJson[ pParser->offset ] == '-' ) ) )
+        {
+            pParser->offset++;
+        }
+
+        for( digits = 0U; ( pParser->offset < pParser->length ) &&
+             ( pJson[ pParser->offset ] >= '0' ) && ( pJson[ pParser->offset ] <= '9' ); digits++ )
+        {
+            pParser->offset++;
+        }
+
+        valid = ( digits > 0U );
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseLiteral( JsonParser_t * pParser )
+{
+    static const char * const literals[] = { "true", "false", "null" };
+    bool valid = false;
+    size_t i = 0U, literalLength = 0U;
+
+    for( i = 0U; i < ( sizeof( literals ) / sizeof( literals[ 0 ] ) ); i++ )
+    {
+        literalLength = strlen( literals[ i ] );
+
+        if( ( ( pParser->length - pParser->offset ) >= literalLength ) &&
+            ( memcmp( &pParser->pJson[ pParser->offset ], literals[ i ], literalLength ) == 0 ) )
+        {
+            pParser->offset += literalLength;
+            valid = true;
+            break;
+        }
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseObject( JsonParser_t * pParser,
+                         int32_t parent,
+                         size_t depth )
+{
+    bool valid = true;
+    JsonIndex_t * pIndex = pParser->pIndex;
+    JsonIndexEntry_t * pEntry = NULL;
+    int32_t entry = JSON_INDEX_NOT_INDEXED;
+    size_t keyStart = 0U, keyLength = 0U;
+
+    /* Skip the opening brace. */
+    pParser->offset++;
+    skipSpace( pParser );
+
+    if( ( pParser->offset < pParser->length ) && ( pParser->pJson[ pParser->offset ] == '}' ) )
+    {
+        pParser->offset++;
+    }
+    else
+    {
+        while( valid == true )
+        {
+            skipSpace( pParser );
+            keyStart = pParser->offset + 1U;
+
+            valid = ( pParser->offset < pParser->length ) &&
+                    ( pParser->pJson[ pParser->offset ] == '"' ) &&
+                    parseString( pParser );
+
+            if( valid == true )
+            {
+                /* The key excludes its quotes. */
+                keyLength = pParser->offset - keyStart - 1U;
+                skipSpace( pParser );
+                valid = ( pParser->offset < pParser->length ) && ( pParser->pJson[ pParser->offset ] == ':' );
+            }
+
+            if( valid == true )
+            {
+                pParser->offset++;
+                entry = JSON_INDEX_NOT_INDEXED;
+
+                /* Once a key does not fit, stop indexing so that no member is
+                 * recorded under the wrong parent. */
+                if( ( parent == JSON_INDEX_NOT_INDEXED ) || ( pParser->full == true ) )
+                {
+                    /* Not indexed. */
+                }
+                else if( pIndex->entryCount == pIndex->maxEntries )
+                {
+                    pParser->full = true;
+                }
+                else
+                {
+                    entry = ( int32_t ) pIndex->entryCount;
+                    pIndex->entryCount++;
+
+                    pEntry = &pIndex->pEntries[ entry ];
+                    pEntry->pKey = &pParser->pJson[ keyStart ];
+                    pEntry->keyLength = keyLength;
+                    pEntry->parent = parent;
+                }
+
+                valid = parseValue( pParser, entry, depth + 1U );
+            }
+
+            if( valid == true )
+            {
+                skipSpace( pParser );
+
+                if( ( pParser->offset < pParser->length ) && ( pParser->pJson[ pParser->offset ] == ',' ) )
+                {
+                    pParser->offset++;
+                }
+                else if( ( pParser->offset < pParser->length ) && ( pParser->pJson[ pParser->offset ] == '}' ) )
+                {
+                    pParser->offset++;
+                    break;
+                }
+                else
+                {
+                    valid = false;
+                }
+            }
+        }
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseArray( JsonParser_t * pParser,
+                        size_t depth )
+{
+    bool valid = true;
+
+    /* Skip the opening bracket. */
+    pParser->offset++;
+    skipSpace( pParser );
+
+    if( ( pParser->offset < pParser->length ) && ( pParser->pJson[ pParser->offset ] == ']' ) )
+    {
+        pParser->offset++;
+    }
+    else
+    {
+        while( valid == true )
+        {
+            valid = parseValue( pParser, JSON_INDEX_NOT_INDEXED, depth + 1U );
+
+            if( valid == true )
+            {
+                skipSpace( pParser );
+
+                if( ( pParser->offset < pParser->length ) && ( pParser->pJson[ pParser->offset ] == ',' ) )
+                {
+                    pParser->offset++;
+                }
+                else if( ( pParser->offset < pParser->length ) && ( pParser->pJson[ pParser->offset ] == ']' ) )
+                {
+                    pParser->offset++;
+                    break;
+                }
+                else
+                {
+                    valid = false;
+                }
+            }
+        }
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseValue( JsonParser_t * pParser,
+                        int32_t entry,
+                        size_t depth )
+{
+    bool valid = false;
+    size_t start = 0U;
+    char c;
+
+    skipSpace( pParser );
+    start = pParser->offset;
+
+    if( ( pParser->offset < pParser->length ) && ( depth <= JSON_INDEX_MAX_DEPTH ) )
+    {
+        c = pParser->pJson[ pParser->offset ];
+
+        if( c == '{' )
+        {
+            valid = parseObject( pParser, entry, depth );
+        }
+        else if( c == '[' )
+        {
+            valid = parseArray( pParser, depth );
+        }
+        else if( c == '"' )
+        {
+            valid = parseString( pParser );
+        }
+        else if( ( c == '-' ) || ( ( c >= '0' ) && ( c <= '9' ) ) )
+        {
+            valid = parseNumber( pParser );
+        }
+        else
+        {
+            valid = parseLiteral( pParser );
+        }
+    }
+
+    if( ( valid == true ) && ( entry >= 0 ) )
+    {
+        /* Like JSON_Search, strings are returned without their quotes. */
+        if( pParser->pJson[ start ] == '"' )
+        {
+            pParser->pIndex->pEntries[ entry ].pValue = &pParser->pJson[ start + 1U ];
+            pParser->pIndex->pEntries[ entry ].valueLength = pParser->offset - start - 2U;
+        }
+        else
+        {
+            pParser->pIndex->pEntries[ entry ].pValue = &pParser->pJson[ start ];
+            pParser->pIndex->pEntries[ entry ].valueLength = pParser->offset - start;
+        }
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+JsonIndexStatus_t JsonIndex_Build( JsonIndex_t * pIndex,
+                                   JsonIndexEntry_t * pEntries,
+                                   size_t maxEntries,
+                                   const char * pJson,
+                                   size_t jsonLength )
+{
+    JsonIndexStatus_t status = JsonIndexSuccess;
+    JsonParser_t parser;
+
+    if( ( pIndex == NULL ) || ( pEntries == NULL ) || ( maxEntries == 0U ) ||
+        ( pJson == NULL ) || ( jsonLength == 0U ) )
+    {
+        status = JsonIndexBadParameter;
+    }
+    else
+    {
+        pIndex->pEntries = pEntries;
+        pIndex->maxEntries = maxEntries;
+        pIndex->entryCount = 0U;
+
+        parser.pJson = pJson;
+        parser.length = jsonLength;
+        parser.offset = 0U;
+        parser.pIndex = pIndex;
+        parser.full = false;
+
+        if( parseValue( &parser, JSON_INDEX_ROOT, 0U ) == true )
+        {
+            skipSpace( &parser );
+        }
+        else
+        {
+            status = JsonIndexIllegalDocument;
+        }
+
+        if( status != JsonIndexSuccess )
+        {
+            /* Empty else MISRA 15.7 */
+        }
+        else if( parser.offset != parser.length )
+        {
+            /* Only whitespace may follow the document. */
+            status = JsonIndexIllegalDocument;
+        }
+        else if( parser.full == true )
+        {
+            status = JsonIndexFull;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        if( status == JsonIndexIllegalDocument )
+        {
+            pIndex->entryCount = 0U;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+JsonIndexStatus_t JsonIndex_Get( const JsonIndex_t * pIndex,
+                                 const char * pQuery,
+                                 size_t queryLength,
+                                 char separator,
+                                 const char ** pValue,
+                                 size_t * pValueLength )
+{
+    JsonIndexStatus_t status = JsonIndexSuccess;
+    int32_t parent = JSON_INDEX_ROOT;
+    size_t entry = 0U, keyStart = 0U, keyEnd = 0U;
+    const JsonIndexEntry_t * pEntry = NULL;
+
+    if( ( pIndex == NULL ) || ( pQuery == NULL ) || ( queryLength == 0U ) ||
+        ( pValue == NULL ) || ( pValueLength == NULL ) )
+    {
+        status = JsonIndexBadParameter;
+    }
+
+    /* Find each key of the path among the members of the previous one. The
+     * members of an object always follow its own entry. */
+    while( ( status == JsonIndexSuccess ) && ( keyStart < queryLength ) )
+    {
+        keyEnd = keyStart;
+
+        while( ( keyEnd < queryLength ) && ( pQuery[ keyEnd ] != separator ) )
+        {
+            keyEnd++;
+        }
+
+        status = JsonIndexNotFound;
+
+        for( entry = ( size_t ) ( parent + 1 ); entry < pIndex->entryCount; entry++ )
+        {
+            pEntry = &pIndex->pEntries[ entry ];
+
+            if( ( pEntry->parent == parent ) &&
+                ( pEntry->keyLength == ( keyEnd - keyStart ) ) &&
+                ( memcmp( pEntry->pKey, &pQuery[ keyStart ], pEntry->keyLength ) == 0 ) )
+            {
+                parent = ( int32_t ) entry;
+                status = JsonIndexSuccess;
+                break;
+            }
+        }
+
+        keyStart = keyEnd + 1U;
+    }
+
+    if( ( status == JsonIndexSuccess ) && ( parent != JSON_INDEX_ROOT ) )
+    {
+        *pValue = pIndex->pEntries[ parent ].pValue;
+        *pValueLength = pIndex->pEntries[ parent ].valueLength;
+    }
+    else if( status == JsonIndexSuccess )
+    {
+        /* The path was empty, for instance a lone separator. */
+        status = JsonIndexNotFound;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,130 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_json_index.h
+ * @brief A one-pass index of the keys of a JSON document, so that several
+ * values can be looked up without scanning the document again for each one.
+ */
+
+#ifndef SHADOW_JSON_INDEX_H_
+#define SHADOW_JSON_INDEX_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Parent index of the members of the top-level object.
+ */
+#define JSON_INDEX_ROOT         ( -1 )
+
+/**
+ * @brief Maximum nesting depth of objects and arrays accepted by
+ * #JsonIndex_Build.
+ */
+#ifndef JSON_INDEX_MAX_DEPTH
+    #define JSON_INDEX_MAX_DEPTH    ( 32 )
+#endif
+
+/**
+ * @brief Return codes from the JSON index functions.
+ */
+typedef enum JsonIndexStatus
+{
+    JsonIndexSuccess,         /**< @brief The function completed successfully. */
+    JsonIndexBadParameter,    /**< @brief A parameter was NULL or empty. */
+    JsonIndexIllegalDocument, /**< @brief The document is not valid JSON. */
+    JsonIndexFull,            /**< @brief The document has more keys than the index has entries. */
+    JsonIndexNotFound         /**< @brief The key path is not in the document. */
+} JsonIndexStatus_t;
+
+/**
+ * @brief One member of an object in the document.
+ */
+typedef struct JsonIndexEntry
+{
+    const char * pKey;   /**< @brief The key, without quotes. */
+    size_t keyLength;    /**< @brief Length of the key. */
+    const char * pValue; /**< @brief The value; strings exclude their quotes. */
+    size_t valueLength;  /**< @brief Length of the value. */
+    int32_t parent;      /**< @brief Index of the entry of the enclosing object, or #JSON_INDEX_ROOT. */
+} JsonIndexEntry_t;
+
+/**
+ * @brief The index of a document, in document order.
+ */
+typedef struct JsonIndex
+{
+    JsonIndexEntry_t * pEntries; /**< @brief The entries. */
+    size_t maxEntries;           /**< @brief Number of entries available. */
+    size_t entryCount;           /**< @brief Number of entries in use. */
+} JsonIndex_t;
+
+/**
+ * @brief Validate a JSON document and index the members of its objects in a
+ * single pass.
+ *
+ * Members of objects nested in arrays are validated but not indexed. The
+ * index points into @p pJson, which must stay unchanged while it is used.
+ *
+ * @param[out] pIndex The index to build.
+ * @param[in] pEntries Storage for the entries.
+ * @param[in] maxEntries Number of entries in @p pEntries.
+ * @param[in] pJson The document.
+ * @param[in] jsonLength Length of the document.
+ *
+ * @return #JsonIndexSuccess if the document is valid and fully indexed;
+ * #JsonIndexFull if it is valid but has more keys than @p maxEntries;
+ * #JsonIndexIllegalDocument if it is not valid JSON;
+ * #JsonIndexBadParameter if a parameter is NULL or empty.
+ */
+JsonIndexStatus_t JsonIndex_Build( JsonIndex_t * pIndex,
+                                   JsonIndexEntry_t * pEntries,
+                                   size_t maxEntries,
+                                   const char * pJson,
+                                   size_t jsonLength );
+
+/**
+ * @brief Find the value of a key path, such as "state.powerOn", in an index.
+ *
+ * This only looks at the index, not the document.
+ *
+ * @param[in] pIndex An index built by #JsonIndex_Build.
+ * @param[in] pQuery The key path.
+ * @param[in] queryLength Length of the key path.
+ * @param[in] separator The character separating keys in @p pQuery.
+ * @param[out] pValue The value; strings exclude their quotes.
+ * @param[out] pValueLength Length of the value.
+ *
+ * @return #JsonIndexSuccess if the key path was found;
+ * #JsonIndexNotFound if it was not;
+ * #JsonIndexBadParameter if a parameter is NULL or empty.
+ */
+JsonIndexStatus_t JsonIndex_Get( const JsonIndex_t * pIndex,
+                                 const char * pQuery,
+                                 size_t queryLength,
+                                 char separator,
+                                 const char ** pValue,
+                                 size_t * pValueLength );
+
+#endif /* ifndef SHADOW_JSON_INDEX_H_ */
@@ -0,0 +1,407 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_json_writer.c
+ * @brief Implementation of the streaming JSON writer used by the shadow demo.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "shadow_json_writer.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append characters to the document, or record that they do not fit.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pData The characters.
+ * @param[in] length The number of characters.
+ */
+static void appendData( JsonWriter_t * pWriter,
+                        const char * pData,
+                        size_t length );
+
+/**
+ * @brief Append a string and its quotes to the document, escaping the
+ * characters JSON does not allow in a string.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pString The string.
+ * @param[in] length Length of @p pString.
+ */
+static void appendString( JsonWriter_t * pWriter,
+                          const char * pString,
+                          size_t length );
+
+/**
+ * @brief Append the separator and key that start a member.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pKey The key, or NULL for the top-level object.
+ * @param[in] keyLength Length of @p pKey.
+ */
+static void startMember( JsonWriter_t * pWriter,
+                         const char * pKey,
+                         size_t keyLength );
+
+/**
+ * @brief Add an unsigned number member, written as a number or a string.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pKey The key of the member.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[in] value The number.
+ * @param[in] quoted Whether to write the number as a string.
+ *
+ * @return #JsonWriterSuccess, or the first error of the document.
+ */
+static JsonWriterStatus_t addUnsigned( JsonWriter_t * pWriter,
+                                       const char * pKey,
+                                       size_t keyLength,
+                                       uint32_t value,
+                                       bool quoted );
+
+/*-----------------------------------------------------------*/
+
+static void appendData( JsonWriter_t * pWriter,
+                        const char * pData,
+                        size_t length )
+{
+    if( pWriter->status != JsonWriterSuccess )
+    {
+        /* Empty else MISRA 15.7 */
+    }
+    else if( ( pWriter->bufferSize - pWriter->length ) < length )
+    {
+        pWriter->status = JsonWriterBufferTooSmall;
+    }
+    else
+    {
+        ( void ) memcpy( &pWriter->pBuffer[ pWriter->length ], pData, length );
+        pWriter->length += length;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void appendString( JsonWriter_t * pWriter,
+                          const char * pString,
+                          size_t length )
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    char escape[ 6 ] = { '\\', 'u', '0', '0', '0', '0' };
+    size_t i = 0U, start = 0U, escapeLength = 0U;
+    uint8_t c = 0U;
+
+    appendData( pWriter, "\"", 1U );
+
+    /* Copy runs of characters that need no escaping in one go. */
+    for( i = 0U; i < length; i++ )
+    {
+        c = ( uint8_t ) pString[ i ];
+        escapeLength = 2U;
+
+        if( ( c == ( uint8_t ) '"' ) || ( c == ( uint8_t ) '\\' ) )
+        {
+            escape[ 1 ] = ( char ) c;
+        }
+        else if( c == ( uint8_t ) '\n' )
+        {
+            escape[ 1 ] = 'n';
+        }
+        else if( c == ( uint8_t ) '\r' )
+        {
+            escape[ 1 ] = 'r';
+        }
+        else if( c == ( uint8_t ) '\t' )
+        {
+            escape[ 1 ] = 't';
+        }
+        else if( c < 0x20U )
+        {
+            escape[ 1 ] = 'u';
+            escape[ 4 ] = hexDigits[ c >> 4 ];
+            escape[ 5 ] = hexDigits[ c & 0x0FU ];
+            escapeLength = sizeof( escape );
+        }
+        else
+        {
+            escapeLength = 0U;
+        }
+
+        if( escapeLength > 0U )
+        {
+            appendData( pWriter, &pString[ start ], i - start );
+            appendData( pWriter, escape, escapeLength );
+            start = i + 1U;
+        }
+    }
+
+    appendData( pWriter, &pString[ start ], length - start );
+    appendData( pWriter, "\"", 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void startMember( JsonWriter_t * pWriter,
+                         const char * pKey,
+                         size_t keyLength )
+{
+    if( pWriter->status != JsonWriterSuccess )
+    {
+        /* Empty else MISRA 15.7 */
+    }
+    else if( pWriter->complete == true )
+    {
+        pWriter->status = JsonWriterBadNesting;
+    }
+    else if( pWriter->depth == 0U )
+    {
+        /* Only the top-level object may, and must, have no key. */
+        if( ( pKey != NULL ) || ( pWriter->length > 0U ) )
+        {
+            pWriter->status = ( pKey != NULL ) ? JsonWriterBadParameter : JsonWriterBadNesting;
+        }
+    }
+    else if( pKey == NULL )
+    {
+        pWriter->status = JsonWriterBadParameter;
+    }
+    else
+    {
+        if( ( pWriter->hasMembers & ( 1UL << pWriter->depth ) ) != 0U )
+        {
+            appendData( pWriter, ",", 1U );
+        }
+
+        pWriter->hasMembers |= ( uint32_t ) ( 1UL << pWriter->depth );
+        appendString( pWriter, pKey, keyLength );
+        appendData( pWriter, ":", 1U );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void JsonWriter_Init( JsonWriter_t * pWriter,
+                      char * pBuffer,
+                      size_t bufferSize )
+{
+    if( pWriter != NULL )
+    {
+        pWriter->pBuffer = pBuffer;
+        pWriter->bufferSize = ( pBuffer != NULL ) ? bufferSize : 0U;
+        pWriter->length = 0U;
+        pWriter->depth = 0U;
+        pWriter->hasMembers = 0U;
+        pWriter->complete = false;
+        pWriter->status = ( pBuffer != NULL ) ? JsonWriterSuccess : JsonWriterBadParameter;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+JsonWriterStatus_t JsonWriter_StartObject( JsonWriter_t * pWriter,
+                                           const char * pKey,
+                                           size_t keyLength )
+{
+    JsonWriterStatus_t status = JsonWriterBadParameter;
+
+    if( pWriter != NULL )
+    {
+        startMember( pWriter, pKey, keyLength );
+
+        if( ( pWriter->status == JsonWriterSuccess ) && ( pWriter->depth == JSON_WRITER_MAX_DEPTH ) )
+        {
+            pWriter->status = JsonWriterBadNesting;
+        }
+
+        appendData( pWriter, "{", 1U );
+
+        if( pWriter->status == JsonWriterSuccess )
+        {
+            pWriter->depth++;
+            pWriter->hasMembers &= ~( uint32_t ) ( 1UL << pWriter->depth );
+        }
+
+        status = pWriter->status;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+JsonWriterStatus_t JsonWriter_EndObject( JsonWriter_t * pWriter )
+{
+    JsonWriterStatus_t status = JsonWriterBadParameter;
+
+    if( pWriter != NULL )
+    {
+        if( ( pWriter->status == JsonWriterSuccess ) && ( pWriter->depth == 0U ) )
+        {
+            pWriter->status = JsonWriterBadNesting;
+        }
+
+        appendData( pWriter, "}", 1U );
+
+        if( pWriter->status == JsonWriterSuccess )
+        {
+            pWriter->depth--;
+            pWriter->complete = ( pWriter->depth == 0U );
+        }
+
+        status = pWriter->status;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+JsonWriterStatus_t JsonWriter_AddString( JsonWriter_t * pWriter,
+                                         const char * pKey,
+                                         size_t keyLength,
+                                         const char * pValue,
+                                         size_t valueLength )
+{
+    JsonWriterStatus_t status = JsonWriterBadParameter;
+
+    if( pWriter != NULL )
+    {
+        if( ( pWriter->status == JsonWriterSuccess ) && ( ( pKey == NULL ) || ( pValue == NULL ) ) )
+        {
+            pWriter->status = JsonWriterBadParameter;
+        }
+
+        startMember( pWriter, pKey, keyLength );
+
+        if( pWriter->status == JsonWriterSuccess )
+        {
+            appendString( pWriter, pValue, valueLength );
+        }
+
+        status = pWriter->status;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static JsonWriterStatus_t addUnsigned( JsonWriter_t * pWriter,
+                                       const char * pKey,
+                                       size_t keyLength,
+                                       uint32_t value,
+                                       bool quoted )
+{
+    JsonWriterStatus_t status = JsonWriterBadParameter;
+    /* Enough for the 10 digits of UINT32_MAX and the quotes. */
+    char digits[ 12 ];
+    size_t start = sizeof( digits );
+    uint32_t remaining = value;
+
+    if( pWriter != NULL )
+    {
+        if( ( pWriter->status == JsonWriterSuccess ) && ( pKey == NULL ) )
+        {
+            pWriter->status = JsonWriterBadParameter;
+        }
+
+        startMember( pWriter, pKey, keyLength );
+
+        if( quoted == true )
+        {
+            start--;
+            digits[ start ] = '"';
+        }
+
+        /* Write the digits from the last one. */
+        do
+        {
+            start--;
+            digits[ start ] = ( char ) ( '0' + ( remaining % 10U ) );
+            remaining /= 10U;
+        } while( remaining > 0U );
+
+        if( quoted == true )
+        {
+            start--;
+            digits[ start ] = '"';
+        }
+
+        appendData( pWriter, &digits[ start ], sizeof( digits ) - start );
+
+        status = pWriter->status;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+JsonWriterStatus_t JsonWriter_AddUnsigned( JsonWriter_t * pWriter,
+                                           const char * pKey,
+                                           size_t keyLength,
+                                           uint32_t value )
+{
+    return addUnsigned( pWriter, pKey, keyLength, value, false );
+}
+
+/*-----------------------------------------------------------*/
+
+JsonWriterStatus_t JsonWriter_AddUnsignedString( JsonWriter_t * pWriter,
+                                                 const char * pKey,
+                                                 size_t keyLength,
+                                                 uint32_t value )
+{
+    return addUnsigned( pWriter, pKey, keyLength, value, true );
+}
+
+/*-----------------------------------------------------------*/
+
+JsonWriterStatus_t JsonWriter_Finish( const JsonWriter_t * pWriter,
+                                      size_t * pLength )
+{
+    JsonWriterStatus_t status = JsonWriterBadParameter;
+
+    if( ( pWriter != NULL ) && ( pLength != NULL ) )
+    {
+        status = pWriter->status;
+
+        if( ( status == JsonWriterSuccess ) && ( pWriter->complete == false ) )
+        {
+            status = JsonWriterBadNesting;
+        }
+
+        if( status == JsonWriterSuccess )
+        {
+            *pLength = pWriter->length;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,165 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_json_writer.h
+ * @brief A streaming writer of JSON documents, used to build shadow update
+ * documents directly in the buffer they are published from.
+ */
+
+#ifndef SHADOW_JSON_WRITER_H_
+#define SHADOW_JSON_WRITER_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum nesting depth of the objects written by a #JsonWriter_t.
+ */
+#define JSON_WRITER_MAX_DEPTH    ( 31U )
+
+/**
+ * @brief Return codes from the JSON writer functions.
+ */
+typedef enum JsonWriterStatus
+{
+    JsonWriterSuccess,        /**< @brief The function completed successfully. */
+    JsonWriterBadParameter,   /**< @brief A parameter was NULL, or a key was missing or unexpected. */
+    JsonWriterBufferTooSmall, /**< @brief The document does not fit in the buffer. */
+    JsonWriterBadNesting      /**< @brief Objects were not started and ended in pairs. */
+} JsonWriterStatus_t;
+
+/**
+ * @brief State of a document being written.
+ *
+ * The first error is kept: the functions called after it do nothing and
+ * return it again, so a document can be written without checking each call.
+ */
+typedef struct JsonWriter
+{
+    char * pBuffer;            /**< @brief The buffer the document is written to. */
+    size_t bufferSize;         /**< @brief Size of the buffer. */
+    size_t length;             /**< @brief Length of the document written so far. */
+    uint32_t depth;            /**< @brief Number of objects started and not ended. */
+    uint32_t hasMembers;       /**< @brief Bit N is set once the object at depth N has a member. */
+    bool complete;             /**< @brief Set once the top-level object has ended. */
+    JsonWriterStatus_t status; /**< @brief The first error, or #JsonWriterSuccess. */
+} JsonWriter_t;
+
+/**
+ * @brief Start writing a document into a buffer.
+ *
+ * @param[out] pWriter The writer.
+ * @param[in] pBuffer The buffer to write to. It is not NUL-terminated.
+ * @param[in] bufferSize Size of @p pBuffer.
+ */
+void JsonWriter_Init( JsonWriter_t * pWriter,
+                      char * pBuffer,
+                      size_t bufferSize );
+
+/**
+ * @brief Start an object.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pKey The key of the object in the enclosing object, or NULL for the
+ * top-level object.
+ * @param[in] keyLength Length of @p pKey.
+ *
+ * @return #JsonWriterSuccess, or the first error of the document.
+ */
+JsonWriterStatus_t JsonWriter_StartObject( JsonWriter_t * pWriter,
+                                           const char * pKey,
+                                           size_t keyLength );
+
+/**
+ * @brief End the last object started.
+ *
+ * @param[in] pWriter The writer.
+ *
+ * @return #JsonWriterSuccess, or the first error of the document.
+ */
+JsonWriterStatus_t JsonWriter_EndObject( JsonWriter_t * pWriter );
+
+/**
+ * @brief Add a string member to the current object, escaping the string.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pKey The key of the member.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[in] pValue The string, which may contain any character.
+ * @param[in] valueLength Length of @p pValue.
+ *
+ * @return #JsonWriterSuccess, or the first error of the document.
+ */
+JsonWriterStatus_t JsonWriter_AddString( JsonWriter_t * pWriter,
+                                         const char * pKey,
+                                         size_t keyLength,
+                                         const char * pValue,
+                                         size_t valueLength );
+
+/**
+ * @brief Add an unsigned number member to the current object.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pKey The key of the member.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[in] value The number.
+ *
+ * @return #JsonWriterSuccess, or the first error of the document.
+ */
+JsonWriterStatus_t JsonWriter_AddUnsigned( JsonWriter_t * pWriter,
+                                           const char * pKey,
+                                           size_t keyLength,
+                                           uint32_t value );
+
+/**
+ * @brief Add a member whose value is an unsigned number written as a string,
+ * such as a client token.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pKey The key of the member.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[in] value The number.
+ *
+ * @return #JsonWriterSuccess, or the first error of the document.
+ */
+JsonWriterStatus_t JsonWriter_AddUnsignedString( JsonWriter_t * pWriter,
+                                                 const char * pKey,
+                                                 size_t keyLength,
+                                                 uint32_t value );
+
+/**
+ * @brief Get the length of a completed document.
+ *
+ * @param[in] pWriter The writer.
+ * @param[out] pLength The length of the document in the buffer.
+ *
+ * @return #JsonWriterSuccess if the top-level object has ended;
+ * #JsonWriterBadNesting if it has not; otherwise the first error of the
+ * document.
+ */
+JsonWriterStatus_t JsonWriter_Finish( const JsonWriter_t * pWriter,
+                                      size_t * pLength );
+
+#endif /* ifndef SHADOW_JSON_WRITER_H_ */
@@ -0,0 +1,381 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_manager.c
+ * @brief Implementation of the registry of things served over one MQTT
+ * connection.
+ *
+ * The things are packed at the start of their array and found through an
+ * open-addressed table with linear probing, at least twice as large as the
+ * number of things. Each thing keeps the hash of its name, so probing compares
+ * names only when the hashes match, and removal shifts the following entries
+ * of a probe sequence back without hashing again.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <string.h>
+
+#include "shadow_manager.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the number of table slots for a number of things: the smallest
+ * power of two of at least twice that number.
+ *
+ * @param[in] maxThings The number of things.
+ *
+ * @return The table size.
+ */
+static size_t tableSizeFor( size_t maxThings );
+
+/**
+ * @brief Hash a thing name with 32-bit FNV-1a.
+ *
+ * @param[in] pThingName The thing name.
+ * @param[in] thingNameLength The length of the thing name.
+ *
+ * @return The hash.
+ */
+static uint32_t hashName( const char * pThingName,
+                          uint16_t thingNameLength );
+
+/**
+ * @brief Find the table slot of a thing name, or the empty slot where it
+ * would go.
+ *
+ * @param[in] pManager The manager.
+ * @param[in] pThingName The thing name.
+ * @param[in] thingNameLength The length of the thing name.
+ * @param[in] hash The hash of the thing name.
+ *
+ * @return The slot.
+ */
+static size_t findSlot( const ShadowManager_t * pManager,
+                        const char * pThingName,
+                        uint16_t thingNameLength,
+                        uint32_t hash );
+
+/*-----------------------------------------------------------*/
+
+static size_t tableSizeFor( size_t maxThings )
+{
+    size_t tableSize = 2U;
+
+    while( tableSize < ( 2U * maxThings ) )
+    {
+        tableSize *= 2U;
+    }
+
+    return tableSize;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t hashName( const char * pThingName,
+                          uint16_t thingNameLength )
+{
+    uint32_t hash = 2166136261UL;
+    uint16_t i = 0U;
+
+    for( i = 0U; i < thingNameLength; i++ )
+    {
+        hash ^= ( uint32_t ) ( uint8_t ) pThingName[ i ];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t findSlot( const ShadowManager_t * pManager,
+                        const char * pThingName,
+                        uint16_t thingNameLength,
+                        uint32_t hash )
+{
+    size_t slot = ( size_t ) hash & pManager->tableMask;
+    uint16_t entry = pManager->pTable[ slot ];
+    const ShadowThing_t * pThing = NULL;
+    bool found = false;
+
+    /* The table is never more than half full, so an empty slot exists. */
+    while( ( entry != 0U ) && ( found == false ) )
+    {
+        pThing = &pManager->pThings[ entry - 1U ];
+
+        if( ( pThing->hash == hash ) &&
+            ( pThing->thingNameLength == thingNameLength ) &&
+            ( memcmp( pThing->pThingName, pThingName, thingNameLength ) == 0 ) )
+        {
+            found = true;
+        }
+        else
+        {
+            slot = ( slot + 1U ) & pManager->tableMask;
+            entry = pManager->pTable[ slot ];
+        }
+    }
+
+    return slot;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t ShadowManager_GetArenaSize( size_t maxThings )
+{
+    /* The things, then the table, plus slack to align the start. */
+    return ( maxThings * sizeof( ShadowThing_t ) ) +
+           ( tableSizeFor( maxThings ) * sizeof( uint16_t ) ) +
+           sizeof( void * );
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowManagerStatus_t ShadowManager_Init( ShadowManager_t * pManager,
+                                          void * pArena,
+                                          size_t arenaSize,
+                                          size_t maxThings )
+{
+    ShadowManagerStatus_t status = ShadowManagerSuccess;
+    uint8_t * pStart = ( uint8_t * ) pArena;
+    size_t padding = 0U, tableSize = 0U;
+
+    if( ( pManager == NULL ) || ( pArena == NULL ) || ( maxThings == 0U ) ||
+        ( maxThings > SHADOW_MANAGER_MAX_THINGS ) ||
+        ( arenaSize < ShadowManager_GetArenaSize( maxThings ) ) )
+    {
+        status = ShadowManagerBadParameter;
+    }
+    else
+    {
+        padding = ( sizeof( void * ) - ( ( uintptr_t ) pStart % sizeof( void * ) ) ) % sizeof( void * );
+        tableSize = tableSizeFor( maxThings );
+
+        /* The things come first, as they need the alignment. */
+        pManager->pThings = ( ShadowThing_t * ) &pStart[ padding ];
+        pManager->pTable = ( uint16_t * ) &pManager->pThings[ maxThings ];
+        pManager->maxThings = maxThings;
+        pManager->thingCount = 0U;
+        pManager->tableMask = tableSize - 1U;
+
+        ( void ) memset( pManager->pTable, 0x00, tableSize * sizeof( uint16_t ) );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowManagerStatus_t ShadowManager_AddThing( ShadowManager_t * pManager,
+                                              const char * pThingName,
+                                              uint16_t thingNameLength,
+                                              ShadowThingCallback_t callback,
+                                              void * pContext )
+{
+    ShadowManagerStatus_t status = ShadowManagerSuccess;
+    ShadowThing_t * pThing = NULL;
+    uint32_t hash = 0U;
+    size_t slot = 0U;
+
+    if( ( pManager == NULL ) || ( pThingName == NULL ) ||
+        ( thingNameLength == 0U ) || ( callback == NULL ) )
+    {
+        status = ShadowManagerBadParameter;
+    }
+    else if( pManager->thingCount == pManager->maxThings )
+    {
+        status = ShadowManagerFull;
+    }
+    else
+    {
+        hash = hashName( pThingName, thingNameLength );
+        slot = findSlot( pManager, pThingName, thingNameLength, hash );
+
+        if( pManager->pTable[ slot ] != 0U )
+        {
+            status = ShadowManagerExists;
+        }
+        else
+        {
+            pThing = &pManager->pThings[ pManager->thingCount ];
+            pThing->pThingName = pThingName;
+            pThing->thingNameLength = thingNameLength;
+            pThing->hash = hash;
+            pThing->callback = callback;
+            pThing->pContext = pContext;
+
+            pManager->thingCount++;
+            pManager->pTable[ slot ] = ( uint16_t ) pManager->thingCount;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowManagerStatus_t ShadowManager_RemoveThing( ShadowManager_t * pManager,
+                                                 const char * pThingName,
+                                                 uint16_t thingNameLength )
+{
+    ShadowManagerStatus_t status = ShadowManagerSuccess;
+    size_t slot = 0U, next = 0U, home = 0U;
+    uint16_t entry = 0U;
+    const ShadowThing_t * pLast = NULL;
+
+    if( pManager == NULL )
+    {
+        status = ShadowManagerBadParameter;
+    }
+    else if( ( pThingName == NULL ) || ( thingNameLength == 0U ) )
+    {
+        status = ShadowManagerNotFound;
+    }
+    else
+    {
+        slot = findSlot( pManager, pThingName, thingNameLength,
+                         hashName( pThingName, thingNameLength ) );
+        entry = pManager->pTable[ slot ];
+
+        if( entry == 0U )
+        {
+            status = ShadowManagerNotFound;
+        }
+        else
+        {
+            /* Shift back each following entry of the probe sequence whose home
+             * slot is not between the hole and it. */
+            next = ( slot + 1U ) & pManager->tableMask;
+
+            while( pManager->pTable[ next ] != 0U )
+            {
+                home = ( size_t ) pManager->pThings[ pManager->pTable[ next ] - 1U ].hash & pManager->tableMask;
+
+                if( ( ( next - home ) & pManager->tableMask ) >= ( ( next - slot ) & pManager->tableMask ) )
+                {
+                    pManager->pTable[ slot ] = pManager->pTable[ next ];
+                    slot = next;
+                }
+
+                next = ( next + 1U ) & pManager->tableMask;
+            }
+
+            pManager->pTable[ slot ] = 0U;
+
+            /* Keep the things packed by moving the last one into the hole. */
+            pManager->thingCount--;
+
+            if( ( size_t ) ( entry - 1U ) != pManager->thingCount )
+            {
+                pLast = &pManager->pThings[ pManager->thingCount ];
+                slot = findSlot( pManager, pLast->pThingName, pLast->thingNameLength, pLast->hash );
+                pManager->pTable[ slot ] = entry;
+                pManager->pThings[ entry - 1U ] = *pLast;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowThing_t * ShadowManager_FindThing( const ShadowManager_t * pManager,
+                                         const char * pThingName,
+                                         uint16_t thingNameLength )
+{
+    ShadowThing_t * pThing = NULL;
+    uint16_t entry = 0U;
+
+    if( ( pManager != NULL ) && ( pThingName != NULL ) && ( thingNameLength != 0U ) )
+    {
+        entry = pManager->pTable[ findSlot( pManager, pThingName, thingNameLength,
+                                            hashName( pThingName, thingNameLength ) ) ];
+
+        if( entry != 0U )
+        {
+            pThing = &pManager->pThings[ entry - 1U ];
+        }
+    }
+
+    return pThing;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowThing_t * ShadowManager_GetThing( const ShadowManager_t * pManager,
+                                        size_t index )
+{
+    ShadowThing_t * pThing = NULL;
+
+    if( ( pManager != NULL ) && ( index < pManager->thingCount ) )
+    {
+        pThing = &pManager->pThings[ index ];
+    }
+
+    return pThing;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowManagerStatus_t ShadowManager_Dispatch( const ShadowManager_t * pManager,
+                                              MQTTPublishInfo_t * pPublishInfo )
+{
+    ShadowManagerStatus_t status = ShadowManagerSuccess;
+    ShadowMessageType_t messageType = ShadowMessageTypeMaxNum;
+    const char * pThingName = NULL;
+    uint16_t thingNameLength = 0U;
+    ShadowThing_t * pThing = NULL;
+
+    if( ( pManager == NULL ) || ( pPublishInfo == NULL ) )
+    {
+        status = ShadowManagerBadParameter;
+    }
+    else if( Shadow_MatchTopic( pPublishInfo->pTopicName,
+                                pPublishInfo->topicNameLength,
+                                &messageType,
+                                &pThingName,
+                                &thingNameLength ) != SHADOW_SUCCESS )
+    {
+        status = ShadowManagerNotShadowTopic;
+    }
+    else
+    {
+        pThing = ShadowManager_FindThing( pManager, pThingName, thingNameLength );
+
+        if( pThing == NULL )
+        {
+            status = ShadowManagerNotFound;
+        }
+        else
+        {
+            pThing->callback( pThing, messageType, pPublishInfo );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,218 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_manager.h
+ * @brief A registry of the things whose shadows are served over one MQTT
+ * connection, which routes incoming shadow messages to a callback per thing.
+ *
+ * A gateway for many devices can then keep a single MQTT session, instead of
+ * one TLS connection per device. The registry is an open-addressed table by
+ * thing name, so a message is routed in constant time however many things are
+ * registered. Their number is chosen at run time by the arena given to
+ * #ShadowManager_Init.
+ */
+
+#ifndef SHADOW_MANAGER_H_
+#define SHADOW_MANAGER_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/* SHADOW API header. */
+#include "shadow.h"
+
+/**
+ * @brief The largest number of things a manager can hold.
+ */
+#define SHADOW_MANAGER_MAX_THINGS    ( 32768U )
+
+/**
+ * @brief A size of arena for #ShadowManager_Init that holds a number of things,
+ * usable to size a static array. It may exceed the size returned by
+ * #ShadowManager_GetArenaSize.
+ *
+ * Besides its entry, each thing needs up to four table slots.
+ */
+#define SHADOW_MANAGER_ARENA_SIZE( maxThings )                 \
+    ( ( ( maxThings ) * sizeof( ShadowThing_t ) ) +            \
+      ( ( 4U * ( maxThings ) ) * sizeof( uint16_t ) ) + sizeof( void * ) )
+
+/**
+ * @brief Return codes from the shadow manager functions.
+ */
+typedef enum ShadowManagerStatus
+{
+    ShadowManagerSuccess,        /**< @brief The function completed successfully. */
+    ShadowManagerBadParameter,   /**< @brief A parameter was NULL, zero, or out of range. */
+    ShadowManagerFull,           /**< @brief The manager holds its maximum number of things. */
+    ShadowManagerExists,         /**< @brief A thing of that name is already registered. */
+    ShadowManagerNotFound,       /**< @brief No thing of that name is registered. */
+    ShadowManagerNotShadowTopic  /**< @brief The topic is not a shadow topic. */
+} ShadowManagerStatus_t;
+
+struct ShadowThing;
+
+/**
+ * @brief Callback type invoked for the shadow messages of a thing.
+ *
+ * @param[in] pThing The thing the message is for.
+ * @param[in] messageType The type of the message, from its topic.
+ * @param[in] pPublishInfo The incoming PUBLISH.
+ */
+typedef void (* ShadowThingCallback_t )( struct ShadowThing * pThing,
+                                         ShadowMessageType_t messageType,
+                                         MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief A thing registered with a manager.
+ */
+typedef struct ShadowThing
+{
+    const char * pThingName;        /**< @brief The thing name, owned by the application. */
+    uint16_t thingNameLength;       /**< @brief Length of the thing name. */
+    uint32_t hash;                  /**< @brief Hash of the thing name. */
+    ShadowThingCallback_t callback; /**< @brief Callback for the messages of the thing. */
+    void * pContext;                /**< @brief State of the thing, owned by the application. */
+} ShadowThing_t;
+
+/**
+ * @brief A shadow manager, set up by #ShadowManager_Init.
+ */
+typedef struct ShadowManager
+{
+    ShadowThing_t * pThings; /**< @brief The registered things, packed at the start. */
+    uint16_t * pTable;       /**< @brief Open-addressed table of thing index + 1 by name hash, 0 when empty. */
+    size_t maxThings;        /**< @brief Number of entries. */
+    size_t thingCount;       /**< @brief Number of registered things. */
+    size_t tableMask;        /**< @brief Table size minus one; the table size is a power of two. */
+} ShadowManager_t;
+
+/**
+ * @brief Get the size of an arena for #ShadowManager_Init that holds a number
+ * of things.
+ *
+ * @param[in] maxThings The number of things.
+ *
+ * @return The arena size in bytes.
+ */
+size_t ShadowManager_GetArenaSize( size_t maxThings );
+
+/**
+ * @brief Set up an empty manager in an arena.
+ *
+ * @param[out] pManager The manager.
+ * @param[in] pArena Memory for the manager. It must stay valid while the
+ * manager is used.
+ * @param[in] arenaSize The size of @p pArena, from #ShadowManager_GetArenaSize.
+ * @param[in] maxThings The number of things, from 1 to
+ * #SHADOW_MANAGER_MAX_THINGS.
+ *
+ * @return #ShadowManagerSuccess, or #ShadowManagerBadParameter if a parameter
+ * is NULL or out of range, or the arena is too small.
+ */
+ShadowManagerStatus_t ShadowManager_Init( ShadowManager_t * pManager,
+                                          void * pArena,
+                                          size_t arenaSize,
+                                          size_t maxThings );
+
+/**
+ * @brief Register a thing and its callback.
+ *
+ * @param[in] pManager The manager.
+ * @param[in] pThingName The thing name. It is saved in the manager, so the
+ * application must not free or alter it until the thing is removed.
+ * @param[in] thingNameLength The length of the thing name.
+ * @param[in] callback The callback for the shadow messages of the thing.
+ * @param[in] pContext State of the thing passed back in #ShadowThing_t, or NULL.
+ *
+ * @return #ShadowManagerSuccess; #ShadowManagerFull if the manager is full;
+ * #ShadowManagerExists if the thing is already registered;
+ * #ShadowManagerBadParameter if a parameter is NULL or 0.
+ */
+ShadowManagerStatus_t ShadowManager_AddThing( ShadowManager_t * pManager,
+                                              const char * pThingName,
+                                              uint16_t thingNameLength,
+                                              ShadowThingCallback_t callback,
+                                              void * pContext );
+
+/**
+ * @brief Remove a thing.
+ *
+ * The last registered thing moves into the place of the removed one, so
+ * pointers to things are only valid until a thing is removed.
+ *
+ * @param[in] pManager The manager.
+ * @param[in] pThingName The thing name.
+ * @param[in] thingNameLength The length of the thing name.
+ *
+ * @return #ShadowManagerSuccess; #ShadowManagerNotFound if the thing is not
+ * registered; #ShadowManagerBadParameter if @p pManager is NULL.
+ */
+ShadowManagerStatus_t ShadowManager_RemoveThing( ShadowManager_t * pManager,
+                                                 const char * pThingName,
+                                                 uint16_t thingNameLength );
+
+/**
+ * @brief Find a registered thing by name.
+ *
+ * @param[in] pManager The manager.
+ * @param[in] pThingName The thing name.
+ * @param[in] thingNameLength The length of the thing name.
+ *
+ * @return The thing, or NULL if it is not registered.
+ */
+ShadowThing_t * ShadowManager_FindThing( const ShadowManager_t * pManager,
+                                         const char * pThingName,
+                                         uint16_t thingNameLength );
+
+/**
+ * @brief Get a registered thing by position, for instance to subscribe to
+ * the topics of every thing.
+ *
+ * @param[in] pManager The manager.
+ * @param[in] index The position, from 0 to the number of things minus one.
+ *
+ * @return The thing, or NULL if @p index is past the last thing.
+ */
+ShadowThing_t * ShadowManager_GetThing( const ShadowManager_t * pManager,
+                                        size_t index );
+
+/**
+ * @brief Route an incoming PUBLISH to the callback of its thing.
+ *
+ * @param[in] pManager The manager.
+ * @param[in] pPublishInfo The incoming PUBLISH.
+ *
+ * @return #ShadowManagerSuccess if a callback was invoked;
+ * #ShadowManagerNotShadowTopic if the topic is not a shadow topic;
+ * #ShadowManagerNotFound if its thing is not registered;
+ * #ShadowManagerBadParameter if a parameter is NULL.
+ */
+ShadowManagerStatus_t ShadowManager_Dispatch( const ShadowManager_t * pManager,
+                                              MQTTPublishInfo_t * pPublishInfo );
+
+#endif /* ifndef SHADOW_MANAGER_H_ */
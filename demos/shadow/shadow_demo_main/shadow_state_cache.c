@@ -0,0 +1,163 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_state_cache.c
+ * @brief Implementation of the local shadow state cache.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+
+#include "shadow_state_cache.h"
+
+/**
+ * @brief The format of a saved cache: a tag, the version and the powerOn
+ * state, so that a file of another kind is not mistaken for a cache.
+ */
+#define SHADOW_CACHE_FORMAT    "shadow-cache-v1 %lu %lu\n"
+
+/*-----------------------------------------------------------*/
+
+void ShadowCache_Reset( ShadowStateCache_t * pCache )
+{
+    if( pCache != NULL )
+    {
+        pCache->valid = false;
+        pCache->version = 0U;
+        pCache->powerOn = 0U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowCache_AcceptVersion( ShadowStateCache_t * pCache,
+                                uint32_t version )
+{
+    bool accepted = false;
+
+    if( pCache == NULL )
+    {
+        /* Empty else MISRA 15.7 */
+    }
+    else if( ( pCache->valid == false ) || ( version > pCache->version ) )
+    {
+        pCache->valid = true;
+        pCache->version = version;
+        accepted = true;
+    }
+    else
+    {
+        /* Stale or duplicate. */
+    }
+
+    return accepted;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_Load( ShadowStateCache_t * pCache,
+                                      const char * pPath )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    FILE * pFile = NULL;
+    unsigned long version = 0UL, powerOn = 0UL;
+
+    if( ( pCache == NULL ) || ( pPath == NULL ) )
+    {
+        status = ShadowCacheBadParameter;
+    }
+    else
+    {
+        ShadowCache_Reset( pCache );
+        pFile = fopen( pPath, "r" );
+
+        if( pFile == NULL )
+        {
+            status = ShadowCacheNotFound;
+        }
+        else
+        {
+            if( ( fscanf( pFile, SHADOW_CACHE_FORMAT, &version, &powerOn ) != 2 ) ||
+                ( version > UINT32_MAX ) || ( powerOn > UINT32_MAX ) )
+            {
+                status = ShadowCacheCorrupt;
+            }
+            else
+            {
+                pCache->valid = true;
+                pCache->version = ( uint32_t ) version;
+                pCache->powerOn = ( uint32_t ) powerOn;
+            }
+
+            ( void ) fclose( pFile );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_Save( const ShadowStateCache_t * pCache,
+                                      const char * pPath )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    FILE * pFile = NULL;
+
+    if( ( pCache == NULL ) || ( pPath == NULL ) )
+    {
+        status = ShadowCacheBadParameter;
+    }
+    else if( pCache->valid == false )
+    {
+        /* An empty cache is saved as no file, so that it loads as empty. */
+        ( void ) remove( pPath );
+    }
+    else
+    {
+        pFile = fopen( pPath, "w" );
+
+        if( pFile == NULL )
+        {
+            status = ShadowCacheFileError;
+        }
+        else
+        {
+            if( fprintf( pFile, SHADOW_CACHE_FORMAT,
+                         ( unsigned long ) pCache->version,
+                         ( unsigned long ) pCache->powerOn ) < 0 )
+            {
+                status = ShadowCacheFileError;
+            }
+
+            if( fclose( pFile ) != 0 )
+            {
+                status = ShadowCacheFileError;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,109 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_state_cache.h
+ * @brief A local copy of the last shadow version and state seen by the device,
+ * which can be kept across runs in a file.
+ *
+ * Shadow versions only increase, so a message with a version no newer than the
+ * cached one is a duplicate or arrived out of order, and can be dropped. A valid
+ * cache restored after a reconnect also tells the device its state without a
+ * full get: a get is only needed when the cache is empty.
+ */
+
+#ifndef SHADOW_STATE_CACHE_H_
+#define SHADOW_STATE_CACHE_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Return codes from the cache functions.
+ */
+typedef enum ShadowCacheStatus
+{
+    ShadowCacheSuccess,      /**< @brief The function completed successfully. */
+    ShadowCacheBadParameter, /**< @brief A parameter was NULL. */
+    ShadowCacheNotFound,     /**< @brief No cache was saved at the path. */
+    ShadowCacheCorrupt,      /**< @brief The saved cache could not be read. */
+    ShadowCacheFileError     /**< @brief The cache could not be saved. */
+} ShadowCacheStatus_t;
+
+/**
+ * @brief The last shadow version and state seen.
+ */
+typedef struct ShadowStateCache
+{
+    bool valid;       /**< @brief Whether any version has been seen. */
+    uint32_t version; /**< @brief The newest version seen. */
+    uint32_t powerOn; /**< @brief The powerOn state at that version. */
+} ShadowStateCache_t;
+
+/**
+ * @brief Empty the cache, for instance after the shadow was deleted, which
+ * restarts its versions.
+ *
+ * @param[out] pCache The cache.
+ */
+void ShadowCache_Reset( ShadowStateCache_t * pCache );
+
+/**
+ * @brief Record the version of a shadow message, unless it is not newer than
+ * the cached one.
+ *
+ * @param[in] pCache The cache.
+ * @param[in] version The version of the message.
+ *
+ * @return true if the message is newer and its state should be applied;
+ * false if it is stale or a duplicate.
+ */
+bool ShadowCache_AcceptVersion( ShadowStateCache_t * pCache,
+                                uint32_t version );
+
+/**
+ * @brief Restore a cache saved by #ShadowCache_Save.
+ *
+ * @param[out] pCache The cache, which is emptied unless the file is read.
+ * @param[in] pPath The file the cache was saved to.
+ *
+ * @return #ShadowCacheSuccess; #ShadowCacheNotFound if there is no file;
+ * #ShadowCacheCorrupt if the file could not be read;
+ * #ShadowCacheBadParameter if a parameter is NULL.
+ */
+ShadowCacheStatus_t ShadowCache_Load( ShadowStateCache_t * pCache,
+                                      const char * pPath );
+
+/**
+ * @brief Save the cache to a file.
+ *
+ * @param[in] pCache The cache.
+ * @param[in] pPath The file to save to. It is replaced.
+ *
+ * @return #ShadowCacheSuccess; #ShadowCacheFileError if the file could not be
+ * written; #ShadowCacheBadParameter if a parameter is NULL.
+ */
+ShadowCacheStatus_t ShadowCache_Save( const ShadowStateCache_t * pCache,
+                                      const char * pPath );
+
+#endif /* ifndef SHADOW_STATE_CACHE_H_ */
@@ -0,0 +1,185 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_update_coalescer.c
+ * @brief Implementation of the coalescer of reported shadow fields.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "shadow_update_coalescer.h"
+
+/* JSON writer header. */
+#include "shadow_json_writer.h"
+
+/*-----------------------------------------------------------*/
+
+ShadowCoalescerStatus_t ShadowCoalescer_Init( ShadowCoalescer_t * pCoalescer,
+                                              uint32_t flushWindowMs,
+                                              size_t maxFields )
+{
+    ShadowCoalescerStatus_t status = ShadowCoalescerSuccess;
+
+    if( ( pCoalescer == NULL ) || ( maxFields == 0U ) ||
+        ( maxFields > SHADOW_COALESCER_MAX_FIELDS ) )
+    {
+        status = ShadowCoalescerBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pCoalescer, 0x00, sizeof( ShadowCoalescer_t ) );
+        pCoalescer->maxFields = maxFields;
+        pCoalescer->flushWindowMs = flushWindowMs;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCoalescerStatus_t ShadowCoalescer_Set( ShadowCoalescer_t * pCoalescer,
+                                             const char * pKey,
+                                             size_t keyLength,
+                                             uint32_t value,
+                                             uint32_t nowMs )
+{
+    ShadowCoalescerStatus_t status = ShadowCoalescerSuccess;
+    size_t i = 0U;
+
+    if( ( pCoalescer == NULL ) || ( pKey == NULL ) || ( keyLength == 0U ) )
+    {
+        status = ShadowCoalescerBadParameter;
+    }
+    else
+    {
+        for( i = 0U; i < pCoalescer->fieldCount; i++ )
+        {
+            if( ( pCoalescer->fields[ i ].keyLength == keyLength ) &&
+                ( memcmp( pCoalescer->fields[ i ].pKey, pKey, keyLength ) == 0 ) )
+            {
+                break;
+            }
+        }
+
+        if( i < pCoalescer->fieldCount )
+        {
+            /* The last write wins. */
+            pCoalescer->fields[ i ].value = value;
+        }
+        else if( pCoalescer->fieldCount == pCoalescer->maxFields )
+        {
+            status = ShadowCoalescerFull;
+        }
+        else
+        {
+            if( pCoalescer->fieldCount == 0U )
+            {
+                /* The flush window starts with the first change. */
+                pCoalescer->firstChangeTimeMs = nowMs;
+            }
+
+            pCoalescer->fields[ i ].pKey = pKey;
+            pCoalescer->fields[ i ].keyLength = keyLength;
+            pCoalescer->fields[ i ].value = value;
+            pCoalescer->fieldCount++;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowCoalescer_IsFlushDue( const ShadowCoalescer_t * pCoalescer,
+                                 uint32_t nowMs )
+{
+    bool flushDue = false;
+
+    if( ( pCoalescer != NULL ) && ( pCoalescer->fieldCount > 0U ) )
+    {
+        /* The unsigned difference stays correct when the clock wraps. */
+        flushDue = ( pCoalescer->fieldCount == pCoalescer->maxFields ) ||
+                   ( ( nowMs - pCoalescer->firstChangeTimeMs ) >= pCoalescer->flushWindowMs );
+    }
+
+    return flushDue;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCoalescerStatus_t ShadowCoalescer_Flush( ShadowCoalescer_t * pCoalescer,
+                                               char * pBuffer,
+                                               size_t bufferSize,
+                                               uint32_t clientToken,
+                                               size_t * pDocumentLength )
+{
+    ShadowCoalescerStatus_t status = ShadowCoalescerSuccess;
+    JsonWriter_t writer;
+    size_t i = 0U;
+
+    if( ( pCoalescer == NULL ) || ( pBuffer == NULL ) || ( pDocumentLength == NULL ) )
+    {
+        status = ShadowCoalescerBadParameter;
+    }
+    else if( pCoalescer->fieldCount == 0U )
+    {
+        status = ShadowCoalescerNothingPending;
+    }
+    else
+    {
+        /* Each call does nothing once the document has failed, so only the
+         * status of the document as a whole is checked. */
+        JsonWriter_Init( &writer, pBuffer, bufferSize );
+        ( void ) JsonWriter_StartObject( &writer, NULL, 0U );
+        ( void ) JsonWriter_StartObject( &writer, "state", sizeof( "state" ) - 1U );
+        ( void ) JsonWriter_StartObject( &writer, "reported", sizeof( "reported" ) - 1U );
+
+        for( i = 0U; i < pCoalescer->fieldCount; i++ )
+        {
+            ( void ) JsonWriter_AddUnsigned( &writer,
+                                             pCoalescer->fields[ i ].pKey,
+                                             pCoalescer->fields[ i ].keyLength,
+                                             pCoalescer->fields[ i ].value );
+        }
+
+        ( void ) JsonWriter_EndObject( &writer );
+        ( void ) JsonWriter_EndObject( &writer );
+        ( void ) JsonWriter_AddUnsignedString( &writer, "clientToken", sizeof( "clientToken" ) - 1U, clientToken );
+        ( void ) JsonWriter_EndObject( &writer );
+
+        if( JsonWriter_Finish( &writer, pDocumentLength ) == JsonWriterSuccess )
+        {
+            pCoalescer->fieldCount = 0U;
+            pCoalescer->lastClientToken = clientToken;
+        }
+        else
+        {
+            status = ShadowCoalescerBufferTooSmall;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,152 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_update_coalescer.h
+ * @brief Merges changes to reported fields made in a short burst into a single
+ * shadow update document.
+ */
+
+#ifndef SHADOW_UPDATE_COALESCER_H_
+#define SHADOW_UPDATE_COALESCER_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of distinct fields a coalescer holds before it must
+ * be flushed.
+ */
+#ifndef SHADOW_COALESCER_MAX_FIELDS
+    #define SHADOW_COALESCER_MAX_FIELDS    ( 8U )
+#endif
+
+/**
+ * @brief Return codes from the coalescer functions.
+ */
+typedef enum ShadowCoalescerStatus
+{
+    ShadowCoalescerSuccess,        /**< @brief The function completed successfully. */
+    ShadowCoalescerBadParameter,   /**< @brief A parameter was NULL or out of range. */
+    ShadowCoalescerFull,           /**< @brief The field is new and the coalescer holds its field limit. */
+    ShadowCoalescerNothingPending, /**< @brief There is no field to flush. */
+    ShadowCoalescerBufferTooSmall  /**< @brief The update document does not fit in the buffer. */
+} ShadowCoalescerStatus_t;
+
+/**
+ * @brief A pending reported field.
+ */
+typedef struct ShadowCoalescerField
+{
+    const char * pKey; /**< @brief The key of the field. */
+    size_t keyLength;  /**< @brief Length of the key. */
+    uint32_t value;    /**< @brief The last value set. */
+} ShadowCoalescerField_t;
+
+/**
+ * @brief The reported fields changed since the last flush.
+ */
+typedef struct ShadowCoalescer
+{
+    ShadowCoalescerField_t fields[ SHADOW_COALESCER_MAX_FIELDS ]; /**< @brief The pending fields, in the order first set. */
+    size_t fieldCount;                                            /**< @brief Number of pending fields. */
+    size_t maxFields;                                             /**< @brief Number of fields that makes a flush due. */
+    uint32_t flushWindowMs;                                       /**< @brief Time after the first change that makes a flush due. */
+    uint32_t firstChangeTimeMs;                                   /**< @brief Time of the first change since the last flush. */
+    uint32_t lastClientToken;                                     /**< @brief Client token of the last flushed document. */
+} ShadowCoalescer_t;
+
+/**
+ * @brief Set up an empty coalescer.
+ *
+ * @param[out] pCoalescer The coalescer.
+ * @param[in] flushWindowMs How long a change may wait for others to be merged
+ * with it.
+ * @param[in] maxFields The number of pending fields that makes a flush due,
+ * from 1 to #SHADOW_COALESCER_MAX_FIELDS.
+ *
+ * @return #ShadowCoalescerSuccess, or #ShadowCoalescerBadParameter.
+ */
+ShadowCoalescerStatus_t ShadowCoalescer_Init( ShadowCoalescer_t * pCoalescer,
+                                              uint32_t flushWindowMs,
+                                              size_t maxFields );
+
+/**
+ * @brief Set the reported value of a field. A later value for the same key
+ * replaces a pending one.
+ *
+ * @param[in] pCoalescer The coalescer.
+ * @param[in] pKey The key of the field. It is kept until the next flush, so
+ * it must not change until then.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[in] value The value.
+ * @param[in] nowMs The current time, as from Clock_GetTimeMs.
+ *
+ * @return #ShadowCoalescerSuccess;
+ * #ShadowCoalescerFull if @p pKey is a new field and the coalescer must be
+ * flushed first; #ShadowCoalescerBadParameter if a parameter is NULL or empty.
+ */
+ShadowCoalescerStatus_t ShadowCoalescer_Set( ShadowCoalescer_t * pCoalescer,
+                                             const char * pKey,
+                                             size_t keyLength,
+                                             uint32_t value,
+                                             uint32_t nowMs );
+
+/**
+ * @brief Tell whether the pending fields should be flushed, because the
+ * flush window of the first of them has passed or the field limit is reached.
+ *
+ * @param[in] pCoalescer The coalescer.
+ * @param[in] nowMs The current time, as from Clock_GetTimeMs.
+ *
+ * @return true if a flush is due.
+ */
+bool ShadowCoalescer_IsFlushDue( const ShadowCoalescer_t * pCoalescer,
+                                 uint32_t nowMs );
+
+/**
+ * @brief Write the pending fields into one "reported" update document, and
+ * clear them.
+ *
+ * The client token of the document is kept, so that the accepted or rejected
+ * response can be matched with all the fields merged into it.
+ *
+ * @param[in] pCoalescer The coalescer.
+ * @param[in] pBuffer The buffer to write the document to.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in] clientToken The client token of the document.
+ * @param[out] pDocumentLength Length of the document.
+ *
+ * @return #ShadowCoalescerSuccess;
+ * #ShadowCoalescerNothingPending if no field is pending;
+ * #ShadowCoalescerBufferTooSmall if the document does not fit, in which case
+ * the fields stay pending; #ShadowCoalescerBadParameter if a parameter is NULL.
+ */
+ShadowCoalescerStatus_t ShadowCoalescer_Flush( ShadowCoalescer_t * pCoalescer,
+                                               char * pBuffer,
+                                               size_t bufferSize,
+                                               uint32_t clientToken,
+                                               size_t * pDocumentLength );
+
+#endif /* ifndef SHADOW_UPDATE_COALESCER_H_ */
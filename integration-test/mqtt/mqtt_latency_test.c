@@ -0,0 +1,625 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_latency_test.c
+ * @brief Round-trip latency benchmarks for the MQTT library when communicating
+ * with AWS IoT from a POSIX platform.
+ *
+ * Each test publishes many messages of every payload size in
+ * #MQTT_LATENCY_PAYLOAD_SIZES, one at a time, and measures the time from
+ * sending the PUBLISH to receiving its echo at QoS 0, its PUBACK at QoS 1 or
+ * its PUBCOMP at QoS 2. The percentiles of each test and payload size are
+ * written as one JSON object per line to #MQTT_LATENCY_RESULTS_PATH, so that
+ * latencies measured on the same hardware can be compared between releases.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+#include "unity.h"
+/* Include paths for public enums, structures, and macros. */
+#include "core_mqtt.h"
+
+/* Include OpenSSL implementation of transport interface. */
+#include "openssl_posix.h"
+
+/* Include clock for timer. */
+#include "clock.h"
+
+/* Ensure that config macros, required for TLS connection, have been defined. */
+#ifndef BROKER_ENDPOINT
+    #error "BROKER_ENDPOINT should be defined for the MQTT integration tests."
+#endif
+
+#ifndef SERVER_ROOT_CA_CERT_PATH
+    #error "SERVER_ROOT_CA_CERT_PATH should be defined for the MQTT integration tests."
+#endif
+
+#ifndef CLIENT_CERT_PATH
+    #error "CLIENT_CERT_PATH should be defined for the MQTT integration tests."
+#endif
+
+#ifndef CLIENT_PRIVATE_KEY_PATH
+    #error "CLIENT_PRIVATE_KEY_PATH should be defined for the MQTT integration tests."
+#endif
+
+/**
+ * @brief Version of the SDK recorded with every result.
+ */
+#ifndef SDK_VERSION
+    #define SDK_VERSION    "unknown"
+#endif
+
+/**
+ * @brief File the results are written to. It is replaced by every run.
+ */
+#ifndef MQTT_LATENCY_RESULTS_PATH
+    #define MQTT_LATENCY_RESULTS_PATH    "mqtt_latency_results.jsonl"
+#endif
+
+/**
+ * @brief Number of round trips measured for each payload size.
+ */
+#ifndef MQTT_LATENCY_ITERATIONS
+    #define MQTT_LATENCY_ITERATIONS    ( 200U )
+#endif
+
+/**
+ * @brief Number of round trips made for each payload size before measuring,
+ * so that connection and cache warm-up are not measured.
+ */
+#define MQTT_LATENCY_WARMUP_ITERATIONS          ( 10U )
+
+/**
+ * @brief Payload sizes in bytes that every test measures.
+ */
+#define MQTT_LATENCY_PAYLOAD_SIZES              { 16U, 256U, 2048U }
+
+/**
+ * @brief Largest payload size in #MQTT_LATENCY_PAYLOAD_SIZES.
+ */
+#define MQTT_LATENCY_MAX_PAYLOAD_SIZE           ( 2048U )
+
+/**
+ * @brief Longest time in milliseconds to wait for a single round trip.
+ */
+#define MQTT_LATENCY_ROUND_TRIP_TIMEOUT_MS      ( 5000U )
+
+/**
+ * @brief Length of MQTT server host name.
+ */
+#define BROKER_ENDPOINT_LENGTH                  ( ( uint16_t ) ( sizeof( BROKER_ENDPOINT ) - 1 ) )
+
+/**
+ * @brief Topic the benchmarks publish to.
+ */
+#define TEST_MQTT_TOPIC                         "/iot/integration/latency"
+
+/**
+ * @brief Size of the network buffer for MQTT packets. It must hold the echo
+ * of the largest payload.
+ */
+#define NETWORK_BUFFER_SIZE                     ( MQTT_LATENCY_MAX_PAYLOAD_SIZE + 128U )
+
+/**
+ * @brief Client identifier for the MQTT connection in the test.
+ */
+#define TEST_CLIENT_IDENTIFIER                  "MQTT-Latency"
+
+/**
+ * @brief Maximum number of digits of the random number appended to the
+ * client identifier.
+ */
+#define MAX_RAND_NUMBER_DIGITS_FOR_CLIENT_ID    ( 3u )
+
+/**
+ * @brief Largest random number appended to the client identifier.
+ */
+#define MAX_RAND_NUMBER_FOR_CLIENT_ID           ( 999u )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS          ( 200U )
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milliseconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS                 ( 1000U )
+
+/**
+ * @brief Keep alive period in seconds for MQTT connection.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS        ( 60U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Packet identifier of the last SUBSCRIBE, UNSUBSCRIBE or PUBLISH.
+ */
+static uint16_t globalPacketIdentifier = 0U;
+
+/**
+ * @brief Network context of the connection with the broker.
+ */
+static NetworkContext_t networkContext;
+
+/**
+ * @brief Information of the broker to connect to.
+ */
+static ServerInfo_t serverInfo;
+
+/**
+ * @brief Credentials of the TLS connection.
+ */
+static OpensslCredentials_t opensslCredentials;
+
+/**
+ * @brief MQTT context of the connection.
+ */
+static MQTTContext_t context;
+
+/**
+ * @brief The network buffer must remain valid for the lifetime of the MQTT context.
+ */
+static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
+
+/**
+ * @brief Payload of every PUBLISH.
+ */
+static uint8_t payload[ MQTT_LATENCY_MAX_PAYLOAD_SIZE ];
+
+/**
+ * @brief Round-trip times in microseconds of the payload size being measured.
+ */
+static uint64_t samples[ MQTT_LATENCY_ITERATIONS ];
+
+/**
+ * @brief Flags set by the event callback when the packet ending a round trip
+ * is received.
+ */
+static bool receivedSubAck = false;
+static bool receivedUnsubAck = false;
+static bool receivedPublish = false;
+static bool receivedPubAck = false;
+static bool receivedPubComp = false;
+
+/**
+ * @brief Whether the results file has been created by this run.
+ */
+static bool resultsFileCreated = false;
+
+/**
+ * @brief Random number for the client identifier of the MQTT connection.
+ */
+static int clientIdRandNumber;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The application callback function that is expected to be invoked by the
+ * MQTT library for incoming publish and incoming acks received over the network.
+ *
+ * @param[in] pContext MQTT context pointer.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Run the process loop until a flag is set by the event callback.
+ *
+ * @param[in] pFlag The flag to wait for.
+ * @param[in] timeoutMs Longest time to wait.
+ *
+ * @return true if the flag was set; false on timeout or error.
+ */
+static bool waitForFlag( const bool * pFlag,
+                         uint32_t timeoutMs );
+
+/**
+ * @brief Measure the round trips of PUBLISHes of every payload size, and
+ * write their percentiles to the results file.
+ *
+ * @param[in] pName Name of the measurement in the results.
+ * @param[in] qos QoS of the PUBLISHes.
+ * @param[in] pFlag Flag set when the packet ending a round trip is received.
+ */
+static void measureRoundTrips( const char * pName,
+                               MQTTQoS_t qos,
+                               bool * pFlag );
+
+/**
+ * @brief Write the percentiles of sorted round-trip times to the results file.
+ *
+ * @param[in] pName Name of the measurement.
+ * @param[in] payloadSize Payload size of the measurement.
+ * @param[in] pSorted Round-trip times in ascending order.
+ * @param[in] count Number of round-trip times.
+ */
+static void writeResults( const char * pName,
+                          size_t payloadSize,
+                          const uint64_t * pSorted,
+                          size_t count );
+
+/**
+ * @brief Get a percentile of sorted values by the nearest-rank method.
+ *
+ * @param[in] pSorted Values in ascending order.
+ * @param[in] count Number of values.
+ * @param[in] percentile The percentile, such as 99.9.
+ *
+ * @return The value of the percentile.
+ */
+static uint64_t percentileOf( const uint64_t * pSorted,
+                              size_t count,
+                              double percentile );
+
+/**
+ * @brief qsort comparison of two uint64_t values.
+ *
+ * @param[in] pFirst The first value.
+ * @param[in] pSecond The second value.
+ *
+ * @return Negative, zero or positive as the first value is smaller than,
+ * equal to or larger than the second.
+ */
+static int compareSamples( const void * pFirst,
+                           const void * pSecond );
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    assert( pContext != NULL );
+    assert( pPacketInfo != NULL );
+    assert( pDeserializedInfo != NULL );
+
+    /* Suppress unused parameter warning when asserts are disabled in build. */
+    ( void ) pContext;
+
+    if( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+    {
+        receivedPublish = true;
+    }
+    else if( pDeserializedInfo->packetIdentifier == globalPacketIdentifier )
+    {
+        switch( pPacketInfo->type )
+        {
+            case MQTT_PACKET_TYPE_SUBACK:
+                receivedSubAck = true;
+                break;
+
+            case MQTT_PACKET_TYPE_UNSUBACK:
+                receivedUnsubAck = true;
+                break;
+
+            case MQTT_PACKET_TYPE_PUBACK:
+                receivedPubAck = true;
+                break;
+
+            case MQTT_PACKET_TYPE_PUBCOMP:
+                receivedPubComp = true;
+                break;
+
+            default:
+                /* The library completes the other acknowledgements. */
+                break;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool waitForFlag( const bool * pFlag,
+                         uint32_t timeoutMs )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    uint32_t entryTimeMs = Clock_GetTimeMs();
+
+    /* Each iteration receives at most one packet, and blocks in the transport
+     * only until data arrives, so the flag is seen as soon as it is set. */
+    while( ( *pFlag == false ) &&
+           ( mqttStatus == MQTTSuccess ) &&
+           ( ( Clock_GetTimeMs() - entryTimeMs ) < timeoutMs ) )
+    {
+        mqttStatus = MQTT_ProcessLoop( &context, 0U );
+    }
+
+    return *pFlag;
+}
+
+/*-----------------------------------------------------------*/
+
+static int compareSamples( const void * pFirst,
+                           const void * pSecond )
+{
+    uint64_t first = *( const uint64_t * ) pFirst;
+    uint64_t second = *( const uint64_t * ) pSecond;
+
+    return ( first > second ) - ( first < second );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t percentileOf( const uint64_t * pSorted,
+                              size_t count,
+                              double percentile )
+{
+    double rank = ( percentile / 100.0 ) * ( double ) count;
+    size_t index = ( size_t ) rank;
+
+    /* The nearest rank is the rank rounded up, counting from 1. */
+    if( ( double ) index < rank )
+    {
+        index++;
+    }
+
+    if( index > 0U )
+    {
+        index--;
+    }
+
+    if( index >= count )
+    {
+        index = count - 1U;
+    }
+
+    return pSorted[ index ];
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeResults( const char * pName,
+                          size_t payloadSize,
+                          const uint64_t * pSorted,
+                          size_t count )
+{
+    FILE * pFile = NULL;
+    uint64_t sum = 0U;
+    size_t index = 0U;
+
+    for( index = 0U; index < count; index++ )
+    {
+        sum += pSorted[ index ];
+    }
+
+    /* The first result of a run replaces the results of the previous run. */
+    pFile = fopen( MQTT_LATENCY_RESULTS_PATH, ( resultsFileCreated == true ) ? "a" : "w" );
+    TEST_ASSERT_NOT_NULL( pFile );
+    resultsFileCreated = true;
+
+    fprintf( pFile,
+             "{\"sdkVersion\":\"%s\",\"benchmark\":\"%s\",\"payloadSize\":%lu,"
+             "\"iterations\":%lu,\"minUs\":%llu,\"meanUs\":%llu,\"p50Us\":%llu,"
+             "\"p90Us\":%llu,\"p99Us\":%llu,\"p999Us\":%llu,\"maxUs\":%llu}\n",
+             SDK_VERSION,
+             pName,
+             ( unsigned long ) payloadSize,
+             ( unsigned long ) count,
+             ( unsigned long long ) pSorted[ 0 ],
+             ( unsigned long long ) ( sum / count ),
+             ( unsigned long long ) percentileOf( pSorted, count, 50.0 ),
+             ( unsigned long long ) percentileOf( pSorted, count, 90.0 ),
+             ( unsigned long long ) percentileOf( pSorted, count, 99.0 ),
+             ( unsigned long long ) percentileOf( pSorted, count, 99.9 ),
+             ( unsigned long long ) pSorted[ count - 1U ] );
+
+    TEST_ASSERT_EQUAL( 0, fclose( pFile ) );
+
+    LogInfo( ( "%s with %lu byte payloads: p50=%llu us, p99=%llu us.",
+               pName,
+               ( unsigned long ) payloadSize,
+               ( unsigned long long ) percentileOf( pSorted, count, 50.0 ),
+               ( unsigned long long ) percentileOf( pSorted, count, 99.0 ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void measureRoundTrips( const char * pName,
+                               MQTTQoS_t qos,
+                               bool * pFlag )
+{
+    const size_t payloadSizes[] = MQTT_LATENCY_PAYLOAD_SIZES;
+    MQTTPublishInfo_t publishInfo;
+    size_t sizeIndex = 0U;
+    uint32_t iteration = 0U;
+    uint64_t startTimeUs = 0U;
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = qos;
+    publishInfo.pTopicName = TEST_MQTT_TOPIC;
+    publishInfo.topicNameLength = strlen( TEST_MQTT_TOPIC );
+    publishInfo.pPayload = payload;
+
+    for( sizeIndex = 0U; sizeIndex < ( sizeof( payloadSizes ) / sizeof( payloadSizes[ 0 ] ) ); sizeIndex++ )
+    {
+        publishInfo.payloadLength = payloadSizes[ sizeIndex ];
+
+        for( iteration = 0U; iteration < ( MQTT_LATENCY_WARMUP_ITERATIONS + MQTT_LATENCY_ITERATIONS ); iteration++ )
+        {
+            *pFlag = false;
+            globalPacketIdentifier = ( qos == MQTTQoS0 ) ? 0U : MQTT_GetPacketId( &context );
+
+            startTimeUs = Clock_GetTimeUs();
+            TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Publish( &context, &publishInfo, globalPacketIdentifier ) );
+            TEST_ASSERT_TRUE( waitForFlag( pFlag, MQTT_LATENCY_ROUND_TRIP_TIMEOUT_MS ) );
+
+            if( iteration >= MQTT_LATENCY_WARMUP_ITERATIONS )
+            {
+                samples[ iteration - MQTT_LATENCY_WARMUP_ITERATIONS ] = Clock_GetTimeUs() - startTimeUs;
+            }
+        }
+
+        qsort( samples, MQTT_LATENCY_ITERATIONS, sizeof( samples[ 0 ] ), compareSamples );
+        writeResults( pName, payloadSizes[ sizeIndex ], samples, MQTT_LATENCY_ITERATIONS );
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct timespec tp;
+    TransportInterface_t transport;
+    MQTTFixedBuffer_t networkBuffer;
+    MQTTConnectInfo_t connectInfo;
+    bool sessionPresent = false;
+    char clientIdBuffer[ sizeof( TEST_CLIENT_IDENTIFIER ) + MAX_RAND_NUMBER_DIGITS_FOR_CLIENT_ID ] = { 0 };
+
+    receivedSubAck = false;
+    receivedUnsubAck = false;
+    receivedPublish = false;
+    receivedPubAck = false;
+    receivedPubComp = false;
+    ( void ) memset( payload, 'x', sizeof( payload ) );
+
+    memset( &opensslCredentials, 0u, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pRootCaPath = SERVER_ROOT_CA_CERT_PATH;
+    opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
+    opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+
+    serverInfo.pHostName = BROKER_ENDPOINT;
+    serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
+    serverInfo.port = BROKER_PORT;
+
+    /* Get current time to seed pseudo random number generator. */
+    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
+
+    /* Seed pseudo random number generator with nanoseconds. */
+    srand( tp.tv_nsec );
+
+    /* Generate a random number to use in the client identifier. */
+    clientIdRandNumber = ( rand() % ( MAX_RAND_NUMBER_FOR_CLIENT_ID + 1u ) );
+
+    /* Establish a TCP connection with the server endpoint, then
+     * establish TLS session on top of TCP connection. */
+    memset( &networkContext, 0u, sizeof( NetworkContext_t ) );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_Connect( &networkContext,
+                                                         &serverInfo,
+                                                         &opensslCredentials,
+                                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                         TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+
+    /* Establish MQTT session on top of the TCP+TLS connection. */
+    transport.pNetworkContext = &networkContext;
+    transport.send = Openssl_Send;
+    transport.recv = Openssl_Recv;
+
+    networkBuffer.pBuffer = buffer;
+    networkBuffer.size = NETWORK_BUFFER_SIZE;
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Init( &context,
+                                               &transport,
+                                               Clock_GetTimeMs,
+                                               eventCallback,
+                                               &networkBuffer ) );
+
+    memset( &connectInfo, 0u, sizeof( MQTTConnectInfo_t ) );
+    connectInfo.cleanSession = true;
+    connectInfo.clientIdentifierLength =
+        snprintf( clientIdBuffer,
+                  sizeof( clientIdBuffer ),
+                  "%d%s", clientIdRandNumber,
+                  TEST_CLIENT_IDENTIFIER );
+    connectInfo.pClientIdentifier = clientIdBuffer;
+    connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Connect( &context,
+                                                  &connectInfo,
+                                                  NULL,
+                                                  CONNACK_RECV_TIMEOUT_MS,
+                                                  &sessionPresent ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* Terminate MQTT connection. */
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Disconnect( &context ) );
+
+    /* Terminate TLS session and TCP connection. */
+    ( void ) Openssl_Disconnect( &networkContext );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Measures the time from publishing at QoS 0 to a topic the test is
+ * subscribed to until the broker routes the message back.
+ */
+void test_MQTT_Latency_Qos0_Loopback( void )
+{
+    MQTTSubscribeInfo_t subscribeInfo;
+
+    ( void ) memset( &subscribeInfo, 0x00, sizeof( subscribeInfo ) );
+    subscribeInfo.qos = MQTTQoS0;
+    subscribeInfo.pTopicFilter = TEST_MQTT_TOPIC;
+    subscribeInfo.topicFilterLength = strlen( TEST_MQTT_TOPIC );
+
+    globalPacketIdentifier = MQTT_GetPacketId( &context );
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Subscribe( &context, &subscribeInfo, 1U, globalPacketIdentifier ) );
+    TEST_ASSERT_TRUE( waitForFlag( &receivedSubAck, MQTT_LATENCY_ROUND_TRIP_TIMEOUT_MS ) );
+
+    measureRoundTrips( "qos0_loopback", MQTTQoS0, &receivedPublish );
+
+    globalPacketIdentifier = MQTT_GetPacketId( &context );
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Unsubscribe( &context, &subscribeInfo, 1U, globalPacketIdentifier ) );
+    TEST_ASSERT_TRUE( waitForFlag( &receivedUnsubAck, MQTT_LATENCY_ROUND_TRIP_TIMEOUT_MS ) );
+}
+
+/**
+ * @brief Measures the time from publishing at QoS 1 until the PUBACK is
+ * received. The test is not subscribed, so no echo is received.
+ */
+void test_MQTT_Latency_Qos1_PubAck( void )
+{
+    measureRoundTrips( "qos1_puback", MQTTQoS1, &receivedPubAck );
+}
+
+/**
+ * @brief Measures the time from publishing at QoS 2 until the PUBCOMP is
+ * received, which includes the PUBREC and PUBREL exchange. The test is not
+ * subscribed, so no echo is received.
+ */
+void test_MQTT_Latency_Qos2_PubComp( void )
+{
+    measureRoundTrips( "qos2_pubcomp", MQTTQoS2, &receivedPubComp );
+}
@@ -0,0 +1,1325 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_reconnect_test.c
+ * @brief Reconnect benchmarks for the MQTT library when communicating with
+ * AWS IoT from a POSIX platform.
+ *
+ * Many simulated sessions publish at QoS 1 through a transport that wraps the
+ * OpenSSL transport and injects faults at configurable rates: dropped
+ * connections, latency spikes and partial reads. A session whose connection
+ * drops reconnects to its persistent session and sends its unacknowledged
+ * PUBLISHes again through #handlePublishResend, as the demos do.
+ *
+ * For every test, the time to recover from a drop, the number and size of the
+ * resent PUBLISHes and the CPU time of the TLS handshakes are written as one
+ * JSON object per line to #MQTT_RECONNECT_RESULTS_PATH. The sessions run in
+ * a single thread, so a reconnect storm measures the time for all of them to
+ * reconnect one after another.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+#include "unity.h"
+/* Include paths for public enums, structures, and macros. */
+#include "core_mqtt.h"
+#include "core_mqtt_state.h"
+
+/* Include OpenSSL implementation of transport interface. */
+#include "openssl_posix.h"
+
+/* Include clock for timer. */
+#include "clock.h"
+
+/* Include the store of in-flight PUBLISH messages used by the demos. */
+#include "inflight_store.h"
+
+/* Ensure that config macros, required for TLS connection, have been defined. */
+#ifndef BROKER_ENDPOINT
+    #error "BROKER_ENDPOINT should be defined for the MQTT integration tests."
+#endif
+
+#ifndef SERVER_ROOT_CA_CERT_PATH
+    #error "SERVER_ROOT_CA_CERT_PATH should be defined for the MQTT integration tests."
+#endif
+
+#ifndef CLIENT_CERT_PATH
+    #error "CLIENT_CERT_PATH should be defined for the MQTT integration tests."
+#endif
+
+#ifndef CLIENT_PRIVATE_KEY_PATH
+    #error "CLIENT_PRIVATE_KEY_PATH should be defined for the MQTT integration tests."
+#endif
+
+/**
+ * @brief Version of the SDK recorded with every result.
+ */
+#ifndef SDK_VERSION
+    #define SDK_VERSION    "unknown"
+#endif
+
+/**
+ * @brief File the results are written to. It is replaced by every run.
+ */
+#ifndef MQTT_RECONNECT_RESULTS_PATH
+    #define MQTT_RECONNECT_RESULTS_PATH    "mqtt_reconnect_results.jsonl"
+#endif
+
+/**
+ * @brief Number of simulated sessions, each with its own connection.
+ */
+#ifndef MQTT_RECONNECT_SESSION_COUNT
+    #define MQTT_RECONNECT_SESSION_COUNT    ( 8U )
+#endif
+
+/**
+ * @brief Number of rounds of the fault injection test. Every session that is
+ * not recovering publishes once per round.
+ */
+#ifndef MQTT_RECONNECT_ROUNDS
+    #define MQTT_RECONNECT_ROUNDS    ( 500U )
+#endif
+
+/**
+ * @brief Number of reconnect storms, in which every session is dropped at
+ * the same time.
+ */
+#ifndef MQTT_RECONNECT_STORM_COUNT
+    #define MQTT_RECONNECT_STORM_COUNT    ( 5U )
+#endif
+
+/**
+ * @brief Rates of the injected faults, in faults per million transport calls.
+ */
+#ifndef MQTT_RECONNECT_DROP_RATE_PPM
+    #define MQTT_RECONNECT_DROP_RATE_PPM             ( 2000U )
+#endif
+
+#ifndef MQTT_RECONNECT_LATENCY_SPIKE_RATE_PPM
+    #define MQTT_RECONNECT_LATENCY_SPIKE_RATE_PPM    ( 5000U )
+#endif
+
+#ifndef MQTT_RECONNECT_PARTIAL_READ_RATE_PPM
+    #define MQTT_RECONNECT_PARTIAL_READ_RATE_PPM     ( 100000U )
+#endif
+
+/**
+ * @brief Duration of an injected latency spike in milliseconds.
+ */
+#ifndef MQTT_RECONNECT_LATENCY_SPIKE_MS
+    #define MQTT_RECONNECT_LATENCY_SPIKE_MS    ( 100U )
+#endif
+
+/**
+ * @brief Seed of the faults, so that runs inject the same faults at the same
+ * transport calls as long as the broker responds the same way.
+ */
+#ifndef MQTT_RECONNECT_FAULT_SEED
+    #define MQTT_RECONNECT_FAULT_SEED    ( 1U )
+#endif
+
+/**
+ * @brief Number of unacknowledged PUBLISHes a session may have.
+ */
+#define MQTT_RECONNECT_WINDOW                   ( 8U )
+
+/**
+ * @brief Largest number of recovery times kept for the percentiles. Later
+ * recoveries are still counted.
+ */
+#define MQTT_RECONNECT_MAX_RECOVERIES           ( 4096U )
+
+/**
+ * @brief Longest time in milliseconds for all sessions to recover and
+ * receive the acknowledgements of their PUBLISHes once faults stop.
+ */
+#define MQTT_RECONNECT_DRAIN_TIMEOUT_MS         ( 30000U )
+
+/**
+ * @brief The rates of the faults are in parts of this number.
+ */
+#define FAULT_RATE_SCALE                        ( 1000000U )
+
+/**
+ * @brief Length of MQTT server host name.
+ */
+#define BROKER_ENDPOINT_LENGTH                  ( ( uint16_t ) ( sizeof( BROKER_ENDPOINT ) - 1 ) )
+
+/**
+ * @brief Topic the benchmarks publish to.
+ */
+#define TEST_MQTT_TOPIC                         "/iot/integration/reconnect"
+
+/**
+ * @brief Payload of every PUBLISH.
+ */
+#define TEST_MQTT_PAYLOAD                       "Reconnect benchmark message."
+
+/**
+ * @brief Size of the network buffer of every session.
+ */
+#define NETWORK_BUFFER_SIZE                     ( 256U )
+
+/**
+ * @brief Client identifier prefix of the sessions, followed by the session
+ * index.
+ */
+#define TEST_CLIENT_IDENTIFIER                  "MQTT-Reconnect"
+
+/**
+ * @brief Size of a client identifier buffer, with room for the random
+ * number before and the session index after #TEST_CLIENT_IDENTIFIER.
+ */
+#define CLIENT_IDENTIFIER_BUFFER_SIZE           ( sizeof( TEST_CLIENT_IDENTIFIER ) + 12U )
+
+/**
+ * @brief Largest random number prefixed to the client identifiers.
+ */
+#define MAX_RAND_NUMBER_FOR_CLIENT_ID           ( 999u )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ * It is short so that idle sessions do not hold up the others.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS          ( 10U )
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milliseconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS                 ( 2000U )
+
+/**
+ * @brief Keep alive period in seconds for MQTT connection.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS        ( 60U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A simulated session and its persistent MQTT session.
+ */
+typedef struct ReconnectSession
+{
+    NetworkContext_t networkContext;  /**< @brief The TLS connection. */
+    MQTTContext_t context;            /**< @brief The MQTT context. */
+    uint8_t buffer[ NETWORK_BUFFER_SIZE ];                                 /**< @brief The network buffer. */
+    InflightStore_t outgoingPublishes;                                     /**< @brief PUBLISHes waiting for their PUBACK. */
+    uint8_t outgoingPublishArena[ INFLIGHT_STORE_ARENA_SIZE( MQTT_RECONNECT_WINDOW ) ]; /**< @brief The memory of outgoingPublishes. */
+    char clientIdentifier[ CLIENT_IDENTIFIER_BUFFER_SIZE ];                /**< @brief The client identifier. */
+    uint16_t clientIdentifierLength;  /**< @brief Length of clientIdentifier. */
+    bool connected;                   /**< @brief Whether the TLS connection is open. */
+    bool dropped;                     /**< @brief Whether a drop was injected, which fails every transport call until the session reconnects. */
+    bool recovering;                  /**< @brief Whether the session is recovering from a drop. */
+    uint64_t recoveryStartUs;         /**< @brief When the drop was noticed. */
+} ReconnectSession_t;
+
+/**
+ * @brief Measurements of a test.
+ */
+typedef struct ReconnectStats
+{
+    uint32_t publishes;        /**< @brief PUBLISHes sent for the first time. */
+    uint32_t drops;            /**< @brief Injected dropped connections. */
+    uint32_t latencySpikes;    /**< @brief Injected latency spikes. */
+    uint32_t partialReads;     /**< @brief Injected partial reads. */
+    uint32_t recoveries;       /**< @brief Recoveries from a drop. */
+    uint32_t resentPublishes;  /**< @brief PUBLISHes sent again by #handlePublishResend. */
+    uint64_t resentBytes;      /**< @brief Size of the resent PUBLISH packets. */
+    uint32_t tlsHandshakes;    /**< @brief Successful TLS handshakes. */
+    uint64_t tlsCpuUs;         /**< @brief CPU time of the TLS handshakes. */
+    uint64_t tlsWallUs;        /**< @brief Elapsed time of the TLS handshakes. */
+    size_t recoveryCount;      /**< @brief Number of recovery times kept. */
+    size_t stormCount;         /**< @brief Number of storm recovery times kept. */
+} ReconnectStats_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The simulated sessions.
+ */
+static ReconnectSession_t sessions[ MQTT_RECONNECT_SESSION_COUNT ];
+
+/**
+ * @brief Measurements of the current test.
+ */
+static ReconnectStats_t stats;
+
+/**
+ * @brief Time in microseconds from noticing a drop until all the PUBLISHes
+ * of the session are acknowledged again.
+ */
+static uint64_t recoverySamples[ MQTT_RECONNECT_MAX_RECOVERIES ];
+
+/**
+ * @brief Time in microseconds from dropping every session until all of them
+ * have recovered.
+ */
+static uint64_t stormSamples[ MQTT_RECONNECT_STORM_COUNT ];
+
+/**
+ * @brief Whether faults are injected. They are not injected while a session
+ * connects, so that the recovery time measures a single reconnect.
+ */
+static bool injectFaults = false;
+
+/**
+ * @brief Rate of each fault in faults per #FAULT_RATE_SCALE transport calls.
+ */
+static uint32_t dropRatePpm = 0U;
+static uint32_t latencySpikeRatePpm = 0U;
+static uint32_t partialReadRatePpm = 0U;
+
+/**
+ * @brief State of the pseudo random faults.
+ */
+static unsigned int faultSeed = MQTT_RECONNECT_FAULT_SEED;
+
+/**
+ * @brief Information of the broker to connect to.
+ */
+static ServerInfo_t serverInfo;
+
+/**
+ * @brief Credentials of the TLS connections.
+ */
+static OpensslCredentials_t opensslCredentials;
+
+/**
+ * @brief TLS context shared by every connection, so that the credentials are
+ * not parsed again by every reconnect.
+ */
+static OpensslTlsContext_t tlsContext;
+
+/**
+ * @brief Store of the TLS session of the broker, shared by every connection.
+ */
+static OpensslSessionStore_t sessionStore;
+
+/**
+ * @brief The serialized TLS session saved by #sessionStore.
+ */
+static uint8_t savedTlsSession[ OPENSSL_MAX_SESSION_LENGTH ];
+
+/**
+ * @brief Length of #savedTlsSession, 0 when no session is saved.
+ */
+static size_t savedTlsSessionLength = 0U;
+
+/**
+ * @brief Whether the results file has been created by this run.
+ */
+static bool resultsFileCreated = false;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Decide whether to inject a fault.
+ *
+ * @param[in] ratePpm The rate of the fault in faults per #FAULT_RATE_SCALE
+ * transport calls.
+ *
+ * @return true to inject the fault.
+ */
+static bool faultHappens( uint32_t ratePpm );
+
+/**
+ * @brief Find the session of a network context.
+ *
+ * @param[in] pNetworkContext The network context.
+ *
+ * @return The session.
+ */
+static ReconnectSession_t * sessionOfNetworkContext( const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Find the session of an MQTT context.
+ *
+ * @param[in] pContext The MQTT context.
+ *
+ * @return The session.
+ */
+static ReconnectSession_t * sessionOfContext( const MQTTContext_t * pContext );
+
+/**
+ * @brief Inject the faults common to sending and receiving: a latency spike,
+ * and a drop that closes the connection as #failedRecv of the system test
+ * does.
+ *
+ * @param[in] pSession The session of the transport call.
+ *
+ * @return true if the connection is dropped.
+ */
+static bool injectFault( ReconnectSession_t * pSession );
+
+/**
+ * @brief Transport receive function that injects faults before calling
+ * #Openssl_Recv. A partial read receives fewer bytes than requested.
+ *
+ * @param[in] pNetworkContext The network context of a session.
+ * @param[out] pBuffer Buffer to receive into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes received, or -1 once the connection is dropped.
+ */
+static int32_t faultyRecv( const NetworkContext_t * pNetworkContext,
+                           void * pBuffer,
+                           size_t bytesToRecv );
+
+/**
+ * @brief Transport send function that injects faults before calling
+ * #Openssl_Send.
+ *
+ * @param[in] pNetworkContext The network context of a session.
+ * @param[in] pBuffer Data to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return Number of bytes sent, or -1 once the connection is dropped.
+ */
+static int32_t faultySend( const NetworkContext_t * pNetworkContext,
+                           const void * pBuffer,
+                           size_t bytesToSend );
+
+/**
+ * @brief Load the TLS session saved in #savedTlsSession.
+ *
+ * @param[in] pStoreContext Unused.
+ * @param[out] pBuffer Buffer to copy the session into.
+ * @param[in] bufferSize Size of @p pBuffer.
+ *
+ * @return Length of the session, 0 if none is saved.
+ */
+static size_t loadTlsSession( void * pStoreContext,
+                              uint8_t * pBuffer,
+                              size_t bufferSize );
+
+/**
+ * @brief Save a TLS session in #savedTlsSession.
+ *
+ * @param[in] pStoreContext Unused.
+ * @param[in] pSession The serialized session.
+ * @param[in] sessionLength Length of @p pSession.
+ */
+static void saveTlsSession( void * pStoreContext,
+                            const uint8_t * pSession,
+                            size_t sessionLength );
+
+/**
+ * @brief The application callback function that is expected to be invoked by the
+ * MQTT library for incoming publish and incoming acks received over the network.
+ *
+ * @param[in] pContext MQTT context pointer.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Get the CPU time of the calling thread in microseconds.
+ *
+ * @return The CPU time.
+ */
+static uint64_t getThreadCpuTimeUs( void );
+
+/**
+ * @brief Connect a session with TLS and resume its persistent MQTT session.
+ * Unacknowledged PUBLISHes are sent again if the broker has the session, and
+ * discarded otherwise.
+ *
+ * @param[in] pSession The session.
+ * @param[in] resumeTlsSession Whether to resume the TLS session of the
+ * broker with an abbreviated handshake.
+ *
+ * @return true if the session is connected.
+ */
+static bool connectSession( ReconnectSession_t * pSession,
+                            bool resumeTlsSession );
+
+/**
+ * @brief Send the unacknowledged PUBLISHes of a session again, as the demos
+ * do after resuming a persistent session, and count them.
+ *
+ * @param[in] pSession The session.
+ *
+ * @return true if every PUBLISH was sent.
+ */
+static bool handlePublishResend( ReconnectSession_t * pSession );
+
+/**
+ * @brief Start recovering a session whose connection dropped.
+ *
+ * @param[in] pSession The session.
+ */
+static void startRecovery( ReconnectSession_t * pSession );
+
+/**
+ * @brief Finish recovering a session once all its PUBLISHes are
+ * acknowledged, and record the recovery time.
+ *
+ * @param[in] pSession The session.
+ *
+ * @return true if the session is not recovering.
+ */
+static bool checkRecovered( ReconnectSession_t * pSession );
+
+/**
+ * @brief Publish a new message at QoS 1 from a session, if its window is
+ * not full.
+ *
+ * @param[in] pSession The session.
+ *
+ * @return true unless the connection dropped.
+ */
+static bool publishNext( ReconnectSession_t * pSession );
+
+/**
+ * @brief Let every session reconnect if it dropped, then receive its
+ * packets once.
+ *
+ * @param[in] resumeTlsSession Whether reconnects resume the TLS session.
+ */
+static void serviceSessions( bool resumeTlsSession );
+
+/**
+ * @brief Service the sessions until all have recovered and every PUBLISH is
+ * acknowledged.
+ *
+ * @param[in] resumeTlsSession Whether reconnects resume the TLS session.
+ * @param[in] timeoutMs Longest time to wait.
+ *
+ * @return true if every session recovered in time.
+ */
+static bool drainSessions( bool resumeTlsSession,
+                           uint32_t timeoutMs );
+
+/**
+ * @brief Measure reconnect storms, in which every session is dropped at once
+ * with a full window of PUBLISHes, and write the results.
+ *
+ * @param[in] pName Name of the measurement in the results.
+ * @param[in] resumeTlsSession Whether reconnects resume the TLS session.
+ */
+static void measureStorms( const char * pName,
+                           bool resumeTlsSession );
+
+/**
+ * @brief Write the measurements of a test to the results file.
+ *
+ * @param[in] pName Name of the measurement.
+ */
+static void writeResults( const char * pName );
+
+/**
+ * @brief Get a percentile of sorted values by the nearest-rank method.
+ *
+ * @param[in] pSorted Values in ascending order.
+ * @param[in] count Number of values, which may be 0.
+ * @param[in] percentile The percentile, such as 99.9.
+ *
+ * @return The value of the percentile, or 0 if there are no values.
+ */
+static uint64_t percentileOf( const uint64_t * pSorted,
+                              size_t count,
+                              double percentile );
+
+/**
+ * @brief qsort comparison of two uint64_t values.
+ *
+ * @param[in] pFirst The first value.
+ * @param[in] pSecond The second value.
+ *
+ * @return Negative, zero or positive as the first value is smaller than,
+ * equal to or larger than the second.
+ */
+static int compareSamples( const void * pFirst,
+                           const void * pSecond );
+
+/*-----------------------------------------------------------*/
+
+static bool faultHappens( uint32_t ratePpm )
+{
+    return ( ratePpm > 0U ) &&
+           ( ( ( uint32_t ) rand_r( &faultSeed ) % FAULT_RATE_SCALE ) < ratePpm );
+}
+
+/*-----------------------------------------------------------*/
+
+static ReconnectSession_t * sessionOfNetworkContext( const NetworkContext_t * pNetworkContext )
+{
+    ReconnectSession_t * pSession = NULL;
+    size_t index = 0U;
+
+    for( index = 0U; ( index < MQTT_RECONNECT_SESSION_COUNT ) && ( pSession == NULL ); index++ )
+    {
+        if( &sessions[ index ].networkContext == pNetworkContext )
+        {
+            pSession = &sessions[ index ];
+        }
+    }
+
+    assert( pSession != NULL );
+
+    return pSession;
+}
+
+/*-----------------------------------------------------------*/
+
+static ReconnectSession_t * sessionOfContext( const MQTTContext_t * pContext )
+{
+    ReconnectSession_t * pSession = NULL;
+    size_t index = 0U;
+
+    for( index = 0U; ( index < MQTT_RECONNECT_SESSION_COUNT ) && ( pSession == NULL ); index++ )
+    {
+        if( &sessions[ index ].context == pContext )
+        {
+            pSession = &sessions[ index ];
+        }
+    }
+
+    assert( pSession != NULL );
+
+    return pSession;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool injectFault( ReconnectSession_t * pSession )
+{
+    if( ( injectFaults == true ) && ( pSession->dropped == false ) )
+    {
+        if( faultHappens( latencySpikeRatePpm ) == true )
+        {
+            stats.latencySpikes++;
+            Clock_SleepMs( MQTT_RECONNECT_LATENCY_SPIKE_MS );
+        }
+
+        if( faultHappens( dropRatePpm ) == true )
+        {
+            stats.drops++;
+            pSession->dropped = true;
+
+            /* Terminate the TLS+TCP connection with the broker. */
+            ( void ) Openssl_Disconnect( &pSession->networkContext );
+            pSession->connected = false;
+        }
+    }
+
+    return pSession->dropped;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t faultyRecv( const NetworkContext_t * pNetworkContext,
+                           void * pBuffer,
+                           size_t bytesToRecv )
+{
+    ReconnectSession_t * pSession = sessionOfNetworkContext( pNetworkContext );
+    int32_t bytesReceived = -1;
+    size_t bytesToRead = bytesToRecv;
+
+    if( injectFault( pSession ) == false )
+    {
+        /* The MQTT library must keep reading until the packet is complete. */
+        if( ( injectFaults == true ) &&
+            ( bytesToRecv > 1U ) &&
+            ( faultHappens( partialReadRatePpm ) == true ) )
+        {
+            stats.partialReads++;
+            bytesToRead = 1U + ( ( size_t ) rand_r( &faultSeed ) % ( bytesToRecv - 1U ) );
+        }
+
+        bytesReceived = Openssl_Recv( pNetworkContext, pBuffer, bytesToRead );
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t faultySend( const NetworkContext_t * pNetworkContext,
+                           const void * pBuffer,
+                           size_t bytesToSend )
+{
+    ReconnectSession_t * pSession = sessionOfNetworkContext( pNetworkContext );
+    int32_t bytesSent = -1;
+
+    if( injectFault( pSession ) == false )
+    {
+        bytesSent = Openssl_Send( pNetworkContext, pBuffer, bytesToSend );
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t loadTlsSession( void * pStoreContext,
+                              uint8_t * pBuffer,
+                              size_t bufferSize )
+{
+    size_t sessionLength = 0U;
+
+    ( void ) pStoreContext;
+
+    if( savedTlsSessionLength <= bufferSize )
+    {
+        ( void ) memcpy( pBuffer, savedTlsSession, savedTlsSessionLength );
+        sessionLength = savedTlsSessionLength;
+    }
+
+    return sessionLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void saveTlsSession( void * pStoreContext,
+                            const uint8_t * pSession,
+                            size_t sessionLength )
+{
+    ( void ) pStoreContext;
+
+    if( sessionLength <= sizeof( savedTlsSession ) )
+    {
+        ( void ) memcpy( savedTlsSession, pSession, sessionLength );
+        savedTlsSessionLength = sessionLength;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    ReconnectSession_t * pSession = NULL;
+
+    assert( pContext != NULL );
+    assert( pPacketInfo != NULL );
+    assert( pDeserializedInfo != NULL );
+
+    if( pPacketInfo->type == MQTT_PACKET_TYPE_PUBACK )
+    {
+        pSession = sessionOfContext( pContext );
+
+        /* A PUBACK of a resent PUBLISH may arrive after the PUBACK of the
+         * original, so an unknown packet identifier is not an error. */
+        ( void ) InflightStore_Release( &pSession->outgoingPublishes,
+                                        pDeserializedInfo->packetIdentifier );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t getThreadCpuTimeUs( void )
+{
+    struct timespec tp;
+
+    ( void ) clock_gettime( CLOCK_THREAD_CPUTIME_ID, &tp );
+
+    return ( ( uint64_t ) tp.tv_sec * 1000000U ) + ( ( uint64_t ) tp.tv_nsec / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool connectSession( ReconnectSession_t * pSession,
+                            bool resumeTlsSession )
+{
+    OpensslCredentials_t credentials = opensslCredentials;
+    MQTTConnectInfo_t connectInfo;
+    bool sessionPresent = false;
+    bool connected = false;
+    uint64_t cpuStartUs = 0U;
+    uint64_t wallStartUs = 0U;
+    bool savedInjectFaults = injectFaults;
+
+    /* Without the session store, the handshake is a full handshake. */
+    if( resumeTlsSession == false )
+    {
+        credentials.pSessionStore = NULL;
+    }
+
+    injectFaults = false;
+
+    cpuStartUs = getThreadCpuTimeUs();
+    wallStartUs = Clock_GetTimeUs();
+
+    if( Openssl_Connect( &pSession->networkContext,
+                         &serverInfo,
+                         &credentials,
+                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                         TRANSPORT_SEND_RECV_TIMEOUT_MS ) == OPENSSL_SUCCESS )
+    {
+        stats.tlsCpuUs += getThreadCpuTimeUs() - cpuStartUs;
+        stats.tlsWallUs += Clock_GetTimeUs() - wallStartUs;
+        stats.tlsHandshakes++;
+        pSession->connected = true;
+        pSession->dropped = false;
+
+        ( void ) memset( &connectInfo, 0x00, sizeof( connectInfo ) );
+        connectInfo.cleanSession = false;
+        connectInfo.pClientIdentifier = pSession->clientIdentifier;
+        connectInfo.clientIdentifierLength = pSession->clientIdentifierLength;
+        connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+
+        if( MQTT_Connect( &pSession->context,
+                          &connectInfo,
+                          NULL,
+                          CONNACK_RECV_TIMEOUT_MS,
+                          &sessionPresent ) == MQTTSuccess )
+        {
+            if( sessionPresent == true )
+            {
+                connected = handlePublishResend( pSession );
+            }
+            else
+            {
+                /* The broker has no session, so no PUBACK will come. */
+                InflightStore_Clear( &pSession->outgoingPublishes );
+                connected = true;
+            }
+        }
+    }
+
+    injectFaults = savedInjectFaults;
+
+    return connected;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool handlePublishResend( ReconnectSession_t * pSession )
+{
+    bool status = true;
+    MQTTStateCursor_t cursor = MQTT_STATE_CURSOR_INITIALIZER;
+    uint16_t packetIdToResend = MQTT_PACKET_ID_INVALID;
+    InflightPublish_t * pPublish = NULL;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+
+    packetIdToResend = MQTT_PublishToResend( &pSession->context, &cursor );
+
+    while( ( packetIdToResend != MQTT_PACKET_ID_INVALID ) && ( status == true ) )
+    {
+        pPublish = InflightStore_Find( &pSession->outgoingPublishes, packetIdToResend );
+
+        if( pPublish == NULL )
+        {
+            LogError( ( "Packet id %u requires resend, but was not found in "
+                        "outgoingPublishes.",
+                        packetIdToResend ) );
+            status = false;
+        }
+        else
+        {
+            pPublish->pubInfo.dup = true;
+
+            if( MQTT_Publish( &pSession->context,
+                              &pPublish->pubInfo,
+                              pPublish->packetId ) == MQTTSuccess )
+            {
+                ( void ) MQTT_GetPublishPacketSize( &pPublish->pubInfo,
+                                                    &remainingLength,
+                                                    &packetSize );
+                stats.resentPublishes++;
+                stats.resentBytes += packetSize;
+            }
+            else
+            {
+                status = false;
+            }
+
+            packetIdToResend = MQTT_PublishToResend( &pSession->context, &cursor );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void startRecovery( ReconnectSession_t * pSession )
+{
+    if( pSession->recovering == false )
+    {
+        pSession->recovering = true;
+        pSession->recoveryStartUs = Clock_GetTimeUs();
+        stats.recoveries++;
+    }
+
+    /* A failure that is not an injected drop also needs a new connection. */
+    pSession->dropped = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool checkRecovered( ReconnectSession_t * pSession )
+{
+    size_t cursor = 0U;
+
+    if( ( pSession->recovering == true ) &&
+        ( pSession->dropped == false ) &&
+        ( InflightStore_Next( &pSession->outgoingPublishes, &cursor ) == NULL ) )
+    {
+        if( stats.recoveryCount < MQTT_RECONNECT_MAX_RECOVERIES )
+        {
+            recoverySamples[ stats.recoveryCount ] = Clock_GetTimeUs() - pSession->recoveryStartUs;
+            stats.recoveryCount++;
+        }
+
+        pSession->recovering = false;
+    }
+
+    return( pSession->recovering == false );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool publishNext( ReconnectSession_t * pSession )
+{
+    bool status = true;
+    InflightPublish_t * pPublish = NULL;
+    uint16_t packetId = MQTT_GetPacketId( &pSession->context );
+
+    if( InflightStore_Allocate( &pSession->outgoingPublishes,
+                                packetId,
+                                &pPublish ) == InflightStoreSuccess )
+    {
+        pPublish->pubInfo.qos = MQTTQoS1;
+        pPublish->pubInfo.pTopicName = TEST_MQTT_TOPIC;
+        pPublish->pubInfo.topicNameLength = ( uint16_t ) strlen( TEST_MQTT_TOPIC );
+        pPublish->pubInfo.pPayload = TEST_MQTT_PAYLOAD;
+        pPublish->pubInfo.payloadLength = strlen( TEST_MQTT_PAYLOAD );
+
+        if( MQTT_Publish( &pSession->context, &pPublish->pubInfo, packetId ) == MQTTSuccess )
+        {
+            stats.publishes++;
+        }
+        else
+        {
+            /* As in the demos, a PUBLISH that could not be sent is not kept. */
+            ( void ) InflightStore_Release( &pSession->outgoingPublishes, packetId );
+            status = false;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void serviceSessions( bool resumeTlsSession )
+{
+    ReconnectSession_t * pSession = NULL;
+    size_t index = 0U;
+
+    for( index = 0U; index < MQTT_RECONNECT_SESSION_COUNT; index++ )
+    {
+        pSession = &sessions[ index ];
+
+        if( pSession->dropped == true )
+        {
+            startRecovery( pSession );
+
+            if( pSession->connected == true )
+            {
+                ( void ) Openssl_Disconnect( &pSession->networkContext );
+                pSession->connected = false;
+            }
+
+            /* A failed reconnect is tried again on the next call. */
+            if( connectSession( pSession, resumeTlsSession ) == false )
+            {
+                pSession->dropped = true;
+            }
+        }
+
+        if( ( pSession->dropped == false ) &&
+            ( MQTT_ProcessLoop( &pSession->context, 0U ) != MQTTSuccess ) )
+        {
+            startRecovery( pSession );
+        }
+
+        ( void ) checkRecovered( pSession );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool drainSessions( bool resumeTlsSession,
+                           uint32_t timeoutMs )
+{
+    uint32_t entryTimeMs = Clock_GetTimeMs();
+    bool drained = false;
+    size_t index = 0U;
+    size_t cursor = 0U;
+
+    while( ( drained == false ) &&
+           ( ( Clock_GetTimeMs() - entryTimeMs ) < timeoutMs ) )
+    {
+        serviceSessions( resumeTlsSession );
+
+        drained = true;
+
+        for( index = 0U; index < MQTT_RECONNECT_SESSION_COUNT; index++ )
+        {
+            cursor = 0U;
+
+            if( ( sessions[ index ].recovering == true ) ||
+                ( InflightStore_Next( &sessions[ index ].outgoingPublishes, &cursor ) != NULL ) )
+            {
+                drained = false;
+            }
+        }
+    }
+
+    return drained;
+}
+
+/*-----------------------------------------------------------*/
+
+static void measureStorms( const char * pName,
+                           bool resumeTlsSession )
+{
+    uint32_t storm = 0U;
+    uint32_t publish = 0U;
+    size_t index = 0U;
+    uint64_t stormStartUs = 0U;
+
+    for( storm = 0U; storm < MQTT_RECONNECT_STORM_COUNT; storm++ )
+    {
+        /* Fill the windows, so that every session has PUBLISHes to resend. */
+        for( index = 0U; index < MQTT_RECONNECT_SESSION_COUNT; index++ )
+        {
+            for( publish = 0U; publish < MQTT_RECONNECT_WINDOW; publish++ )
+            {
+                TEST_ASSERT_TRUE( publishNext( &sessions[ index ] ) );
+            }
+        }
+
+        stormStartUs = Clock_GetTimeUs();
+
+        for( index = 0U; index < MQTT_RECONNECT_SESSION_COUNT; index++ )
+        {
+            stats.drops++;
+            ( void ) Openssl_Disconnect( &sessions[ index ].networkContext );
+            sessions[ index ].connected = false;
+            startRecovery( &sessions[ index ] );
+        }
+
+        TEST_ASSERT_TRUE( drainSessions( resumeTlsSession, MQTT_RECONNECT_DRAIN_TIMEOUT_MS ) );
+
+        stormSamples[ stats.stormCount ] = Clock_GetTimeUs() - stormStartUs;
+        stats.stormCount++;
+    }
+
+    writeResults( pName );
+}
+
+/*-----------------------------------------------------------*/
+
+static int compareSamples( const void * pFirst,
+                           const void * pSecond )
+{
+    uint64_t first = *( const uint64_t * ) pFirst;
+    uint64_t second = *( const uint64_t * ) pSecond;
+
+    return ( first > second ) - ( first < second );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t percentileOf( const uint64_t * pSorted,
+                              size_t count,
+                              double percentile )
+{
+    double rank = ( percentile / 100.0 ) * ( double ) count;
+    size_t index = ( size_t ) rank;
+    uint64_t value = 0U;
+
+    /* The nearest rank is the rank rounded up, counting from 1. */
+    if( ( double ) index < rank )
+    {
+        index++;
+    }
+
+    if( index > 0U )
+    {
+        index--;
+    }
+
+    if( index >= count )
+    {
+        index = count - 1U;
+    }
+
+    if( count > 0U )
+    {
+        value = pSorted[ index ];
+    }
+
+    return value;
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeResults( const char * pName )
+{
+    FILE * pFile = NULL;
+    uint64_t tlsCpuMeanUs = 0U;
+    uint64_t tlsWallMeanUs = 0U;
+
+    qsort( recoverySamples, stats.recoveryCount, sizeof( recoverySamples[ 0 ] ), compareSamples );
+    qsort( stormSamples, stats.stormCount, sizeof( stormSamples[ 0 ] ), compareSamples );
+
+    if( stats.tlsHandshakes > 0U )
+    {
+        tlsCpuMeanUs = stats.tlsCpuUs / stats.tlsHandshakes;
+        tlsWallMeanUs = stats.tlsWallUs / stats.tlsHandshakes;
+    }
+
+    /* The first result of a run replaces the results of the previous run. */
+    pFile = fopen( MQTT_RECONNECT_RESULTS_PATH, ( resultsFileCreated == true ) ? "a" : "w" );
+    TEST_ASSERT_NOT_NULL( pFile );
+    resultsFileCreated = true;
+
+    fprintf( pFile,
+             "{\"sdkVersion\":\"%s\",\"benchmark\":\"%s\",\"sessions\":%u,"
+             "\"publishes\":%lu,\"drops\":%lu,\"latencySpikes\":%lu,\"partialReads\":%lu,"
+             "\"recoveries\":%lu,\"recoveryP50Us\":%llu,\"recoveryP99Us\":%llu,\"recoveryMaxUs\":%llu,"
+             "\"stormP50Us\":%llu,\"stormMaxUs\":%llu,"
+             "\"resentPublishes\":%lu,\"resentBytes\":%llu,"
+             "\"tlsHandshakes\":%lu,\"tlsCpuUs\":%llu,\"tlsCpuMeanUs\":%llu,\"tlsWallMeanUs\":%llu}\n",
+             SDK_VERSION,
+             pName,
+             ( unsigned int ) MQTT_RECONNECT_SESSION_COUNT,
+             ( unsigned long ) stats.publishes,
+             ( unsigned long ) stats.drops,
+             ( unsigned long ) stats.latencySpikes,
+             ( unsigned long ) stats.partialReads,
+             ( unsigned long ) stats.recoveries,
+             ( unsigned long long ) percentileOf( recoverySamples, stats.recoveryCount, 50.0 ),
+             ( unsigned long long ) percentileOf( recoverySamples, stats.recoveryCount, 99.0 ),
+             ( unsigned long long ) percentileOf( recoverySamples, stats.recoveryCount, 100.0 ),
+             ( unsigned long long ) percentileOf( stormSamples, stats.stormCount, 50.0 ),
+             ( unsigned long long ) percentileOf( stormSamples, stats.stormCount, 100.0 ),
+             ( unsigned long ) stats.resentPublishes,
+             ( unsigned long long ) stats.resentBytes,
+             ( unsigned long ) stats.tlsHandshakes,
+             ( unsigned long long ) stats.tlsCpuUs,
+             ( unsigned long long ) tlsCpuMeanUs,
+             ( unsigned long long ) tlsWallMeanUs );
+
+    TEST_ASSERT_EQUAL( 0, fclose( pFile ) );
+
+    LogInfo( ( "%s: %lu recoveries, p99=%llu us, %lu PUBLISHes resent, "
+               "%llu us CPU per TLS handshake.",
+               pName,
+               ( unsigned long ) stats.recoveries,
+               ( unsigned long long ) percentileOf( recoverySamples, stats.recoveryCount, 99.0 ),
+               ( unsigned long ) stats.resentPublishes,
+               ( unsigned long long ) tlsCpuMeanUs ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct timespec tp;
+    TransportInterface_t transport;
+    MQTTFixedBuffer_t networkBuffer;
+    ReconnectSession_t * pSession = NULL;
+    int clientIdRandNumber = 0;
+    size_t index = 0U;
+
+    ( void ) memset( &stats, 0x00, sizeof( stats ) );
+    ( void ) memset( sessions, 0x00, sizeof( sessions ) );
+    injectFaults = false;
+    faultSeed = MQTT_RECONNECT_FAULT_SEED;
+    savedTlsSessionLength = 0U;
+
+    sessionStore.load = loadTlsSession;
+    sessionStore.save = saveTlsSession;
+    sessionStore.pStoreContext = NULL;
+
+    memset( &opensslCredentials, 0u, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pRootCaPath = SERVER_ROOT_CA_CERT_PATH;
+    opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
+    opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+    opensslCredentials.pSessionStore = &sessionStore;
+
+    /* Parse the credentials once for every connection of the test. */
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+    opensslCredentials.pTlsContext = &tlsContext;
+
+    serverInfo.pHostName = BROKER_ENDPOINT;
+    serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
+    serverInfo.port = BROKER_PORT;
+
+    /* Get current time to seed pseudo random number generator. */
+    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
+
+    /* Seed pseudo random number generator with nanoseconds. */
+    srand( tp.tv_nsec );
+
+    /* Generate a random number to use in the client identifiers. */
+    clientIdRandNumber = ( rand() % ( MAX_RAND_NUMBER_FOR_CLIENT_ID + 1u ) );
+
+    transport.send = faultySend;
+    transport.recv = faultyRecv;
+
+    for( index = 0U; index < MQTT_RECONNECT_SESSION_COUNT; index++ )
+    {
+        pSession = &sessions[ index ];
+
+        pSession->clientIdentifierLength =
+            ( uint16_t ) snprintf( pSession->clientIdentifier,
+                                   sizeof( pSession->clientIdentifier ),
+                                   "%d%s%lu", clientIdRandNumber,
+                                   TEST_CLIENT_IDENTIFIER,
+                                   ( unsigned long ) index );
+
+        TEST_ASSERT_EQUAL( InflightStoreSuccess,
+                           InflightStore_Init( &pSession->outgoingPublishes,
+                                               pSession->outgoingPublishArena,
+                                               sizeof( pSession->outgoingPublishArena ),
+                                               MQTT_RECONNECT_WINDOW ) );
+
+        transport.pNetworkContext = &pSession->networkContext;
+        networkBuffer.pBuffer = pSession->buffer;
+        networkBuffer.size = NETWORK_BUFFER_SIZE;
+
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Init( &pSession->context,
+                                                   &transport,
+                                                   Clock_GetTimeMs,
+                                                   eventCallback,
+                                                   &networkBuffer ) );
+
+        /* Start the persistent session the session resumes after a drop. */
+        TEST_ASSERT_TRUE( connectSession( pSession, true ) );
+    }
+
+    /* Only the reconnects are measured. */
+    stats.tlsHandshakes = 0U;
+    stats.tlsCpuUs = 0U;
+    stats.tlsWallUs = 0U;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    size_t index = 0U;
+
+    injectFaults = false;
+
+    for( index = 0U; index < MQTT_RECONNECT_SESSION_COUNT; index++ )
+    {
+        if( sessions[ index ].connected == true )
+        {
+            /* Terminate MQTT connection. */
+            ( void ) MQTT_Disconnect( &sessions[ index ].context );
+
+            /* Terminate TLS session and TCP connection. */
+            ( void ) Openssl_Disconnect( &sessions[ index ].networkContext );
+        }
+    }
+
+    ( void ) Openssl_TlsContextCleanup( &tlsContext );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Publishes from every session while injecting drops, latency spikes
+ * and partial reads at the configured rates, and verifies that every session
+ * recovers and every PUBLISH is acknowledged once the faults stop.
+ */
+void test_MQTT_Reconnect_Random_Faults( void )
+{
+    uint32_t round = 0U;
+    size_t index = 0U;
+
+    dropRatePpm = MQTT_RECONNECT_DROP_RATE_PPM;
+    latencySpikeRatePpm = MQTT_RECONNECT_LATENCY_SPIKE_RATE_PPM;
+    partialReadRatePpm = MQTT_RECONNECT_PARTIAL_READ_RATE_PPM;
+    injectFaults = true;
+
+    for( round = 0U; round < MQTT_RECONNECT_ROUNDS; round++ )
+    {
+        for( index = 0U; index < MQTT_RECONNECT_SESSION_COUNT; index++ )
+        {
+            /* A recovering session waits for its resent PUBLISHes first. */
+            if( ( sessions[ index ].recovering == false ) &&
+                ( publishNext( &sessions[ index ] ) == false ) )
+            {
+                startRecovery( &sessions[ index ] );
+            }
+        }
+
+        serviceSessions( true );
+    }
+
+    injectFaults = false;
+    TEST_ASSERT_TRUE( drainSessions( true, MQTT_RECONNECT_DRAIN_TIMEOUT_MS ) );
+
+    writeResults( "random_faults" );
+}
+
+/**
+ * @brief Drops every session at once and measures the reconnects with full
+ * TLS handshakes. Partial reads are still injected.
+ */
+void test_MQTT_Reconnect_Storm_Full_Handshake( void )
+{
+    dropRatePpm = 0U;
+    latencySpikeRatePpm = 0U;
+    partialReadRatePpm = MQTT_RECONNECT_PARTIAL_READ_RATE_PPM;
+    injectFaults = true;
+
+    measureStorms( "storm_full_handshake", false );
+}
+
+/**
+ * @brief Drops every session at once and measures the reconnects with TLS
+ * sessions resumed from the session store. Partial reads are still injected.
+ */
+void test_MQTT_Reconnect_Storm_Resumed_Handshake( void )
+{
+    dropRatePpm = 0U;
+    latencySpikeRatePpm = 0U;
+    partialReadRatePpm = MQTT_RECONNECT_PARTIAL_READ_RATE_PPM;
+    injectFaults = true;
+
+    measureStorms( "storm_resumed_handshake", true );
+}
@@ -40,6 +40,37 @@
  */
 uint32_t Clock_GetTimeMs( void );
 
+/**
+ * @brief Get the elapsed time of the monotonic clock in nanoseconds.
+ *
+ * Unlike #Clock_GetTimeMs, the value does not wrap in practice, so it can be
+ * used to measure latency below one millisecond and intervals of any length.
+ * It reads the same clock as #Clock_GetTimeMs.
+ *
+ * @return Time in nanoseconds.
+ */
+uint64_t Clock_GetTimeNs( void );
+
+/**
+ * @brief Get the elapsed time of the monotonic clock in microseconds.
+ *
+ * @return Time in microseconds.
+ */
+uint64_t Clock_GetTimeUs( void );
+
+/**
+ * @brief Get the elapsed time of a cheaper, coarse monotonic clock.
+ *
+ * Where the system provides CLOCK_MONOTONIC_COARSE, this reads it instead of
+ * the clock used by #Clock_GetTimeMs. It is cheaper to read but is only as
+ * precise as the system tick, usually a few milliseconds, so it suits timeout
+ * checks on hot paths rather than latency measurements. Otherwise it is the
+ * same as #Clock_GetTimeMs.
+ *
+ * @return Time in milliseconds.
+ */
+uint32_t Clock_GetCoarseTimeMs( void );
+
 /**
  * @brief Millisecond sleep function.
  *
@@ -0,0 +1,162 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file memory_stats.h
+ * @brief Optional measurements of the heap used by OpenSSL and of the peak
+ * stack depth of a thread, to size buffers and stacks from.
+ */
+
+#ifndef MEMORY_STATS_H_
+#define MEMORY_STATS_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Set to 1 to measure the memory used by the demos.
+ *
+ * When this is 0, #MEMORY_STATS_INIT and #MEMORY_STATS_LOG are removed by
+ * the preprocessor, so the demos are the same as without measurements. The
+ * BUILD_MEMORY_INSTRUMENTATION CMake option sets it to 1 for every target.
+ */
+#ifndef MEMORY_STATS_ENABLED
+    #define MEMORY_STATS_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Bytes of stack below the caller of #MemoryStats_PaintStack that
+ * are painted by #MEMORY_STATS_INIT.
+ *
+ * It must be less than the free stack of the thread, which is 8 MB for the
+ * main thread of most Linux systems and often much less for other threads.
+ */
+#ifndef MEMORY_STATS_STACK_PAINT_SIZE
+    #define MEMORY_STATS_STACK_PAINT_SIZE    ( 64U * 1024U )
+#endif
+
+/**
+ * @brief Heap counters of the allocations made through the hooks installed by
+ * #MemoryStats_HookOpenssl.
+ */
+typedef struct MemoryStatsHeap
+{
+    uint64_t allocations; /**< @brief Calls that allocated memory, including reallocations. */
+    uint64_t frees;       /**< @brief Calls that freed memory. */
+    uint64_t totalBytes;  /**< @brief Bytes requested by all allocations. */
+    size_t currentBytes;  /**< @brief Bytes allocated and not yet freed. */
+    size_t peakBytes;     /**< @brief Highest value of currentBytes since the hooks were
+                           * installed or the peak was last reset. */
+} MemoryStatsHeap_t;
+
+#if ( MEMORY_STATS_ENABLED != 0 )
+
+/**
+ * @brief Start measuring the OpenSSL heap and the stack of the calling
+ * thread. Use it at the start of main, before any other OpenSSL call.
+ */
+    #define MEMORY_STATS_INIT()                                             \
+    do {                                                                    \
+        ( void ) MemoryStats_HookOpenssl();                                 \
+        MemoryStats_PaintStack( ( size_t ) MEMORY_STATS_STACK_PAINT_SIZE ); \
+    } while( 0 )
+
+/**
+ * @brief Log the measurements taken since #MEMORY_STATS_INIT.
+ *
+ * @param[in] pLabel Name of the program or phase measured.
+ */
+    #define MEMORY_STATS_LOG( pLabel )    MemoryStats_Log( pLabel )
+
+#else /* if ( MEMORY_STATS_ENABLED != 0 ) */
+
+    #define MEMORY_STATS_INIT()
+    #define MEMORY_STATS_LOG( pLabel )
+
+#endif /* if ( MEMORY_STATS_ENABLED != 0 ) */
+
+#if ( MEMORY_STATS_ENABLED != 0 )
+
+/**
+ * @brief Count the heap allocations of OpenSSL, using
+ * CRYPTO_set_mem_functions.
+ *
+ * OpenSSL only accepts the hooks before it allocates anything, so call this
+ * before any other OpenSSL function. Each allocation is made a few bytes
+ * larger to remember its size.
+ *
+ * @return true if the hooks were installed; false if OpenSSL had already
+ * allocated memory.
+ */
+bool MemoryStats_HookOpenssl( void );
+
+/**
+ * @brief Copy the heap counters of OpenSSL.
+ *
+ * The counters are updated atomically, so this may be called from any
+ * thread.
+ *
+ * @param[out] pSnapshot The copy of the counters.
+ * @param[in] resetPeak Whether to set the peak to the current number of
+ * bytes after copying it, to measure the peak of the next phase.
+ */
+void MemoryStats_GetOpensslHeap( MemoryStatsHeap_t * pSnapshot,
+                                 bool resetPeak );
+
+/**
+ * @brief Fill the unused stack below the caller with a known pattern, so
+ * that #MemoryStats_GetStackHighWaterMark can later find how deep the
+ * calling thread went.
+ *
+ * Painting applies to the calling thread only. Call it from the outermost
+ * function to measure, such as main or the function of a thread.
+ *
+ * @param[in] depth Bytes of stack to paint. It must be less than the free
+ * stack of the thread.
+ */
+void MemoryStats_PaintStack( size_t depth );
+
+/**
+ * @brief Get the peak stack used below the caller of #MemoryStats_PaintStack
+ * by the calling thread since it was painted.
+ *
+ * A value equal to the painted depth means the stack went at least that
+ * deep, and should be painted deeper to measure it.
+ *
+ * @return Bytes of stack used, to within the frame of
+ * #MemoryStats_PaintStack; 0 if the thread has not painted its stack.
+ */
+size_t MemoryStats_GetStackHighWaterMark( void );
+
+/**
+ * @brief Log the heap counters of OpenSSL and the stack high water mark of
+ * the calling thread.
+ *
+ * @param[in] pLabel Name of the program or phase measured.
+ */
+void MemoryStats_Log( const char * pLabel );
+
+#endif /* if ( MEMORY_STATS_ENABLED != 0 ) */
+
+#endif /* ifndef MEMORY_STATS_H_ */
@@ -0,0 +1,154 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file retry_scheduler.h
+ * @brief Retries of an operation, such as reconnecting a session, scheduled on
+ * a timer wheel instead of sleeping between attempts.
+ *
+ * Each session that has to reconnect gets a #RetryScheduler_t. The backoff
+ * delay between attempts is a timer on a shared #TimerWheel_t, so one thread
+ * that calls #TimerWheel_Advance from its event loop can reconnect many
+ * sessions while it keeps processing the traffic of the healthy ones. Only
+ * the attempt itself, for example a TLS handshake, runs on that thread.
+ */
+
+#ifndef RETRY_SCHEDULER_H_
+#define RETRY_SCHEDULER_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "retry_utils.h"
+#include "timer_wheel.h"
+
+/**
+ * @brief Status for the retry scheduler functions.
+ */
+typedef enum RetrySchedulerStatus
+{
+    RetrySchedulerSuccess = 0, /**< @brief The function completed successfully. */
+    RetrySchedulerBadParameter /**< @brief At least one parameter was invalid. */
+} RetrySchedulerStatus_t;
+
+/**
+ * @brief Function that makes one attempt, for example to connect a session.
+ *
+ * @param[in] pContext The context of #RetrySchedulerConfig_t.
+ *
+ * @return true if the attempt succeeded; false to retry after a backoff.
+ */
+typedef bool ( * RetrySchedulerAttemptFunc_t )( void * pContext );
+
+/**
+ * @brief Function called when the retries end.
+ *
+ * @param[in] pContext The context of #RetrySchedulerConfig_t.
+ * @param[in] succeeded true if an attempt succeeded; false if the attempts
+ * were exhausted.
+ */
+typedef void ( * RetrySchedulerDoneFunc_t )( void * pContext,
+                                             bool succeeded );
+
+/**
+ * @brief Function that returns the current time in milliseconds, such as
+ * #Clock_GetTimeMs.
+ */
+typedef uint32_t ( * RetrySchedulerGetTimeFunc_t )( void );
+
+/**
+ * @brief Configuration of a retry scheduler.
+ */
+typedef struct RetrySchedulerConfig
+{
+    TimerWheel_t * pTimerWheel;              /**< @brief The timer wheel that schedules the attempts. */
+    RetryUtilsBudget_t * pBudget;            /**< @brief Optional budget shared with other schedulers; NULL for none. */
+    RetrySchedulerGetTimeFunc_t getTimeMs;   /**< @brief The clock of the timer wheel. */
+    RetrySchedulerAttemptFunc_t attempt;     /**< @brief Function that makes one attempt. */
+    RetrySchedulerDoneFunc_t done;           /**< @brief Optional function called when the retries end; NULL for none. */
+    void * pContext;                         /**< @brief Context passed to @ref RetrySchedulerConfig.attempt and @ref RetrySchedulerConfig.done. */
+} RetrySchedulerConfig_t;
+
+/**
+ * @brief A retry scheduler.
+ *
+ * @note The members of this structure are private to the retry scheduler and
+ * must not be accessed by the application.
+ */
+typedef struct RetryScheduler
+{
+    TimerWheelTimer_t timer;         /**< @brief Timer of the next attempt. */
+    RetryUtilsParams_t retryParams;  /**< @brief Backoff state between attempts. */
+    RetrySchedulerConfig_t config;   /**< @brief Copy of the configuration. */
+} RetryScheduler_t;
+
+/**
+ * @brief Initialize a retry scheduler.
+ *
+ * @param[out] pScheduler The scheduler to initialize.
+ * @param[in] pConfig The configuration. It is copied.
+ * @param[in] pRetryParams The backoff parameters, initialized with
+ * #RetryUtils_ParamsInit. They are copied.
+ *
+ * @return #RetrySchedulerSuccess if successful; #RetrySchedulerBadParameter if
+ * a parameter or a required member of @p pConfig is NULL.
+ */
+RetrySchedulerStatus_t RetryScheduler_Init( RetryScheduler_t * pScheduler,
+                                            const RetrySchedulerConfig_t * pConfig,
+                                            const RetryUtilsParams_t * pRetryParams );
+
+/**
+ * @brief Start retrying: schedule the first attempt for the next call to
+ * #TimerWheel_Advance.
+ *
+ * Each failed attempt schedules the next one after the delay returned by
+ * #RetryUtils_GetNextBackoffMs, until an attempt succeeds or the attempts are
+ * exhausted. Starting a scheduler that is already retrying has no effect.
+ *
+ * @param[in] pScheduler The scheduler.
+ *
+ * @return #RetrySchedulerSuccess if successful; #RetrySchedulerBadParameter if
+ * @p pScheduler is NULL.
+ */
+RetrySchedulerStatus_t RetryScheduler_Start( RetryScheduler_t * pScheduler );
+
+/**
+ * @brief Stop retrying without calling the done function.
+ *
+ * @param[in] pScheduler The scheduler.
+ *
+ * @return #RetrySchedulerSuccess if successful; #RetrySchedulerBadParameter if
+ * @p pScheduler is NULL.
+ */
+RetrySchedulerStatus_t RetryScheduler_Cancel( RetryScheduler_t * pScheduler );
+
+/**
+ * @brief Check whether a scheduler is retrying.
+ *
+ * @param[in] pScheduler The scheduler.
+ *
+ * @return true if an attempt is scheduled; false otherwise.
+ */
+bool RetryScheduler_IsPending( const RetryScheduler_t * pScheduler );
+
+#endif /* ifndef RETRY_SCHEDULER_H_ */
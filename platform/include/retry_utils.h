@@ -58,6 +58,22 @@
  *
  * > sleep_seconds = random_between( 0, min( 2<sup>attempts_count</sup> * base_seconds, maximum_seconds ) )
  *
+ * @ref RetryUtils_GetNextBackoffMs computes the same kind of delay in
+ * milliseconds without sleeping, for applications that wait in an event loop
+ * or on a timer. Its limits and jitter strategy are set at runtime by
+ * @ref RetryUtils_ParamsInit, and each @ref RetryUtilsParams_t has its own
+ * pseudo random number generator, so it is safe to use from several threads
+ * with separate parameters.
+ *
+ * Connections that reconnect at the same time, for example after a server
+ * outage, can also share a @ref RetryUtilsBudget_t. Each reconnect attempt is
+ * made only after @ref RetryUtils_BudgetAcquire allows it, and is followed by
+ * @ref RetryUtils_BudgetRelease, which limits how many TLS handshakes run at
+ * once and how often they start. With @ref RetryUtilsParams_t.pBudget set,
+ * @ref RetryUtils_BackoffAndSleep releases the attempt that failed and takes
+ * the next one from the budget, so the application only takes the first
+ * attempt before the loop and releases the attempt that succeeds.
+ *
  * @section retryutils_implementation Implementing Retry Utils
  *
  * The functions that must be implemented are:<br>
@@ -190,14 +206,73 @@
 #define MAX_JITTER_VALUE_SECONDS         5U
 
 /**
- * @brief Status for @ref RetryUtils_BackoffAndSleep.
+ * @brief Status for the retry utility functions.
  */
 typedef enum RetryUtilsStatus
 {
-    RetryUtilsSuccess = 0,     /**< @brief The function returned successfully after sleeping. */
-    RetryUtilsRetriesExhausted /**< @brief The function exhausted all retry attempts. */
+    RetryUtilsSuccess = 0,      /**< @brief The function returned successfully after sleeping. */
+    RetryUtilsRetriesExhausted, /**< @brief The function exhausted all retry attempts. */
+    RetryUtilsBadParameter,     /**< @brief At least one parameter was invalid. */
+    RetryUtilsThrottled         /**< @brief The retry budget does not allow an attempt yet. */
 } RetryUtilsStatus_t;
 
+/**
+ * @brief How @ref RetryUtils_GetNextBackoffMs randomizes the delays.
+ *
+ * See https://aws.amazon.com/blogs/architecture/exponential-backoff-and-jitter/
+ * for a comparison of the strategies.
+ */
+typedef enum RetryUtilsJitter
+{
+    /**
+     * @brief A random delay between 0 and the lesser of the maximum backoff
+     * and the base backoff doubled for each attempt done.
+     */
+    RetryUtilsFullJitter = 0,
+
+    /**
+     * @brief A random delay between the base backoff and three times the
+     * previous delay, capped at the maximum backoff.
+     */
+    RetryUtilsDecorrelatedJitter
+} RetryUtilsJitter_t;
+
+/**
+ * @brief A retry budget shared by every connection of a process.
+ *
+ * The budget is a token bucket: it holds up to a number of attempts, and
+ * gains one attempt back at a fixed interval. It can also limit how many
+ * attempts, such as TLS handshakes, are in progress at once. When a server
+ * becomes unavailable, the connections that reconnect then draw from the same
+ * budget, so their attempts are spread over time instead of all happening at
+ * once.
+ *
+ * The budget is safe to use from several threads without a lock.
+ *
+ * @note The members of this structure are private to the retry utilities and
+ * must not be accessed by the application.
+ */
+typedef struct RetryUtilsBudget
+{
+    uint64_t fullAtMs;             /**< @brief Time at which the bucket is full again. */
+    uint32_t refillIntervalMs;     /**< @brief Interval at which one attempt is added back to the bucket. */
+    uint32_t burstToleranceMs;     /**< @brief Time to refill all but one attempt of the bucket. */
+    uint32_t maxInProgress;        /**< @brief Maximum number of attempts in progress, or 0 for no limit. */
+    uint32_t inProgress;           /**< @brief Number of attempts in progress. */
+    uint32_t granted;              /**< @brief Number of attempts allowed. */
+    uint32_t rateThrottled;        /**< @brief Number of attempts refused because the bucket was empty. */
+    uint32_t concurrencyThrottled; /**< @brief Number of attempts refused because too many were in progress. */
+} RetryUtilsBudget_t;
+
+/**
+ * @brief Initializer of a #RetryUtilsBudget_t with static storage, with the
+ * same parameters as @ref RetryUtils_BudgetInit.
+ *
+ * ( @p capacity - 1 ) * @p refillIntervalMs must fit in 32 bits.
+ */
+#define RETRY_UTILS_BUDGET_INITIALIZER( capacity, refillIntervalMs, maxInProgress ) \
+    { 0U, ( refillIntervalMs ), ( ( capacity ) - 1U ) * ( refillIntervalMs ), ( maxInProgress ), 0U, 0U, 0U, 0U }
+
 /**
  * @brief Represents parameters required for retry logic.
  */
@@ -213,11 +288,64 @@ typedef struct RetryUtilsParams
      * @brief The max jitter value for backoff time in retry attempt.
      */
     uint32_t nextJitterMax;
+
+    /**
+     * @brief The number of attempts after which @ref RetryUtils_GetNextBackoffMs
+     * reports that retries are exhausted, or 0 to retry forever.
+     */
+    uint32_t maxAttempts;
+
+    /**
+     * @brief The base backoff in milliseconds for @ref RetryUtils_GetNextBackoffMs.
+     */
+    uint32_t baseBackoffMs;
+
+    /**
+     * @brief The maximum backoff in milliseconds for @ref RetryUtils_GetNextBackoffMs.
+     */
+    uint32_t maxBackoffMs;
+
+    /**
+     * @brief The delay last returned by @ref RetryUtils_GetNextBackoffMs, used
+     * by #RetryUtilsDecorrelatedJitter.
+     */
+    uint32_t previousBackoffMs;
+
+    /**
+     * @brief The state of the pseudo random number generator used by
+     * @ref RetryUtils_GetNextBackoffMs. Each set of parameters has its own, so
+     * the delays of separate threads are independent.
+     */
+    uint32_t randomState;
+
+    /**
+     * @brief The jitter strategy of @ref RetryUtils_GetNextBackoffMs.
+     */
+    RetryUtilsJitter_t jitter;
+
+    /**
+     * @brief The budget that the attempts of @ref RetryUtils_BackoffAndSleep
+     * draw from, or NULL for none. Set it after @ref RetryUtils_ParamsReset,
+     * which clears it.
+     */
+    RetryUtilsBudget_t * pBudget;
 } RetryUtilsParams_t;
 
 
 /**
- * @brief Resets the retry timeout value and number of attempts.
+ * @brief Counters of a retry budget, returned by @ref RetryUtils_BudgetGetStats.
+ */
+typedef struct RetryUtilsBudgetStats
+{
+    uint32_t inProgress;           /**< @brief Number of attempts in progress. */
+    uint32_t granted;              /**< @brief Number of attempts allowed. */
+    uint32_t rateThrottled;        /**< @brief Number of attempts refused because the bucket was empty. */
+    uint32_t concurrencyThrottled; /**< @brief Number of attempts refused because too many were in progress. */
+} RetryUtilsBudgetStats_t;
+
+/**
+ * @brief Resets the retry timeout value and number of attempts, and clears
+ * the budget of the parameters.
  * This function must be called by the application before a new retry attempt.
  *
  * @param[in, out] pRetryParams Structure containing attempts done and timeout
@@ -232,6 +360,11 @@ void RetryUtils_ParamsReset( RetryUtilsParams_t * pRetryParams );
  * must use this function between retry failures to add exponential delay.
  * This function will block the calling task for the current timeout value.
  *
+ * When @ref RetryUtilsParams_t.pBudget is set, the attempt that failed is
+ * released to the budget, and after the backoff this function also waits
+ * until the budget allows the next attempt, which the application must
+ * release once it has completed.
+ *
  * @param[in, out] pRetryParams Structure containing retry parameters.
  *
  * @return #RetryUtilsSuccess after a successful sleep, #RetryUtilsRetriesExhausted
@@ -241,4 +374,120 @@ void RetryUtils_ParamsReset( RetryUtilsParams_t * pRetryParams );
 RetryUtilsStatus_t RetryUtils_BackoffAndSleep( RetryUtilsParams_t * pRetryParams );
 /* @[define_retryutils_backoffandsleep] */
 
+/**
+ * @brief Initialize the parameters for @ref RetryUtils_GetNextBackoffMs.
+ *
+ * Unlike @ref RetryUtils_ParamsReset, this does not touch the state of the
+ * process-wide rand(), and the limits are set at runtime rather than by
+ * #MAX_RETRY_ATTEMPTS and #MAX_RETRY_BACKOFF_SECONDS.
+ *
+ * @param[out] pRetryParams Structure to initialize.
+ * @param[in] maxAttempts Number of attempts after which retries are
+ * exhausted, or 0 to retry forever.
+ * @param[in] baseBackoffMs Base backoff in milliseconds. Must not be 0.
+ * @param[in] maxBackoffMs Maximum backoff in milliseconds. Must not be less
+ * than @p baseBackoffMs.
+ * @param[in] jitter The jitter strategy.
+ * @param[in] seed Seed of the pseudo random number generator of
+ * @p pRetryParams, or 0 to seed it from the clock and the address of
+ * @p pRetryParams.
+ *
+ * @return #RetryUtilsSuccess if successful; #RetryUtilsBadParameter if a
+ * parameter is invalid.
+ */
+RetryUtilsStatus_t RetryUtils_ParamsInit( RetryUtilsParams_t * pRetryParams,
+                                          uint32_t maxAttempts,
+                                          uint32_t baseBackoffMs,
+                                          uint32_t maxBackoffMs,
+                                          RetryUtilsJitter_t jitter,
+                                          uint32_t seed );
+
+/**
+ * @brief Get the delay before the next retry without sleeping.
+ *
+ * The application waits for the returned delay in whatever way suits it, for
+ * example by arming a timer or passing it as the timeout of an event loop,
+ * and then retries. When retries are exhausted, the attempts are reset so the
+ * application may start a new cycle of retries.
+ *
+ * @param[in, out] pRetryParams Structure initialized with
+ * @ref RetryUtils_ParamsInit.
+ * @param[out] pNextBackoffMs The delay in milliseconds before the next retry.
+ *
+ * @return #RetryUtilsSuccess if another retry may be made after the delay;
+ * #RetryUtilsRetriesExhausted when all attempts are exhausted;
+ * #RetryUtilsBadParameter if a parameter is NULL.
+ */
+RetryUtilsStatus_t RetryUtils_GetNextBackoffMs( RetryUtilsParams_t * pRetryParams,
+                                                uint32_t * pNextBackoffMs );
+
+/**
+ * @brief Initialize a retry budget.
+ *
+ * @param[out] pBudget The budget to initialize.
+ * @param[in] capacity Number of attempts that may be made at once when the
+ * bucket is full. Must not be 0.
+ * @param[in] refillIntervalMs Interval in milliseconds at which one attempt is
+ * added back to the bucket. Must not be 0.
+ * @param[in] maxInProgress Maximum number of attempts in progress at once, or
+ * 0 for no limit.
+ *
+ * @return #RetryUtilsSuccess if successful; #RetryUtilsBadParameter if a
+ * parameter is invalid.
+ */
+RetryUtilsStatus_t RetryUtils_BudgetInit( RetryUtilsBudget_t * pBudget,
+                                          uint32_t capacity,
+                                          uint32_t refillIntervalMs,
+                                          uint32_t maxInProgress );
+
+/**
+ * @brief Take one attempt from a retry budget without waiting.
+ *
+ * Every successful call must be followed by a call to
+ * @ref RetryUtils_BudgetRelease once the attempt has completed, whether it
+ * succeeded or not.
+ *
+ * @param[in] pBudget The budget.
+ * @param[out] pWaitMs When the attempt is refused, the time in milliseconds
+ * after which it may succeed. May be NULL.
+ *
+ * @return #RetryUtilsSuccess if the attempt may be made now;
+ * #RetryUtilsThrottled if it is refused; #RetryUtilsBadParameter if
+ * @p pBudget is NULL.
+ */
+RetryUtilsStatus_t RetryUtils_BudgetAcquire( RetryUtilsBudget_t * pBudget,
+                                             uint32_t * pWaitMs );
+
+/**
+ * @brief Take one attempt from a retry budget, sleeping until it is allowed.
+ *
+ * @param[in] pBudget The budget.
+ *
+ * @return #RetryUtilsSuccess once the attempt may be made;
+ * #RetryUtilsBadParameter if @p pBudget is NULL.
+ */
+RetryUtilsStatus_t RetryUtils_BudgetAcquireAndSleep( RetryUtilsBudget_t * pBudget );
+
+/**
+ * @brief Mark an attempt taken from a retry budget as completed.
+ *
+ * @param[in] pBudget The budget.
+ *
+ * @return #RetryUtilsSuccess if successful; #RetryUtilsBadParameter if
+ * @p pBudget is NULL.
+ */
+RetryUtilsStatus_t RetryUtils_BudgetRelease( RetryUtilsBudget_t * pBudget );
+
+/**
+ * @brief Get the counters of a retry budget.
+ *
+ * @param[in] pBudget The budget.
+ * @param[out] pStats The counters.
+ *
+ * @return #RetryUtilsSuccess if successful; #RetryUtilsBadParameter if a
+ * parameter is NULL.
+ */
+RetryUtilsStatus_t RetryUtils_BudgetGetStats( const RetryUtilsBudget_t * pBudget,
+                                              RetryUtilsBudgetStats_t * pStats );
+
 #endif /* ifndef RETRY_UTILS_H_ */
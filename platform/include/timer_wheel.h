@@ -0,0 +1,244 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file timer_wheel.h
+ * @brief A hierarchical timer wheel for tracking many timeouts at once.
+ *
+ * Keep-alive intervals, acknowledgment timeouts, retransmissions and retry
+ * backoffs of many sessions can all be armed on one wheel. Arming and
+ * canceling a timer take constant time, and #TimerWheel_GetTimeoutMs tells an
+ * event loop how long it can sleep until the next timer expires, so no
+ * session needs to be scanned to find out whether its timeout has passed.
+ *
+ * Times are in milliseconds from the clock of #Clock_GetTimeMs, and wrap
+ * around in the same way. Timers are owned by the application, so the wheel
+ * does not allocate memory. The wheel is not thread safe.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of bits of the time used to select a slot in one level.
+ */
+#define TIMER_WHEEL_SLOT_BITS      ( 6U )
+
+/**
+ * @brief Number of slots in each level of the wheel.
+ */
+#define TIMER_WHEEL_SLOTS          ( 1U << TIMER_WHEEL_SLOT_BITS )
+
+/**
+ * @brief Number of levels of the wheel.
+ *
+ * Level 0 has a slot for each millisecond, and each level above it has slots
+ * #TIMER_WHEEL_SLOTS times as long as the level below. With 4 levels, timers
+ * up to 2 to the power of 24 milliseconds, about 4.6 hours, away are placed
+ * directly. Timers further away are placed in the last slot of the top level
+ * and moved down when it is reached.
+ */
+#define TIMER_WHEEL_LEVELS         ( 4U )
+
+/**
+ * @brief Timeout returned by #TimerWheel_GetTimeoutMs when no timer is armed.
+ * It has the same value as EVENT_LOOP_WAIT_FOREVER.
+ */
+#define TIMER_WHEEL_WAIT_FOREVER    ( UINT32_MAX )
+
+/**
+ * @brief Status for the timer wheel functions.
+ */
+typedef enum TimerWheelStatus
+{
+    TimerWheelSuccess = 0,  /**< @brief The function completed successfully. */
+    TimerWheelBadParameter, /**< @brief At least one parameter was invalid. */
+    TimerWheelNoTimers      /**< @brief No timer is armed. */
+} TimerWheelStatus_t;
+
+struct TimerWheelTimer;
+
+/**
+ * @brief Function called when a timer expires.
+ *
+ * The timer is no longer armed when this is called, so the function may arm it
+ * again, for example to implement a periodic timer. It may also arm or cancel
+ * any other timer, but must not call #TimerWheel_Advance.
+ *
+ * @param[in] pTimer The timer that expired.
+ * @param[in] pContext The context passed to #TimerWheel_InitTimer.
+ */
+typedef void ( * TimerWheelCallback_t )( struct TimerWheelTimer * pTimer,
+                                         void * pContext );
+
+/**
+ * @brief A timer that can be armed on a timer wheel.
+ *
+ * @note The members of this structure are private to the timer wheel and
+ * must not be accessed by the application.
+ */
+typedef struct TimerWheelTimer
+{
+    struct TimerWheelTimer * pNext; /**< @brief Next timer in the same slot. */
+    struct TimerWheelTimer * pPrev; /**< @brief Previous timer in the same slot. */
+    uint32_t expiryMs;              /**< @brief Time at which the timer expires. */
+    TimerWheelCallback_t callback;  /**< @brief Function called when the timer expires. */
+    void * pContext;                /**< @brief Context passed to @ref TimerWheelTimer.callback. */
+    uint8_t level;                  /**< @brief Level of the slot holding the timer, or a special value. */
+    uint8_t slot;                   /**< @brief Index of the slot holding the timer in its level. */
+} TimerWheelTimer_t;
+
+/**
+ * @brief The timer wheel object.
+ *
+ * @note The members of this structure are private to the timer wheel and
+ * must not be accessed by the application.
+ */
+typedef struct TimerWheel
+{
+    TimerWheelTimer_t * pSlots[ TIMER_WHEEL_LEVELS ][ TIMER_WHEEL_SLOTS ]; /**< @brief Lists of the armed timers. */
+    uint64_t occupied[ TIMER_WHEEL_LEVELS ];                               /**< @brief Bit map of the slots that are not empty. */
+    TimerWheelTimer_t * pExpired;                                          /**< @brief Expired timers whose callbacks have not run yet. */
+    uint32_t currentMs;                                                    /**< @brief First time that has not been processed yet. */
+    size_t armedCount;                                                     /**< @brief Number of armed timers. */
+} TimerWheel_t;
+
+/**
+ * @brief Initialize a timer wheel.
+ *
+ * @param[out] pTimerWheel The timer wheel to initialize.
+ * @param[in] nowMs The current time, usually from #Clock_GetTimeMs.
+ *
+ * @return #TimerWheelSuccess if successful; #TimerWheelBadParameter if
+ * @p pTimerWheel is NULL.
+ */
+TimerWheelStatus_t TimerWheel_Init( TimerWheel_t * pTimerWheel,
+                                    uint32_t nowMs );
+
+/**
+ * @brief Initialize a timer before it is first armed.
+ *
+ * @param[out] pTimer The timer to initialize.
+ * @param[in] callback Function to call when the timer expires.
+ * @param[in] pContext Context to pass to @p callback.
+ *
+ * @return #TimerWheelSuccess if successful; #TimerWheelBadParameter if
+ * @p pTimer or @p callback is NULL.
+ */
+TimerWheelStatus_t TimerWheel_InitTimer( TimerWheelTimer_t * pTimer,
+                                         TimerWheelCallback_t callback,
+                                         void * pContext );
+
+/**
+ * @brief Arm a timer to expire at the given time.
+ *
+ * A timer that is already armed is moved to the new time. The wheel has
+ * processed every time up to the one last passed to #TimerWheel_Advance, so a
+ * timer armed for that time or earlier expires one millisecond after it. The
+ * deadline reported by #TimerWheel_NextDeadline and #TimerWheel_GetTimeoutMs
+ * is then that later time.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] pTimer The timer, initialized with #TimerWheel_InitTimer.
+ * @param[in] expiryMs The time at which the timer expires. It must be less
+ * than 2 to the power of 31 milliseconds, about 24 days, after the current
+ * time of the wheel.
+ *
+ * @return #TimerWheelSuccess if successful; #TimerWheelBadParameter if a
+ * parameter is NULL.
+ */
+TimerWheelStatus_t TimerWheel_Arm( TimerWheel_t * pTimerWheel,
+                                   TimerWheelTimer_t * pTimer,
+                                   uint32_t expiryMs );
+
+/**
+ * @brief Cancel a timer so that it does not expire.
+ *
+ * Canceling a timer that is not armed has no effect.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] pTimer The timer.
+ *
+ * @return #TimerWheelSuccess if successful; #TimerWheelBadParameter if a
+ * parameter is NULL.
+ */
+TimerWheelStatus_t TimerWheel_Cancel( TimerWheel_t * pTimerWheel,
+                                      TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Check whether a timer is armed.
+ *
+ * @param[in] pTimer The timer, initialized with #TimerWheel_InitTimer.
+ *
+ * @return true if the timer is armed and its callback has not run yet; false
+ * otherwise.
+ */
+bool TimerWheel_IsArmed( const TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Move the wheel forward to the current time, calling the callback of
+ * every timer that expired on the way, in order of expiry.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] nowMs The current time, usually from #Clock_GetTimeMs. A time
+ * before the current time of the wheel has no effect.
+ *
+ * @return #TimerWheelSuccess if successful; #TimerWheelBadParameter if
+ * @p pTimerWheel is NULL.
+ */
+TimerWheelStatus_t TimerWheel_Advance( TimerWheel_t * pTimerWheel,
+                                       uint32_t nowMs );
+
+/**
+ * @brief Get the time at which the next timer expires.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[out] pDeadlineMs The expiry time of the armed timer that expires first.
+ *
+ * @return #TimerWheelSuccess if successful; #TimerWheelNoTimers if no timer is
+ * armed; #TimerWheelBadParameter if a parameter is NULL.
+ */
+TimerWheelStatus_t TimerWheel_NextDeadline( const TimerWheel_t * pTimerWheel,
+                                            uint32_t * pDeadlineMs );
+
+/**
+ * @brief Get how long an event loop can sleep before the next timer expires.
+ *
+ * The result can be passed as the timeout to EventLoop_Wait or poll, after
+ * which #TimerWheel_Advance runs the timers that expired.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] nowMs The current time, usually from #Clock_GetTimeMs.
+ *
+ * @return Milliseconds until the next timer expires; 0 if a timer has already
+ * expired; #TIMER_WHEEL_WAIT_FOREVER if no timer is armed or @p pTimerWheel is
+ * NULL.
+ */
+uint32_t TimerWheel_GetTimeoutMs( const TimerWheel_t * pTimerWheel,
+                                  uint32_t nowMs );
+
+#endif /* ifndef TIMER_WHEEL_H_ */
@@ -0,0 +1,118 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file trace_probes.h
+ * @brief Optional static tracepoints for tracing the SDK in production with
+ * eBPF, SystemTap or LTTng, without rebuilding it with debug logs.
+ *
+ * The tracepoints are USDT probes of the provider `aws_iot_sdk`, defined with
+ * <sys/sdt.h>. Each one compiles to a single NOP and a note in the ELF
+ * file, and tracers rewrite the NOP only while attached. For example:
+ *
+ *     bpftrace -e 'usdt:./shadow_demo_main:aws_iot_sdk:openssl_recv { @[arg2] = count(); }'
+ *     lttng enable-event --userspace-probe=sdt:./shadow_demo_main:aws_iot_sdk:tls_handshake_end tls
+ *
+ * The probes and their arguments are:
+ *
+ * | Probe                       | Arguments                                        |
+ * | --------------------------- | ------------------------------------------------ |
+ * | dns_resolve_start           | host name, host name length                      |
+ * | dns_resolve_end             | host name, #SocketStatus_t                       |
+ * | tcp_connect_start           | host name, port                                  |
+ * | tcp_connect_end             | host name, #SocketStatus_t                       |
+ * | tls_handshake_start         | network context                                  |
+ * | tls_handshake_end           | network context, result of SSL_connect           |
+ * | plaintext_send, _recv       | network context, bytes requested, bytes or error |
+ * | plaintext_writev            | network context, vector count, bytes or error    |
+ * | openssl_send, _recv         | network context, bytes requested, bytes or error |
+ * | publish_enqueue             | packet id, topic name, payload length            |
+ * | publish_ack                 | packet id                                        |
+ * | subscription_dispatch_start | topic name, topic name length                    |
+ * | subscription_dispatch_end   | topic name, topic name length                    |
+ *
+ * The arguments are evaluated even when no tracer is attached, so only pass
+ * values that are already at hand.
+ */
+
+#ifndef TRACE_PROBES_H_
+#define TRACE_PROBES_H_
+
+/**
+ * @brief Set to 1 to compile the tracepoints in. It needs <sys/sdt.h>, which
+ * the systemtap-sdt-dev or systemtap-sdt-devel package provides. The
+ * BUILD_TRACE_PROBES CMake option sets it to 1 for every target.
+ *
+ * When this is 0, the tracepoints are removed by the preprocessor.
+ */
+#ifndef TRACE_PROBES_ENABLED
+    #define TRACE_PROBES_ENABLED    ( 0 )
+#endif
+
+#if ( TRACE_PROBES_ENABLED != 0 )
+
+    #include <sys/sdt.h>
+
+/**
+ * @brief A tracepoint without arguments.
+ *
+ * @param[in] name Name of the probe.
+ */
+    #define TRACE_PROBE0( name )                      DTRACE_PROBE( aws_iot_sdk, name )
+
+/**
+ * @brief A tracepoint with one argument.
+ *
+ * @param[in] name Name of the probe.
+ * @param[in] arg1 Integer or pointer argument.
+ */
+    #define TRACE_PROBE1( name, arg1 )                DTRACE_PROBE1( aws_iot_sdk, name, arg1 )
+
+/**
+ * @brief A tracepoint with two arguments.
+ *
+ * @param[in] name Name of the probe.
+ * @param[in] arg1 Integer or pointer argument.
+ * @param[in] arg2 Integer or pointer argument.
+ */
+    #define TRACE_PROBE2( name, arg1, arg2 )          DTRACE_PROBE2( aws_iot_sdk, name, arg1, arg2 )
+
+/**
+ * @brief A tracepoint with three arguments.
+ *
+ * @param[in] name Name of the probe.
+ * @param[in] arg1 Integer or pointer argument.
+ * @param[in] arg2 Integer or pointer argument.
+ * @param[in] arg3 Integer or pointer argument.
+ */
+    #define TRACE_PROBE3( name, arg1, arg2, arg3 )    DTRACE_PROBE3( aws_iot_sdk, name, arg1, arg2, arg3 )
+
+#else /* if ( TRACE_PROBES_ENABLED != 0 ) */
+
+    #define TRACE_PROBE0( name )
+    #define TRACE_PROBE1( name, arg1 )
+    #define TRACE_PROBE2( name, arg1, arg2 )
+    #define TRACE_PROBE3( name, arg1, arg2, arg3 )
+
+#endif /* if ( TRACE_PROBES_ENABLED != 0 ) */
+
+#endif /* ifndef TRACE_PROBES_H_ */
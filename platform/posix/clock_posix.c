@@ -40,16 +40,38 @@
  */
 #define NANOSECONDS_PER_MILLISECOND    ( 1000000L )    /**< @brief Nanoseconds per millisecond. */
 #define MILLISECONDS_PER_SECOND        ( 1000L )       /**< @brief Milliseconds per second. */
+#define NANOSECONDS_PER_SECOND         ( 1000000000L ) /**< @brief Nanoseconds per second. */
+#define NANOSECONDS_PER_MICROSECOND    ( 1000L )       /**< @brief Nanoseconds per microsecond. */
+
+/**
+ * @brief The clock read by #Clock_GetCoarseTimeMs.
+ */
+#ifdef CLOCK_MONOTONIC_COARSE
+    #define COARSE_CLOCK    CLOCK_MONOTONIC_COARSE
+#else
+    #define COARSE_CLOCK    CLOCK_MONOTONIC
+#endif
 
 /*-----------------------------------------------------------*/
 
-uint32_t Clock_GetTimeMs( void )
+/**
+ * @brief Get the time of a clock in milliseconds, truncated to 32 bits.
+ *
+ * @param[in] clockId The clock to read.
+ *
+ * @return Time in milliseconds.
+ */
+static uint32_t getTimeMs( clockid_t clockId );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getTimeMs( clockid_t clockId )
 {
     int64_t timeMs;
     struct timespec timeSpec;
 
-    /* Get the MONOTONIC time. */
-    ( void ) clock_gettime( CLOCK_MONOTONIC, &timeSpec );
+    /* Get the time of the clock. */
+    ( void ) clock_gettime( clockId, &timeSpec );
 
     /* Calculate the milliseconds from timespec. */
     timeMs = ( timeSpec.tv_sec * MILLISECONDS_PER_SECOND )
@@ -64,6 +86,40 @@ uint32_t Clock_GetTimeMs( void )
 
 /*-----------------------------------------------------------*/
 
+uint32_t Clock_GetTimeMs( void )
+{
+    return getTimeMs( CLOCK_MONOTONIC );
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetTimeNs( void )
+{
+    struct timespec timeSpec;
+
+    /* Get the MONOTONIC time. */
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &timeSpec );
+
+    return ( ( uint64_t ) timeSpec.tv_sec * ( uint64_t ) NANOSECONDS_PER_SECOND )
+           + ( uint64_t ) timeSpec.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetTimeUs( void )
+{
+    return Clock_GetTimeNs() / ( uint64_t ) NANOSECONDS_PER_MICROSECOND;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t Clock_GetCoarseTimeMs( void )
+{
+    return getTimeMs( COARSE_CLOCK );
+}
+
+/*-----------------------------------------------------------*/
+
 void Clock_SleepMs( uint32_t sleepTimeMs )
 {
     /* Convert parameter to timespec. */
@@ -0,0 +1,361 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+
+/* POSIX includes. */
+#include <alloca.h>
+
+/* OpenSSL includes. */
+#include <openssl/crypto.h>
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the memory measurements. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "MemoryStats"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+#include "memory_stats.h"
+
+#if ( MEMORY_STATS_ENABLED != 0 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Byte written over the painted stack. Stack frames rarely hold long
+ * runs of it.
+ */
+    #define STACK_PAINT_BYTE    ( 0xA5U )
+
+/**
+ * @brief Header in front of each allocation counted, holding its size. The
+ * union keeps the memory after it aligned for any type.
+ */
+typedef union AllocationHeader
+{
+    size_t size;          /**< @brief Bytes requested by the caller. */
+    long double alignLd;  /**< @brief Alignment only. */
+    void * alignPointer;  /**< @brief Alignment only. */
+    uint64_t alignUint64; /**< @brief Alignment only. */
+} AllocationHeader_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Heap counters of OpenSSL, updated atomically.
+ */
+static MemoryStatsHeap_t opensslHeap;
+
+/**
+ * @brief Lowest address painted by the calling thread, or NULL.
+ */
+static __thread volatile uint8_t * pPaintedStack = NULL;
+
+/**
+ * @brief Bytes painted by the calling thread.
+ */
+static __thread size_t paintedDepth = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Count an allocation of @p size bytes.
+ *
+ * @param[in] size Bytes allocated.
+ */
+static void recordAllocation( size_t size );
+
+/**
+ * @brief Count a free of @p size bytes.
+ *
+ * @param[in] size Bytes freed.
+ */
+static void recordFree( size_t size );
+
+/**
+ * @brief The malloc hook passed to OpenSSL.
+ *
+ * @param[in] size Bytes to allocate.
+ * @param[in] pFile Source file of the caller in OpenSSL.
+ * @param[in] line Source line of the caller in OpenSSL.
+ *
+ * @return The memory, or NULL.
+ */
+static void * countedMalloc( size_t size,
+                             const char * pFile,
+                             int line );
+
+/**
+ * @brief The realloc hook passed to OpenSSL.
+ *
+ * @param[in] pMemory Memory from #countedMalloc or #countedRealloc, or NULL.
+ * @param[in] size Bytes to resize to.
+ * @param[in] pFile Source file of the caller in OpenSSL.
+ * @param[in] line Source line of the caller in OpenSSL.
+ *
+ * @return The memory, or NULL.
+ */
+static void * countedRealloc( void * pMemory,
+                              size_t size,
+                              const char * pFile,
+                              int line );
+
+/**
+ * @brief The free hook passed to OpenSSL.
+ *
+ * @param[in] pMemory Memory from #countedMalloc or #countedRealloc, or NULL.
+ * @param[in] pFile Source file of the caller in OpenSSL.
+ * @param[in] line Source line of the caller in OpenSSL.
+ */
+static void countedFree( void * pMemory,
+                         const char * pFile,
+                         int line );
+
+/*-----------------------------------------------------------*/
+
+static void recordAllocation( size_t size )
+{
+    size_t currentBytes = 0U;
+    size_t peakBytes = 0U;
+
+    ( void ) __atomic_add_fetch( &opensslHeap.allocations, 1U, __ATOMIC_RELAXED );
+    ( void ) __atomic_add_fetch( &opensslHeap.totalBytes, ( uint64_t ) size, __ATOMIC_RELAXED );
+    currentBytes = __atomic_add_fetch( &opensslHeap.currentBytes, size, __ATOMIC_RELAXED );
+    peakBytes = __atomic_load_n( &opensslHeap.peakBytes, __ATOMIC_RELAXED );
+
+    /* Another thread may raise the peak between the load and the exchange,
+     * in which case the exchange reloads it. */
+    while( ( currentBytes > peakBytes ) &&
+           ( __atomic_compare_exchange_n( &opensslHeap.peakBytes,
+                                          &peakBytes,
+                                          currentBytes,
+                                          false,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED ) == false ) )
+    {
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void recordFree( size_t size )
+{
+    ( void ) __atomic_add_fetch( &opensslHeap.frees, 1U, __ATOMIC_RELAXED );
+    ( void ) __atomic_sub_fetch( &opensslHeap.currentBytes, size, __ATOMIC_RELAXED );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * countedMalloc( size_t size,
+                             const char * pFile,
+                             int line )
+{
+    AllocationHeader_t * pHeader = malloc( sizeof( AllocationHeader_t ) + size );
+    void * pMemory = NULL;
+
+    ( void ) pFile;
+    ( void ) line;
+
+    if( pHeader != NULL )
+    {
+        pHeader->size = size;
+        recordAllocation( size );
+        pMemory = &pHeader[ 1 ];
+    }
+
+    return pMemory;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * countedRealloc( void * pMemory,
+                              size_t size,
+                              const char * pFile,
+                              int line )
+{
+    AllocationHeader_t * pHeader = NULL;
+    size_t oldSize = 0U;
+    void * pResized = NULL;
+
+    if( pMemory == NULL )
+    {
+        pResized = countedMalloc( size, pFile, line );
+    }
+    else if( size == 0U )
+    {
+        countedFree( pMemory, pFile, line );
+    }
+    else
+    {
+        pHeader = ( AllocationHeader_t * ) pMemory - 1;
+        oldSize = pHeader->size;
+        pHeader = realloc( pHeader, sizeof( AllocationHeader_t ) + size );
+
+        /* The old memory is unchanged when realloc fails. */
+        if( pHeader != NULL )
+        {
+            pHeader->size = size;
+            recordFree( oldSize );
+            recordAllocation( size );
+            pResized = &pHeader[ 1 ];
+        }
+    }
+
+    return pResized;
+}
+
+/*-----------------------------------------------------------*/
+
+static void countedFree( void * pMemory,
+                         const char * pFile,
+                         int line )
+{
+    AllocationHeader_t * pHeader = NULL;
+
+    ( void ) pFile;
+    ( void ) line;
+
+    if( pMemory != NULL )
+    {
+        pHeader = ( AllocationHeader_t * ) pMemory - 1;
+        recordFree( pHeader->size );
+        free( pHeader );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool MemoryStats_HookOpenssl( void )
+{
+    bool hooked = ( CRYPTO_set_mem_functions( countedMalloc,
+                                              countedRealloc,
+                                              countedFree ) == 1 );
+
+    if( hooked == false )
+    {
+        LogWarn( ( "OpenSSL allocated memory before its hooks could be installed, "
+                   "so its heap is not measured." ) );
+    }
+
+    return hooked;
+}
+
+/*-----------------------------------------------------------*/
+
+void MemoryStats_GetOpensslHeap( MemoryStatsHeap_t * pSnapshot,
+                                 bool resetPeak )
+{
+    if( pSnapshot != NULL )
+    {
+        pSnapshot->allocations = __atomic_load_n( &opensslHeap.allocations, __ATOMIC_RELAXED );
+        pSnapshot->frees = __atomic_load_n( &opensslHeap.frees, __ATOMIC_RELAXED );
+        pSnapshot->totalBytes = __atomic_load_n( &opensslHeap.totalBytes, __ATOMIC_RELAXED );
+        pSnapshot->currentBytes = __atomic_load_n( &opensslHeap.currentBytes, __ATOMIC_RELAXED );
+        pSnapshot->peakBytes = __atomic_load_n( &opensslHeap.peakBytes, __ATOMIC_RELAXED );
+
+        if( resetPeak == true )
+        {
+            __atomic_store_n( &opensslHeap.peakBytes, pSnapshot->currentBytes, __ATOMIC_RELAXED );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void MemoryStats_PaintStack( size_t depth )
+{
+    /* The memory from alloca lies below the frame of this function, which
+     * is just below the frame of the caller. It is free again once this
+     * returns, so the deeper calls of the caller overwrite it. A function
+     * calling alloca is never inlined, and the volatile pointer keeps the
+     * compiler from dropping stores to memory it considers dead. */
+    volatile uint8_t * pStack = alloca( depth );
+    size_t i = 0U;
+
+    for( i = 0U; i < depth; i++ )
+    {
+        pStack[ i ] = STACK_PAINT_BYTE;
+    }
+
+    pPaintedStack = pStack;
+    paintedDepth = depth;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t MemoryStats_GetStackHighWaterMark( void )
+{
+    size_t untouched = 0U;
+
+    if( pPaintedStack != NULL )
+    {
+        /* The stack grows down, so the deepest use is the lowest byte that
+         * no longer holds the paint. */
+        while( ( untouched < paintedDepth ) &&
+               ( pPaintedStack[ untouched ] == STACK_PAINT_BYTE ) )
+        {
+            untouched++;
+        }
+    }
+
+    return paintedDepth - untouched;
+}
+
+/*-----------------------------------------------------------*/
+
+void MemoryStats_Log( const char * pLabel )
+{
+    MemoryStatsHeap_t heap;
+    size_t stackUsed = MemoryStats_GetStackHighWaterMark();
+
+    MemoryStats_GetOpensslHeap( &heap, false );
+
+    LogInfo( ( "Memory used by %s: OpenSSL heap current=%lu peak=%lu bytes, "
+               "allocations=%lu frees=%lu totalBytes=%lu; stack high water mark=%lu of %lu bytes painted%s.",
+               ( pLabel != NULL ) ? pLabel : "",
+               ( unsigned long ) heap.currentBytes,
+               ( unsigned long ) heap.peakBytes,
+               ( unsigned long ) heap.allocations,
+               ( unsigned long ) heap.frees,
+               ( unsigned long ) heap.totalBytes,
+               ( unsigned long ) stackUsed,
+               ( unsigned long ) paintedDepth,
+               ( ( paintedDepth > 0U ) && ( stackUsed == paintedDepth ) ) ? " (overflowed the paint)" : "" ) );
+}
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( MEMORY_STATS_ENABLED != 0 ) */
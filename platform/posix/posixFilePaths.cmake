@@ -7,7 +7,13 @@
 
 # Sockets utility source files.
 set( SOCKETS_SOURCES
-     ${CMAKE_CURRENT_LIST_DIR}/transport/src/sockets_posix.c )
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/sockets_posix.c
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/dns_cache_posix.c )
+
+# Transport statistics source files, used by the plaintext and OpenSSL
+# transports.
+set( TRANSPORT_STATS_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/transport_stats_posix.c )
 
 # Plaintext transport source files.
 set( PLAINTEXT_TRANSPORT_SOURCES
@@ -17,6 +23,22 @@ set( PLAINTEXT_TRANSPORT_SOURCES
 set( OPENSSL_TRANSPORT_SOURCES
      ${CMAKE_CURRENT_LIST_DIR}/transport/src/openssl_posix.c )
 
+# OpenSSL connection pool source files.
+set( OPENSSL_POOL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/openssl_pool_posix.c )
+
+# io_uring transport source files.
+set( IO_URING_TRANSPORT_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/io_uring_posix.c )
+
+# In-memory loopback transport source files.
+set( LOOPBACK_TRANSPORT_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/loopback_posix.c )
+
+# Event loop source files.
+set( EVENT_LOOP_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/event_loop_posix.c )
+
 # Transport Public Include directories.
 set( COMMON_TRANSPORT_INCLUDE_PUBLIC_DIRS
      ${CMAKE_CURRENT_LIST_DIR}/transport/include
@@ -26,6 +48,20 @@ set( COMMON_TRANSPORT_INCLUDE_PUBLIC_DIRS
 set( RETRY_SOURCES
      ${CMAKE_CURRENT_LIST_DIR}/retry_utils_posix.c )
 
+# Timer wheel source files.
+set( TIMER_WHEEL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/timer_wheel_posix.c )
+
+# Retry scheduler source files, which also need the retry utility and timer
+# wheel source files.
+set( RETRY_SCHEDULER_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/retry_scheduler_posix.c )
+
+# Memory measurement source files, used when MEMORY_STATS_ENABLED is defined
+# to 1.
+set( MEMORY_STATS_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/memory_stats_posix.c )
+
 # Retry Public Include directories.
 set( RETRY_INCLUDE_PUBLIC_DIRS
      ${PLATFORM_DIR}/include )
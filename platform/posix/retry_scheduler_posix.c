@@ -0,0 +1,190 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file retry_scheduler_posix.c
+ * @brief Implementation of the retry scheduler in retry_scheduler.h.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "retry_scheduler.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Timer callback that makes the next attempt of a scheduler.
+ *
+ * @param[in] pTimer The timer of the scheduler.
+ * @param[in] pContext The scheduler.
+ */
+static void runAttempt( TimerWheelTimer_t * pTimer,
+                        void * pContext );
+
+/**
+ * @brief End the retries of a scheduler and report the result.
+ *
+ * @param[in] pScheduler The scheduler.
+ * @param[in] succeeded Whether an attempt succeeded.
+ */
+static void finishRetries( RetryScheduler_t * pScheduler,
+                           bool succeeded );
+
+/*-----------------------------------------------------------*/
+
+static void finishRetries( RetryScheduler_t * pScheduler,
+                           bool succeeded )
+{
+    /* Start from the first backoff again the next time. */
+    pScheduler->retryParams.attemptsDone = 0U;
+    pScheduler->retryParams.previousBackoffMs = pScheduler->retryParams.baseBackoffMs;
+
+    if( pScheduler->config.done != NULL )
+    {
+        pScheduler->config.done( pScheduler->config.pContext, succeeded );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void runAttempt( TimerWheelTimer_t * pTimer,
+                        void * pContext )
+{
+    RetryScheduler_t * pScheduler = ( RetryScheduler_t * ) pContext;
+    RetryUtilsStatus_t retryStatus = RetryUtilsSuccess;
+    uint32_t delayMs = 0U;
+    bool succeeded = false;
+
+    /* Wait for the shared budget before attempting, so that sessions that
+     * reconnect together do not all make their attempts at once. */
+    if( pScheduler->config.pBudget != NULL )
+    {
+        retryStatus = RetryUtils_BudgetAcquire( pScheduler->config.pBudget, &delayMs );
+    }
+
+    if( retryStatus == RetryUtilsThrottled )
+    {
+        ( void ) TimerWheel_Arm( pScheduler->config.pTimerWheel,
+                                 pTimer,
+                                 pScheduler->config.getTimeMs() + delayMs );
+    }
+    else
+    {
+        succeeded = pScheduler->config.attempt( pScheduler->config.pContext );
+
+        if( pScheduler->config.pBudget != NULL )
+        {
+            ( void ) RetryUtils_BudgetRelease( pScheduler->config.pBudget );
+        }
+
+        if( succeeded == true )
+        {
+            finishRetries( pScheduler, true );
+        }
+        else if( RetryUtils_GetNextBackoffMs( &pScheduler->retryParams, &delayMs ) == RetryUtilsSuccess )
+        {
+            /* The attempt may have taken a while, so the backoff starts from
+             * the time it ended. */
+            ( void ) TimerWheel_Arm( pScheduler->config.pTimerWheel,
+                                     pTimer,
+                                     pScheduler->config.getTimeMs() + delayMs );
+        }
+        else
+        {
+            finishRetries( pScheduler, false );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+RetrySchedulerStatus_t RetryScheduler_Init( RetryScheduler_t * pScheduler,
+                                            const RetrySchedulerConfig_t * pConfig,
+                                            const RetryUtilsParams_t * pRetryParams )
+{
+    RetrySchedulerStatus_t returnStatus = RetrySchedulerSuccess;
+
+    if( ( pScheduler == NULL ) || ( pConfig == NULL ) || ( pRetryParams == NULL ) ||
+        ( pConfig->pTimerWheel == NULL ) || ( pConfig->getTimeMs == NULL ) ||
+        ( pConfig->attempt == NULL ) )
+    {
+        returnStatus = RetrySchedulerBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pScheduler, 0, sizeof( RetryScheduler_t ) );
+        pScheduler->config = *pConfig;
+        pScheduler->retryParams = *pRetryParams;
+        ( void ) TimerWheel_InitTimer( &pScheduler->timer, runAttempt, pScheduler );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+RetrySchedulerStatus_t RetryScheduler_Start( RetryScheduler_t * pScheduler )
+{
+    RetrySchedulerStatus_t returnStatus = RetrySchedulerSuccess;
+
+    if( pScheduler == NULL )
+    {
+        returnStatus = RetrySchedulerBadParameter;
+    }
+    else if( TimerWheel_IsArmed( &pScheduler->timer ) == false )
+    {
+        /* The first attempt is made right away, on the next advance. */
+        ( void ) TimerWheel_Arm( pScheduler->config.pTimerWheel,
+                                 &pScheduler->timer,
+                                 pScheduler->config.getTimeMs() );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+RetrySchedulerStatus_t RetryScheduler_Cancel( RetryScheduler_t * pScheduler )
+{
+    RetrySchedulerStatus_t returnStatus = RetrySchedulerSuccess;
+
+    if( pScheduler == NULL )
+    {
+        returnStatus = RetrySchedulerBadParameter;
+    }
+    else
+    {
+        ( void ) TimerWheel_Cancel( pScheduler->config.pTimerWheel, &pScheduler->timer );
+        pScheduler->retryParams.attemptsDone = 0U;
+        pScheduler->retryParams.previousBackoffMs = pScheduler->retryParams.baseBackoffMs;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+bool RetryScheduler_IsPending( const RetryScheduler_t * pScheduler )
+{
+    return ( pScheduler != NULL ) && TimerWheel_IsArmed( &pScheduler->timer );
+}
+/*-----------------------------------------------------------*/
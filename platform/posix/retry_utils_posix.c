@@ -28,9 +28,91 @@
 /* Standard includes. */
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include <time.h>
 
 #include "retry_utils.h"
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Multiplier used to mix the bits of the seed of #nextRandom.
+ */
+#define SEED_MIX_MULTIPLIER    ( 0x9E3779B9U )
+
+/**
+ * @brief Seed used when mixing the clock and address gives 0, which would
+ * keep the generator at 0 forever.
+ */
+#define FALLBACK_SEED          ( 0x2545F491U )
+
+/**
+ * @brief Number of attempts after which doubling the base backoff would
+ * overflow 32 bits, so that the maximum backoff is used instead.
+ */
+#define MAX_DOUBLINGS          ( 31U )
+
+/**
+ * @brief Number of milliseconds in one second.
+ */
+#define ONE_SEC_TO_MS          ( 1000U )
+
+/**
+ * @brief Number of nanoseconds in one millisecond.
+ */
+#define ONE_MS_TO_NS           ( 1000000U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the next value of the xorshift pseudo random number generator
+ * of a set of retry parameters.
+ *
+ * @param[in, out] pRetryParams The retry parameters holding the generator state.
+ *
+ * @return A pseudo random 32-bit value.
+ */
+static uint32_t nextRandom( RetryUtilsParams_t * pRetryParams );
+
+/**
+ * @brief Get a pseudo random value in a range.
+ *
+ * @param[in, out] pRetryParams The retry parameters holding the generator state.
+ * @param[in] low The lowest value of the range.
+ * @param[in] high The highest value of the range, included.
+ *
+ * @return A value from @p low to @p high.
+ */
+static uint32_t randomBetween( RetryUtilsParams_t * pRetryParams,
+                               uint32_t low,
+                               uint32_t high );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t nextRandom( RetryUtilsParams_t * pRetryParams )
+{
+    uint32_t state = pRetryParams->randomState;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    pRetryParams->randomState = state;
+
+    return state;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t randomBetween( RetryUtilsParams_t * pRetryParams,
+                               uint32_t low,
+                               uint32_t high )
+{
+    uint64_t range = ( ( uint64_t ) high - ( uint64_t ) low ) + 1U;
+
+    return low + ( uint32_t ) ( ( uint64_t ) nextRandom( pRetryParams ) % range );
+}
 
 /*-----------------------------------------------------------*/
 
@@ -39,6 +121,12 @@ RetryUtilsStatus_t RetryUtils_BackoffAndSleep( RetryUtilsParams_t * pRetryParams
     RetryUtilsStatus_t status = RetryUtilsRetriesExhausted;
     int backOffDelay = 0;
 
+    /* The attempt that failed is no longer in progress. */
+    if( pRetryParams->pBudget != NULL )
+    {
+        ( void ) RetryUtils_BudgetRelease( pRetryParams->pBudget );
+    }
+
     /* If MAX_RETRY_ATTEMPTS is set to 0, try forever. */
     if( ( pRetryParams->attemptsDone < MAX_RETRY_ATTEMPTS ) ||
         ( 0 == MAX_RETRY_ATTEMPTS ) )
@@ -63,6 +151,13 @@ RetryUtilsStatus_t RetryUtils_BackoffAndSleep( RetryUtilsParams_t * pRetryParams
             pRetryParams->nextJitterMax = MAX_RETRY_BACKOFF_SECONDS;
         }
 
+        /* Wait until the budget shared with other connections allows the
+         * next attempt. */
+        if( pRetryParams->pBudget != NULL )
+        {
+            ( void ) RetryUtils_BudgetAcquireAndSleep( pRetryParams->pBudget );
+        }
+
         status = RetryUtilsSuccess;
     }
     else
@@ -86,6 +181,7 @@ void RetryUtils_ParamsReset( RetryUtilsParams_t * pRetryParams )
 
     /* Reset attempts done to zero so that the next retry cycle can start. */
     pRetryParams->attemptsDone = 0;
+    pRetryParams->pBudget = NULL;
 
     /* Get current time to seed pseudo random number generator. */
     ( void ) clock_gettime( CLOCK_REALTIME, &tp );
@@ -101,3 +197,282 @@ void RetryUtils_ParamsReset( RetryUtilsParams_t * pRetryParams )
 }
 
 /*-----------------------------------------------------------*/
+
+RetryUtilsStatus_t RetryUtils_ParamsInit( RetryUtilsParams_t * pRetryParams,
+                                          uint32_t maxAttempts,
+                                          uint32_t baseBackoffMs,
+                                          uint32_t maxBackoffMs,
+                                          RetryUtilsJitter_t jitter,
+                                          uint32_t seed )
+{
+    RetryUtilsStatus_t status = RetryUtilsSuccess;
+    uint64_t nowNs = 0U;
+
+    if( ( pRetryParams == NULL ) || ( baseBackoffMs == 0U ) ||
+        ( maxBackoffMs < baseBackoffMs ) ||
+        ( ( jitter != RetryUtilsFullJitter ) && ( jitter != RetryUtilsDecorrelatedJitter ) ) )
+    {
+        status = RetryUtilsBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pRetryParams, 0, sizeof( RetryUtilsParams_t ) );
+        pRetryParams->maxAttempts = maxAttempts;
+        pRetryParams->baseBackoffMs = baseBackoffMs;
+        pRetryParams->maxBackoffMs = maxBackoffMs;
+        pRetryParams->previousBackoffMs = baseBackoffMs;
+        pRetryParams->jitter = jitter;
+
+        if( seed == 0U )
+        {
+            /* Mix in the address of the parameters, so that parameters seeded
+             * at the same time by separate threads still differ. */
+            nowNs = Clock_GetTimeNs();
+            seed = ( ( uint32_t ) nowNs ^ ( uint32_t ) ( nowNs >> 32 ) ^
+                     ( uint32_t ) ( uintptr_t ) pRetryParams ) * SEED_MIX_MULTIPLIER;
+        }
+
+        pRetryParams->randomState = ( seed != 0U ) ? seed : FALLBACK_SEED;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+RetryUtilsStatus_t RetryUtils_GetNextBackoffMs( RetryUtilsParams_t * pRetryParams,
+                                                uint32_t * pNextBackoffMs )
+{
+    RetryUtilsStatus_t status = RetryUtilsSuccess;
+    uint64_t ceilingMs = 0U;
+
+    if( ( pRetryParams == NULL ) || ( pNextBackoffMs == NULL ) )
+    {
+        status = RetryUtilsBadParameter;
+    }
+    else if( ( pRetryParams->maxAttempts != 0U ) &&
+             ( pRetryParams->attemptsDone >= pRetryParams->maxAttempts ) )
+    {
+        /* Let the application know retries are exhausted, and reset the
+         * attempts so that it may start a new cycle of retries. */
+        status = RetryUtilsRetriesExhausted;
+        pRetryParams->attemptsDone = 0U;
+        pRetryParams->previousBackoffMs = pRetryParams->baseBackoffMs;
+    }
+    else
+    {
+        if( pRetryParams->jitter == RetryUtilsDecorrelatedJitter )
+        {
+            ceilingMs = ( uint64_t ) pRetryParams->previousBackoffMs * 3U;
+            ceilingMs = ( ceilingMs < pRetryParams->maxBackoffMs ) ? ceilingMs : pRetryParams->maxBackoffMs;
+            *pNextBackoffMs = randomBetween( pRetryParams,
+                                             pRetryParams->baseBackoffMs,
+                                             ( uint32_t ) ceilingMs );
+        }
+        else
+        {
+            ceilingMs = pRetryParams->maxBackoffMs;
+
+            if( pRetryParams->attemptsDone < MAX_DOUBLINGS )
+            {
+                ceilingMs = ( uint64_t ) pRetryParams->baseBackoffMs << pRetryParams->attemptsDone;
+                ceilingMs = ( ceilingMs < pRetryParams->maxBackoffMs ) ? ceilingMs : pRetryParams->maxBackoffMs;
+            }
+
+            *pNextBackoffMs = randomBetween( pRetryParams, 0U, ( uint32_t ) ceilingMs );
+        }
+
+        pRetryParams->previousBackoffMs = *pNextBackoffMs;
+
+        /* Keep counting when retrying forever, without wrapping around. */
+        if( pRetryParams->attemptsDone < UINT32_MAX )
+        {
+            pRetryParams->attemptsDone++;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+RetryUtilsStatus_t RetryUtils_BudgetInit( RetryUtilsBudget_t * pBudget,
+                                          uint32_t capacity,
+                                          uint32_t refillIntervalMs,
+                                          uint32_t maxInProgress )
+{
+    RetryUtilsStatus_t status = RetryUtilsSuccess;
+
+    if( ( pBudget == NULL ) || ( capacity == 0U ) || ( refillIntervalMs == 0U ) ||
+        ( ( ( uint64_t ) capacity - 1U ) * refillIntervalMs > UINT32_MAX ) )
+    {
+        status = RetryUtilsBadParameter;
+    }
+    else
+    {
+        /* A full time of 0 is in the past, so the bucket starts full. */
+        ( void ) memset( pBudget, 0, sizeof( RetryUtilsBudget_t ) );
+        pBudget->refillIntervalMs = refillIntervalMs;
+        pBudget->burstToleranceMs = ( capacity - 1U ) * refillIntervalMs;
+        pBudget->maxInProgress = maxInProgress;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+RetryUtilsStatus_t RetryUtils_BudgetAcquire( RetryUtilsBudget_t * pBudget,
+                                             uint32_t * pWaitMs )
+{
+    RetryUtilsStatus_t status = RetryUtilsSuccess;
+    uint32_t inProgress = 0U;
+    uint64_t nowMs = 0U, fullAtMs = 0U, startMs = 0U;
+    bool updated = false;
+    uint32_t waitMs = 0U;
+
+    if( pBudget == NULL )
+    {
+        status = RetryUtilsBadParameter;
+    }
+    else
+    {
+        /* Claim a slot for an attempt in progress. */
+        inProgress = __atomic_load_n( &pBudget->inProgress, __ATOMIC_RELAXED );
+
+        while( ( updated == false ) && ( status == RetryUtilsSuccess ) )
+        {
+            if( ( pBudget->maxInProgress != 0U ) && ( inProgress >= pBudget->maxInProgress ) )
+            {
+                /* There is no telling when an attempt in progress completes,
+                 * so suggest waiting for one refill interval. */
+                status = RetryUtilsThrottled;
+                waitMs = pBudget->refillIntervalMs;
+                ( void ) __atomic_add_fetch( &pBudget->concurrencyThrottled, 1U, __ATOMIC_RELAXED );
+            }
+            else
+            {
+                updated = __atomic_compare_exchange_n( &pBudget->inProgress, &inProgress, inProgress + 1U,
+                                                       false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED );
+            }
+        }
+
+        /* Take an attempt from the bucket. This is the generic cell rate
+         * algorithm: the bucket has an attempt left as long as the time at
+         * which it is full again is at most the burst tolerance away. */
+        if( status == RetryUtilsSuccess )
+        {
+            nowMs = Clock_GetTimeNs() / ONE_MS_TO_NS;
+            fullAtMs = __atomic_load_n( &pBudget->fullAtMs, __ATOMIC_RELAXED );
+            updated = false;
+
+            while( ( updated == false ) && ( status == RetryUtilsSuccess ) )
+            {
+                startMs = ( fullAtMs > nowMs ) ? fullAtMs : nowMs;
+
+                if( ( startMs - nowMs ) > pBudget->burstToleranceMs )
+                {
+                    status = RetryUtilsThrottled;
+                    waitMs = ( uint32_t ) ( ( startMs - nowMs ) - pBudget->burstToleranceMs );
+                    ( void ) __atomic_add_fetch( &pBudget->rateThrottled, 1U, __ATOMIC_RELAXED );
+                    ( void ) __atomic_sub_fetch( &pBudget->inProgress, 1U, __ATOMIC_ACQ_REL );
+                }
+                else
+                {
+                    updated = __atomic_compare_exchange_n( &pBudget->fullAtMs, &fullAtMs,
+                                                           startMs + pBudget->refillIntervalMs,
+                                                           false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED );
+                }
+            }
+        }
+
+        if( status == RetryUtilsSuccess )
+        {
+            ( void ) __atomic_add_fetch( &pBudget->granted, 1U, __ATOMIC_RELAXED );
+        }
+        else if( pWaitMs != NULL )
+        {
+            *pWaitMs = waitMs;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+RetryUtilsStatus_t RetryUtils_BudgetAcquireAndSleep( RetryUtilsBudget_t * pBudget )
+{
+    RetryUtilsStatus_t status = RetryUtilsThrottled;
+    uint32_t waitMs = 0U;
+    struct timespec sleepTime;
+
+    while( status == RetryUtilsThrottled )
+    {
+        status = RetryUtils_BudgetAcquire( pBudget, &waitMs );
+
+        if( status == RetryUtilsThrottled )
+        {
+            sleepTime.tv_sec = ( time_t ) ( waitMs / ONE_SEC_TO_MS );
+            sleepTime.tv_nsec = ( long ) ( waitMs % ONE_SEC_TO_MS ) * ( long ) ONE_MS_TO_NS;
+            ( void ) nanosleep( &sleepTime, NULL );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+RetryUtilsStatus_t RetryUtils_BudgetRelease( RetryUtilsBudget_t * pBudget )
+{
+    RetryUtilsStatus_t status = RetryUtilsSuccess;
+    uint32_t inProgress = 0U;
+    bool updated = false;
+
+    if( pBudget == NULL )
+    {
+        status = RetryUtilsBadParameter;
+    }
+    else
+    {
+        /* Never go below 0, even if the application releases too often. */
+        inProgress = __atomic_load_n( &pBudget->inProgress, __ATOMIC_RELAXED );
+
+        while( ( updated == false ) && ( inProgress > 0U ) )
+        {
+            updated = __atomic_compare_exchange_n( &pBudget->inProgress, &inProgress, inProgress - 1U,
+                                                   false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+RetryUtilsStatus_t RetryUtils_BudgetGetStats( const RetryUtilsBudget_t * pBudget,
+                                              RetryUtilsBudgetStats_t * pStats )
+{
+    RetryUtilsStatus_t status = RetryUtilsSuccess;
+
+    if( ( pBudget == NULL ) || ( pStats == NULL ) )
+    {
+        status = RetryUtilsBadParameter;
+    }
+    else
+    {
+        pStats->inProgress = __atomic_load_n( &pBudget->inProgress, __ATOMIC_RELAXED );
+        pStats->granted = __atomic_load_n( &pBudget->granted, __ATOMIC_RELAXED );
+        pStats->rateThrottled = __atomic_load_n( &pBudget->rateThrottled, __ATOMIC_RELAXED );
+        pStats->concurrencyThrottled = __atomic_load_n( &pBudget->concurrencyThrottled, __ATOMIC_RELAXED );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,576 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file timer_wheel_posix.c
+ * @brief Implementation of the hierarchical timer wheel in timer_wheel.h.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "timer_wheel.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Mask of the slot index within one level.
+ */
+#define SLOT_MASK           ( TIMER_WHEEL_SLOTS - 1U )
+
+/**
+ * @brief Value of @ref TimerWheelTimer.level for a timer that is not armed.
+ */
+#define LEVEL_NOT_ARMED     ( 0xFFU )
+
+/**
+ * @brief Value of @ref TimerWheelTimer.level for a timer that expired and is
+ * waiting in @ref TimerWheel.pExpired for its callback to run.
+ */
+#define LEVEL_EXPIRED       ( 0xFEU )
+
+/**
+ * @brief Number of milliseconds from the current time that the levels of the
+ * wheel cover.
+ */
+#define WHEEL_RANGE_MS      ( 1UL << ( TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS ) )
+
+/**
+ * @brief Shift of the time to get the slot index in a level.
+ */
+#define LEVEL_SHIFT( level )    ( ( uint32_t ) ( level ) * TIMER_WHEEL_SLOT_BITS )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Add a timer to the head of a list.
+ *
+ * @param[in,out] ppHead The head of the list.
+ * @param[in] pTimer The timer to add.
+ */
+static void pushTimer( TimerWheelTimer_t ** ppHead,
+                       TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Remove a timer from the list it is in.
+ *
+ * @param[in,out] ppHead The head of the list.
+ * @param[in] pTimer The timer to remove.
+ */
+static void unlinkTimer( TimerWheelTimer_t ** ppHead,
+                         TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Place a timer in the slot for its expiry time relative to the
+ * current time of the wheel.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] pTimer The timer, which is not in any list.
+ */
+static void insertTimer( TimerWheel_t * pTimerWheel,
+                         TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Remove an armed timer from its slot or from the expired list.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] pTimer The armed timer.
+ */
+static void removeTimer( TimerWheel_t * pTimerWheel,
+                         TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Move the timers of a slot to the levels below, now that the current
+ * time has reached the start of the slot.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] level The level of the slot, greater than 0.
+ * @param[in] slot The index of the slot.
+ */
+static void cascadeSlot( TimerWheel_t * pTimerWheel,
+                         uint32_t level,
+                         uint32_t slot );
+
+/**
+ * @brief Process the current time of the wheel: move down the timers of the
+ * slots it starts, then run the timers that expire at it.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ */
+static void processTick( TimerWheel_t * pTimerWheel );
+
+/**
+ * @brief Get the time up to which the wheel can skip ahead without missing a
+ * timer or a slot to move down.
+ *
+ * @param[in] pTimerWheel The timer wheel.
+ * @param[in] endMs One past the time the wheel is advanced to.
+ *
+ * @return The next time that must be processed, or @p endMs.
+ */
+static uint32_t getSkipTarget( const TimerWheel_t * pTimerWheel,
+                               uint32_t endMs );
+
+/**
+ * @brief Find the first slot that is not empty in a level, searching from a
+ * slot index and wrapping around.
+ *
+ * @param[in] occupied Bit map of the slots that are not empty.
+ * @param[in] start The slot index to start searching from.
+ *
+ * @return The number of slots after @p start of the slot found.
+ */
+static uint32_t findNextSlot( uint64_t occupied,
+                              uint32_t start );
+
+/*-----------------------------------------------------------*/
+
+static void pushTimer( TimerWheelTimer_t ** ppHead,
+                       TimerWheelTimer_t * pTimer )
+{
+    pTimer->pPrev = NULL;
+    pTimer->pNext = *ppHead;
+
+    if( *ppHead != NULL )
+    {
+        ( *ppHead )->pPrev = pTimer;
+    }
+
+    *ppHead = pTimer;
+}
+/*-----------------------------------------------------------*/
+
+static void unlinkTimer( TimerWheelTimer_t ** ppHead,
+                         TimerWheelTimer_t * pTimer )
+{
+    if( pTimer->pPrev != NULL )
+    {
+        pTimer->pPrev->pNext = pTimer->pNext;
+    }
+    else
+    {
+        *ppHead = pTimer->pNext;
+    }
+
+    if( pTimer->pNext != NULL )
+    {
+        pTimer->pNext->pPrev = pTimer->pPrev;
+    }
+
+    pTimer->pNext = NULL;
+    pTimer->pPrev = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void insertTimer( TimerWheel_t * pTimerWheel,
+                         TimerWheelTimer_t * pTimer )
+{
+    uint32_t deltaMs = 0U, slotTimeMs = 0U, level = 0U, slot = 0U;
+
+    /* A timer that is already due expires at the current time. */
+    if( ( int32_t ) ( pTimer->expiryMs - pTimerWheel->currentMs ) < 0 )
+    {
+        pTimer->expiryMs = pTimerWheel->currentMs;
+    }
+
+    deltaMs = pTimer->expiryMs - pTimerWheel->currentMs;
+    slotTimeMs = pTimer->expiryMs;
+
+    /* Park a timer beyond the range of the wheel in the furthest slot. It is
+     * placed again, closer to its expiry, when that slot is reached. */
+    if( deltaMs >= WHEEL_RANGE_MS )
+    {
+        slotTimeMs = pTimerWheel->currentMs + ( uint32_t ) ( WHEEL_RANGE_MS - 1U );
+        deltaMs = ( uint32_t ) ( WHEEL_RANGE_MS - 1U );
+    }
+
+    /* Use the lowest level whose slots cover the time until expiry. */
+    while( ( level < ( TIMER_WHEEL_LEVELS - 1U ) ) &&
+           ( deltaMs >= ( 1UL << LEVEL_SHIFT( level + 1U ) ) ) )
+    {
+        level++;
+    }
+
+    slot = ( slotTimeMs >> LEVEL_SHIFT( level ) ) & SLOT_MASK;
+
+    pTimer->level = ( uint8_t ) level;
+    pTimer->slot = ( uint8_t ) slot;
+    pushTimer( &pTimerWheel->pSlots[ level ][ slot ], pTimer );
+    pTimerWheel->occupied[ level ] |= ( ( uint64_t ) 1U << slot );
+}
+/*-----------------------------------------------------------*/
+
+static void removeTimer( TimerWheel_t * pTimerWheel,
+                         TimerWheelTimer_t * pTimer )
+{
+    TimerWheelTimer_t ** ppHead = NULL;
+
+    if( pTimer->level == LEVEL_EXPIRED )
+    {
+        unlinkTimer( &pTimerWheel->pExpired, pTimer );
+    }
+    else
+    {
+        ppHead = &pTimerWheel->pSlots[ pTimer->level ][ pTimer->slot ];
+        unlinkTimer( ppHead, pTimer );
+
+        if( *ppHead == NULL )
+        {
+            pTimerWheel->occupied[ pTimer->level ] &= ~( ( uint64_t ) 1U << pTimer->slot );
+        }
+    }
+
+    pTimer->level = LEVEL_NOT_ARMED;
+}
+/*-----------------------------------------------------------*/
+
+static void cascadeSlot( TimerWheel_t * pTimerWheel,
+                         uint32_t level,
+                         uint32_t slot )
+{
+    TimerWheelTimer_t * pTimer = pTimerWheel->pSlots[ level ][ slot ];
+    TimerWheelTimer_t * pNext = NULL;
+
+    pTimerWheel->pSlots[ level ][ slot ] = NULL;
+    pTimerWheel->occupied[ level ] &= ~( ( uint64_t ) 1U << slot );
+
+    while( pTimer != NULL )
+    {
+        pNext = pTimer->pNext;
+        insertTimer( pTimerWheel, pTimer );
+        pTimer = pNext;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void processTick( TimerWheel_t * pTimerWheel )
+{
+    TimerWheelTimer_t * pTimer = NULL;
+    uint32_t tickMs = pTimerWheel->currentMs, level = 1U, slot = 0U;
+
+    /* Each time a level wraps around, move the timers of the next slot of the
+     * level above into the levels below. */
+    while( ( level < TIMER_WHEEL_LEVELS ) &&
+           ( ( ( tickMs >> LEVEL_SHIFT( level - 1U ) ) & SLOT_MASK ) == 0U ) )
+    {
+        cascadeSlot( pTimerWheel, level, ( tickMs >> LEVEL_SHIFT( level ) ) & SLOT_MASK );
+        level++;
+    }
+
+    /* The timers of the slot move to the expired list before any callback
+     * runs, so a timer armed by a callback cannot land in the list being
+     * processed, and a callback can still cancel a timer that has expired
+     * but not run yet. */
+    slot = tickMs & SLOT_MASK;
+    pTimerWheel->pExpired = pTimerWheel->pSlots[ 0 ][ slot ];
+    pTimerWheel->pSlots[ 0 ][ slot ] = NULL;
+    pTimerWheel->occupied[ 0 ] &= ~( ( uint64_t ) 1U << slot );
+
+    for( pTimer = pTimerWheel->pExpired; pTimer != NULL; pTimer = pTimer->pNext )
+    {
+        pTimer->level = LEVEL_EXPIRED;
+    }
+
+    pTimerWheel->currentMs = tickMs + 1U;
+
+    while( pTimerWheel->pExpired != NULL )
+    {
+        pTimer = pTimerWheel->pExpired;
+        removeTimer( pTimerWheel, pTimer );
+        pTimerWheel->armedCount--;
+        pTimer->callback( pTimer, pTimer->pContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t getSkipTarget( const TimerWheel_t * pTimerWheel,
+                               uint32_t endMs )
+{
+    uint32_t targetMs = endMs, boundaryMask = 0U, level = 0U;
+
+    /* Find the highest level that has no timers in it or in any level below
+     * it. Nothing happens until the start of the next slot of the level above
+     * it, where timers may have to be moved down. */
+    while( ( level < TIMER_WHEEL_LEVELS ) && ( pTimerWheel->occupied[ level ] == 0U ) )
+    {
+        level++;
+    }
+
+    if( level < TIMER_WHEEL_LEVELS )
+    {
+        boundaryMask = ( uint32_t ) ( ( 1UL << LEVEL_SHIFT( level ) ) - 1U );
+        targetMs = ( pTimerWheel->currentMs + boundaryMask ) & ~boundaryMask;
+
+        /* Do not skip past the time the wheel is advanced to. */
+        if( ( int32_t ) ( targetMs - endMs ) > 0 )
+        {
+            targetMs = endMs;
+        }
+    }
+
+    return targetMs;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t findNextSlot( uint64_t occupied,
+                              uint32_t start )
+{
+    uint32_t distance = 0U;
+
+    while( ( distance < TIMER_WHEEL_SLOTS ) &&
+           ( ( occupied & ( ( uint64_t ) 1U << ( ( start + distance ) & SLOT_MASK ) ) ) == 0U ) )
+    {
+        distance++;
+    }
+
+    return distance;
+}
+/*-----------------------------------------------------------*/
+
+TimerWheelStatus_t TimerWheel_Init( TimerWheel_t * pTimerWheel,
+                                    uint32_t nowMs )
+{
+    TimerWheelStatus_t returnStatus = TimerWheelSuccess;
+
+    if( pTimerWheel == NULL )
+    {
+        returnStatus = TimerWheelBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pTimerWheel, 0, sizeof( TimerWheel_t ) );
+        pTimerWheel->currentMs = nowMs;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+TimerWheelStatus_t TimerWheel_InitTimer( TimerWheelTimer_t * pTimer,
+                                         TimerWheelCallback_t callback,
+                                         void * pContext )
+{
+    TimerWheelStatus_t returnStatus = TimerWheelSuccess;
+
+    if( ( pTimer == NULL ) || ( callback == NULL ) )
+    {
+        returnStatus = TimerWheelBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pTimer, 0, sizeof( TimerWheelTimer_t ) );
+        pTimer->callback = callback;
+        pTimer->pContext = pContext;
+        pTimer->level = LEVEL_NOT_ARMED;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+TimerWheelStatus_t TimerWheel_Arm( TimerWheel_t * pTimerWheel,
+                                   TimerWheelTimer_t * pTimer,
+                                   uint32_t expiryMs )
+{
+    TimerWheelStatus_t returnStatus = TimerWheelSuccess;
+
+    if( ( pTimerWheel == NULL ) || ( pTimer == NULL ) )
+    {
+        returnStatus = TimerWheelBadParameter;
+    }
+    else
+    {
+        if( pTimer->level == LEVEL_NOT_ARMED )
+        {
+            pTimerWheel->armedCount++;
+        }
+        else
+        {
+            removeTimer( pTimerWheel, pTimer );
+        }
+
+        pTimer->expiryMs = expiryMs;
+        insertTimer( pTimerWheel, pTimer );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+TimerWheelStatus_t TimerWheel_Cancel( TimerWheel_t * pTimerWheel,
+                                      TimerWheelTimer_t * pTimer )
+{
+    TimerWheelStatus_t returnStatus = TimerWheelSuccess;
+
+    if( ( pTimerWheel == NULL ) || ( pTimer == NULL ) )
+    {
+        returnStatus = TimerWheelBadParameter;
+    }
+    else if( pTimer->level != LEVEL_NOT_ARMED )
+    {
+        removeTimer( pTimerWheel, pTimer );
+        pTimerWheel->armedCount--;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+bool TimerWheel_IsArmed( const TimerWheelTimer_t * pTimer )
+{
+    return ( pTimer != NULL ) && ( pTimer->level != LEVEL_NOT_ARMED );
+}
+/*-----------------------------------------------------------*/
+
+TimerWheelStatus_t TimerWheel_Advance( TimerWheel_t * pTimerWheel,
+                                       uint32_t nowMs )
+{
+    TimerWheelStatus_t returnStatus = TimerWheelSuccess;
+    uint32_t endMs = nowMs + 1U, targetMs = 0U;
+
+    if( pTimerWheel == NULL )
+    {
+        returnStatus = TimerWheelBadParameter;
+    }
+    else
+    {
+        while( ( int32_t ) ( endMs - pTimerWheel->currentMs ) > 0 )
+        {
+            /* Skip the times at which nothing can happen, so that advancing
+             * over a long idle period does not visit every millisecond. */
+            targetMs = getSkipTarget( pTimerWheel, endMs );
+
+            if( targetMs != pTimerWheel->currentMs )
+            {
+                pTimerWheel->currentMs = targetMs;
+            }
+            else
+            {
+                processTick( pTimerWheel );
+            }
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+TimerWheelStatus_t TimerWheel_NextDeadline( const TimerWheel_t * pTimerWheel,
+                                            uint32_t * pDeadlineMs )
+{
+    TimerWheelStatus_t returnStatus = TimerWheelSuccess;
+    const TimerWheelTimer_t * pTimer = NULL;
+    uint32_t level = 0U, slot = 0U, position = 0U, slotMask = 0U, startMs = 0U;
+    uint32_t distanceMs = 0U, minDistanceMs = UINT32_MAX;
+
+    if( ( pTimerWheel == NULL ) || ( pDeadlineMs == NULL ) )
+    {
+        returnStatus = TimerWheelBadParameter;
+    }
+    else if( pTimerWheel->armedCount == 0U )
+    {
+        returnStatus = TimerWheelNoTimers;
+    }
+    else if( pTimerWheel->pExpired != NULL )
+    {
+        /* Called from a callback while other expired timers wait to run. */
+        *pDeadlineMs = pTimerWheel->pExpired->expiryMs;
+    }
+    else
+    {
+        /* The slots of level 0 are one millisecond each, so the first one that
+         * is not empty gives the exact expiry of its timers. */
+        if( pTimerWheel->occupied[ 0 ] != 0U )
+        {
+            minDistanceMs = findNextSlot( pTimerWheel->occupied[ 0 ],
+                                          pTimerWheel->currentMs & SLOT_MASK );
+        }
+
+        /* In the levels above, slots are searched in order of their start
+         * time, from the first slot that has not been moved down: the slot
+         * after the one of the current time, unless the current time is the
+         * start of that slot. No timer of a slot expires before the slot
+         * starts, so the search ends at the first slot that starts after the
+         * earliest expiry found. Usually that is the slot after the first
+         * one that is not empty, but a timer parked beyond the range of the
+         * wheel can expire long after later slots of the top level. */
+        for( level = 1U; level < TIMER_WHEEL_LEVELS; level++ )
+        {
+            if( pTimerWheel->occupied[ level ] != 0U )
+            {
+                slotMask = ( uint32_t ) ( ( 1UL << LEVEL_SHIFT( level ) ) - 1U );
+                startMs = ( pTimerWheel->currentMs + slotMask ) & ~slotMask;
+                slot = ( startMs >> LEVEL_SHIFT( level ) ) & SLOT_MASK;
+                position = findNextSlot( pTimerWheel->occupied[ level ], slot );
+
+                while( ( position < TIMER_WHEEL_SLOTS ) &&
+                       ( ( ( startMs - pTimerWheel->currentMs ) + ( position << LEVEL_SHIFT( level ) ) ) < minDistanceMs ) )
+                {
+                    for( pTimer = pTimerWheel->pSlots[ level ][ ( slot + position ) & SLOT_MASK ];
+                         pTimer != NULL;
+                         pTimer = pTimer->pNext )
+                    {
+                        distanceMs = pTimer->expiryMs - pTimerWheel->currentMs;
+
+                        if( distanceMs < minDistanceMs )
+                        {
+                            minDistanceMs = distanceMs;
+                        }
+                    }
+
+                    position += 1U + findNextSlot( pTimerWheel->occupied[ level ],
+                                                   ( slot + position + 1U ) & SLOT_MASK );
+                }
+            }
+        }
+
+        *pDeadlineMs = pTimerWheel->currentMs + minDistanceMs;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t TimerWheel_GetTimeoutMs( const TimerWheel_t * pTimerWheel,
+                                  uint32_t nowMs )
+{
+    uint32_t timeoutMs = TIMER_WHEEL_WAIT_FOREVER, deadlineMs = 0U;
+
+    if( TimerWheel_NextDeadline( pTimerWheel, &deadlineMs ) == TimerWheelSuccess )
+    {
+        if( ( int32_t ) ( deadlineMs - nowMs ) > 0 )
+        {
+            timeoutMs = deadlineMs - nowMs;
+        }
+        else
+        {
+            timeoutMs = 0U;
+        }
+    }
+
+    return timeoutMs;
+}
+/*-----------------------------------------------------------*/
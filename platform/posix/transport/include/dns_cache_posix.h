@@ -0,0 +1,203 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DNS_CACHE_POSIX_H_
+#define DNS_CACHE_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the DNS cache. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "DNS_Cache"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+/**
+ * @brief The maximum number of host names kept in the cache. When the cache
+ * is full, the entry that expires first is replaced.
+ */
+#ifndef DNS_CACHE_MAX_ENTRIES
+    #define DNS_CACHE_MAX_ENTRIES             ( 4U )
+#endif
+
+/**
+ * @brief The maximum number of resolved addresses kept for a host name.
+ */
+#ifndef DNS_CACHE_MAX_ADDRESSES
+    #define DNS_CACHE_MAX_ADDRESSES           ( 8U )
+#endif
+
+/**
+ * @brief The maximum length of a host name that can be cached.
+ */
+#ifndef DNS_CACHE_MAX_HOST_NAME_LENGTH
+    #define DNS_CACHE_MAX_HOST_NAME_LENGTH    ( 253U )
+#endif
+
+/**
+ * @brief How long resolved addresses are used before the host name is
+ * resolved again.
+ *
+ * @note getaddrinfo does not report the time to live of the DNS records, so
+ * this should be set to no more than the TTL of the records of the endpoint.
+ */
+#ifndef DNS_CACHE_TTL_MS
+    #define DNS_CACHE_TTL_MS                  ( 60000U )
+#endif
+
+/**
+ * @brief DNS cache return status.
+ */
+typedef enum DnsCacheStatus
+{
+    DNS_CACHE_SUCCESS = 0,       /**< Function successfully completed. */
+    DNS_CACHE_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    DNS_CACHE_DNS_FAILURE,       /**< Resolving the host name failed. */
+    DNS_CACHE_API_ERROR,         /**< A call to a system API resulted in an internal error. */
+    DNS_CACHE_IN_PROGRESS        /**< An asynchronous resolve was started. */
+} DnsCacheStatus_t;
+
+/**
+ * @brief The resolved addresses of a host name, in the same form as the list
+ * returned by getaddrinfo.
+ *
+ * The records are linked through ai_next starting from the first record, and
+ * point into this structure. The list must not be passed to freeaddrinfo.
+ */
+typedef struct DnsCacheRecord
+{
+    struct addrinfo addrInfo[ DNS_CACHE_MAX_ADDRESSES ];         /**< @brief The address records. */
+    struct sockaddr_storage addresses[ DNS_CACHE_MAX_ADDRESSES ]; /**< @brief Storage for the addresses of the records. */
+    size_t addressCount;                                         /**< @brief Number of records. */
+} DnsCacheRecord_t;
+
+/**
+ * @brief An asynchronous resolve of a host name into the cache.
+ *
+ * The hostname is resolved by a worker thread. The application waits for
+ * #DnsCacheRequest_t.notifyDescriptor to become readable, for example with
+ * #EventLoop_Add, and then calls #DnsCache_FinishResolve.
+ */
+typedef struct DnsCacheRequest
+{
+    char hostName[ DNS_CACHE_MAX_HOST_NAME_LENGTH + 1U ]; /**< @brief The host name to resolve. */
+    size_t hostNameLength;                                /**< @brief Length of the host name. */
+    int32_t notifyDescriptor;                             /**< @brief Becomes readable once the resolve completes. */
+    int32_t signalDescriptor;                             /**< @brief Written by the worker thread when it completes. */
+    pthread_t thread;                                     /**< @brief The worker thread. */
+    DnsCacheStatus_t resolveStatus;                       /**< @brief Status of the resolve. */
+} DnsCacheRequest_t;
+
+/**
+ * @brief Get the resolved addresses of a host name. The addresses are taken
+ * from the cache when they have not expired, and resolved and cached
+ * otherwise.
+ *
+ * This function is thread safe.
+ *
+ * @param[in] pHostName The host name to resolve.
+ * @param[in] hostNameLength Length of the host name.
+ * @param[out] pRecord The output parameter to return the addresses in.
+ *
+ * @return #DNS_CACHE_SUCCESS if successful; #DNS_CACHE_INVALID_PARAMETER,
+ * #DNS_CACHE_DNS_FAILURE on error.
+ */
+DnsCacheStatus_t DnsCache_Resolve( const char * pHostName,
+                                   size_t hostNameLength,
+                                   DnsCacheRecord_t * pRecord );
+
+/**
+ * @brief Start resolving a host name into the cache without blocking.
+ *
+ * @param[out] pRequest The request to start.
+ * @param[in] pHostName The host name to resolve.
+ * @param[in] hostNameLength Length of the host name.
+ *
+ * @return #DNS_CACHE_SUCCESS if the addresses are already cached, in which
+ * case there is nothing to wait for; #DNS_CACHE_IN_PROGRESS if the resolve
+ * was started; #DNS_CACHE_INVALID_PARAMETER, #DNS_CACHE_API_ERROR on error.
+ */
+DnsCacheStatus_t DnsCache_ResolveAsync( DnsCacheRequest_t * pRequest,
+                                        const char * pHostName,
+                                        size_t hostNameLength );
+
+/**
+ * @brief Complete an asynchronous resolve once
+ * #DnsCacheRequest_t.notifyDescriptor is readable, and release its resources.
+ *
+ * This blocks until the worker thread exits, so it should only be called
+ * once the notify descriptor is readable. Remove the notify descriptor from
+ * any event loop before calling this, as it is closed.
+ *
+ * @param[in] pRequest The request started by #DnsCache_ResolveAsync.
+ *
+ * @return The status of the resolve: #DNS_CACHE_SUCCESS if the addresses are
+ * now cached; #DNS_CACHE_INVALID_PARAMETER, #DNS_CACHE_DNS_FAILURE,
+ * #DNS_CACHE_API_ERROR on error.
+ */
+DnsCacheStatus_t DnsCache_FinishResolve( DnsCacheRequest_t * pRequest );
+
+/**
+ * @brief Remove a host name from the cache, so that it is resolved again.
+ *
+ * This should be called when no address of the host could be connected to.
+ *
+ * @param[in] pHostName The host name to remove.
+ * @param[in] hostNameLength Length of the host name.
+ *
+ * @return #DNS_CACHE_SUCCESS if successful; #DNS_CACHE_INVALID_PARAMETER on error.
+ */
+DnsCacheStatus_t DnsCache_Invalidate( const char * pHostName,
+                                      size_t hostNameLength );
+
+/**
+ * @brief Remove every host name from the cache.
+ */
+void DnsCache_Clear( void );
+
+#endif /* ifndef DNS_CACHE_POSIX_H_ */
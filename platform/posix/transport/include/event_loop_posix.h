@@ -0,0 +1,248 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EVENT_LOOP_POSIX_H_
+#define EVENT_LOOP_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the event loop. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Event_Loop"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/**
+ * @brief Use epoll on Linux unless #EVENT_LOOP_USE_POLL is defined. Every
+ * other POSIX system uses poll.
+ */
+#if defined( __linux__ ) && !defined( EVENT_LOOP_USE_POLL )
+    #define EVENT_LOOP_USE_EPOLL    1
+#else
+    #include <poll.h>
+#endif
+
+/**
+ * @brief The maximum number of connections a single event loop can own.
+ *
+ * The storage for every connection is part of #EventLoop_t, so this value
+ * determines the size of the event loop object.
+ */
+#ifndef EVENT_LOOP_MAX_CONNECTIONS
+    #define EVENT_LOOP_MAX_CONNECTIONS    ( 64U )
+#endif
+
+/**
+ * @brief Timeout value for #EventLoop_Wait to block until an event occurs.
+ */
+#define EVENT_LOOP_WAIT_FOREVER    ( UINT32_MAX )
+
+/**
+ * @brief Event flag for a connection that has data available to read.
+ */
+#define EVENT_LOOP_READABLE        ( 0x01U )
+
+/**
+ * @brief Event flag for a connection that can accept data to send.
+ */
+#define EVENT_LOOP_WRITABLE        ( 0x02U )
+
+/**
+ * @brief Event flag for a connection that was closed by the peer or is in an
+ * error state. It is always reported and does not need to be requested.
+ */
+#define EVENT_LOOP_ERROR           ( 0x04U )
+
+/**
+ * @brief Event loop return status.
+ */
+typedef enum EventLoopStatus
+{
+    EVENT_LOOP_SUCCESS = 0,        /**< Function successfully completed. */
+    EVENT_LOOP_INVALID_PARAMETER,  /**< At least one parameter was invalid. */
+    EVENT_LOOP_NO_MEMORY,          /**< All #EVENT_LOOP_MAX_CONNECTIONS slots are in use. */
+    EVENT_LOOP_NOT_FOUND,          /**< The socket descriptor is not owned by the event loop. */
+    EVENT_LOOP_ALREADY_REGISTERED, /**< The socket descriptor is already owned by the event loop. */
+    EVENT_LOOP_API_ERROR           /**< A call to a system API resulted in an internal error. */
+} EventLoopStatus_t;
+
+/**
+ * @brief A connection owned by the event loop.
+ */
+typedef struct EventLoopEntry
+{
+    int32_t socketDescriptor;          /**< @brief Socket descriptor, or -1 for an unused slot. */
+    NetworkContext_t * pNetworkContext; /**< @brief Network context of the connection. */
+    uint32_t interestEvents;           /**< @brief Bitwise OR of the events to wait for. */
+} EventLoopEntry_t;
+
+/**
+ * @brief An event reported by #EventLoop_Wait.
+ */
+typedef struct EventLoopEvent
+{
+    int32_t socketDescriptor;          /**< @brief Socket descriptor of the ready connection. */
+    NetworkContext_t * pNetworkContext; /**< @brief Network context registered with the connection. */
+    uint32_t events;                   /**< @brief Bitwise OR of the events that are ready. */
+} EventLoopEvent_t;
+
+/**
+ * @brief The event loop object.
+ *
+ * @note The members of this structure are private to the event loop and
+ * must not be accessed by the application.
+ */
+typedef struct EventLoop
+{
+    EventLoopEntry_t entries[ EVENT_LOOP_MAX_CONNECTIONS ]; /**< @brief Connection slots. */
+    size_t entryCount;                                      /**< @brief Number of slots in use. */
+    size_t highestEntry;                                    /**< @brief One past the highest slot in use. */
+    #ifdef EVENT_LOOP_USE_EPOLL
+        int32_t epollDescriptor;                            /**< @brief Descriptor returned by epoll_create1. */
+    #else
+        struct pollfd pollDescriptors[ EVENT_LOOP_MAX_CONNECTIONS ]; /**< @brief Descriptors passed to poll. */
+    #endif
+} EventLoop_t;
+
+/**
+ * @brief Initialize an event loop.
+ *
+ * @param[out] pEventLoop The event loop to initialize.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful;
+ * #EVENT_LOOP_INVALID_PARAMETER, #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Init( EventLoop_t * pEventLoop );
+
+/**
+ * @brief Add a connection to the event loop.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] socketDescriptor The connected socket of the connection.
+ * @param[in] pNetworkContext The network context that owns the socket. It is
+ * returned with every event reported for the socket and may be NULL for
+ * descriptors that are not transport connections.
+ * @param[in] interestEvents Bitwise OR of #EVENT_LOOP_READABLE and
+ * #EVENT_LOOP_WRITABLE.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER,
+ * #EVENT_LOOP_NO_MEMORY, #EVENT_LOOP_ALREADY_REGISTERED, #EVENT_LOOP_API_ERROR
+ * on error.
+ */
+EventLoopStatus_t EventLoop_Add( EventLoop_t * pEventLoop,
+                                 int32_t socketDescriptor,
+                                 NetworkContext_t * pNetworkContext,
+                                 uint32_t interestEvents );
+
+/**
+ * @brief Change the events the event loop waits for on a connection.
+ *
+ * A typical use is to add #EVENT_LOOP_WRITABLE only while a send is pending.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] socketDescriptor The socket of a connection added with #EventLoop_Add.
+ * @param[in] interestEvents Bitwise OR of #EVENT_LOOP_READABLE and
+ * #EVENT_LOOP_WRITABLE.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER,
+ * #EVENT_LOOP_NOT_FOUND, #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Modify( EventLoop_t * pEventLoop,
+                                    int32_t socketDescriptor,
+                                    uint32_t interestEvents );
+
+/**
+ * @brief Remove a connection from the event loop.
+ *
+ * The socket is not closed. This must be called before the socket is
+ * disconnected.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] socketDescriptor The socket of a connection added with #EventLoop_Add.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER,
+ * #EVENT_LOOP_NOT_FOUND, #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Remove( EventLoop_t * pEventLoop,
+                                    int32_t socketDescriptor );
+
+/**
+ * @brief Wait until at least one connection is ready or the timeout expires.
+ *
+ * The connections in @p pEvents are those for which the application can call
+ * #MQTT_ProcessLoop, or the transport receive and send functions, without
+ * blocking.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[out] pEvents Array to return the ready connections in.
+ * @param[in] maxEvents Number of elements in @p pEvents.
+ * @param[in] timeoutMs Time to wait for an event. 0 returns immediately and
+ * #EVENT_LOOP_WAIT_FOREVER blocks until an event occurs.
+ * @param[out] pEventCount Number of events written to @p pEvents. This is 0
+ * when the timeout expired.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful;
+ * #EVENT_LOOP_INVALID_PARAMETER, #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Wait( EventLoop_t * pEventLoop,
+                                  EventLoopEvent_t * pEvents,
+                                  size_t maxEvents,
+                                  uint32_t timeoutMs,
+                                  size_t * pEventCount );
+
+/**
+ * @brief Release the resources of an event loop.
+ *
+ * The sockets of the connections that are still added are not closed.
+ *
+ * @param[in] pEventLoop The event loop.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful;
+ * #EVENT_LOOP_INVALID_PARAMETER, #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Deinit( EventLoop_t * pEventLoop );
+
+#endif /* ifndef EVENT_LOOP_POSIX_H_ */
@@ -0,0 +1,363 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IO_URING_POSIX_H_
+#define IO_URING_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the transport interface implementation which uses
+ * io_uring and Sockets. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_IoUring_Sockets"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transport includes. */
+#include "transport_interface.h"
+#include "sockets_posix.h"
+
+/**
+ * @brief Number of submission queue entries of a ring. It is also the maximum
+ * number of receives and sends that can be in progress on a ring at a time.
+ *
+ * Every #IoUring_Recv and #IoUring_Send uses two entries while it waits, one
+ * for the operation and one for its timeout.
+ */
+#ifndef IO_URING_QUEUE_DEPTH
+    #define IO_URING_QUEUE_DEPTH    ( 64U )
+#endif
+
+/**
+ * @brief The maximum number of buffers that can be registered with a ring.
+ */
+#ifndef IO_URING_MAX_BUFFERS
+    #define IO_URING_MAX_BUFFERS    ( 64U )
+#endif
+
+/**
+ * @brief Length of every buffer registered with a ring.
+ */
+#ifndef IO_URING_BUFFER_LENGTH
+    #define IO_URING_BUFFER_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Timeout value for #IoUring_WaitCompletions to block until an
+ * operation completes.
+ */
+#define IO_URING_WAIT_FOREVER    ( UINT32_MAX )
+
+/**
+ * @brief io_uring return status.
+ */
+typedef enum IoUringStatus
+{
+    IO_URING_SUCCESS = 0,       /**< Function successfully completed. */
+    IO_URING_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    IO_URING_NO_MEMORY,         /**< The submission queue or the registered buffers are all in use. */
+    IO_URING_API_ERROR          /**< A call to a system API resulted in an internal error. */
+} IoUringStatus_t;
+
+/**
+ * @brief The kind of operation reported in an #IoUringCompletion_t.
+ */
+typedef enum IoUringOperation
+{
+    IO_URING_OPERATION_RECV = 0, /**< A receive submitted with #IoUring_SubmitRecv. */
+    IO_URING_OPERATION_SEND      /**< A send submitted with #IoUring_SubmitSend. */
+} IoUringOperation_t;
+
+/**
+ * @brief A receive or send in progress on a ring.
+ *
+ * @note The members of this structure are private to the transport.
+ */
+typedef struct IoUringRequest
+{
+    NetworkContext_t * pNetworkContext; /**< @brief Connection of the operation. */
+    void * pBuffer;                     /**< @brief Buffer of the operation. */
+    int32_t result;                     /**< @brief Result reported by the kernel. */
+    IoUringOperation_t operation;       /**< @brief The kind of operation. */
+    bool inUse;                         /**< @brief Whether the slot holds an operation. */
+    bool synchronous;                   /**< @brief Whether a #IoUring_Recv or #IoUring_Send waits for it. */
+    bool completed;                     /**< @brief Whether the kernel reported the result. */
+} IoUringRequest_t;
+
+/**
+ * @brief An operation reported by #IoUring_WaitCompletions.
+ */
+typedef struct IoUringCompletion
+{
+    NetworkContext_t * pNetworkContext; /**< @brief Connection the operation was submitted for. */
+    IoUringOperation_t operation;       /**< @brief The kind of operation. */
+    void * pBuffer;                     /**< @brief Buffer that holds the received data or was sent. */
+    int32_t result;                     /**< @brief Bytes transferred, 0 when the peer closed the
+                                         * connection or a negative errno value. */
+} IoUringCompletion_t;
+
+/**
+ * @brief An io_uring instance shared by many connections.
+ *
+ * A ring and its connections must be used from a single thread.
+ *
+ * @note The members of this structure are private to the transport and
+ * must not be accessed by the application.
+ */
+typedef struct IoUring
+{
+    int32_t ringDescriptor;                                 /**< @brief Descriptor returned by io_uring_setup. */
+    void * pSqRing;                                         /**< @brief Mapping of the submission queue ring. */
+    size_t sqRingLength;                                    /**< @brief Length of the submission queue ring mapping. */
+    void * pCqRing;                                         /**< @brief Mapping of the completion queue ring. */
+    size_t cqRingLength;                                    /**< @brief Length of the completion queue ring mapping. */
+    struct io_uring_sqe * pSqes;                            /**< @brief Mapping of the submission queue entries. */
+    size_t sqesLength;                                      /**< @brief Length of the submission queue entries mapping. */
+    uint32_t * pSqHead;                                     /**< @brief Submission queue head, written by the kernel. */
+    uint32_t * pSqTail;                                     /**< @brief Submission queue tail, written by the application. */
+    uint32_t * pSqArray;                                    /**< @brief Indexes of the queued submission queue entries. */
+    uint32_t sqMask;                                        /**< @brief Mask of a submission queue index. */
+    uint32_t sqEntries;                                     /**< @brief Number of submission queue entries. */
+    uint32_t * pCqHead;                                     /**< @brief Completion queue head, written by the application. */
+    uint32_t * pCqTail;                                     /**< @brief Completion queue tail, written by the kernel. */
+    struct io_uring_cqe * pCqes;                            /**< @brief Completion queue entries. */
+    uint32_t cqMask;                                        /**< @brief Mask of a completion queue index. */
+    uint32_t pendingSubmissions;                            /**< @brief Entries queued but not yet submitted. */
+    IoUringRequest_t requests[ IO_URING_QUEUE_DEPTH ];      /**< @brief Operations in progress. */
+    uint16_t completedRequests[ IO_URING_QUEUE_DEPTH ];     /**< @brief Completed submitted operations, in order. */
+    size_t completedHead;                                   /**< @brief First entry of completedRequests. */
+    size_t completedCount;                                  /**< @brief Number of entries in completedRequests. */
+    uint8_t * pBuffers;                                     /**< @brief Registered buffers, or NULL. */
+    size_t bufferCount;                                     /**< @brief Number of registered buffers. */
+    bool bufferInUse[ IO_URING_MAX_BUFFERS ];               /**< @brief Whether a connection owns a buffer. */
+} IoUring_t;
+
+/**
+ * @brief Definition of the network context.
+ */
+struct NetworkContext
+{
+    int32_t socketDescriptor; /**< @brief Socket descriptor of the connection. */
+    IoUring_t * pRing;        /**< @brief Ring the operations of the connection are submitted to. */
+    uint32_t sendTimeoutMs;   /**< @brief Timeout of #IoUring_Send. 0 waits forever. */
+    uint32_t recvTimeoutMs;   /**< @brief Timeout of #IoUring_Recv. 0 waits forever. */
+    int32_t bufferIndex;      /**< @brief Registered buffer owned by the connection, or -1. */
+};
+
+/**
+ * @brief Create an io_uring instance and register buffers with it.
+ *
+ * Registered buffers are pinned by the kernel once, so receives into them
+ * skip mapping the pages on every operation. Every connection created with
+ * #IoUring_Connect takes one of the buffers while one is free.
+ *
+ * @param[out] pRing The ring to initialize.
+ * @param[in] pBuffers Memory for @p bufferCount buffers of
+ * #IO_URING_BUFFER_LENGTH bytes each, or NULL to register no buffers. It must
+ * stay valid until #IoUring_Deinit.
+ * @param[in] bufferCount Number of buffers in @p pBuffers, at most
+ * #IO_URING_MAX_BUFFERS.
+ *
+ * @note This requires Linux 5.11 or later.
+ *
+ * @return #IO_URING_SUCCESS if successful;
+ * #IO_URING_INVALID_PARAMETER, #IO_URING_API_ERROR on error.
+ */
+IoUringStatus_t IoUring_Init( IoUring_t * pRing,
+                              uint8_t * pBuffers,
+                              size_t bufferCount );
+
+/**
+ * @brief Release the resources of a ring.
+ *
+ * The connections that use the ring must be disconnected first.
+ *
+ * @param[in] pRing The ring.
+ *
+ * @return #IO_URING_SUCCESS if successful; #IO_URING_INVALID_PARAMETER on error.
+ */
+IoUringStatus_t IoUring_Deinit( IoUring_t * pRing );
+
+/**
+ * @brief Get the descriptor of a ring.
+ *
+ * The descriptor is readable while completions are waiting to be reaped, so
+ * it can be added to an event loop with a NULL network context, and
+ * #IoUring_WaitCompletions called with a timeout of 0 when it is readable.
+ *
+ * @param[in] pRing The ring.
+ *
+ * @return The descriptor of the ring; -1 if @p pRing is NULL.
+ */
+int32_t IoUring_GetDescriptor( const IoUring_t * pRing );
+
+/**
+ * @brief Establish a TCP connection whose data is transferred through a ring.
+ *
+ * The connection is set up with #Sockets_ConnectWithConfig. The send and
+ * receive timeouts of @p pSocketsConfig are used by #IoUring_Send and
+ * #IoUring_Recv, and #SocketsConfig_t.nonBlocking is ignored.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ * @param[in] pRing The ring to submit the operations of the connection to.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pSocketsConfig Connection configuration.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE, #SOCKETS_API_ERROR on error.
+ */
+SocketStatus_t IoUring_Connect( NetworkContext_t * pNetworkContext,
+                                IoUring_t * pRing,
+                                const ServerInfo_t * pServerInfo,
+                                const SocketsConfig_t * pSocketsConfig );
+
+/**
+ * @brief Close a TCP connection created with #IoUring_Connect.
+ *
+ * Operations of the connection that are still in progress must have
+ * completed first.
+ *
+ * @param[in] pNetworkContext The network context to close the connection.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER on error.
+ */
+SocketStatus_t IoUring_Disconnect( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Receives data over an established TCP connection.
+ *
+ * This can be used as #TransportInterface.recv function to receive data over
+ * the network. It submits the receive, together with any operations queued
+ * with #IoUring_SubmitRecv and #IoUring_SubmitSend, and waits for it. The
+ * completions of other operations found while waiting are kept for
+ * #IoUring_WaitCompletions.
+ *
+ * @param[in] pNetworkContext The network context created using IoUring_Connect API.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested from the network.
+ *
+ * @return Number of bytes received if successful, 0 if no data arrived within
+ * the receive timeout; negative value on error.
+ */
+int32_t IoUring_Recv( NetworkContext_t * pNetworkContext,
+                      void * pBuffer,
+                      size_t bytesToRecv );
+
+/**
+ * @brief Sends data over an established TCP connection.
+ *
+ * This can be used as the #TransportInterface.send function to send data
+ * over the network, in the same way as #IoUring_Recv.
+ *
+ * @param[in] pNetworkContext The network context created using IoUring_Connect API.
+ * @param[in] pBuffer Buffer containing the bytes to send over the network.
+ * @param[in] bytesToSend Number of bytes to send over the network.
+ *
+ * @return Number of bytes sent if successful, 0 if the socket could not take
+ * data within the send timeout; negative value on error.
+ */
+int32_t IoUring_Send( NetworkContext_t * pNetworkContext,
+                      const void * pBuffer,
+                      size_t bytesToSend );
+
+/**
+ * @brief Queue a receive on a connection without waiting for it.
+ *
+ * The receive is submitted with the next #IoUring_WaitCompletions,
+ * #IoUring_Recv or #IoUring_Send call on the ring, so that the operations of
+ * many connections are submitted with a single system call.
+ *
+ * @param[in] pNetworkContext The network context created using IoUring_Connect API.
+ * @param[out] pBuffer Buffer to receive into, or NULL to receive into the
+ * registered buffer of the connection. It must stay valid until the
+ * receive completes.
+ * @param[in] bytesToRecv Number of bytes to receive at most. It is limited to
+ * #IO_URING_BUFFER_LENGTH when the registered buffer is used.
+ *
+ * @return #IO_URING_SUCCESS if successful; #IO_URING_INVALID_PARAMETER,
+ * #IO_URING_NO_MEMORY, #IO_URING_API_ERROR on error.
+ */
+IoUringStatus_t IoUring_SubmitRecv( NetworkContext_t * pNetworkContext,
+                                    void * pBuffer,
+                                    size_t bytesToRecv );
+
+/**
+ * @brief Queue a send on a connection without waiting for it.
+ *
+ * @param[in] pNetworkContext The network context created using IoUring_Connect API.
+ * @param[in] pBuffer Buffer containing the bytes to send. It must stay valid
+ * until the send completes.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @note Like #IoUring_Send, fewer bytes than requested may be sent.
+ *
+ * @return #IO_URING_SUCCESS if successful; #IO_URING_INVALID_PARAMETER,
+ * #IO_URING_NO_MEMORY, #IO_URING_API_ERROR on error.
+ */
+IoUringStatus_t IoUring_SubmitSend( NetworkContext_t * pNetworkContext,
+                                    const void * pBuffer,
+                                    size_t bytesToSend );
+
+/**
+ * @brief Submit the queued operations of a ring and wait until at least one
+ * of them completes or the timeout expires.
+ *
+ * @param[in] pRing The ring.
+ * @param[out] pCompletions Array to return the completed operations in.
+ * @param[in] maxCompletions Number of elements in @p pCompletions.
+ * @param[in] timeoutMs Time to wait for a completion. 0 returns immediately
+ * and #IO_URING_WAIT_FOREVER blocks until an operation completes.
+ * @param[out] pCompletionCount Number of completions written to
+ * @p pCompletions. This is 0 when the timeout expired.
+ *
+ * @return #IO_URING_SUCCESS if successful;
+ * #IO_URING_INVALID_PARAMETER, #IO_URING_API_ERROR on error.
+ */
+IoUringStatus_t IoUring_WaitCompletions( IoUring_t * pRing,
+                                         IoUringCompletion_t * pCompletions,
+                                         size_t maxCompletions,
+                                         uint32_t timeoutMs,
+                                         size_t * pCompletionCount );
+
+#endif /* ifndef IO_URING_POSIX_H_ */
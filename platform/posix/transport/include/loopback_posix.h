@@ -0,0 +1,278 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LOOPBACK_POSIX_H_
+#define LOOPBACK_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the in-memory loopback transport. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_Loopback"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/**
+ * @brief The maximum number of writes that can wait in a ring for their
+ * simulated latency or bandwidth. Writes beyond this wait like writes to a
+ * full ring.
+ */
+#ifndef LOOPBACK_MAX_SEGMENTS
+    #define LOOPBACK_MAX_SEGMENTS    ( 64U )
+#endif
+
+/**
+ * @brief Loopback transport return status.
+ */
+typedef enum LoopbackStatus
+{
+    LOOPBACK_SUCCESS = 0,      /**< Function successfully completed. */
+    LOOPBACK_INVALID_PARAMETER /**< At least one parameter was invalid. */
+} LoopbackStatus_t;
+
+/**
+ * @brief Optional shaping of the data that flows through a ring.
+ */
+typedef struct LoopbackShaping
+{
+    uint32_t latencyUs;      /**< @brief Delay before written data can be read. */
+    uint32_t bytesPerSecond; /**< @brief Rate at which written data can be read. 0 for no limit. */
+} LoopbackShaping_t;
+
+/**
+ * @brief Data written by one write, for shaping.
+ */
+typedef struct LoopbackSegment
+{
+    size_t endPosition;   /**< @brief Ring position just after the last byte of the write. */
+    uint64_t readyTimeUs; /**< @brief Time from which the bytes can be read. */
+} LoopbackSegment_t;
+
+/**
+ * @brief A one-way byte stream between two endpoints.
+ *
+ * One endpoint writes into the ring and the other reads from it, without
+ * locks, so the endpoints can be used from different threads.
+ *
+ * @note The members of this structure are private to the transport and
+ * must not be accessed by the application.
+ */
+typedef struct LoopbackRing
+{
+    uint8_t * pBuffer;                                /**< @brief Storage of the ring. */
+    size_t bufferSize;                                /**< @brief Size of the storage, a power of 2. */
+    size_t writePosition;                             /**< @brief Bytes written so far, updated by the writer. */
+    size_t readPosition;                              /**< @brief Bytes read so far, updated by the reader. */
+    bool closed;                                      /**< @brief Set once the writer closed the stream. */
+    bool shaped;                                      /**< @brief Whether latency or bandwidth is simulated. */
+    LoopbackShaping_t shaping;                        /**< @brief The simulated latency and bandwidth. */
+    LoopbackSegment_t segments[ LOOPBACK_MAX_SEGMENTS ]; /**< @brief Writes that are not readable yet. */
+    size_t segmentWriteCount;                         /**< @brief Segments added so far, updated by the writer. */
+    size_t segmentReadCount;                          /**< @brief Segments made readable so far, updated by the reader. */
+    uint64_t transmitDoneUs;                          /**< @brief Time the last write is fully transmitted at the simulated bandwidth. */
+    size_t readablePosition;                          /**< @brief End of the data whose segments are readable. */
+} LoopbackRing_t;
+
+/**
+ * @brief Function called after every successful send of an endpoint to let a
+ * peer in the same thread respond.
+ *
+ * The peer reads what was sent with #Loopback_Recv on its own endpoint and
+ * responds with #Loopback_Send.
+ *
+ * @param[in] pPeerEndpoint The network context of the peer.
+ * @param[in] pPeerContext The context passed to #Loopback_SetPeer.
+ */
+typedef void ( * LoopbackPeerCallback_t )( NetworkContext_t * pPeerEndpoint,
+                                           void * pPeerContext );
+
+/**
+ * @brief Definition of the network context.
+ */
+struct NetworkContext
+{
+    LoopbackRing_t * pRecvRing;           /**< @brief Ring the endpoint reads from. */
+    LoopbackRing_t * pSendRing;           /**< @brief Ring the endpoint writes to. */
+    uint32_t recvTimeoutMs;               /**< @brief Time #Loopback_Recv waits for data. */
+    uint32_t sendTimeoutMs;               /**< @brief Time #Loopback_Send waits for room. */
+    LoopbackPeerCallback_t peerCallback;  /**< @brief Peer run after every send, or NULL. */
+    NetworkContext_t * pPeerEndpoint;     /**< @brief Endpoint passed to the peer callback. */
+    void * pPeerContext;                  /**< @brief Context passed to the peer callback. */
+};
+
+/**
+ * @brief One step of a #LoopbackScript_t.
+ */
+typedef struct LoopbackScriptStep
+{
+    size_t expectedLength;     /**< @brief Bytes to receive from the endpoint before responding. */
+    const uint8_t * pResponse; /**< @brief Bytes to send back, or NULL to send nothing. */
+    size_t responseLength;     /**< @brief Length of @p pResponse. */
+} LoopbackScriptStep_t;
+
+/**
+ * @brief A peer that sends fixed responses after receiving a number of bytes,
+ * such as a CONNACK after a CONNECT, for use with #Loopback_RunScript.
+ */
+typedef struct LoopbackScript
+{
+    const LoopbackScriptStep_t * pSteps; /**< @brief The steps of the peer. */
+    size_t stepCount;                    /**< @brief Number of steps in @p pSteps. */
+    bool repeatLastStep;                 /**< @brief Whether the last step runs again after it completed,
+                                          * so that, for example, every PINGREQ gets a PINGRESP. */
+    size_t currentStep;                  /**< @brief Step the peer is in. Set to 0 before use. */
+    size_t receivedLength;               /**< @brief Bytes received in the current step. Set to 0 before use. */
+} LoopbackScript_t;
+
+/**
+ * @brief Initialize a ring.
+ *
+ * @param[out] pRing The ring to initialize.
+ * @param[in] pBuffer Storage of the ring.
+ * @param[in] bufferSize Size of @p pBuffer. It must be a power of 2.
+ * @param[in] pShaping The simulated latency and bandwidth of the ring, or
+ * NULL to make written data readable immediately.
+ *
+ * @return #LOOPBACK_SUCCESS if successful; #LOOPBACK_INVALID_PARAMETER on error.
+ */
+LoopbackStatus_t Loopback_Init( LoopbackRing_t * pRing,
+                                uint8_t * pBuffer,
+                                size_t bufferSize,
+                                const LoopbackShaping_t * pShaping );
+
+/**
+ * @brief Set up one endpoint of a loopback connection.
+ *
+ * A connection uses two rings. The other endpoint is set up with the same
+ * rings in the opposite order.
+ *
+ * @param[out] pNetworkContext The endpoint to set up.
+ * @param[in] pRecvRing The ring the endpoint reads from.
+ * @param[in] pSendRing The ring the endpoint writes to.
+ * @param[in] recvTimeoutMs Time #Loopback_Recv waits for data. 0 returns
+ * immediately.
+ * @param[in] sendTimeoutMs Time #Loopback_Send waits for room in the ring. 0
+ * returns immediately.
+ *
+ * @return #LOOPBACK_SUCCESS if successful; #LOOPBACK_INVALID_PARAMETER on error.
+ */
+LoopbackStatus_t Loopback_Connect( NetworkContext_t * pNetworkContext,
+                                   LoopbackRing_t * pRecvRing,
+                                   LoopbackRing_t * pSendRing,
+                                   uint32_t recvTimeoutMs,
+                                   uint32_t sendTimeoutMs );
+
+/**
+ * @brief Run a peer in the thread of an endpoint after each of its sends.
+ *
+ * @param[in] pNetworkContext The endpoint whose sends the peer handles.
+ * @param[in] pPeerEndpoint The other endpoint of the connection.
+ * @param[in] peerCallback The peer, or NULL to remove it.
+ * @param[in] pPeerContext Context passed to @p peerCallback.
+ *
+ * @return #LOOPBACK_SUCCESS if successful; #LOOPBACK_INVALID_PARAMETER on error.
+ */
+LoopbackStatus_t Loopback_SetPeer( NetworkContext_t * pNetworkContext,
+                                   NetworkContext_t * pPeerEndpoint,
+                                   LoopbackPeerCallback_t peerCallback,
+                                   void * pPeerContext );
+
+/**
+ * @brief Close the endpoint. Once the other endpoint has read the data that
+ * is left, its receives fail.
+ *
+ * @param[in] pNetworkContext The endpoint to close.
+ *
+ * @return #LOOPBACK_SUCCESS if successful; #LOOPBACK_INVALID_PARAMETER on error.
+ */
+LoopbackStatus_t Loopback_Disconnect( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Receives data from the other endpoint.
+ *
+ * This can be used as #TransportInterface.recv function.
+ *
+ * @param[in] pNetworkContext The endpoint set up with #Loopback_Connect.
+ * @param[out] pBuffer Buffer to receive the data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes received if successful, 0 if no data was readable
+ * within the receive timeout; negative value once the other endpoint closed
+ * and all its data was read.
+ */
+int32_t Loopback_Recv( NetworkContext_t * pNetworkContext,
+                       void * pBuffer,
+                       size_t bytesToRecv );
+
+/**
+ * @brief Sends data to the other endpoint.
+ *
+ * This can be used as #TransportInterface.send function. After the data is
+ * written, the peer set with #Loopback_SetPeer runs.
+ *
+ * @param[in] pNetworkContext The endpoint set up with #Loopback_Connect.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return Number of bytes sent if successful, which is less than
+ * @p bytesToSend when the ring is full; 0 if the ring stayed full for the
+ * send timeout; negative value if the other endpoint closed.
+ */
+int32_t Loopback_Send( NetworkContext_t * pNetworkContext,
+                       const void * pBuffer,
+                       size_t bytesToSend );
+
+/**
+ * @brief A #LoopbackPeerCallback_t that runs a #LoopbackScript_t.
+ *
+ * @param[in] pPeerEndpoint The endpoint of the peer.
+ * @param[in] pPeerContext The #LoopbackScript_t to run.
+ */
+void Loopback_RunScript( NetworkContext_t * pPeerEndpoint,
+                         void * pPeerContext );
+
+#endif /* ifndef LOOPBACK_POSIX_H_ */
@@ -0,0 +1,231 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef OPENSSL_POOL_POSIX_H_
+#define OPENSSL_POOL_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the OpenSSL connection pool. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_OpenSSL_Pool"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* POSIX include. */
+#include <pthread.h>
+
+/* OpenSSL transport include. */
+#include "openssl_posix.h"
+
+/**
+ * @brief The maximum number of servers a pool keeps connections to at the
+ * same time.
+ */
+#ifndef OPENSSL_POOL_MAX_HOSTS
+    #define OPENSSL_POOL_MAX_HOSTS               ( 4U )
+#endif
+
+/**
+ * @brief The maximum number of connections of a pool, idle or checked out,
+ * to all servers.
+ */
+#ifndef OPENSSL_POOL_MAX_CONNECTIONS
+    #define OPENSSL_POOL_MAX_CONNECTIONS         ( 8U )
+#endif
+
+/**
+ * @brief The maximum length of the host name of a server, not counting the
+ * NULL terminator.
+ */
+#ifndef OPENSSL_POOL_MAX_HOST_NAME_LENGTH
+    #define OPENSSL_POOL_MAX_HOST_NAME_LENGTH    ( 253U )
+#endif
+
+/**
+ * @brief OpenSSL connection pool return status.
+ */
+typedef enum OpensslPoolStatus
+{
+    OPENSSL_POOL_SUCCESS = 0,      /**< Function successfully completed. */
+    OPENSSL_POOL_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    OPENSSL_POOL_NO_SPACE,         /**< All connections or all servers of the pool are in use. */
+    OPENSSL_POOL_CONNECT_FAILURE,  /**< A new connection could not be established. */
+    OPENSSL_POOL_API_ERROR         /**< A call to a system API resulted in an internal error. */
+} OpensslPoolStatus_t;
+
+/**
+ * @brief A connection of a pool.
+ *
+ * @note The members of this structure are private to the pool and must not
+ * be accessed by the application.
+ */
+typedef struct OpensslPoolConnection
+{
+    NetworkContext_t networkContext;           /**< @brief The TLS connection. */
+    int32_t hostIndex;                         /**< @brief Server of the connection; -1 if the slot is free. */
+    bool checkedOut;                           /**< @brief Whether the application is using the connection. */
+    uint64_t idleSinceMs;                      /**< @brief Time the connection was checked in. */
+    struct OpensslPoolConnection * pNextIdle;  /**< @brief Next idle connection of the same server. */
+} OpensslPoolConnection_t;
+
+/**
+ * @brief A server of a pool and its idle connections.
+ *
+ * @note The members of this structure are private to the pool and must not
+ * be accessed by the application.
+ */
+typedef struct OpensslPoolHost
+{
+    char hostName[ OPENSSL_POOL_MAX_HOST_NAME_LENGTH + 1U ]; /**< @brief Host name of the server. */
+    size_t hostNameLength;                                   /**< @brief Length of the host name. */
+    uint16_t port;                                           /**< @brief Port of the server. */
+    OpensslPoolConnection_t * pIdleHead;                     /**< @brief Idle connections, most recently used first. */
+    size_t connectionCount;                                  /**< @brief Connections to the server, idle or checked out. */
+} OpensslPoolHost_t;
+
+/**
+ * @brief A pool of TLS connections that are kept open between requests, so
+ * that requests to the same server, such as HTTP requests with the
+ * keep-alive flag, do not need a TCP and TLS handshake each.
+ *
+ * The functions of a pool can be called from several threads.
+ *
+ * @note The members of this structure are private to the pool and must not
+ * be accessed by the application.
+ */
+typedef struct OpensslPool
+{
+    OpensslPoolHost_t hosts[ OPENSSL_POOL_MAX_HOSTS ];                   /**< @brief The servers. */
+    OpensslPoolConnection_t connections[ OPENSSL_POOL_MAX_CONNECTIONS ]; /**< @brief The connections. */
+    uint32_t sendTimeoutMs;                                              /**< @brief Send timeout of new connections. */
+    uint32_t recvTimeoutMs;                                              /**< @brief Receive timeout of new connections. */
+    uint32_t idleTimeoutMs;                                              /**< @brief Time after which idle connections are closed. */
+    pthread_mutex_t mutex;                                               /**< @brief Serializes access to the lists. */
+} OpensslPool_t;
+
+/**
+ * @brief Initialize a pool.
+ *
+ * @param[out] pPool The pool to initialize.
+ * @param[in] sendTimeoutMs Send timeout of the connections, as for #Openssl_Connect.
+ * @param[in] recvTimeoutMs Receive timeout of the connections, as for #Openssl_Connect.
+ * @param[in] idleTimeoutMs Time after which an idle connection is closed. It
+ * should be shorter than the idle timeout of the servers. 0 keeps idle
+ * connections open until they fail the health check.
+ *
+ * @return #OPENSSL_POOL_SUCCESS on success;
+ * #OPENSSL_POOL_INVALID_PARAMETER or #OPENSSL_POOL_API_ERROR on failure.
+ */
+OpensslPoolStatus_t OpensslPool_Init( OpensslPool_t * pPool,
+                                      uint32_t sendTimeoutMs,
+                                      uint32_t recvTimeoutMs,
+                                      uint32_t idleTimeoutMs );
+
+/**
+ * @brief Get a connection to a server, reusing an idle one when possible.
+ *
+ * Idle connections are checked before reuse, and closed if the server closed
+ * them or sent unexpected data. A new connection is made with #Openssl_Connect
+ * when no idle connection is healthy.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pServerInfo The server to connect to.
+ * @param[in] pOpensslCredentials Credentials for a new connection. Use the
+ * same credentials for every checkout of a server. Setting
+ * #OpensslCredentials_t.pTlsContext and #OpensslCredentials_t.pSessionStore
+ * also makes new connections cheaper.
+ * @param[out] ppNetworkContext The connection, which can be used with the
+ * OpenSSL transport functions until it is checked in.
+ *
+ * @return #OPENSSL_POOL_SUCCESS on success; #OPENSSL_POOL_INVALID_PARAMETER,
+ * #OPENSSL_POOL_NO_SPACE or #OPENSSL_POOL_CONNECT_FAILURE on failure.
+ */
+OpensslPoolStatus_t OpensslPool_Checkout( OpensslPool_t * pPool,
+                                          const ServerInfo_t * pServerInfo,
+                                          const OpensslCredentials_t * pOpensslCredentials,
+                                          NetworkContext_t ** ppNetworkContext );
+
+/**
+ * @brief Return a connection to the pool.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pNetworkContext The connection received from #OpensslPool_Checkout.
+ * @param[in] keepAlive true to keep the connection for the next checkout;
+ * false to close it, such as after a transport error or when the server
+ * responded with "Connection: close".
+ *
+ * @return #OPENSSL_POOL_SUCCESS on success; #OPENSSL_POOL_INVALID_PARAMETER
+ * on failure.
+ */
+OpensslPoolStatus_t OpensslPool_Checkin( OpensslPool_t * pPool,
+                                         NetworkContext_t * pNetworkContext,
+                                         bool keepAlive );
+
+/**
+ * @brief Close the connections that have been idle for longer than the idle
+ * timeout.
+ *
+ * This is also done by every #OpensslPool_Checkout, so it only needs to be
+ * called to release connections while the pool is not used.
+ *
+ * @param[in] pPool The pool.
+ *
+ * @return #OPENSSL_POOL_SUCCESS on success; #OPENSSL_POOL_INVALID_PARAMETER
+ * on failure.
+ */
+OpensslPoolStatus_t OpensslPool_EvictIdle( OpensslPool_t * pPool );
+
+/**
+ * @brief Close the idle connections and release the resources of the pool.
+ *
+ * @note Every checked out connection must be checked in before.
+ *
+ * @param[in] pPool The pool.
+ *
+ * @return #OPENSSL_POOL_SUCCESS on success; #OPENSSL_POOL_INVALID_PARAMETER
+ * on failure.
+ */
+OpensslPoolStatus_t OpensslPool_Cleanup( OpensslPool_t * pPool );
+
+#endif /* ifndef OPENSSL_POOL_POSIX_H_ */
@@ -49,26 +49,63 @@
 
 /************ End of logging configuration ****************/
 
+/* Standard include. */
+#include <stdbool.h>
+
+/* POSIX include. */
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
 /* OpenSSL include. */
 #include <openssl/ssl.h>
 
 /* Transport includes. */
 #include "transport_interface.h"
+#include "transport_stats_posix.h"
 
 /* Socket include. */
 #include "sockets_posix.h"
 
+/**
+ * @brief A buffer that #Openssl_Recv fills with one large SSL_read and serves
+ * smaller reads from.
+ *
+ * Readers such as coreMQTT receive a packet in several small reads, for its
+ * fixed header, remaining length and payload, which would each be an SSL_read
+ * without this buffer. Reads at least as large as the buffer bypass it.
+ *
+ * The buffer is owned by the application and must remain valid for as long as
+ * the connection is open. #Openssl_Connect discards its contents.
+ */
+typedef struct OpensslReadAhead
+{
+    uint8_t * pBuffer;  /**< @brief Buffer to read ahead into. */
+    size_t bufferSize;  /**< @brief Size of #OpensslReadAhead_t.pBuffer. */
+    size_t offset;      /**< @brief Offset of the data not yet received by the application. */
+    size_t length;      /**< @brief Length of the data not yet received by the application. */
+} OpensslReadAhead_t;
+
 /**
  * @brief Definition of the network context for the transport interface
  * implementation that uses OpenSSL and POSIX sockets.
  *
  * @note For this transport implementation, the socket descriptor and
- * SSL context is used.
+ * SSL context is used. The network context must be zero-initialized so that
+ * the optional fields are unset.
  */
 struct NetworkContext
 {
     int32_t socketDescriptor;
     SSL * pSsl;
+    OpensslReadAhead_t * pReadAhead; /**< @brief Optional read-ahead buffer; NULL to read directly. */
+    bool earlyDataEnabled;           /**< @brief Set by #Openssl_Connect when the first send completes the handshake. */
+    ConnectTiming_t * pConnectTiming; /**< @brief Optional times of the phases of #Openssl_Connect; NULL to not record them.
+                                       * It must stay valid until #Openssl_Connect returns. */
+    #if ( TRANSPORT_STATS_ENABLED != 0 )
+        TransportStats_t * pStats;   /**< @brief Optional counters of the connection; NULL to not count.
+                                      * It must be set before #Openssl_Connect to count system calls. */
+    #endif
 };
 
 /**
@@ -86,6 +123,96 @@ typedef enum OpensslStatus
     OPENSSL_CONNECT_FAILURE      /**< Initial connection to the server failed. */
 } OpensslStatus_t;
 
+/**
+ * @brief A TLS context that is built once from #OpensslCredentials_t and
+ * shared by every connection and reconnection that uses it.
+ *
+ * The certificates and key are read and parsed only when the context is
+ * initialized or rotated, instead of on every call to #Openssl_Connect.
+ *
+ * The underlying SSL_CTX is reference counted by OpenSSL: every connection
+ * holds a reference for as long as it is open, so rotating or cleaning up the
+ * context does not affect connections that are already established.
+ *
+ * @note The members of this structure are private to the OpenSSL transport
+ * and must not be accessed by the application.
+ */
+typedef struct OpensslTlsContext
+{
+    SSL_CTX * pSslContext;  /**< @brief The shared SSL context. */
+    pthread_mutex_t mutex;  /**< @brief Serializes access to pSslContext during rotation. */
+} OpensslTlsContext_t;
+
+/**
+ * @brief The maximum length of a serialized TLS session handled by an
+ * #OpensslSessionStore_t. Sessions that serialize to more bytes are not saved.
+ */
+#ifndef OPENSSL_MAX_SESSION_LENGTH
+    #define OPENSSL_MAX_SESSION_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Size of the stack buffer #Openssl_Writev uses to combine small
+ * buffers into one TLS record.
+ */
+#ifndef OPENSSL_WRITEV_BUFFER_LENGTH
+    #define OPENSSL_WRITEV_BUFFER_LENGTH    ( 1024U )
+#endif
+
+/**
+ * @brief Size of the stack buffer #Openssl_SendFile reads a file into when
+ * the connection does not use kernel TLS.
+ */
+#ifndef OPENSSL_SENDFILE_BUFFER_LENGTH
+    #define OPENSSL_SENDFILE_BUFFER_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Storage for the TLS session of a server, used to resume the session
+ * with an abbreviated handshake on the next connection.
+ *
+ * Sessions are passed as the DER encoding produced by OpenSSL, so the store
+ * can keep them in memory or persist them across process restarts.
+ *
+ * @note A session store holds the session of a single server. Use a separate
+ * store for every #ServerInfo_t the application connects to.
+ *
+ * @warning A serialized session contains the secret needed to resume it and
+ * must be protected the same way as a private key.
+ */
+typedef struct OpensslSessionStore
+{
+    /**
+     * @brief Copy the saved session into @p pBuffer.
+     *
+     * @param[in] pStoreContext #OpensslSessionStore_t.pStoreContext.
+     * @param[out] pBuffer Buffer to copy the serialized session into.
+     * @param[in] bufferSize Size of @p pBuffer.
+     *
+     * @return Length of the serialized session; 0 if no session is saved.
+     */
+    size_t ( * load )( void * pStoreContext,
+                       uint8_t * pBuffer,
+                       size_t bufferSize );
+
+    /**
+     * @brief Save a new session received from the server, replacing any
+     * session saved before.
+     *
+     * This is called from the transport when the server sends a session
+     * ticket, which can be during #Openssl_Connect or a later #Openssl_Recv.
+     *
+     * @param[in] pStoreContext #OpensslSessionStore_t.pStoreContext.
+     * @param[in] pSession The serialized session.
+     * @param[in] sessionLength Length of @p pSession.
+     */
+    void ( * save )( void * pStoreContext,
+                     const uint8_t * pSession,
+                     size_t sessionLength );
+
+    void * pStoreContext; /**< @brief Application context passed to load and save. */
+} OpensslSessionStore_t;
+
 /**
  * @brief Contains the credentials to establish a TLS connection.
  */
@@ -132,6 +259,124 @@ typedef struct OpensslCredentials
     const char * pRootCaPath;     /**< @brief Filepath string to the trusted server root CA. */
     const char * pClientCertPath; /**< @brief Filepath string to the client certificate. */
     const char * pPrivateKeyPath; /**< @brief Filepath string to the client certificate's private key. */
+
+    /**
+     * @brief Certificates and private key in memory, used instead of the
+     * file of the same credential, so that credentials loaded once from
+     * secure storage do not have to be written to or read from a file.
+     *
+     * Each credential is DER encoded when it starts with the ASN.1 SEQUENCE
+     * tag (0x30), and PEM encoded otherwise. A PEM root CA may hold several
+     * trusted certificates, and a PEM client certificate may be followed by
+     * its chain.
+     *
+     * @note The buffers are only read while the SSL context is created, by
+     * #Openssl_Connect or #Openssl_TlsContextInit, and need not stay valid
+     * afterwards.
+     */
+    const uint8_t * pRootCa;     /**< @brief The trusted server root CA. */
+    size_t rootCaLength;         /**< @brief Length of #OpensslCredentials_t.pRootCa. */
+    const uint8_t * pClientCert; /**< @brief The client certificate. */
+    size_t clientCertLength;     /**< @brief Length of #OpensslCredentials_t.pClientCert. */
+    const uint8_t * pPrivateKey; /**< @brief The client certificate's private key. */
+    size_t privateKeyLength;     /**< @brief Length of #OpensslCredentials_t.pPrivateKey. */
+
+    /**
+     * @brief URI of the client certificate's private key in a hardware token
+     * such as a TPM or secure element, used instead of the private key file
+     * or buffer. The handshake signature is then computed by the token, and
+     * the key never leaves it.
+     *
+     * For example, "pkcs11:token=gw;object=client;pin-value=1234" for the
+     * "pkcs11" provider, or "handle:0x81000001" for the "tpm2" provider.
+     *
+     * @note This string must be NULL-terminated because the OpenSSL API requires it to be.
+     */
+    const char * pPrivateKeyUri;
+
+    /**
+     * @brief Name of the OpenSSL provider that loads
+     * #OpensslCredentials_t.pPrivateKeyUri, which is loaded if needed and
+     * stays loaded. Set to NULL to use the providers that are already
+     * loaded, such as by the OpenSSL configuration file.
+     *
+     * @note Before OpenSSL 3.0, this names the engine to load the key with,
+     * and the URI is the key identifier of the engine.
+     */
+    const char * pKeyProvider;
+
+    /**
+     * @brief A TLS context created with #Openssl_TlsContextInit. Set to NULL
+     * to create a new SSL context from the credentials on every connect.
+     *
+     * When set, the credentials above are ignored by #Openssl_Connect. ALPN,
+     * SNI, MFLN and the cipher, group and version preferences below are still
+     * applied to every connection.
+     */
+    OpensslTlsContext_t * pTlsContext;
+
+    /**
+     * @brief Storage used to resume the TLS session of the server. Set to
+     * NULL to perform a full handshake on every connect.
+     *
+     * @note When #OpensslCredentials_t.pTlsContext is used, this must also
+     * be set in the credentials passed to #Openssl_TlsContextInit, so that
+     * the shared context reports new sessions.
+     */
+    const OpensslSessionStore_t * pSessionStore;
+
+    /**
+     * @brief Set to true to let the kernel encrypt TLS records (kTLS), so
+     * that #Openssl_SendFile sends files without copying them through the
+     * application.
+     *
+     * kTLS is used only when OpenSSL is 3.0 or later, was built with kTLS
+     * support, the kernel has the tls module loaded and the negotiated
+     * cipher can be offloaded. Otherwise the connection falls back to
+     * OpenSSL encrypting the records in user space.
+     */
+    bool enableKtls;
+
+    /**
+     * @brief Cipher and key exchange preferences, in the formats of the
+     * OpenSSL functions named below. Set a field to NULL to keep the OpenSSL
+     * default.
+     *
+     * For example, devices without AES instructions can prefer
+     * ChaCha20-Poly1305 with "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_128_GCM_SHA256"
+     * as cipher suites and "X25519:P-256" as groups.
+     *
+     * @note These strings must be NULL-terminated because the OpenSSL API requires them to be.
+     */
+    const char * pCipherList;   /**< @brief TLS 1.2 and earlier ciphers, for SSL_set_cipher_list. */
+    const char * pCipherSuites; /**< @brief TLS 1.3 cipher suites, for SSL_set_ciphersuites. */
+    const char * pGroups;       /**< @brief Key exchange groups, for SSL_set1_groups_list. */
+
+    /**
+     * @brief Lowest and highest TLS versions to negotiate, such as
+     * TLS1_2_VERSION or TLS1_3_VERSION. Set both to TLS1_3_VERSION to only
+     * allow TLS 1.3 and its one round trip handshake. Set to 0 to keep the
+     * OpenSSL default.
+     */
+    uint16_t minTlsVersion;
+    uint16_t maxTlsVersion; /**< @brief See #OpensslCredentials_t.minTlsVersion. */
+
+    /**
+     * @brief Set to true to send the first bytes of a resumed connection,
+     * such as the MQTT CONNECT packet, as TLS 1.3 early data, which saves a
+     * round trip on every reconnect.
+     *
+     * Early data is only sent when the session loaded from
+     * #OpensslCredentials_t.pSessionStore allows it. #Openssl_Connect then
+     * returns before the handshake, which is completed by the first
+     * #Openssl_Send, so a failed handshake is reported by that send. Bytes the
+     * server rejects are sent again after the handshake.
+     *
+     * @warning Early data can be replayed by an attacker, so it must only
+     * carry requests that are safe to receive twice, such as a CONNECT or a
+     * QoS 0 publish.
+     */
+    bool enableEarlyData;
 } OpensslCredentials_t;
 
 /**
@@ -155,6 +400,51 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
                                  uint32_t sendTimeoutMs,
                                  uint32_t recvTimeoutMs );
 
+/**
+ * @brief Create a TLS context that can be shared by many connections.
+ *
+ * The root CA, client certificate and private key are loaded from the file
+ * paths in @p pOpensslCredentials once. Set #OpensslCredentials_t.pTlsContext
+ * to the initialized context to use it in #Openssl_Connect.
+ *
+ * @param[out] pTlsContext The TLS context to initialize.
+ * @param[in] pOpensslCredentials Credentials to load into the context.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER,
+ * #OPENSSL_INVALID_CREDENTIALS, #OPENSSL_API_ERROR on failure.
+ */
+OpensslStatus_t Openssl_TlsContextInit( OpensslTlsContext_t * pTlsContext,
+                                        const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Replace the credentials of a shared TLS context, for example after a
+ * certificate rotation.
+ *
+ * New connections use the new credentials. Connections that are already
+ * established keep the credentials they were created with. If loading the
+ * new credentials fails, the context is left unchanged.
+ *
+ * @param[in] pTlsContext The TLS context created with #Openssl_TlsContextInit.
+ * @param[in] pOpensslCredentials Credentials to load into the context.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER,
+ * #OPENSSL_INVALID_CREDENTIALS, #OPENSSL_API_ERROR on failure.
+ */
+OpensslStatus_t Openssl_TlsContextRotate( OpensslTlsContext_t * pTlsContext,
+                                          const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Release the reference of a shared TLS context.
+ *
+ * The SSL context is freed once every connection created from it has been
+ * disconnected.
+ *
+ * @param[in] pTlsContext The TLS context created with #Openssl_TlsContextInit.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER on failure.
+ */
+OpensslStatus_t Openssl_TlsContextCleanup( OpensslTlsContext_t * pTlsContext );
+
 /**
  * @brief Closes a TLS session on top of a TCP connection using the OpenSSL API.
  *
@@ -197,4 +487,49 @@ int32_t Openssl_Send( const NetworkContext_t * pNetworkContext,
                       const void * pBuffer,
                       size_t bytesToSend );
 
+/**
+ * @brief Sends data from several buffers over an established TLS session.
+ *
+ * The buffers are sent in order, as if they were one contiguous buffer. Small
+ * buffers are copied together into a buffer of #OPENSSL_WRITEV_BUFFER_LENGTH
+ * bytes so that, for example, a packet header and the start of its payload
+ * go out in one TLS record instead of one record each. Once that buffer is
+ * empty, the rest of a buffer that is at least as large is passed to
+ * #SSL_write without copying.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ * @param[in] pIoVectors Array of the buffers to send.
+ * @param[in] ioVectorCount Number of buffers in @p pIoVectors.
+ *
+ * @return Number of bytes sent if successful; negative value on error. If an
+ * error occurs after some records were sent, the number of bytes in those
+ * records is returned.
+ */
+int32_t Openssl_Writev( const NetworkContext_t * pNetworkContext,
+                        const struct iovec * pIoVectors,
+                        size_t ioVectorCount );
+
+/**
+ * @brief Sends the contents of a file over an established TLS session.
+ *
+ * When the kernel encrypts the records of the connection (see
+ * #OpensslCredentials_t.enableKtls), the file is sent with #SSL_sendfile
+ * without being copied to user space. Otherwise it is read in chunks of
+ * #OPENSSL_SENDFILE_BUFFER_LENGTH bytes and sent with #Openssl_Send.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ * @param[in] fileDescriptor Descriptor of the file to send. Its file offset
+ * is not changed.
+ * @param[in] offset Offset in the file of the first byte to send.
+ * @param[in] bytesToSend Number of bytes to send from the file.
+ *
+ * @return Number of bytes sent if successful; negative value on error. Fewer
+ * bytes than requested are sent when the file ends first, or when an error
+ * occurs after some bytes were sent.
+ */
+int32_t Openssl_SendFile( const NetworkContext_t * pNetworkContext,
+                          int32_t fileDescriptor,
+                          off_t offset,
+                          size_t bytesToSend );
+
 #endif /* ifndef OPENSSL_POSIX_H_ */
@@ -49,16 +49,27 @@
 
 /************ End of logging configuration ****************/
 
+/* POSIX includes. */
+#include <sys/types.h>
+#include <sys/uio.h>
+
 /* Transport includes. */
 #include "transport_interface.h"
 #include "sockets_posix.h"
+#include "transport_stats_posix.h"
 
 /**
  * @brief Definition of the network context.
  */
 struct NetworkContext
 {
-    int32_t socketDescriptor;
+    int32_t socketDescriptor; /**< @brief Socket descriptor of the connection. */
+    uint32_t sendTimeoutMs;   /**< @brief Send timeout used in non-blocking mode. */
+    uint32_t recvTimeoutMs;   /**< @brief Receive timeout used in non-blocking mode. */
+    bool nonBlocking;         /**< @brief Whether the socket is in non-blocking mode. */
+    #if ( TRANSPORT_STATS_ENABLED != 0 )
+        TransportStats_t * pStats; /**< @brief Optional counters of the connection; NULL to not count. */
+    #endif
 };
 
 /**
@@ -79,6 +90,51 @@ SocketStatus_t Plaintext_Connect( NetworkContext_t * pNetworkContext,
                                   uint32_t sendTimeoutMs,
                                   uint32_t recvTimeoutMs );
 
+/**
+ * @brief Establish TCP connection to server with additional configuration.
+ *
+ * When #SocketsConfig_t.nonBlocking is set, the socket is put in non-blocking
+ * mode and the send and receive timeouts are kept in the network context.
+ * #Plaintext_Recv and #Plaintext_Send then call recv and send directly and
+ * only wait for the socket, for at most the timeout, when it would block.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pSocketsConfig Connection configuration.
+ *
+ * @note In non-blocking mode, a timeout of 0 makes #Plaintext_Recv and
+ * #Plaintext_Send return immediately when the socket would block.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE, #SOCKETS_API_ERROR on error.
+ */
+SocketStatus_t Plaintext_ConnectWithConfig( NetworkContext_t * pNetworkContext,
+                                            const ServerInfo_t * pServerInfo,
+                                            const SocketsConfig_t * pSocketsConfig );
+
+/**
+ * @brief Establish a connection to a server listening on a Unix domain
+ * socket, such as a broker or gateway on the same host.
+ *
+ * A local connection skips DNS and the TCP/IP stack, which lowers latency
+ * and CPU use. The other functions of this transport, from #Plaintext_Recv
+ * to #Plaintext_SendFile, work on it unchanged.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ * @param[in] pSocketPath Path of the socket. On Linux, a path that starts
+ * with a NUL byte is an abstract address, which has no file.
+ * @param[in] socketPathLength Length of the path, without a terminating NUL.
+ * @param[in] pSocketsConfig Connection configuration. Only the timeouts and
+ * #SocketsConfig_t.nonBlocking apply, as for #Plaintext_ConnectWithConfig.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_CONNECT_FAILURE, #SOCKETS_API_ERROR on error.
+ */
+SocketStatus_t Plaintext_ConnectUnix( NetworkContext_t * pNetworkContext,
+                                      const char * pSocketPath,
+                                      size_t socketPathLength,
+                                      const SocketsConfig_t * pSocketsConfig );
+
 /**
  * @brief Close TCP connection to server.
  *
@@ -104,6 +160,28 @@ int32_t Plaintext_Recv( const NetworkContext_t * pNetworkContext,
                         void * pBuffer,
                         size_t bytesToRecv );
 
+/**
+ * @brief Receives exactly the requested number of bytes over an established
+ * TCP connection, unless the receive timeout expires first.
+ *
+ * Unlike #Plaintext_Recv, which returns after a single read, this keeps
+ * reading until @p bytesToRecv bytes have arrived. The receive timeout, set on
+ * the socket or passed to #Plaintext_ConnectWithConfig in non-blocking mode,
+ * is a single deadline for the whole call rather than for each read. This
+ * suits reading the remaining bytes of a packet whose length is already known.
+ *
+ * @param[in] pNetworkContext The network context created using Plaintext_Connect API.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested from the network.
+ *
+ * @return @p bytesToRecv if all bytes were received; fewer bytes, possibly 0,
+ * if the timeout expired first; negative value on error or if the peer closed
+ * the connection before all bytes arrived.
+ */
+int32_t Plaintext_RecvAll( const NetworkContext_t * pNetworkContext,
+                           void * pBuffer,
+                           size_t bytesToRecv );
+
 /**
  * @brief Sends data over an established TCP connection.
  *
@@ -120,4 +198,60 @@ int32_t Plaintext_Send( const NetworkContext_t * pNetworkContext,
                         const void * pBuffer,
                         size_t bytesToSend );
 
+/**
+ * @brief Sends data from several buffers over an established TCP connection
+ * with a single system call.
+ *
+ * This sends, for example, a packet header and its payload from separate
+ * buffers without copying them into one buffer first. The buffers are sent in
+ * order, as if they were one contiguous buffer.
+ *
+ * @param[in] pNetworkContext The network context created using Plaintext_Connect API.
+ * @param[in] pIoVectors Array of the buffers to send.
+ * @param[in] ioVectorCount Number of buffers in @p pIoVectors.
+ *
+ * @note Like #Plaintext_Send, fewer bytes than the total length of the buffers
+ * may be sent. The caller sends the rest by calling again with the buffers
+ * adjusted past the bytes that were sent. At most IOV_MAX buffers are sent in
+ * one call, or 16 where limits.h does not define IOV_MAX.
+ *
+ * @return Number of bytes sent if successful; negative value on error.
+ */
+int32_t Plaintext_Writev( const NetworkContext_t * pNetworkContext,
+                          const struct iovec * pIoVectors,
+                          size_t ioVectorCount );
+
+/**
+ * @brief Size of the stack buffer #Plaintext_SendFile reads a file into where
+ * the system has no Linux #sendfile.
+ */
+#ifndef PLAINTEXT_SENDFILE_BUFFER_LENGTH
+    #define PLAINTEXT_SENDFILE_BUFFER_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Sends the contents of a file over an established TCP connection.
+ *
+ * On Linux, the kernel copies the file to the socket with #sendfile, without
+ * the file passing through user space. Elsewhere, up to
+ * #PLAINTEXT_SENDFILE_BUFFER_LENGTH bytes are read into a buffer and sent.
+ *
+ * @param[in] pNetworkContext The network context created using Plaintext_Connect API.
+ * @param[in] fileDescriptor Descriptor of the file to send. Its file offset
+ * is not changed.
+ * @param[in] offset Offset in the file of the first byte to send.
+ * @param[in] bytesToSend Number of bytes to send from the file.
+ *
+ * @note Like #Plaintext_Send, fewer bytes than requested may be sent. The
+ * caller sends the rest by calling again with the offset moved past the
+ * bytes that were sent.
+ *
+ * @return Number of bytes sent if successful; 0 if the send timed out or the
+ * file ended at @p offset; negative value on error.
+ */
+int32_t Plaintext_SendFile( const NetworkContext_t * pNetworkContext,
+                            int32_t fileDescriptor,
+                            off_t offset,
+                            size_t bytesToSend );
+
 #endif /* ifndef PLAINTEXT_POSIX_H_ */
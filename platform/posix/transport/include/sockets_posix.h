@@ -48,9 +48,21 @@
 
 /************ End of logging configuration ****************/
 
+/* Standard includes. */
+#include <stdbool.h>
+
 /* Transport interface include. */
 #include "transport_interface.h"
 
+/**
+ * @brief The maximum number of resolved addresses raced by
+ * #Sockets_ConnectWithConfig when #SocketsConfig_t.connectionAttemptDelayMs
+ * is set. Further addresses are not attempted.
+ */
+#ifndef SOCKETS_MAX_CONNECTION_ATTEMPTS
+    #define SOCKETS_MAX_CONNECTION_ATTEMPTS    ( 8U )
+#endif
+
 /**
  * @brief TCP Connect / Disconnect return status.
  */
@@ -74,6 +86,142 @@ typedef struct ServerInfo
     uint16_t port;          /**< @brief Server port in host-order. */
 } ServerInfo_t;
 
+/**
+ * @brief Tuning options set on the socket after it is created and before it
+ * is connected.
+ *
+ * Fields that are 0 or false leave the default of the operating system. An
+ * option that cannot be set is logged and skipped.
+ */
+typedef struct SocketOptions
+{
+    /**
+     * @brief Disable Nagle's algorithm with TCP_NODELAY, so that small
+     * packets are sent without waiting for earlier ones to be acknowledged.
+     */
+    bool noDelay;
+
+    bool keepAlive;                /**< @brief Send TCP keep-alive probes on an idle connection. */
+    uint32_t keepAliveIdleSec;     /**< @brief Idle time before the first keep-alive probe. */
+    uint32_t keepAliveIntervalSec; /**< @brief Time between keep-alive probes. */
+    uint32_t keepAliveProbeCount;  /**< @brief Unanswered probes before the connection is dropped. */
+
+    uint32_t sendBufferSize;       /**< @brief Size of the kernel send buffer (SO_SNDBUF). */
+    uint32_t receiveBufferSize;    /**< @brief Size of the kernel receive buffer (SO_RCVBUF). */
+
+    /**
+     * @brief Time that sent data may remain unacknowledged before the
+     * connection is dropped (TCP_USER_TIMEOUT).
+     */
+    uint32_t userTimeoutMs;
+
+    /**
+     * @brief Use TCP Fast Open (TCP_FASTOPEN_CONNECT), so that the first data
+     * sent, such as the TLS ClientHello, is carried in the SYN once the
+     * server has issued a cookie.
+     *
+     * @note The connect then completes without waiting for the handshake, and
+     * a failure to connect is reported by the first send or receive.
+     */
+    bool fastOpen;
+} SocketOptions_t;
+
+/**
+ * @brief Times, from #Clock_GetTimeUs, at which each phase of establishing
+ * a connection completed, to find which phase makes a connect slow.
+ *
+ * A time of zero means the phase was not reached or does not apply.
+ */
+typedef struct ConnectTiming
+{
+    uint64_t startUs;                  /**< @brief When connecting started. Set by
+                                        * #Sockets_ConnectWithConfig unless already set. */
+    uint64_t dnsResolvedUs;            /**< @brief When the addresses of the server were known. */
+    uint64_t tcpConnectedUs;           /**< @brief When the TCP connection was established, or
+                                        * only set up when #SocketOptions_t.fastOpen is used. */
+    uint64_t tlsCertificateReceivedUs; /**< @brief When the certificate of the server was received. */
+    uint64_t tlsCertificateVerifiedUs; /**< @brief When the next handshake message was read, which
+                                        * is after the certificate chain was verified. */
+    uint64_t tlsHandshakeDoneUs;       /**< @brief When the TLS handshake completed. */
+    uint64_t connackReceivedUs;        /**< @brief When the CONNACK was received, set by the
+                                        * caller of MQTT_Connect. */
+    bool dnsCacheUsed;                 /**< @brief Whether the DNS cache was used, in which case a
+                                        * short DNS phase means the addresses were cached. */
+    bool tlsSessionResumed;            /**< @brief Whether the TLS handshake resumed a session, in
+                                        * which case the server sends no certificate. */
+} ConnectTiming_t;
+
+/**
+ * @brief Configuration used when establishing a connection to a server.
+ *
+ * @note Fields that are not used must be zero, so the structure should be
+ * cleared with memset before it is filled in.
+ */
+typedef struct SocketsConfig
+{
+    uint32_t sendTimeoutMs; /**< @brief Timeout for transport send. */
+    uint32_t recvTimeoutMs; /**< @brief Timeout for transport recv. */
+
+    /**
+     * @brief Put the socket in non-blocking mode once it is connected.
+     *
+     * The send and receive timeouts are then not set on the socket, and
+     * the transport is expected to keep them and wait only when the socket
+     * would block.
+     */
+    bool nonBlocking;
+
+    /**
+     * @brief Delay before attempting the next resolved address while
+     * earlier attempts are still in progress, as in Happy Eyeballs
+     * (RFC 8305), which recommends 250 ms.
+     *
+     * The addresses are attempted alternating between IPv6 and IPv4,
+     * starting with the family of the first address returned by DNS. The
+     * first connection to be established is used and the others are closed.
+     * An attempt that fails starts the next one immediately.
+     *
+     * Set to 0 to attempt the addresses one at a time with a blocking
+     * connect.
+     */
+    uint32_t connectionAttemptDelayMs;
+
+    /**
+     * @brief Time allowed for establishing the connection, over all of the
+     * resolved addresses.
+     *
+     * The addresses are connected to with a non-blocking connect, and
+     * #SOCKETS_CONNECT_FAILURE is returned when no connection is established
+     * within this time.
+     *
+     * Set to 0 to wait for the blocking connect of the operating system, or,
+     * when #SocketsConfig_t.connectionAttemptDelayMs is set, for the attempts
+     * to complete.
+     */
+    uint32_t connectTimeoutMs;
+
+    /**
+     * @brief Take the addresses of the server from the DNS cache of
+     * dns_cache_posix.h instead of resolving the host name on every connect.
+     *
+     * When no address can be connected to, the host name is removed from
+     * the cache so that the next connect resolves it again.
+     */
+    bool useDnsCache;
+
+    /**
+     * @brief Tuning options to set on the socket before connecting; NULL to
+     * keep the defaults.
+     */
+    const SocketOptions_t * pSocketOptions;
+
+    /**
+     * @brief Times at which the DNS and TCP phases of the connection
+     * completed; NULL to not record them.
+     */
+    ConnectTiming_t * pConnectTiming;
+} SocketsConfig_t;
+
 /**
  * @brief Establish a connection to server.
  *
@@ -92,6 +240,43 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
                                 uint32_t sendTimeoutMs,
                                 uint32_t recvTimeoutMs );
 
+/**
+ * @brief Establish a connection to server with additional configuration.
+ *
+ * @param[out] pTcpSocket The output parameter to return the created socket descriptor.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pSocketsConfig Connection configuration.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE, #SOCKETS_API_ERROR on error.
+ */
+SocketStatus_t Sockets_ConnectWithConfig( int32_t * pTcpSocket,
+                                          const ServerInfo_t * pServerInfo,
+                                          const SocketsConfig_t * pSocketsConfig );
+
+/**
+ * @brief Establish a connection to a server listening on a Unix domain
+ * socket, such as a broker or gateway on the same host.
+ *
+ * The connection skips DNS and the TCP/IP stack. It is a stream socket, so
+ * the plaintext transport sends and receives over it as over TCP.
+ *
+ * @param[out] pUnixSocket The output parameter to return the created socket descriptor.
+ * @param[in] pSocketPath Path of the socket. On Linux, a path that starts
+ * with a NUL byte is an abstract address, which has no file.
+ * @param[in] socketPathLength Length of the path, without a terminating NUL.
+ * @param[in] pSocketsConfig Connection configuration. Only
+ * #SocketsConfig_t.sendTimeoutMs, #SocketsConfig_t.recvTimeoutMs and
+ * #SocketsConfig_t.nonBlocking apply; the other fields are for TCP.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_CONNECT_FAILURE, #SOCKETS_API_ERROR, #SOCKETS_INSUFFICIENT_MEMORY on error.
+ */
+SocketStatus_t Sockets_ConnectUnix( int32_t * pUnixSocket,
+                                    const char * pSocketPath,
+                                    size_t socketPathLength,
+                                    const SocketsConfig_t * pSocketsConfig );
+
 /**
  * @brief End connection to server.
  *
@@ -0,0 +1,158 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TRANSPORT_STATS_POSIX_H_
+#define TRANSPORT_STATS_POSIX_H_
+
+/**
+ * @file transport_stats_posix.h
+ * @brief Optional per-connection counters of the plaintext and OpenSSL
+ * transports.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Clock include. */
+#include "clock.h"
+
+/**
+ * @brief Set to 1 to add a #TransportStats_t pointer to the network context
+ * of the plaintext and OpenSSL transports and to count their operations.
+ *
+ * When this is 0, the pointer and every counting statement are removed by the
+ * preprocessor, so the transports are the same as without statistics.
+ */
+#ifndef TRANSPORT_STATS_ENABLED
+    #define TRANSPORT_STATS_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Counters of a connection.
+ *
+ * The application owns the counters and points the network context at them
+ * before connecting. Counters of the receive functions describe the calls
+ * made by the application, such as #Plaintext_Recv, and not the system calls
+ * made inside them.
+ */
+typedef struct TransportStats
+{
+    uint64_t bytesReceived;  /**< @brief Bytes returned by the receive function. */
+    uint64_t bytesSent;      /**< @brief Bytes reported as sent by the send functions. */
+    uint64_t blockedTimeUs;  /**< @brief Time spent in the receive and send functions, most
+                              * of which is spent waiting for the socket. */
+    uint32_t recvCalls;      /**< @brief Calls of the receive function. */
+    uint32_t sendCalls;      /**< @brief Calls of the send functions. */
+    uint32_t recvTimeouts;   /**< @brief Receive calls that returned 0 bytes. */
+    uint32_t sendTimeouts;   /**< @brief Send calls that returned 0 bytes. */
+    uint32_t errors;         /**< @brief Receive and send calls that returned an error. */
+    uint32_t systemCalls;    /**< @brief System calls made on the socket, including the TLS
+                              * handshake for the OpenSSL transport. */
+    uint32_t wantReadCount;  /**< @brief SSL_ERROR_WANT_READ results of the OpenSSL transport. */
+    uint32_t wantWriteCount; /**< @brief SSL_ERROR_WANT_WRITE results of the OpenSSL transport. */
+} TransportStats_t;
+
+#if ( TRANSPORT_STATS_ENABLED != 0 )
+
+/**
+ * @brief Add one to a counter if the connection has statistics.
+ *
+ * @param[in] pStats The counters of the connection, or NULL.
+ * @param[in] counter The member of #TransportStats_t to increment.
+ */
+    #define TRANSPORT_STATS_INCREMENT( pStats, counter ) \
+    do {                                                 \
+        if( ( pStats ) != NULL )                         \
+        {                                                \
+            ( pStats )->counter++;                       \
+        }                                                \
+    } while( 0 )
+
+/**
+ * @brief The time at the start of a receive or send call, to pass to
+ * #TRANSPORT_STATS_RECORD. It is 0 when the connection has no statistics.
+ *
+ * @param[in] pStats The counters of the connection, or NULL.
+ */
+    #define TRANSPORT_STATS_START( pStats ) \
+    ( ( ( pStats ) != NULL ) ? Clock_GetTimeUs() : 0U )
+
+/**
+ * @brief Record the result of a receive or send call.
+ *
+ * @param[in] pStats The counters of the connection, or NULL.
+ * @param[in] isSend Whether the call was a send.
+ * @param[in] result The return value of the call.
+ * @param[in] startTimeUs The value of #TRANSPORT_STATS_START at the start
+ * of the call.
+ */
+    #define TRANSPORT_STATS_RECORD( pStats, isSend, result, startTimeUs ) \
+    TransportStats_RecordCall( ( pStats ), ( isSend ), ( result ), ( startTimeUs ) )
+
+#else /* if ( TRANSPORT_STATS_ENABLED != 0 ) */
+
+    #define TRANSPORT_STATS_INCREMENT( pStats, counter )
+    #define TRANSPORT_STATS_START( pStats )                                  ( 0U )
+    #define TRANSPORT_STATS_RECORD( pStats, isSend, result, startTimeUs )    ( void ) ( startTimeUs )
+
+#endif /* if ( TRANSPORT_STATS_ENABLED != 0 ) */
+
+#if ( TRANSPORT_STATS_ENABLED != 0 )
+
+/**
+ * @brief Record the result of a receive or send call.
+ *
+ * Use #TRANSPORT_STATS_RECORD instead, so that the call is removed when
+ * #TRANSPORT_STATS_ENABLED is 0.
+ *
+ * @param[in] pStats The counters of the connection. Nothing is recorded
+ * when this is NULL.
+ * @param[in] isSend Whether the call was a send.
+ * @param[in] result The return value of the call.
+ * @param[in] startTimeUs The time the call started.
+ */
+void TransportStats_RecordCall( TransportStats_t * pStats,
+                                bool isSend,
+                                int32_t result,
+                                uint64_t startTimeUs );
+
+/**
+ * @brief Copy the counters of a connection and optionally reset them.
+ *
+ * @param[in] pStats The counters of the connection.
+ * @param[out] pSnapshot The copy of the counters.
+ * @param[in] reset Whether to set the counters to 0 after copying them.
+ *
+ * @note The counters are not protected against concurrent updates. Take the
+ * snapshot from the thread that calls the transport functions of the
+ * connection.
+ *
+ * @return true if successful; false if a parameter is NULL.
+ */
+bool TransportStats_Snapshot( TransportStats_t * pStats,
+                              TransportStats_t * pSnapshot,
+                              bool reset );
+
+#endif /* if ( TRANSPORT_STATS_ENABLED != 0 ) */
+
+#endif /* ifndef TRANSPORT_STATS_POSIX_H_ */
@@ -0,0 +1,500 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include "dns_cache_posix.h"
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of nanoseconds in one millisecond.
+ */
+#define ONE_MS_TO_NS     ( 1000000U )
+
+/**
+ * @brief The resolved addresses of a host name kept in the cache.
+ */
+typedef struct DnsCacheEntry
+{
+    char hostName[ DNS_CACHE_MAX_HOST_NAME_LENGTH + 1U ];
+    size_t hostNameLength;
+    struct sockaddr_storage addresses[ DNS_CACHE_MAX_ADDRESSES ];
+    socklen_t addressLengths[ DNS_CACHE_MAX_ADDRESSES ];
+    size_t addressCount;
+    uint64_t expiryTimeMs; /* 0 when the entry is unused. */
+} DnsCacheEntry_t;
+
+/**
+ * @brief The cached host names.
+ */
+static DnsCacheEntry_t cacheEntries[ DNS_CACHE_MAX_ENTRIES ];
+
+/**
+ * @brief Protects #cacheEntries.
+ */
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the entry of a host name. #cacheMutex must be held.
+ *
+ * @param[in] pHostName The host name.
+ * @param[in] hostNameLength Length of the host name.
+ *
+ * @return The entry; NULL if the host name is not cached.
+ */
+static DnsCacheEntry_t * findEntry( const char * pHostName,
+                                    size_t hostNameLength );
+
+/**
+ * @brief Copy the addresses of an entry into a record.
+ *
+ * @param[in] pEntry The cache entry.
+ * @param[out] pRecord The record to copy the addresses into.
+ */
+static void copyEntryToRecord( const DnsCacheEntry_t * pEntry,
+                               DnsCacheRecord_t * pRecord );
+
+/**
+ * @brief Get the addresses of a host name from the cache if they have not
+ * expired.
+ *
+ * @param[in] pHostName The host name.
+ * @param[in] hostNameLength Length of the host name.
+ * @param[out] pRecord The record to copy the addresses into; may be NULL to
+ * only check whether they are cached.
+ *
+ * @return true if the addresses are cached; false otherwise.
+ */
+static bool lookupCache( const char * pHostName,
+                         size_t hostNameLength,
+                         DnsCacheRecord_t * pRecord );
+
+/**
+ * @brief Resolve a host name with getaddrinfo and cache its addresses.
+ *
+ * @param[in] pHostName The host name.
+ * @param[in] hostNameLength Length of the host name.
+ * @param[out] pRecord The record to copy the addresses into; may be NULL.
+ *
+ * @return #DNS_CACHE_SUCCESS if successful; #DNS_CACHE_DNS_FAILURE on error.
+ */
+static DnsCacheStatus_t resolveAndStore( const char * pHostName,
+                                         size_t hostNameLength,
+                                         DnsCacheRecord_t * pRecord );
+
+/**
+ * @brief Worker thread of #DnsCache_ResolveAsync.
+ *
+ * @param[in] pArgument The #DnsCacheRequest_t to resolve.
+ *
+ * @return NULL.
+ */
+static void * resolveWorker( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static DnsCacheEntry_t * findEntry( const char * pHostName,
+                                    size_t hostNameLength )
+{
+    DnsCacheEntry_t * pEntry = NULL;
+    size_t i;
+
+    for( i = 0U; ( i < DNS_CACHE_MAX_ENTRIES ) && ( pEntry == NULL ); i++ )
+    {
+        if( ( cacheEntries[ i ].expiryTimeMs != 0U ) &&
+            ( cacheEntries[ i ].hostNameLength == hostNameLength ) &&
+            ( memcmp( cacheEntries[ i ].hostName, pHostName, hostNameLength ) == 0 ) )
+        {
+            pEntry = &cacheEntries[ i ];
+        }
+    }
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static void copyEntryToRecord( const DnsCacheEntry_t * pEntry,
+                               DnsCacheRecord_t * pRecord )
+{
+    size_t i;
+
+    ( void ) memset( pRecord, 0, sizeof( DnsCacheRecord_t ) );
+
+    for( i = 0U; i < pEntry->addressCount; i++ )
+    {
+        ( void ) memcpy( &pRecord->addresses[ i ],
+                         &pEntry->addresses[ i ],
+                         sizeof( struct sockaddr_storage ) );
+
+        /* The records are the same as the ones asked from getaddrinfo. */
+        pRecord->addrInfo[ i ].ai_family = ( int ) pEntry->addresses[ i ].ss_family;
+        pRecord->addrInfo[ i ].ai_socktype = SOCK_STREAM;
+        pRecord->addrInfo[ i ].ai_protocol = IPPROTO_TCP;
+        pRecord->addrInfo[ i ].ai_addrlen = pEntry->addressLengths[ i ];
+
+        /* MISRA Rule 11.3 flags the following line for casting a pointer of
+         * a object type to a pointer of a different object type. This rule
+         * is suppressed because struct sockaddr_storage is defined by POSIX
+         * to be large enough and aligned for any struct sockaddr. */
+        /* coverity[misra_c_2012_rule_11_3_violation] */
+        pRecord->addrInfo[ i ].ai_addr = ( struct sockaddr * ) &pRecord->addresses[ i ];
+        pRecord->addrInfo[ i ].ai_next = ( ( i + 1U ) < pEntry->addressCount ) ?
+                                         &pRecord->addrInfo[ i + 1U ] : NULL;
+    }
+
+    pRecord->addressCount = pEntry->addressCount;
+}
+/*-----------------------------------------------------------*/
+
+static bool lookupCache( const char * pHostName,
+                         size_t hostNameLength,
+                         DnsCacheRecord_t * pRecord )
+{
+    DnsCacheEntry_t * pEntry = NULL;
+    bool cached = false;
+    uint64_t nowMs = Clock_GetTimeNs() / ONE_MS_TO_NS;
+
+    ( void ) pthread_mutex_lock( &cacheMutex );
+
+    pEntry = findEntry( pHostName, hostNameLength );
+
+    if( ( pEntry != NULL ) && ( pEntry->expiryTimeMs > nowMs ) )
+    {
+        if( pRecord != NULL )
+        {
+            copyEntryToRecord( pEntry, pRecord );
+        }
+
+        cached = true;
+    }
+
+    ( void ) pthread_mutex_unlock( &cacheMutex );
+
+    return cached;
+}
+/*-----------------------------------------------------------*/
+
+static DnsCacheStatus_t resolveAndStore( const char * pHostName,
+                                         size_t hostNameLength,
+                                         DnsCacheRecord_t * pRecord )
+{
+    DnsCacheStatus_t returnStatus = DNS_CACHE_SUCCESS;
+    DnsCacheEntry_t newEntry;
+    DnsCacheEntry_t * pEntry = NULL;
+    struct addrinfo hints;
+    struct addrinfo * pListHead = NULL;
+    const struct addrinfo * pIndex = NULL;
+    int32_t dnsStatus = -1;
+    size_t i;
+
+    ( void ) memset( &newEntry, 0, sizeof( newEntry ) );
+    ( void ) memcpy( newEntry.hostName, pHostName, hostNameLength );
+    newEntry.hostNameLength = hostNameLength;
+
+    /* Ask for the same records as #Sockets_Connect. */
+    ( void ) memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = ( int32_t ) SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    dnsStatus = getaddrinfo( newEntry.hostName, NULL, &hints, &pListHead );
+
+    if( dnsStatus != 0 )
+    {
+        LogError( ( "Failed to resolve DNS: Hostname=%.*s, ErrorCode=%d.",
+                    ( int32_t ) hostNameLength,
+                    pHostName,
+                    dnsStatus ) );
+        returnStatus = DNS_CACHE_DNS_FAILURE;
+    }
+    else
+    {
+        for( pIndex = pListHead;
+             ( pIndex != NULL ) && ( newEntry.addressCount < DNS_CACHE_MAX_ADDRESSES );
+             pIndex = pIndex->ai_next )
+        {
+            if( ( pIndex->ai_addr != NULL ) &&
+                ( ( size_t ) pIndex->ai_addrlen <= sizeof( struct sockaddr_storage ) ) )
+            {
+                ( void ) memcpy( &newEntry.addresses[ newEntry.addressCount ],
+                                 pIndex->ai_addr,
+                                 ( size_t ) pIndex->ai_addrlen );
+                newEntry.addressLengths[ newEntry.addressCount ] = pIndex->ai_addrlen;
+                newEntry.addressCount++;
+            }
+        }
+
+        freeaddrinfo( pListHead );
+
+        if( newEntry.addressCount == 0U )
+        {
+            LogError( ( "DNS returned no addresses: Hostname=%.*s.",
+                        ( int32_t ) hostNameLength,
+                        pHostName ) );
+            returnStatus = DNS_CACHE_DNS_FAILURE;
+        }
+    }
+
+    if( returnStatus == DNS_CACHE_SUCCESS )
+    {
+        newEntry.expiryTimeMs = ( Clock_GetTimeNs() / ONE_MS_TO_NS ) + DNS_CACHE_TTL_MS;
+
+        ( void ) pthread_mutex_lock( &cacheMutex );
+
+        /* Replace the entry of the host name, an unused entry or the entry
+         * that expires first, in that order. */
+        pEntry = findEntry( pHostName, hostNameLength );
+
+        for( i = 0U; ( i < DNS_CACHE_MAX_ENTRIES ) && ( pEntry == NULL ); i++ )
+        {
+            if( cacheEntries[ i ].expiryTimeMs == 0U )
+            {
+                pEntry = &cacheEntries[ i ];
+            }
+        }
+
+        if( pEntry == NULL )
+        {
+            pEntry = &cacheEntries[ 0 ];
+
+            for( i = 1U; i < DNS_CACHE_MAX_ENTRIES; i++ )
+            {
+                if( cacheEntries[ i ].expiryTimeMs < pEntry->expiryTimeMs )
+                {
+                    pEntry = &cacheEntries[ i ];
+                }
+            }
+        }
+
+        ( void ) memcpy( pEntry, &newEntry, sizeof( newEntry ) );
+
+        ( void ) pthread_mutex_unlock( &cacheMutex );
+
+        if( pRecord != NULL )
+        {
+            copyEntryToRecord( &newEntry, pRecord );
+        }
+
+        LogDebug( ( "Cached %u addresses: Hostname=%.*s.",
+                    ( unsigned int ) newEntry.addressCount,
+                    ( int32_t ) hostNameLength,
+                    pHostName ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void * resolveWorker( void * pArgument )
+{
+    DnsCacheRequest_t * pRequest = ( DnsCacheRequest_t * ) pArgument;
+    uint8_t signal = 1U;
+
+    pRequest->resolveStatus = resolveAndStore( pRequest->hostName,
+                                               pRequest->hostNameLength,
+                                               NULL );
+
+    /* Wake up the application waiting on the notify descriptor. */
+    if( write( pRequest->signalDescriptor, &signal, sizeof( signal ) ) != ( ssize_t ) sizeof( signal ) )
+    {
+        LogError( ( "Failed to signal the completion of a DNS resolve." ) );
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+DnsCacheStatus_t DnsCache_Resolve( const char * pHostName,
+                                   size_t hostNameLength,
+                                   DnsCacheRecord_t * pRecord )
+{
+    DnsCacheStatus_t returnStatus = DNS_CACHE_SUCCESS;
+
+    if( ( pHostName == NULL ) || ( pRecord == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pHostName=%p, pRecord=%p.",
+                    ( const void * ) pHostName,
+                    ( void * ) pRecord ) );
+        returnStatus = DNS_CACHE_INVALID_PARAMETER;
+    }
+    else if( ( hostNameLength == 0U ) || ( hostNameLength > DNS_CACHE_MAX_HOST_NAME_LENGTH ) )
+    {
+        LogError( ( "Parameter check failed: hostNameLength must be between 1 and %u.",
+                    ( unsigned int ) DNS_CACHE_MAX_HOST_NAME_LENGTH ) );
+        returnStatus = DNS_CACHE_INVALID_PARAMETER;
+    }
+    else if( lookupCache( pHostName, hostNameLength, pRecord ) == false )
+    {
+        returnStatus = resolveAndStore( pHostName, hostNameLength, pRecord );
+    }
+    else
+    {
+        LogDebug( ( "Using cached addresses: Hostname=%.*s.",
+                    ( int32_t ) hostNameLength,
+                    pHostName ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+DnsCacheStatus_t DnsCache_ResolveAsync( DnsCacheRequest_t * pRequest,
+                                        const char * pHostName,
+                                        size_t hostNameLength )
+{
+    DnsCacheStatus_t returnStatus = DNS_CACHE_SUCCESS;
+    int pipeDescriptors[ 2 ] = { -1, -1 };
+
+    if( ( pRequest == NULL ) || ( pHostName == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pRequest=%p, pHostName=%p.",
+                    ( void * ) pRequest,
+                    ( const void * ) pHostName ) );
+        returnStatus = DNS_CACHE_INVALID_PARAMETER;
+    }
+    else if( ( hostNameLength == 0U ) || ( hostNameLength > DNS_CACHE_MAX_HOST_NAME_LENGTH ) )
+    {
+        LogError( ( "Parameter check failed: hostNameLength must be between 1 and %u.",
+                    ( unsigned int ) DNS_CACHE_MAX_HOST_NAME_LENGTH ) );
+        returnStatus = DNS_CACHE_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pRequest, 0, sizeof( DnsCacheRequest_t ) );
+        pRequest->notifyDescriptor = -1;
+        pRequest->signalDescriptor = -1;
+
+        if( lookupCache( pHostName, hostNameLength, NULL ) == false )
+        {
+            ( void ) memcpy( pRequest->hostName, pHostName, hostNameLength );
+            pRequest->hostNameLength = hostNameLength;
+            returnStatus = DNS_CACHE_IN_PROGRESS;
+        }
+    }
+
+    if( returnStatus == DNS_CACHE_IN_PROGRESS )
+    {
+        if( pipe( pipeDescriptors ) != 0 )
+        {
+            LogError( ( "Failed to create the pipe to signal the DNS resolve." ) );
+            returnStatus = DNS_CACHE_API_ERROR;
+        }
+        else
+        {
+            pRequest->notifyDescriptor = ( int32_t ) pipeDescriptors[ 0 ];
+            pRequest->signalDescriptor = ( int32_t ) pipeDescriptors[ 1 ];
+
+            if( pthread_create( &pRequest->thread, NULL, resolveWorker, pRequest ) != 0 )
+            {
+                LogError( ( "Failed to create the DNS resolve thread." ) );
+                ( void ) close( pRequest->notifyDescriptor );
+                ( void ) close( pRequest->signalDescriptor );
+                pRequest->notifyDescriptor = -1;
+                pRequest->signalDescriptor = -1;
+                returnStatus = DNS_CACHE_API_ERROR;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+DnsCacheStatus_t DnsCache_FinishResolve( DnsCacheRequest_t * pRequest )
+{
+    DnsCacheStatus_t returnStatus = DNS_CACHE_SUCCESS;
+
+    if( pRequest == NULL )
+    {
+        LogError( ( "Parameter check failed: pRequest is NULL." ) );
+        returnStatus = DNS_CACHE_INVALID_PARAMETER;
+    }
+    else if( pRequest->notifyDescriptor < 0 )
+    {
+        LogError( ( "Parameter check failed: The request is not in progress." ) );
+        returnStatus = DNS_CACHE_INVALID_PARAMETER;
+    }
+    else if( pthread_join( pRequest->thread, NULL ) != 0 )
+    {
+        LogError( ( "Failed to join the DNS resolve thread." ) );
+        returnStatus = DNS_CACHE_API_ERROR;
+    }
+    else
+    {
+        ( void ) close( pRequest->notifyDescriptor );
+        ( void ) close( pRequest->signalDescriptor );
+        pRequest->notifyDescriptor = -1;
+        pRequest->signalDescriptor = -1;
+        returnStatus = pRequest->resolveStatus;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+DnsCacheStatus_t DnsCache_Invalidate( const char * pHostName,
+                                      size_t hostNameLength )
+{
+    DnsCacheStatus_t returnStatus = DNS_CACHE_SUCCESS;
+    DnsCacheEntry_t * pEntry = NULL;
+
+    if( ( pHostName == NULL ) || ( hostNameLength == 0U ) )
+    {
+        LogError( ( "Parameter check failed: pHostName is NULL or hostNameLength is 0." ) );
+        returnStatus = DNS_CACHE_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &cacheMutex );
+
+        pEntry = findEntry( pHostName, hostNameLength );
+
+        if( pEntry != NULL )
+        {
+            ( void ) memset( pEntry, 0, sizeof( DnsCacheEntry_t ) );
+        }
+
+        ( void ) pthread_mutex_unlock( &cacheMutex );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+void DnsCache_Clear( void )
+{
+    ( void ) pthread_mutex_lock( &cacheMutex );
+    ( void ) memset( cacheEntries, 0, sizeof( cacheEntries ) );
+    ( void ) pthread_mutex_unlock( &cacheMutex );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,560 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <errno.h>
+#include <unistd.h>
+
+#include "event_loop_posix.h"
+
+#ifdef EVENT_LOOP_USE_EPOLL
+    #include <sys/epoll.h>
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the slot of a socket descriptor in the event loop.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] socketDescriptor The socket descriptor to find.
+ *
+ * @return Pointer to the slot if it exists; NULL otherwise.
+ */
+static EventLoopEntry_t * findEntry( EventLoop_t * pEventLoop,
+                                     int32_t socketDescriptor );
+
+/**
+ * @brief Find an unused slot in the event loop.
+ *
+ * @param[in] pEventLoop The event loop.
+ *
+ * @return Pointer to an unused slot; NULL if all slots are in use.
+ */
+static EventLoopEntry_t * findFreeEntry( EventLoop_t * pEventLoop );
+
+/**
+ * @brief Register a change of the interest set of a slot with the system.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] pEntry The slot to register.
+ * @param[in] operation The epoll_ctl operation. It is ignored when poll is used.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_API_ERROR on error.
+ */
+static EventLoopStatus_t updateSystemInterest( EventLoop_t * pEventLoop,
+                                               EventLoopEntry_t * pEntry,
+                                               int32_t operation );
+
+/*-----------------------------------------------------------*/
+
+static EventLoopEntry_t * findEntry( EventLoop_t * pEventLoop,
+                                     int32_t socketDescriptor )
+{
+    EventLoopEntry_t * pEntry = NULL;
+    size_t i = 0U;
+
+    /* Unused slots hold a negative descriptor, so never match one. */
+    for( i = 0U; ( socketDescriptor >= 0 ) && ( i < pEventLoop->highestEntry ); i++ )
+    {
+        if( pEventLoop->entries[ i ].socketDescriptor == socketDescriptor )
+        {
+            pEntry = &pEventLoop->entries[ i ];
+            break;
+        }
+    }
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static EventLoopEntry_t * findFreeEntry( EventLoop_t * pEventLoop )
+{
+    EventLoopEntry_t * pEntry = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; i < EVENT_LOOP_MAX_CONNECTIONS; i++ )
+    {
+        if( pEventLoop->entries[ i ].socketDescriptor < 0 )
+        {
+            pEntry = &pEventLoop->entries[ i ];
+
+            if( i >= pEventLoop->highestEntry )
+            {
+                pEventLoop->highestEntry = i + 1U;
+            }
+
+            break;
+        }
+    }
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static EventLoopStatus_t updateSystemInterest( EventLoop_t * pEventLoop,
+                                               EventLoopEntry_t * pEntry,
+                                               int32_t operation )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+
+    #ifdef EVENT_LOOP_USE_EPOLL
+        struct epoll_event epollEvent;
+
+        ( void ) memset( &epollEvent, 0x00, sizeof( epollEvent ) );
+
+        if( ( pEntry->interestEvents & EVENT_LOOP_READABLE ) != 0U )
+        {
+            epollEvent.events |= ( uint32_t ) EPOLLIN;
+        }
+
+        if( ( pEntry->interestEvents & EVENT_LOOP_WRITABLE ) != 0U )
+        {
+            epollEvent.events |= ( uint32_t ) EPOLLOUT;
+        }
+
+        /* The slots never move, so the event can point to its slot directly. */
+        epollEvent.data.ptr = pEntry;
+
+        if( epoll_ctl( pEventLoop->epollDescriptor,
+                       operation,
+                       pEntry->socketDescriptor,
+                       &epollEvent ) != 0 )
+        {
+            LogError( ( "Failed to update epoll interest of socket %d: %s.",
+                        ( int ) pEntry->socketDescriptor,
+                        strerror( errno ) ) );
+            returnStatus = EVENT_LOOP_API_ERROR;
+        }
+    #else /* ifdef EVENT_LOOP_USE_EPOLL */
+        struct pollfd * pPollDescriptor = NULL;
+        size_t index = ( size_t ) ( pEntry - pEventLoop->entries );
+
+        ( void ) operation;
+
+        /* The poll descriptors are parallel to the slots. A negative descriptor
+         * is ignored by poll, so unused slots do not need to be compacted. */
+        pPollDescriptor = &pEventLoop->pollDescriptors[ index ];
+        pPollDescriptor->fd = pEntry->socketDescriptor;
+        pPollDescriptor->events = 0;
+        pPollDescriptor->revents = 0;
+
+        if( ( pEntry->interestEvents & EVENT_LOOP_READABLE ) != 0U )
+        {
+            pPollDescriptor->events |= POLLIN;
+        }
+
+        if( ( pEntry->interestEvents & EVENT_LOOP_WRITABLE ) != 0U )
+        {
+            pPollDescriptor->events |= POLLOUT;
+        }
+    #endif /* ifdef EVENT_LOOP_USE_EPOLL */
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Init( EventLoop_t * pEventLoop )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    size_t i = 0U;
+
+    if( pEventLoop == NULL )
+    {
+        LogError( ( "Parameter check failed: pEventLoop is NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pEventLoop, 0x00, sizeof( EventLoop_t ) );
+
+        for( i = 0U; i < EVENT_LOOP_MAX_CONNECTIONS; i++ )
+        {
+            pEventLoop->entries[ i ].socketDescriptor = -1;
+            #ifndef EVENT_LOOP_USE_EPOLL
+                pEventLoop->pollDescriptors[ i ].fd = -1;
+            #endif
+        }
+
+        #ifdef EVENT_LOOP_USE_EPOLL
+            pEventLoop->epollDescriptor = epoll_create1( EPOLL_CLOEXEC );
+
+            if( pEventLoop->epollDescriptor < 0 )
+            {
+                LogError( ( "Failed to create epoll instance: %s.",
+                            strerror( errno ) ) );
+                returnStatus = EVENT_LOOP_API_ERROR;
+            }
+        #endif
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Add( EventLoop_t * pEventLoop,
+                                 int32_t socketDescriptor,
+                                 NetworkContext_t * pNetworkContext,
+                                 uint32_t interestEvents )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    EventLoopEntry_t * pEntry = NULL;
+
+    if( ( pEventLoop == NULL ) || ( socketDescriptor < 0 ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop=%p, socketDescriptor=%d.",
+                    ( void * ) pEventLoop,
+                    ( int ) socketDescriptor ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else if( findEntry( pEventLoop, socketDescriptor ) != NULL )
+    {
+        LogError( ( "Socket %d is already added to the event loop.",
+                    ( int ) socketDescriptor ) );
+        returnStatus = EVENT_LOOP_ALREADY_REGISTERED;
+    }
+    else
+    {
+        pEntry = findFreeEntry( pEventLoop );
+
+        if( pEntry == NULL )
+        {
+            LogError( ( "Failed to add socket %d: All %u event loop slots are in use.",
+                        ( int ) socketDescriptor,
+                        ( unsigned int ) EVENT_LOOP_MAX_CONNECTIONS ) );
+            returnStatus = EVENT_LOOP_NO_MEMORY;
+        }
+    }
+
+    if( returnStatus == EVENT_LOOP_SUCCESS )
+    {
+        pEntry->socketDescriptor = socketDescriptor;
+        pEntry->pNetworkContext = pNetworkContext;
+        pEntry->interestEvents = interestEvents;
+
+        #ifdef EVENT_LOOP_USE_EPOLL
+            returnStatus = updateSystemInterest( pEventLoop, pEntry, EPOLL_CTL_ADD );
+        #else
+            returnStatus = updateSystemInterest( pEventLoop, pEntry, 0 );
+        #endif
+
+        if( returnStatus == EVENT_LOOP_SUCCESS )
+        {
+            pEventLoop->entryCount++;
+        }
+        else
+        {
+            /* Release the slot again. */
+            pEntry->socketDescriptor = -1;
+            pEntry->pNetworkContext = NULL;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Modify( EventLoop_t * pEventLoop,
+                                    int32_t socketDescriptor,
+                                    uint32_t interestEvents )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    EventLoopEntry_t * pEntry = NULL;
+
+    if( pEventLoop == NULL )
+    {
+        LogError( ( "Parameter check failed: pEventLoop is NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        pEntry = findEntry( pEventLoop, socketDescriptor );
+
+        if( pEntry == NULL )
+        {
+            LogError( ( "Socket %d is not owned by the event loop.",
+                        ( int ) socketDescriptor ) );
+            returnStatus = EVENT_LOOP_NOT_FOUND;
+        }
+    }
+
+    if( returnStatus == EVENT_LOOP_SUCCESS )
+    {
+        pEntry->interestEvents = interestEvents;
+
+        #ifdef EVENT_LOOP_USE_EPOLL
+            returnStatus = updateSystemInterest( pEventLoop, pEntry, EPOLL_CTL_MOD );
+        #else
+            returnStatus = updateSystemInterest( pEventLoop, pEntry, 0 );
+        #endif
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Remove( EventLoop_t * pEventLoop,
+                                    int32_t socketDescriptor )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    EventLoopEntry_t * pEntry = NULL;
+
+    if( pEventLoop == NULL )
+    {
+        LogError( ( "Parameter check failed: pEventLoop is NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        pEntry = findEntry( pEventLoop, socketDescriptor );
+
+        if( pEntry == NULL )
+        {
+            LogError( ( "Socket %d is not owned by the event loop.",
+                        ( int ) socketDescriptor ) );
+            returnStatus = EVENT_LOOP_NOT_FOUND;
+        }
+    }
+
+    if( returnStatus == EVENT_LOOP_SUCCESS )
+    {
+        #ifdef EVENT_LOOP_USE_EPOLL
+            if( epoll_ctl( pEventLoop->epollDescriptor,
+                           EPOLL_CTL_DEL,
+                           socketDescriptor,
+                           NULL ) != 0 )
+            {
+                LogError( ( "Failed to remove socket %d from epoll: %s.",
+                            ( int ) socketDescriptor,
+                            strerror( errno ) ) );
+                returnStatus = EVENT_LOOP_API_ERROR;
+            }
+        #else
+            pEventLoop->pollDescriptors[ pEntry - pEventLoop->entries ].fd = -1;
+        #endif
+
+        /* The slot is released even if the system call failed, as the
+         * descriptor is about to be closed by the application. */
+        pEntry->socketDescriptor = -1;
+        pEntry->pNetworkContext = NULL;
+        pEntry->interestEvents = 0U;
+        pEventLoop->entryCount--;
+
+        /* Shrink the range of slots that are scanned. */
+        while( ( pEventLoop->highestEntry > 0U ) &&
+               ( pEventLoop->entries[ pEventLoop->highestEntry - 1U ].socketDescriptor < 0 ) )
+        {
+            pEventLoop->highestEntry--;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Wait( EventLoop_t * pEventLoop,
+                                  EventLoopEvent_t * pEvents,
+                                  size_t maxEvents,
+                                  uint32_t timeoutMs,
+                                  size_t * pEventCount )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    int32_t pollTimeout = -1, readyCount = -1, i = 0;
+    size_t eventCount = 0U;
+    uint32_t events = 0U;
+    EventLoopEntry_t * pEntry = NULL;
+
+    #ifdef EVENT_LOOP_USE_EPOLL
+        struct epoll_event epollEvents[ EVENT_LOOP_MAX_CONNECTIONS ];
+        size_t eventsToWaitFor = 0U;
+    #else
+        size_t index = 0U;
+    #endif
+
+    if( ( pEventLoop == NULL ) || ( pEvents == NULL ) ||
+        ( maxEvents == 0U ) || ( pEventCount == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop=%p, pEvents=%p, "
+                    "maxEvents=%lu, pEventCount=%p.",
+                    ( void * ) pEventLoop,
+                    ( void * ) pEvents,
+                    ( unsigned long ) maxEvents,
+                    ( void * ) pEventCount ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* A negative timeout makes both epoll and poll block indefinitely. */
+        if( timeoutMs == EVENT_LOOP_WAIT_FOREVER )
+        {
+            pollTimeout = -1;
+        }
+        else if( timeoutMs > ( uint32_t ) INT32_MAX )
+        {
+            pollTimeout = INT32_MAX;
+        }
+        else
+        {
+            pollTimeout = ( int32_t ) timeoutMs;
+        }
+
+        #ifdef EVENT_LOOP_USE_EPOLL
+            eventsToWaitFor = ( maxEvents < EVENT_LOOP_MAX_CONNECTIONS ) ?
+                              maxEvents : EVENT_LOOP_MAX_CONNECTIONS;
+
+            readyCount = epoll_wait( pEventLoop->epollDescriptor,
+                                     epollEvents,
+                                     ( int ) eventsToWaitFor,
+                                     pollTimeout );
+        #else
+            readyCount = poll( pEventLoop->pollDescriptors,
+                               ( nfds_t ) pEventLoop->highestEntry,
+                               pollTimeout );
+        #endif
+
+        if( readyCount < 0 )
+        {
+            /* An interrupted wait is reported as a timeout so the caller
+             * simply waits again. */
+            if( errno != EINTR )
+            {
+                LogError( ( "Failed to wait for socket events: %s.",
+                            strerror( errno ) ) );
+                returnStatus = EVENT_LOOP_API_ERROR;
+            }
+
+            readyCount = 0;
+        }
+    }
+
+    if( returnStatus == EVENT_LOOP_SUCCESS )
+    {
+        #ifdef EVENT_LOOP_USE_EPOLL
+            for( i = 0; i < readyCount; i++ )
+            {
+                pEntry = ( EventLoopEntry_t * ) epollEvents[ i ].data.ptr;
+                events = 0U;
+
+                if( ( epollEvents[ i ].events & ( uint32_t ) EPOLLIN ) != 0U )
+                {
+                    events |= EVENT_LOOP_READABLE;
+                }
+
+                if( ( epollEvents[ i ].events & ( uint32_t ) EPOLLOUT ) != 0U )
+                {
+                    events |= EVENT_LOOP_WRITABLE;
+                }
+
+                if( ( epollEvents[ i ].events & ( ( uint32_t ) EPOLLERR | ( uint32_t ) EPOLLHUP ) ) != 0U )
+                {
+                    events |= EVENT_LOOP_ERROR;
+                }
+
+                pEvents[ eventCount ].socketDescriptor = pEntry->socketDescriptor;
+                pEvents[ eventCount ].pNetworkContext = pEntry->pNetworkContext;
+                pEvents[ eventCount ].events = events;
+                eventCount++;
+            }
+        #else /* ifdef EVENT_LOOP_USE_EPOLL */
+            ( void ) i;
+
+            for( index = 0U;
+                 ( index < pEventLoop->highestEntry ) &&
+                 ( readyCount > 0 ) && ( eventCount < maxEvents );
+                 index++ )
+            {
+                if( ( pEventLoop->pollDescriptors[ index ].fd >= 0 ) &&
+                    ( pEventLoop->pollDescriptors[ index ].revents != 0 ) )
+                {
+                    pEntry = &pEventLoop->entries[ index ];
+                    events = 0U;
+                    readyCount--;
+
+                    if( ( pEventLoop->pollDescriptors[ index ].revents & POLLIN ) != 0 )
+                    {
+                        events |= EVENT_LOOP_READABLE;
+                    }
+
+                    if( ( pEventLoop->pollDescriptors[ index ].revents & POLLOUT ) != 0 )
+                    {
+                        events |= EVENT_LOOP_WRITABLE;
+                    }
+
+                    if( ( pEventLoop->pollDescriptors[ index ].revents & ( POLLERR | POLLHUP | POLLNVAL ) ) != 0 )
+                    {
+                        events |= EVENT_LOOP_ERROR;
+                    }
+
+                    pEvents[ eventCount ].socketDescriptor = pEntry->socketDescriptor;
+                    pEvents[ eventCount ].pNetworkContext = pEntry->pNetworkContext;
+                    pEvents[ eventCount ].events = events;
+                    eventCount++;
+                }
+            }
+        #endif /* ifdef EVENT_LOOP_USE_EPOLL */
+    }
+
+    if( pEventCount != NULL )
+    {
+        *pEventCount = eventCount;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Deinit( EventLoop_t * pEventLoop )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+
+    if( pEventLoop == NULL )
+    {
+        LogError( ( "Parameter check failed: pEventLoop is NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        #ifdef EVENT_LOOP_USE_EPOLL
+            if( pEventLoop->epollDescriptor >= 0 )
+            {
+                if( close( pEventLoop->epollDescriptor ) != 0 )
+                {
+                    LogError( ( "Failed to close epoll instance: %s.",
+                                strerror( errno ) ) );
+                    returnStatus = EVENT_LOOP_API_ERROR;
+                }
+
+                pEventLoop->epollDescriptor = -1;
+            }
+        #endif
+
+        pEventLoop->entryCount = 0U;
+        pEventLoop->highestEntry = 0U;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
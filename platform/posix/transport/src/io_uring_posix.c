@@ -0,0 +1,1091 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* Linux include. */
+#include <linux/io_uring.h>
+
+#include "io_uring_posix.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Milliseconds per second.
+ */
+#define ONE_SEC_TO_MS                      ( 1000 )
+
+/**
+ * @brief Nanoseconds per millisecond.
+ */
+#define ONE_MS_TO_NS                       ( 1000000 )
+
+/**
+ * @brief User data of the linked timeouts of #IoUring_Recv and #IoUring_Send.
+ * Operations use the index of their request plus one, so this never matches
+ * one of them, and the completions that carry it are dropped.
+ */
+#define LINKED_TIMEOUT_USER_DATA           ( 0U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Call io_uring_enter, retrying when a signal interrupts it.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] minComplete Number of completions to wait for.
+ * @param[in] timeoutMs Time to wait for @p minComplete completions, or
+ * #IO_URING_WAIT_FOREVER. It is ignored when @p minComplete is 0.
+ *
+ * @return 0 if successful; a negative errno value on error. -ETIME is
+ * returned when the timeout expired.
+ */
+static int32_t enterRing( IoUring_t * pRing,
+                          uint32_t minComplete,
+                          uint32_t timeoutMs );
+
+/**
+ * @brief Map the submission and completion queues of a ring.
+ *
+ * @param[in] pRing The ring, with its descriptor set.
+ * @param[in] pParams The parameters returned by io_uring_setup.
+ *
+ * @return #IO_URING_SUCCESS if successful; #IO_URING_API_ERROR on error.
+ */
+static IoUringStatus_t mapRing( IoUring_t * pRing,
+                                const struct io_uring_params * pParams );
+
+/**
+ * @brief Unmap the queues mapped by #mapRing.
+ *
+ * @param[in] pRing The ring.
+ */
+static void unmapRing( IoUring_t * pRing );
+
+/**
+ * @brief Check that submission queue entries are free. When the queue is
+ * full, the queued entries are submitted to make room.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] entryCount Number of entries needed.
+ *
+ * @return true if @p entryCount entries are free; false otherwise.
+ */
+static bool reserveSqes( IoUring_t * pRing,
+                         uint32_t entryCount );
+
+/**
+ * @brief Get a free submission queue entry after the queued ones.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] offset Position of the entry after the last queued entry. It
+ * must be less than the count passed to #reserveSqes.
+ *
+ * @return The entry, cleared.
+ */
+static struct io_uring_sqe * getSqe( IoUring_t * pRing,
+                                     uint32_t offset );
+
+/**
+ * @brief Make the entries returned by #getSqe visible to the kernel.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] entryCount Number of entries to queue.
+ */
+static void queueSqes( IoUring_t * pRing,
+                       uint32_t entryCount );
+
+/**
+ * @brief Fill a submission queue entry for a receive or send.
+ *
+ * @param[in] pNetworkContext The connection of the operation.
+ * @param[in] requestIndex The request of the operation.
+ * @param[in] length Number of bytes to transfer.
+ * @param[out] pSqe The entry to fill.
+ */
+static void prepareOperation( const NetworkContext_t * pNetworkContext,
+                              int32_t requestIndex,
+                              size_t length,
+                              struct io_uring_sqe * pSqe );
+
+/**
+ * @brief Take a free request slot of a ring.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] pNetworkContext The connection of the operation.
+ * @param[in] operation The kind of operation.
+ * @param[in] pBuffer The buffer of the operation.
+ * @param[in] synchronous Whether the caller waits for the operation.
+ *
+ * @return The index of the request; -1 if all requests are in use.
+ */
+static int32_t allocateRequest( IoUring_t * pRing,
+                                NetworkContext_t * pNetworkContext,
+                                IoUringOperation_t operation,
+                                void * pBuffer,
+                                bool synchronous );
+
+/**
+ * @brief Queue an operation that #IoUring_WaitCompletions reports.
+ *
+ * @param[in] pNetworkContext The connection of the operation.
+ * @param[in] operation The kind of operation.
+ * @param[in] pBuffer The buffer of the operation.
+ * @param[in] length Number of bytes to transfer.
+ *
+ * @return #IO_URING_SUCCESS if successful;
+ * #IO_URING_NO_MEMORY, #IO_URING_API_ERROR on error.
+ */
+static IoUringStatus_t submitOperation( NetworkContext_t * pNetworkContext,
+                                        IoUringOperation_t operation,
+                                        void * pBuffer,
+                                        size_t length );
+
+/**
+ * @brief Queue an operation, submit it and wait until it completes or its
+ * timeout expires.
+ *
+ * @param[in] pNetworkContext The connection of the operation.
+ * @param[in] operation The kind of operation.
+ * @param[in] pBuffer The buffer of the operation.
+ * @param[in] length Number of bytes to transfer.
+ * @param[in] timeoutMs Time to wait for the operation. 0 waits forever.
+ *
+ * @return The result reported by the kernel; -ECANCELED when the timeout
+ * expired, or a negative errno value when the operation could not be
+ * submitted.
+ */
+static int32_t runOperation( NetworkContext_t * pNetworkContext,
+                             IoUringOperation_t operation,
+                             void * pBuffer,
+                             size_t length,
+                             uint32_t timeoutMs );
+
+/**
+ * @brief Move the results of all completion queue entries to their requests.
+ *
+ * @param[in] pRing The ring.
+ */
+static void reapCompletions( IoUring_t * pRing );
+
+/**
+ * @brief Convert the result of #runOperation to the return value of the
+ * transport interface functions.
+ *
+ * @param[in] result The result of #runOperation.
+ * @param[in] operation The kind of operation.
+ *
+ * @return Number of bytes transferred, 0 on timeout; -1 on error.
+ */
+static int32_t convertResult( int32_t result,
+                              IoUringOperation_t operation );
+
+/*-----------------------------------------------------------*/
+
+static int32_t enterRing( IoUring_t * pRing,
+                          uint32_t minComplete,
+                          uint32_t timeoutMs )
+{
+    struct io_uring_getevents_arg waitArgument;
+    struct __kernel_timespec waitTimeout;
+    uint32_t flags = 0U;
+    long enterStatus = -1;
+    int32_t returnStatus = 0;
+    bool retry = true;
+
+    ( void ) memset( &waitArgument, 0, sizeof( waitArgument ) );
+
+    if( minComplete > 0U )
+    {
+        flags = IORING_ENTER_GETEVENTS;
+
+        if( timeoutMs != IO_URING_WAIT_FOREVER )
+        {
+            waitTimeout.tv_sec = ( int64_t ) ( timeoutMs / ( uint32_t ) ONE_SEC_TO_MS );
+            waitTimeout.tv_nsec = ( int64_t ) ( timeoutMs % ( uint32_t ) ONE_SEC_TO_MS ) * ONE_MS_TO_NS;
+            waitArgument.ts = ( uint64_t ) ( uintptr_t ) &waitTimeout;
+        }
+    }
+
+    /* The argument is always passed so that the wait has the same form with
+     * and without a timeout. */
+    flags |= IORING_ENTER_EXT_ARG;
+
+    while( retry == true )
+    {
+        enterStatus = syscall( __NR_io_uring_enter,
+                               pRing->ringDescriptor,
+                               pRing->pendingSubmissions,
+                               minComplete,
+                               flags,
+                               &waitArgument,
+                               sizeof( waitArgument ) );
+
+        if( enterStatus >= 0 )
+        {
+            /* The kernel consumes entries in order, so the ones it did not
+             * take stay queued for the next call. */
+            pRing->pendingSubmissions -= ( uint32_t ) enterStatus;
+            retry = false;
+        }
+        else if( errno != EINTR )
+        {
+            returnStatus = -errno;
+            retry = false;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static IoUringStatus_t mapRing( IoUring_t * pRing,
+                                const struct io_uring_params * pParams )
+{
+    IoUringStatus_t returnStatus = IO_URING_SUCCESS;
+    uint8_t * pSqRing = NULL, * pCqRing = NULL;
+    void * pMapping = NULL;
+
+    pRing->sqRingLength = pParams->sq_off.array + ( pParams->sq_entries * sizeof( uint32_t ) );
+    pRing->cqRingLength = pParams->cq_off.cqes + ( pParams->cq_entries * sizeof( struct io_uring_cqe ) );
+    pRing->sqesLength = pParams->sq_entries * sizeof( struct io_uring_sqe );
+
+    /* Both rings share one mapping when the kernel supports it. */
+    if( ( pParams->features & IORING_FEAT_SINGLE_MMAP ) != 0U )
+    {
+        if( pRing->cqRingLength > pRing->sqRingLength )
+        {
+            pRing->sqRingLength = pRing->cqRingLength;
+        }
+
+        pRing->cqRingLength = 0U;
+    }
+
+    pMapping = mmap( NULL, pRing->sqRingLength, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, pRing->ringDescriptor,
+                     ( off_t ) IORING_OFF_SQ_RING );
+
+    if( pMapping == MAP_FAILED )
+    {
+        LogError( ( "Failed to map the submission queue: errno=%d.", errno ) );
+        returnStatus = IO_URING_API_ERROR;
+    }
+    else
+    {
+        pRing->pSqRing = pMapping;
+
+        if( pRing->cqRingLength == 0U )
+        {
+            pRing->pCqRing = pMapping;
+        }
+        else
+        {
+            pMapping = mmap( NULL, pRing->cqRingLength, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, pRing->ringDescriptor,
+                             ( off_t ) IORING_OFF_CQ_RING );
+
+            if( pMapping == MAP_FAILED )
+            {
+                LogError( ( "Failed to map the completion queue: errno=%d.", errno ) );
+                returnStatus = IO_URING_API_ERROR;
+            }
+            else
+            {
+                pRing->pCqRing = pMapping;
+            }
+        }
+    }
+
+    if( returnStatus == IO_URING_SUCCESS )
+    {
+        pMapping = mmap( NULL, pRing->sqesLength, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, pRing->ringDescriptor,
+                         ( off_t ) IORING_OFF_SQES );
+
+        if( pMapping == MAP_FAILED )
+        {
+            LogError( ( "Failed to map the submission queue entries: errno=%d.", errno ) );
+            returnStatus = IO_URING_API_ERROR;
+        }
+        else
+        {
+            pRing->pSqes = ( struct io_uring_sqe * ) pMapping;
+        }
+    }
+
+    if( returnStatus == IO_URING_SUCCESS )
+    {
+        pSqRing = ( uint8_t * ) pRing->pSqRing;
+        pCqRing = ( uint8_t * ) pRing->pCqRing;
+
+        pRing->pSqHead = ( uint32_t * ) &pSqRing[ pParams->sq_off.head ];
+        pRing->pSqTail = ( uint32_t * ) &pSqRing[ pParams->sq_off.tail ];
+        pRing->pSqArray = ( uint32_t * ) &pSqRing[ pParams->sq_off.array ];
+        pRing->sqMask = *( ( uint32_t * ) &pSqRing[ pParams->sq_off.ring_mask ] );
+        pRing->sqEntries = pParams->sq_entries;
+        pRing->pCqHead = ( uint32_t * ) &pCqRing[ pParams->cq_off.head ];
+        pRing->pCqTail = ( uint32_t * ) &pCqRing[ pParams->cq_off.tail ];
+        pRing->pCqes = ( struct io_uring_cqe * ) &pCqRing[ pParams->cq_off.cqes ];
+        pRing->cqMask = *( ( uint32_t * ) &pCqRing[ pParams->cq_off.ring_mask ] );
+    }
+    else
+    {
+        unmapRing( pRing );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void unmapRing( IoUring_t * pRing )
+{
+    if( pRing->pSqes != NULL )
+    {
+        ( void ) munmap( pRing->pSqes, pRing->sqesLength );
+        pRing->pSqes = NULL;
+    }
+
+    if( ( pRing->pCqRing != NULL ) && ( pRing->pCqRing != pRing->pSqRing ) )
+    {
+        ( void ) munmap( pRing->pCqRing, pRing->cqRingLength );
+    }
+
+    pRing->pCqRing = NULL;
+
+    if( pRing->pSqRing != NULL )
+    {
+        ( void ) munmap( pRing->pSqRing, pRing->sqRingLength );
+        pRing->pSqRing = NULL;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static bool reserveSqes( IoUring_t * pRing,
+                         uint32_t entryCount )
+{
+    uint32_t head = 0U, tail = 0U;
+
+    /* The tail is only written by the application, and the head by the
+     * kernel once it consumed the entries. */
+    tail = *pRing->pSqTail;
+    head = __atomic_load_n( pRing->pSqHead, __ATOMIC_ACQUIRE );
+
+    if( ( ( pRing->sqEntries - ( tail - head ) ) < entryCount ) &&
+        ( pRing->pendingSubmissions > 0U ) )
+    {
+        ( void ) enterRing( pRing, 0U, 0U );
+        head = __atomic_load_n( pRing->pSqHead, __ATOMIC_ACQUIRE );
+    }
+
+    return ( ( pRing->sqEntries - ( tail - head ) ) >= entryCount ) ? true : false;
+}
+/*-----------------------------------------------------------*/
+
+static struct io_uring_sqe * getSqe( IoUring_t * pRing,
+                                     uint32_t offset )
+{
+    struct io_uring_sqe * pSqe = &pRing->pSqes[ ( *pRing->pSqTail + offset ) & pRing->sqMask ];
+
+    ( void ) memset( pSqe, 0, sizeof( struct io_uring_sqe ) );
+
+    return pSqe;
+}
+/*-----------------------------------------------------------*/
+
+static void queueSqes( IoUring_t * pRing,
+                       uint32_t entryCount )
+{
+    uint32_t tail = *pRing->pSqTail;
+    uint32_t i = 0U;
+
+    for( i = 0U; i < entryCount; i++ )
+    {
+        pRing->pSqArray[ ( tail + i ) & pRing->sqMask ] = ( tail + i ) & pRing->sqMask;
+    }
+
+    /* The entries must be written before the kernel sees the new tail. */
+    __atomic_store_n( pRing->pSqTail, tail + entryCount, __ATOMIC_RELEASE );
+    pRing->pendingSubmissions += entryCount;
+}
+/*-----------------------------------------------------------*/
+
+static void prepareOperation( const NetworkContext_t * pNetworkContext,
+                              int32_t requestIndex,
+                              size_t length,
+                              struct io_uring_sqe * pSqe )
+{
+    const IoUringRequest_t * pRequest = &pNetworkContext->pRing->requests[ requestIndex ];
+    const uint8_t * pRegisteredBuffer = NULL;
+
+    if( pNetworkContext->bufferIndex >= 0 )
+    {
+        pRegisteredBuffer = &pNetworkContext->pRing->pBuffers[ ( size_t ) pNetworkContext->bufferIndex *
+                                                               IO_URING_BUFFER_LENGTH ];
+    }
+
+    pSqe->fd = pNetworkContext->socketDescriptor;
+    pSqe->addr = ( uint64_t ) ( uintptr_t ) pRequest->pBuffer;
+    pSqe->len = ( uint32_t ) length;
+    pSqe->user_data = ( uint64_t ) requestIndex + 1U;
+
+    if( pRequest->operation == IO_URING_OPERATION_SEND )
+    {
+        pSqe->opcode = IORING_OP_SEND;
+        pSqe->msg_flags = MSG_NOSIGNAL;
+    }
+    else if( ( pRegisteredBuffer != NULL ) &&
+             ( ( const uint8_t * ) pRequest->pBuffer == pRegisteredBuffer ) )
+    {
+        /* The kernel already holds the pages of registered buffers. */
+        pSqe->opcode = IORING_OP_READ_FIXED;
+        pSqe->buf_index = ( uint16_t ) pNetworkContext->bufferIndex;
+    }
+    else
+    {
+        pSqe->opcode = IORING_OP_RECV;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static int32_t allocateRequest( IoUring_t * pRing,
+                                NetworkContext_t * pNetworkContext,
+                                IoUringOperation_t operation,
+                                void * pBuffer,
+                                bool synchronous )
+{
+    int32_t requestIndex = -1;
+    size_t i = 0U;
+
+    for( i = 0U; ( i < IO_URING_QUEUE_DEPTH ) && ( requestIndex < 0 ); i++ )
+    {
+        if( pRing->requests[ i ].inUse == false )
+        {
+            pRing->requests[ i ].pNetworkContext = pNetworkContext;
+            pRing->requests[ i ].pBuffer = pBuffer;
+            pRing->requests[ i ].result = 0;
+            pRing->requests[ i ].operation = operation;
+            pRing->requests[ i ].inUse = true;
+            pRing->requests[ i ].synchronous = synchronous;
+            pRing->requests[ i ].completed = false;
+            requestIndex = ( int32_t ) i;
+        }
+    }
+
+    return requestIndex;
+}
+/*-----------------------------------------------------------*/
+
+static IoUringStatus_t submitOperation( NetworkContext_t * pNetworkContext,
+                                        IoUringOperation_t operation,
+                                        void * pBuffer,
+                                        size_t length )
+{
+    IoUring_t * pRing = pNetworkContext->pRing;
+    IoUringStatus_t returnStatus = IO_URING_SUCCESS;
+    struct io_uring_sqe * pSqe = NULL;
+    int32_t requestIndex = -1;
+
+    requestIndex = allocateRequest( pRing, pNetworkContext, operation, pBuffer, false );
+
+    if( requestIndex < 0 )
+    {
+        LogError( ( "All %u requests of the ring are in use.", IO_URING_QUEUE_DEPTH ) );
+        returnStatus = IO_URING_NO_MEMORY;
+    }
+    else
+    {
+        if( reserveSqes( pRing, 1U ) == false )
+        {
+            LogError( ( "The submission queue of the ring is full." ) );
+            pRing->requests[ requestIndex ].inUse = false;
+            returnStatus = IO_URING_NO_MEMORY;
+        }
+        else
+        {
+            pSqe = getSqe( pRing, 0U );
+            prepareOperation( pNetworkContext, requestIndex, length, pSqe );
+            queueSqes( pRing, 1U );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t runOperation( NetworkContext_t * pNetworkContext,
+                             IoUringOperation_t operation,
+                             void * pBuffer,
+                             size_t length,
+                             uint32_t timeoutMs )
+{
+    IoUring_t * pRing = pNetworkContext->pRing;
+    IoUringRequest_t * pRequest = NULL;
+    struct io_uring_sqe * pSqe = NULL, * pTimeoutSqe = NULL;
+    struct __kernel_timespec operationTimeout;
+    uint32_t entryCount = ( timeoutMs > 0U ) ? 2U : 1U;
+    int32_t requestIndex = -1, result = -ENOBUFS, enterStatus = 0;
+
+    requestIndex = allocateRequest( pRing, pNetworkContext, operation, pBuffer, true );
+
+    if( requestIndex >= 0 )
+    {
+        pRequest = &pRing->requests[ requestIndex ];
+
+        if( reserveSqes( pRing, entryCount ) == true )
+        {
+            pSqe = getSqe( pRing, 0U );
+        }
+    }
+
+    if( pSqe != NULL )
+    {
+        prepareOperation( pNetworkContext, requestIndex, length, pSqe );
+
+        if( timeoutMs > 0U )
+        {
+            /* The kernel cancels the operation with -ECANCELED once the
+             * linked timeout expires. The timeout is read when the entries
+             * are submitted below. */
+            operationTimeout.tv_sec = ( int64_t ) ( timeoutMs / ( uint32_t ) ONE_SEC_TO_MS );
+            operationTimeout.tv_nsec = ( int64_t ) ( timeoutMs % ( uint32_t ) ONE_SEC_TO_MS ) * ONE_MS_TO_NS;
+
+            pSqe->flags |= IOSQE_IO_LINK;
+            pTimeoutSqe = getSqe( pRing, 1U );
+            pTimeoutSqe->opcode = IORING_OP_LINK_TIMEOUT;
+            pTimeoutSqe->fd = -1;
+            pTimeoutSqe->addr = ( uint64_t ) ( uintptr_t ) &operationTimeout;
+            pTimeoutSqe->len = 1U;
+            pTimeoutSqe->user_data = LINKED_TIMEOUT_USER_DATA;
+        }
+
+        queueSqes( pRing, entryCount );
+
+        /* Other completions found while waiting are kept for
+         * IoUring_WaitCompletions. */
+        while( ( pRequest->completed == false ) && ( enterStatus == 0 ) )
+        {
+            enterStatus = enterRing( pRing, 1U, IO_URING_WAIT_FOREVER );
+            reapCompletions( pRing );
+        }
+
+        if( pRequest->completed == true )
+        {
+            result = pRequest->result;
+            pRequest->inUse = false;
+        }
+        else
+        {
+            /* The request stays in use, as the kernel may still complete
+             * it, and IoUring_WaitCompletions drops it then. */
+            LogError( ( "Failed to wait for the operation: errno=%d.", -enterStatus ) );
+            pRequest->pNetworkContext = NULL;
+            pRequest->synchronous = false;
+            result = enterStatus;
+        }
+    }
+    else
+    {
+        LogError( ( "No room in the ring to submit the operation." ) );
+
+        if( pRequest != NULL )
+        {
+            pRequest->inUse = false;
+        }
+    }
+
+    return result;
+}
+/*-----------------------------------------------------------*/
+
+static void reapCompletions( IoUring_t * pRing )
+{
+    const struct io_uring_cqe * pCqe = NULL;
+    IoUringRequest_t * pRequest = NULL;
+    uint32_t head = 0U, tail = 0U;
+    size_t completedIndex = 0U;
+
+    head = *pRing->pCqHead;
+    tail = __atomic_load_n( pRing->pCqTail, __ATOMIC_ACQUIRE );
+
+    while( head != tail )
+    {
+        pCqe = &pRing->pCqes[ head & pRing->cqMask ];
+
+        if( ( pCqe->user_data != LINKED_TIMEOUT_USER_DATA ) &&
+            ( pCqe->user_data <= IO_URING_QUEUE_DEPTH ) )
+        {
+            pRequest = &pRing->requests[ pCqe->user_data - 1U ];
+            pRequest->result = pCqe->res;
+            pRequest->completed = true;
+
+            if( pRequest->synchronous == false )
+            {
+                completedIndex = ( pRing->completedHead + pRing->completedCount ) % IO_URING_QUEUE_DEPTH;
+                pRing->completedRequests[ completedIndex ] = ( uint16_t ) ( pCqe->user_data - 1U );
+                pRing->completedCount++;
+            }
+        }
+
+        head++;
+    }
+
+    /* Entries must be read before the kernel may overwrite them. */
+    __atomic_store_n( pRing->pCqHead, head, __ATOMIC_RELEASE );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t convertResult( int32_t result,
+                              IoUringOperation_t operation )
+{
+    int32_t bytesTransferred = -1;
+
+    if( result > 0 )
+    {
+        bytesTransferred = result;
+    }
+    else if( ( result == -ECANCELED ) || ( result == -EAGAIN ) || ( result == -EINTR ) )
+    {
+        /* Timed out before any data could be transferred. */
+        bytesTransferred = 0;
+    }
+    else if( result == 0 )
+    {
+        /* A receive of 0 bytes means the peer closed the connection. */
+        bytesTransferred = ( operation == IO_URING_OPERATION_RECV ) ? -1 : 0;
+    }
+    else
+    {
+        LogError( ( "Transport operation failed: errno=%d.", -result ) );
+    }
+
+    return bytesTransferred;
+}
+/*-----------------------------------------------------------*/
+
+IoUringStatus_t IoUring_Init( IoUring_t * pRing,
+                              uint8_t * pBuffers,
+                              size_t bufferCount )
+{
+    IoUringStatus_t returnStatus = IO_URING_SUCCESS;
+    struct io_uring_params params;
+    struct iovec bufferVectors[ IO_URING_MAX_BUFFERS ];
+    long systemStatus = -1;
+    size_t i = 0U;
+
+    if( pRing == NULL )
+    {
+        LogError( ( "Parameter check failed: pRing is NULL." ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else if( ( bufferCount > IO_URING_MAX_BUFFERS ) ||
+             ( ( pBuffers == NULL ) && ( bufferCount > 0U ) ) )
+    {
+        LogError( ( "Parameter check failed: Invalid buffers: pBuffers=%p, bufferCount=%lu.",
+                    ( void * ) pBuffers, ( unsigned long ) bufferCount ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pRing, 0, sizeof( IoUring_t ) );
+        ( void ) memset( &params, 0, sizeof( params ) );
+
+        systemStatus = syscall( __NR_io_uring_setup, IO_URING_QUEUE_DEPTH, &params );
+
+        if( systemStatus < 0 )
+        {
+            LogError( ( "Failed to create the ring: errno=%d.", errno ) );
+            pRing->ringDescriptor = -1;
+            returnStatus = IO_URING_API_ERROR;
+        }
+        else
+        {
+            pRing->ringDescriptor = ( int32_t ) systemStatus;
+        }
+    }
+
+    /* Waiting with a timeout needs the extended argument of io_uring_enter. */
+    if( ( returnStatus == IO_URING_SUCCESS ) &&
+        ( ( params.features & IORING_FEAT_EXT_ARG ) == 0U ) )
+    {
+        LogError( ( "The kernel does not support waiting for completions with a timeout." ) );
+        returnStatus = IO_URING_API_ERROR;
+    }
+
+    if( returnStatus == IO_URING_SUCCESS )
+    {
+        returnStatus = mapRing( pRing, &params );
+    }
+
+    if( ( returnStatus == IO_URING_SUCCESS ) && ( bufferCount > 0U ) )
+    {
+        for( i = 0U; i < bufferCount; i++ )
+        {
+            bufferVectors[ i ].iov_base = &pBuffers[ i * IO_URING_BUFFER_LENGTH ];
+            bufferVectors[ i ].iov_len = IO_URING_BUFFER_LENGTH;
+        }
+
+        systemStatus = syscall( __NR_io_uring_register,
+                                pRing->ringDescriptor,
+                                IORING_REGISTER_BUFFERS,
+                                bufferVectors,
+                                ( unsigned int ) bufferCount );
+
+        if( systemStatus < 0 )
+        {
+            LogError( ( "Failed to register %lu buffers: errno=%d.",
+                        ( unsigned long ) bufferCount, errno ) );
+            unmapRing( pRing );
+            returnStatus = IO_URING_API_ERROR;
+        }
+        else
+        {
+            pRing->pBuffers = pBuffers;
+            pRing->bufferCount = bufferCount;
+        }
+    }
+
+    if( ( returnStatus == IO_URING_API_ERROR ) && ( pRing->ringDescriptor >= 0 ) )
+    {
+        ( void ) close( pRing->ringDescriptor );
+        pRing->ringDescriptor = -1;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+IoUringStatus_t IoUring_Deinit( IoUring_t * pRing )
+{
+    IoUringStatus_t returnStatus = IO_URING_SUCCESS;
+
+    if( pRing == NULL )
+    {
+        LogError( ( "Parameter check failed: pRing is NULL." ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else if( pRing->ringDescriptor >= 0 )
+    {
+        /* Closing the ring also unregisters its buffers. */
+        unmapRing( pRing );
+        ( void ) close( pRing->ringDescriptor );
+        pRing->ringDescriptor = -1;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t IoUring_GetDescriptor( const IoUring_t * pRing )
+{
+    return ( pRing != NULL ) ? pRing->ringDescriptor : -1;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t IoUring_Connect( NetworkContext_t * pNetworkContext,
+                                IoUring_t * pRing,
+                                const ServerInfo_t * pServerInfo,
+                                const SocketsConfig_t * pSocketsConfig )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    SocketsConfig_t socketsConfig;
+    size_t i = 0U;
+
+    if( ( pNetworkContext == NULL ) || ( pRing == NULL ) || ( pSocketsConfig == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext=%p, pRing=%p, pSocketsConfig=%p.",
+                    ( void * ) pNetworkContext, ( void * ) pRing, ( const void * ) pSocketsConfig ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* The ring waits for the socket itself, so the socket stays in
+         * blocking mode, where the kernel does not fail operations that
+         * would block. */
+        socketsConfig = *pSocketsConfig;
+        socketsConfig.nonBlocking = false;
+
+        pNetworkContext->pRing = pRing;
+        pNetworkContext->sendTimeoutMs = pSocketsConfig->sendTimeoutMs;
+        pNetworkContext->recvTimeoutMs = pSocketsConfig->recvTimeoutMs;
+        pNetworkContext->bufferIndex = -1;
+
+        returnStatus = Sockets_ConnectWithConfig( &pNetworkContext->socketDescriptor,
+                                                  pServerInfo,
+                                                  &socketsConfig );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        for( i = 0U; ( i < pRing->bufferCount ) && ( pNetworkContext->bufferIndex < 0 ); i++ )
+        {
+            if( pRing->bufferInUse[ i ] == false )
+            {
+                pRing->bufferInUse[ i ] = true;
+                pNetworkContext->bufferIndex = ( int32_t ) i;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t IoUring_Disconnect( NetworkContext_t * pNetworkContext )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    if( pNetworkContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        if( ( pNetworkContext->pRing != NULL ) && ( pNetworkContext->bufferIndex >= 0 ) )
+        {
+            pNetworkContext->pRing->bufferInUse[ pNetworkContext->bufferIndex ] = false;
+            pNetworkContext->bufferIndex = -1;
+        }
+
+        returnStatus = Sockets_Disconnect( pNetworkContext->socketDescriptor );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t IoUring_Recv( NetworkContext_t * pNetworkContext,
+                      void * pBuffer,
+                      size_t bytesToRecv )
+{
+    int32_t result = 0;
+
+    assert( pNetworkContext != NULL );
+    assert( pNetworkContext->pRing != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToRecv > 0U );
+
+    result = runOperation( pNetworkContext,
+                           IO_URING_OPERATION_RECV,
+                           pBuffer,
+                           bytesToRecv,
+                           pNetworkContext->recvTimeoutMs );
+
+    return convertResult( result, IO_URING_OPERATION_RECV );
+}
+/*-----------------------------------------------------------*/
+
+int32_t IoUring_Send( NetworkContext_t * pNetworkContext,
+                      const void * pBuffer,
+                      size_t bytesToSend )
+{
+    int32_t result = 0;
+
+    assert( pNetworkContext != NULL );
+    assert( pNetworkContext->pRing != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToSend > 0U );
+
+    /* The cast removes the const qualifier, as requests also hold receive
+     * buffers. The kernel does not modify the buffer of a send. */
+    result = runOperation( pNetworkContext,
+                           IO_URING_OPERATION_SEND,
+                           ( void * ) pBuffer,
+                           bytesToSend,
+                           pNetworkContext->sendTimeoutMs );
+
+    return convertResult( result, IO_URING_OPERATION_SEND );
+}
+/*-----------------------------------------------------------*/
+
+IoUringStatus_t IoUring_SubmitRecv( NetworkContext_t * pNetworkContext,
+                                    void * pBuffer,
+                                    size_t bytesToRecv )
+{
+    IoUringStatus_t returnStatus = IO_URING_SUCCESS;
+    void * pRecvBuffer = pBuffer;
+    size_t recvLength = bytesToRecv;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pRing == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is not connected." ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else if( ( pBuffer == NULL ) && ( pNetworkContext->bufferIndex < 0 ) )
+    {
+        LogError( ( "Parameter check failed: The connection has no registered buffer." ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else if( bytesToRecv == 0U )
+    {
+        LogError( ( "Parameter check failed: bytesToRecv is 0." ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else
+    {
+        if( pBuffer == NULL )
+        {
+            pRecvBuffer = &pNetworkContext->pRing->pBuffers[ ( size_t ) pNetworkContext->bufferIndex *
+                                                              IO_URING_BUFFER_LENGTH ];
+
+            if( recvLength > IO_URING_BUFFER_LENGTH )
+            {
+                recvLength = IO_URING_BUFFER_LENGTH;
+            }
+        }
+
+        returnStatus = submitOperation( pNetworkContext,
+                                        IO_URING_OPERATION_RECV,
+                                        pRecvBuffer,
+                                        recvLength );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+IoUringStatus_t IoUring_SubmitSend( NetworkContext_t * pNetworkContext,
+                                    const void * pBuffer,
+                                    size_t bytesToSend )
+{
+    IoUringStatus_t returnStatus = IO_URING_SUCCESS;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pRing == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is not connected." ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else if( ( pBuffer == NULL ) || ( bytesToSend == 0U ) )
+    {
+        LogError( ( "Parameter check failed: pBuffer=%p, bytesToSend=%lu.",
+                    pBuffer, ( unsigned long ) bytesToSend ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* The cast removes the const qualifier, as requests also hold
+         * receive buffers. The kernel does not modify the buffer of a send. */
+        returnStatus = submitOperation( pNetworkContext,
+                                        IO_URING_OPERATION_SEND,
+                                        ( void * ) pBuffer,
+                                        bytesToSend );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+IoUringStatus_t IoUring_WaitCompletions( IoUring_t * pRing,
+                                         IoUringCompletion_t * pCompletions,
+                                         size_t maxCompletions,
+                                         uint32_t timeoutMs,
+                                         size_t * pCompletionCount )
+{
+    IoUringStatus_t returnStatus = IO_URING_SUCCESS;
+    IoUringRequest_t * pRequest = NULL;
+    int32_t enterStatus = 0;
+    size_t count = 0U;
+    bool waitDone = false;
+
+    if( ( pRing == NULL ) || ( pCompletions == NULL ) ||
+        ( maxCompletions == 0U ) || ( pCompletionCount == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pRing=%p, pCompletions=%p, "
+                    "maxCompletions=%lu, pCompletionCount=%p.",
+                    ( void * ) pRing, ( void * ) pCompletions,
+                    ( unsigned long ) maxCompletions, ( void * ) pCompletionCount ) );
+        returnStatus = IO_URING_INVALID_PARAMETER;
+    }
+    else
+    {
+        reapCompletions( pRing );
+
+        /* Submit before waiting, so that an expired timeout is reported. */
+        if( pRing->pendingSubmissions > 0U )
+        {
+            enterStatus = enterRing( pRing, 0U, 0U );
+        }
+
+        /* Completions of linked timeouts wake the wait without reporting
+         * anything, so wait again until an operation completes. */
+        while( ( waitDone == false ) && ( enterStatus == 0 ) && ( pRing->completedCount == 0U ) )
+        {
+            enterStatus = enterRing( pRing, ( timeoutMs > 0U ) ? 1U : 0U, timeoutMs );
+            reapCompletions( pRing );
+
+            if( ( enterStatus < 0 ) || ( timeoutMs == 0U ) )
+            {
+                waitDone = true;
+            }
+        }
+
+        /* An expired timeout is not an error. */
+        if( ( enterStatus < 0 ) && ( enterStatus != -ETIME ) )
+        {
+            LogError( ( "Failed to wait for completions: errno=%d.", -enterStatus ) );
+            returnStatus = IO_URING_API_ERROR;
+        }
+
+        while( ( count < maxCompletions ) && ( pRing->completedCount > 0U ) )
+        {
+            pRequest = &pRing->requests[ pRing->completedRequests[ pRing->completedHead ] ];
+            pRing->completedHead = ( pRing->completedHead + 1U ) % IO_URING_QUEUE_DEPTH;
+            pRing->completedCount--;
+
+            pRequest->inUse = false;
+
+            /* Operations abandoned by IoUring_Recv or IoUring_Send are not
+             * reported. */
+            if( pRequest->pNetworkContext != NULL )
+            {
+                pCompletions[ count ].pNetworkContext = pRequest->pNetworkContext;
+                pCompletions[ count ].operation = pRequest->operation;
+                pCompletions[ count ].pBuffer = pRequest->pBuffer;
+                pCompletions[ count ].result = pRequest->result;
+                count++;
+            }
+        }
+
+        *pCompletionCount = count;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
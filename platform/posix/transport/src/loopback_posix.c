@@ -0,0 +1,633 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* POSIX includes. */
+#include <time.h>
+
+#include "loopback_posix.h"
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Time waited between two checks of a ring that is empty or full.
+ */
+#ifndef LOOPBACK_POLL_INTERVAL_US
+    #define LOOPBACK_POLL_INTERVAL_US    ( 100U )
+#endif
+
+/**
+ * @brief Size of the buffer used by #Loopback_RunScript to receive data.
+ */
+#define LOOPBACK_SCRIPT_BUFFER_LENGTH    ( 256U )
+
+/**
+ * @brief Microseconds per second.
+ */
+#define ONE_SEC_TO_US                    ( 1000000U )
+
+/**
+ * @brief Milliseconds to microseconds.
+ */
+#define ONE_MS_TO_US                     ( 1000U )
+
+/**
+ * @brief Nanoseconds per microsecond.
+ */
+#define ONE_US_TO_NS                     ( 1000U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sleep for one poll interval, or less if the deadline is closer.
+ *
+ * @param[in] deadlineUs The time until which the caller waits.
+ *
+ * @return true if the deadline has not passed yet; false otherwise.
+ */
+static bool waitUntil( uint64_t deadlineUs );
+
+/**
+ * @brief Get the number of bytes that can be read from a ring.
+ *
+ * Must only be called by the reader of the ring.
+ *
+ * @param[in] pRing The ring.
+ *
+ * @return The number of readable bytes.
+ */
+static size_t getReadableLength( LoopbackRing_t * pRing );
+
+/**
+ * @brief Get the number of bytes that can be written to a ring.
+ *
+ * Must only be called by the writer of the ring.
+ *
+ * @param[in] pRing The ring.
+ *
+ * @return The number of bytes that fit in the ring.
+ */
+static size_t getWritableLength( const LoopbackRing_t * pRing );
+
+/**
+ * @brief Copy bytes out of a ring and release their space to the writer.
+ *
+ * @param[in] pRing The ring.
+ * @param[out] pBuffer Where to copy the bytes.
+ * @param[in] length Number of bytes, at most what #getReadableLength returned.
+ */
+static void readRing( LoopbackRing_t * pRing,
+                      uint8_t * pBuffer,
+                      size_t length );
+
+/**
+ * @brief Copy bytes into a ring and make them available to the reader,
+ * immediately or after the simulated latency and bandwidth.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] pBuffer The bytes to copy.
+ * @param[in] length Number of bytes, at most what #getWritableLength returned.
+ */
+static void writeRing( LoopbackRing_t * pRing,
+                       const uint8_t * pBuffer,
+                       size_t length );
+
+/*-----------------------------------------------------------*/
+
+static bool waitUntil( uint64_t deadlineUs )
+{
+    uint64_t now = Clock_GetTimeUs();
+    uint64_t sleepUs = LOOPBACK_POLL_INTERVAL_US;
+    struct timespec interval;
+    bool waited = false;
+
+    if( now < deadlineUs )
+    {
+        if( ( deadlineUs - now ) < sleepUs )
+        {
+            sleepUs = deadlineUs - now;
+        }
+
+        interval.tv_sec = 0;
+        interval.tv_nsec = ( long ) ( sleepUs * ONE_US_TO_NS );
+        ( void ) nanosleep( &interval, NULL );
+        waited = true;
+    }
+
+    return waited;
+}
+/*-----------------------------------------------------------*/
+
+static size_t getReadableLength( LoopbackRing_t * pRing )
+{
+    size_t segmentWriteCount = 0U;
+    size_t readableLength = 0U;
+    uint64_t now = 0U;
+    const LoopbackSegment_t * pSegment = NULL;
+
+    if( pRing->shaped == true )
+    {
+        segmentWriteCount = __atomic_load_n( &pRing->segmentWriteCount, __ATOMIC_ACQUIRE );
+        now = Clock_GetTimeUs();
+
+        while( pRing->segmentReadCount != segmentWriteCount )
+        {
+            pSegment = &pRing->segments[ pRing->segmentReadCount % LOOPBACK_MAX_SEGMENTS ];
+
+            if( pSegment->readyTimeUs > now )
+            {
+                break;
+            }
+
+            pRing->readablePosition = pSegment->endPosition;
+            __atomic_store_n( &pRing->segmentReadCount,
+                              pRing->segmentReadCount + 1U,
+                              __ATOMIC_RELEASE );
+        }
+
+        readableLength = pRing->readablePosition - pRing->readPosition;
+    }
+    else
+    {
+        readableLength = __atomic_load_n( &pRing->writePosition, __ATOMIC_ACQUIRE ) -
+                         pRing->readPosition;
+    }
+
+    return readableLength;
+}
+/*-----------------------------------------------------------*/
+
+static size_t getWritableLength( const LoopbackRing_t * pRing )
+{
+    size_t writableLength = 0U;
+    size_t segmentReadCount = 0U;
+
+    writableLength = pRing->bufferSize -
+                     ( pRing->writePosition -
+                       __atomic_load_n( &pRing->readPosition, __ATOMIC_ACQUIRE ) );
+
+    if( pRing->shaped == true )
+    {
+        segmentReadCount = __atomic_load_n( &pRing->segmentReadCount, __ATOMIC_ACQUIRE );
+
+        /* Every write needs a segment to record when it becomes readable. */
+        if( ( pRing->segmentWriteCount - segmentReadCount ) == LOOPBACK_MAX_SEGMENTS )
+        {
+            writableLength = 0U;
+        }
+    }
+
+    return writableLength;
+}
+/*-----------------------------------------------------------*/
+
+static void readRing( LoopbackRing_t * pRing,
+                      uint8_t * pBuffer,
+                      size_t length )
+{
+    size_t offset = pRing->readPosition & ( pRing->bufferSize - 1U );
+    size_t firstLength = pRing->bufferSize - offset;
+
+    if( firstLength > length )
+    {
+        firstLength = length;
+    }
+
+    ( void ) memcpy( pBuffer, &pRing->pBuffer[ offset ], firstLength );
+    ( void ) memcpy( &pBuffer[ firstLength ], pRing->pBuffer, length - firstLength );
+
+    __atomic_store_n( &pRing->readPosition,
+                      pRing->readPosition + length,
+                      __ATOMIC_RELEASE );
+}
+/*-----------------------------------------------------------*/
+
+static void writeRing( LoopbackRing_t * pRing,
+                       const uint8_t * pBuffer,
+                       size_t length )
+{
+    size_t offset = pRing->writePosition & ( pRing->bufferSize - 1U );
+    size_t firstLength = pRing->bufferSize - offset;
+    uint64_t now = 0U;
+    LoopbackSegment_t * pSegment = NULL;
+
+    if( firstLength > length )
+    {
+        firstLength = length;
+    }
+
+    ( void ) memcpy( &pRing->pBuffer[ offset ], pBuffer, firstLength );
+    ( void ) memcpy( pRing->pBuffer, &pBuffer[ firstLength ], length - firstLength );
+
+    __atomic_store_n( &pRing->writePosition,
+                      pRing->writePosition + length,
+                      __ATOMIC_RELEASE );
+
+    if( pRing->shaped == true )
+    {
+        now = Clock_GetTimeUs();
+
+        /* Writes are transmitted one after the other at the simulated
+         * bandwidth, then delayed by the simulated latency. */
+        if( pRing->transmitDoneUs < now )
+        {
+            pRing->transmitDoneUs = now;
+        }
+
+        if( pRing->shaping.bytesPerSecond != 0U )
+        {
+            pRing->transmitDoneUs += ( ( uint64_t ) length * ONE_SEC_TO_US ) /
+                                     pRing->shaping.bytesPerSecond;
+        }
+
+        pSegment = &pRing->segments[ pRing->segmentWriteCount % LOOPBACK_MAX_SEGMENTS ];
+        pSegment->endPosition = pRing->writePosition;
+        pSegment->readyTimeUs = pRing->transmitDoneUs + pRing->shaping.latencyUs;
+
+        __atomic_store_n( &pRing->segmentWriteCount,
+                          pRing->segmentWriteCount + 1U,
+                          __ATOMIC_RELEASE );
+    }
+}
+/*-----------------------------------------------------------*/
+
+LoopbackStatus_t Loopback_Init( LoopbackRing_t * pRing,
+                                uint8_t * pBuffer,
+                                size_t bufferSize,
+                                const LoopbackShaping_t * pShaping )
+{
+    LoopbackStatus_t returnStatus = LOOPBACK_SUCCESS;
+
+    if( ( pRing == NULL ) || ( pBuffer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pRing and pBuffer must not be NULL." ) );
+        returnStatus = LOOPBACK_INVALID_PARAMETER;
+    }
+    else if( ( bufferSize == 0U ) || ( ( bufferSize & ( bufferSize - 1U ) ) != 0U ) )
+    {
+        LogError( ( "Parameter check failed: bufferSize must be a power of 2: "
+                    "bufferSize=%lu.", ( unsigned long ) bufferSize ) );
+        returnStatus = LOOPBACK_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pRing, 0, sizeof( LoopbackRing_t ) );
+        pRing->pBuffer = pBuffer;
+        pRing->bufferSize = bufferSize;
+
+        if( ( pShaping != NULL ) &&
+            ( ( pShaping->latencyUs != 0U ) || ( pShaping->bytesPerSecond != 0U ) ) )
+        {
+            pRing->shaped = true;
+            pRing->shaping = *pShaping;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+LoopbackStatus_t Loopback_Connect( NetworkContext_t * pNetworkContext,
+                                   LoopbackRing_t * pRecvRing,
+                                   LoopbackRing_t * pSendRing,
+                                   uint32_t recvTimeoutMs,
+                                   uint32_t sendTimeoutMs )
+{
+    LoopbackStatus_t returnStatus = LOOPBACK_SUCCESS;
+
+    if( ( pNetworkContext == NULL ) || ( pRecvRing == NULL ) || ( pSendRing == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext, pRecvRing and "
+                    "pSendRing must not be NULL." ) );
+        returnStatus = LOOPBACK_INVALID_PARAMETER;
+    }
+    else if( pRecvRing == pSendRing )
+    {
+        LogError( ( "Parameter check failed: An endpoint needs different rings "
+                    "to receive and to send." ) );
+        returnStatus = LOOPBACK_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pNetworkContext, 0, sizeof( NetworkContext_t ) );
+        pNetworkContext->pRecvRing = pRecvRing;
+        pNetworkContext->pSendRing = pSendRing;
+        pNetworkContext->recvTimeoutMs = recvTimeoutMs;
+        pNetworkContext->sendTimeoutMs = sendTimeoutMs;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+LoopbackStatus_t Loopback_SetPeer( NetworkContext_t * pNetworkContext,
+                                   NetworkContext_t * pPeerEndpoint,
+                                   LoopbackPeerCallback_t peerCallback,
+                                   void * pPeerContext )
+{
+    LoopbackStatus_t returnStatus = LOOPBACK_SUCCESS;
+
+    if( ( pNetworkContext == NULL ) ||
+        ( ( peerCallback != NULL ) && ( pPeerEndpoint == NULL ) ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext must not be NULL, "
+                    "and a peer needs pPeerEndpoint." ) );
+        returnStatus = LOOPBACK_INVALID_PARAMETER;
+    }
+    else
+    {
+        pNetworkContext->peerCallback = peerCallback;
+        pNetworkContext->pPeerEndpoint = pPeerEndpoint;
+        pNetworkContext->pPeerContext = pPeerContext;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+LoopbackStatus_t Loopback_Disconnect( NetworkContext_t * pNetworkContext )
+{
+    LoopbackStatus_t returnStatus = LOOPBACK_SUCCESS;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pSendRing == NULL ) ||
+        ( pNetworkContext->pRecvRing == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is not connected." ) );
+        returnStatus = LOOPBACK_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Closing the ring the endpoint writes to ends the stream of the other
+         * endpoint. Closing the ring it reads from fails the sends of the other
+         * endpoint. */
+        __atomic_store_n( &pNetworkContext->pSendRing->closed, true, __ATOMIC_RELEASE );
+        __atomic_store_n( &pNetworkContext->pRecvRing->closed, true, __ATOMIC_RELEASE );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Loopback_Recv( NetworkContext_t * pNetworkContext,
+                       void * pBuffer,
+                       size_t bytesToRecv )
+{
+    int32_t bytesReceived = -1;
+    LoopbackRing_t * pRing = NULL;
+    uint64_t deadlineUs = 0U;
+    size_t readableLength = 0U;
+    bool closed = false;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pRecvRing == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is not connected." ) );
+    }
+    else if( ( pBuffer == NULL ) || ( bytesToRecv == 0U ) )
+    {
+        LogError( ( "Parameter check failed: pBuffer must not be NULL and "
+                    "bytesToRecv must be greater than 0." ) );
+    }
+    else
+    {
+        pRing = pNetworkContext->pRecvRing;
+        deadlineUs = Clock_GetTimeUs() + ( ( uint64_t ) pNetworkContext->recvTimeoutMs * ONE_MS_TO_US );
+
+        do
+        {
+            /* Read the flag first so that all data written before the ring was
+             * closed is seen. */
+            closed = __atomic_load_n( &pRing->closed, __ATOMIC_ACQUIRE );
+            readableLength = getReadableLength( pRing );
+
+            if( readableLength > 0U )
+            {
+                break;
+            }
+
+            if( ( closed == true ) &&
+                ( __atomic_load_n( &pRing->writePosition, __ATOMIC_ACQUIRE ) ==
+                  pRing->readPosition ) )
+            {
+                break;
+            }
+        } while( waitUntil( deadlineUs ) == true );
+
+        if( readableLength > 0U )
+        {
+            if( readableLength > bytesToRecv )
+            {
+                readableLength = bytesToRecv;
+            }
+
+            if( readableLength > ( size_t ) INT32_MAX )
+            {
+                readableLength = ( size_t ) INT32_MAX;
+            }
+
+            readRing( pRing, pBuffer, readableLength );
+            bytesReceived = ( int32_t ) readableLength;
+        }
+        else if( closed == true )
+        {
+            LogDebug( ( "The other endpoint closed the connection." ) );
+        }
+        else
+        {
+            /* No data within the timeout. */
+            bytesReceived = 0;
+        }
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Loopback_Send( NetworkContext_t * pNetworkContext,
+                       const void * pBuffer,
+                       size_t bytesToSend )
+{
+    int32_t bytesSent = -1;
+    LoopbackRing_t * pRing = NULL;
+    uint64_t deadlineUs = 0U;
+    size_t writableLength = 0U;
+    bool closed = false;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pSendRing == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is not connected." ) );
+    }
+    else if( ( pBuffer == NULL ) || ( bytesToSend == 0U ) )
+    {
+        LogError( ( "Parameter check failed: pBuffer must not be NULL and "
+                    "bytesToSend must be greater than 0." ) );
+    }
+    else
+    {
+        pRing = pNetworkContext->pSendRing;
+        deadlineUs = Clock_GetTimeUs() + ( ( uint64_t ) pNetworkContext->sendTimeoutMs * ONE_MS_TO_US );
+
+        do
+        {
+            closed = __atomic_load_n( &pRing->closed, __ATOMIC_ACQUIRE );
+            writableLength = getWritableLength( pRing );
+
+            if( ( closed == true ) || ( writableLength > 0U ) )
+            {
+                break;
+            }
+        } while( waitUntil( deadlineUs ) == true );
+
+        if( closed == true )
+        {
+            LogError( ( "Failed to send: The connection is closed." ) );
+        }
+        else if( writableLength == 0U )
+        {
+            /* The ring stayed full for the timeout. */
+            bytesSent = 0;
+        }
+        else
+        {
+            if( writableLength > bytesToSend )
+            {
+                writableLength = bytesToSend;
+            }
+
+            if( writableLength > ( size_t ) INT32_MAX )
+            {
+                writableLength = ( size_t ) INT32_MAX;
+            }
+
+            writeRing( pRing, pBuffer, writableLength );
+            bytesSent = ( int32_t ) writableLength;
+
+            if( pNetworkContext->peerCallback != NULL )
+            {
+                pNetworkContext->peerCallback( pNetworkContext->pPeerEndpoint,
+                                               pNetworkContext->pPeerContext );
+            }
+        }
+    }
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+void Loopback_RunScript( NetworkContext_t * pPeerEndpoint,
+                         void * pPeerContext )
+{
+    LoopbackScript_t * pScript = pPeerContext;
+    const LoopbackScriptStep_t * pStep = NULL;
+    uint8_t buffer[ LOOPBACK_SCRIPT_BUFFER_LENGTH ];
+    size_t bytesToRecv = 0U;
+    size_t responseSent = 0U;
+    int32_t result = 0;
+    bool keepRunning = true;
+
+    if( ( pPeerEndpoint == NULL ) || ( pScript == NULL ) ||
+        ( ( pScript->pSteps == NULL ) && ( pScript->stepCount != 0U ) ) )
+    {
+        LogError( ( "Parameter check failed: pPeerEndpoint and pPeerContext "
+                    "must not be NULL." ) );
+        keepRunning = false;
+    }
+
+    while( keepRunning == true )
+    {
+        if( pScript->currentStep == pScript->stepCount )
+        {
+            /* The script is over. Drop whatever else is sent. */
+            keepRunning = ( Loopback_Recv( pPeerEndpoint, buffer, sizeof( buffer ) ) > 0 );
+        }
+        else if( pScript->receivedLength < pScript->pSteps[ pScript->currentStep ].expectedLength )
+        {
+            bytesToRecv = pScript->pSteps[ pScript->currentStep ].expectedLength -
+                          pScript->receivedLength;
+
+            if( bytesToRecv > sizeof( buffer ) )
+            {
+                bytesToRecv = sizeof( buffer );
+            }
+
+            result = Loopback_Recv( pPeerEndpoint, buffer, bytesToRecv );
+
+            if( result > 0 )
+            {
+                pScript->receivedLength += ( size_t ) result;
+            }
+            else
+            {
+                /* Wait for the next send. */
+                keepRunning = false;
+            }
+        }
+        else
+        {
+            pStep = &pScript->pSteps[ pScript->currentStep ];
+            responseSent = 0U;
+            result = 1;
+
+            while( ( pStep->pResponse != NULL ) &&
+                   ( responseSent < pStep->responseLength ) && ( result > 0 ) )
+            {
+                result = Loopback_Send( pPeerEndpoint,
+                                        &pStep->pResponse[ responseSent ],
+                                        pStep->responseLength - responseSent );
+
+                if( result > 0 )
+                {
+                    responseSent += ( size_t ) result;
+                }
+            }
+
+            if( result <= 0 )
+            {
+                LogError( ( "Failed to send the response of script step %lu: "
+                            "Sent %lu of %lu bytes.",
+                            ( unsigned long ) pScript->currentStep,
+                            ( unsigned long ) responseSent,
+                            ( unsigned long ) pStep->responseLength ) );
+            }
+
+            pScript->receivedLength = 0U;
+
+            if( ( pScript->repeatLastStep == false ) ||
+                ( ( pScript->currentStep + 1U ) < pScript->stepCount ) )
+            {
+                pScript->currentStep++;
+            }
+            else if( pStep->expectedLength == 0U )
+            {
+                /* A repeated step that needs no data answers once per send. */
+                keepRunning = false;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+    }
+}
+/*-----------------------------------------------------------*/
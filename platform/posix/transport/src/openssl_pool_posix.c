@@ -0,0 +1,589 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <poll.h>
+
+#include "openssl_pool_posix.h"
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Nanoseconds per millisecond.
+ */
+#define ONE_MS_TO_NS     ( 1000000U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the server in the pool, or add it to a free slot.
+ *
+ * Must be called with the mutex of the pool locked.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pServerInfo The server.
+ *
+ * @return Index of the server in #OpensslPool_t.hosts; -1 if the server is not
+ * in the pool and every slot is in use.
+ */
+static int32_t findHost( OpensslPool_t * pPool,
+                         const ServerInfo_t * pServerInfo );
+
+/**
+ * @brief Find the pool connection of a network context.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return The connection; NULL if the network context is not a checked out
+ * connection of the pool.
+ */
+static OpensslPoolConnection_t * findConnection( OpensslPool_t * pPool,
+                                                 const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Remove the connections that have been idle for longer than the idle
+ * timeout from the idle lists.
+ *
+ * Must be called with the mutex of the pool locked.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] evictAll Whether to remove every idle connection.
+ *
+ * @return The removed connections, linked by #OpensslPoolConnection_t.pNextIdle.
+ */
+static OpensslPoolConnection_t * removeIdleConnections( OpensslPool_t * pPool,
+                                                        bool evictAll );
+
+/**
+ * @brief Free the slot of a connection that is not in an idle list.
+ *
+ * Must be called with the mutex of the pool locked.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pConnection The connection.
+ */
+static void releaseConnection( OpensslPool_t * pPool,
+                               OpensslPoolConnection_t * pConnection );
+
+/**
+ * @brief Disconnect connections and free their slots.
+ *
+ * Must be called with the mutex of the pool unlocked, so that other threads
+ * can use the pool while the connections are shut down.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pConnections Connections linked by #OpensslPoolConnection_t.pNextIdle.
+ */
+static void closeConnections( OpensslPool_t * pPool,
+                              OpensslPoolConnection_t * pConnections );
+
+/**
+ * @brief Check that an idle connection can be reused.
+ *
+ * An idle connection should have nothing to read. Records that arrived while
+ * it was idle are processed without blocking, which keeps a connection that
+ * only received TLS 1.3 session tickets and closes one that received a
+ * close_notify alert, data or the end of the stream.
+ *
+ * @param[in] pNetworkContext The connection.
+ *
+ * @return true if the connection can be reused; false otherwise.
+ */
+static bool isConnectionHealthy( const NetworkContext_t * pNetworkContext );
+
+/*-----------------------------------------------------------*/
+
+static int32_t findHost( OpensslPool_t * pPool,
+                         const ServerInfo_t * pServerInfo )
+{
+    int32_t hostIndex = -1;
+    int32_t freeIndex = -1;
+    size_t i = 0U;
+    OpensslPoolHost_t * pHost = NULL;
+
+    for( i = 0U; ( i < OPENSSL_POOL_MAX_HOSTS ) && ( hostIndex < 0 ); i++ )
+    {
+        pHost = &pPool->hosts[ i ];
+
+        if( ( pHost->connectionCount > 0U ) &&
+            ( pHost->port == pServerInfo->port ) &&
+            ( pHost->hostNameLength == pServerInfo->hostNameLength ) &&
+            ( memcmp( pHost->hostName, pServerInfo->pHostName, pHost->hostNameLength ) == 0 ) )
+        {
+            hostIndex = ( int32_t ) i;
+        }
+        else if( ( pHost->connectionCount == 0U ) && ( freeIndex < 0 ) )
+        {
+            freeIndex = ( int32_t ) i;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    /* A server without connections gives up its slot. */
+    if( ( hostIndex < 0 ) && ( freeIndex >= 0 ) )
+    {
+        hostIndex = freeIndex;
+        pHost = &pPool->hosts[ hostIndex ];
+        ( void ) memcpy( pHost->hostName, pServerInfo->pHostName, pServerInfo->hostNameLength );
+        pHost->hostName[ pServerInfo->hostNameLength ] = '\0';
+        pHost->hostNameLength = pServerInfo->hostNameLength;
+        pHost->port = pServerInfo->port;
+        pHost->pIdleHead = NULL;
+    }
+
+    return hostIndex;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslPoolConnection_t * findConnection( OpensslPool_t * pPool,
+                                                 const NetworkContext_t * pNetworkContext )
+{
+    OpensslPoolConnection_t * pConnection = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; ( i < OPENSSL_POOL_MAX_CONNECTIONS ) && ( pConnection == NULL ); i++ )
+    {
+        if( ( &pPool->connections[ i ].networkContext == pNetworkContext ) &&
+            ( pPool->connections[ i ].checkedOut == true ) )
+        {
+            pConnection = &pPool->connections[ i ];
+        }
+    }
+
+    return pConnection;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslPoolConnection_t * removeIdleConnections( OpensslPool_t * pPool,
+                                                        bool evictAll )
+{
+    OpensslPoolConnection_t * pRemoved = NULL;
+    OpensslPoolConnection_t ** ppLink = NULL;
+    OpensslPoolConnection_t * pConnection = NULL;
+    uint64_t nowMs = Clock_GetTimeNs() / ONE_MS_TO_NS;
+    size_t i = 0U;
+    bool expired = false;
+
+    for( i = 0U; i < OPENSSL_POOL_MAX_HOSTS; i++ )
+    {
+        ppLink = &pPool->hosts[ i ].pIdleHead;
+
+        while( *ppLink != NULL )
+        {
+            pConnection = *ppLink;
+            expired = ( evictAll == true ) ||
+                      ( ( pPool->idleTimeoutMs != 0U ) &&
+                        ( ( nowMs - pConnection->idleSinceMs ) >= pPool->idleTimeoutMs ) );
+
+            if( expired == true )
+            {
+                *ppLink = pConnection->pNextIdle;
+                pConnection->pNextIdle = pRemoved;
+                pRemoved = pConnection;
+            }
+            else
+            {
+                ppLink = &pConnection->pNextIdle;
+            }
+        }
+    }
+
+    return pRemoved;
+}
+/*-----------------------------------------------------------*/
+
+static void releaseConnection( OpensslPool_t * pPool,
+                               OpensslPoolConnection_t * pConnection )
+{
+    pPool->hosts[ pConnection->hostIndex ].connectionCount--;
+    pConnection->hostIndex = -1;
+    pConnection->pNextIdle = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void closeConnections( OpensslPool_t * pPool,
+                              OpensslPoolConnection_t * pConnections )
+{
+    OpensslPoolConnection_t * pConnection = pConnections;
+    OpensslPoolConnection_t * pNext = NULL;
+
+    while( pConnection != NULL )
+    {
+        ( void ) Openssl_Disconnect( &pConnection->networkContext );
+        pConnection = pConnection->pNextIdle;
+    }
+
+    if( pConnections != NULL )
+    {
+        ( void ) pthread_mutex_lock( &pPool->mutex );
+
+        for( pConnection = pConnections; pConnection != NULL; pConnection = pNext )
+        {
+            pNext = pConnection->pNextIdle;
+            releaseConnection( pPool, pConnection );
+        }
+
+        ( void ) pthread_mutex_unlock( &pPool->mutex );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static bool isConnectionHealthy( const NetworkContext_t * pNetworkContext )
+{
+    struct pollfd pollFd;
+    int32_t pollStatus = 0;
+    int32_t flags = 0;
+    int32_t sslStatus = 0;
+    uint8_t byte = 0U;
+    bool healthy = false;
+
+    pollFd.fd = pNetworkContext->socketDescriptor;
+    pollFd.events = POLLIN;
+    pollFd.revents = 0;
+
+    if( ( pNetworkContext->pReadAhead != NULL ) && ( pNetworkContext->pReadAhead->length > 0U ) )
+    {
+        LogDebug( ( "Idle connection has data of a previous response left." ) );
+    }
+    else if( SSL_pending( pNetworkContext->pSsl ) > 0 )
+    {
+        LogDebug( ( "Idle connection has decrypted data left." ) );
+    }
+    else
+    {
+        pollStatus = poll( &pollFd, 1, 0 );
+
+        if( pollStatus == 0 )
+        {
+            healthy = true;
+        }
+        else if( ( pollStatus > 0 ) &&
+                 ( ( pollFd.revents & ( POLLERR | POLLHUP | POLLNVAL ) ) == 0 ) )
+        {
+            flags = fcntl( pNetworkContext->socketDescriptor, F_GETFL );
+
+            if( ( flags >= 0 ) &&
+                ( fcntl( pNetworkContext->socketDescriptor, F_SETFL, flags | O_NONBLOCK ) == 0 ) )
+            {
+                sslStatus = SSL_peek( pNetworkContext->pSsl, &byte, 1 );
+
+                /* Only records without application data, such as session
+                 * tickets, leave OpenSSL waiting for more data. */
+                healthy = ( sslStatus <= 0 ) &&
+                          ( SSL_get_error( pNetworkContext->pSsl, sslStatus ) == SSL_ERROR_WANT_READ );
+
+                ( void ) fcntl( pNetworkContext->socketDescriptor, F_SETFL, flags );
+            }
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        if( healthy == false )
+        {
+            LogDebug( ( "Idle connection was closed by the server or received data." ) );
+        }
+    }
+
+    return healthy;
+}
+/*-----------------------------------------------------------*/
+
+OpensslPoolStatus_t OpensslPool_Init( OpensslPool_t * pPool,
+                                      uint32_t sendTimeoutMs,
+                                      uint32_t recvTimeoutMs,
+                                      uint32_t idleTimeoutMs )
+{
+    OpensslPoolStatus_t returnStatus = OPENSSL_POOL_SUCCESS;
+    size_t i = 0U;
+
+    if( pPool == NULL )
+    {
+        LogError( ( "Parameter check failed: pPool is NULL." ) );
+        returnStatus = OPENSSL_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pPool, 0, sizeof( OpensslPool_t ) );
+        pPool->sendTimeoutMs = sendTimeoutMs;
+        pPool->recvTimeoutMs = recvTimeoutMs;
+        pPool->idleTimeoutMs = idleTimeoutMs;
+
+        for( i = 0U; i < OPENSSL_POOL_MAX_CONNECTIONS; i++ )
+        {
+            pPool->connections[ i ].hostIndex = -1;
+        }
+
+        if( pthread_mutex_init( &pPool->mutex, NULL ) != 0 )
+        {
+            LogError( ( "Failed to initialize the connection pool mutex." ) );
+            returnStatus = OPENSSL_POOL_API_ERROR;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslPoolStatus_t OpensslPool_Checkout( OpensslPool_t * pPool,
+                                          const ServerInfo_t * pServerInfo,
+                                          const OpensslCredentials_t * pOpensslCredentials,
+                                          NetworkContext_t ** ppNetworkContext )
+{
+    OpensslPoolStatus_t returnStatus = OPENSSL_POOL_SUCCESS;
+    OpensslPoolConnection_t * pConnection = NULL;
+    OpensslPoolConnection_t * pExpired = NULL;
+    OpensslPoolHost_t * pHost = NULL;
+    int32_t hostIndex = -1;
+    size_t i = 0U;
+    bool searching = true;
+
+    if( ( pPool == NULL ) || ( pServerInfo == NULL ) ||
+        ( pOpensslCredentials == NULL ) || ( ppNetworkContext == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pPool, pServerInfo, "
+                    "pOpensslCredentials and ppNetworkContext must not be NULL." ) );
+        returnStatus = OPENSSL_POOL_INVALID_PARAMETER;
+    }
+    else if( ( pServerInfo->pHostName == NULL ) ||
+             ( pServerInfo->hostNameLength == 0U ) ||
+             ( pServerInfo->hostNameLength > OPENSSL_POOL_MAX_HOST_NAME_LENGTH ) )
+    {
+        LogError( ( "Parameter check failed: The host name must be between 1 and %u "
+                    "characters long.", ( unsigned int ) OPENSSL_POOL_MAX_HOST_NAME_LENGTH ) );
+        returnStatus = OPENSSL_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &pPool->mutex );
+        pExpired = removeIdleConnections( pPool, false );
+        ( void ) pthread_mutex_unlock( &pPool->mutex );
+        closeConnections( pPool, pExpired );
+
+        /* Reuse the most recently used idle connection that is healthy. */
+        while( searching == true )
+        {
+            ( void ) pthread_mutex_lock( &pPool->mutex );
+            hostIndex = findHost( pPool, pServerInfo );
+            pConnection = NULL;
+
+            if( hostIndex >= 0 )
+            {
+                pHost = &pPool->hosts[ hostIndex ];
+                pConnection = pHost->pIdleHead;
+
+                if( pConnection != NULL )
+                {
+                    pHost->pIdleHead = pConnection->pNextIdle;
+                    pConnection->pNextIdle = NULL;
+                }
+            }
+
+            ( void ) pthread_mutex_unlock( &pPool->mutex );
+
+            if( ( pConnection != NULL ) &&
+                ( isConnectionHealthy( &pConnection->networkContext ) == false ) )
+            {
+                closeConnections( pPool, pConnection );
+            }
+            else
+            {
+                searching = false;
+            }
+        }
+
+        if( pConnection != NULL )
+        {
+            LogDebug( ( "Reusing an idle connection to %.*s:%u.",
+                        ( int ) pServerInfo->hostNameLength,
+                        pServerInfo->pHostName,
+                        ( unsigned int ) pServerInfo->port ) );
+        }
+        else
+        {
+            /* Reserve a slot, then connect without holding the mutex. */
+            ( void ) pthread_mutex_lock( &pPool->mutex );
+            hostIndex = findHost( pPool, pServerInfo );
+
+            for( i = 0U; ( hostIndex >= 0 ) && ( i < OPENSSL_POOL_MAX_CONNECTIONS ); i++ )
+            {
+                if( pPool->connections[ i ].hostIndex < 0 )
+                {
+                    pConnection = &pPool->connections[ i ];
+                    pConnection->hostIndex = hostIndex;
+                    pPool->hosts[ hostIndex ].connectionCount++;
+                    break;
+                }
+            }
+
+            ( void ) pthread_mutex_unlock( &pPool->mutex );
+
+            if( pConnection == NULL )
+            {
+                LogError( ( "Failed to check out a connection: Every connection of "
+                            "the pool is in use." ) );
+                returnStatus = OPENSSL_POOL_NO_SPACE;
+            }
+            else
+            {
+                ( void ) memset( &pConnection->networkContext, 0, sizeof( NetworkContext_t ) );
+
+                if( Openssl_Connect( &pConnection->networkContext,
+                                     pServerInfo,
+                                     pOpensslCredentials,
+                                     pPool->sendTimeoutMs,
+                                     pPool->recvTimeoutMs ) != OPENSSL_SUCCESS )
+                {
+                    LogError( ( "Failed to connect to %.*s:%u.",
+                                ( int ) pServerInfo->hostNameLength,
+                                pServerInfo->pHostName,
+                                ( unsigned int ) pServerInfo->port ) );
+                    ( void ) pthread_mutex_lock( &pPool->mutex );
+                    releaseConnection( pPool, pConnection );
+                    ( void ) pthread_mutex_unlock( &pPool->mutex );
+                    pConnection = NULL;
+                    returnStatus = OPENSSL_POOL_CONNECT_FAILURE;
+                }
+            }
+        }
+
+        if( pConnection != NULL )
+        {
+            pConnection->checkedOut = true;
+            *ppNetworkContext = &pConnection->networkContext;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslPoolStatus_t OpensslPool_Checkin( OpensslPool_t * pPool,
+                                         NetworkContext_t * pNetworkContext,
+                                         bool keepAlive )
+{
+    OpensslPoolStatus_t returnStatus = OPENSSL_POOL_SUCCESS;
+    OpensslPoolConnection_t * pConnection = NULL;
+    OpensslPoolHost_t * pHost = NULL;
+
+    if( ( pPool == NULL ) || ( pNetworkContext == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pPool and pNetworkContext must not be NULL." ) );
+        returnStatus = OPENSSL_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        pConnection = findConnection( pPool, pNetworkContext );
+
+        if( pConnection == NULL )
+        {
+            LogError( ( "Parameter check failed: pNetworkContext was not checked "
+                        "out of this pool." ) );
+            returnStatus = OPENSSL_POOL_INVALID_PARAMETER;
+        }
+        else if( keepAlive == false )
+        {
+            pConnection->checkedOut = false;
+            closeConnections( pPool, pConnection );
+        }
+        else
+        {
+            ( void ) pthread_mutex_lock( &pPool->mutex );
+            pConnection->checkedOut = false;
+            pHost = &pPool->hosts[ pConnection->hostIndex ];
+            pConnection->idleSinceMs = Clock_GetTimeNs() / ONE_MS_TO_NS;
+            pConnection->pNextIdle = pHost->pIdleHead;
+            pHost->pIdleHead = pConnection;
+            ( void ) pthread_mutex_unlock( &pPool->mutex );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslPoolStatus_t OpensslPool_EvictIdle( OpensslPool_t * pPool )
+{
+    OpensslPoolStatus_t returnStatus = OPENSSL_POOL_SUCCESS;
+    OpensslPoolConnection_t * pExpired = NULL;
+
+    if( pPool == NULL )
+    {
+        LogError( ( "Parameter check failed: pPool is NULL." ) );
+        returnStatus = OPENSSL_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &pPool->mutex );
+        pExpired = removeIdleConnections( pPool, false );
+        ( void ) pthread_mutex_unlock( &pPool->mutex );
+        closeConnections( pPool, pExpired );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslPoolStatus_t OpensslPool_Cleanup( OpensslPool_t * pPool )
+{
+    OpensslPoolStatus_t returnStatus = OPENSSL_POOL_SUCCESS;
+    OpensslPoolConnection_t * pIdle = NULL;
+    size_t i = 0U;
+
+    if( pPool == NULL )
+    {
+        LogError( ( "Parameter check failed: pPool is NULL." ) );
+        returnStatus = OPENSSL_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &pPool->mutex );
+        pIdle = removeIdleConnections( pPool, true );
+        ( void ) pthread_mutex_unlock( &pPool->mutex );
+        closeConnections( pPool, pIdle );
+
+        for( i = 0U; i < OPENSSL_POOL_MAX_CONNECTIONS; i++ )
+        {
+            if( pPool->connections[ i ].hostIndex >= 0 )
+            {
+                LogWarn( ( "A connection is still checked out while the pool is "
+                           "cleaned up." ) );
+                break;
+            }
+        }
+
+        ( void ) pthread_mutex_destroy( &pPool->mutex );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
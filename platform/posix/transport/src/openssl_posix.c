@@ -22,6 +22,7 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <errno.h>
 #include <string.h>
 
 /* POSIX socket include. */
@@ -31,8 +32,19 @@
 #include "transport_interface.h"
 
 #include "openssl_posix.h"
+#include "clock.h"
+#include "trace_probes.h"
 #include <openssl/err.h>
 
+/* Hardware keys are loaded through providers from OpenSSL 3.0, and through
+ * engines before. */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    #include <openssl/provider.h>
+    #include <openssl/store.h>
+#else
+    #include <openssl/engine.h>
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -50,6 +62,12 @@
  */
 #define CLIENT_KEY_LABEL     "client's key"
 
+/**
+ * @brief The ASN.1 SEQUENCE tag that every DER encoded certificate and key
+ * starts with.
+ */
+#define DER_SEQUENCE_TAG     ( 0x30U )
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -100,6 +118,91 @@ static int32_t setClientCertificate( SSL_CTX * pSslContext,
 static int32_t setPrivateKey( SSL_CTX * pSslContext,
                               const char * pPrivateKeyPath );
 
+/**
+ * @brief Check whether a credential in memory is DER encoded rather than
+ * PEM encoded.
+ *
+ * @param[in] pCredential The credential.
+ * @param[in] credentialLength Length of @p pCredential.
+ *
+ * @return true if the credential starts with an ASN.1 SEQUENCE; false
+ * otherwise.
+ */
+static bool isDerEncoded( const uint8_t * pCredential,
+                          size_t credentialLength );
+
+/**
+ * @brief Add the X509 certificates in a buffer to the trusted list of root
+ * certificates.
+ *
+ * @param[out] pSslContext SSL context to which the trusted server root CAs are to be added.
+ * @param[in] pRootCa One DER certificate, or one or more PEM certificates.
+ * @param[in] rootCaLength Length of @p pRootCa.
+ *
+ * @return 1 on success; -1 on failure;
+ */
+static int32_t setRootCaFromBuffer( const SSL_CTX * pSslContext,
+                                    const uint8_t * pRootCa,
+                                    size_t rootCaLength );
+
+/**
+ * @brief Set the X509 certificate in a buffer as client certificate for the
+ * server to authenticate.
+ *
+ * @param[out] pSslContext SSL context to which the client certificate is to be set.
+ * @param[in] pClientCert One DER certificate, or a PEM certificate followed
+ * by its chain.
+ * @param[in] clientCertLength Length of @p pClientCert.
+ *
+ * @return 1 on success; -1, 0 on failure;
+ */
+static int32_t setClientCertificateFromBuffer( SSL_CTX * pSslContext,
+                                               const uint8_t * pClientCert,
+                                               size_t clientCertLength );
+
+/**
+ * @brief Set the private key in a buffer for the client's certificate.
+ *
+ * @param[out] pSslContext SSL context to which the private key is to be added.
+ * @param[in] pPrivateKey DER or PEM private key.
+ * @param[in] privateKeyLength Length of @p pPrivateKey.
+ *
+ * @return 1 on success; -1, 0 on failure;
+ */
+static int32_t setPrivateKeyFromBuffer( SSL_CTX * pSslContext,
+                                        const uint8_t * pPrivateKey,
+                                        size_t privateKeyLength );
+
+/**
+ * @brief Set the private key in a hardware token for the client's
+ * certificate, so that the handshake signature is computed by the token.
+ *
+ * @param[out] pSslContext SSL context to which the private key is to be added.
+ * @param[in] pPrivateKeyUri URI of the private key.
+ * @param[in] pKeyProvider Name of the provider or engine that loads the key;
+ * NULL to use the providers already loaded.
+ *
+ * @return 1 on success; -1, 0 on failure;
+ */
+static int32_t setPrivateKeyFromUri( SSL_CTX * pSslContext,
+                                     const char * pPrivateKeyUri,
+                                     const char * pKeyProvider );
+
+/**
+ * @brief Load a private key from a hardware token.
+ *
+ * With OpenSSL 3.0 or later, the key is loaded by URI through the store of
+ * the provider, which is loaded first if needed. With earlier versions, the
+ * URI is passed as key identifier to the engine.
+ *
+ * @param[in] pPrivateKeyUri URI of the private key.
+ * @param[in] pKeyProvider Name of the provider or engine that loads the key.
+ *
+ * @return The key; NULL on failure.
+ */
+static EVP_PKEY * loadPrivateKeyFromUri( const char * pPrivateKeyUri,
+                                         const char * pKeyProvider );
+
 /**
  * @brief Passes TLS credentials to the OpenSSL library.
  *
@@ -118,7 +221,8 @@ static int32_t setCredentials( SSL_CTX * pSslContext,
 /**
  * @brief Set optional configurations for the TLS connection.
  *
- * This function is used to set SNI, MFLN, and ALPN protocols.
+ * This function is used to set SNI, MFLN, ALPN protocols, and the cipher,
+ * group and version preferences.
  *
  * @param[in] pSsl SSL context to which the optional configurations are to be set.
  * @param[in] pOpensslCredentials TLS credentials containing configurations.
@@ -126,6 +230,179 @@ static int32_t setCredentials( SSL_CTX * pSslContext,
 static void setOptionalConfigurations( SSL * pSsl,
                                        const OpensslCredentials_t * pOpensslCredentials );
 
+/**
+ * @brief Create a new SSL context and import the credentials into it.
+ *
+ * @param[in] pOpensslCredentials TLS credentials to be imported.
+ * @param[out] ppSslContext The created SSL context. It is NULL on failure.
+ *
+ * @return #OPENSSL_SUCCESS on success;
+ * #OPENSSL_API_ERROR, #OPENSSL_INVALID_CREDENTIALS on failure.
+ */
+static OpensslStatus_t createSslContext( const OpensslCredentials_t * pOpensslCredentials,
+                                         SSL_CTX ** ppSslContext );
+
+/**
+ * @brief Take a reference to the SSL context of a shared TLS context.
+ *
+ * @param[in] pTlsContext The shared TLS context.
+ * @param[out] ppSslContext The referenced SSL context. It is NULL on failure.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_API_ERROR on failure.
+ */
+static OpensslStatus_t referenceSharedSslContext( OpensslTlsContext_t * pTlsContext,
+                                                  SSL_CTX ** ppSslContext );
+
+/**
+ * @brief Offer the session saved in the session store for resumption.
+ *
+ * Failing to load or restore a session is not an error; the handshake then
+ * falls back to a full handshake.
+ *
+ * @param[in] pSsl SSL object of the connection.
+ * @param[in] pSessionStore The session store of the server.
+ */
+static void setSavedSession( SSL * pSsl,
+                             const OpensslSessionStore_t * pSessionStore );
+
+/**
+ * @brief Callback invoked by OpenSSL when the server issues a new session. It
+ * serializes the session and passes it to the session store of the connection.
+ *
+ * @param[in] pSsl SSL object of the connection.
+ * @param[in] pSession The new session.
+ *
+ * @return 0 to indicate that no reference to @p pSession was kept.
+ */
+static int saveNewSession( SSL * pSsl,
+                           SSL_SESSION * pSession );
+
+/**
+ * @brief Receive data through the read-ahead buffer of a connection.
+ *
+ * The buffer is filled with one SSL_read when it is empty and nothing was
+ * received yet, as that read may block for the receive timeout. Once some data
+ * was received, it is only filled again from the data that OpenSSL already
+ * decrypted, as reported by SSL_pending, which does not block.
+ *
+ * @param[in] pSsl The SSL object of the connection.
+ * @param[in] pReadAhead The read-ahead buffer of the connection.
+ * @param[out] pBuffer Buffer to receive the data into.
+ * @param[in] bytesToRecv Number of bytes to receive.
+ *
+ * @return The number of bytes received if successful; the return value of
+ * SSL_read on failure.
+ */
+static int32_t recvReadAhead( SSL * pSsl,
+                              OpensslReadAhead_t * pReadAhead,
+                              uint8_t * pBuffer,
+                              size_t bytesToRecv );
+
+/**
+ * @brief Check whether the kernel encrypts the records sent on a connection.
+ *
+ * @param[in] pSsl The SSL object of the connection.
+ *
+ * @return true if kTLS is used for sending; false otherwise.
+ */
+static bool isKtlsSendEnabled( SSL * pSsl );
+
+/**
+ * @brief Send part of a file on a connection that uses kTLS for sending.
+ *
+ * @param[in] pSsl The SSL object of the connection.
+ * @param[in] fileDescriptor Descriptor of the file to send.
+ * @param[in] offset Offset in the file of the first byte to send.
+ * @param[in] bytesToSend Number of bytes to send, at most INT32_MAX.
+ *
+ * @return The number of bytes sent if successful; negative value on error.
+ */
+static int32_t sendFileWithKtls( SSL * pSsl,
+                                 int32_t fileDescriptor,
+                                 off_t offset,
+                                 size_t bytesToSend );
+
+/**
+ * @brief Check whether the handshake can be left to the first send, so that
+ * the sent bytes travel as TLS 1.3 early data.
+ *
+ * @param[in] pSsl The SSL object of the connection, with the saved session set.
+ * @param[in] pOpensslCredentials TLS credentials of the connection.
+ *
+ * @return true if early data is enabled and the session allows it; false otherwise.
+ */
+static bool canSendEarlyData( SSL * pSsl,
+                              const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Send the first bytes of a connection as early data and complete
+ * the handshake.
+ *
+ * @param[in] pSsl The SSL object of the connection.
+ * @param[in] pBuffer The bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return The number of bytes the server accepted as early data, which may
+ * be 0 when it rejected them; negative value if the handshake failed.
+ */
+static int32_t sendEarlyData( SSL * pSsl,
+                              const void * pBuffer,
+                              size_t bytesToSend );
+
+/**
+ * @brief Message callback that records when the certificate of the server is
+ * received and when it has been verified.
+ *
+ * OpenSSL verifies the certificate chain as soon as it is received, before
+ * it reads the next handshake message, so the time at which the next message
+ * is seen is used as the end of the verification.
+ *
+ * @param[in] isWrite Whether the message was sent rather than received.
+ * @param[in] version Unused.
+ * @param[in] contentType The record type of the message.
+ * @param[in] pBuffer The message.
+ * @param[in] length Length of the message.
+ * @param[in] pSsl Unused.
+ * @param[in] pArgument The #ConnectTiming_t of the connection.
+ */
+static void recordHandshakeTiming( int isWrite,
+                                   int version,
+                                   int contentType,
+                                   const void * pBuffer,
+                                   size_t length,
+                                   SSL * pSsl,
+                                   void * pArgument );
+
+#if ( TRANSPORT_STATS_ENABLED != 0 )
+
+/**
+ * @brief BIO callback that counts the reads and writes of the socket BIO of
+ * a connection, each of which is one system call.
+ *
+ * @param[in] pBio The socket BIO. Its callback argument is the
+ * #TransportStats_t of the connection.
+ * @param[in] operation The BIO operation and whether it is about to start or
+ * has returned.
+ * @param[in] pArgument Unused.
+ * @param[in] length Unused.
+ * @param[in] argumentInt Unused.
+ * @param[in] argumentLong Unused.
+ * @param[in] returnValue The result of the operation.
+ * @param[in] pProcessed Unused.
+ *
+ * @return @p returnValue, so that the result of the operation is kept.
+ */
+    static long countSystemCalls( BIO * pBio,
+                                  int operation,
+                                  const char * pArgument,
+                                  size_t length,
+                                  int argumentInt,
+                                  long argumentLong,
+                                  int returnValue,
+                                  size_t * pProcessed );
+
+#endif /* if ( TRANSPORT_STATS_ENABLED != 0 ) */
+
 /**
  * @brief Converts the sockets wrapper status to openssl status.
  *
@@ -355,191 +632,1091 @@ static int32_t setPrivateKey( SSL_CTX * pSslContext,
 }
 /*-----------------------------------------------------------*/
 
-static int32_t setCredentials( SSL_CTX * pSslContext,
-                               const OpensslCredentials_t * pOpensslCredentials )
+static bool isDerEncoded( const uint8_t * pCredential,
+                          size_t credentialLength )
 {
-    int32_t sslStatus = 0;
+    assert( pCredential != NULL );
+
+    return ( credentialLength > 0U ) && ( pCredential[ 0 ] == DER_SEQUENCE_TAG );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t setRootCaFromBuffer( const SSL_CTX * pSslContext,
+                                    const uint8_t * pRootCa,
+                                    size_t rootCaLength )
+{
+    int32_t sslStatus = 1;
+    BIO * pBio = NULL;
+    X509 * pRootCaCert = NULL;
+    X509_STORE * pCertStore = NULL;
+    const uint8_t * pDerData = pRootCa;
+    size_t certificateCount = 0U;
 
     assert( pSslContext != NULL );
-    assert( pOpensslCredentials != NULL );
+    assert( pRootCa != NULL );
 
-    if( pOpensslCredentials->pRootCaPath != NULL )
+    pCertStore = SSL_CTX_get_cert_store( pSslContext );
+
+    if( isDerEncoded( pRootCa, rootCaLength ) == true )
     {
-        sslStatus = setRootCa( pSslContext,
-                               pOpensslCredentials->pRootCaPath );
+        pRootCaCert = d2i_X509( NULL, &pDerData, ( long ) rootCaLength );
     }
+    else
+    {
+        pBio = BIO_new_mem_buf( pRootCa, ( int32_t ) rootCaLength );
 
-    if( ( sslStatus == 1 ) &&
-        ( pOpensslCredentials->pClientCertPath != NULL ) )
+        if( pBio != NULL )
+        {
+            pRootCaCert = PEM_read_bio_X509( pBio, NULL, NULL, NULL );
+        }
+    }
+
+    /* A PEM buffer may hold a bundle of root CAs, which are all trusted. */
+    while( ( pRootCaCert != NULL ) && ( sslStatus == 1 ) )
     {
-        sslStatus = setClientCertificate( pSslContext,
-                                          pOpensslCredentials->pClientCertPath );
+        sslStatus = X509_STORE_add_cert( pCertStore, pRootCaCert );
+        X509_free( pRootCaCert );
+        pRootCaCert = NULL;
+        certificateCount++;
+
+        if( ( sslStatus == 1 ) && ( pBio != NULL ) )
+        {
+            pRootCaCert = PEM_read_bio_X509( pBio, NULL, NULL, NULL );
+        }
     }
 
-    if( ( sslStatus == 1 ) &&
-        ( pOpensslCredentials->pPrivateKeyPath != NULL ) )
+    if( pBio != NULL )
     {
-        sslStatus = setPrivateKey( pSslContext,
-                                   pOpensslCredentials->pPrivateKeyPath );
+        ( void ) BIO_free( pBio );
+
+        /* Reading past the last certificate of the bundle queues an error. */
+        ERR_clear_error();
+    }
+
+    if( ( certificateCount == 0U ) || ( sslStatus != 1 ) )
+    {
+        LogError( ( "Failed to import the root CA from memory." ) );
+        sslStatus = -1;
+    }
+    else
+    {
+        LogDebug( ( "Successfully imported %u root CA certificates from memory.",
+                    ( unsigned int ) certificateCount ) );
     }
 
     return sslStatus;
 }
 /*-----------------------------------------------------------*/
 
-static void setOptionalConfigurations( SSL * pSsl,
-                                       const OpensslCredentials_t * pOpensslCredentials )
+static int32_t setClientCertificateFromBuffer( SSL_CTX * pSslContext,
+                                               const uint8_t * pClientCert,
+                                               size_t clientCertLength )
 {
     int32_t sslStatus = -1;
-    int16_t readBufferLength = 0;
+    BIO * pBio = NULL;
+    X509 * pCertificate = NULL;
+    const uint8_t * pDerData = pClientCert;
 
-    assert( pSsl != NULL );
-    assert( pOpensslCredentials != NULL );
+    assert( pSslContext != NULL );
+    assert( pClientCert != NULL );
 
-    /* Set TLS ALPN if requested. */
-    if( ( pOpensslCredentials->pAlpnProtos != NULL ) &&
-        ( pOpensslCredentials->alpnProtosLen > 0U ) )
+    if( isDerEncoded( pClientCert, clientCertLength ) == true )
     {
-        LogDebug( ( "Setting ALPN protos." ) );
-        sslStatus = SSL_set_alpn_protos( pSsl,
-                                         ( const uint8_t * ) pOpensslCredentials->pAlpnProtos,
-                                         ( uint32_t ) pOpensslCredentials->alpnProtosLen );
+        pCertificate = d2i_X509( NULL, &pDerData, ( long ) clientCertLength );
+    }
+    else
+    {
+        pBio = BIO_new_mem_buf( pClientCert, ( int32_t ) clientCertLength );
 
-        if( sslStatus != 0 )
+        if( pBio != NULL )
         {
-            LogError( ( "SSL_set_alpn_protos failed to set ALPN protos. %s",
-                        pOpensslCredentials->pAlpnProtos ) );
+            pCertificate = PEM_read_bio_X509( pBio, NULL, NULL, NULL );
         }
     }
 
-    /* Set TLS MFLN if requested. */
-    if( pOpensslCredentials->maxFragmentLength > 0U )
+    if( pCertificate != NULL )
     {
-        LogDebug( ( "Setting max send fragment length %u.",
-                    pOpensslCredentials->maxFragmentLength ) );
-
-        /* Set the maximum send fragment length. */
+        /* The context takes its own reference to the certificate. */
+        sslStatus = SSL_CTX_use_certificate( pSslContext, pCertificate );
+        X509_free( pCertificate );
+        pCertificate = NULL;
+    }
 
-        /* MISRA Directive 4.6 flags the following line for using basic
-         * numerical type long. This directive is suppressed because openssl
-         * function #SSL_set_max_send_fragment expects a length argument
-         * type of long. */
-        /* coverity[misra_c_2012_directive_4_6_violation] */
-        sslStatus = ( int32_t ) SSL_set_max_send_fragment( pSsl,
-                                                           ( long ) pOpensslCredentials->maxFragmentLength );
+    /* The certificates that follow a PEM client certificate form its chain. */
+    if( ( sslStatus == 1 ) && ( pBio != NULL ) )
+    {
+        pCertificate = PEM_read_bio_X509( pBio, NULL, NULL, NULL );
+    }
 
-        if( sslStatus != 1 )
+    while( pCertificate != NULL )
+    {
+        /* The context takes ownership of the chain certificate on success. */
+        if( SSL_CTX_add_extra_chain_cert( pSslContext, pCertificate ) != 1 )
         {
-            LogError( ( "Failed to set max send fragment length %u.",
-                        pOpensslCredentials->maxFragmentLength ) );
+            X509_free( pCertificate );
+            pCertificate = NULL;
+            sslStatus = -1;
         }
         else
         {
-            readBufferLength = ( int16_t ) pOpensslCredentials->maxFragmentLength +
-                               SSL3_RT_MAX_ENCRYPTED_OVERHEAD;
-
-            /* Change the size of the read buffer to match the
-             * maximum fragment length + some extra bytes for overhead. */
-            SSL_set_default_read_buffer_len( pSsl,
-                                             ( size_t ) readBufferLength );
+            pCertificate = PEM_read_bio_X509( pBio, NULL, NULL, NULL );
         }
     }
 
-    /* Enable SNI if requested. */
-    if( pOpensslCredentials->sniHostName != NULL )
+    if( pBio != NULL )
     {
-        LogDebug( ( "Setting server name %s for SNI.",
-                    pOpensslCredentials->sniHostName ) );
+        ( void ) BIO_free( pBio );
 
-        /* MISRA Rule 11.8 flags the following line for removing the const
-         * qualifier from the pointed to type. This rule is suppressed because
-         * openssl implementation of #SSL_set_tlsext_host_name internally casts
-         * the pointer to a string literal to a `void *` pointer. */
-        /* coverity[misra_c_2012_rule_11_8_violation] */
-        sslStatus = ( int32_t ) SSL_set_tlsext_host_name( pSsl,
-                                                          pOpensslCredentials->sniHostName );
+        /* Reading past the last certificate of the chain queues an error. */
+        ERR_clear_error();
+    }
 
-        if( sslStatus != 1 )
-        {
-            LogError( ( "Failed to set server name %s for SNI.",
-                        pOpensslCredentials->sniHostName ) );
-        }
+    if( sslStatus != 1 )
+    {
+        LogError( ( "Failed to import the client certificate from memory." ) );
+    }
+    else
+    {
+        LogDebug( ( "Successfully imported client certificate from memory." ) );
     }
+
+    return sslStatus;
 }
 /*-----------------------------------------------------------*/
 
-OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
-                                 const ServerInfo_t * pServerInfo,
-                                 const OpensslCredentials_t * pOpensslCredentials,
-                                 uint32_t sendTimeoutMs,
-                                 uint32_t recvTimeoutMs )
+static int32_t setPrivateKeyFromBuffer( SSL_CTX * pSslContext,
+                                        const uint8_t * pPrivateKey,
+                                        size_t privateKeyLength )
 {
-    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
-    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
-    int32_t sslStatus = 0;
-    uint8_t sslObjectCreated = 0;
-    SSL_CTX * pSslContext = NULL;
-    int32_t verifyPeerCertStatus = X509_V_OK;
+    int32_t sslStatus = -1;
+    BIO * pBio = NULL;
+    EVP_PKEY * pKey = NULL;
+    const uint8_t * pDerData = pPrivateKey;
 
-    /* Validate parameters. */
-    if( pNetworkContext == NULL )
-    {
-        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
-        returnStatus = OPENSSL_INVALID_PARAMETER;
-    }
-    else if( pOpensslCredentials == NULL )
+    assert( pSslContext != NULL );
+    assert( pPrivateKey != NULL );
+
+    if( isDerEncoded( pPrivateKey, privateKeyLength ) == true )
     {
-        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
-        returnStatus = OPENSSL_INVALID_PARAMETER;
+        pKey = d2i_AutoPrivateKey( NULL, &pDerData, ( long ) privateKeyLength );
     }
     else
     {
-        /* Empty else. */
+        pBio = BIO_new_mem_buf( pPrivateKey, ( int32_t ) privateKeyLength );
+
+        if( pBio != NULL )
+        {
+            pKey = PEM_read_bio_PrivateKey( pBio, NULL, NULL, NULL );
+            ( void ) BIO_free( pBio );
+        }
     }
 
-    /* Establish the TCP connection. */
-    if( returnStatus == OPENSSL_SUCCESS )
+    if( pKey != NULL )
     {
-        socketStatus = Sockets_Connect( &pNetworkContext->socketDescriptor,
-                                        pServerInfo,
-                                        sendTimeoutMs,
-                                        recvTimeoutMs );
-
-        /* Convert socket wrapper status to openssl status. */
-        returnStatus = convertToOpensslStatus( socketStatus );
+        /* The context takes its own reference to the key. */
+        sslStatus = SSL_CTX_use_PrivateKey( pSslContext, pKey );
+        EVP_PKEY_free( pKey );
     }
 
-    /* Create SSL context. */
-    if( returnStatus == OPENSSL_SUCCESS )
+    if( sslStatus != 1 )
+    {
+        LogError( ( "Failed to import the client certificate private key from memory." ) );
+    }
+    else
     {
-        pSslContext = SSL_CTX_new( TLS_client_method() );
+        LogDebug( ( "Successfully imported client certificate private key from memory." ) );
+    }
+
+    return sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
 
-        if( pSslContext == NULL )
+    static EVP_PKEY * loadPrivateKeyFromUri( const char * pPrivateKeyUri,
+                                             const char * pKeyProvider )
+    {
+        EVP_PKEY * pKey = NULL;
+        OSSL_STORE_CTX * pStore = NULL;
+        OSSL_STORE_INFO * pInfo = NULL;
+        bool providerLoaded = true;
+
+        assert( pPrivateKeyUri != NULL );
+
+        /* Providers stay loaded for the life of the process, as the keys they
+         * load are used by every connection. Loading a provider explicitly
+         * stops OpenSSL from loading the default provider on first use, so it
+         * is loaded as well. */
+        if( ( pKeyProvider != NULL ) && ( OSSL_PROVIDER_available( NULL, pKeyProvider ) != 1 ) )
         {
-            LogError( ( "Creation of a new SSL_CTX object failed." ) );
-            returnStatus = OPENSSL_API_ERROR;
+            if( ( OSSL_PROVIDER_load( NULL, pKeyProvider ) == NULL ) ||
+                ( ( OSSL_PROVIDER_available( NULL, "default" ) != 1 ) &&
+                  ( OSSL_PROVIDER_load( NULL, "default" ) == NULL ) ) )
+            {
+                LogError( ( "OSSL_PROVIDER_load failed to load provider %s.",
+                            pKeyProvider ) );
+                providerLoaded = false;
+            }
         }
-    }
 
-    /* Setup credentials. */
+        if( providerLoaded == true )
+        {
+            pStore = OSSL_STORE_open( pPrivateKeyUri, NULL, NULL, NULL, NULL );
+
+            if( pStore == NULL )
+            {
+                LogError( ( "OSSL_STORE_open failed to open %s.", pPrivateKeyUri ) );
+            }
+            else if( OSSL_STORE_expect( pStore, OSSL_STORE_INFO_PKEY ) != 1 )
+            {
+                LogError( ( "OSSL_STORE_expect failed to select private keys." ) );
+            }
+            else
+            {
+                /* Take the first private key of the URI. */
+                while( ( pKey == NULL ) && ( OSSL_STORE_eof( pStore ) != 1 ) &&
+                       ( OSSL_STORE_error( pStore ) != 1 ) )
+                {
+                    pInfo = OSSL_STORE_load( pStore );
+
+                    if( pInfo != NULL )
+                    {
+                        pKey = OSSL_STORE_INFO_get1_PKEY( pInfo );
+                        OSSL_STORE_INFO_free( pInfo );
+                    }
+                }
+            }
+
+            if( pStore != NULL )
+            {
+                ( void ) OSSL_STORE_close( pStore );
+            }
+        }
+
+        return pKey;
+    }
+
+#else /* if OPENSSL_VERSION_NUMBER >= 0x30000000L */
+
+    static EVP_PKEY * loadPrivateKeyFromUri( const char * pPrivateKeyUri,
+                                             const char * pKeyProvider )
+    {
+        EVP_PKEY * pKey = NULL;
+        ENGINE * pEngine = NULL;
+
+        assert( pPrivateKeyUri != NULL );
+
+        if( pKeyProvider == NULL )
+        {
+            LogError( ( "An engine is required to load a private key by URI." ) );
+        }
+        else
+        {
+            ENGINE_load_builtin_engines();
+            pEngine = ENGINE_by_id( pKeyProvider );
+        }
+
+        if( ( pEngine != NULL ) && ( ENGINE_init( pEngine ) == 1 ) )
+        {
+            /* The key keeps its own reference to the engine. */
+            pKey = ENGINE_load_private_key( pEngine, pPrivateKeyUri, NULL, NULL );
+            ( void ) ENGINE_finish( pEngine );
+        }
+        else if( pEngine != NULL )
+        {
+            LogError( ( "ENGINE_init failed to initialize engine %s.", pKeyProvider ) );
+        }
+        else
+        {
+            /* Empty else. */
+        }
+
+        if( pEngine != NULL )
+        {
+            ( void ) ENGINE_free( pEngine );
+        }
+
+        return pKey;
+    }
+
+#endif /* if OPENSSL_VERSION_NUMBER >= 0x30000000L */
+/*-----------------------------------------------------------*/
+
+static int32_t setPrivateKeyFromUri( SSL_CTX * pSslContext,
+                                     const char * pPrivateKeyUri,
+                                     const char * pKeyProvider )
+{
+    int32_t sslStatus = -1;
+    EVP_PKEY * pKey = NULL;
+
+    assert( pSslContext != NULL );
+    assert( pPrivateKeyUri != NULL );
+
+    pKey = loadPrivateKeyFromUri( pPrivateKeyUri, pKeyProvider );
+
+    if( pKey != NULL )
+    {
+        /* The context takes its own reference to the key. */
+        sslStatus = SSL_CTX_use_PrivateKey( pSslContext, pKey );
+        EVP_PKEY_free( pKey );
+    }
+
+    if( sslStatus != 1 )
+    {
+        LogError( ( "Failed to import the client certificate private key at %s.",
+                    pPrivateKeyUri ) );
+    }
+    else
+    {
+        LogDebug( ( "Successfully imported client certificate private key at %s.",
+                    pPrivateKeyUri ) );
+    }
+
+    return sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t setCredentials( SSL_CTX * pSslContext,
+                               const OpensslCredentials_t * pOpensslCredentials )
+{
+    int32_t sslStatus = 0;
+
+    assert( pSslContext != NULL );
+    assert( pOpensslCredentials != NULL );
+
+    /* A credential in memory is used instead of the file of the same
+     * credential. */
+    if( pOpensslCredentials->pRootCa != NULL )
+    {
+        sslStatus = setRootCaFromBuffer( pSslContext,
+                                         pOpensslCredentials->pRootCa,
+                                         pOpensslCredentials->rootCaLength );
+    }
+    else if( pOpensslCredentials->pRootCaPath != NULL )
+    {
+        sslStatus = setRootCa( pSslContext,
+                               pOpensslCredentials->pRootCaPath );
+    }
+    else
+    {
+        /* Empty else. A root CA is required. */
+    }
+
+    if( ( sslStatus == 1 ) &&
+        ( pOpensslCredentials->pClientCert != NULL ) )
+    {
+        sslStatus = setClientCertificateFromBuffer( pSslContext,
+                                                    pOpensslCredentials->pClientCert,
+                                                    pOpensslCredentials->clientCertLength );
+    }
+    else if( ( sslStatus == 1 ) &&
+             ( pOpensslCredentials->pClientCertPath != NULL ) )
+    {
+        sslStatus = setClientCertificate( pSslContext,
+                                          pOpensslCredentials->pClientCertPath );
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    if( ( sslStatus == 1 ) &&
+        ( pOpensslCredentials->pPrivateKeyUri != NULL ) )
+    {
+        sslStatus = setPrivateKeyFromUri( pSslContext,
+                                          pOpensslCredentials->pPrivateKeyUri,
+                                          pOpensslCredentials->pKeyProvider );
+    }
+    else if( ( sslStatus == 1 ) &&
+             ( pOpensslCredentials->pPrivateKey != NULL ) )
+    {
+        sslStatus = setPrivateKeyFromBuffer( pSslContext,
+                                             pOpensslCredentials->pPrivateKey,
+                                             pOpensslCredentials->privateKeyLength );
+    }
+    else if( ( sslStatus == 1 ) &&
+             ( pOpensslCredentials->pPrivateKeyPath != NULL ) )
+    {
+        sslStatus = setPrivateKey( pSslContext,
+                                   pOpensslCredentials->pPrivateKeyPath );
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    return sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void setOptionalConfigurations( SSL * pSsl,
+                                       const OpensslCredentials_t * pOpensslCredentials )
+{
+    int32_t sslStatus = -1;
+    int16_t readBufferLength = 0;
+
+    assert( pSsl != NULL );
+    assert( pOpensslCredentials != NULL );
+
+    /* Set TLS ALPN if requested. */
+    if( ( pOpensslCredentials->pAlpnProtos != NULL ) &&
+        ( pOpensslCredentials->alpnProtosLen > 0U ) )
+    {
+        LogDebug( ( "Setting ALPN protos." ) );
+        sslStatus = SSL_set_alpn_protos( pSsl,
+                                         ( const uint8_t * ) pOpensslCredentials->pAlpnProtos,
+                                         ( uint32_t ) pOpensslCredentials->alpnProtosLen );
+
+        if( sslStatus != 0 )
+        {
+            LogError( ( "SSL_set_alpn_protos failed to set ALPN protos. %s",
+                        pOpensslCredentials->pAlpnProtos ) );
+        }
+    }
+
+    /* Set TLS MFLN if requested. */
+    if( pOpensslCredentials->maxFragmentLength > 0U )
+    {
+        LogDebug( ( "Setting max send fragment length %u.",
+                    pOpensslCredentials->maxFragmentLength ) );
+
+        /* Set the maximum send fragment length. */
+
+        /* MISRA Directive 4.6 flags the following line for using basic
+         * numerical type long. This directive is suppressed because openssl
+         * function #SSL_set_max_send_fragment expects a length argument
+         * type of long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        sslStatus = ( int32_t ) SSL_set_max_send_fragment( pSsl,
+                                                           ( long ) pOpensslCredentials->maxFragmentLength );
+
+        if( sslStatus != 1 )
+        {
+            LogError( ( "Failed to set max send fragment length %u.",
+                        pOpensslCredentials->maxFragmentLength ) );
+        }
+        else
+        {
+            readBufferLength = ( int16_t ) pOpensslCredentials->maxFragmentLength +
+                               SSL3_RT_MAX_ENCRYPTED_OVERHEAD;
+
+            /* Change the size of the read buffer to match the
+             * maximum fragment length + some extra bytes for overhead. */
+            SSL_set_default_read_buffer_len( pSsl,
+                                             ( size_t ) readBufferLength );
+        }
+    }
+
+    /* Enable SNI if requested. */
+    if( pOpensslCredentials->sniHostName != NULL )
+    {
+        LogDebug( ( "Setting server name %s for SNI.",
+                    pOpensslCredentials->sniHostName ) );
+
+        /* MISRA Rule 11.8 flags the following line for removing the const
+         * qualifier from the pointed to type. This rule is suppressed because
+         * openssl implementation of #SSL_set_tlsext_host_name internally casts
+         * the pointer to a string literal to a `void *` pointer. */
+        /* coverity[misra_c_2012_rule_11_8_violation] */
+        sslStatus = ( int32_t ) SSL_set_tlsext_host_name( pSsl,
+                                                          pOpensslCredentials->sniHostName );
+
+        if( sslStatus != 1 )
+        {
+            LogError( ( "Failed to set server name %s for SNI.",
+                        pOpensslCredentials->sniHostName ) );
+        }
+    }
+
+    /* Set the cipher, group and version preferences if requested. */
+    if( pOpensslCredentials->pCipherList != NULL )
+    {
+        if( SSL_set_cipher_list( pSsl, pOpensslCredentials->pCipherList ) != 1 )
+        {
+            LogError( ( "Failed to set cipher list %s.",
+                        pOpensslCredentials->pCipherList ) );
+        }
+    }
+
+    if( pOpensslCredentials->pCipherSuites != NULL )
+    {
+        #ifdef TLS1_3_VERSION
+            if( SSL_set_ciphersuites( pSsl, pOpensslCredentials->pCipherSuites ) != 1 )
+            {
+                LogError( ( "Failed to set TLS 1.3 cipher suites %s.",
+                            pOpensslCredentials->pCipherSuites ) );
+            }
+        #else
+            LogWarn( ( "TLS 1.3 cipher suites are not supported by this version of OpenSSL." ) );
+        #endif
+    }
+
+    if( pOpensslCredentials->pGroups != NULL )
+    {
+        /* MISRA Rule 11.8 flags the following line for removing the const
+         * qualifier from the pointed to type. This rule is suppressed because
+         * openssl implementation of #SSL_set1_groups_list internally casts
+         * the string to a `void *` pointer without modifying it. */
+        /* coverity[misra_c_2012_rule_11_8_violation] */
+        if( SSL_set1_groups_list( pSsl, pOpensslCredentials->pGroups ) != 1 )
+        {
+            LogError( ( "Failed to set groups %s.",
+                        pOpensslCredentials->pGroups ) );
+        }
+    }
+
+    if( pOpensslCredentials->minTlsVersion != 0U )
+    {
+        if( SSL_set_min_proto_version( pSsl, pOpensslCredentials->minTlsVersion ) != 1 )
+        {
+            LogError( ( "Failed to set minimum TLS version 0x%04x.",
+                        ( unsigned int ) pOpensslCredentials->minTlsVersion ) );
+        }
+    }
+
+    if( pOpensslCredentials->maxTlsVersion != 0U )
+    {
+        if( SSL_set_max_proto_version( pSsl, pOpensslCredentials->maxTlsVersion ) != 1 )
+        {
+            LogError( ( "Failed to set maximum TLS version 0x%04x.",
+                        ( unsigned int ) pOpensslCredentials->maxTlsVersion ) );
+        }
+    }
+
+    /* Let the kernel encrypt the records if requested. The option has to be
+     * set before the handshake, and OpenSSL silently keeps encrypting in
+     * user space when the kernel or the cipher does not support kTLS. */
+    if( pOpensslCredentials->enableKtls == true )
+    {
+        #ifdef SSL_OP_ENABLE_KTLS
+            LogDebug( ( "Enabling kernel TLS." ) );
+            ( void ) SSL_set_options( pSsl, SSL_OP_ENABLE_KTLS );
+        #else
+            LogWarn( ( "Kernel TLS is not supported by this version of OpenSSL." ) );
+        #endif
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void setSavedSession( SSL * pSsl,
+                             const OpensslSessionStore_t * pSessionStore )
+{
+    uint8_t sessionBuffer[ OPENSSL_MAX_SESSION_LENGTH ];
+    const uint8_t * pSessionData = sessionBuffer;
+    size_t sessionLength = 0U;
+    SSL_SESSION * pSession = NULL;
+
+    assert( pSsl != NULL );
+    assert( pSessionStore != NULL );
+
+    /* New sessions are reported to the store of this connection. */
+    ( void ) SSL_set_app_data( pSsl, ( void * ) pSessionStore );
+
+    if( pSessionStore->load != NULL )
+    {
+        sessionLength = pSessionStore->load( pSessionStore->pStoreContext,
+                                             sessionBuffer,
+                                             sizeof( sessionBuffer ) );
+    }
+
+    if( ( sessionLength > 0U ) && ( sessionLength <= sizeof( sessionBuffer ) ) )
+    {
+        /* MISRA Directive 4.6 flags the following line for using basic
+         * numerical type long. This directive is suppressed because openssl
+         * function #d2i_SSL_SESSION takes a length argument of type long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        pSession = d2i_SSL_SESSION( NULL, &pSessionData, ( long ) sessionLength );
+    }
+
+    if( pSession != NULL )
+    {
+        if( SSL_set_session( pSsl, pSession ) != 1 )
+        {
+            LogWarn( ( "Failed to offer the saved TLS session. "
+                       "Performing a full handshake." ) );
+        }
+        else
+        {
+            LogDebug( ( "Offering the saved TLS session for resumption." ) );
+        }
+
+        /* The SSL object keeps its own reference to the session. */
+        SSL_SESSION_free( pSession );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static int saveNewSession( SSL * pSsl,
+                           SSL_SESSION * pSession )
+{
+    uint8_t sessionBuffer[ OPENSSL_MAX_SESSION_LENGTH ];
+    uint8_t * pSessionData = sessionBuffer;
+    const OpensslSessionStore_t * pSessionStore = NULL;
+    int32_t sessionLength = 0;
+
+    pSessionStore = ( const OpensslSessionStore_t * ) SSL_get_app_data( pSsl );
+
+    if( ( pSessionStore != NULL ) && ( pSessionStore->save != NULL ) )
+    {
+        sessionLength = i2d_SSL_SESSION( pSession, NULL );
+
+        if( ( sessionLength > 0 ) &&
+            ( ( size_t ) sessionLength <= sizeof( sessionBuffer ) ) )
+        {
+            sessionLength = i2d_SSL_SESSION( pSession, &pSessionData );
+        }
+        else
+        {
+            LogWarn( ( "The new TLS session is not saved: It requires %d bytes but "
+                       "OPENSSL_MAX_SESSION_LENGTH is %u.",
+                       ( int ) sessionLength,
+                       ( unsigned int ) OPENSSL_MAX_SESSION_LENGTH ) );
+            sessionLength = 0;
+        }
+    }
+
+    if( sessionLength > 0 )
+    {
+        LogDebug( ( "Saving new TLS session of %d bytes.", ( int ) sessionLength ) );
+        pSessionStore->save( pSessionStore->pStoreContext,
+                             sessionBuffer,
+                             ( size_t ) sessionLength );
+    }
+
+    /* The session was serialized, so OpenSSL keeps ownership of it. */
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t recvReadAhead( SSL * pSsl,
+                              OpensslReadAhead_t * pReadAhead,
+                              uint8_t * pBuffer,
+                              size_t bytesToRecv )
+{
+    int32_t sslStatus = 0;
+    size_t bytesCopied = 0U, copyLength = 0U;
+    bool stopReading = false;
+
+    assert( pSsl != NULL );
+    assert( pReadAhead != NULL );
+    assert( pReadAhead->pBuffer != NULL );
+
+    while( ( bytesCopied < bytesToRecv ) && ( stopReading == false ) )
+    {
+        if( pReadAhead->length == 0U )
+        {
+            if( ( bytesCopied == 0U ) || ( SSL_pending( pSsl ) > 0 ) )
+            {
+                sslStatus = ( int32_t ) SSL_read( pSsl,
+                                                  pReadAhead->pBuffer,
+                                                  ( int32_t ) pReadAhead->bufferSize );
+
+                if( sslStatus > 0 )
+                {
+                    pReadAhead->offset = 0U;
+                    pReadAhead->length = ( size_t ) sslStatus;
+                }
+                else
+                {
+                    stopReading = true;
+                }
+            }
+            else
+            {
+                stopReading = true;
+            }
+        }
+
+        copyLength = bytesToRecv - bytesCopied;
+
+        if( copyLength > pReadAhead->length )
+        {
+            copyLength = pReadAhead->length;
+        }
+
+        ( void ) memcpy( &pBuffer[ bytesCopied ],
+                         &pReadAhead->pBuffer[ pReadAhead->offset ],
+                         copyLength );
+        pReadAhead->offset += copyLength;
+        pReadAhead->length -= copyLength;
+        bytesCopied += copyLength;
+    }
+
+    return ( bytesCopied > 0U ) ? ( int32_t ) bytesCopied : sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+static bool isKtlsSendEnabled( SSL * pSsl )
+{
+    bool ktlsEnabled = false;
+
+    assert( pSsl != NULL );
+
+    #ifdef SSL_OP_ENABLE_KTLS
+        ktlsEnabled = ( BIO_get_ktls_send( SSL_get_wbio( pSsl ) ) != 0 ) ? true : false;
+    #else
+        ( void ) pSsl;
+    #endif
+
+    return ktlsEnabled;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t sendFileWithKtls( SSL * pSsl,
+                                 int32_t fileDescriptor,
+                                 off_t offset,
+                                 size_t bytesToSend )
+{
+    int32_t bytesSent = -1;
+    int32_t sslError = 0;
+
+    /* Unused parameter when logs are disabled. */
+    ( void ) sslError;
+
+    assert( pSsl != NULL );
+    assert( bytesToSend <= ( size_t ) INT32_MAX );
+
+    #ifdef SSL_OP_ENABLE_KTLS
+        bytesSent = ( int32_t ) SSL_sendfile( pSsl,
+                                              fileDescriptor,
+                                              offset,
+                                              bytesToSend,
+                                              0 );
+
+        if( bytesSent <= 0 )
+        {
+            sslError = SSL_get_error( pSsl, bytesSent );
+
+            LogErrorRateLimited( ( "Failed to send file over network: SSL_sendfile of OpenSSL failed: "
+                                   "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
+            bytesSent = ( bytesSent < 0 ) ? bytesSent : -1;
+        }
+    #else
+        ( void ) fileDescriptor;
+        ( void ) offset;
+        ( void ) bytesToSend;
+    #endif /* ifdef SSL_OP_ENABLE_KTLS */
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+#if ( TRANSPORT_STATS_ENABLED != 0 )
+
+    static long countSystemCalls( BIO * pBio,
+                                  int operation,
+                                  const char * pArgument,
+                                  size_t length,
+                                  int argumentInt,
+                                  long argumentLong,
+                                  int returnValue,
+                                  size_t * pProcessed )
+    {
+        TransportStats_t * pStats = ( TransportStats_t * ) BIO_get_callback_arg( pBio );
+
+        ( void ) pArgument;
+        ( void ) length;
+        ( void ) argumentInt;
+        ( void ) argumentLong;
+        ( void ) pProcessed;
+
+        if( ( pStats != NULL ) &&
+            ( ( operation == ( BIO_CB_READ | BIO_CB_RETURN ) ) ||
+              ( operation == ( BIO_CB_WRITE | BIO_CB_RETURN ) ) ) )
+        {
+            pStats->systemCalls++;
+        }
+
+        return ( long ) returnValue;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TRANSPORT_STATS_ENABLED != 0 ) */
+
+static bool canSendEarlyData( SSL * pSsl,
+                              const OpensslCredentials_t * pOpensslCredentials )
+{
+    bool canSend = false;
+
+    assert( pSsl != NULL );
+    assert( pOpensslCredentials != NULL );
+
+    /* Early data needs a saved session in which the server allowed it. */
+    if( pOpensslCredentials->enableEarlyData == true )
+    {
+        #ifdef SSL_EARLY_DATA_REJECTED
+            canSend = ( SSL_get_session( pSsl ) != NULL ) &&
+                      ( SSL_SESSION_get_max_early_data( SSL_get_session( pSsl ) ) > 0U );
+        #else
+            LogWarn( ( "TLS 1.3 early data is not supported by this version of OpenSSL." ) );
+        #endif
+    }
+
+    return canSend;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t sendEarlyData( SSL * pSsl,
+                              const void * pBuffer,
+                              size_t bytesToSend )
+{
+    int32_t earlyDataSent = -1;
+
+    #ifdef SSL_EARLY_DATA_REJECTED
+        size_t earlyDataLength = bytesToSend;
+        size_t written = 0U;
+        uint32_t maxEarlyData = 0U;
+
+        maxEarlyData = SSL_SESSION_get_max_early_data( SSL_get_session( pSsl ) );
+
+        if( earlyDataLength > maxEarlyData )
+        {
+            earlyDataLength = maxEarlyData;
+        }
+
+        /* The early data is sent with the ClientHello. When that fails, the
+         * handshake is completed without it. */
+        if( SSL_write_early_data( pSsl, pBuffer, earlyDataLength, &written ) != 1 )
+        {
+            LogWarn( ( "Failed to send early data. Sending the data after the handshake." ) );
+            written = 0U;
+        }
+
+        if( SSL_connect( pSsl ) != 1 )
+        {
+            LogError( ( "SSL_connect failed to perform TLS handshake." ) );
+        }
+        else if( SSL_get_verify_result( pSsl ) != X509_V_OK )
+        {
+            LogError( ( "SSL_get_verify_result failed to verify X509 "
+                        "certificate from peer." ) );
+        }
+        else
+        {
+            /* Rejected early data was discarded by the server and has to be
+             * sent again. */
+            if( SSL_get_early_data_status( pSsl ) != SSL_EARLY_DATA_ACCEPTED )
+            {
+                LogDebug( ( "The server rejected the early data." ) );
+                written = 0U;
+            }
+
+            LogDebug( ( "Established a TLS connection: SessionResumed=%d, EarlyData=%lu.",
+                        SSL_session_reused( pSsl ),
+                        ( unsigned long ) written ) );
+            earlyDataSent = ( int32_t ) written;
+        }
+    #else /* ifdef SSL_EARLY_DATA_REJECTED */
+        ( void ) pSsl;
+        ( void ) pBuffer;
+        ( void ) bytesToSend;
+    #endif /* ifdef SSL_EARLY_DATA_REJECTED */
+
+    return earlyDataSent;
+}
+/*-----------------------------------------------------------*/
+
+static void recordHandshakeTiming( int isWrite,
+                                   int version,
+                                   int contentType,
+                                   const void * pBuffer,
+                                   size_t length,
+                                   SSL * pSsl,
+                                   void * pArgument )
+{
+    ConnectTiming_t * pConnectTiming = ( ConnectTiming_t * ) pArgument;
+    uint8_t messageType = 0U;
+
+    ( void ) version;
+    ( void ) pSsl;
+
+    if( ( isWrite == 0 ) && ( contentType == SSL3_RT_HANDSHAKE ) && ( length > 0U ) )
+    {
+        messageType = ( ( const uint8_t * ) pBuffer )[ 0 ];
+
+        if( messageType == ( uint8_t ) SSL3_MT_CERTIFICATE )
+        {
+            pConnectTiming->tlsCertificateReceivedUs = Clock_GetTimeUs();
+        }
+        else if( ( pConnectTiming->tlsCertificateReceivedUs != 0U ) &&
+                 ( pConnectTiming->tlsCertificateVerifiedUs == 0U ) )
+        {
+            pConnectTiming->tlsCertificateVerifiedUs = Clock_GetTimeUs();
+        }
+        else
+        {
+            /* Empty else. */
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t createSslContext( const OpensslCredentials_t * pOpensslCredentials,
+                                         SSL_CTX ** ppSslContext )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    int32_t sslStatus = 0;
+    SSL_CTX * pSslContext = NULL;
+
+    assert( pOpensslCredentials != NULL );
+    assert( ppSslContext != NULL );
+
+    pSslContext = SSL_CTX_new( TLS_client_method() );
+
+    if( pSslContext == NULL )
+    {
+        LogError( ( "Creation of a new SSL_CTX object failed." ) );
+        returnStatus = OPENSSL_API_ERROR;
+    }
+
+    /* Setup credentials. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        /* Set auto retry mode for the blocking calls to SSL_read and SSL_write.
+         * The mask returned by SSL_CTX_set_mode does not need to be checked. */
+
+        /* MISRA Directive 4.6 flags the following line for using basic
+        * numerical type long. This directive is suppressed because openssl
+        * function #SSL_CTX_set_mode takes an argument of type long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        ( void ) SSL_CTX_set_mode( pSslContext, ( long ) SSL_MODE_AUTO_RETRY );
+
+        sslStatus = setCredentials( pSslContext,
+                                    pOpensslCredentials );
+
+        if( sslStatus != 1 )
+        {
+            LogError( ( "Setting up credentials failed." ) );
+            returnStatus = OPENSSL_INVALID_CREDENTIALS;
+        }
+    }
+
+    /* Report new sessions to the session store instead of keeping them in
+     * the internal cache, which is never used by a client. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) &&
+        ( pOpensslCredentials->pSessionStore != NULL ) )
+    {
+        /* MISRA Directive 4.6 flags the following line for using basic
+         * numerical type long. This directive is suppressed because openssl
+         * function #SSL_CTX_set_session_cache_mode takes an argument of type long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        ( void ) SSL_CTX_set_session_cache_mode( pSslContext,
+                                                 ( long ) ( SSL_SESS_CACHE_CLIENT |
+                                                            SSL_SESS_CACHE_NO_INTERNAL_STORE ) );
+        SSL_CTX_sess_set_new_cb( pSslContext, saveNewSession );
+    }
+
+    /* Hand the SSL context to the caller, who frees it in both cases. */
+    *ppSslContext = pSslContext;
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t referenceSharedSslContext( OpensslTlsContext_t * pTlsContext,
+                                                  SSL_CTX ** ppSslContext )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+    assert( pTlsContext != NULL );
+    assert( ppSslContext != NULL );
+
+    *ppSslContext = NULL;
+
+    /* The lock keeps a concurrent rotation from freeing the SSL context
+     * before the reference is taken. */
+    ( void ) pthread_mutex_lock( &pTlsContext->mutex );
+
+    if( ( pTlsContext->pSslContext != NULL ) &&
+        ( SSL_CTX_up_ref( pTlsContext->pSslContext ) == 1 ) )
+    {
+        *ppSslContext = pTlsContext->pSslContext;
+    }
+
+    ( void ) pthread_mutex_unlock( &pTlsContext->mutex );
+
+    if( *ppSslContext == NULL )
+    {
+        LogError( ( "The shared TLS context is not initialized." ) );
+        returnStatus = OPENSSL_API_ERROR;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
+                                 const ServerInfo_t * pServerInfo,
+                                 const OpensslCredentials_t * pOpensslCredentials,
+                                 uint32_t sendTimeoutMs,
+                                 uint32_t recvTimeoutMs )
+{
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    SocketsConfig_t socketsConfig;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    int32_t sslStatus = 0;
+    uint8_t sslObjectCreated = 0;
+    SSL_CTX * pSslContext = NULL;
+    int32_t verifyPeerCertStatus = X509_V_OK;
+
+    /* Validate parameters. */
+    if( pNetworkContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pOpensslCredentials == NULL )
+    {
+        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( ( pNetworkContext->pReadAhead != NULL ) &&
+             ( ( pNetworkContext->pReadAhead->pBuffer == NULL ) ||
+               ( pNetworkContext->pReadAhead->bufferSize == 0U ) ) )
+    {
+        LogError( ( "Parameter check failed: pReadAhead has no buffer." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    /* Discard data read ahead on a previous connection. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( pNetworkContext->pReadAhead != NULL ) )
+    {
+        pNetworkContext->pReadAhead->offset = 0U;
+        pNetworkContext->pReadAhead->length = 0U;
+    }
+
+    /* Establish the TCP connection. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        /* Set auto retry mode for the blocking calls to SSL_read and SSL_write.
-         * The mask returned by SSL_CTX_set_mode does not need to be checked. */
+        ( void ) memset( &socketsConfig, 0x00, sizeof( socketsConfig ) );
+        socketsConfig.sendTimeoutMs = sendTimeoutMs;
+        socketsConfig.recvTimeoutMs = recvTimeoutMs;
+        socketsConfig.pConnectTiming = pNetworkContext->pConnectTiming;
 
-        /* MISRA Directive 4.6 flags the following line for using basic
-        * numerical type long. This directive is suppressed because openssl
-        * function #SSL_CTX_set_mode takes an argument of type long. */
-        /* coverity[misra_c_2012_directive_4_6_violation] */
-        ( void ) SSL_CTX_set_mode( pSslContext, ( long ) SSL_MODE_AUTO_RETRY );
+        socketStatus = Sockets_ConnectWithConfig( &pNetworkContext->socketDescriptor,
+                                                  pServerInfo,
+                                                  &socketsConfig );
 
-        sslStatus = setCredentials( pSslContext,
-                                    pOpensslCredentials );
+        /* Convert socket wrapper status to openssl status. */
+        returnStatus = convertToOpensslStatus( socketStatus );
+    }
 
-        if( sslStatus != 1 )
+    /* Create the SSL context, or reference the shared one. The reference is
+     * released at the end of this function, as the SSL object keeps its own. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        if( pOpensslCredentials->pTlsContext != NULL )
         {
-            LogError( ( "Setting up credentials failed." ) );
-            returnStatus = OPENSSL_INVALID_CREDENTIALS;
+            returnStatus = referenceSharedSslContext( pOpensslCredentials->pTlsContext,
+                                                      &pSslContext );
+        }
+        else
+        {
+            returnStatus = createSslContext( pOpensslCredentials, &pSslContext );
         }
     }
 
@@ -574,22 +1751,73 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
         }
     }
 
+    #if ( TRANSPORT_STATS_ENABLED != 0 )
+        /* SSL_set_fd uses one socket BIO for reading and writing. */
+        if( ( returnStatus == OPENSSL_SUCCESS ) && ( pNetworkContext->pStats != NULL ) )
+        {
+            BIO_set_callback_arg( SSL_get_rbio( pNetworkContext->pSsl ),
+                                  ( char * ) pNetworkContext->pStats );
+            BIO_set_callback_ex( SSL_get_rbio( pNetworkContext->pSsl ), countSystemCalls );
+        }
+    #endif
+
     /* Perform the TLS handshake. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
         setOptionalConfigurations( pNetworkContext->pSsl, pOpensslCredentials );
 
-        sslStatus = SSL_connect( pNetworkContext->pSsl );
+        if( pOpensslCredentials->pSessionStore != NULL )
+        {
+            setSavedSession( pNetworkContext->pSsl, pOpensslCredentials->pSessionStore );
+        }
 
-        if( sslStatus != 1 )
+        /* With early data, the first send performs the handshake. */
+        pNetworkContext->earlyDataEnabled = canSendEarlyData( pNetworkContext->pSsl,
+                                                              pOpensslCredentials );
+
+        if( pNetworkContext->earlyDataEnabled == true )
         {
-            LogError( ( "SSL_connect failed to perform TLS handshake." ) );
-            returnStatus = OPENSSL_HANDSHAKE_FAILED;
+            SSL_set_connect_state( pNetworkContext->pSsl );
+        }
+        else
+        {
+            /* The times of a deferred handshake are not recorded, as it
+             * completes after this function returns. */
+            if( pNetworkContext->pConnectTiming != NULL )
+            {
+                SSL_set_msg_callback_arg( pNetworkContext->pSsl, pNetworkContext->pConnectTiming );
+                SSL_set_msg_callback( pNetworkContext->pSsl, recordHandshakeTiming );
+            }
+
+            TRACE_PROBE1( tls_handshake_start, pNetworkContext );
+            sslStatus = SSL_connect( pNetworkContext->pSsl );
+            TRACE_PROBE2( tls_handshake_end, pNetworkContext, sslStatus );
+
+            if( pNetworkContext->pConnectTiming != NULL )
+            {
+                SSL_set_msg_callback( pNetworkContext->pSsl, NULL );
+            }
+
+            if( sslStatus != 1 )
+            {
+                LogError( ( "SSL_connect failed to perform TLS handshake." ) );
+                returnStatus = OPENSSL_HANDSHAKE_FAILED;
+            }
+            else if( pNetworkContext->pConnectTiming != NULL )
+            {
+                pNetworkContext->pConnectTiming->tlsHandshakeDoneUs = Clock_GetTimeUs();
+                pNetworkContext->pConnectTiming->tlsSessionResumed =
+                    ( SSL_session_reused( pNetworkContext->pSsl ) == 1 );
+            }
+            else
+            {
+                /* Empty else. */
+            }
         }
     }
 
     /* Verify X509 certificate from peer. */
-    if( returnStatus == OPENSSL_SUCCESS )
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( pNetworkContext->earlyDataEnabled == false ) )
     {
         verifyPeerCertStatus = ( int32_t ) SSL_get_verify_result( pNetworkContext->pSsl );
 
@@ -619,9 +1847,123 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
     {
         LogError( ( "Failed to establish a TLS connection." ) );
     }
+    else if( pNetworkContext->earlyDataEnabled == true )
+    {
+        LogDebug( ( "Deferred the TLS handshake to send early data." ) );
+    }
+    else
+    {
+        LogDebug( ( "Established a TLS connection: SessionResumed=%d.",
+                    SSL_session_reused( pNetworkContext->pSsl ) ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_TlsContextInit( OpensslTlsContext_t * pTlsContext,
+                                        const OpensslCredentials_t * pOpensslCredentials )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+    if( ( pTlsContext == NULL ) || ( pOpensslCredentials == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pTlsContext=%p, pOpensslCredentials=%p.",
+                    ( void * ) pTlsContext,
+                    ( const void * ) pOpensslCredentials ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        pTlsContext->pSslContext = NULL;
+
+        if( pthread_mutex_init( &pTlsContext->mutex, NULL ) != 0 )
+        {
+            LogError( ( "Failed to initialize the TLS context mutex." ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+    }
+
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        returnStatus = Openssl_TlsContextRotate( pTlsContext, pOpensslCredentials );
+
+        if( returnStatus != OPENSSL_SUCCESS )
+        {
+            ( void ) pthread_mutex_destroy( &pTlsContext->mutex );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_TlsContextRotate( OpensslTlsContext_t * pTlsContext,
+                                          const OpensslCredentials_t * pOpensslCredentials )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    SSL_CTX * pNewSslContext = NULL, * pOldSslContext = NULL;
+
+    if( ( pTlsContext == NULL ) || ( pOpensslCredentials == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pTlsContext=%p, pOpensslCredentials=%p.",
+                    ( void * ) pTlsContext,
+                    ( const void * ) pOpensslCredentials ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Load the credentials outside of the lock, so connections can keep
+         * using the current context while the files are parsed. */
+        returnStatus = createSslContext( pOpensslCredentials, &pNewSslContext );
+    }
+
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        ( void ) pthread_mutex_lock( &pTlsContext->mutex );
+        pOldSslContext = pTlsContext->pSslContext;
+        pTlsContext->pSslContext = pNewSslContext;
+        ( void ) pthread_mutex_unlock( &pTlsContext->mutex );
+
+        /* Connections that still use the old context hold their own reference. */
+        if( pOldSslContext != NULL )
+        {
+            SSL_CTX_free( pOldSslContext );
+        }
+
+        LogDebug( ( "Loaded credentials into the shared TLS context." ) );
+    }
+    else if( pNewSslContext != NULL )
+    {
+        SSL_CTX_free( pNewSslContext );
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_TlsContextCleanup( OpensslTlsContext_t * pTlsContext )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+    if( pTlsContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pTlsContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
     else
     {
-        LogDebug( ( "Established a TLS connection." ) );
+        if( pTlsContext->pSslContext != NULL )
+        {
+            SSL_CTX_free( pTlsContext->pSslContext );
+            pTlsContext->pSslContext = NULL;
+        }
+
+        ( void ) pthread_mutex_destroy( &pTlsContext->mutex );
     }
 
     return returnStatus;
@@ -668,6 +2010,7 @@ int32_t Openssl_Recv( const NetworkContext_t * pNetworkContext,
 {
     int32_t bytesReceived = 0;
     int32_t sslError = 0;
+    uint64_t startTimeUs = 0U;
 
     if( pNetworkContext == NULL )
     {
@@ -675,10 +2018,24 @@ int32_t Openssl_Recv( const NetworkContext_t * pNetworkContext,
     }
     else if( pNetworkContext->pSsl != NULL )
     {
-        /* SSL read of data. */
-        bytesReceived = ( int32_t ) SSL_read( pNetworkContext->pSsl,
-                                              pBuffer,
-                                              ( int32_t ) bytesToRecv );
+        startTimeUs = TRANSPORT_STATS_START( pNetworkContext->pStats );
+
+        if( ( pNetworkContext->pReadAhead != NULL ) &&
+            ( ( pNetworkContext->pReadAhead->length > 0U ) ||
+              ( bytesToRecv < pNetworkContext->pReadAhead->bufferSize ) ) )
+        {
+            bytesReceived = recvReadAhead( pNetworkContext->pSsl,
+                                           pNetworkContext->pReadAhead,
+                                           pBuffer,
+                                           bytesToRecv );
+        }
+        else
+        {
+            /* SSL read of data. */
+            bytesReceived = ( int32_t ) SSL_read( pNetworkContext->pSsl,
+                                                  pBuffer,
+                                                  ( int32_t ) bytesToRecv );
+        }
 
         /* Handle error return status if transport read did not succeed. */
         if( bytesReceived <= 0 )
@@ -688,14 +2045,23 @@ int32_t Openssl_Recv( const NetworkContext_t * pNetworkContext,
             if( sslError == SSL_ERROR_WANT_READ )
             {
                 /* There is no data to receive at this time. */
+                TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, wantReadCount );
                 bytesReceived = 0;
             }
             else
             {
-                LogError( ( "Failed to receive data over network: SSL_read failed: "
-                            "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
+                if( sslError == SSL_ERROR_WANT_WRITE )
+                {
+                    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, wantWriteCount );
+                }
+
+                LogErrorRateLimited( ( "Failed to receive data over network: SSL_read failed: "
+                                       "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
             }
         }
+
+        TRANSPORT_STATS_RECORD( pNetworkContext->pStats, false, bytesReceived, startTimeUs );
+        TRACE_PROBE3( openssl_recv, pNetworkContext, bytesToRecv, bytesReceived );
     }
     else
     {
@@ -712,7 +2078,9 @@ int32_t Openssl_Send( const NetworkContext_t * pNetworkContext,
                       size_t bytesToSend )
 {
     int32_t bytesSent = 0;
+    int32_t earlyDataSent = 0;
     int32_t sslError = 0;
+    uint64_t startTimeUs = 0U;
 
     /* Unused parameter when logs are disabled. */
     ( void ) sslError;
@@ -723,18 +2091,63 @@ int32_t Openssl_Send( const NetworkContext_t * pNetworkContext,
     }
     else if( pNetworkContext->pSsl != NULL )
     {
-        /* SSL write of data. */
-        bytesSent = ( int32_t ) SSL_write( pNetworkContext->pSsl,
-                                           pBuffer,
-                                           ( int32_t ) bytesToSend );
+        startTimeUs = TRANSPORT_STATS_START( pNetworkContext->pStats );
+
+        /* The first send of a connection with early data completes the
+         * handshake. */
+        if( ( pNetworkContext->earlyDataEnabled == true ) &&
+            ( SSL_is_init_finished( pNetworkContext->pSsl ) == 0 ) )
+        {
+            earlyDataSent = sendEarlyData( pNetworkContext->pSsl, pBuffer, bytesToSend );
+        }
+
+        if( earlyDataSent < 0 )
+        {
+            bytesSent = earlyDataSent;
+        }
+        else if( ( size_t ) earlyDataSent == bytesToSend )
+        {
+            bytesSent = earlyDataSent;
+        }
+        else
+        {
+            /* SSL write of data. */
+            bytesSent = ( int32_t ) SSL_write( pNetworkContext->pSsl,
+                                               &( ( const uint8_t * ) pBuffer )[ earlyDataSent ],
+                                               ( int32_t ) ( bytesToSend - ( size_t ) earlyDataSent ) );
+
+            if( ( bytesSent <= 0 ) && ( earlyDataSent > 0 ) )
+            {
+                /* Report the bytes sent as early data. */
+                bytesSent = 0;
+            }
+
+            bytesSent += earlyDataSent;
+        }
 
         if( bytesSent <= 0 )
         {
             sslError = SSL_get_error( pNetworkContext->pSsl, bytesSent );
 
-            LogError( ( "Failed to send data over network: SSL_write of OpenSSL failed: "
-                        "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
+            if( sslError == SSL_ERROR_WANT_READ )
+            {
+                TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, wantReadCount );
+            }
+            else if( sslError == SSL_ERROR_WANT_WRITE )
+            {
+                TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, wantWriteCount );
+            }
+            else
+            {
+                /* Empty else. */
+            }
+
+            LogErrorRateLimited( ( "Failed to send data over network: SSL_write of OpenSSL failed: "
+                                   "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
         }
+
+        TRANSPORT_STATS_RECORD( pNetworkContext->pStats, true, bytesSent, startTimeUs );
+        TRACE_PROBE3( openssl_send, pNetworkContext, bytesToSend, bytesSent );
     }
     else
     {
@@ -745,3 +2158,198 @@ int32_t Openssl_Send( const NetworkContext_t * pNetworkContext,
     return bytesSent;
 }
 /*-----------------------------------------------------------*/
+
+int32_t Openssl_Writev( const NetworkContext_t * pNetworkContext,
+                        const struct iovec * pIoVectors,
+                        size_t ioVectorCount )
+{
+    uint8_t coalesceBuffer[ OPENSSL_WRITEV_BUFFER_LENGTH ];
+    const uint8_t * pVectorData = NULL, * pRecord = NULL;
+    size_t vectorIndex = 0U, vectorOffset = 0U, bufferedLength = 0U;
+    size_t copyLength = 0U, recordLength = 0U;
+    int32_t totalBytesSent = 0, sendStatus = 0;
+    bool sendFailed = false;
+
+    assert( pIoVectors != NULL );
+    assert( ioVectorCount > 0U );
+
+    while( ( vectorIndex <= ioVectorCount ) && ( sendFailed == false ) )
+    {
+        pRecord = NULL;
+
+        if( vectorIndex == ioVectorCount )
+        {
+            /* Send the bytes left in the buffer. */
+            pRecord = coalesceBuffer;
+            recordLength = bufferedLength;
+            vectorIndex++;
+        }
+        else
+        {
+            pVectorData = ( const uint8_t * ) pIoVectors[ vectorIndex ].iov_base;
+            copyLength = pIoVectors[ vectorIndex ].iov_len - vectorOffset;
+
+            if( copyLength == 0U )
+            {
+                vectorIndex++;
+                vectorOffset = 0U;
+            }
+            else if( ( bufferedLength == 0U ) && ( copyLength >= sizeof( coalesceBuffer ) ) )
+            {
+                /* Large buffers are written as they are. */
+                pRecord = &pVectorData[ vectorOffset ];
+                recordLength = copyLength;
+                vectorOffset += copyLength;
+            }
+            else
+            {
+                if( copyLength > ( sizeof( coalesceBuffer ) - bufferedLength ) )
+                {
+                    copyLength = sizeof( coalesceBuffer ) - bufferedLength;
+                }
+
+                ( void ) memcpy( &coalesceBuffer[ bufferedLength ],
+                                 &pVectorData[ vectorOffset ],
+                                 copyLength );
+                bufferedLength += copyLength;
+                vectorOffset += copyLength;
+
+                if( bufferedLength == sizeof( coalesceBuffer ) )
+                {
+                    pRecord = coalesceBuffer;
+                    recordLength = bufferedLength;
+                }
+            }
+        }
+
+        if( ( pRecord != NULL ) && ( recordLength > 0U ) )
+        {
+            if( pRecord == coalesceBuffer )
+            {
+                bufferedLength = 0U;
+            }
+
+            sendStatus = Openssl_Send( pNetworkContext, pRecord, recordLength );
+
+            if( sendStatus > 0 )
+            {
+                totalBytesSent += sendStatus;
+            }
+            else
+            {
+                sendFailed = true;
+            }
+        }
+    }
+
+    /* Report an error only when no bytes were sent before it. */
+    if( ( sendFailed == true ) && ( totalBytesSent == 0 ) )
+    {
+        totalBytesSent = ( sendStatus < 0 ) ? sendStatus : -1;
+    }
+
+    return totalBytesSent;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Openssl_SendFile( const NetworkContext_t * pNetworkContext,
+                          int32_t fileDescriptor,
+                          off_t offset,
+                          size_t bytesToSend )
+{
+    uint8_t fileBuffer[ OPENSSL_SENDFILE_BUFFER_LENGTH ];
+    size_t sendLength = bytesToSend, chunkLength = 0U;
+    ssize_t bytesRead = 0;
+    int32_t totalBytesSent = 0, sendStatus = 0;
+    bool sendDone = false;
+
+    /* The return value cannot report more than INT32_MAX bytes. */
+    if( sendLength > ( size_t ) INT32_MAX )
+    {
+        sendLength = ( size_t ) INT32_MAX;
+    }
+
+    if( pNetworkContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else if( pNetworkContext->pSsl == NULL )
+    {
+        LogError( ( "Failed to send file over network: "
+                    "SSL object in network context is NULL." ) );
+    }
+    else if( fileDescriptor < 0 )
+    {
+        LogError( ( "Parameter check failed: fileDescriptor is invalid." ) );
+        totalBytesSent = -1;
+    }
+
+    else if( sendLength == 0U )
+    {
+        LogDebug( ( "No bytes of the file to send." ) );
+    }
+    else if( isKtlsSendEnabled( pNetworkContext->pSsl ) == true )
+    {
+        /* The kernel encrypts the file as it sends it. */
+        totalBytesSent = sendFileWithKtls( pNetworkContext->pSsl,
+                                           fileDescriptor,
+                                           offset,
+                                           sendLength );
+    }
+    else
+    {
+        /* Without kTLS, the file is copied through a buffer and encrypted
+         * by SSL_write. */
+        while( ( ( size_t ) totalBytesSent < sendLength ) && ( sendDone == false ) )
+        {
+            chunkLength = sendLength - ( size_t ) totalBytesSent;
+
+            if( chunkLength > sizeof( fileBuffer ) )
+            {
+                chunkLength = sizeof( fileBuffer );
+            }
+
+            bytesRead = pread( fileDescriptor,
+                               fileBuffer,
+                               chunkLength,
+                               offset + ( off_t ) totalBytesSent );
+
+            if( bytesRead < 0 )
+            {
+                LogError( ( "Failed to read file to send: errno=%d.", errno ) );
+                sendStatus = -1;
+                sendDone = true;
+            }
+            else if( bytesRead == 0 )
+            {
+                LogDebug( ( "File ended after %d bytes.", ( int ) totalBytesSent ) );
+                sendDone = true;
+            }
+            else
+            {
+                sendStatus = Openssl_Send( pNetworkContext,
+                                           fileBuffer,
+                                           ( size_t ) bytesRead );
+
+                if( sendStatus > 0 )
+                {
+                    totalBytesSent += sendStatus;
+                }
+                else
+                {
+                    sendStatus = ( sendStatus < 0 ) ? sendStatus : -1;
+                    sendDone = true;
+                }
+            }
+        }
+
+        /* Report an error only when no bytes were sent before it. */
+        if( totalBytesSent == 0 )
+        {
+            totalBytesSent = sendStatus;
+        }
+    }
+
+    return totalBytesSent;
+}
+/*-----------------------------------------------------------*/
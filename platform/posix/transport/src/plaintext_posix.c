@@ -22,14 +22,48 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <limits.h>
 #include <string.h>
 
 /* POSIX socket includes. */
 #include <errno.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/time.h>
+
+/* Zero-copy file sending, or reading the file where it is missing. */
+#if defined( __linux__ )
+    #include <sys/sendfile.h>
+#else
+    #include <unistd.h>
+#endif
 
 #include "plaintext_posix.h"
+#include "clock.h"
+#include "trace_probes.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of milliseconds in one second.
+ */
+#define ONE_SEC_TO_MS    ( 1000U )
+
+/**
+ * @brief Number of microseconds in one millisecond.
+ */
+#define ONE_MS_TO_US     ( 1000U )
+
+/**
+ * @brief Maximum number of buffers passed to #sendmsg in one call. IOV_MAX is
+ * only defined by limits.h for some feature test macros, so fall back to the
+ * minimum value allowed by POSIX.
+ */
+#ifdef IOV_MAX
+    #define MAX_IO_VECTORS    ( ( size_t ) IOV_MAX )
+#else
+    #define MAX_IO_VECTORS    ( ( size_t ) 16U )
+#endif
 
 /*-----------------------------------------------------------*/
 
@@ -40,6 +74,98 @@
  */
 static void logTransportError( int32_t errorNumber );
 
+/**
+ * @brief Wait until a socket can be read from or written to.
+ *
+ * @param[in] socketDescriptor The socket to wait for.
+ * @param[in] waitForWrite Wait for the socket to be writable instead of readable.
+ * @param[in] timeoutMs Maximum time to wait. 0 returns immediately.
+ *
+ * @return Positive value if the socket is ready; 0 on timeout; negative value on error.
+ */
+static int32_t waitForSocket( int32_t socketDescriptor,
+                              bool waitForWrite,
+                              uint32_t timeoutMs );
+
+/**
+ * @brief Receive data on a non-blocking socket, waiting for at most the cached
+ * receive timeout only if no data is available.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested from the network.
+ *
+ * @return Number of bytes received if successful; negative value on error.
+ */
+static int32_t recvNonBlocking( const NetworkContext_t * pNetworkContext,
+                                void * pBuffer,
+                                size_t bytesToRecv );
+
+/**
+ * @brief Send data on a non-blocking socket, waiting for at most the cached
+ * send timeout only if the socket buffer is full.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[in] pBuffer Buffer containing the bytes to send over the network.
+ * @param[in] bytesToSend Number of bytes to send over the network.
+ *
+ * @return Number of bytes sent if successful; negative value on error.
+ */
+static int32_t sendNonBlocking( const NetworkContext_t * pNetworkContext,
+                                const void * pBuffer,
+                                size_t bytesToSend );
+
+/**
+ * @brief Receive data after waiting for the socket with #select, using the
+ * receive timeout set on the socket.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested from the network.
+ *
+ * @return Number of bytes received if successful; negative value on error.
+ */
+static int32_t recvWithSelect( const NetworkContext_t * pNetworkContext,
+                               void * pBuffer,
+                               size_t bytesToRecv );
+
+/**
+ * @brief Send data after waiting for the socket with #select, using the
+ * send timeout set on the socket.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[in] pBuffer Buffer containing the bytes to send over the network.
+ * @param[in] bytesToSend Number of bytes to send over the network.
+ *
+ * @return Number of bytes sent if successful; negative value on error.
+ */
+static int32_t sendWithSelect( const NetworkContext_t * pNetworkContext,
+                               const void * pBuffer,
+                               size_t bytesToSend );
+
+/**
+ * @brief Send a message made of several buffers, waiting for the socket if it
+ * would block in non-blocking mode.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[in] pMessage The message describing the buffers to send.
+ *
+ * @return Number of bytes sent if successful; 0 if the send timed out;
+ * negative value on error.
+ */
+static int32_t sendMessage( const NetworkContext_t * pNetworkContext,
+                            const struct msghdr * pMessage );
+
+/**
+ * @brief Get the receive timeout of a connection: the cached timeout in
+ * non-blocking mode, or the timeout set on the socket otherwise.
+ *
+ * @param[in] pNetworkContext The network context.
+ *
+ * @return The receive timeout in milliseconds; 0 if it could not be read.
+ */
+static uint32_t getRecvTimeoutMs( const NetworkContext_t * pNetworkContext );
+
 /*-----------------------------------------------------------*/
 
 static void logTransportError( int32_t errorNumber )
@@ -47,7 +173,253 @@ static void logTransportError( int32_t errorNumber )
     /* Remove unused parameter warning. */
     ( void ) errorNumber;
 
-    LogError( ( "A transport error occurred: %s.", strerror( errorNumber ) ) );
+    LogErrorRateLimited( ( "A transport error occurred: %s.", strerror( errorNumber ) ) );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t waitForSocket( int32_t socketDescriptor,
+                              bool waitForWrite,
+                              uint32_t timeoutMs )
+{
+    struct timeval timeout;
+    fd_set fds;
+
+    timeout.tv_sec = ( time_t ) ( timeoutMs / ONE_SEC_TO_MS );
+    timeout.tv_usec = ( suseconds_t ) ( ( timeoutMs % ONE_SEC_TO_MS ) * ONE_MS_TO_US );
+
+    /* MISRA Directive 4.6 flags the following line for a violation of using a
+     * basic type "int" rather than a type that includes size and signedness information.
+     * We suppress the violation as the flagged type, "fd_set", is a POSIX
+     * system-specific type, and is used for the call to "select()". */
+
+    /* MISRA Rule 14.4 flags the following line for using condition expression "0"
+     * as a boolean type. We suppress the violation as the "FD_ZERO" is a POSIX
+     * specific macro utility whose implementation is supplied by the system.
+     * The "FD_ZERO" macro is called as specified by the POSIX manual here:
+     * https://pubs.opengroup.org/onlinepubs/009695399/basedefs/sys/select.h.html */
+    /* coverity[misra_c_2012_directive_4_6_violation] */
+    /* coverity[misra_c_2012_rule_14_4_violation] */
+    FD_ZERO( &fds );
+
+    /* MISRA Rule 10.1, Rule 10.8 and Rule 13.4 flag the following line for
+     * implementation of the "FD_SET()" POSIX macro. We suppress these violations
+     * as "FD_SET" is a POSIX specific macro utility whose implementation
+     * is supplied by the system.
+     * The "FD_SET" macro is used as specified by the POSIX manual here:
+     * https://pubs.opengroup.org/onlinepubs/009695399/basedefs/sys/select.h.html */
+    /* coverity[misra_c_2012_directive_4_6_violation] */
+    /* coverity[misra_c_2012_rule_10_1_violation] */
+    /* coverity[misra_c_2012_rule_13_4_violation] */
+    /* coverity[misra_c_2012_rule_10_8_violation] */
+    FD_SET( socketDescriptor, &fds );
+
+    return ( int32_t ) select( socketDescriptor + 1,
+                               ( waitForWrite == true ) ? NULL : &fds,
+                               ( waitForWrite == true ) ? &fds : NULL,
+                               NULL,
+                               &timeout );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t recvNonBlocking( const NetworkContext_t * pNetworkContext,
+                                void * pBuffer,
+                                size_t bytesToRecv )
+{
+    int32_t bytesReceived = -1, selectStatus = 1;
+
+    /* Try to receive first, as data is usually already available. */
+    bytesReceived = ( int32_t ) recv( pNetworkContext->socketDescriptor,
+                                      pBuffer,
+                                      bytesToRecv,
+                                      0 );
+    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+    if( ( bytesReceived < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+    {
+        /* Only wait for the socket when no data is available yet. */
+        selectStatus = waitForSocket( pNetworkContext->socketDescriptor,
+                                      false,
+                                      pNetworkContext->recvTimeoutMs );
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+        if( selectStatus > 0 )
+        {
+            bytesReceived = ( int32_t ) recv( pNetworkContext->socketDescriptor,
+                                              pBuffer,
+                                              bytesToRecv,
+                                              0 );
+            TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+            if( ( bytesReceived < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+            {
+                /* The readiness notification was spurious. */
+                bytesReceived = 0;
+                selectStatus = 0;
+            }
+        }
+        else if( selectStatus == 0 )
+        {
+            /* Timed out waiting for data to be received. */
+            bytesReceived = 0;
+        }
+        else
+        {
+            /* An error occurred while polling. */
+            bytesReceived = -1;
+        }
+    }
+
+    if( ( selectStatus > 0 ) && ( bytesReceived == 0 ) )
+    {
+        /* Peer has closed the connection. Treat as an error. */
+        bytesReceived = -1;
+    }
+    else if( bytesReceived < 0 )
+    {
+        logTransportError( errno );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t sendNonBlocking( const NetworkContext_t * pNetworkContext,
+                                const void * pBuffer,
+                                size_t bytesToSend )
+{
+    int32_t bytesSent = -1, selectStatus = 1;
+
+    /* Try to send first, as the socket buffer usually has room. */
+    bytesSent = ( int32_t ) send( pNetworkContext->socketDescriptor,
+                                  pBuffer,
+                                  bytesToSend,
+                                  0 );
+    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+    if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+    {
+        /* Only wait for the socket when its send buffer is full. */
+        selectStatus = waitForSocket( pNetworkContext->socketDescriptor,
+                                      true,
+                                      pNetworkContext->sendTimeoutMs );
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+        if( selectStatus > 0 )
+        {
+            bytesSent = ( int32_t ) send( pNetworkContext->socketDescriptor,
+                                          pBuffer,
+                                          bytesToSend,
+                                          0 );
+            TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+            if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+            {
+                /* The readiness notification was spurious. */
+                bytesSent = 0;
+                selectStatus = 0;
+            }
+        }
+        else if( selectStatus == 0 )
+        {
+            /* Timed out waiting for data to be sent. */
+            bytesSent = 0;
+        }
+        else
+        {
+            /* An error occurred while polling. */
+            bytesSent = -1;
+        }
+    }
+
+    if( ( selectStatus > 0 ) && ( bytesSent == 0 ) )
+    {
+        /* Peer has closed the connection. Treat as an error. */
+        bytesSent = -1;
+    }
+    else if( bytesSent < 0 )
+    {
+        logTransportError( errno );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t sendMessage( const NetworkContext_t * pNetworkContext,
+                            const struct msghdr * pMessage )
+{
+    int32_t bytesSent = -1, selectStatus = 1;
+
+    bytesSent = ( int32_t ) sendmsg( pNetworkContext->socketDescriptor,
+                                     pMessage,
+                                     0 );
+    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+    if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+    {
+        if( pNetworkContext->nonBlocking == true )
+        {
+            /* Only wait for the socket when its send buffer is full. */
+            selectStatus = waitForSocket( pNetworkContext->socketDescriptor,
+                                          true,
+                                          pNetworkContext->sendTimeoutMs );
+            TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+        }
+        else
+        {
+            /* The send timeout of the blocking socket expired. */
+            selectStatus = 0;
+        }
+
+        if( selectStatus > 0 )
+        {
+            bytesSent = ( int32_t ) sendmsg( pNetworkContext->socketDescriptor,
+                                             pMessage,
+                                             0 );
+            TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+            if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+            {
+                /* The readiness notification was spurious. */
+                bytesSent = 0;
+                selectStatus = 0;
+            }
+        }
+        else if( selectStatus == 0 )
+        {
+            /* Timed out waiting for data to be sent. */
+            bytesSent = 0;
+        }
+        else
+        {
+            /* An error occurred while polling. */
+            bytesSent = -1;
+        }
+    }
+
+    if( ( selectStatus > 0 ) && ( bytesSent == 0 ) )
+    {
+        /* Peer has closed the connection. Treat as an error. */
+        bytesSent = -1;
+    }
+    else if( bytesSent < 0 )
+    {
+        logTransportError( errno );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return bytesSent;
 }
 /*-----------------------------------------------------------*/
 
@@ -56,10 +428,90 @@ SocketStatus_t Plaintext_Connect( NetworkContext_t * pNetworkContext,
                                   uint32_t sendTimeoutMs,
                                   uint32_t recvTimeoutMs )
 {
-    return Sockets_Connect( &pNetworkContext->socketDescriptor,
-                            pServerInfo,
-                            sendTimeoutMs,
-                            recvTimeoutMs );
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    if( pNetworkContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        pNetworkContext->sendTimeoutMs = sendTimeoutMs;
+        pNetworkContext->recvTimeoutMs = recvTimeoutMs;
+        pNetworkContext->nonBlocking = false;
+
+        returnStatus = Sockets_Connect( &pNetworkContext->socketDescriptor,
+                                        pServerInfo,
+                                        sendTimeoutMs,
+                                        recvTimeoutMs );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Plaintext_ConnectWithConfig( NetworkContext_t * pNetworkContext,
+                                            const ServerInfo_t * pServerInfo,
+                                            const SocketsConfig_t * pSocketsConfig )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    if( pNetworkContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pSocketsConfig == NULL )
+    {
+        LogError( ( "Parameter check failed: pSocketsConfig is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        pNetworkContext->sendTimeoutMs = pSocketsConfig->sendTimeoutMs;
+        pNetworkContext->recvTimeoutMs = pSocketsConfig->recvTimeoutMs;
+        pNetworkContext->nonBlocking = pSocketsConfig->nonBlocking;
+
+        returnStatus = Sockets_ConnectWithConfig( &pNetworkContext->socketDescriptor,
+                                                  pServerInfo,
+                                                  pSocketsConfig );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Plaintext_ConnectUnix( NetworkContext_t * pNetworkContext,
+                                      const char * pSocketPath,
+                                      size_t socketPathLength,
+                                      const SocketsConfig_t * pSocketsConfig )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    if( pNetworkContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pSocketsConfig == NULL )
+    {
+        LogError( ( "Parameter check failed: pSocketsConfig is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        pNetworkContext->sendTimeoutMs = pSocketsConfig->sendTimeoutMs;
+        pNetworkContext->recvTimeoutMs = pSocketsConfig->recvTimeoutMs;
+        pNetworkContext->nonBlocking = pSocketsConfig->nonBlocking;
+
+        returnStatus = Sockets_ConnectUnix( &pNetworkContext->socketDescriptor,
+                                            pSocketPath,
+                                            socketPathLength,
+                                            pSocketsConfig );
+    }
+
+    return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
@@ -69,19 +521,15 @@ SocketStatus_t Plaintext_Disconnect( const NetworkContext_t * pNetworkContext )
 }
 /*-----------------------------------------------------------*/
 
-int32_t Plaintext_Recv( const NetworkContext_t * pNetworkContext,
-                        void * pBuffer,
-                        size_t bytesToRecv )
+static int32_t recvWithSelect( const NetworkContext_t * pNetworkContext,
+                               void * pBuffer,
+                               size_t bytesToRecv )
 {
     int32_t bytesReceived = -1, selectStatus = -1, getTimeoutStatus = -1;
     struct timeval recvTimeout;
     socklen_t recvTimeoutLen;
     fd_set readfds;
 
-    assert( pNetworkContext != NULL );
-    assert( pBuffer != NULL );
-    assert( bytesToRecv > 0 );
-
     /* Get receive timeout from the socket to use as the timeout for #select. */
     recvTimeoutLen = ( socklen_t ) sizeof( recvTimeout );
     getTimeoutStatus = getsockopt( pNetworkContext->socketDescriptor,
@@ -89,6 +537,7 @@ int32_t Plaintext_Recv( const NetworkContext_t * pNetworkContext,
                                    SO_RCVTIMEO,
                                    &recvTimeout,
                                    &recvTimeoutLen );
+    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
 
     /* Make #select return immediately if getting the timeout failed. */
     if( getTimeoutStatus < 0 )
@@ -135,6 +584,7 @@ int32_t Plaintext_Recv( const NetworkContext_t * pNetworkContext,
                            NULL,
                            NULL,
                            &recvTimeout );
+    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
 
     if( selectStatus > 0 )
     {
@@ -143,6 +593,7 @@ int32_t Plaintext_Recv( const NetworkContext_t * pNetworkContext,
                                           pBuffer,
                                           bytesToRecv,
                                           0 );
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
     }
     else if( selectStatus < 0 )
     {
@@ -173,19 +624,15 @@ int32_t Plaintext_Recv( const NetworkContext_t * pNetworkContext,
 }
 /*-----------------------------------------------------------*/
 
-int32_t Plaintext_Send( const NetworkContext_t * pNetworkContext,
-                        const void * pBuffer,
-                        size_t bytesToSend )
+static int32_t sendWithSelect( const NetworkContext_t * pNetworkContext,
+                               const void * pBuffer,
+                               size_t bytesToSend )
 {
     int32_t bytesSent = -1, selectStatus = -1, getTimeoutStatus = -1;
     struct timeval sendTimeout;
     socklen_t sendTimeoutLen;
     fd_set writefds;
 
-    assert( pNetworkContext != NULL );
-    assert( pBuffer != NULL );
-    assert( bytesToSend > 0 );
-
     /* Get send timeout from the socket to use as the timeout for #select. */
     sendTimeoutLen = ( socklen_t ) sizeof( sendTimeout );
     getTimeoutStatus = getsockopt( pNetworkContext->socketDescriptor,
@@ -193,6 +640,7 @@ int32_t Plaintext_Send( const NetworkContext_t * pNetworkContext,
                                    SO_SNDTIMEO,
                                    &sendTimeout,
                                    &sendTimeoutLen );
+    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
 
     /* Make #select return immediately if getting the timeout failed. */
     if( getTimeoutStatus < 0 )
@@ -237,6 +685,7 @@ int32_t Plaintext_Send( const NetworkContext_t * pNetworkContext,
                            &writefds,
                            NULL,
                            &sendTimeout );
+    TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
 
     if( selectStatus > 0 )
     {
@@ -245,6 +694,7 @@ int32_t Plaintext_Send( const NetworkContext_t * pNetworkContext,
                                       pBuffer,
                                       bytesToSend,
                                       0 );
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
     }
     else if( selectStatus < 0 )
     {
@@ -274,3 +724,338 @@ int32_t Plaintext_Send( const NetworkContext_t * pNetworkContext,
     return bytesSent;
 }
 /*-----------------------------------------------------------*/
+
+static uint32_t getRecvTimeoutMs( const NetworkContext_t * pNetworkContext )
+{
+    uint32_t timeoutMs = 0U;
+    uint64_t recvTimeoutMs = 0U;
+    struct timeval recvTimeout;
+    socklen_t recvTimeoutLen;
+
+    if( pNetworkContext->nonBlocking == true )
+    {
+        timeoutMs = pNetworkContext->recvTimeoutMs;
+    }
+    else
+    {
+        ( void ) memset( &recvTimeout, 0, sizeof( recvTimeout ) );
+        recvTimeoutLen = ( socklen_t ) sizeof( recvTimeout );
+
+        if( getsockopt( pNetworkContext->socketDescriptor,
+                        SOL_SOCKET,
+                        SO_RCVTIMEO,
+                        &recvTimeout,
+                        &recvTimeoutLen ) == 0 )
+        {
+            /* A timeout of more than 49 days does not fit in 32 bits of
+             * milliseconds, and is as good as waiting forever. */
+            recvTimeoutMs = ( ( uint64_t ) recvTimeout.tv_sec * ONE_SEC_TO_MS ) +
+                            ( ( uint64_t ) recvTimeout.tv_usec / ONE_MS_TO_US );
+            timeoutMs = ( recvTimeoutMs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) recvTimeoutMs;
+        }
+
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+    }
+
+    return timeoutMs;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Plaintext_Recv( const NetworkContext_t * pNetworkContext,
+                        void * pBuffer,
+                        size_t bytesToRecv )
+{
+    int32_t bytesReceived = -1;
+    uint64_t startTimeUs = 0U;
+
+    assert( pNetworkContext != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToRecv > 0 );
+
+    startTimeUs = TRANSPORT_STATS_START( pNetworkContext->pStats );
+
+    if( pNetworkContext->nonBlocking == true )
+    {
+        bytesReceived = recvNonBlocking( pNetworkContext, pBuffer, bytesToRecv );
+    }
+    else
+    {
+        bytesReceived = recvWithSelect( pNetworkContext, pBuffer, bytesToRecv );
+    }
+
+    TRANSPORT_STATS_RECORD( pNetworkContext->pStats, false, bytesReceived, startTimeUs );
+    TRACE_PROBE3( plaintext_recv, pNetworkContext, bytesToRecv, bytesReceived );
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Plaintext_RecvAll( const NetworkContext_t * pNetworkContext,
+                           void * pBuffer,
+                           size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0, recvStatus = 0, selectStatus = 1;
+    uint64_t startTimeUs = 0U, deadlineUs = 0U, nowUs = 0U;
+    uint32_t waitMs = 0U;
+    uint8_t * pNext = ( uint8_t * ) pBuffer;
+    size_t bytesRemaining = bytesToRecv;
+
+    assert( pNetworkContext != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToRecv > 0 );
+
+    startTimeUs = TRANSPORT_STATS_START( pNetworkContext->pStats );
+
+    /* A single deadline covers every read, so a slow trickle of partial reads
+     * cannot extend the wait beyond one receive timeout. */
+    waitMs = getRecvTimeoutMs( pNetworkContext );
+    deadlineUs = Clock_GetTimeUs() + ( ( uint64_t ) waitMs * ONE_MS_TO_US );
+
+    while( ( bytesRemaining > 0U ) && ( selectStatus > 0 ) )
+    {
+        selectStatus = waitForSocket( pNetworkContext->socketDescriptor,
+                                      false,
+                                      waitMs );
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+        if( selectStatus > 0 )
+        {
+            recvStatus = ( int32_t ) recv( pNetworkContext->socketDescriptor,
+                                           pNext,
+                                           bytesRemaining,
+                                           0 );
+            TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+            if( recvStatus > 0 )
+            {
+                pNext = &pNext[ recvStatus ];
+                bytesRemaining -= ( size_t ) recvStatus;
+                bytesReceived += recvStatus;
+            }
+            else if( recvStatus == 0 )
+            {
+                /* Peer has closed the connection. Treat as an error. */
+                selectStatus = -1;
+            }
+            else if( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+            {
+                /* The readiness notification was spurious. */
+            }
+            else
+            {
+                logTransportError( errno );
+                selectStatus = -1;
+            }
+
+            /* Wait only for what is left of the deadline, rounded up to
+             * whole milliseconds. A wait of 0 still picks up data that has
+             * already arrived. */
+            nowUs = Clock_GetTimeUs();
+            waitMs = ( nowUs < deadlineUs ) ?
+                     ( uint32_t ) ( ( deadlineUs - nowUs + ONE_MS_TO_US - 1U ) / ONE_MS_TO_US ) : 0U;
+        }
+        else if( selectStatus < 0 )
+        {
+            logTransportError( errno );
+        }
+        else
+        {
+            /* Timed out with only part of the data received. */
+        }
+    }
+
+    if( selectStatus < 0 )
+    {
+        /* The bytes received so far are only part of the requested data, and
+         * the connection can no longer be used to receive the rest. */
+        bytesReceived = -1;
+    }
+
+    TRANSPORT_STATS_RECORD( pNetworkContext->pStats, false, bytesReceived, startTimeUs );
+    TRACE_PROBE3( plaintext_recv, pNetworkContext, bytesToRecv, bytesReceived );
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Plaintext_Send( const NetworkContext_t * pNetworkContext,
+                        const void * pBuffer,
+                        size_t bytesToSend )
+{
+    int32_t bytesSent = -1;
+    uint64_t startTimeUs = 0U;
+
+    assert( pNetworkContext != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToSend > 0 );
+
+    startTimeUs = TRANSPORT_STATS_START( pNetworkContext->pStats );
+
+    if( pNetworkContext->nonBlocking == true )
+    {
+        bytesSent = sendNonBlocking( pNetworkContext, pBuffer, bytesToSend );
+    }
+    else
+    {
+        bytesSent = sendWithSelect( pNetworkContext, pBuffer, bytesToSend );
+    }
+
+    TRANSPORT_STATS_RECORD( pNetworkContext->pStats, true, bytesSent, startTimeUs );
+    TRACE_PROBE3( plaintext_send, pNetworkContext, bytesToSend, bytesSent );
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Plaintext_Writev( const NetworkContext_t * pNetworkContext,
+                          const struct iovec * pIoVectors,
+                          size_t ioVectorCount )
+{
+    struct msghdr message;
+    int32_t bytesSent = -1;
+    uint64_t startTimeUs = 0U;
+
+    assert( pNetworkContext != NULL );
+    assert( pIoVectors != NULL );
+    assert( ioVectorCount > 0U );
+
+    startTimeUs = TRANSPORT_STATS_START( pNetworkContext->pStats );
+
+    ( void ) memset( &message, 0, sizeof( message ) );
+
+    /* The cast removes the const qualifier, as #msghdr is also used for
+     * receiving. #sendmsg does not modify the buffers. */
+    message.msg_iov = ( struct iovec * ) pIoVectors;
+
+    /* The remaining buffers are sent by the next call. */
+    message.msg_iovlen = ( ioVectorCount > MAX_IO_VECTORS ) ? MAX_IO_VECTORS : ioVectorCount;
+
+    bytesSent = sendMessage( pNetworkContext, &message );
+
+    TRANSPORT_STATS_RECORD( pNetworkContext->pStats, true, bytesSent, startTimeUs );
+    TRACE_PROBE3( plaintext_writev, pNetworkContext, ioVectorCount, bytesSent );
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t Plaintext_SendFile( const NetworkContext_t * pNetworkContext,
+                            int32_t fileDescriptor,
+                            off_t offset,
+                            size_t bytesToSend )
+{
+    int32_t bytesSent = -1, selectStatus = -1;
+    size_t sendLength = bytesToSend;
+    uint64_t startTimeUs = 0U;
+
+    #if defined( __linux__ )
+        off_t fileOffset = offset;
+    #else
+        uint8_t fileBuffer[ PLAINTEXT_SENDFILE_BUFFER_LENGTH ];
+        ssize_t bytesRead = 0;
+    #endif
+
+    assert( pNetworkContext != NULL );
+    assert( fileDescriptor >= 0 );
+    assert( bytesToSend > 0U );
+
+    /* The return value cannot report more than INT32_MAX bytes. */
+    if( sendLength > ( size_t ) INT32_MAX )
+    {
+        sendLength = ( size_t ) INT32_MAX;
+    }
+
+    startTimeUs = TRANSPORT_STATS_START( pNetworkContext->pStats );
+
+    #if defined( __linux__ )
+        bytesSent = ( int32_t ) sendfile( pNetworkContext->socketDescriptor,
+                                          fileDescriptor,
+                                          &fileOffset,
+                                          sendLength );
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+        if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+        {
+            if( pNetworkContext->nonBlocking == true )
+            {
+                /* Only wait for the socket when its send buffer is full. */
+                selectStatus = waitForSocket( pNetworkContext->socketDescriptor,
+                                              true,
+                                              pNetworkContext->sendTimeoutMs );
+                TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+            }
+            else
+            {
+                /* The send timeout of the blocking socket expired. */
+                selectStatus = 0;
+            }
+
+            if( selectStatus > 0 )
+            {
+                bytesSent = ( int32_t ) sendfile( pNetworkContext->socketDescriptor,
+                                                  fileDescriptor,
+                                                  &fileOffset,
+                                                  sendLength );
+                TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+                if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+                {
+                    /* The readiness notification was spurious. */
+                    bytesSent = 0;
+                }
+            }
+            else if( selectStatus == 0 )
+            {
+                /* Timed out waiting for data to be sent. */
+                bytesSent = 0;
+            }
+            else
+            {
+                /* An error occurred while polling. */
+                bytesSent = -1;
+            }
+        }
+
+        /* Unlike #send, 0 bytes means the file ended, not the connection. */
+        if( bytesSent < 0 )
+        {
+            logTransportError( errno );
+        }
+    #else /* if defined( __linux__ ) */
+        /* Without #sendfile, the file is copied through a buffer. */
+        ( void ) selectStatus;
+
+        if( sendLength > sizeof( fileBuffer ) )
+        {
+            sendLength = sizeof( fileBuffer );
+        }
+
+        bytesRead = pread( fileDescriptor, fileBuffer, sendLength, offset );
+        TRANSPORT_STATS_INCREMENT( pNetworkContext->pStats, systemCalls );
+
+        if( bytesRead < 0 )
+        {
+            LogError( ( "Failed to read file to send: errno=%d.", errno ) );
+            bytesSent = -1;
+        }
+        else if( bytesRead == 0 )
+        {
+            bytesSent = 0;
+        }
+        else if( pNetworkContext->nonBlocking == true )
+        {
+            bytesSent = sendNonBlocking( pNetworkContext, fileBuffer, ( size_t ) bytesRead );
+        }
+        else
+        {
+            bytesSent = sendWithSelect( pNetworkContext, fileBuffer, ( size_t ) bytesRead );
+        }
+    #endif /* if defined( __linux__ ) */
+
+    TRANSPORT_STATS_RECORD( pNetworkContext->pStats, true, bytesSent, startTimeUs );
+    TRACE_PROBE3( plaintext_send, pNetworkContext, sendLength, bytesSent );
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
@@ -22,17 +22,25 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 
 /* POSIX sockets includes. */
 #include <errno.h>
 #include <netdb.h>
 #include <time.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 #include "sockets_posix.h"
+#include "clock.h"
+#include "dns_cache_posix.h"
+#include "trace_probes.h"
 
 /*-----------------------------------------------------------*/
 
@@ -46,6 +54,11 @@
  */
 #define ONE_MS_TO_US     ( 1000 )
 
+/**
+ * @brief Number of nanoseconds in one millisecond.
+ */
+#define ONE_MS_TO_NS     ( 1000000 )
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -64,11 +77,16 @@ static SocketStatus_t resolveHostName( const char * pHostName,
 
 /**
  * @brief Traverse list of DNS records until a connection is established.
+ * The list is not freed.
  *
  * @param[in] pListHead List containing resolved DNS records.
  * @param[in] pHostName Server host name.
  * @param[in] hostNameLength Length associated with host name.
  * @param[in] port Server port in host-order.
+ * @param[in] pSocketsConfig Connection configuration. The records are raced
+ * when #SocketsConfig_t.connectionAttemptDelayMs or
+ * #SocketsConfig_t.connectTimeoutMs is set, and attempted one at a time with a
+ * blocking connect otherwise.
  * @param[out] pTcpSocket The output parameter to return the created socket.
  *
  * @return #SOCKETS_SUCCESS if successful; #SOCKETS_CONNECT_FAILURE on error.
@@ -77,8 +95,106 @@ static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
                                          const char * pHostName,
                                          size_t hostNameLength,
                                          uint16_t port,
+                                         const SocketsConfig_t * pSocketsConfig,
                                          int32_t * pTcpSocket );
 
+/**
+ * @brief Race connections to the resolved DNS records, starting a new attempt
+ * every #SocketsConfig_t.connectionAttemptDelayMs until one of them is
+ * established.
+ *
+ * When the delay is 0, the next attempt is started only when the previous one
+ * fails. When #SocketsConfig_t.connectTimeoutMs is set, the attempts are
+ * given up once it expires.
+ *
+ * @param[in] pListHead List containing resolved DNS records.
+ * @param[in] port Server port in host-order.
+ * @param[in] pSocketsConfig Connection configuration.
+ * @param[out] pTcpSocket The output parameter to return the created socket,
+ * which is left in non-blocking mode.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_CONNECT_FAILURE on error.
+ */
+static SocketStatus_t raceConnections( struct addrinfo * pListHead,
+                                       uint16_t port,
+                                       const SocketsConfig_t * pSocketsConfig,
+                                       int32_t * pTcpSocket );
+
+/**
+ * @brief Get the time to wait for the connection attempts in progress.
+ *
+ * @param[in] attemptDelayMs Delay before the next attempt is due; 0 if no
+ * attempt is due.
+ * @param[in] deadlineMs Time by which a connection must be established; 0
+ * for no limit.
+ *
+ * @return The timeout for #poll in milliseconds; -1 to wait indefinitely.
+ */
+static int32_t getPollTimeout( uint32_t attemptDelayMs,
+                               uint64_t deadlineMs );
+
+/**
+ * @brief Order the DNS records to alternate between address families,
+ * starting with the family of the first record.
+ *
+ * @param[in] pListHead List containing resolved DNS records.
+ * @param[out] pAddresses Array to return the ordered records in.
+ * @param[in] maxAddresses Size of @p pAddresses.
+ *
+ * @return The number of records in @p pAddresses.
+ */
+static size_t interleaveAddressFamilies( struct addrinfo * pListHead,
+                                         struct addrinfo ** pAddresses,
+                                         size_t maxAddresses );
+
+/**
+ * @brief Find the next DNS record of, or not of, an address family.
+ *
+ * @param[in] pStart The record to start searching from.
+ * @param[in] family The address family.
+ * @param[in] matchFamily Whether to find a record of @p family, or of any
+ * other family.
+ *
+ * @return The record found; NULL if there is none.
+ */
+static struct addrinfo * findAddressFamily( struct addrinfo * pStart,
+                                            int32_t family,
+                                            bool matchFamily );
+
+/**
+ * @brief Create a non-blocking socket and start connecting it to the address
+ * record.
+ *
+ * @param[in] pAddrInfo Address record of the server.
+ * @param[in] port Server port in host-order.
+ * @param[in] pSocketOptions Options to set on the socket; NULL for none.
+ * @param[out] pTcpSocket The output parameter to return the created socket;
+ * -1 on failure.
+ * @param[out] pConnected Whether the connection was established immediately.
+ *
+ * @return #SOCKETS_SUCCESS if the connection is established or in progress;
+ * #SOCKETS_CONNECT_FAILURE on error.
+ */
+static SocketStatus_t startConnection( const struct addrinfo * pAddrInfo,
+                                       uint16_t port,
+                                       const SocketOptions_t * pSocketOptions,
+                                       int32_t * pTcpSocket,
+                                       bool * pConnected );
+
+/**
+ * @brief Set the port of an address record and get the length of the address.
+ *
+ * @param[in, out] pAddrInfo Address record of the server.
+ * @param[in] port Server port in host-order.
+ * @param[out] pResolvedIpAddr Buffer of #INET6_ADDRSTRLEN bytes to return
+ * the IP address as a string in, for logging.
+ *
+ * @return The length of the address.
+ */
+static socklen_t setAddressPort( struct sockaddr * pAddrInfo,
+                                 uint16_t port,
+                                 char * pResolvedIpAddr );
+
 /**
  * @brief Connect to server using the provided address record.
  *
@@ -92,6 +208,75 @@ static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
                                         uint16_t port,
                                         int32_t tcpSocket );
 
+/**
+ * @brief Set the send and receive timeouts of a connected socket.
+ *
+ * @param[in] tcpSocket Socket handle.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ *
+ * @return #SOCKETS_SUCCESS if successful;
+ * #SOCKETS_API_ERROR, #SOCKETS_INSUFFICIENT_MEMORY, #SOCKETS_INVALID_PARAMETER on error.
+ */
+static SocketStatus_t setSocketTimeouts( int32_t tcpSocket,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs );
+
+/**
+ * @brief Put a socket in, or take it out of, non-blocking mode.
+ *
+ * @param[in] tcpSocket Socket handle.
+ * @param[in] nonBlocking Whether to put the socket in non-blocking mode.
+ *
+ * @return #SOCKETS_SUCCESS if successful;
+ * #SOCKETS_API_ERROR, #SOCKETS_INSUFFICIENT_MEMORY, #SOCKETS_INVALID_PARAMETER on error.
+ */
+static SocketStatus_t setSocketNonBlocking( int32_t tcpSocket,
+                                            bool nonBlocking );
+
+/**
+ * @brief Apply the blocking mode and timeouts of the configuration to a
+ * connected socket.
+ *
+ * @param[in] tcpSocket Socket handle.
+ * @param[in] pSocketsConfig Connection configuration.
+ * @param[in] nonBlockingConnect Whether the socket was connected with a
+ * non-blocking connect, which leaves it in non-blocking mode.
+ *
+ * @return #SOCKETS_SUCCESS if successful;
+ * #SOCKETS_API_ERROR, #SOCKETS_INSUFFICIENT_MEMORY, #SOCKETS_INVALID_PARAMETER on error.
+ */
+static SocketStatus_t configureConnectedSocket( int32_t tcpSocket,
+                                                const SocketsConfig_t * pSocketsConfig,
+                                                bool nonBlockingConnect );
+
+/**
+ * @brief Set the tuning options on a socket before it is connected.
+ *
+ * An option that cannot be set is logged and skipped, as the connection works
+ * without it.
+ *
+ * @param[in] tcpSocket Socket handle.
+ * @param[in] pSocketOptions Options to set on the socket.
+ */
+static void setSocketOptions( int32_t tcpSocket,
+                              const SocketOptions_t * pSocketOptions );
+
+/**
+ * @brief Set an integer option on a socket, and log a failure.
+ *
+ * @param[in] tcpSocket Socket handle.
+ * @param[in] level Protocol level of the option.
+ * @param[in] optionName The option.
+ * @param[in] optionValue Value of the option.
+ * @param[in] pOptionName Name of the option, for logging.
+ */
+static void setIntegerOption( int32_t tcpSocket,
+                              int32_t level,
+                              int32_t optionName,
+                              int32_t optionValue,
+                              const char * pOptionName );
+
 /**
  * @brief Log possible error using errno and return appropriate status.
  *
@@ -142,13 +327,10 @@ static SocketStatus_t resolveHostName( const char * pHostName,
 }
 /*-----------------------------------------------------------*/
 
-static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
-                                        uint16_t port,
-                                        int32_t tcpSocket )
+static socklen_t setAddressPort( struct sockaddr * pAddrInfo,
+                                 uint16_t port,
+                                 char * pResolvedIpAddr )
 {
-    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
-    int32_t connectStatus = 0;
-    char resolvedIpAddr[ INET6_ADDRSTRLEN ];
     socklen_t addrInfoLength;
     uint16_t netPort = 0;
     struct sockaddr_in * pIpv4Address;
@@ -156,7 +338,7 @@ static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
 
     assert( pAddrInfo != NULL );
     assert( pAddrInfo->sa_family == AF_INET || pAddrInfo->sa_family == AF_INET6 );
-    assert( tcpSocket >= 0 );
+    assert( pResolvedIpAddr != NULL );
 
     /* Convert port from host byte order to network byte order. */
     netPort = htons( port );
@@ -175,8 +357,8 @@ static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
         addrInfoLength = ( socklen_t ) sizeof( struct sockaddr_in );
         ( void ) inet_ntop( ( int32_t ) pAddrInfo->sa_family,
                             &pIpv4Address->sin_addr,
-                            resolvedIpAddr,
-                            ( socklen_t ) sizeof( resolvedIpAddr ) );
+                            pResolvedIpAddr,
+                            ( socklen_t ) INET6_ADDRSTRLEN );
     }
     else
     {
@@ -192,10 +374,28 @@ static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
         addrInfoLength = ( socklen_t ) sizeof( struct sockaddr_in6 );
         ( void ) inet_ntop( ( int32_t ) pAddrInfo->sa_family,
                             &pIpv6Address->sin6_addr,
-                            resolvedIpAddr,
-                            ( socklen_t ) sizeof( resolvedIpAddr ) );
+                            pResolvedIpAddr,
+                            ( socklen_t ) INET6_ADDRSTRLEN );
     }
 
+    return addrInfoLength;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
+                                        uint16_t port,
+                                        int32_t tcpSocket )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    int32_t connectStatus = 0;
+    char resolvedIpAddr[ INET6_ADDRSTRLEN ];
+    socklen_t addrInfoLength;
+
+    assert( pAddrInfo != NULL );
+    assert( tcpSocket >= 0 );
+
+    addrInfoLength = setAddressPort( pAddrInfo, port, resolvedIpAddr );
+
     LogDebug( ( "Attempting to connect to server using the resolved IP address:"
                 " IP address=%s.",
                 resolvedIpAddr ) );
@@ -215,10 +415,299 @@ static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
 }
 /*-----------------------------------------------------------*/
 
+static struct addrinfo * findAddressFamily( struct addrinfo * pStart,
+                                            int32_t family,
+                                            bool matchFamily )
+{
+    struct addrinfo * pIndex = pStart;
+
+    while( ( pIndex != NULL ) && ( ( pIndex->ai_family == family ) != matchFamily ) )
+    {
+        pIndex = pIndex->ai_next;
+    }
+
+    return pIndex;
+}
+/*-----------------------------------------------------------*/
+
+static size_t interleaveAddressFamilies( struct addrinfo * pListHead,
+                                         struct addrinfo ** pAddresses,
+                                         size_t maxAddresses )
+{
+    struct addrinfo * pPreferred = NULL, * pOther = NULL;
+    int32_t preferredFamily;
+    size_t addressCount = 0U;
+    bool preferredTurn = true;
+
+    assert( pListHead != NULL );
+    assert( pAddresses != NULL );
+
+    preferredFamily = pListHead->ai_family;
+    pPreferred = pListHead;
+    pOther = findAddressFamily( pListHead, preferredFamily, false );
+
+    while( ( addressCount < maxAddresses ) && ( ( pPreferred != NULL ) || ( pOther != NULL ) ) )
+    {
+        if( ( pOther == NULL ) || ( ( preferredTurn == true ) && ( pPreferred != NULL ) ) )
+        {
+            pAddresses[ addressCount ] = pPreferred;
+            pPreferred = findAddressFamily( pPreferred->ai_next, preferredFamily, true );
+        }
+        else
+        {
+            pAddresses[ addressCount ] = pOther;
+            pOther = findAddressFamily( pOther->ai_next, preferredFamily, false );
+        }
+
+        addressCount++;
+        preferredTurn = !preferredTurn;
+    }
+
+    return addressCount;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t startConnection( const struct addrinfo * pAddrInfo,
+                                       uint16_t port,
+                                       const SocketOptions_t * pSocketOptions,
+                                       int32_t * pTcpSocket,
+                                       bool * pConnected )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    int32_t connectStatus = 0;
+    char resolvedIpAddr[ INET6_ADDRSTRLEN ];
+    socklen_t addrInfoLength;
+
+    assert( pAddrInfo != NULL );
+    assert( pTcpSocket != NULL );
+    assert( pConnected != NULL );
+
+    *pConnected = false;
+    *pTcpSocket = socket( pAddrInfo->ai_family,
+                          pAddrInfo->ai_socktype,
+                          pAddrInfo->ai_protocol );
+
+    if( *pTcpSocket == -1 )
+    {
+        returnStatus = SOCKETS_CONNECT_FAILURE;
+    }
+    else
+    {
+        if( pSocketOptions != NULL )
+        {
+            setSocketOptions( *pTcpSocket, pSocketOptions );
+        }
+
+        returnStatus = setSocketNonBlocking( *pTcpSocket, true );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        addrInfoLength = setAddressPort( pAddrInfo->ai_addr, port, resolvedIpAddr );
+
+        LogDebug( ( "Starting connection attempt to the resolved IP address:"
+                    " IP address=%s.",
+                    resolvedIpAddr ) );
+
+        connectStatus = connect( *pTcpSocket, pAddrInfo->ai_addr, addrInfoLength );
+
+        if( connectStatus == 0 )
+        {
+            *pConnected = true;
+        }
+        else if( errno != EINPROGRESS )
+        {
+            LogWarn( ( "Failed to connect to server using the resolved IP address: IP address=%s.",
+                       resolvedIpAddr ) );
+            returnStatus = SOCKETS_CONNECT_FAILURE;
+        }
+        else
+        {
+            /* Empty else. The connection is in progress. */
+        }
+    }
+
+    if( ( returnStatus != SOCKETS_SUCCESS ) && ( *pTcpSocket != -1 ) )
+    {
+        ( void ) close( *pTcpSocket );
+        *pTcpSocket = -1;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t getPollTimeout( uint32_t attemptDelayMs,
+                               uint64_t deadlineMs )
+{
+    int32_t timeoutMs = -1;
+    uint64_t nowMs = 0U;
+
+    if( attemptDelayMs > 0U )
+    {
+        timeoutMs = ( int32_t ) attemptDelayMs;
+    }
+
+    if( deadlineMs > 0U )
+    {
+        nowMs = Clock_GetTimeNs() / ONE_MS_TO_NS;
+
+        if( nowMs >= deadlineMs )
+        {
+            timeoutMs = 0;
+        }
+        else if( ( timeoutMs == -1 ) || ( ( deadlineMs - nowMs ) < ( uint64_t ) timeoutMs ) )
+        {
+            timeoutMs = ( int32_t ) ( deadlineMs - nowMs );
+        }
+        else
+        {
+            /* Empty else. The next attempt is due before the deadline. */
+        }
+    }
+
+    return timeoutMs;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t raceConnections( struct addrinfo * pListHead,
+                                       uint16_t port,
+                                       const SocketsConfig_t * pSocketsConfig,
+                                       int32_t * pTcpSocket )
+{
+    SocketStatus_t returnStatus = SOCKETS_CONNECT_FAILURE;
+    struct addrinfo * pAddresses[ SOCKETS_MAX_CONNECTION_ATTEMPTS ];
+    struct pollfd attempts[ SOCKETS_MAX_CONNECTION_ATTEMPTS ];
+    size_t addressCount = 0U, startedCount = 0U, pendingCount = 0U, i = 0U;
+    int32_t pollStatus = 0, socketError = 0;
+    socklen_t socketErrorLength;
+    uint64_t deadlineMs = 0U;
+    bool startNext = true, connected = false, pollFailed = false, timedOut = false;
+    uint32_t attemptDelayMs = 0U, connectTimeoutMs = 0U;
+
+    assert( pListHead != NULL );
+    assert( pSocketsConfig != NULL );
+    assert( pTcpSocket != NULL );
+
+    attemptDelayMs = pSocketsConfig->connectionAttemptDelayMs;
+    connectTimeoutMs = pSocketsConfig->connectTimeoutMs;
+
+    addressCount = interleaveAddressFamilies( pListHead,
+                                              pAddresses,
+                                              SOCKETS_MAX_CONNECTION_ATTEMPTS );
+    *pTcpSocket = -1;
+
+    if( connectTimeoutMs > 0U )
+    {
+        deadlineMs = ( Clock_GetTimeNs() / ONE_MS_TO_NS ) + connectTimeoutMs;
+    }
+
+    while( ( *pTcpSocket == -1 ) && ( pollFailed == false ) && ( timedOut == false ) &&
+           ( ( startedCount < addressCount ) || ( pendingCount > 0U ) ) )
+    {
+        /* Start the next attempt when the delay expired or when no attempt
+         * is in progress. */
+        if( ( startedCount < addressCount ) && ( ( startNext == true ) || ( pendingCount == 0U ) ) )
+        {
+            attempts[ startedCount ].events = POLLOUT;
+            attempts[ startedCount ].revents = 0;
+
+            if( startConnection( pAddresses[ startedCount ],
+                                 port,
+                                 pSocketsConfig->pSocketOptions,
+                                 &attempts[ startedCount ].fd,
+                                 &connected ) == SOCKETS_SUCCESS )
+            {
+                pendingCount++;
+
+                if( connected == true )
+                {
+                    *pTcpSocket = attempts[ startedCount ].fd;
+                }
+            }
+
+            startedCount++;
+            startNext = false;
+        }
+        else
+        {
+            /* Wait for an attempt to complete, or until the next attempt is
+             * due. Sockets of failed attempts are -1 and ignored by #poll. */
+            pollStatus = poll( attempts,
+                               ( nfds_t ) startedCount,
+                               getPollTimeout( ( startedCount < addressCount ) ? attemptDelayMs : 0U,
+                                               deadlineMs ) );
+
+            if( ( pollStatus == 0 ) && ( deadlineMs > 0U ) && ( ( Clock_GetTimeNs() / ONE_MS_TO_NS ) >= deadlineMs ) )
+            {
+                LogError( ( "Connection attempts timed out after %u ms.",
+                            ( unsigned int ) connectTimeoutMs ) );
+                timedOut = true;
+            }
+            else if( ( pollStatus == 0 ) && ( attemptDelayMs > 0U ) )
+            {
+                startNext = true;
+            }
+            else if( ( pollStatus < 0 ) && ( errno != EINTR ) )
+            {
+                LogError( ( "Waiting for connection attempts failed: %s.", strerror( errno ) ) );
+                pollFailed = true;
+            }
+            else
+            {
+                /* Empty else. */
+            }
+
+            for( i = 0U; ( pollStatus > 0 ) && ( i < startedCount ) && ( *pTcpSocket == -1 ); i++ )
+            {
+                if( ( attempts[ i ].fd != -1 ) && ( attempts[ i ].revents != 0 ) )
+                {
+                    socketErrorLength = ( socklen_t ) sizeof( socketError );
+
+                    if( ( getsockopt( attempts[ i ].fd,
+                                      SOL_SOCKET,
+                                      SO_ERROR,
+                                      &socketError,
+                                      &socketErrorLength ) == 0 ) &&
+                        ( socketError == 0 ) )
+                    {
+                        *pTcpSocket = attempts[ i ].fd;
+                    }
+                    else
+                    {
+                        LogWarn( ( "Connection attempt %u failed.", ( unsigned int ) i ) );
+                        ( void ) close( attempts[ i ].fd );
+                        attempts[ i ].fd = -1;
+                        pendingCount--;
+                    }
+                }
+            }
+        }
+    }
+
+    /* Close the attempts that lost the race. */
+    for( i = 0U; i < startedCount; i++ )
+    {
+        if( ( attempts[ i ].fd != -1 ) && ( attempts[ i ].fd != *pTcpSocket ) )
+        {
+            ( void ) close( attempts[ i ].fd );
+        }
+    }
+
+    if( *pTcpSocket != -1 )
+    {
+        returnStatus = SOCKETS_SUCCESS;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
 static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
                                          const char * pHostName,
                                          size_t hostNameLength,
                                          uint16_t port,
+                                         const SocketsConfig_t * pSocketsConfig,
                                          int32_t * pTcpSocket )
 {
     SocketStatus_t returnStatus = SOCKETS_CONNECT_FAILURE;
@@ -227,6 +716,7 @@ static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
     assert( pListHead != NULL );
     assert( pHostName != NULL );
     assert( hostNameLength > 0 );
+    assert( pSocketsConfig != NULL );
     assert( pTcpSocket != NULL );
 
     /* Unused parameters when logging is disabled. */
@@ -237,25 +727,41 @@ static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
                 ( int32_t ) hostNameLength,
                 pHostName ) );
 
-    /* Attempt to connect to one of the retrieved DNS records. */
-    for( pIndex = pListHead; pIndex != NULL; pIndex = pIndex->ai_next )
+    if( ( pSocketsConfig->connectionAttemptDelayMs > 0U ) ||
+        ( pSocketsConfig->connectTimeoutMs > 0U ) )
     {
-        *pTcpSocket = socket( pIndex->ai_family,
-                              pIndex->ai_socktype,
-                              pIndex->ai_protocol );
-
-        if( *pTcpSocket == -1 )
+        returnStatus = raceConnections( pListHead,
+                                        port,
+                                        pSocketsConfig,
+                                        pTcpSocket );
+    }
+    else
+    {
+        /* Attempt to connect to one of the retrieved DNS records. */
+        for( pIndex = pListHead; pIndex != NULL; pIndex = pIndex->ai_next )
         {
-            continue;
-        }
+            *pTcpSocket = socket( pIndex->ai_family,
+                                  pIndex->ai_socktype,
+                                  pIndex->ai_protocol );
 
-        /* Attempt to connect to a resolved DNS address of the host. */
-        returnStatus = connectToAddress( pIndex->ai_addr, port, *pTcpSocket );
+            if( *pTcpSocket == -1 )
+            {
+                continue;
+            }
 
-        /* If connected to an IP address successfully, exit from the loop. */
-        if( returnStatus == SOCKETS_SUCCESS )
-        {
-            break;
+            if( pSocketsConfig->pSocketOptions != NULL )
+            {
+                setSocketOptions( *pTcpSocket, pSocketsConfig->pSocketOptions );
+            }
+
+            /* Attempt to connect to a resolved DNS address of the host. */
+            returnStatus = connectToAddress( pIndex->ai_addr, port, *pTcpSocket );
+
+            /* If connected to an IP address successfully, exit from the loop. */
+            if( returnStatus == SOCKETS_SUCCESS )
+            {
+                break;
+            }
         }
     }
 
@@ -272,12 +778,110 @@ static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
                     pHostName ) );
     }
 
-    freeaddrinfo( pListHead );
-
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
+static void setIntegerOption( int32_t tcpSocket,
+                              int32_t level,
+                              int32_t optionName,
+                              int32_t optionValue,
+                              const char * pOptionName )
+{
+    /* Unused parameter when logging is disabled. */
+    ( void ) pOptionName;
+
+    if( setsockopt( tcpSocket,
+                    level,
+                    optionName,
+                    &optionValue,
+                    ( socklen_t ) sizeof( optionValue ) ) < 0 )
+    {
+        LogWarn( ( "Setting socket option %s to %d failed: %s.",
+                   pOptionName,
+                   ( int ) optionValue,
+                   strerror( errno ) ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void setSocketOptions( int32_t tcpSocket,
+                              const SocketOptions_t * pSocketOptions )
+{
+    assert( pSocketOptions != NULL );
+
+    if( pSocketOptions->noDelay == true )
+    {
+        setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY" );
+    }
+
+    if( pSocketOptions->keepAlive == true )
+    {
+        setIntegerOption( tcpSocket, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE" );
+
+        #if defined( TCP_KEEPIDLE ) && defined( TCP_KEEPINTVL ) && defined( TCP_KEEPCNT )
+            if( pSocketOptions->keepAliveIdleSec > 0U )
+            {
+                setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_KEEPIDLE,
+                                  ( int32_t ) pSocketOptions->keepAliveIdleSec, "TCP_KEEPIDLE" );
+            }
+
+            if( pSocketOptions->keepAliveIntervalSec > 0U )
+            {
+                setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_KEEPINTVL,
+                                  ( int32_t ) pSocketOptions->keepAliveIntervalSec, "TCP_KEEPINTVL" );
+            }
+
+            if( pSocketOptions->keepAliveProbeCount > 0U )
+            {
+                setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_KEEPCNT,
+                                  ( int32_t ) pSocketOptions->keepAliveProbeCount, "TCP_KEEPCNT" );
+            }
+        #else
+            if( ( pSocketOptions->keepAliveIdleSec > 0U ) ||
+                ( pSocketOptions->keepAliveIntervalSec > 0U ) ||
+                ( pSocketOptions->keepAliveProbeCount > 0U ) )
+            {
+                LogWarn( ( "The keep-alive timing cannot be set on this platform." ) );
+            }
+        #endif
+    }
+
+    /* The buffer sizes are set before connecting so that the TCP window
+     * scale negotiated in the handshake matches them. */
+    if( pSocketOptions->sendBufferSize > 0U )
+    {
+        setIntegerOption( tcpSocket, SOL_SOCKET, SO_SNDBUF,
+                          ( int32_t ) pSocketOptions->sendBufferSize, "SO_SNDBUF" );
+    }
+
+    if( pSocketOptions->receiveBufferSize > 0U )
+    {
+        setIntegerOption( tcpSocket, SOL_SOCKET, SO_RCVBUF,
+                          ( int32_t ) pSocketOptions->receiveBufferSize, "SO_RCVBUF" );
+    }
+
+    if( pSocketOptions->userTimeoutMs > 0U )
+    {
+        #ifdef TCP_USER_TIMEOUT
+            setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                              ( int32_t ) pSocketOptions->userTimeoutMs, "TCP_USER_TIMEOUT" );
+        #else
+            LogWarn( ( "TCP_USER_TIMEOUT is not supported on this platform." ) );
+        #endif
+    }
+
+    if( pSocketOptions->fastOpen == true )
+    {
+        #ifdef TCP_FASTOPEN_CONNECT
+            setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, "TCP_FASTOPEN_CONNECT" );
+        #else
+            LogWarn( ( "TCP Fast Open is not supported on this platform." ) );
+        #endif
+    }
+}
+/*-----------------------------------------------------------*/
+
 static SocketStatus_t retrieveError( int32_t errorNumber )
 {
     SocketStatus_t returnStatus = SOCKETS_API_ERROR;
@@ -301,15 +905,139 @@ static SocketStatus_t retrieveError( int32_t errorNumber )
 }
 /*-----------------------------------------------------------*/
 
+static SocketStatus_t configureConnectedSocket( int32_t tcpSocket,
+                                                const SocketsConfig_t * pSocketsConfig,
+                                                bool nonBlockingConnect )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    assert( pSocketsConfig != NULL );
+
+    /* A non-blocking socket never blocks for the socket timeouts, so they are
+     * left to the transport instead of being set on the socket. Sockets
+     * connected with a non-blocking connect are already non-blocking. */
+    if( pSocketsConfig->nonBlocking == true )
+    {
+        if( nonBlockingConnect == false )
+        {
+            returnStatus = setSocketNonBlocking( tcpSocket, true );
+        }
+    }
+    else
+    {
+        if( nonBlockingConnect == true )
+        {
+            returnStatus = setSocketNonBlocking( tcpSocket, false );
+        }
+
+        if( returnStatus == SOCKETS_SUCCESS )
+        {
+            returnStatus = setSocketTimeouts( tcpSocket,
+                                              pSocketsConfig->sendTimeoutMs,
+                                              pSocketsConfig->recvTimeoutMs );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t setSocketTimeouts( int32_t tcpSocket,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct timeval transportTimeout;
+    int32_t setTimeoutStatus = -1;
+
+    /* Set the send timeout. */
+    transportTimeout.tv_sec = ( ( ( int64_t ) sendTimeoutMs ) / ONE_SEC_TO_MS );
+    transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) sendTimeoutMs ) % ONE_SEC_TO_MS ) );
+
+    setTimeoutStatus = setsockopt( tcpSocket,
+                                   SOL_SOCKET,
+                                   SO_SNDTIMEO,
+                                   &transportTimeout,
+                                   ( socklen_t ) sizeof( transportTimeout ) );
+
+    if( setTimeoutStatus < 0 )
+    {
+        LogError( ( "Setting socket send timeout failed." ) );
+        returnStatus = retrieveError( errno );
+    }
+
+    /* Set the receive timeout. */
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        transportTimeout.tv_sec = ( ( ( int64_t ) recvTimeoutMs ) / ONE_SEC_TO_MS );
+        transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) recvTimeoutMs ) % ONE_SEC_TO_MS ) );
+
+        setTimeoutStatus = setsockopt( tcpSocket,
+                                       SOL_SOCKET,
+                                       SO_RCVTIMEO,
+                                       &transportTimeout,
+                                       ( socklen_t ) sizeof( transportTimeout ) );
+
+        if( setTimeoutStatus < 0 )
+        {
+            LogError( ( "Setting socket receive timeout failed." ) );
+            returnStatus = retrieveError( errno );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t setSocketNonBlocking( int32_t tcpSocket,
+                                            bool nonBlocking )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    int32_t socketFlags = -1;
+
+    socketFlags = fcntl( tcpSocket, F_GETFL );
+
+    if( socketFlags >= 0 )
+    {
+        socketFlags = ( nonBlocking == true ) ? ( socketFlags | O_NONBLOCK ) :
+                      ( socketFlags & ~O_NONBLOCK );
+        socketFlags = fcntl( tcpSocket, F_SETFL, socketFlags );
+    }
+
+    if( socketFlags < 0 )
+    {
+        LogError( ( "Setting socket blocking mode failed." ) );
+        returnStatus = retrieveError( errno );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
 SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
                                 const ServerInfo_t * pServerInfo,
                                 uint32_t sendTimeoutMs,
                                 uint32_t recvTimeoutMs )
+{
+    SocketsConfig_t socketsConfig;
+
+    ( void ) memset( &socketsConfig, 0x00, sizeof( socketsConfig ) );
+    socketsConfig.sendTimeoutMs = sendTimeoutMs;
+    socketsConfig.recvTimeoutMs = recvTimeoutMs;
+
+    return Sockets_ConnectWithConfig( pTcpSocket, pServerInfo, &socketsConfig );
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_ConnectWithConfig( int32_t * pTcpSocket,
+                                          const ServerInfo_t * pServerInfo,
+                                          const SocketsConfig_t * pSocketsConfig )
 {
     SocketStatus_t returnStatus = SOCKETS_SUCCESS;
     struct addrinfo * pListHead = NULL;
-    struct timeval transportTimeout;
-    int32_t setTimeoutStatus = -1;
+    DnsCacheRecord_t dnsCacheRecord;
+    bool nonBlockingConnect = false;
+    ConnectTiming_t * pConnectTiming = NULL;
 
     if( pServerInfo == NULL )
     {
@@ -331,6 +1059,11 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
         LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
         returnStatus = SOCKETS_INVALID_PARAMETER;
     }
+    else if( pSocketsConfig == NULL )
+    {
+        LogError( ( "Parameter check failed: pSocketsConfig is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
     else
     {
         /* Empty else. */
@@ -338,58 +1071,177 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
 
     if( returnStatus == SOCKETS_SUCCESS )
     {
-        returnStatus = resolveHostName( pServerInfo->pHostName,
-                                        pServerInfo->hostNameLength,
-                                        &pListHead );
+        pConnectTiming = pSocketsConfig->pConnectTiming;
+
+        if( ( pConnectTiming != NULL ) && ( pConnectTiming->startUs == 0U ) )
+        {
+            pConnectTiming->startUs = Clock_GetTimeUs();
+        }
+
+        TRACE_PROBE2( dns_resolve_start, pServerInfo->pHostName, pServerInfo->hostNameLength );
+
+        if( pSocketsConfig->useDnsCache == true )
+        {
+            if( DnsCache_Resolve( pServerInfo->pHostName,
+                                  pServerInfo->hostNameLength,
+                                  &dnsCacheRecord ) == DNS_CACHE_SUCCESS )
+            {
+                pListHead = &dnsCacheRecord.addrInfo[ 0 ];
+            }
+            else
+            {
+                returnStatus = SOCKETS_DNS_FAILURE;
+            }
+        }
+        else
+        {
+            returnStatus = resolveHostName( pServerInfo->pHostName,
+                                            pServerInfo->hostNameLength,
+                                            &pListHead );
+        }
+
+        TRACE_PROBE2( dns_resolve_end, pServerInfo->pHostName, returnStatus );
+
+        if( ( pConnectTiming != NULL ) && ( returnStatus == SOCKETS_SUCCESS ) )
+        {
+            pConnectTiming->dnsResolvedUs = Clock_GetTimeUs();
+            pConnectTiming->dnsCacheUsed = pSocketsConfig->useDnsCache;
+        }
     }
 
     if( returnStatus == SOCKETS_SUCCESS )
     {
+        nonBlockingConnect = ( pSocketsConfig->connectionAttemptDelayMs > 0U ) ||
+                             ( pSocketsConfig->connectTimeoutMs > 0U );
+        TRACE_PROBE2( tcp_connect_start, pServerInfo->pHostName, pServerInfo->port );
         returnStatus = attemptConnection( pListHead,
                                           pServerInfo->pHostName,
                                           pServerInfo->hostNameLength,
                                           pServerInfo->port,
+                                          pSocketsConfig,
                                           pTcpSocket );
+        TRACE_PROBE2( tcp_connect_end, pServerInfo->pHostName, returnStatus );
+
+        if( ( pConnectTiming != NULL ) && ( returnStatus == SOCKETS_SUCCESS ) )
+        {
+            pConnectTiming->tcpConnectedUs = Clock_GetTimeUs();
+        }
+
+        if( pSocketsConfig->useDnsCache == false )
+        {
+            freeaddrinfo( pListHead );
+        }
+        else if( returnStatus != SOCKETS_SUCCESS )
+        {
+            /* The cached addresses may be stale. */
+            ( void ) DnsCache_Invalidate( pServerInfo->pHostName,
+                                          pServerInfo->hostNameLength );
+        }
+        else
+        {
+            /* Empty else. */
+        }
     }
 
-    /* Set the send timeout. */
     if( returnStatus == SOCKETS_SUCCESS )
     {
-        transportTimeout.tv_sec = ( ( ( int64_t ) sendTimeoutMs ) / ONE_SEC_TO_MS );
-        transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) sendTimeoutMs ) % ONE_SEC_TO_MS ) );
+        returnStatus = configureConnectedSocket( *pTcpSocket,
+                                                 pSocketsConfig,
+                                                 nonBlockingConnect );
+    }
 
-        setTimeoutStatus = setsockopt( *pTcpSocket,
-                                       SOL_SOCKET,
-                                       SO_SNDTIMEO,
-                                       &transportTimeout,
-                                       ( socklen_t ) sizeof( transportTimeout ) );
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
 
-        if( setTimeoutStatus < 0 )
+SocketStatus_t Sockets_ConnectUnix( int32_t * pUnixSocket,
+                                    const char * pSocketPath,
+                                    size_t socketPathLength,
+                                    const SocketsConfig_t * pSocketsConfig )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct sockaddr_un address;
+    int32_t unixSocket = -1;
+
+    if( pUnixSocket == NULL )
+    {
+        LogError( ( "Parameter check failed: pUnixSocket is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pSocketPath == NULL )
+    {
+        LogError( ( "Parameter check failed: pSocketPath is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( ( socketPathLength == 0U ) ||
+             ( socketPathLength >= sizeof( address.sun_path ) ) )
+    {
+        LogError( ( "Parameter check failed: socketPathLength must be between 1 and %lu.",
+                    ( unsigned long ) ( sizeof( address.sun_path ) - 1U ) ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pSocketsConfig == NULL )
+    {
+        LogError( ( "Parameter check failed: pSocketsConfig is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        unixSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+        if( unixSocket == -1 )
         {
-            LogError( ( "Setting socket send timeout failed." ) );
+            LogError( ( "Failed to create a Unix domain socket." ) );
             returnStatus = retrieveError( errno );
         }
     }
 
-    /* Set the receive timeout. */
     if( returnStatus == SOCKETS_SUCCESS )
     {
-        transportTimeout.tv_sec = ( ( ( int64_t ) recvTimeoutMs ) / ONE_SEC_TO_MS );
-        transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) recvTimeoutMs ) % ONE_SEC_TO_MS ) );
-
-        setTimeoutStatus = setsockopt( *pTcpSocket,
-                                       SOL_SOCKET,
-                                       SO_RCVTIMEO,
-                                       &transportTimeout,
-                                       ( socklen_t ) sizeof( transportTimeout ) );
+        ( void ) memset( &address, 0x00, sizeof( address ) );
+        address.sun_family = AF_UNIX;
+        ( void ) memcpy( address.sun_path, pSocketPath, socketPathLength );
 
-        if( setTimeoutStatus < 0 )
+        /* The length of the address, rather than a terminating NUL, ends the
+         * path, so that a Linux abstract address that starts with NUL works.
+         * MISRA Rule 11.3 flags the cast to a struct sockaddr pointer, which is
+         * how POSIX passes addresses of every family to connect. */
+        /* coverity[misra_c_2012_rule_11_3_violation] */
+        if( connect( unixSocket,
+                     ( struct sockaddr * ) &address,
+                     ( socklen_t ) ( offsetof( struct sockaddr_un, sun_path ) + socketPathLength ) ) == -1 )
         {
-            LogError( ( "Setting socket receive timeout failed." ) );
-            returnStatus = retrieveError( errno );
+            LogError( ( "Failed to connect to the Unix domain socket: Path=%.*s, Error=%s.",
+                        ( int32_t ) socketPathLength,
+                        pSocketPath,
+                        strerror( errno ) ) );
+            returnStatus = SOCKETS_CONNECT_FAILURE;
         }
     }
 
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = configureConnectedSocket( unixSocket, pSocketsConfig, false );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        *pUnixSocket = unixSocket;
+    }
+    else if( unixSocket != -1 )
+    {
+        ( void ) close( unixSocket );
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
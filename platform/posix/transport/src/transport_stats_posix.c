@@ -0,0 +1,99 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "transport_stats_posix.h"
+
+#if ( TRANSPORT_STATS_ENABLED != 0 )
+
+/*-----------------------------------------------------------*/
+
+void TransportStats_RecordCall( TransportStats_t * pStats,
+                                bool isSend,
+                                int32_t result,
+                                uint64_t startTimeUs )
+{
+    if( pStats != NULL )
+    {
+        if( isSend == true )
+        {
+            pStats->sendCalls++;
+        }
+        else
+        {
+            pStats->recvCalls++;
+        }
+
+        if( result < 0 )
+        {
+            pStats->errors++;
+        }
+        else if( result == 0 )
+        {
+            if( isSend == true )
+            {
+                pStats->sendTimeouts++;
+            }
+            else
+            {
+                pStats->recvTimeouts++;
+            }
+        }
+        else if( isSend == true )
+        {
+            pStats->bytesSent += ( uint64_t ) result;
+        }
+        else
+        {
+            pStats->bytesReceived += ( uint64_t ) result;
+        }
+
+        pStats->blockedTimeUs += Clock_GetTimeUs() - startTimeUs;
+    }
+}
+/*-----------------------------------------------------------*/
+
+bool TransportStats_Snapshot( TransportStats_t * pStats,
+                              TransportStats_t * pSnapshot,
+                              bool reset )
+{
+    bool returnStatus = false;
+
+    if( ( pStats != NULL ) && ( pSnapshot != NULL ) )
+    {
+        *pSnapshot = *pStats;
+
+        if( reset == true )
+        {
+            ( void ) memset( pStats, 0, sizeof( TransportStats_t ) );
+        }
+
+        returnStatus = true;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TRANSPORT_STATS_ENABLED != 0 ) */
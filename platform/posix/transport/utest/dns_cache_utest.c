@@ -0,0 +1,299 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "/usr/include/errno.h"
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "dns_cache_posix.h"
+
+#include "mock_netdb.h"
+#include "mock_unistd_api.h"
+#include "mock_pthread_api.h"
+
+/* The host name to resolve. */
+#define HOSTNAME              "amazon.com"
+
+/* The number of addresses returned from #getaddrinfo. */
+#define NUM_ADDRESSES         2
+
+/* The descriptors returned from #pipe. */
+#define NOTIFY_DESCRIPTOR     3
+#define SIGNAL_DESCRIPTOR     4
+
+static struct sockaddr_in resolvedAddresses[ NUM_ADDRESSES ];
+static struct addrinfo addrInfo[ NUM_ADDRESSES ];
+static struct addrinfo * pAddrInfo = &addrInfo[ 0 ];
+static DnsCacheRecord_t record;
+static DnsCacheRequest_t request;
+static int pipeDescriptors[ 2 ] = { NOTIFY_DESCRIPTOR, SIGNAL_DESCRIPTOR };
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    size_t i;
+
+    for( i = 0; i < NUM_ADDRESSES; i++ )
+    {
+        memset( &resolvedAddresses[ i ], 0, sizeof( struct sockaddr_in ) );
+        resolvedAddresses[ i ].sin_family = AF_INET;
+        resolvedAddresses[ i ].sin_addr.s_addr = ( in_addr_t ) ( i + 1U );
+
+        memset( &addrInfo[ i ], 0, sizeof( struct addrinfo ) );
+        addrInfo[ i ].ai_family = AF_INET;
+        addrInfo[ i ].ai_socktype = SOCK_STREAM;
+        addrInfo[ i ].ai_protocol = IPPROTO_TCP;
+        addrInfo[ i ].ai_addrlen = sizeof( struct sockaddr_in );
+        addrInfo[ i ].ai_addr = ( struct sockaddr * ) &resolvedAddresses[ i ];
+        addrInfo[ i ].ai_next = ( i + 1U < NUM_ADDRESSES ) ? &addrInfo[ i + 1U ] : NULL;
+    }
+
+    DnsCache_Clear();
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Expect the calls that resolve #HOSTNAME with #getaddrinfo.
+ */
+static void expectResolve( void )
+{
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pAddrInfo );
+    freeaddrinfo_ExpectAnyArgs();
+}
+
+/**
+ * @brief Stub for #pthread_create that runs the worker on the calling thread.
+ */
+static int pthread_create_Stub( pthread_t * __newthread,
+                                const pthread_attr_t * __attr,
+                                ThreadStartRoutine_t __start_routine,
+                                void * __arg,
+                                int numCalls )
+{
+    ( void ) __newthread;
+    ( void ) __attr;
+    ( void ) numCalls;
+
+    ( void ) __start_routine( __arg );
+
+    return 0;
+}
+
+/**
+ * @brief Test that the DNS cache functions validate their parameters.
+ */
+void test_DnsCache_Invalid_Params( void )
+{
+    char longHostName[ DNS_CACHE_MAX_HOST_NAME_LENGTH + 1U ] = { 0 };
+
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_Resolve( NULL, strlen( HOSTNAME ), &record ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_Resolve( HOSTNAME, strlen( HOSTNAME ), NULL ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_Resolve( HOSTNAME, 0, &record ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_Resolve( longHostName, sizeof( longHostName ), &record ) );
+
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_ResolveAsync( NULL, HOSTNAME, strlen( HOSTNAME ) ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_ResolveAsync( &request, NULL, strlen( HOSTNAME ) ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_ResolveAsync( &request, HOSTNAME, 0 ) );
+
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER, DnsCache_FinishResolve( NULL ) );
+    request.notifyDescriptor = -1;
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER, DnsCache_FinishResolve( &request ) );
+
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_Invalidate( NULL, strlen( HOSTNAME ) ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_INVALID_PARAMETER,
+                       DnsCache_Invalidate( HOSTNAME, 0 ) );
+}
+
+/**
+ * @brief Test that #DnsCache_Resolve returns the addresses from
+ * #getaddrinfo as a linked list, and from the cache afterwards.
+ */
+void test_DnsCache_Resolve_Caches_Addresses( void )
+{
+    struct sockaddr_in * pAddress;
+    size_t i;
+
+    expectResolve();
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_Resolve( HOSTNAME, strlen( HOSTNAME ), &record ) );
+
+    /* No call to #getaddrinfo is expected. */
+    memset( &record, 0, sizeof( record ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_Resolve( HOSTNAME, strlen( HOSTNAME ), &record ) );
+
+    TEST_ASSERT_EQUAL( NUM_ADDRESSES, record.addressCount );
+
+    for( i = 0; i < NUM_ADDRESSES; i++ )
+    {
+        pAddress = ( struct sockaddr_in * ) record.addrInfo[ i ].ai_addr;
+        TEST_ASSERT_EQUAL_PTR( &record.addresses[ i ], pAddress );
+        TEST_ASSERT_EQUAL( AF_INET, record.addrInfo[ i ].ai_family );
+        TEST_ASSERT_EQUAL( sizeof( struct sockaddr_in ), record.addrInfo[ i ].ai_addrlen );
+        TEST_ASSERT_EQUAL( resolvedAddresses[ i ].sin_addr.s_addr, pAddress->sin_addr.s_addr );
+    }
+
+    TEST_ASSERT_EQUAL_PTR( &record.addrInfo[ 1 ], record.addrInfo[ 0 ].ai_next );
+    TEST_ASSERT_NULL( record.addrInfo[ NUM_ADDRESSES - 1 ].ai_next );
+}
+
+/**
+ * @brief Test that #DnsCache_Resolve fails when the host name cannot be
+ * resolved, and resolves again after #DnsCache_Invalidate.
+ */
+void test_DnsCache_Resolve_Failure_And_Invalidate( void )
+{
+    getaddrinfo_ExpectAnyArgsAndReturn( EAI_NONAME );
+    TEST_ASSERT_EQUAL( DNS_CACHE_DNS_FAILURE,
+                       DnsCache_Resolve( HOSTNAME, strlen( HOSTNAME ), &record ) );
+
+    /* A list without addresses is a failure too. */
+    addrInfo[ 0 ].ai_addr = NULL;
+    addrInfo[ 0 ].ai_next = NULL;
+    expectResolve();
+    TEST_ASSERT_EQUAL( DNS_CACHE_DNS_FAILURE,
+                       DnsCache_Resolve( HOSTNAME, strlen( HOSTNAME ), &record ) );
+    addrInfo[ 0 ].ai_addr = ( struct sockaddr * ) &resolvedAddresses[ 0 ];
+    addrInfo[ 0 ].ai_next = &addrInfo[ 1 ];
+
+    expectResolve();
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_Resolve( HOSTNAME, strlen( HOSTNAME ), &record ) );
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_Invalidate( HOSTNAME, strlen( HOSTNAME ) ) );
+
+    expectResolve();
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_Resolve( HOSTNAME, strlen( HOSTNAME ), &record ) );
+}
+
+/**
+ * @brief Test that the cache replaces the entry that expires first when it
+ * is full.
+ */
+void test_DnsCache_Resolve_Replaces_Oldest_Entry( void )
+{
+    char hostNames[ DNS_CACHE_MAX_ENTRIES + 1U ][ 2 ];
+    size_t i;
+
+    for( i = 0; i <= DNS_CACHE_MAX_ENTRIES; i++ )
+    {
+        hostNames[ i ][ 0 ] = ( char ) ( 'a' + i );
+        hostNames[ i ][ 1 ] = '\0';
+        expectResolve();
+        TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                           DnsCache_Resolve( hostNames[ i ], 1, &record ) );
+    }
+
+    /* The first host name was replaced, while the last one is cached. */
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_Resolve( hostNames[ DNS_CACHE_MAX_ENTRIES ], 1, &record ) );
+    expectResolve();
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_Resolve( hostNames[ 0 ], 1, &record ) );
+}
+
+/**
+ * @brief Test that #DnsCache_ResolveAsync resolves on a worker thread that
+ * signals the notify descriptor, and that #DnsCache_FinishResolve returns
+ * the status of the resolve.
+ */
+void test_DnsCache_ResolveAsync( void )
+{
+    pipe_ExpectAnyArgsAndReturn( 0 );
+    pipe_ReturnArrayThruPtr___pipedes( pipeDescriptors, 2 );
+    pthread_create_StubWithCallback( pthread_create_Stub );
+    expectResolve();
+    write_ExpectAnyArgsAndReturn( 1 );
+    TEST_ASSERT_EQUAL( DNS_CACHE_IN_PROGRESS,
+                       DnsCache_ResolveAsync( &request, HOSTNAME, strlen( HOSTNAME ) ) );
+    TEST_ASSERT_EQUAL( NOTIFY_DESCRIPTOR, request.notifyDescriptor );
+
+    pthread_join_ExpectAnyArgsAndReturn( 0 );
+    close_ExpectAndReturn( NOTIFY_DESCRIPTOR, 0 );
+    close_ExpectAndReturn( SIGNAL_DESCRIPTOR, 0 );
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS, DnsCache_FinishResolve( &request ) );
+    TEST_ASSERT_EQUAL( -1, request.notifyDescriptor );
+
+    /* The host name is now cached, so nothing needs to be waited for. */
+    TEST_ASSERT_EQUAL( DNS_CACHE_SUCCESS,
+                       DnsCache_ResolveAsync( &request, HOSTNAME, strlen( HOSTNAME ) ) );
+    TEST_ASSERT_EQUAL( -1, request.notifyDescriptor );
+
+    pthread_create_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Test that #DnsCache_ResolveAsync and #DnsCache_FinishResolve fail
+ * when a system API fails.
+ */
+void test_DnsCache_ResolveAsync_API_Errors( void )
+{
+    pipe_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( DNS_CACHE_API_ERROR,
+                       DnsCache_ResolveAsync( &request, HOSTNAME, strlen( HOSTNAME ) ) );
+
+    pipe_ExpectAnyArgsAndReturn( 0 );
+    pipe_ReturnArrayThruPtr___pipedes( pipeDescriptors, 2 );
+    pthread_create_ExpectAnyArgsAndReturn( EAGAIN );
+    close_ExpectAndReturn( NOTIFY_DESCRIPTOR, 0 );
+    close_ExpectAndReturn( SIGNAL_DESCRIPTOR, 0 );
+    TEST_ASSERT_EQUAL( DNS_CACHE_API_ERROR,
+                       DnsCache_ResolveAsync( &request, HOSTNAME, strlen( HOSTNAME ) ) );
+    TEST_ASSERT_EQUAL( -1, request.notifyDescriptor );
+
+    request.notifyDescriptor = NOTIFY_DESCRIPTOR;
+    pthread_join_ExpectAnyArgsAndReturn( EINVAL );
+    TEST_ASSERT_EQUAL( DNS_CACHE_API_ERROR, DnsCache_FinishResolve( &request ) );
+}
@@ -0,0 +1,360 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "/usr/include/errno.h"
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "event_loop_posix.h"
+
+#include "mock_epoll_api.h"
+#include "mock_unistd_api.h"
+
+/* The descriptor returned from #epoll_create1. */
+#define EPOLL_DESCRIPTOR       3
+
+/* The socket descriptors added to the event loop. */
+#define SOCKET_DESCRIPTOR      5
+#define SOCKET_DESCRIPTOR_2    6
+
+/* The number of events to pass to #EventLoop_Wait. */
+#define MAX_EVENTS             4
+
+/* The timeout to pass to #EventLoop_Wait. */
+#define WAIT_TIMEOUT_MS        10
+
+/**
+ * @brief Definition of the network context for the tests.
+ */
+struct NetworkContext
+{
+    int32_t socketDescriptor;
+};
+
+static EventLoop_t eventLoop;
+static EventLoopEvent_t events[ MAX_EVENTS ];
+static NetworkContext_t networkContext;
+static NetworkContext_t networkContext2;
+
+/* The last event registered through #epoll_ctl. */
+static struct epoll_event registeredEvent;
+
+/* The events for the #epoll_wait stub to report. */
+static uint32_t readyEvents;
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    networkContext.socketDescriptor = SOCKET_DESCRIPTOR;
+    networkContext2.socketDescriptor = SOCKET_DESCRIPTOR_2;
+    readyEvents = EPOLLIN;
+
+    epoll_create1_ExpectAnyArgsAndReturn( EPOLL_DESCRIPTOR );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Init( &eventLoop ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Stub for #epoll_ctl that captures the slot registered with an event
+ * so that #epoll_wait can report it.
+ */
+static int epoll_ctl_Stub( int epfd,
+                           int op,
+                           int fd,
+                           struct epoll_event * pEvent,
+                           int numCalls )
+{
+    ( void ) epfd;
+    ( void ) fd;
+    ( void ) numCalls;
+
+    if( op != EPOLL_CTL_DEL )
+    {
+        registeredEvent = *pEvent;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Stub for #epoll_wait that reports #readyEvents for the last
+ * registered slot.
+ */
+static int epoll_wait_Stub( int epfd,
+                            struct epoll_event * pEvents,
+                            int maxEvents,
+                            int timeout,
+                            int numCalls )
+{
+    ( void ) epfd;
+    ( void ) maxEvents;
+    ( void ) timeout;
+    ( void ) numCalls;
+
+    pEvents[ 0 ] = registeredEvent;
+    pEvents[ 0 ].events = readyEvents;
+
+    return 1;
+}
+
+/**
+ * @brief Add the test connection to the event loop.
+ */
+static void addConnection( void )
+{
+    epoll_ctl_StubWithCallback( epoll_ctl_Stub );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Add( &eventLoop,
+                                      SOCKET_DESCRIPTOR,
+                                      &networkContext,
+                                      EVENT_LOOP_READABLE ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #EventLoop_Init rejects a NULL event loop.
+ */
+void test_EventLoop_Init_Invalid_Params( void )
+{
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Init( NULL ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Init fails when #epoll_create1 fails.
+ */
+void test_EventLoop_Init_Epoll_Create_Fails( void )
+{
+    epoll_create1_ExpectAnyArgsAndReturn( -1 );
+    errno = EMFILE;
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR, EventLoop_Init( &eventLoop ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Add validates its parameters.
+ */
+void test_EventLoop_Add_Invalid_Params( void )
+{
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Add( NULL, SOCKET_DESCRIPTOR, &networkContext, EVENT_LOOP_READABLE ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Add( &eventLoop, -1, &networkContext, EVENT_LOOP_READABLE ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Add rejects a socket that was already added.
+ */
+void test_EventLoop_Add_Already_Registered( void )
+{
+    addConnection();
+    TEST_ASSERT_EQUAL( EVENT_LOOP_ALREADY_REGISTERED,
+                       EventLoop_Add( &eventLoop, SOCKET_DESCRIPTOR, &networkContext, EVENT_LOOP_READABLE ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Add fails when every slot is in use.
+ */
+void test_EventLoop_Add_No_Memory( void )
+{
+    int32_t i;
+
+    epoll_ctl_IgnoreAndReturn( 0 );
+
+    for( i = 0; i < ( int32_t ) EVENT_LOOP_MAX_CONNECTIONS; i++ )
+    {
+        TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                           EventLoop_Add( &eventLoop, SOCKET_DESCRIPTOR + i, NULL, EVENT_LOOP_READABLE ) );
+    }
+
+    TEST_ASSERT_EQUAL( EVENT_LOOP_NO_MEMORY,
+                       EventLoop_Add( &eventLoop, SOCKET_DESCRIPTOR + i, NULL, EVENT_LOOP_READABLE ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Add releases the slot when #epoll_ctl fails.
+ */
+void test_EventLoop_Add_Epoll_Ctl_Fails( void )
+{
+    epoll_ctl_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR,
+                       EventLoop_Add( &eventLoop, SOCKET_DESCRIPTOR, &networkContext, EVENT_LOOP_READABLE ) );
+    TEST_ASSERT_EQUAL( 0, eventLoop.entryCount );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_NOT_FOUND,
+                       EventLoop_Remove( &eventLoop, SOCKET_DESCRIPTOR ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Modify updates the interest set of a connection.
+ */
+void test_EventLoop_Modify( void )
+{
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Modify( NULL, SOCKET_DESCRIPTOR, EVENT_LOOP_WRITABLE ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_NOT_FOUND,
+                       EventLoop_Modify( &eventLoop, SOCKET_DESCRIPTOR, EVENT_LOOP_WRITABLE ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_NOT_FOUND,
+                       EventLoop_Modify( &eventLoop, -1, EVENT_LOOP_WRITABLE ) );
+
+    addConnection();
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Modify( &eventLoop,
+                                         SOCKET_DESCRIPTOR,
+                                         EVENT_LOOP_READABLE | EVENT_LOOP_WRITABLE ) );
+    TEST_ASSERT_EQUAL( EPOLLIN | EPOLLOUT, registeredEvent.events );
+}
+
+/**
+ * @brief Test that #EventLoop_Remove releases the slot of a connection.
+ */
+void test_EventLoop_Remove( void )
+{
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Remove( NULL, SOCKET_DESCRIPTOR ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_NOT_FOUND,
+                       EventLoop_Remove( &eventLoop, SOCKET_DESCRIPTOR ) );
+
+    addConnection();
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Remove( &eventLoop, SOCKET_DESCRIPTOR ) );
+    TEST_ASSERT_EQUAL( 0, eventLoop.entryCount );
+    TEST_ASSERT_EQUAL( 0, eventLoop.highestEntry );
+
+    /* The slot is released even if epoll fails to remove the socket. */
+    addConnection();
+    epoll_ctl_StubWithCallback( NULL );
+    epoll_ctl_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR,
+                       EventLoop_Remove( &eventLoop, SOCKET_DESCRIPTOR ) );
+    TEST_ASSERT_EQUAL( 0, eventLoop.entryCount );
+}
+
+/**
+ * @brief Test that #EventLoop_Wait validates its parameters.
+ */
+void test_EventLoop_Wait_Invalid_Params( void )
+{
+    size_t eventCount = 0U;
+
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Wait( NULL, events, MAX_EVENTS, WAIT_TIMEOUT_MS, &eventCount ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Wait( &eventLoop, NULL, MAX_EVENTS, WAIT_TIMEOUT_MS, &eventCount ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Wait( &eventLoop, events, 0U, WAIT_TIMEOUT_MS, &eventCount ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER,
+                       EventLoop_Wait( &eventLoop, events, MAX_EVENTS, WAIT_TIMEOUT_MS, NULL ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Wait reports the network context and events of
+ * a ready connection.
+ */
+void test_EventLoop_Wait_Reports_Ready_Connection( void )
+{
+    size_t eventCount = 0U;
+
+    addConnection();
+
+    readyEvents = EPOLLIN | EPOLLOUT | EPOLLHUP;
+    epoll_wait_StubWithCallback( epoll_wait_Stub );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Wait( &eventLoop, events, MAX_EVENTS, WAIT_TIMEOUT_MS, &eventCount ) );
+    TEST_ASSERT_EQUAL( 1, eventCount );
+    TEST_ASSERT_EQUAL( SOCKET_DESCRIPTOR, events[ 0 ].socketDescriptor );
+    TEST_ASSERT_EQUAL_PTR( &networkContext, events[ 0 ].pNetworkContext );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_READABLE | EVENT_LOOP_WRITABLE | EVENT_LOOP_ERROR,
+                       events[ 0 ].events );
+
+    /* The wait also succeeds when blocking indefinitely. */
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Wait( &eventLoop, events, MAX_EVENTS, EVENT_LOOP_WAIT_FOREVER, &eventCount ) );
+    TEST_ASSERT_EQUAL( 1, eventCount );
+    epoll_wait_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Test that #EventLoop_Wait reports no events when the timeout expires
+ * or the wait is interrupted, and an error for other failures.
+ */
+void test_EventLoop_Wait_Timeout_And_Errors( void )
+{
+    size_t eventCount = 1U;
+
+    epoll_wait_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Wait( &eventLoop, events, MAX_EVENTS, 0U, &eventCount ) );
+    TEST_ASSERT_EQUAL( 0, eventCount );
+
+    epoll_wait_ExpectAnyArgsAndReturn( -1 );
+    errno = EINTR;
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Wait( &eventLoop, events, MAX_EVENTS, UINT32_MAX - 1U, &eventCount ) );
+    TEST_ASSERT_EQUAL( 0, eventCount );
+
+    epoll_wait_ExpectAnyArgsAndReturn( -1 );
+    errno = EBADF;
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR,
+                       EventLoop_Wait( &eventLoop, events, MAX_EVENTS, WAIT_TIMEOUT_MS, &eventCount ) );
+    TEST_ASSERT_EQUAL( 0, eventCount );
+}
+
+/**
+ * @brief Test that #EventLoop_Deinit closes the epoll instance.
+ */
+void test_EventLoop_Deinit( void )
+{
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Deinit( NULL ) );
+
+    close_ExpectAndReturn( EPOLL_DESCRIPTOR, 0 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Deinit( &eventLoop ) );
+
+    /* The epoll instance is only closed once. */
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Deinit( &eventLoop ) );
+
+    epoll_create1_ExpectAnyArgsAndReturn( EPOLL_DESCRIPTOR );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Init( &eventLoop ) );
+    close_ExpectAndReturn( EPOLL_DESCRIPTOR, -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR, EventLoop_Deinit( &eventLoop ) );
+}
@@ -0,0 +1,307 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "/usr/include/errno.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "io_uring_posix.h"
+
+/* Timeouts of the connections. */
+#define SEND_RECV_TIMEOUT_MS    50U
+
+/* The number of completions to pass to #IoUring_WaitCompletions. */
+#define MAX_COMPLETIONS         4
+
+/* The timeout to pass to #IoUring_WaitCompletions. */
+#define WAIT_TIMEOUT_MS         1000U
+
+/* The number of buffers registered with the ring. */
+#define BUFFER_COUNT            2U
+
+static IoUring_t ring;
+static uint8_t registeredBuffers[ BUFFER_COUNT * IO_URING_BUFFER_LENGTH ];
+static IoUringCompletion_t completions[ MAX_COMPLETIONS ];
+static NetworkContext_t networkContext;
+static NetworkContext_t networkContext2;
+static SocketsConfig_t socketsConfig;
+static ServerInfo_t serverInfo;
+
+/* The listening socket of the server and the accepted connections. */
+static int32_t listenSocket = -1;
+static int32_t serverSocket = -1;
+static int32_t serverSocket2 = -1;
+
+/* Whether the kernel lets the tests create a ring. */
+static bool ringAvailable = false;
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof( address );
+
+    ( void ) memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    /* The server listens on a port chosen by the system. */
+    listenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, listenSocket );
+    TEST_ASSERT_EQUAL( 0, bind( listenSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( listenSocket, 2 ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( listenSocket, ( struct sockaddr * ) &address, &addressLength ) );
+
+    serverInfo.pHostName = "127.0.0.1";
+    serverInfo.hostNameLength = strlen( serverInfo.pHostName );
+    serverInfo.port = ntohs( address.sin_port );
+
+    ( void ) memset( &socketsConfig, 0, sizeof( socketsConfig ) );
+    socketsConfig.sendTimeoutMs = SEND_RECV_TIMEOUT_MS;
+    socketsConfig.recvTimeoutMs = SEND_RECV_TIMEOUT_MS;
+
+    ringAvailable = ( IoUring_Init( &ring, registeredBuffers, BUFFER_COUNT ) == IO_URING_SUCCESS );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    if( serverSocket >= 0 )
+    {
+        ( void ) close( serverSocket );
+        serverSocket = -1;
+    }
+
+    if( serverSocket2 >= 0 )
+    {
+        ( void ) close( serverSocket2 );
+        serverSocket2 = -1;
+    }
+
+    ( void ) close( listenSocket );
+
+    if( ringAvailable == true )
+    {
+        ( void ) IoUring_Deinit( &ring );
+    }
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Connect a network context to the server and accept the connection.
+ *
+ * The test is skipped when io_uring is disabled, such as by the seccomp
+ * profile of a container.
+ */
+static void connectToServer( NetworkContext_t * pNetworkContext,
+                             int32_t * pServerSocket )
+{
+    if( ringAvailable == false )
+    {
+        TEST_IGNORE_MESSAGE( "io_uring is not available." );
+    }
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS,
+                       IoUring_Connect( pNetworkContext, &ring, &serverInfo, &socketsConfig ) );
+    *pServerSocket = accept( listenSocket, NULL, NULL );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, *pServerSocket );
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #IoUring_Init and #IoUring_Deinit reject invalid parameters.
+ */
+void test_IoUring_Init_Invalid_Params( void )
+{
+    IoUring_t invalidRing;
+
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER,
+                       IoUring_Init( NULL, registeredBuffers, BUFFER_COUNT ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER,
+                       IoUring_Init( &invalidRing, NULL, BUFFER_COUNT ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER,
+                       IoUring_Init( &invalidRing, registeredBuffers, IO_URING_MAX_BUFFERS + 1U ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER, IoUring_Deinit( NULL ) );
+    TEST_ASSERT_EQUAL( -1, IoUring_GetDescriptor( NULL ) );
+}
+
+/**
+ * @brief Test that #IoUring_Connect rejects invalid parameters.
+ */
+void test_IoUring_Connect_Invalid_Params( void )
+{
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER,
+                       IoUring_Connect( NULL, &ring, &serverInfo, &socketsConfig ) );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER,
+                       IoUring_Connect( &networkContext, NULL, &serverInfo, &socketsConfig ) );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER,
+                       IoUring_Connect( &networkContext, &ring, &serverInfo, NULL ) );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, IoUring_Disconnect( NULL ) );
+}
+
+/**
+ * @brief Test that #IoUring_Send and #IoUring_Recv transfer data and that a
+ * receive returns 0 once its timeout expires.
+ */
+void test_IoUring_Send_Recv( void )
+{
+    uint8_t buffer[ 16 ];
+
+    connectToServer( &networkContext, &serverSocket );
+
+    TEST_ASSERT_EQUAL( 5, IoUring_Send( &networkContext, "hello", 5U ) );
+    TEST_ASSERT_EQUAL( 5, recv( serverSocket, buffer, sizeof( buffer ), 0 ) );
+    TEST_ASSERT_EQUAL_MEMORY( "hello", buffer, 5U );
+
+    TEST_ASSERT_EQUAL( 5, send( serverSocket, "world", 5U, 0 ) );
+    TEST_ASSERT_EQUAL( 5, IoUring_Recv( &networkContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( "world", buffer, 5U );
+
+    /* No data arrives within the receive timeout. */
+    TEST_ASSERT_EQUAL( 0, IoUring_Recv( &networkContext, buffer, sizeof( buffer ) ) );
+
+    /* A closed connection is an error. */
+    ( void ) close( serverSocket );
+    serverSocket = -1;
+    TEST_ASSERT_EQUAL( -1, IoUring_Recv( &networkContext, buffer, sizeof( buffer ) ) );
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, IoUring_Disconnect( &networkContext ) );
+}
+
+/**
+ * @brief Test that the operations of several connections are submitted
+ * together and reported by #IoUring_WaitCompletions, and that receives
+ * without a buffer use the registered buffer of the connection.
+ */
+void test_IoUring_WaitCompletions( void )
+{
+    uint8_t buffer[ 16 ], serverBuffer[ 16 ];
+    size_t completionCount = 0U;
+    const uint8_t * pRegisteredBuffer = NULL;
+
+    connectToServer( &networkContext, &serverSocket );
+    connectToServer( &networkContext2, &serverSocket2 );
+    TEST_ASSERT_NOT_EQUAL( networkContext.bufferIndex, networkContext2.bufferIndex );
+
+    TEST_ASSERT_EQUAL( IO_URING_SUCCESS, IoUring_SubmitRecv( &networkContext, NULL, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( IO_URING_SUCCESS, IoUring_SubmitRecv( &networkContext2, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( IO_URING_SUCCESS, IoUring_SubmitSend( &networkContext2, "ping", 4U ) );
+
+    /* Only the send can complete. */
+    TEST_ASSERT_EQUAL( IO_URING_SUCCESS,
+                       IoUring_WaitCompletions( &ring, completions, MAX_COMPLETIONS,
+                                                WAIT_TIMEOUT_MS, &completionCount ) );
+    TEST_ASSERT_EQUAL( 1U, completionCount );
+    TEST_ASSERT_EQUAL_PTR( &networkContext2, completions[ 0 ].pNetworkContext );
+    TEST_ASSERT_EQUAL( IO_URING_OPERATION_SEND, completions[ 0 ].operation );
+    TEST_ASSERT_EQUAL( 4, completions[ 0 ].result );
+    TEST_ASSERT_EQUAL( 4, recv( serverSocket2, serverBuffer, sizeof( serverBuffer ), 0 ) );
+
+    /* Data for the first receive. */
+    TEST_ASSERT_EQUAL( 3, send( serverSocket, "abc", 3U, 0 ) );
+    TEST_ASSERT_EQUAL( IO_URING_SUCCESS,
+                       IoUring_WaitCompletions( &ring, completions, MAX_COMPLETIONS,
+                                                WAIT_TIMEOUT_MS, &completionCount ) );
+    TEST_ASSERT_EQUAL( 1U, completionCount );
+    pRegisteredBuffer = &registeredBuffers[ ( size_t ) networkContext.bufferIndex * IO_URING_BUFFER_LENGTH ];
+    TEST_ASSERT_EQUAL_PTR( &networkContext, completions[ 0 ].pNetworkContext );
+    TEST_ASSERT_EQUAL( IO_URING_OPERATION_RECV, completions[ 0 ].operation );
+    TEST_ASSERT_EQUAL_PTR( pRegisteredBuffer, completions[ 0 ].pBuffer );
+    TEST_ASSERT_EQUAL( 3, completions[ 0 ].result );
+    TEST_ASSERT_EQUAL_MEMORY( "abc", pRegisteredBuffer, 3U );
+
+    /* The second receive is still pending when the timeout expires. */
+    TEST_ASSERT_EQUAL( IO_URING_SUCCESS,
+                       IoUring_WaitCompletions( &ring, completions, MAX_COMPLETIONS,
+                                                0U, &completionCount ) );
+    TEST_ASSERT_EQUAL( 0U, completionCount );
+
+    /* A closed connection completes the receive with 0 bytes. */
+    ( void ) close( serverSocket2 );
+    serverSocket2 = -1;
+    TEST_ASSERT_EQUAL( IO_URING_SUCCESS,
+                       IoUring_WaitCompletions( &ring, completions, MAX_COMPLETIONS,
+                                                WAIT_TIMEOUT_MS, &completionCount ) );
+    TEST_ASSERT_EQUAL( 1U, completionCount );
+    TEST_ASSERT_EQUAL_PTR( &networkContext2, completions[ 0 ].pNetworkContext );
+    TEST_ASSERT_EQUAL_PTR( buffer, completions[ 0 ].pBuffer );
+    TEST_ASSERT_EQUAL( 0, completions[ 0 ].result );
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, IoUring_Disconnect( &networkContext ) );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, IoUring_Disconnect( &networkContext2 ) );
+}
+
+/**
+ * @brief Test that #IoUring_SubmitRecv, #IoUring_SubmitSend and
+ * #IoUring_WaitCompletions reject invalid parameters.
+ */
+void test_IoUring_Submit_Invalid_Params( void )
+{
+    size_t completionCount = 0U;
+    uint8_t buffer[ 4 ];
+    NetworkContext_t unconnectedContext;
+
+    ( void ) memset( &unconnectedContext, 0, sizeof( unconnectedContext ) );
+    unconnectedContext.bufferIndex = -1;
+
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER, IoUring_SubmitRecv( NULL, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER, IoUring_SubmitRecv( &unconnectedContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER, IoUring_SubmitSend( NULL, buffer, sizeof( buffer ) ) );
+
+    unconnectedContext.pRing = &ring;
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER, IoUring_SubmitRecv( &unconnectedContext, NULL, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER, IoUring_SubmitRecv( &unconnectedContext, buffer, 0U ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER, IoUring_SubmitSend( &unconnectedContext, NULL, sizeof( buffer ) ) );
+
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER,
+                       IoUring_WaitCompletions( NULL, completions, MAX_COMPLETIONS, 0U, &completionCount ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER,
+                       IoUring_WaitCompletions( &ring, NULL, MAX_COMPLETIONS, 0U, &completionCount ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER,
+                       IoUring_WaitCompletions( &ring, completions, 0U, 0U, &completionCount ) );
+    TEST_ASSERT_EQUAL( IO_URING_INVALID_PARAMETER,
+                       IoUring_WaitCompletions( &ring, completions, MAX_COMPLETIONS, 0U, NULL ) );
+}
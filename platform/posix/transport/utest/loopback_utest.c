@@ -0,0 +1,276 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "loopback_posix.h"
+
+/* Size of the rings of the connection. */
+#define RING_SIZE               64U
+
+/* Receive and send timeouts of the client endpoint. */
+#define CLIENT_TIMEOUT_MS       20U
+
+/* Latency simulated by the shaping test. */
+#define LATENCY_US              20000U
+
+/* Bandwidth simulated by the shaping test. */
+#define BYTES_PER_SECOND        1000U
+
+/* Bytes sent by the client and responses of the scripted peer. */
+#define CONNECT_PACKET          "\x10\x03" "abc"
+#define CONNECT_PACKET_LENGTH   5U
+#define CONNACK_PACKET          "\x20\x02\x00\x00"
+#define CONNACK_PACKET_LENGTH   4U
+#define PINGREQ_PACKET          "\xC0\x00"
+#define PINGRESP_PACKET         "\xD0\x00"
+#define PING_PACKET_LENGTH      2U
+
+static uint8_t clientToPeerBuffer[ RING_SIZE ];
+static uint8_t peerToClientBuffer[ RING_SIZE ];
+static LoopbackRing_t clientToPeer;
+static LoopbackRing_t peerToClient;
+static NetworkContext_t client;
+static NetworkContext_t peer;
+static uint8_t buffer[ RING_SIZE * 2U ];
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    TEST_ASSERT_EQUAL( LOOPBACK_SUCCESS,
+                       Loopback_Init( &clientToPeer, clientToPeerBuffer, RING_SIZE, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_SUCCESS,
+                       Loopback_Init( &peerToClient, peerToClientBuffer, RING_SIZE, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_SUCCESS,
+                       Loopback_Connect( &client, &peerToClient, &clientToPeer,
+                                         CLIENT_TIMEOUT_MS, CLIENT_TIMEOUT_MS ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_SUCCESS,
+                       Loopback_Connect( &peer, &clientToPeer, &peerToClient, 0U, 0U ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Get the value of the monotonic clock in milliseconds.
+ */
+static uint64_t getTimeMs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000U ) + ( ( uint64_t ) now.tv_nsec / 1000000U );
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that the loopback functions reject invalid parameters.
+ */
+void test_Loopback_Invalid_Params( void )
+{
+    LoopbackRing_t ring;
+
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Init( NULL, clientToPeerBuffer, RING_SIZE, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Init( &ring, NULL, RING_SIZE, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Init( &ring, clientToPeerBuffer, 0U, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Init( &ring, clientToPeerBuffer, RING_SIZE - 1U, NULL ) );
+
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Connect( NULL, &peerToClient, &clientToPeer, 0U, 0U ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Connect( &client, NULL, &clientToPeer, 0U, 0U ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Connect( &client, &peerToClient, NULL, 0U, 0U ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_Connect( &client, &clientToPeer, &clientToPeer, 0U, 0U ) );
+
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_SetPeer( NULL, &peer, Loopback_RunScript, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER,
+                       Loopback_SetPeer( &client, NULL, Loopback_RunScript, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_INVALID_PARAMETER, Loopback_Disconnect( NULL ) );
+
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Recv( NULL, buffer, 1U ) );
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Recv( &client, NULL, 1U ) );
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Recv( &client, buffer, 0U ) );
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Send( NULL, buffer, 1U ) );
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Send( &client, NULL, 1U ) );
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Send( &client, buffer, 0U ) );
+}
+
+/**
+ * @brief Test that data sent by one endpoint is received by the other, also
+ * when it wraps around the end of the ring.
+ */
+void test_Loopback_Send_Recv( void )
+{
+    size_t i = 0U;
+    size_t round = 0U;
+
+    for( i = 0U; i < sizeof( buffer ); i++ )
+    {
+        buffer[ i ] = ( uint8_t ) i;
+    }
+
+    for( round = 0U; round < 3U; round++ )
+    {
+        TEST_ASSERT_EQUAL( 40, Loopback_Send( &client, &buffer[ round ], 40U ) );
+        ( void ) memset( &buffer[ RING_SIZE ], 0, RING_SIZE );
+        TEST_ASSERT_EQUAL( 40, Loopback_Recv( &peer, &buffer[ RING_SIZE ], RING_SIZE ) );
+        TEST_ASSERT_EQUAL_MEMORY( &buffer[ round ], &buffer[ RING_SIZE ], 40U );
+    }
+
+    /* Nothing is left to receive. */
+    TEST_ASSERT_EQUAL( 0, Loopback_Recv( &peer, buffer, 1U ) );
+}
+
+/**
+ * @brief Test that a send to a full ring is partial, then times out.
+ */
+void test_Loopback_Send_Full_Ring( void )
+{
+    uint64_t startMs = 0U;
+
+    TEST_ASSERT_EQUAL( RING_SIZE, Loopback_Send( &client, buffer, sizeof( buffer ) ) );
+
+    startMs = getTimeMs();
+    TEST_ASSERT_EQUAL( 0, Loopback_Send( &client, buffer, 1U ) );
+    TEST_ASSERT_GREATER_OR_EQUAL( CLIENT_TIMEOUT_MS, getTimeMs() - startMs );
+
+    /* Reading makes room again. */
+    TEST_ASSERT_EQUAL( 1, Loopback_Recv( &peer, buffer, 1U ) );
+    TEST_ASSERT_EQUAL( 1, Loopback_Send( &client, buffer, sizeof( buffer ) ) );
+}
+
+/**
+ * @brief Test that a receive from an empty ring times out.
+ */
+void test_Loopback_Recv_Timeout( void )
+{
+    uint64_t startMs = getTimeMs();
+
+    TEST_ASSERT_EQUAL( 0, Loopback_Recv( &client, buffer, 1U ) );
+    TEST_ASSERT_GREATER_OR_EQUAL( CLIENT_TIMEOUT_MS, getTimeMs() - startMs );
+}
+
+/**
+ * @brief Test that the data sent before a disconnect is received, then
+ * receives and sends fail.
+ */
+void test_Loopback_Disconnect( void )
+{
+    TEST_ASSERT_EQUAL( 3, Loopback_Send( &peer, "abc", 3U ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_SUCCESS, Loopback_Disconnect( &peer ) );
+
+    TEST_ASSERT_EQUAL( 3, Loopback_Recv( &client, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Recv( &client, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_LESS_THAN( 0, Loopback_Send( &client, buffer, 1U ) );
+}
+
+/**
+ * @brief Test that a scripted peer responds once it received each step.
+ */
+void test_Loopback_RunScript( void )
+{
+    static const LoopbackScriptStep_t steps[] =
+    {
+        { CONNECT_PACKET_LENGTH, ( const uint8_t * ) CONNACK_PACKET, CONNACK_PACKET_LENGTH },
+        { PING_PACKET_LENGTH,    ( const uint8_t * ) PINGRESP_PACKET, PING_PACKET_LENGTH   }
+    };
+    LoopbackScript_t script = { 0 };
+    size_t i = 0U;
+
+    script.pSteps = steps;
+    script.stepCount = sizeof( steps ) / sizeof( steps[ 0 ] );
+    script.repeatLastStep = true;
+    TEST_ASSERT_EQUAL( LOOPBACK_SUCCESS,
+                       Loopback_SetPeer( &client, &peer, Loopback_RunScript, &script ) );
+
+    /* The peer waits for the whole CONNECT. */
+    TEST_ASSERT_EQUAL( 2, Loopback_Send( &client, CONNECT_PACKET, 2U ) );
+    TEST_ASSERT_EQUAL( 0, Loopback_Recv( &client, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 3, Loopback_Send( &client, &CONNECT_PACKET[ 2 ], 3U ) );
+    TEST_ASSERT_EQUAL( CONNACK_PACKET_LENGTH, Loopback_Recv( &client, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( CONNACK_PACKET, buffer, CONNACK_PACKET_LENGTH );
+
+    /* Every PINGREQ gets a PINGRESP. */
+    for( i = 0U; i < 3U; i++ )
+    {
+        TEST_ASSERT_EQUAL( PING_PACKET_LENGTH,
+                           Loopback_Send( &client, PINGREQ_PACKET, PING_PACKET_LENGTH ) );
+        TEST_ASSERT_EQUAL( PING_PACKET_LENGTH, Loopback_Recv( &client, buffer, sizeof( buffer ) ) );
+        TEST_ASSERT_EQUAL_MEMORY( PINGRESP_PACKET, buffer, PING_PACKET_LENGTH );
+    }
+}
+
+/**
+ * @brief Test that shaped data is readable only after the latency and the
+ * time to transmit it at the bandwidth.
+ */
+void test_Loopback_Shaping( void )
+{
+    LoopbackShaping_t shaping = { LATENCY_US, BYTES_PER_SECOND };
+    uint64_t startMs = 0U;
+    uint64_t elapsedMs = 0U;
+
+    TEST_ASSERT_EQUAL( LOOPBACK_SUCCESS,
+                       Loopback_Init( &peerToClient, peerToClientBuffer, RING_SIZE, &shaping ) );
+
+    /* 20 bytes take 20 ms at 1000 bytes per second, plus 20 ms of latency. */
+    startMs = getTimeMs();
+    TEST_ASSERT_EQUAL( 20, Loopback_Send( &peer, buffer, 20U ) );
+    client.recvTimeoutMs = 0U;
+    TEST_ASSERT_EQUAL( 0, Loopback_Recv( &client, buffer, sizeof( buffer ) ) );
+    client.recvTimeoutMs = 200U;
+    TEST_ASSERT_EQUAL( 20, Loopback_Recv( &client, buffer, sizeof( buffer ) ) );
+    elapsedMs = getTimeMs() - startMs;
+    TEST_ASSERT_GREATER_OR_EQUAL( 40U, elapsedMs );
+    TEST_ASSERT_LESS_THAN( 200U, elapsedMs );
+}
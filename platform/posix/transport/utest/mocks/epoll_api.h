@@ -0,0 +1,46 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file epoll_api.h
+ * @brief This file is used to generate mocks for functions used from <sys/epoll.h>.
+ * Mocking epoll.h itself causes several errors from parsing its macros.
+ */
+
+#ifndef EPOLL_API_H_
+#define EPOLL_API_H_
+
+#include <sys/epoll.h>
+
+extern int epoll_create1( int __flags );
+
+extern int epoll_ctl( int __epfd,
+                      int __op,
+                      int __fd,
+                      struct epoll_event * __event );
+
+extern int epoll_wait( int __epfd,
+                       struct epoll_event * __events,
+                       int __maxevents,
+                       int __timeout );
+
+#endif /* ifndef EPOLL_API_H_ */
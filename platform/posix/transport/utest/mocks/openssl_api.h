@@ -24,6 +24,8 @@
 #define OPENSSL_API_H_
 
 #include <openssl/ssl.h>
+#include <openssl/provider.h>
+#include <openssl/store.h>
 
 /**
  * @file openssl_api.h
@@ -59,6 +61,61 @@ struct ssl_method_st
     int filler;
 };
 
+struct ssl_session_st
+{
+    int filler;
+};
+
+struct bio_st
+{
+    int filler;
+};
+
+struct evp_pkey_st
+{
+    int filler;
+};
+
+struct ossl_provider_st
+{
+    int filler;
+};
+
+struct ossl_store_ctx_st
+{
+    int filler;
+};
+
+struct ossl_store_info_st
+{
+    int filler;
+};
+
+struct ossl_lib_ctx_st
+{
+    int filler;
+};
+
+struct ui_method_st
+{
+    int filler;
+};
+
+/* CMock cannot parse function pointer parameters, so the type of the
+ * callback of #SSL_CTX_sess_set_new_cb is given a name. */
+typedef int (* NewSessionCallback_t)( SSL * ssl,
+                                      SSL_SESSION * session );
+
+/* The type of the callback of #SSL_set_msg_callback, named for the same
+ * reason. */
+typedef void (* MessageCallback_t)( int write_p,
+                                    int version,
+                                    int content_type,
+                                    const void * buf,
+                                    size_t len,
+                                    SSL * ssl,
+                                    void * arg );
+
 /* The functions prototypes below are used by CMock to generate mocks
  * for any OpenSSL API calls used by the OpenSSL transport wrapper.
  *
@@ -75,6 +132,64 @@ X509 * PEM_read_X509( FILE * fp,
 
 extern X509_STORE * SSL_CTX_get_cert_store( const SSL_CTX * ctx );
 
+extern BIO * BIO_new_mem_buf( const void * buf,
+                              int len );
+
+extern int BIO_free( BIO * a );
+
+extern X509 * PEM_read_bio_X509( BIO * bp,
+                                 X509 ** x,
+                                 pem_password_cb * cb,
+                                 void * u );
+
+extern EVP_PKEY * PEM_read_bio_PrivateKey( BIO * bp,
+                                           EVP_PKEY ** x,
+                                           pem_password_cb * cb,
+                                           void * u );
+
+extern X509 * d2i_X509( X509 ** a,
+                        const unsigned char ** in,
+                        long len );
+
+extern EVP_PKEY * d2i_AutoPrivateKey( EVP_PKEY ** a,
+                                      const unsigned char ** pp,
+                                      long length );
+
+extern int SSL_CTX_use_certificate( SSL_CTX * ctx,
+                                    X509 * x );
+
+extern int SSL_CTX_use_PrivateKey( SSL_CTX * ctx,
+                                   EVP_PKEY * pkey );
+
+extern void EVP_PKEY_free( EVP_PKEY * pkey );
+
+extern int OSSL_PROVIDER_available( OSSL_LIB_CTX * libctx,
+                                    const char * name );
+
+extern OSSL_PROVIDER * OSSL_PROVIDER_load( OSSL_LIB_CTX * libctx,
+                                           const char * name );
+
+extern OSSL_STORE_CTX * OSSL_STORE_open( const char * uri,
+                                         const UI_METHOD * ui_method,
+                                         void * ui_data,
+                                         OSSL_STORE_post_process_info_fn post_process,
+                                         void * post_process_data );
+
+extern int OSSL_STORE_expect( OSSL_STORE_CTX * ctx,
+                              int expected_type );
+
+extern OSSL_STORE_INFO * OSSL_STORE_load( OSSL_STORE_CTX * ctx );
+
+extern int OSSL_STORE_eof( OSSL_STORE_CTX * ctx );
+
+extern int OSSL_STORE_error( OSSL_STORE_CTX * ctx );
+
+extern int OSSL_STORE_close( OSSL_STORE_CTX * ctx );
+
+extern EVP_PKEY * OSSL_STORE_INFO_get1_PKEY( const OSSL_STORE_INFO * info );
+
+extern void OSSL_STORE_INFO_free( OSSL_STORE_INFO * info );
+
 extern int SSL_CTX_use_certificate_chain_file( SSL_CTX * ctx,
                                                const char * file );
 
@@ -113,10 +228,13 @@ extern long SSL_get_verify_result( const SSL * ssl );
 
 extern void SSL_CTX_free( SSL_CTX * );
 
+extern int SSL_CTX_up_ref( SSL_CTX * ctx );
+
 extern void SSL_free( SSL * ssl );
 
 /* Macro wrappers:
- * SSL_CTX_set_mode */
+ * SSL_CTX_set_mode
+ * SSL_CTX_set_session_cache_mode */
 extern long SSL_CTX_ctrl( SSL_CTX * ctx,
                           int cmd,
                           long larg,
@@ -124,7 +242,8 @@ extern long SSL_CTX_ctrl( SSL_CTX * ctx,
 
 /* Macro wrappers:
  * SSL_set_tlsext_host_name
- * SSL_set_max_send_fragment */
+ * SSL_set_max_send_fragment
+ * SSL_set_msg_callback_arg */
 extern long SSL_ctrl( SSL * ssl,
                       int cmd,
                       long larg,
@@ -136,6 +255,12 @@ extern int SSL_read( SSL * ssl,
                      void * buf,
                      int num );
 
+extern int SSL_peek( SSL * ssl,
+                     void * buf,
+                     int num );
+
+extern int SSL_pending( const SSL * s );
+
 extern int SSL_get_error( const SSL * s,
                           int ret_code );
 
@@ -143,8 +268,90 @@ extern int SSL_write( SSL * ssl,
                       const void * buf,
                       int num );
 
+extern void SSL_CTX_sess_set_new_cb( SSL_CTX * ctx,
+                                     NewSessionCallback_t new_session_cb );
+
+extern void SSL_set_msg_callback( SSL * ssl,
+                                  MessageCallback_t cb );
+
+/* Macro wrappers:
+ * SSL_set_app_data */
+extern int SSL_set_ex_data( SSL * ssl,
+                            int idx,
+                            void * data );
+
+/* Macro wrappers:
+ * SSL_get_app_data */
+extern void * SSL_get_ex_data( const SSL * ssl,
+                               int idx );
+
+extern SSL_SESSION * d2i_SSL_SESSION( SSL_SESSION ** a,
+                                      const unsigned char ** pp,
+                                      long length );
+
+extern int i2d_SSL_SESSION( const SSL_SESSION * in,
+                            unsigned char ** pp );
+
+extern int SSL_set_session( SSL * to,
+                            SSL_SESSION * session );
+
+extern void SSL_SESSION_free( SSL_SESSION * ses );
+
+extern int SSL_session_reused( const SSL * s );
+
+extern void SSL_set_connect_state( SSL * s );
+
+extern int SSL_is_init_finished( const SSL * s );
+
+extern SSL_SESSION * SSL_get_session( const SSL * ssl );
+
+extern uint32_t SSL_SESSION_get_max_early_data( const SSL_SESSION * s );
+
+extern int SSL_write_early_data( SSL * s,
+                                 const void * buf,
+                                 size_t num,
+                                 size_t * written );
+
+extern int SSL_get_early_data_status( const SSL * s );
+
 const char * ERR_reason_error_string( unsigned long e );
 
+void ERR_clear_error( void );
+
 void X509_free( X509 * a );
 
+extern int SSL_set_cipher_list( SSL * s,
+                                const char * str );
+
+extern int SSL_set_ciphersuites( SSL * s,
+                                 const char * str );
+
+extern uint64_t SSL_set_options( SSL * s,
+                                 uint64_t op );
+
+/* Macro wrappers:
+ * BIO_get_ktls_send */
+extern long BIO_ctrl( BIO * bp,
+                      int cmd,
+                      long larg,
+                      void * parg );
+
+extern BIO * SSL_get_wbio( const SSL * s );
+
+extern BIO * SSL_get_rbio( const SSL * s );
+
+extern void BIO_set_callback_ex( BIO * b,
+                                 BIO_callback_fn_ex callback );
+
+extern void BIO_set_callback_arg( BIO * b,
+                                  char * arg );
+
+extern char * BIO_get_callback_arg( const BIO * b );
+
+extern ossl_ssize_t SSL_sendfile( SSL * s,
+                                  int fd,
+                                  off_t offset,
+                                  size_t size,
+                                  int flags );
+
 #endif /* ifndef OPENSSL_API_H_ */
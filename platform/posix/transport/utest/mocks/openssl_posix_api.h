@@ -0,0 +1,42 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file openssl_posix_api.h
+ * @brief This file is used to generate mocks for the functions of the OpenSSL
+ * transport used by the OpenSSL connection pool.
+ */
+
+#ifndef OPENSSL_POSIX_API_H_
+#define OPENSSL_POSIX_API_H_
+
+#include "openssl_posix.h"
+
+extern OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
+                                        const ServerInfo_t * pServerInfo,
+                                        const OpensslCredentials_t * pOpensslCredentials,
+                                        uint32_t sendTimeoutMs,
+                                        uint32_t recvTimeoutMs );
+
+extern OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext );
+
+#endif /* ifndef OPENSSL_POSIX_API_H_ */
@@ -0,0 +1,55 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file pthread_api.h
+ * @brief This file is used to generate mocks for functions used from <pthread.h>.
+ * Mocking pthread.h itself causes several errors from parsing its macros.
+ */
+
+#ifndef PTHREAD_API_H_
+#define PTHREAD_API_H_
+
+#include <pthread.h>
+
+extern int pthread_mutex_init( pthread_mutex_t * __mutex,
+                               const pthread_mutexattr_t * __mutexattr );
+
+extern int pthread_mutex_destroy( pthread_mutex_t * __mutex );
+
+extern int pthread_mutex_lock( pthread_mutex_t * __mutex );
+
+extern int pthread_mutex_unlock( pthread_mutex_t * __mutex );
+
+/* CMock cannot parse function pointer parameters, so the type of the start
+ * routine of #pthread_create is given a name. */
+typedef void * (* ThreadStartRoutine_t)( void * arg );
+
+extern int pthread_create( pthread_t * __newthread,
+                           const pthread_attr_t * __attr,
+                           ThreadStartRoutine_t __start_routine,
+                           void * __arg );
+
+extern int pthread_join( pthread_t __th,
+                         void ** __thread_return );
+
+#endif /* ifndef PTHREAD_API_H_ */
@@ -23,6 +23,9 @@
 #ifndef UNISTD_API_H_
 #define UNISTD_API_H_
 
+#include <stddef.h>
+#include <sys/types.h>
+
 /**
  * @file unistd_api.h
  * @brief This file is used to generate a mock for any functions from
@@ -46,4 +49,29 @@ extern int close( int __fd );
 extern char * getcwd( char * __buf,
                       size_t __size );
 
+/* Create a one-way communication channel (pipe).
+ * If successful, two file descriptors are stored in PIPEDES;
+ * bytes written on PIPEDES[1] can be read from PIPEDES[0].
+ * Returns 0 if successful, -1 if not.  */
+extern int pipe( int __pipedes[ 2 ] );
+
+/* Write N bytes of BUF to FD.  Return the number written, or -1.
+ *
+ * This function is a cancellation point and therefore not marked with
+ * __THROW.  */
+extern ssize_t write( int __fd,
+                      const void * __buf,
+                      size_t __n );
+
+/* Read NBYTES into BUF from FD at the given position OFFSET without
+ * changing the file pointer.  Return the number read, -1 for errors
+ * or 0 for EOF.
+ *
+ * This function is a cancellation point and therefore not marked with
+ * __THROW.  */
+extern ssize_t pread( int __fd,
+                      void * __buf,
+                      size_t __nbytes,
+                      off_t __offset );
+
 #endif /* ifndef UNISTD_API_H_ */
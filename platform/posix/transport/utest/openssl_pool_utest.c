@@ -0,0 +1,368 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "openssl_pool_posix.h"
+
+#include "mock_openssl_posix_api.h"
+#include "mock_openssl_api.h"
+#include "mock_poll_api.h"
+#include "mock_fcntl_api.h"
+#include "mock_pthread_api.h"
+
+/* Timeouts of the connections. */
+#define SEND_RECV_TIMEOUT_MS    100U
+
+/* Idle timeout of the pool in the eviction test. */
+#define IDLE_TIMEOUT_MS         1U
+
+/* The servers to connect to. */
+#define HOSTNAME                "amazon.com"
+#define OTHER_HOSTNAME          "aws.amazon.com"
+#define PORT                    443
+
+static OpensslPool_t pool;
+static ServerInfo_t serverInfo;
+static ServerInfo_t otherServerInfo;
+static OpensslCredentials_t opensslCredentials;
+
+/* The events #poll_Stub reports for an idle connection; 0 for none. */
+static short pollEvents = 0;
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    serverInfo.pHostName = HOSTNAME;
+    serverInfo.hostNameLength = strlen( HOSTNAME );
+    serverInfo.port = PORT;
+    otherServerInfo.pHostName = OTHER_HOSTNAME;
+    otherServerInfo.hostNameLength = strlen( OTHER_HOSTNAME );
+    otherServerInfo.port = PORT;
+    ( void ) memset( &opensslCredentials, 0, sizeof( opensslCredentials ) );
+    pollEvents = 0;
+
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS,
+                       OpensslPool_Init( &pool, SEND_RECV_TIMEOUT_MS, SEND_RECV_TIMEOUT_MS, 0U ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Stub for #poll that reports #pollEvents for the idle connection.
+ */
+static int poll_Stub( struct pollfd * __fds,
+                      nfds_t __nfds,
+                      int __timeout,
+                      int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL( 1, __nfds );
+    TEST_ASSERT_EQUAL( 0, __timeout );
+    __fds[ 0 ].revents = pollEvents;
+
+    return ( pollEvents == 0 ) ? 0 : 1;
+}
+
+/**
+ * @brief Check out a new connection to a server.
+ */
+static NetworkContext_t * checkoutNewConnection( const ServerInfo_t * pServerInfo )
+{
+    NetworkContext_t * pNetworkContext = NULL;
+
+    Openssl_Connect_ExpectAnyArgsAndReturn( OPENSSL_SUCCESS );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS,
+                       OpensslPool_Checkout( &pool, pServerInfo, &opensslCredentials, &pNetworkContext ) );
+    TEST_ASSERT_NOT_NULL( pNetworkContext );
+
+    return pNetworkContext;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #OpensslPool_Init rejects invalid parameters and reports
+ * a mutex failure.
+ */
+void test_OpensslPool_Init_Invalid_Params( void )
+{
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER, OpensslPool_Init( NULL, 0U, 0U, 0U ) );
+
+    pthread_mutex_init_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_API_ERROR, OpensslPool_Init( &pool, 0U, 0U, 0U ) );
+}
+
+/**
+ * @brief Test that #OpensslPool_Checkout rejects invalid parameters.
+ */
+void test_OpensslPool_Checkout_Invalid_Params( void )
+{
+    NetworkContext_t * pNetworkContext = NULL;
+    char longHostName[ OPENSSL_POOL_MAX_HOST_NAME_LENGTH + 1U ];
+
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER,
+                       OpensslPool_Checkout( NULL, &serverInfo, &opensslCredentials, &pNetworkContext ) );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER,
+                       OpensslPool_Checkout( &pool, NULL, &opensslCredentials, &pNetworkContext ) );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER,
+                       OpensslPool_Checkout( &pool, &serverInfo, NULL, &pNetworkContext ) );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER,
+                       OpensslPool_Checkout( &pool, &serverInfo, &opensslCredentials, NULL ) );
+
+    serverInfo.hostNameLength = 0U;
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER,
+                       OpensslPool_Checkout( &pool, &serverInfo, &opensslCredentials, &pNetworkContext ) );
+
+    ( void ) memset( longHostName, 'a', sizeof( longHostName ) );
+    serverInfo.pHostName = longHostName;
+    serverInfo.hostNameLength = sizeof( longHostName );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER,
+                       OpensslPool_Checkout( &pool, &serverInfo, &opensslCredentials, &pNetworkContext ) );
+}
+
+/**
+ * @brief Test that #OpensslPool_Checkin rejects connections that are not
+ * checked out of the pool.
+ */
+void test_OpensslPool_Checkin_Invalid_Params( void )
+{
+    NetworkContext_t networkContext;
+    NetworkContext_t * pNetworkContext = NULL;
+
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER, OpensslPool_Checkin( NULL, &networkContext, true ) );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER, OpensslPool_Checkin( &pool, NULL, true ) );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER, OpensslPool_Checkin( &pool, &networkContext, true ) );
+
+    /* A connection can only be checked in once. */
+    pNetworkContext = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pNetworkContext, true ) );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER, OpensslPool_Checkin( &pool, pNetworkContext, true ) );
+
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER, OpensslPool_EvictIdle( NULL ) );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_INVALID_PARAMETER, OpensslPool_Cleanup( NULL ) );
+}
+
+/**
+ * @brief Test that a healthy idle connection is reused without connecting.
+ */
+void test_OpensslPool_Reuses_Idle_Connection( void )
+{
+    NetworkContext_t * pFirst = NULL;
+    NetworkContext_t * pSecond = NULL;
+
+    pFirst = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pFirst, true ) );
+
+    SSL_pending_ExpectAnyArgsAndReturn( 0 );
+    poll_StubWithCallback( poll_Stub );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS,
+                       OpensslPool_Checkout( &pool, &serverInfo, &opensslCredentials, &pSecond ) );
+    TEST_ASSERT_EQUAL_PTR( pFirst, pSecond );
+}
+
+/**
+ * @brief Test that an idle connection that only received session tickets is
+ * reused.
+ */
+void test_OpensslPool_Reuses_Connection_With_Session_Ticket( void )
+{
+    NetworkContext_t * pFirst = NULL;
+    NetworkContext_t * pSecond = NULL;
+
+    pFirst = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pFirst, true ) );
+
+    SSL_pending_ExpectAnyArgsAndReturn( 0 );
+    pollEvents = POLLIN;
+    poll_StubWithCallback( poll_Stub );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    SSL_peek_ExpectAnyArgsAndReturn( -1 );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_WANT_READ );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS,
+                       OpensslPool_Checkout( &pool, &serverInfo, &opensslCredentials, &pSecond ) );
+    TEST_ASSERT_EQUAL_PTR( pFirst, pSecond );
+}
+
+/**
+ * @brief Test that idle connections closed by the server are replaced by a
+ * new connection.
+ */
+void test_OpensslPool_Replaces_Closed_Connection( void )
+{
+    NetworkContext_t * pFirst = NULL;
+    NetworkContext_t * pSecond = NULL;
+
+    /* The server sent a close_notify alert. */
+    pFirst = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pFirst, true ) );
+
+    SSL_pending_ExpectAnyArgsAndReturn( 0 );
+    pollEvents = POLLIN;
+    poll_StubWithCallback( poll_Stub );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    SSL_peek_ExpectAnyArgsAndReturn( 0 );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_ZERO_RETURN );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    Openssl_Disconnect_ExpectAnyArgsAndReturn( OPENSSL_SUCCESS );
+    pSecond = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pSecond, true ) );
+
+    /* The connection was reset. */
+    SSL_pending_ExpectAnyArgsAndReturn( 0 );
+    pollEvents = POLLIN | POLLHUP;
+    Openssl_Disconnect_ExpectAnyArgsAndReturn( OPENSSL_SUCCESS );
+    pSecond = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pSecond, true ) );
+
+    /* Decrypted data of a previous response is left. */
+    SSL_pending_ExpectAnyArgsAndReturn( 1 );
+    Openssl_Disconnect_ExpectAnyArgsAndReturn( OPENSSL_SUCCESS );
+    ( void ) checkoutNewConnection( &serverInfo );
+}
+
+/**
+ * @brief Test that a connection checked in without keep-alive is closed.
+ */
+void test_OpensslPool_Checkin_Without_Keep_Alive( void )
+{
+    NetworkContext_t * pNetworkContext = NULL;
+
+    pNetworkContext = checkoutNewConnection( &serverInfo );
+    Openssl_Disconnect_ExpectAnyArgsAndReturn( OPENSSL_SUCCESS );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pNetworkContext, false ) );
+
+    /* No idle connection is left, so the next checkout connects. */
+    ( void ) checkoutNewConnection( &serverInfo );
+}
+
+/**
+ * @brief Test that every server has its own idle connections.
+ */
+void test_OpensslPool_Separates_Hosts( void )
+{
+    NetworkContext_t * pNetworkContext = NULL;
+    NetworkContext_t * pOther = NULL;
+
+    pNetworkContext = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pNetworkContext, true ) );
+
+    pOther = checkoutNewConnection( &otherServerInfo );
+    TEST_ASSERT_NOT_EQUAL( pNetworkContext, pOther );
+
+    /* The same host name on another port is another server. */
+    serverInfo.port = PORT + 1;
+    ( void ) checkoutNewConnection( &serverInfo );
+}
+
+/**
+ * @brief Test that checkouts fail once the pool is full or a connect fails,
+ * and that a failed connect does not use up a connection.
+ */
+void test_OpensslPool_Checkout_Fails( void )
+{
+    NetworkContext_t * pNetworkContext = NULL;
+    size_t i = 0U;
+
+    Openssl_Connect_ExpectAnyArgsAndReturn( OPENSSL_HANDSHAKE_FAILED );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_CONNECT_FAILURE,
+                       OpensslPool_Checkout( &pool, &serverInfo, &opensslCredentials, &pNetworkContext ) );
+
+    for( i = 0U; i < OPENSSL_POOL_MAX_CONNECTIONS; i++ )
+    {
+        ( void ) checkoutNewConnection( &serverInfo );
+    }
+
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_NO_SPACE,
+                       OpensslPool_Checkout( &pool, &serverInfo, &opensslCredentials, &pNetworkContext ) );
+}
+
+/**
+ * @brief Test that checkouts fail once every server slot is in use.
+ */
+void test_OpensslPool_Checkout_Too_Many_Hosts( void )
+{
+    NetworkContext_t * pNetworkContext = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; i < OPENSSL_POOL_MAX_HOSTS; i++ )
+    {
+        serverInfo.port = ( uint16_t ) ( PORT + i );
+        ( void ) checkoutNewConnection( &serverInfo );
+    }
+
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_NO_SPACE,
+                       OpensslPool_Checkout( &pool, &otherServerInfo, &opensslCredentials, &pNetworkContext ) );
+}
+
+/**
+ * @brief Test that idle connections are closed after the idle timeout and
+ * by #OpensslPool_Cleanup.
+ */
+void test_OpensslPool_Evicts_Idle_Connections( void )
+{
+    NetworkContext_t * pNetworkContext = NULL;
+    struct timespec delay = { 0, 5000000 };
+
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS,
+                       OpensslPool_Init( &pool, SEND_RECV_TIMEOUT_MS, SEND_RECV_TIMEOUT_MS, IDLE_TIMEOUT_MS ) );
+
+    pNetworkContext = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pNetworkContext, true ) );
+    ( void ) nanosleep( &delay, NULL );
+
+    Openssl_Disconnect_ExpectAnyArgsAndReturn( OPENSSL_SUCCESS );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_EvictIdle( &pool ) );
+
+    /* Cleanup closes the connections that did not expire yet. */
+    pNetworkContext = checkoutNewConnection( &serverInfo );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Checkin( &pool, pNetworkContext, true ) );
+    Openssl_Disconnect_ExpectAnyArgsAndReturn( OPENSSL_SUCCESS );
+    TEST_ASSERT_EQUAL( OPENSSL_POOL_SUCCESS, OpensslPool_Cleanup( &pool ) );
+}
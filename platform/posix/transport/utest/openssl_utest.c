@@ -33,7 +33,9 @@
 #include "mock_unistd_api.h"
 #include "mock_openssl_api.h"
 #include "mock_sockets_posix.h"
+#include "mock_clock.h"
 #include "mock_stdio_api.h"
+#include "mock_pthread_api.h"
 
 /* The send and receive timeout to set for the socket. */
 #define SEND_RECV_TIMEOUT       0
@@ -50,12 +52,23 @@
 /* Configuration parameters for the TLS connection. */
 #define MFLN                    42
 #define ALPN_PROTOS             "x-amzn-mqtt-ca"
+#define CIPHER_LIST             "ECDHE-ECDSA-CHACHA20-POLY1305"
+#define CIPHER_SUITES           "TLS_CHACHA20_POLY1305_SHA256"
+#define GROUPS                  "X25519"
+
+/* The private key in a hardware token and the provider that loads it. */
+#define PRIVATE_KEY_URI         "pkcs11:object=client"
+#define KEY_PROVIDER            "pkcs11"
 
 /* Parameters to pass to #Openssl_Send and #Openssl_Recv. */
 #define BYTES_TO_SEND           4
 #define BYTES_TO_RECV           4
 #define SSL_READ_WRITE_ERROR    -1
 
+/* File descriptor of a file sent with Openssl_SendFile. */
+#define FILE_DESCRIPTOR         7
+#define FILE_OFFSET             100
+
 /* The size of the buffer passed to #Openssl_Send and #Openssl_Recv. */
 #define BUFFER_LEN              4
 
@@ -64,14 +77,50 @@ static ServerInfo_t serverInfo = { 0 };
 static OpensslCredentials_t opensslCredentials = { 0 };
 static NetworkContext_t networkContext = { 0 };
 static uint8_t opensslBuffer[ BUFFER_LEN ] = { 0 };
+static OpensslTlsContext_t tlsContext;
 
 /* Objects from the OpenSSL API. */
 static SSL ssl;
 static SSL_METHOD sslMethod;
 static SSL_CTX sslCtx;
+static SSL_CTX rotatedSslCtx;
 static FILE rootCaFile;
 static X509 rootCa;
 static X509_STORE CaStore;
+static SSL_SESSION sslSession;
+static BIO memoryBio;
+static BIO socketBio;
+static X509 clientCert;
+static EVP_PKEY privateKey;
+static OSSL_PROVIDER keyProvider;
+static OSSL_STORE_CTX keyStore;
+static OSSL_STORE_INFO keyStoreInfo;
+
+/* Credentials in memory. Only the first byte, which selects DER or PEM, is
+ * read by the transport. */
+static const uint8_t pemCredential[] = "-----BEGIN CERTIFICATE-----";
+static const uint8_t derCredential[] = { 0x30, 0x82, 0x01, 0x0a };
+
+/* The serialized session returned by the session store and the session last
+ * saved to it. */
+static const uint8_t storedSession[] = { 0x30, 0x03, 0x02, 0x01, 0x01 };
+
+/* The early data limit of the saved session in the early data tests. */
+#define MAX_EARLY_DATA          2U
+static size_t savedSessionLength = 0U;
+static NewSessionCallback_t newSessionCallback = NULL;
+
+/* The time of the fake clock returned by #Clock_GetTimeUs_Stub when a test
+ * starts it, and how much it advances on every read, in microseconds. */
+#define FAKE_CLOCK_START_US     1000000U
+#define FAKE_CLOCK_STEP_US      1500U
+static uint64_t fakeClockUs = 0U;
+
+/* The connect timing passed to #Sockets_ConnectWithConfig, and the message
+ * callback set by the last call to #SSL_set_msg_callback. */
+static ConnectTiming_t * pSocketsConnectTiming = NULL;
+static MessageCallback_t messageCallback = NULL;
+static int messageCallbackSetCount = 0;
 
 /**
  * @brief OpenSSL Connect / Disconnect return status.
@@ -90,6 +139,11 @@ typedef enum FunctionNames
     SSL_set_alpn_protos_fn,
     SSL_set_max_send_fragment_fn,
     SSL_set_tlsext_host_name_fn,
+    SSL_set_cipher_list_fn,
+    SSL_set_ciphersuites_fn,
+    SSL_set1_groups_list_fn,
+    SSL_set_min_proto_version_fn,
+    SSL_set_max_proto_version_fn,
     SSL_connect_fn,
     SSL_get_verify_result_fn
 } FunctionNames_t;
@@ -111,6 +165,10 @@ void setUp()
     opensslCredentials.alpnProtosLen = strlen( ALPN_PROTOS );
     opensslCredentials.maxFragmentLength = MFLN;
     opensslCredentials.sniHostName = HOSTNAME;
+
+    networkContext.pStats = NULL;
+    networkContext.pConnectTiming = NULL;
+    networkContext.earlyDataEnabled = false;
 }
 
 /* Called after each test method. */
@@ -197,12 +255,12 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
     {
         TEST_ASSERT_NOT_NULL( retValue );
         socketStatus = *( ( SocketStatus_t * ) retValue );
-        Sockets_Connect_ExpectAnyArgsAndReturn( socketStatus );
+        Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( socketStatus );
         returnStatus = convertToOpensslStatus( socketStatus );
     }
     else if( returnStatus == OPENSSL_SUCCESS )
     {
-        Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+        Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
     }
 
     /* Calls like this can't fail no matter what you return. */
@@ -388,6 +446,66 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
         }
     }
 
+    if( opensslCredentials.pCipherList != NULL )
+    {
+        if( functionToFail == SSL_set_cipher_list_fn )
+        {
+            SSL_set_cipher_list_ExpectAnyArgsAndReturn( 0 );
+        }
+        else if( returnStatus == OPENSSL_SUCCESS )
+        {
+            SSL_set_cipher_list_ExpectAnyArgsAndReturn( 1 );
+        }
+    }
+
+    if( opensslCredentials.pCipherSuites != NULL )
+    {
+        if( functionToFail == SSL_set_ciphersuites_fn )
+        {
+            SSL_set_ciphersuites_ExpectAnyArgsAndReturn( 0 );
+        }
+        else if( returnStatus == OPENSSL_SUCCESS )
+        {
+            SSL_set_ciphersuites_ExpectAnyArgsAndReturn( 1 );
+        }
+    }
+
+    if( opensslCredentials.pGroups != NULL )
+    {
+        if( functionToFail == SSL_set1_groups_list_fn )
+        {
+            SSL_ctrl_ExpectAnyArgsAndReturn( 0 );
+        }
+        else if( returnStatus == OPENSSL_SUCCESS )
+        {
+            SSL_ctrl_ExpectAnyArgsAndReturn( 1 );
+        }
+    }
+
+    if( opensslCredentials.minTlsVersion != 0U )
+    {
+        if( functionToFail == SSL_set_min_proto_version_fn )
+        {
+            SSL_ctrl_ExpectAnyArgsAndReturn( 0 );
+        }
+        else if( returnStatus == OPENSSL_SUCCESS )
+        {
+            SSL_ctrl_ExpectAnyArgsAndReturn( 1 );
+        }
+    }
+
+    if( opensslCredentials.maxTlsVersion != 0U )
+    {
+        if( functionToFail == SSL_set_max_proto_version_fn )
+        {
+            SSL_ctrl_ExpectAnyArgsAndReturn( 0 );
+        }
+        else if( returnStatus == OPENSSL_SUCCESS )
+        {
+            SSL_ctrl_ExpectAnyArgsAndReturn( 1 );
+        }
+    }
+
     if( functionToFail == SSL_connect_fn )
     {
         SSL_connect_ExpectAnyArgsAndReturn( -1 );
@@ -549,10 +667,19 @@ void test_Openssl_Connect_Setting_TLS_Configurations_Fails( void )
     FunctionNames_t configFunctions[] =
     {
         SSL_set_alpn_protos_fn, SSL_set_max_send_fragment_fn,
-        SSL_set_tlsext_host_name_fn
+        SSL_set_tlsext_host_name_fn, SSL_set_cipher_list_fn,
+        SSL_set_ciphersuites_fn, SSL_set1_groups_list_fn,
+        SSL_set_min_proto_version_fn, SSL_set_max_proto_version_fn
     };
     uint16_t i;
 
+    /* Prefer ChaCha20-Poly1305 and X25519, and only allow TLS 1.3. */
+    opensslCredentials.pCipherList = CIPHER_LIST;
+    opensslCredentials.pCipherSuites = CIPHER_SUITES;
+    opensslCredentials.pGroups = GROUPS;
+    opensslCredentials.minTlsVersion = TLS1_3_VERSION;
+    opensslCredentials.maxTlsVersion = TLS1_3_VERSION;
+
     for( i = 0; i < sizeof( configFunctions ) / sizeof( FunctionNames_t ); i++ )
     {
         expectedStatus = failFunctionFrom_Openssl_Connect( configFunctions[ i ], NULL );
@@ -807,3 +934,1133 @@ void test_Openssl_Recv_Network_Error( void )
     TEST_ASSERT_EQUAL( SSL_READ_WRITE_ERROR, bytesReceived );
     TEST_ASSERT_TRUE( bytesReceived <= 0 );
 }
+
+/* The lengths that #SSL_read_Stub returns, and the next byte it sends. */
+static const int readLengths[] = { 6, 2, 3, 5, 16 };
+static uint8_t nextReadByte;
+
+/**
+ * @brief Stub for #SSL_read that receives the next bytes of a sequence in the
+ * lengths of #readLengths.
+ */
+static int SSL_read_Stub( SSL * ssl,
+                          void * buf,
+                          int num,
+                          int numCalls )
+{
+    int i, readLength;
+
+    ( void ) ssl;
+
+    TEST_ASSERT_TRUE( numCalls < ( int ) ( sizeof( readLengths ) / sizeof( readLengths[ 0 ] ) ) );
+    readLength = ( readLengths[ numCalls ] < num ) ? readLengths[ numCalls ] : num;
+
+    for( i = 0; i < readLength; i++ )
+    {
+        ( ( uint8_t * ) buf )[ i ] = nextReadByte++;
+    }
+
+    return readLength;
+}
+
+/**
+ * @brief Receive bytes with #Openssl_Recv and check that they continue the
+ * sequence of #SSL_read_Stub.
+ */
+static void recvSequence( uint8_t * pExpectedByte,
+                          size_t bytesToRecv,
+                          int32_t expectedBytesReceived )
+{
+    uint8_t buffer[ 16 ];
+    int32_t bytesReceived, i;
+
+    TEST_ASSERT_TRUE( bytesToRecv <= sizeof( buffer ) );
+    bytesReceived = Openssl_Recv( &networkContext, buffer, bytesToRecv );
+    TEST_ASSERT_EQUAL( expectedBytesReceived, bytesReceived );
+
+    for( i = 0; i < bytesReceived; i++ )
+    {
+        TEST_ASSERT_EQUAL_UINT8( *pExpectedByte, buffer[ i ] );
+        ( *pExpectedByte )++;
+    }
+}
+
+/**
+ * @brief Test that #Openssl_Recv serves small reads from the read-ahead
+ * buffer, and reads from OpenSSL only when it is empty and nothing was received
+ * yet, or when OpenSSL has decrypted data pending.
+ */
+void test_Openssl_Recv_Reads_Ahead( void )
+{
+    uint8_t readAheadBuffer[ 8 ];
+    OpensslReadAhead_t readAhead;
+    uint8_t expectedByte = 0;
+
+    memset( &readAhead, 0, sizeof( readAhead ) );
+    readAhead.pBuffer = readAheadBuffer;
+    readAhead.bufferSize = sizeof( readAheadBuffer );
+    networkContext.pSsl = &ssl;
+    networkContext.pReadAhead = &readAhead;
+    nextReadByte = 0;
+    SSL_read_StubWithCallback( SSL_read_Stub );
+
+    /* One read of 6 bytes serves the reads of 1 and 4 bytes, and part of the
+     * read of 4 bytes, which does not wait for more data. */
+    recvSequence( &expectedByte, 1, 1 );
+    recvSequence( &expectedByte, 4, 4 );
+    SSL_pending_ExpectAndReturn( &ssl, 0 );
+    recvSequence( &expectedByte, 4, 1 );
+
+    /* Pending data is read to complete a read. */
+    recvSequence( &expectedByte, 2, 2 );
+    SSL_pending_ExpectAndReturn( &ssl, 5 );
+    recvSequence( &expectedByte, 4, 4 );
+    recvSequence( &expectedByte, 4, 4 );
+
+    /* A read of the size of the buffer bypasses it. */
+    recvSequence( &expectedByte, 8, 8 );
+    TEST_ASSERT_EQUAL( 0, readAhead.length );
+
+    SSL_read_StubWithCallback( NULL );
+
+    /* Errors of SSL_read are handled as without the buffer. */
+    SSL_read_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_WANT_READ );
+    recvSequence( &expectedByte, 4, 0 );
+
+    networkContext.pReadAhead = NULL;
+}
+
+/**
+ * @brief Expect the calls that create an SSL context from a root CA only.
+ *
+ * @param[in] pSslContext The SSL context to return from #SSL_CTX_new.
+ */
+static void expectCreateSslContextFromRootCa( SSL_CTX * pSslContext )
+{
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( pSslContext );
+    SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 1 );
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        getcwd_ExpectAnyArgsAndReturn( NULL );
+    #endif
+    fopen_ExpectAnyArgsAndReturn( &rootCaFile );
+    PEM_read_X509_ExpectAnyArgsAndReturn( &rootCa );
+    SSL_CTX_get_cert_store_ExpectAnyArgsAndReturn( &CaStore );
+    X509_STORE_add_cert_ExpectAnyArgsAndReturn( 1 );
+    X509_free_ExpectAnyArgs();
+    fclose_ExpectAnyArgsAndReturn( 0 );
+}
+
+/**
+ * @brief Test that the shared TLS context functions validate their parameters.
+ */
+void test_Openssl_TlsContext_Invalid_Params( void )
+{
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER,
+                       Openssl_TlsContextInit( NULL, &opensslCredentials ) );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER,
+                       Openssl_TlsContextInit( &tlsContext, NULL ) );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER,
+                       Openssl_TlsContextRotate( NULL, &opensslCredentials ) );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER,
+                       Openssl_TlsContextRotate( &tlsContext, NULL ) );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER,
+                       Openssl_TlsContextCleanup( NULL ) );
+}
+
+/**
+ * @brief Test that #Openssl_TlsContextInit loads the credentials once and
+ * #Openssl_TlsContextCleanup releases them.
+ */
+void test_Openssl_TlsContext_Init_And_Cleanup( void )
+{
+    opensslCredentials.pClientCertPath = NULL;
+    opensslCredentials.pPrivateKeyPath = NULL;
+
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    expectCreateSslContextFromRootCa( &sslCtx );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+    TEST_ASSERT_EQUAL_PTR( &sslCtx, tlsContext.pSslContext );
+
+    SSL_CTX_free_Expect( &sslCtx );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_TlsContextCleanup( &tlsContext ) );
+    TEST_ASSERT_NULL( tlsContext.pSslContext );
+}
+
+/**
+ * @brief Test that #Openssl_TlsContextInit fails when the mutex cannot be
+ * created or the credentials cannot be loaded.
+ */
+void test_Openssl_TlsContext_Init_Fails( void )
+{
+    pthread_mutex_init_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( OPENSSL_API_ERROR,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( NULL );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_API_ERROR,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+
+    /* The SSL context created before loading the root CA failed is freed. */
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( &sslCtx );
+    SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 1 );
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        getcwd_ExpectAnyArgsAndReturn( NULL );
+    #endif
+    fopen_ExpectAnyArgsAndReturn( NULL );
+    SSL_CTX_free_Expect( &sslCtx );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_CREDENTIALS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+    TEST_ASSERT_NULL( tlsContext.pSslContext );
+}
+
+/**
+ * @brief Test that #Openssl_TlsContextInit loads the credentials from memory
+ * instead of from files, whether they are PEM or DER encoded.
+ */
+void test_Openssl_TlsContext_Init_From_Memory( void )
+{
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pRootCa = pemCredential;
+    opensslCredentials.rootCaLength = sizeof( pemCredential );
+    opensslCredentials.pClientCert = derCredential;
+    opensslCredentials.clientCertLength = sizeof( derCredential );
+    opensslCredentials.pPrivateKey = pemCredential;
+    opensslCredentials.privateKeyLength = sizeof( pemCredential );
+
+    /* Every root CA of the PEM bundle is trusted. */
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( &sslCtx );
+    SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_CTX_get_cert_store_ExpectAnyArgsAndReturn( &CaStore );
+    BIO_new_mem_buf_ExpectAndReturn( pemCredential, sizeof( pemCredential ), &memoryBio );
+    PEM_read_bio_X509_ExpectAndReturn( &memoryBio, NULL, NULL, NULL, &rootCa );
+    X509_STORE_add_cert_ExpectAndReturn( &CaStore, &rootCa, 1 );
+    X509_free_Expect( &rootCa );
+    PEM_read_bio_X509_ExpectAndReturn( &memoryBio, NULL, NULL, NULL, &rootCa );
+    X509_STORE_add_cert_ExpectAndReturn( &CaStore, &rootCa, 1 );
+    X509_free_Expect( &rootCa );
+    PEM_read_bio_X509_ExpectAndReturn( &memoryBio, NULL, NULL, NULL, NULL );
+    BIO_free_ExpectAndReturn( &memoryBio, 1 );
+    ERR_clear_error_Expect();
+
+    /* The DER client certificate is parsed without a BIO. */
+    d2i_X509_ExpectAnyArgsAndReturn( &clientCert );
+    SSL_CTX_use_certificate_ExpectAndReturn( &sslCtx, &clientCert, 1 );
+    X509_free_Expect( &clientCert );
+
+    BIO_new_mem_buf_ExpectAndReturn( pemCredential, sizeof( pemCredential ), &memoryBio );
+    PEM_read_bio_PrivateKey_ExpectAndReturn( &memoryBio, NULL, NULL, NULL, &privateKey );
+    BIO_free_ExpectAndReturn( &memoryBio, 1 );
+    SSL_CTX_use_PrivateKey_ExpectAndReturn( &sslCtx, &privateKey, 1 );
+    EVP_PKEY_free_Expect( &privateKey );
+
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+
+    SSL_CTX_free_Expect( &sslCtx );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_TlsContextCleanup( &tlsContext ) );
+
+    /* A PEM root CA without any certificate is invalid. */
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( &sslCtx );
+    SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_CTX_get_cert_store_ExpectAnyArgsAndReturn( &CaStore );
+    BIO_new_mem_buf_ExpectAnyArgsAndReturn( &memoryBio );
+    PEM_read_bio_X509_ExpectAnyArgsAndReturn( NULL );
+    BIO_free_ExpectAnyArgsAndReturn( 1 );
+    ERR_clear_error_Expect();
+    SSL_CTX_free_Expect( &sslCtx );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_CREDENTIALS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+
+    /* A DER private key that cannot be parsed is invalid. */
+    opensslCredentials.pRootCa = derCredential;
+    opensslCredentials.rootCaLength = sizeof( derCredential );
+    opensslCredentials.pPrivateKey = derCredential;
+    opensslCredentials.privateKeyLength = sizeof( derCredential );
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( &sslCtx );
+    SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_CTX_get_cert_store_ExpectAnyArgsAndReturn( &CaStore );
+    d2i_X509_ExpectAnyArgsAndReturn( &rootCa );
+    X509_STORE_add_cert_ExpectAnyArgsAndReturn( 1 );
+    X509_free_Expect( &rootCa );
+    d2i_X509_ExpectAnyArgsAndReturn( &clientCert );
+    SSL_CTX_use_certificate_ExpectAnyArgsAndReturn( 1 );
+    X509_free_Expect( &clientCert );
+    d2i_AutoPrivateKey_ExpectAnyArgsAndReturn( NULL );
+    SSL_CTX_free_Expect( &sslCtx );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_CREDENTIALS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+}
+
+/**
+ * @brief Test that #Openssl_TlsContextInit loads the private key by URI
+ * through the key provider, loading the provider first.
+ */
+void test_Openssl_TlsContext_Init_Key_From_Uri( void )
+{
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pRootCa = derCredential;
+    opensslCredentials.rootCaLength = sizeof( derCredential );
+    opensslCredentials.pPrivateKeyUri = PRIVATE_KEY_URI;
+    opensslCredentials.pKeyProvider = KEY_PROVIDER;
+
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( &sslCtx );
+    SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_CTX_get_cert_store_ExpectAnyArgsAndReturn( &CaStore );
+    d2i_X509_ExpectAnyArgsAndReturn( &rootCa );
+    X509_STORE_add_cert_ExpectAnyArgsAndReturn( 1 );
+    X509_free_Expect( &rootCa );
+
+    /* The default provider is needed in addition to the key provider. */
+    OSSL_PROVIDER_available_ExpectAndReturn( NULL, KEY_PROVIDER, 0 );
+    OSSL_PROVIDER_load_ExpectAndReturn( NULL, KEY_PROVIDER, &keyProvider );
+    OSSL_PROVIDER_available_ExpectAndReturn( NULL, "default", 1 );
+    OSSL_STORE_open_ExpectAndReturn( PRIVATE_KEY_URI, NULL, NULL, NULL, NULL, &keyStore );
+    OSSL_STORE_expect_ExpectAndReturn( &keyStore, OSSL_STORE_INFO_PKEY, 1 );
+    OSSL_STORE_eof_ExpectAndReturn( &keyStore, 0 );
+    OSSL_STORE_error_ExpectAndReturn( &keyStore, 0 );
+    OSSL_STORE_load_ExpectAndReturn( &keyStore, &keyStoreInfo );
+    OSSL_STORE_INFO_get1_PKEY_ExpectAndReturn( &keyStoreInfo, &privateKey );
+    OSSL_STORE_INFO_free_Expect( &keyStoreInfo );
+    OSSL_STORE_close_ExpectAndReturn( &keyStore, 1 );
+    SSL_CTX_use_PrivateKey_ExpectAndReturn( &sslCtx, &privateKey, 1 );
+    EVP_PKEY_free_Expect( &privateKey );
+
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+
+    SSL_CTX_free_Expect( &sslCtx );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_TlsContextCleanup( &tlsContext ) );
+
+    /* A URI that cannot be opened is invalid. The provider is already
+     * loaded. */
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( &sslCtx );
+    SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_CTX_get_cert_store_ExpectAnyArgsAndReturn( &CaStore );
+    d2i_X509_ExpectAnyArgsAndReturn( &rootCa );
+    X509_STORE_add_cert_ExpectAnyArgsAndReturn( 1 );
+    X509_free_Expect( &rootCa );
+    OSSL_PROVIDER_available_ExpectAndReturn( NULL, KEY_PROVIDER, 1 );
+    OSSL_STORE_open_ExpectAnyArgsAndReturn( NULL );
+    SSL_CTX_free_Expect( &sslCtx );
+    pthread_mutex_destroy_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_CREDENTIALS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+}
+
+/**
+ * @brief Test that #Openssl_TlsContextRotate swaps in the new SSL context and
+ * releases the reference to the old one.
+ */
+void test_Openssl_TlsContext_Rotate( void )
+{
+    opensslCredentials.pClientCertPath = NULL;
+    opensslCredentials.pPrivateKeyPath = NULL;
+    tlsContext.pSslContext = &sslCtx;
+
+    expectCreateSslContextFromRootCa( &rotatedSslCtx );
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_free_Expect( &sslCtx );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS,
+                       Openssl_TlsContextRotate( &tlsContext, &opensslCredentials ) );
+    TEST_ASSERT_EQUAL_PTR( &rotatedSslCtx, tlsContext.pSslContext );
+
+    /* A failed rotation leaves the context unchanged. */
+    TLS_client_method_ExpectAndReturn( &sslMethod );
+    SSL_CTX_new_ExpectAnyArgsAndReturn( NULL );
+    TEST_ASSERT_EQUAL( OPENSSL_API_ERROR,
+                       Openssl_TlsContextRotate( &tlsContext, &opensslCredentials ) );
+    TEST_ASSERT_EQUAL_PTR( &rotatedSslCtx, tlsContext.pSslContext );
+}
+
+/**
+ * @brief Test that #Openssl_Connect references the shared SSL context instead
+ * of loading the credentials.
+ */
+void test_Openssl_Connect_Shared_TlsContext( void )
+{
+    OpensslStatus_t returnStatus;
+
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pTlsContext = &tlsContext;
+    tlsContext.pSslContext = &sslCtx;
+
+    Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    SSL_CTX_free_Expect( &sslCtx );
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Openssl_Connect fails when the shared TLS context has no
+ * SSL context.
+ */
+void test_Openssl_Connect_Shared_TlsContext_Not_Initialized( void )
+{
+    OpensslStatus_t returnStatus;
+
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pTlsContext = &tlsContext;
+    tlsContext.pSslContext = NULL;
+
+    Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_API_ERROR, returnStatus );
+}
+
+/**
+ * @brief Session store callback that loads #storedSession.
+ */
+static size_t loadSession( void * pStoreContext,
+                           uint8_t * pBuffer,
+                           size_t bufferSize )
+{
+    ( void ) pStoreContext;
+    TEST_ASSERT_TRUE( bufferSize >= sizeof( storedSession ) );
+    memcpy( pBuffer, storedSession, sizeof( storedSession ) );
+
+    return sizeof( storedSession );
+}
+
+/**
+ * @brief Session store callback that records the length of the saved session.
+ */
+static void saveSession( void * pStoreContext,
+                         const uint8_t * pSession,
+                         size_t sessionLength )
+{
+    ( void ) pStoreContext;
+    TEST_ASSERT_NOT_NULL( pSession );
+    savedSessionLength = sessionLength;
+}
+
+/**
+ * @brief Stub for #SSL_CTX_sess_set_new_cb that keeps the new session callback.
+ */
+static void SSL_CTX_sess_set_new_cb_Stub( SSL_CTX * ctx,
+                                          NewSessionCallback_t new_session_cb,
+                                          int numCalls )
+{
+    ( void ) ctx;
+    ( void ) numCalls;
+    newSessionCallback = new_session_cb;
+}
+
+/**
+ * @brief Stub for #i2d_SSL_SESSION that serializes a session of
+ * @p sizeof( storedSession ) bytes.
+ */
+static int i2d_SSL_SESSION_Stub( const SSL_SESSION * in,
+                                 unsigned char ** pp,
+                                 int numCalls )
+{
+    ( void ) in;
+    ( void ) numCalls;
+
+    if( pp != NULL )
+    {
+        memcpy( *pp, storedSession, sizeof( storedSession ) );
+        *pp += sizeof( storedSession );
+    }
+
+    return ( int ) sizeof( storedSession );
+}
+
+/**
+ * @brief Test that #Openssl_Connect offers the session loaded from the session
+ * store before the handshake.
+ */
+void test_Openssl_Connect_Offers_Saved_Session( void )
+{
+    OpensslStatus_t returnStatus;
+    OpensslSessionStore_t sessionStore = { loadSession, saveSession, NULL };
+
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pTlsContext = &tlsContext;
+    opensslCredentials.pSessionStore = &sessionStore;
+    tlsContext.pSslContext = &sslCtx;
+
+    Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_ex_data_ExpectAndReturn( &ssl, 0, &sessionStore, 1 );
+    d2i_SSL_SESSION_ExpectAndReturn( NULL, NULL, sizeof( storedSession ), &sslSession );
+    d2i_SSL_SESSION_IgnoreArg_pp();
+    SSL_set_session_ExpectAndReturn( &ssl, &sslSession, 1 );
+    SSL_SESSION_free_Expect( &sslSession );
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        SSL_session_reused_ExpectAnyArgsAndReturn( 1 );
+    #endif
+    SSL_CTX_free_Expect( &sslCtx );
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* A session that fails to parse falls back to a full handshake. */
+    Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_ex_data_ExpectAnyArgsAndReturn( 1 );
+    d2i_SSL_SESSION_ExpectAnyArgsAndReturn( NULL );
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        SSL_session_reused_ExpectAnyArgsAndReturn( 0 );
+    #endif
+    SSL_CTX_free_Expect( &sslCtx );
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that an SSL context created with a session store passes new
+ * sessions to the store of the connection.
+ */
+void test_Openssl_TlsContext_Saves_New_Sessions( void )
+{
+    OpensslSessionStore_t sessionStore = { loadSession, saveSession, NULL };
+
+    opensslCredentials.pClientCertPath = NULL;
+    opensslCredentials.pPrivateKeyPath = NULL;
+    opensslCredentials.pSessionStore = &sessionStore;
+    newSessionCallback = NULL;
+    savedSessionLength = 0U;
+
+    pthread_mutex_init_ExpectAnyArgsAndReturn( 0 );
+    expectCreateSslContextFromRootCa( &sslCtx );
+    SSL_CTX_ctrl_ExpectAndReturn( &sslCtx,
+                                  SSL_CTRL_SET_SESS_CACHE_MODE,
+                                  SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE,
+                                  NULL,
+                                  0 );
+    SSL_CTX_sess_set_new_cb_StubWithCallback( SSL_CTX_sess_set_new_cb_Stub );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS,
+                       Openssl_TlsContextInit( &tlsContext, &opensslCredentials ) );
+    TEST_ASSERT_NOT_NULL( newSessionCallback );
+
+    /* The session is serialized and handed to the store. */
+    SSL_get_ex_data_ExpectAndReturn( &ssl, 0, &sessionStore );
+    i2d_SSL_SESSION_StubWithCallback( i2d_SSL_SESSION_Stub );
+    TEST_ASSERT_EQUAL( 0, newSessionCallback( &ssl, &sslSession ) );
+    TEST_ASSERT_EQUAL( sizeof( storedSession ), savedSessionLength );
+
+    /* Connections without a session store are ignored. */
+    savedSessionLength = 0U;
+    SSL_get_ex_data_ExpectAndReturn( &ssl, 0, NULL );
+    TEST_ASSERT_EQUAL( 0, newSessionCallback( &ssl, &sslSession ) );
+    TEST_ASSERT_EQUAL( 0U, savedSessionLength );
+
+    SSL_CTX_sess_set_new_cb_StubWithCallback( NULL );
+    i2d_SSL_SESSION_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Expect the calls of #Openssl_Send that send early data and complete
+ * the handshake.
+ *
+ * @param[in] earlyDataSent Bytes accepted by #SSL_write_early_data.
+ * @param[in] connectStatus The value to return from #SSL_connect.
+ * @param[in] earlyDataStatus The value to return from #SSL_get_early_data_status.
+ */
+static void expectSendEarlyData( size_t * pEarlyDataSent,
+                                 int connectStatus,
+                                 int earlyDataStatus )
+{
+    SSL_is_init_finished_ExpectAnyArgsAndReturn( 0 );
+    SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+    SSL_SESSION_get_max_early_data_ExpectAndReturn( &sslSession, MAX_EARLY_DATA );
+    SSL_write_early_data_ExpectAndReturn( &ssl, opensslBuffer, MAX_EARLY_DATA, NULL, 1 );
+    SSL_write_early_data_IgnoreArg_written();
+    SSL_write_early_data_ReturnThruPtr_written( pEarlyDataSent );
+    SSL_connect_ExpectAndReturn( &ssl, connectStatus );
+
+    if( connectStatus == 1 )
+    {
+        SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+        SSL_get_early_data_status_ExpectAndReturn( &ssl, earlyDataStatus );
+        #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+            SSL_session_reused_ExpectAnyArgsAndReturn( 1 );
+        #endif
+    }
+}
+
+/**
+ * @brief Test that #Openssl_Connect leaves the handshake to the first send
+ * when the saved session allows early data.
+ */
+void test_Openssl_Connect_Defers_Handshake_For_Early_Data( void )
+{
+    OpensslStatus_t returnStatus;
+    OpensslSessionStore_t sessionStore = { loadSession, saveSession, NULL };
+
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pTlsContext = &tlsContext;
+    opensslCredentials.pSessionStore = &sessionStore;
+    opensslCredentials.enableEarlyData = true;
+    tlsContext.pSslContext = &sslCtx;
+
+    Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_ex_data_ExpectAnyArgsAndReturn( 1 );
+    d2i_SSL_SESSION_ExpectAnyArgsAndReturn( &sslSession );
+    SSL_set_session_ExpectAndReturn( &ssl, &sslSession, 1 );
+    SSL_SESSION_free_Expect( &sslSession );
+    SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+    SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+    SSL_SESSION_get_max_early_data_ExpectAndReturn( &sslSession, MAX_EARLY_DATA );
+    SSL_set_connect_state_Expect( &ssl );
+    SSL_CTX_free_Expect( &sslCtx );
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_TRUE( networkContext.earlyDataEnabled );
+
+    /* A session without early data is resumed with a regular handshake. */
+    Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_ex_data_ExpectAnyArgsAndReturn( 1 );
+    d2i_SSL_SESSION_ExpectAnyArgsAndReturn( &sslSession );
+    SSL_set_session_ExpectAndReturn( &ssl, &sslSession, 1 );
+    SSL_SESSION_free_Expect( &sslSession );
+    SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+    SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+    SSL_SESSION_get_max_early_data_ExpectAndReturn( &sslSession, 0U );
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        SSL_session_reused_ExpectAnyArgsAndReturn( 1 );
+    #endif
+    SSL_CTX_free_Expect( &sslCtx );
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_FALSE( networkContext.earlyDataEnabled );
+}
+
+/**
+ * @brief Test that the first #Openssl_Send sends what the session allows as
+ * early data, and the rest and any rejected early data after the handshake.
+ */
+void test_Openssl_Send_Early_Data( void )
+{
+    int32_t bytesSent;
+    size_t earlyDataSent = MAX_EARLY_DATA;
+
+    networkContext.pSsl = &ssl;
+    networkContext.earlyDataEnabled = true;
+
+    /* The server accepts the early data. */
+    expectSendEarlyData( &earlyDataSent, 1, SSL_EARLY_DATA_ACCEPTED );
+    SSL_write_ExpectAndReturn( &ssl, &opensslBuffer[ MAX_EARLY_DATA ],
+                               BYTES_TO_SEND - MAX_EARLY_DATA,
+                               BYTES_TO_SEND - MAX_EARLY_DATA );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    /* Later sends are regular writes. */
+    SSL_is_init_finished_ExpectAnyArgsAndReturn( 1 );
+    SSL_write_ExpectAndReturn( &ssl, opensslBuffer, BYTES_TO_SEND, BYTES_TO_SEND );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    /* Rejected early data is sent again. */
+    expectSendEarlyData( &earlyDataSent, 1, SSL_EARLY_DATA_REJECTED );
+    SSL_write_ExpectAndReturn( &ssl, opensslBuffer, BYTES_TO_SEND, BYTES_TO_SEND );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    /* The early data is reported when the write after it fails. */
+    expectSendEarlyData( &earlyDataSent, 1, SSL_EARLY_DATA_ACCEPTED );
+    SSL_write_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( MAX_EARLY_DATA, bytesSent );
+
+    /* A failed handshake fails the send. */
+    expectSendEarlyData( &earlyDataSent, -1, SSL_EARLY_DATA_ACCEPTED );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SSL );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_LESS_THAN( 0, bytesSent );
+}
+
+/**
+ * @brief Test that #Openssl_Writev combines small buffers into one record and
+ * writes large buffers without copying them.
+ */
+void test_Openssl_Writev_Coalesces_Buffers( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVectors[ 3 ];
+    static uint8_t payload[ OPENSSL_WRITEV_BUFFER_LENGTH * 2U ];
+
+    networkContext.pSsl = &ssl;
+
+    /* A header and the start of the payload fill the first record, and the
+     * rest of the payload is written directly. */
+    ioVectors[ 0 ].iov_base = opensslBuffer;
+    ioVectors[ 0 ].iov_len = BUFFER_LEN;
+    ioVectors[ 1 ].iov_base = payload;
+    ioVectors[ 1 ].iov_len = sizeof( payload );
+    ioVectors[ 2 ].iov_base = opensslBuffer;
+    ioVectors[ 2 ].iov_len = BUFFER_LEN;
+
+    SSL_write_ExpectAndReturn( &ssl, NULL, OPENSSL_WRITEV_BUFFER_LENGTH, OPENSSL_WRITEV_BUFFER_LENGTH );
+    SSL_write_IgnoreArg_buf();
+    SSL_write_ExpectAndReturn( &ssl,
+                               &payload[ OPENSSL_WRITEV_BUFFER_LENGTH - BUFFER_LEN ],
+                               OPENSSL_WRITEV_BUFFER_LENGTH + BUFFER_LEN,
+                               OPENSSL_WRITEV_BUFFER_LENGTH + BUFFER_LEN );
+    SSL_write_ExpectAndReturn( &ssl, NULL, BUFFER_LEN, BUFFER_LEN );
+    SSL_write_IgnoreArg_buf();
+    bytesSent = Openssl_Writev( &networkContext, ioVectors, 3 );
+    TEST_ASSERT_EQUAL( sizeof( payload ) + ( 2 * BUFFER_LEN ), bytesSent );
+
+    /* Small buffers go out in a single record. */
+    ioVectors[ 1 ].iov_len = BUFFER_LEN;
+    SSL_write_ExpectAndReturn( &ssl, NULL, 3 * BUFFER_LEN, 3 * BUFFER_LEN );
+    SSL_write_IgnoreArg_buf();
+    bytesSent = Openssl_Writev( &networkContext, ioVectors, 3 );
+    TEST_ASSERT_EQUAL( 3 * BUFFER_LEN, bytesSent );
+}
+
+/**
+ * @brief Test that #Openssl_Writev returns an error only when no record was
+ * sent before it.
+ */
+void test_Openssl_Writev_Network_Error( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVectors[ 2 ];
+    static uint8_t payload[ OPENSSL_WRITEV_BUFFER_LENGTH ];
+
+    networkContext.pSsl = &ssl;
+    ioVectors[ 0 ].iov_base = payload;
+    ioVectors[ 0 ].iov_len = sizeof( payload );
+    ioVectors[ 1 ].iov_base = opensslBuffer;
+    ioVectors[ 1 ].iov_len = BUFFER_LEN;
+
+    SSL_write_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SSL );
+    bytesSent = Openssl_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( SSL_READ_WRITE_ERROR, bytesSent );
+
+    SSL_write_ExpectAnyArgsAndReturn( sizeof( payload ) );
+    SSL_write_ExpectAnyArgsAndReturn( 0 );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_ZERO_RETURN );
+    bytesSent = Openssl_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( sizeof( payload ), bytesSent );
+}
+
+#if defined( SSL_OP_ENABLE_KTLS ) && !defined( OPENSSL_NO_KTLS )
+
+/**
+ * @brief Test that #Openssl_SendFile lets the kernel send the file when the
+ * connection uses kTLS.
+ */
+    void test_Openssl_SendFile_Ktls( void )
+    {
+        int32_t bytesSent;
+
+        networkContext.pSsl = &ssl;
+
+        SSL_get_wbio_ExpectAndReturn( &ssl, &socketBio );
+        BIO_ctrl_ExpectAndReturn( &socketBio, BIO_CTRL_GET_KTLS_SEND, 0, NULL, 1 );
+        SSL_sendfile_ExpectAndReturn( &ssl, FILE_DESCRIPTOR, FILE_OFFSET,
+                                      OPENSSL_SENDFILE_BUFFER_LENGTH * 4U, 0,
+                                      OPENSSL_SENDFILE_BUFFER_LENGTH * 4U );
+        bytesSent = Openssl_SendFile( &networkContext, FILE_DESCRIPTOR,
+                                      FILE_OFFSET, OPENSSL_SENDFILE_BUFFER_LENGTH * 4U );
+        TEST_ASSERT_EQUAL( OPENSSL_SENDFILE_BUFFER_LENGTH * 4U, bytesSent );
+
+        SSL_get_wbio_ExpectAndReturn( &ssl, &socketBio );
+        BIO_ctrl_ExpectAndReturn( &socketBio, BIO_CTRL_GET_KTLS_SEND, 0, NULL, 1 );
+        SSL_sendfile_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+        SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SYSCALL );
+        bytesSent = Openssl_SendFile( &networkContext, FILE_DESCRIPTOR,
+                                      FILE_OFFSET, BUFFER_LEN );
+        TEST_ASSERT_EQUAL( SSL_READ_WRITE_ERROR, bytesSent );
+    }
+
+#endif /* if defined( SSL_OP_ENABLE_KTLS ) && !defined( OPENSSL_NO_KTLS ) */
+
+/**
+ * @brief Test that #Openssl_SendFile reads the file into a buffer and sends
+ * it through SSL_write when the connection does not use kTLS.
+ */
+void test_Openssl_SendFile_Copies_File( void )
+{
+    int32_t bytesSent;
+    size_t fileLength = OPENSSL_SENDFILE_BUFFER_LENGTH + BUFFER_LEN;
+
+    networkContext.pSsl = &ssl;
+
+    /* Invalid parameters. */
+    bytesSent = Openssl_SendFile( NULL, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+    bytesSent = Openssl_SendFile( &networkContext, -1, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+
+    /* The file ends before the requested number of bytes. */
+    #if defined( SSL_OP_ENABLE_KTLS ) && !defined( OPENSSL_NO_KTLS )
+        SSL_get_wbio_ExpectAndReturn( &ssl, &socketBio );
+        BIO_ctrl_IgnoreAndReturn( 0 );
+    #endif
+    pread_ExpectAndReturn( FILE_DESCRIPTOR, NULL, OPENSSL_SENDFILE_BUFFER_LENGTH,
+                           FILE_OFFSET, OPENSSL_SENDFILE_BUFFER_LENGTH );
+    pread_IgnoreArg___buf();
+    SSL_write_ExpectAndReturn( &ssl, NULL, OPENSSL_SENDFILE_BUFFER_LENGTH,
+                               OPENSSL_SENDFILE_BUFFER_LENGTH );
+    SSL_write_IgnoreArg_buf();
+    pread_ExpectAndReturn( FILE_DESCRIPTOR, NULL, OPENSSL_SENDFILE_BUFFER_LENGTH,
+                           FILE_OFFSET + OPENSSL_SENDFILE_BUFFER_LENGTH, BUFFER_LEN );
+    pread_IgnoreArg___buf();
+    SSL_write_ExpectAndReturn( &ssl, NULL, BUFFER_LEN, BUFFER_LEN );
+    SSL_write_IgnoreArg_buf();
+    pread_ExpectAndReturn( FILE_DESCRIPTOR, NULL, OPENSSL_SENDFILE_BUFFER_LENGTH,
+                           FILE_OFFSET + fileLength, 0 );
+    pread_IgnoreArg___buf();
+    bytesSent = Openssl_SendFile( &networkContext, FILE_DESCRIPTOR,
+                                  FILE_OFFSET, fileLength * 2U );
+    TEST_ASSERT_EQUAL( fileLength, bytesSent );
+
+    /* Reading the file fails before anything was sent. */
+    #if defined( SSL_OP_ENABLE_KTLS ) && !defined( OPENSSL_NO_KTLS )
+        SSL_get_wbio_ExpectAndReturn( &ssl, &socketBio );
+    #endif
+    pread_ExpectAnyArgsAndReturn( -1 );
+    bytesSent = Openssl_SendFile( &networkContext, FILE_DESCRIPTOR,
+                                  FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+
+    /* Sending fails after the first chunk. */
+    #if defined( SSL_OP_ENABLE_KTLS ) && !defined( OPENSSL_NO_KTLS )
+        SSL_get_wbio_ExpectAndReturn( &ssl, &socketBio );
+    #endif
+    pread_ExpectAnyArgsAndReturn( OPENSSL_SENDFILE_BUFFER_LENGTH );
+    SSL_write_ExpectAnyArgsAndReturn( OPENSSL_SENDFILE_BUFFER_LENGTH );
+    pread_ExpectAnyArgsAndReturn( BUFFER_LEN );
+    SSL_write_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SSL );
+    bytesSent = Openssl_SendFile( &networkContext, FILE_DESCRIPTOR,
+                                  FILE_OFFSET, fileLength );
+    TEST_ASSERT_EQUAL( OPENSSL_SENDFILE_BUFFER_LENGTH, bytesSent );
+}
+
+/**
+ * @brief Test that the counters of a connection record the calls, bytes and
+ * SSL_ERROR_WANT_* results of #Openssl_Recv and #Openssl_Send.
+ */
+void test_Openssl_Stats( void )
+{
+    TransportStats_t stats;
+
+    memset( &stats, 0, sizeof( stats ) );
+    networkContext.pSsl = &ssl;
+    networkContext.pStats = &stats;
+
+    SSL_read_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV ) );
+
+    SSL_read_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_WANT_READ );
+    TEST_ASSERT_EQUAL( 0, Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV ) );
+
+    SSL_write_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND ) );
+
+    SSL_write_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_WANT_WRITE );
+    TEST_ASSERT_EQUAL( SSL_READ_WRITE_ERROR, Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND ) );
+
+    TEST_ASSERT_EQUAL( 2, stats.recvCalls );
+    TEST_ASSERT_EQUAL( 2, stats.sendCalls );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, stats.bytesReceived );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, stats.bytesSent );
+    TEST_ASSERT_EQUAL( 1, stats.recvTimeouts );
+    TEST_ASSERT_EQUAL( 1, stats.errors );
+    TEST_ASSERT_EQUAL( 1, stats.wantReadCount );
+    TEST_ASSERT_EQUAL( 1, stats.wantWriteCount );
+}
+
+/**
+ * @brief Stub for #Sockets_ConnectWithConfig that keeps the connect timing
+ * of the configuration.
+ */
+static SocketStatus_t Sockets_ConnectWithConfig_Stub( int32_t * pTcpSocket,
+                                                      const ServerInfo_t * pServerInfo,
+                                                      const SocketsConfig_t * pSocketsConfig,
+                                                      int numCalls )
+{
+    ( void ) pTcpSocket;
+    ( void ) pServerInfo;
+    ( void ) numCalls;
+    pSocketsConnectTiming = pSocketsConfig->pConnectTiming;
+
+    return SOCKETS_SUCCESS;
+}
+
+/**
+ * @brief Stub for #Clock_GetTimeUs that advances the fake clock by
+ * #FAKE_CLOCK_STEP_US on every read.
+ */
+static uint64_t Clock_GetTimeUs_Stub( int numCalls )
+{
+    ( void ) numCalls;
+    fakeClockUs += FAKE_CLOCK_STEP_US;
+
+    return fakeClockUs;
+}
+
+/**
+ * @brief Stub for #SSL_set_msg_callback that keeps the message callback.
+ */
+static void SSL_set_msg_callback_Stub( SSL * ssl,
+                                       MessageCallback_t cb,
+                                       int numCalls )
+{
+    ( void ) ssl;
+    ( void ) numCalls;
+    messageCallback = cb;
+    messageCallbackSetCount++;
+}
+
+/**
+ * @brief Stub for #SSL_connect that passes the messages of a TLS 1.3
+ * handshake to the message callback, and completes the handshake.
+ */
+static int SSL_connect_Stub( SSL * ssl,
+                             int numCalls )
+{
+    const uint8_t clientHello[] = { SSL3_MT_CLIENT_HELLO };
+    const uint8_t serverHello[] = { SSL3_MT_SERVER_HELLO };
+    const uint8_t encryptedExtensions[] = { SSL3_MT_ENCRYPTED_EXTENSIONS };
+    const uint8_t certificate[] = { SSL3_MT_CERTIFICATE };
+    const uint8_t certificateVerify[] = { SSL3_MT_CERTIFICATE_VERIFY };
+    const uint8_t finished[] = { SSL3_MT_FINISHED };
+    const uint8_t recordHeader[] = { SSL3_RT_HANDSHAKE, 0x03, 0x03, 0x00, 0x01 };
+    void * pArgument = pSocketsConnectTiming;
+
+    ( void ) numCalls;
+    TEST_ASSERT_NOT_NULL( messageCallback );
+
+    /* Sent messages and messages before the certificate are not timed. */
+    messageCallback( 1, TLS1_3_VERSION, SSL3_RT_HANDSHAKE, clientHello,
+                     sizeof( clientHello ), ssl, pArgument );
+    messageCallback( 0, TLS1_3_VERSION, SSL3_RT_HANDSHAKE, serverHello,
+                     sizeof( serverHello ), ssl, pArgument );
+    messageCallback( 0, TLS1_3_VERSION, SSL3_RT_HANDSHAKE, encryptedExtensions,
+                     sizeof( encryptedExtensions ), ssl, pArgument );
+
+    /* The certificate is received, and the next message from the server
+     * follows its verification. */
+    messageCallback( 0, TLS1_3_VERSION, SSL3_RT_HANDSHAKE, certificate,
+                     sizeof( certificate ), ssl, pArgument );
+    messageCallback( 0, TLS1_3_VERSION, SSL3_RT_HEADER, recordHeader,
+                     sizeof( recordHeader ), ssl, pArgument );
+    messageCallback( 0, TLS1_3_VERSION, SSL3_RT_HANDSHAKE, certificateVerify,
+                     0U, ssl, pArgument );
+    messageCallback( 0, TLS1_3_VERSION, SSL3_RT_HANDSHAKE, certificateVerify,
+                     sizeof( certificateVerify ), ssl, pArgument );
+
+    /* Later messages do not move the verification time. */
+    messageCallback( 0, TLS1_3_VERSION, SSL3_RT_HANDSHAKE, finished,
+                     sizeof( finished ), ssl, pArgument );
+
+    return 1;
+}
+
+/**
+ * @brief Test that #Openssl_Connect records when the server certificate was
+ * received and verified and when the handshake completed, and passes the
+ * connect timing to #Sockets_ConnectWithConfig for the earlier phases.
+ */
+void test_Openssl_Connect_Records_Connect_Timing( void )
+{
+    OpensslStatus_t returnStatus;
+    ConnectTiming_t connectTiming;
+
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pTlsContext = &tlsContext;
+    tlsContext.pSslContext = &sslCtx;
+    memset( &connectTiming, 0, sizeof( ConnectTiming_t ) );
+    networkContext.pConnectTiming = &connectTiming;
+    pSocketsConnectTiming = NULL;
+    messageCallback = NULL;
+    messageCallbackSetCount = 0;
+    fakeClockUs = FAKE_CLOCK_START_US;
+
+    Sockets_ConnectWithConfig_StubWithCallback( Sockets_ConnectWithConfig_Stub );
+    Clock_GetTimeUs_StubWithCallback( Clock_GetTimeUs_Stub );
+    SSL_set_msg_callback_StubWithCallback( SSL_set_msg_callback_Stub );
+    SSL_connect_StubWithCallback( SSL_connect_Stub );
+
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_ctrl_ExpectAndReturn( &ssl, SSL_CTRL_SET_MSG_CALLBACK_ARG, 0, &connectTiming, 0 );
+    SSL_session_reused_ExpectAndReturn( &ssl, 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    SSL_CTX_free_Expect( &sslCtx );
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        SSL_session_reused_ExpectAnyArgsAndReturn( 1 );
+    #endif
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_EQUAL_PTR( &connectTiming, pSocketsConnectTiming );
+
+    /* The clock is read when the certificate is received, when the next
+     * message arrives, and when the handshake completes. */
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US + FAKE_CLOCK_STEP_US,
+                       connectTiming.tlsCertificateReceivedUs );
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US + ( 2U * FAKE_CLOCK_STEP_US ),
+                       connectTiming.tlsCertificateVerifiedUs );
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US + ( 3U * FAKE_CLOCK_STEP_US ),
+                       connectTiming.tlsHandshakeDoneUs );
+    TEST_ASSERT_TRUE( connectTiming.tlsSessionResumed );
+    TEST_ASSERT_EQUAL( 0, connectTiming.connackReceivedUs );
+
+    /* The callback is removed after the handshake. */
+    TEST_ASSERT_EQUAL( 2, messageCallbackSetCount );
+    TEST_ASSERT_NULL( messageCallback );
+
+    Sockets_ConnectWithConfig_StubWithCallback( NULL );
+    Clock_GetTimeUs_StubWithCallback( NULL );
+    SSL_set_msg_callback_StubWithCallback( NULL );
+    SSL_connect_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Test that #Openssl_Connect neither sets the message callback nor
+ * reads the clock when no #ConnectTiming_t is passed.
+ */
+void test_Openssl_Connect_Without_Connect_Timing( void )
+{
+    OpensslStatus_t returnStatus;
+    ConnectTiming_t unusedTiming;
+
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pTlsContext = &tlsContext;
+    tlsContext.pSslContext = &sslCtx;
+    pSocketsConnectTiming = &unusedTiming;
+    messageCallbackSetCount = 0;
+    fakeClockUs = FAKE_CLOCK_START_US;
+
+    Sockets_ConnectWithConfig_StubWithCallback( Sockets_ConnectWithConfig_Stub );
+    Clock_GetTimeUs_StubWithCallback( Clock_GetTimeUs_Stub );
+    SSL_set_msg_callback_StubWithCallback( SSL_set_msg_callback_Stub );
+
+    pthread_mutex_lock_ExpectAnyArgsAndReturn( 0 );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    pthread_mutex_unlock_ExpectAnyArgsAndReturn( 0 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    SSL_CTX_free_Expect( &sslCtx );
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        SSL_session_reused_ExpectAnyArgsAndReturn( 0 );
+    #endif
+
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_NULL( pSocketsConnectTiming );
+    TEST_ASSERT_EQUAL( 0, messageCallbackSetCount );
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US, fakeClockUs );
+
+    Sockets_ConnectWithConfig_StubWithCallback( NULL );
+    Clock_GetTimeUs_StubWithCallback( NULL );
+    SSL_set_msg_callback_StubWithCallback( NULL );
+}
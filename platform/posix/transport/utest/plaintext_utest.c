@@ -34,6 +34,7 @@
 #include "mock_stdio_api.h"
 #include "mock_select_api.h"
 #include "mock_socket.h"
+#include "mock_sendfile_api.h"
 
 /* The send and receive timeout to set for the socket. */
 #define SEND_RECV_TIMEOUT    0
@@ -49,6 +50,10 @@
 /* The size of the buffer passed to #Plaintext_Send and #Plaintext_Recv. */
 #define BUFFER_LEN           4
 
+/* Descriptor and offset of a file sent with #Plaintext_SendFile. */
+#define FILE_DESCRIPTOR      3
+#define FILE_OFFSET          100
+
 /* An unknown transport status for the default case. */
 #define UNKNOWN_ERRNO        42
 
@@ -56,6 +61,7 @@
 #define SEND_RECV_ERROR      -1
 
 static ServerInfo_t serverInfo;
+static SocketsConfig_t socketsConfig;
 static NetworkContext_t networkContext;
 static uint8_t plaintextBuffer[ BUFFER_LEN ] = { 0 };
 
@@ -77,6 +83,9 @@ void setUp()
     serverInfo.pHostName = HOSTNAME;
     serverInfo.hostNameLength = strlen( HOSTNAME );
     serverInfo.port = PORT;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    memset( &networkContext, 0, sizeof( NetworkContext_t ) );
 }
 
 /* Called after each test method. */
@@ -114,6 +123,88 @@ void test_Plaintext_Connect_Forwards_From_Sockets_Connect( void )
     TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
 }
 
+/**
+ * @brief Test that #Plaintext_Connect rejects a NULL network context without
+ * connecting.
+ */
+void test_Plaintext_Connect_Invalid_Params( void )
+{
+    SocketStatus_t socketStatus;
+
+    socketStatus = Plaintext_Connect( NULL,
+                                      &serverInfo,
+                                      SEND_RECV_TIMEOUT,
+                                      SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+}
+
+/**
+ * @brief Test that #Plaintext_ConnectWithConfig validates its parameters.
+ */
+void test_Plaintext_ConnectWithConfig_Invalid_Params( void )
+{
+    SocketStatus_t socketStatus;
+
+    socketStatus = Plaintext_ConnectWithConfig( NULL,
+                                                &serverInfo,
+                                                &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Plaintext_ConnectWithConfig( &networkContext,
+                                                &serverInfo,
+                                                NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+}
+
+/**
+ * @brief Test that #Plaintext_ConnectWithConfig keeps the timeouts in the
+ * network context and forwards the status from #Sockets_ConnectWithConfig.
+ */
+void test_Plaintext_ConnectWithConfig_Caches_Timeouts( void )
+{
+    SocketStatus_t socketStatus;
+
+    socketsConfig.sendTimeoutMs = 10;
+    socketsConfig.recvTimeoutMs = 20;
+    socketsConfig.nonBlocking = true;
+
+    Sockets_ConnectWithConfig_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    socketStatus = Plaintext_ConnectWithConfig( &networkContext,
+                                                &serverInfo,
+                                                &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 10, networkContext.sendTimeoutMs );
+    TEST_ASSERT_EQUAL( 20, networkContext.recvTimeoutMs );
+    TEST_ASSERT_TRUE( networkContext.nonBlocking );
+}
+
+/**
+ * @brief Test that #Plaintext_ConnectUnix validates its parameters, keeps the
+ * timeouts in the network context and forwards the status from
+ * #Sockets_ConnectUnix.
+ */
+void test_Plaintext_ConnectUnix( void )
+{
+    SocketStatus_t socketStatus;
+
+    socketStatus = Plaintext_ConnectUnix( NULL, "/tmp/broker", 11U, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Plaintext_ConnectUnix( &networkContext, "/tmp/broker", 11U, NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketsConfig.sendTimeoutMs = 10;
+    socketsConfig.recvTimeoutMs = 20;
+    socketsConfig.nonBlocking = true;
+
+    Sockets_ConnectUnix_ExpectAnyArgsAndReturn( SOCKETS_CONNECT_FAILURE );
+    socketStatus = Plaintext_ConnectUnix( &networkContext, "/tmp/broker", 11U, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+    TEST_ASSERT_EQUAL( 10, networkContext.sendTimeoutMs );
+    TEST_ASSERT_EQUAL( 20, networkContext.recvTimeoutMs );
+    TEST_ASSERT_TRUE( networkContext.nonBlocking );
+}
+
 /**
  * @brief Test that #Plaintext_Disconnect forwards the status from #Sockets_Disconnect.
  *
@@ -216,6 +307,97 @@ void test_Plaintext_Recv_Network_Error( void )
     }
 }
 
+/**
+ * @brief Test that #Plaintext_RecvAll keeps reading until all requested bytes
+ * have arrived.
+ */
+void test_Plaintext_RecvAll_Partial_Reads( void )
+{
+    int32_t bytesReceived;
+
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( 1 );
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV - 1 );
+    bytesReceived = Plaintext_RecvAll( &networkContext,
+                                       plaintextBuffer,
+                                       BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+
+    /* Spurious wakeups in non-blocking mode do not end the receive. */
+    networkContext.nonBlocking = true;
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+    bytesReceived = Plaintext_RecvAll( &networkContext,
+                                       plaintextBuffer,
+                                       BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+}
+
+/**
+ * @brief Test that #Plaintext_RecvAll returns the bytes received so far when
+ * the timeout expires.
+ */
+void test_Plaintext_RecvAll_Timeout( void )
+{
+    int32_t bytesReceived;
+
+    getsockopt_ExpectAnyArgsAndReturn( -1 );
+    select_ExpectAnyArgsAndReturn( 0 );
+    bytesReceived = Plaintext_RecvAll( &networkContext,
+                                       plaintextBuffer,
+                                       BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( 1 );
+    select_ExpectAnyArgsAndReturn( 0 );
+    bytesReceived = Plaintext_RecvAll( &networkContext,
+                                       plaintextBuffer,
+                                       BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 1, bytesReceived );
+}
+
+/**
+ * @brief Test that #Plaintext_RecvAll returns an error when polling or
+ * receiving fails, or the peer closes the connection, even after a partial read.
+ */
+void test_Plaintext_RecvAll_Errors( void )
+{
+    int32_t bytesReceived;
+
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    select_ExpectAnyArgsAndReturn( -1 );
+    bytesReceived = Plaintext_RecvAll( &networkContext,
+                                       plaintextBuffer,
+                                       BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesReceived );
+
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( 1 );
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( 0 );
+    bytesReceived = Plaintext_RecvAll( &networkContext,
+                                       plaintextBuffer,
+                                       BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesReceived );
+
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = ECONNRESET;
+    bytesReceived = Plaintext_RecvAll( &networkContext,
+                                       plaintextBuffer,
+                                       BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesReceived );
+}
+
 /**
  * @brief Test the happy path case when #Plaintext_Send is able to send all bytes
  * over the network stack successfully.
@@ -303,3 +485,311 @@ void test_Plaintext_Send_Poll_Error( void )
                                 BYTES_TO_SEND );
     TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
 }
+
+/**
+ * @brief Test that #Plaintext_Recv in non-blocking mode receives without
+ * waiting when data is already available.
+ */
+void test_Plaintext_Recv_NonBlocking_Data_Available( void )
+{
+    int32_t bytesReceived;
+
+    networkContext.nonBlocking = true;
+
+    recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+}
+
+/**
+ * @brief Test that #Plaintext_Recv in non-blocking mode waits for the socket
+ * when no data is available and receives once it is readable.
+ */
+void test_Plaintext_Recv_NonBlocking_Waits_On_EAGAIN( void )
+{
+    int32_t bytesReceived;
+
+    networkContext.nonBlocking = true;
+
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+
+    /* A spurious wakeup is reported as no data. */
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EWOULDBLOCK;
+    select_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+}
+
+/**
+ * @brief Test that #Plaintext_Recv in non-blocking mode handles timeouts,
+ * polling errors, network errors and a closed connection.
+ */
+void test_Plaintext_Recv_NonBlocking_Errors( void )
+{
+    int32_t bytesReceived;
+
+    networkContext.nonBlocking = true;
+
+    /* Timed out waiting for data. */
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 0 );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+    /* Failed to wait for data. */
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( -1 );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesReceived );
+
+    /* Network error. */
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = ECONNRESET;
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesReceived );
+
+    /* Peer closed the connection. */
+    recv_ExpectAnyArgsAndReturn( 0 );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesReceived );
+}
+
+/**
+ * @brief Test that #Plaintext_Send in non-blocking mode sends without
+ * waiting, and waits for the socket only when its buffer is full.
+ */
+void test_Plaintext_Send_NonBlocking( void )
+{
+    int32_t bytesSent;
+
+    networkContext.nonBlocking = true;
+
+    send_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 1 );
+    send_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 1 );
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+}
+
+/**
+ * @brief Test that #Plaintext_Send in non-blocking mode handles timeouts,
+ * polling errors and network errors.
+ */
+void test_Plaintext_Send_NonBlocking_Errors( void )
+{
+    int32_t bytesSent;
+
+    networkContext.nonBlocking = true;
+
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EWOULDBLOCK;
+    select_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( -1 );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EPIPE;
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+
+    send_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+}
+
+/**
+ * @brief Test that #Plaintext_Writev sends all buffers with one #sendmsg and
+ * handles a full send buffer in both socket modes.
+ */
+void test_Plaintext_Writev( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVectors[ 2 ];
+
+    ioVectors[ 0 ].iov_base = plaintextBuffer;
+    ioVectors[ 0 ].iov_len = BUFFER_LEN / 2;
+    ioVectors[ 1 ].iov_base = &plaintextBuffer[ BUFFER_LEN / 2 ];
+    ioVectors[ 1 ].iov_len = BUFFER_LEN / 2;
+
+    sendmsg_ExpectAnyArgsAndReturn( BUFFER_LEN );
+    bytesSent = Plaintext_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( BUFFER_LEN, bytesSent );
+
+    /* The send timeout of a blocking socket expired. */
+    sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    bytesSent = Plaintext_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EPIPE;
+    bytesSent = Plaintext_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+
+    networkContext.nonBlocking = true;
+
+    sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EWOULDBLOCK;
+    select_ExpectAnyArgsAndReturn( 1 );
+    sendmsg_ExpectAnyArgsAndReturn( BUFFER_LEN );
+    bytesSent = Plaintext_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( BUFFER_LEN, bytesSent );
+
+    sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    sendmsg_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_Writev( &networkContext, ioVectors, 2 );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+}
+
+/**
+ * @brief Test that #Plaintext_SendFile sends the file with #sendfile and
+ * handles a full send buffer and the end of the file.
+ */
+void test_Plaintext_SendFile( void )
+{
+    int32_t bytesSent;
+
+    sendfile_ExpectAndReturn( 0, FILE_DESCRIPTOR, NULL, BUFFER_LEN, BUFFER_LEN );
+    sendfile_IgnoreArg_offset();
+    bytesSent = Plaintext_SendFile( &networkContext, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( BUFFER_LEN, bytesSent );
+
+    /* The file ended, which is not a closed connection. */
+    sendfile_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_SendFile( &networkContext, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    /* The send timeout of a blocking socket expired. */
+    sendfile_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    bytesSent = Plaintext_SendFile( &networkContext, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    sendfile_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EPIPE;
+    bytesSent = Plaintext_SendFile( &networkContext, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+
+    networkContext.nonBlocking = true;
+
+    sendfile_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EWOULDBLOCK;
+    select_ExpectAnyArgsAndReturn( 1 );
+    sendfile_ExpectAnyArgsAndReturn( BUFFER_LEN );
+    bytesSent = Plaintext_SendFile( &networkContext, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( BUFFER_LEN, bytesSent );
+
+    sendfile_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_SendFile( &networkContext, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    sendfile_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    bytesSent = Plaintext_SendFile( &networkContext, FILE_DESCRIPTOR, FILE_OFFSET, BUFFER_LEN );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+}
+
+/**
+ * @brief Test that the counters of a connection record the calls, bytes,
+ * timeouts and system calls of #Plaintext_Recv and #Plaintext_Send, and that
+ * #TransportStats_Snapshot resets them.
+ */
+void test_Plaintext_Stats( void )
+{
+    TransportStats_t stats, snapshot;
+
+    memset( &stats, 0, sizeof( stats ) );
+    networkContext.pStats = &stats;
+    networkContext.nonBlocking = true;
+
+    recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, Plaintext_Recv( &networkContext, plaintextBuffer, BYTES_TO_RECV ) );
+
+    /* A receive timeout waits for the socket once. */
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    select_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( 0, Plaintext_Recv( &networkContext, plaintextBuffer, BYTES_TO_RECV ) );
+
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = UNKNOWN_ERRNO;
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, Plaintext_Send( &networkContext, plaintextBuffer, BYTES_TO_SEND ) );
+
+    TEST_ASSERT_EQUAL( 2, stats.recvCalls );
+    TEST_ASSERT_EQUAL( 1, stats.sendCalls );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, stats.bytesReceived );
+    TEST_ASSERT_EQUAL( 0, stats.bytesSent );
+    TEST_ASSERT_EQUAL( 1, stats.recvTimeouts );
+    TEST_ASSERT_EQUAL( 1, stats.errors );
+    TEST_ASSERT_EQUAL( 4, stats.systemCalls );
+
+    TEST_ASSERT_TRUE( TransportStats_Snapshot( &stats, &snapshot, true ) );
+    TEST_ASSERT_EQUAL( 2, snapshot.recvCalls );
+    TEST_ASSERT_EQUAL( 0, stats.recvCalls );
+    TEST_ASSERT_EQUAL( 0, stats.systemCalls );
+    TEST_ASSERT_FALSE( TransportStats_Snapshot( NULL, &snapshot, false ) );
+    TEST_ASSERT_FALSE( TransportStats_Snapshot( &stats, NULL, false ) );
+}
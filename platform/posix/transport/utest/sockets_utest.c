@@ -20,21 +20,28 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
 #include "/usr/include/errno.h"
 
 #include "unity.h"
 
 /* Include paths for public enums, structures, and macros. */
 #include "sockets_posix.h"
+#include "dns_cache_posix.h"
 
 #include "mock_netdb.h"
 #include "mock_socket.h"
 #include "mock_inet.h"
 #include "mock_unistd_api.h"
 #include "mock_stdio_api.h"
+#include "mock_fcntl_api.h"
+#include "mock_poll_api.h"
 
 /* The number of #addrinfo objects to create in the linked list. */
 #define NUM_ADDR_INFO        3
@@ -46,9 +53,68 @@
 #define HOSTNAME             "amazon.com"
 #define PORT                 80
 
+/* The path of the Unix domain socket to connect to, as an abstract address. */
+#define UNIX_SOCKET_PATH           "\0broker"
+#define UNIX_SOCKET_PATH_LENGTH    ( sizeof( UNIX_SOCKET_PATH ) - 1U )
+
+/* The delay between racing connection attempts. */
+#define ATTEMPT_DELAY_MS     250
+
+/* The time allowed for establishing a connection. */
+#define CONNECT_TIMEOUT_MS   20
+
+/* The time of the fake monotonic clock when a test starts it, and how much
+ * it advances on every read, in microseconds. */
+#define FAKE_CLOCK_START_US  1000000U
+#define FAKE_CLOCK_STEP_US   1500U
+
+/* A start time set before connecting, which must be kept. */
+#define PRESET_START_US      42U
+
 static struct addrinfo * addrInfo;
 static ServerInfo_t serverInfo;
 
+/* The index of the connection attempt that #poll_Stub reports as complete. */
+static nfds_t completedAttempt;
+
+/* The socket options set through #setsockopt_Stub. */
+static int setOptionNames[ 16 ];
+static int setOptionValues[ 16 ];
+
+/* Whether #__wrap_clock_gettime returns the fake monotonic clock, and its
+ * time in microseconds. */
+static bool fakeClockEnabled = false;
+static uint64_t fakeClockUs;
+
+/* The clock_gettime of the C library. */
+int __real_clock_gettime( clockid_t clockId,
+                          struct timespec * pTime );
+
+/**
+ * @brief Replaces clock_gettime for the sockets transport, as the test is
+ * linked with --wrap=clock_gettime. While #fakeClockEnabled is set, the
+ * monotonic clock advances by #FAKE_CLOCK_STEP_US on every read, so that the
+ * times of the phases of a connection are known.
+ */
+int __wrap_clock_gettime( clockid_t clockId,
+                          struct timespec * pTime )
+{
+    int status = 0;
+
+    if( ( fakeClockEnabled == true ) && ( clockId == CLOCK_MONOTONIC ) )
+    {
+        fakeClockUs += FAKE_CLOCK_STEP_US;
+        pTime->tv_sec = ( time_t ) ( fakeClockUs / 1000000U );
+        pTime->tv_nsec = ( long ) ( ( fakeClockUs % 1000000U ) * 1000U );
+    }
+    else
+    {
+        status = __real_clock_gettime( clockId, pTime );
+    }
+
+    return status;
+}
+
 /**
  * @brief Allocate a linked list that mocks a set of DNS records returned from
  * a call to #getaddrinfo.
@@ -132,6 +198,7 @@ void setUp()
 /* Called after each test method. */
 void tearDown()
 {
+    fakeClockEnabled = false;
 }
 
 /* Called at the beginning of the whole suite. */
@@ -370,3 +437,677 @@ void test_Sockets_Connect_Succeed_On_Nth_IP_Address( void )
                                     SEND_RECV_TIMEOUT );
     TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
 }
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig fails when the configuration is NULL.
+ */
+void test_Sockets_ConnectWithConfig_Invalid_Params( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = 1;
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig puts the socket in non-blocking
+ * mode instead of setting the socket timeouts.
+ */
+void test_Sockets_ConnectWithConfig_NonBlocking( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int tcpSocket = 1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    socketsConfig.nonBlocking = true;
+
+    expectSocketsConnectCalls( NUM_ADDR_INFO );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig returns an error when the
+ * socket cannot be put in non-blocking mode.
+ */
+void test_Sockets_ConnectWithConfig_NonBlocking_Fails( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int tcpSocket = 1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    socketsConfig.nonBlocking = true;
+
+    /* Fail getting the socket flags. */
+    expectSocketsConnectCalls( NUM_ADDR_INFO );
+    fcntl_ExpectAnyArgsAndReturn( -1 );
+    errno = EBADF;
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    /* Fail setting the socket flags. */
+    expectSocketsConnectCalls( NUM_ADDR_INFO );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( -1 );
+    errno = EINVAL;
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_API_ERROR, socketStatus );
+}
+
+/**
+ * @brief Stub for #poll that times out on the first call, and then reports
+ * the attempt at #completedAttempt as complete and moves to the next one.
+ */
+static int poll_Stub( struct pollfd * __fds,
+                      nfds_t __nfds,
+                      int __timeout,
+                      int numCalls )
+{
+    int pollStatus = 0;
+
+    TEST_ASSERT_TRUE( completedAttempt < __nfds );
+
+    if( numCalls == 0 )
+    {
+        TEST_ASSERT_EQUAL( ATTEMPT_DELAY_MS, __timeout );
+    }
+    else
+    {
+        __fds[ completedAttempt ].revents = POLLOUT;
+        completedAttempt++;
+        pollStatus = 1;
+    }
+
+    return pollStatus;
+}
+
+/**
+ * @brief Expect the calls that start a non-blocking connection attempt.
+ *
+ * @param[in] tcpSocket The socket to return from #socket.
+ * @param[in] connectStatus The value to return from #connect.
+ */
+static void expectStartConnection( int tcpSocket,
+                                   int connectStatus )
+{
+    socket_ExpectAnyArgsAndReturn( tcpSocket );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( connectStatus );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig starts the next connection
+ * attempt when the attempt delay expires, uses the first connection
+ * established and closes the others.
+ */
+void test_Sockets_ConnectWithConfig_Races_Attempts( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int tcpSocket = -1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    socketsConfig.connectionAttemptDelayMs = ATTEMPT_DELAY_MS;
+    completedAttempt = 1;
+    errno = EINPROGRESS;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    expectStartConnection( 3, -1 );
+    poll_StubWithCallback( poll_Stub );
+    expectStartConnection( 4, -1 );
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    close_ExpectAndReturn( 3, 0 );
+    freeaddrinfo_ExpectAnyArgs();
+
+    /* The socket is put back in blocking mode for the socket timeouts. */
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 4, tcpSocket );
+
+    poll_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig starts the next connection
+ * attempt immediately when an attempt fails, and fails when every attempt
+ * fails.
+ */
+void test_Sockets_ConnectWithConfig_Race_Attempts_Fail( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int tcpSocket = -1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    socketsConfig.connectionAttemptDelayMs = ATTEMPT_DELAY_MS;
+    socketsConfig.nonBlocking = true;
+    completedAttempt = 1;
+    errno = EINPROGRESS;
+
+    /* The first socket cannot be created, the second attempt completes with
+     * an error and the third connects. The socket stays non-blocking. */
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( -1 );
+    expectStartConnection( 3, -1 );
+    poll_StubWithCallback( poll_Stub );
+    expectStartConnection( 4, -1 );
+    getsockopt_ExpectAnyArgsAndReturn( -1 );
+    close_ExpectAndReturn( 3, 0 );
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 4, tcpSocket );
+    poll_StubWithCallback( NULL );
+
+    /* Every connection is refused without waiting. */
+    errno = ECONNREFUSED;
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( -1 );
+    expectStartConnection( 3, -1 );
+    close_ExpectAndReturn( 3, 0 );
+    expectStartConnection( 4, -1 );
+    close_ExpectAndReturn( 4, 0 );
+    freeaddrinfo_ExpectAnyArgs();
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+}
+
+/**
+ * @brief Stub for #poll that lets the time out expire without any connection
+ * attempt completing.
+ */
+static int poll_Timeout_Stub( struct pollfd * __fds,
+                              nfds_t __nfds,
+                              int __timeout,
+                              int numCalls )
+{
+    struct timespec sleepTime;
+
+    ( void ) __fds;
+    ( void ) numCalls;
+
+    /* Only one attempt is in progress without an attempt delay. */
+    TEST_ASSERT_EQUAL( 1, __nfds );
+    TEST_ASSERT_TRUE( ( __timeout >= 0 ) && ( __timeout <= CONNECT_TIMEOUT_MS ) );
+
+    sleepTime.tv_sec = 0;
+    sleepTime.tv_nsec = ( long ) __timeout * 1000000L;
+    ( void ) nanosleep( &sleepTime, NULL );
+
+    return 0;
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig connects with a non-blocking
+ * connect when a connect timeout is set, and fails once the timeout expires.
+ */
+void test_Sockets_ConnectWithConfig_Connect_Timeout( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int tcpSocket = -1;
+    struct pollfd completedPoll = { 3, POLLOUT, POLLOUT };
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    socketsConfig.connectTimeoutMs = CONNECT_TIMEOUT_MS;
+    errno = EINPROGRESS;
+
+    /* The first attempt connects within the timeout, and the socket is put
+     * back in blocking mode for the socket timeouts. */
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    expectStartConnection( 3, -1 );
+    poll_ExpectAnyArgsAndReturn( 1 );
+    poll_ReturnThruPtr___fds( &completedPoll );
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 3, tcpSocket );
+
+    /* The first attempt does not complete in time, and the remaining
+     * addresses are not attempted. */
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    expectStartConnection( 3, -1 );
+    poll_StubWithCallback( poll_Timeout_Stub );
+    close_ExpectAndReturn( 3, 0 );
+    freeaddrinfo_ExpectAnyArgs();
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+
+    poll_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Expect the calls that connect a socket with a blocking connect and
+ * set its timeouts.
+ *
+ * @param[in] connectStatus The value to return from #connect.
+ */
+static void expectBlockingConnection( int connectStatus )
+{
+    socket_ExpectAnyArgsAndReturn( 1 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( connectStatus );
+
+    if( connectStatus == 0 )
+    {
+        setsockopt_ExpectAnyArgsAndReturn( 0 );
+        setsockopt_ExpectAnyArgsAndReturn( 0 );
+    }
+    else
+    {
+        close_ExpectAnyArgsAndReturn( 0 );
+    }
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig takes the addresses from the
+ * DNS cache, and removes them from the cache when no connection succeeds.
+ */
+void test_Sockets_ConnectWithConfig_Uses_Dns_Cache( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int tcpSocket = -1;
+    struct sockaddr_in address;
+    struct addrinfo cachedAddrInfo;
+    struct addrinfo * pCachedAddrInfo = &cachedAddrInfo;
+
+    memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    memset( &cachedAddrInfo, 0, sizeof( cachedAddrInfo ) );
+    cachedAddrInfo.ai_family = AF_INET;
+    cachedAddrInfo.ai_socktype = SOCK_STREAM;
+    cachedAddrInfo.ai_protocol = IPPROTO_TCP;
+    cachedAddrInfo.ai_addrlen = sizeof( address );
+    cachedAddrInfo.ai_addr = ( struct sockaddr * ) &address;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    socketsConfig.useDnsCache = true;
+    DnsCache_Clear();
+
+    /* The cached list is not freed by #Sockets_ConnectWithConfig. */
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pCachedAddrInfo );
+    freeaddrinfo_ExpectAnyArgs();
+    expectBlockingConnection( 0 );
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+
+    /* DNS is skipped on the next connect. */
+    expectBlockingConnection( -1 );
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+
+    /* The failure removed the host name from the cache. */
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pCachedAddrInfo );
+    freeaddrinfo_ExpectAnyArgs();
+    expectBlockingConnection( 0 );
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+
+    getaddrinfo_ExpectAnyArgsAndReturn( EAI_NONAME );
+    DnsCache_Clear();
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, socketStatus );
+}
+
+/**
+ * @brief Stub for #setsockopt that records the integer options set.
+ */
+static int setsockopt_Stub( int __fd,
+                            int __level,
+                            int __optname,
+                            const void * __optval,
+                            socklen_t __optlen,
+                            int numCalls )
+{
+    ( void ) __fd;
+    ( void ) __level;
+
+    TEST_ASSERT_TRUE( numCalls < 16 );
+    setOptionNames[ numCalls ] = __optname;
+
+    /* The send and receive timeouts are not integers. */
+    if( __optlen == sizeof( int ) )
+    {
+        setOptionValues[ numCalls ] = *( ( const int * ) __optval );
+    }
+
+    /* Fail one option, which is skipped. */
+    return ( __optname == SO_SNDBUF ) ? -1 : 0;
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig sets the socket options before
+ * connecting, and skips the options that cannot be set.
+ */
+void test_Sockets_ConnectWithConfig_Socket_Options( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    SocketOptions_t socketOptions;
+    int tcpSocket = -1;
+
+    memset( &socketOptions, 0, sizeof( SocketOptions_t ) );
+    socketOptions.noDelay = true;
+    socketOptions.keepAlive = true;
+    socketOptions.keepAliveIdleSec = 30;
+    socketOptions.sendBufferSize = 2048;
+    socketOptions.receiveBufferSize = 4096;
+    socketOptions.userTimeoutMs = 5000;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    socketsConfig.pSocketOptions = &socketOptions;
+    memset( setOptionNames, 0, sizeof( setOptionNames ) );
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( 1 );
+    setsockopt_StubWithCallback( setsockopt_Stub );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+
+    /* The options are followed by the send and receive timeouts. */
+    TEST_ASSERT_EQUAL( TCP_NODELAY, setOptionNames[ 0 ] );
+    TEST_ASSERT_EQUAL( SO_KEEPALIVE, setOptionNames[ 1 ] );
+    TEST_ASSERT_EQUAL( TCP_KEEPIDLE, setOptionNames[ 2 ] );
+    TEST_ASSERT_EQUAL( 30, setOptionValues[ 2 ] );
+    TEST_ASSERT_EQUAL( SO_SNDBUF, setOptionNames[ 3 ] );
+    TEST_ASSERT_EQUAL( SO_RCVBUF, setOptionNames[ 4 ] );
+    TEST_ASSERT_EQUAL( 4096, setOptionValues[ 4 ] );
+    TEST_ASSERT_EQUAL( TCP_USER_TIMEOUT, setOptionNames[ 5 ] );
+    TEST_ASSERT_EQUAL( 5000, setOptionValues[ 5 ] );
+    TEST_ASSERT_EQUAL( SO_SNDTIMEO, setOptionNames[ 6 ] );
+    TEST_ASSERT_EQUAL( SO_RCVTIMEO, setOptionNames[ 7 ] );
+
+    setsockopt_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig records when connecting started,
+ * when DNS resolution completed and when the TCP connection was established.
+ */
+void test_Sockets_ConnectWithConfig_Records_Connect_Timing( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    ConnectTiming_t connectTiming;
+    int tcpSocket = -1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    memset( &connectTiming, 0, sizeof( ConnectTiming_t ) );
+    socketsConfig.pConnectTiming = &connectTiming;
+    fakeClockEnabled = true;
+    fakeClockUs = FAKE_CLOCK_START_US;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( 1 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+
+    /* The clock is read once at the start and once at the end of each phase. */
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US + FAKE_CLOCK_STEP_US, connectTiming.startUs );
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US + ( 2U * FAKE_CLOCK_STEP_US ), connectTiming.dnsResolvedUs );
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US + ( 3U * FAKE_CLOCK_STEP_US ), connectTiming.tcpConnectedUs );
+    TEST_ASSERT_FALSE( connectTiming.dnsCacheUsed );
+
+    /* The later phases belong to the TLS and MQTT layers. */
+    TEST_ASSERT_EQUAL( 0, connectTiming.tlsCertificateReceivedUs );
+    TEST_ASSERT_EQUAL( 0, connectTiming.tlsCertificateVerifiedUs );
+    TEST_ASSERT_EQUAL( 0, connectTiming.tlsHandshakeDoneUs );
+    TEST_ASSERT_EQUAL( 0, connectTiming.connackReceivedUs );
+
+    /* A start time set by the caller is kept, and the phases that are not
+     * reached stay zero. */
+    memset( &connectTiming, 0, sizeof( ConnectTiming_t ) );
+    connectTiming.startUs = PRESET_START_US;
+    fakeClockUs = FAKE_CLOCK_START_US;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( -1 );
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, socketStatus );
+    TEST_ASSERT_EQUAL( PRESET_START_US, connectTiming.startUs );
+    TEST_ASSERT_EQUAL( 0, connectTiming.dnsResolvedUs );
+    TEST_ASSERT_EQUAL( 0, connectTiming.tcpConnectedUs );
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US, fakeClockUs );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectWithConfig neither records nor reads the
+ * clock when no #ConnectTiming_t is passed.
+ */
+void test_Sockets_ConnectWithConfig_Without_Connect_Timing( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int tcpSocket = -1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+    fakeClockEnabled = true;
+    fakeClockUs = FAKE_CLOCK_START_US;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( 1 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_ConnectWithConfig( &tcpSocket,
+                                              &serverInfo,
+                                              &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( FAKE_CLOCK_START_US, fakeClockUs );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectUnix fails when invalid parameters are
+ * passed to the function.
+ */
+void test_Sockets_ConnectUnix_Invalid_Params( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    struct sockaddr_un address;
+    int unixSocket = -1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+
+    socketStatus = Sockets_ConnectUnix( NULL, UNIX_SOCKET_PATH,
+                                        UNIX_SOCKET_PATH_LENGTH, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, NULL,
+                                        UNIX_SOCKET_PATH_LENGTH, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        0U, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    /* The path must leave room for a terminating NUL. */
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        sizeof( address.sun_path ), &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        UNIX_SOCKET_PATH_LENGTH, NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+    TEST_ASSERT_EQUAL( -1, unixSocket );
+}
+
+/**
+ * @brief Stub for #connect that checks the Unix domain socket address.
+ */
+static int connect_Unix_Stub( int __fd,
+                              const struct sockaddr * __addr,
+                              socklen_t __len,
+                              int numCalls )
+{
+    const struct sockaddr_un * pAddress = ( const struct sockaddr_un * ) __addr;
+
+    ( void ) __fd;
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL( AF_UNIX, pAddress->sun_family );
+    TEST_ASSERT_EQUAL( offsetof( struct sockaddr_un, sun_path ) + UNIX_SOCKET_PATH_LENGTH, __len );
+    TEST_ASSERT_EQUAL_MEMORY( UNIX_SOCKET_PATH, pAddress->sun_path, UNIX_SOCKET_PATH_LENGTH );
+
+    return 0;
+}
+
+/**
+ * @brief Test that #Sockets_ConnectUnix connects to the path and sets the
+ * socket timeouts, or puts the socket in non-blocking mode.
+ */
+void test_Sockets_ConnectUnix_Succeeds( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int unixSocket = -1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+
+    socket_ExpectAndReturn( AF_UNIX, SOCK_STREAM, 0, 1 );
+    connect_StubWithCallback( connect_Unix_Stub );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        UNIX_SOCKET_PATH_LENGTH, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 1, unixSocket );
+
+    socketsConfig.nonBlocking = true;
+    socket_ExpectAndReturn( AF_UNIX, SOCK_STREAM, 0, 2 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        UNIX_SOCKET_PATH_LENGTH, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 2, unixSocket );
+
+    connect_StubWithCallback( NULL );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectUnix returns an error, and closes the
+ * socket it created, when the socket cannot be created, connected or
+ * configured.
+ */
+void test_Sockets_ConnectUnix_Fails( void )
+{
+    SocketStatus_t socketStatus;
+    SocketsConfig_t socketsConfig;
+    int unixSocket = -1;
+
+    memset( &socketsConfig, 0, sizeof( SocketsConfig_t ) );
+
+    /* Fail creating the socket. */
+    socket_ExpectAnyArgsAndReturn( -1 );
+    errno = ENOMEM;
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        UNIX_SOCKET_PATH_LENGTH, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_INSUFFICIENT_MEMORY, socketStatus );
+
+    /* Fail connecting, as when nothing listens on the path. */
+    socket_ExpectAnyArgsAndReturn( 1 );
+    connect_ExpectAnyArgsAndReturn( -1 );
+    errno = ENOENT;
+    close_ExpectAndReturn( 1, 0 );
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        UNIX_SOCKET_PATH_LENGTH, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+
+    /* Fail setting the timeouts. */
+    socket_ExpectAnyArgsAndReturn( 1 );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( -1 );
+    errno = EINVAL;
+    close_ExpectAndReturn( 1, 0 );
+
+    socketStatus = Sockets_ConnectUnix( &unixSocket, UNIX_SOCKET_PATH,
+                                        UNIX_SOCKET_PATH_LENGTH, &socketsConfig );
+    TEST_ASSERT_EQUAL( SOCKETS_API_ERROR, socketStatus );
+    TEST_ASSERT_EQUAL( -1, unixSocket );
+}
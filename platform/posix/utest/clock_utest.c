@@ -40,6 +40,8 @@
 /* Time conversion constants. */
 #define NANOSECONDS_PER_MILLISECOND    ( 1000000L )    /**< @brief Nanoseconds per millisecond. */
 #define MILLISECONDS_PER_SECOND        ( 1000L )
+#define NANOSECONDS_PER_SECOND         ( 1000000000L )
+#define NANOSECONDS_PER_MICROSECOND    ( 1000L )
 
 /**
  * @brief Used to make assertions on the arguments passed to #nanosleep
@@ -142,6 +144,60 @@ void test_Clock_GetTimeMs_Returns_Expected_Time_Guaranteed_Overflow( void )
     TEST_ASSERT_EQUAL( expectedTimeMs, actualTimeMs );
 }
 
+/**
+ * @brief Test that #Clock_GetTimeNs and #Clock_GetTimeUs return the full 64-bit
+ * time of the monotonic clock.
+ */
+void test_Clock_GetTimeNs_And_GetTimeUs_Return_Expected_Time( void )
+{
+    uint64_t expectedTimeNs;
+    struct timespec timeSpec;
+
+    /* A time in milliseconds that does not fit in 32 bits. */
+    timeSpec.tv_sec = ( time_t ) UINT32_MAX;
+    timeSpec.tv_nsec = GET_TIME_NS;
+
+    expectedTimeNs = ( ( uint64_t ) timeSpec.tv_sec * NANOSECONDS_PER_SECOND )
+                     + ( uint64_t ) timeSpec.tv_nsec;
+
+    clock_gettime_ExpectAndReturn( CLOCK_MONOTONIC, NULL, 0 );
+    clock_gettime_IgnoreArg_time_point();
+    clock_gettime_ReturnThruPtr_time_point( &timeSpec );
+    TEST_ASSERT_EQUAL_UINT64( expectedTimeNs, Clock_GetTimeNs() );
+
+    clock_gettime_ExpectAndReturn( CLOCK_MONOTONIC, NULL, 0 );
+    clock_gettime_IgnoreArg_time_point();
+    clock_gettime_ReturnThruPtr_time_point( &timeSpec );
+    TEST_ASSERT_EQUAL_UINT64( expectedTimeNs / NANOSECONDS_PER_MICROSECOND,
+                              Clock_GetTimeUs() );
+}
+
+/**
+ * @brief Test that #Clock_GetCoarseTimeMs reads the coarse clock where it is
+ * available.
+ */
+void test_Clock_GetCoarseTimeMs_Returns_Expected_Time( void )
+{
+    uint32_t expectedTimeMs;
+    struct timespec timeSpec;
+
+    timeSpec.tv_sec = GET_TIME_S;
+    timeSpec.tv_nsec = GET_TIME_NS;
+
+    #ifdef CLOCK_MONOTONIC_COARSE
+        clock_gettime_ExpectAndReturn( CLOCK_MONOTONIC_COARSE, NULL, 0 );
+    #else
+        clock_gettime_ExpectAndReturn( CLOCK_MONOTONIC, NULL, 0 );
+    #endif
+    clock_gettime_IgnoreArg_time_point();
+    clock_gettime_ReturnThruPtr_time_point( &timeSpec );
+
+    expectedTimeMs = ( timeSpec.tv_sec * MILLISECONDS_PER_SECOND )
+                     + ( timeSpec.tv_nsec / NANOSECONDS_PER_MILLISECOND );
+
+    TEST_ASSERT_EQUAL( expectedTimeMs, Clock_GetCoarseTimeMs() );
+}
+
 /**
  * @brief Test that the call to #nanosleep in #Clock_SleepMs receives the
  * expected parameter values.
@@ -0,0 +1,304 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "retry_scheduler.h"
+
+#include "mock_time_api.h"
+
+/* Parameters passed to #RetryUtils_ParamsInit. */
+#define MAX_ATTEMPTS          ( 3U )
+#define BASE_BACKOFF_MS       ( 100U )
+#define MAX_BACKOFF_MS        ( 1000U )
+#define SEED                  ( 7U )
+
+/* The time at which the tests start. */
+#define START_TIME_MS         ( 5000U )
+
+/* Parameters passed to #RetryUtils_BudgetInit. */
+#define BUDGET_REFILL_MS      ( 250U )
+
+static TimerWheel_t timerWheel;
+static RetryUtilsParams_t retryParams;
+static RetrySchedulerConfig_t schedulerConfig;
+static RetryScheduler_t scheduler;
+
+/* The time returned by #getTimeMs. */
+static uint32_t currentTimeMs;
+
+/* Number of attempts made, and the attempt that succeeds, or 0 for none. */
+static uint32_t attemptCount;
+static uint32_t succeedingAttempt;
+
+/* Number of calls to #onDone, and the result of the last one. */
+static uint32_t doneCount;
+static bool doneSucceeded;
+
+/* ========================================================================== */
+
+/**
+ * @brief The clock of the timer wheel used by the tests.
+ */
+static uint32_t getTimeMs( void )
+{
+    return currentTimeMs;
+}
+
+/**
+ * @brief Stub for #clock_gettime that keeps the system clock at 0.
+ */
+static int clock_gettime_Stub( clockid_t clock_id,
+                               struct timespec * time_point,
+                               int numCalls )
+{
+    ( void ) clock_id;
+    ( void ) numCalls;
+    ( void ) memset( time_point, 0, sizeof( struct timespec ) );
+
+    return 0;
+}
+
+/**
+ * @brief Attempt that succeeds only on #succeedingAttempt.
+ */
+static bool attempt( void * pContext )
+{
+    TEST_ASSERT_EQUAL_PTR( &scheduler, pContext );
+    attemptCount++;
+
+    return attemptCount == succeedingAttempt;
+}
+
+/**
+ * @brief Done function that records the result.
+ */
+static void onDone( void * pContext,
+                    bool succeeded )
+{
+    TEST_ASSERT_EQUAL_PTR( &scheduler, pContext );
+    doneCount++;
+    doneSucceeded = succeeded;
+}
+
+/**
+ * @brief Move the clock to the next scheduled attempt and run it.
+ */
+static void runNextAttempt( void )
+{
+    uint32_t deadlineMs;
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    currentTimeMs = deadlineMs;
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, currentTimeMs ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    currentTimeMs = START_TIME_MS;
+    attemptCount = 0U;
+    succeedingAttempt = 0U;
+    doneCount = 0U;
+    doneSucceeded = false;
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Init( &timerWheel, START_TIME_MS ) );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess,
+                       RetryUtils_ParamsInit( &retryParams, MAX_ATTEMPTS, BASE_BACKOFF_MS, MAX_BACKOFF_MS,
+                                              RetryUtilsDecorrelatedJitter, SEED ) );
+
+    memset( &schedulerConfig, 0, sizeof( schedulerConfig ) );
+    schedulerConfig.pTimerWheel = &timerWheel;
+    schedulerConfig.getTimeMs = getTimeMs;
+    schedulerConfig.attempt = attempt;
+    schedulerConfig.done = onDone;
+    schedulerConfig.pContext = &scheduler;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that the retry scheduler functions reject invalid parameters.
+ */
+void test_RetryScheduler_Invalid_Params( void )
+{
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Init( NULL, &schedulerConfig, &retryParams ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Init( &scheduler, NULL, &retryParams ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Init( &scheduler, &schedulerConfig, NULL ) );
+
+    schedulerConfig.pTimerWheel = NULL;
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Init( &scheduler, &schedulerConfig, &retryParams ) );
+    schedulerConfig.pTimerWheel = &timerWheel;
+    schedulerConfig.getTimeMs = NULL;
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Init( &scheduler, &schedulerConfig, &retryParams ) );
+    schedulerConfig.getTimeMs = getTimeMs;
+    schedulerConfig.attempt = NULL;
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Init( &scheduler, &schedulerConfig, &retryParams ) );
+
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Start( NULL ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerBadParameter, RetryScheduler_Cancel( NULL ) );
+    TEST_ASSERT_FALSE( RetryScheduler_IsPending( NULL ) );
+}
+
+/**
+ * @brief Test that failed attempts are retried after a backoff scheduled on
+ * the timer wheel until one succeeds.
+ */
+void test_RetryScheduler_Retries_Until_Success( void )
+{
+    uint32_t previousTimeMs;
+
+    succeedingAttempt = 3U;
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Init( &scheduler, &schedulerConfig, &retryParams ) );
+    TEST_ASSERT_FALSE( RetryScheduler_IsPending( &scheduler ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Start( &scheduler ) );
+    TEST_ASSERT_TRUE( RetryScheduler_IsPending( &scheduler ) );
+
+    /* The first attempt is made on the next advance. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, currentTimeMs ) );
+    TEST_ASSERT_EQUAL( 1U, attemptCount );
+    TEST_ASSERT_TRUE( RetryScheduler_IsPending( &scheduler ) );
+
+    /* The retries wait for at least the base backoff. */
+    while( RetryScheduler_IsPending( &scheduler ) )
+    {
+        previousTimeMs = currentTimeMs;
+        runNextAttempt();
+        TEST_ASSERT_GREATER_OR_EQUAL( previousTimeMs + BASE_BACKOFF_MS, currentTimeMs );
+    }
+
+    TEST_ASSERT_EQUAL( 3U, attemptCount );
+    TEST_ASSERT_EQUAL( 1U, doneCount );
+    TEST_ASSERT_TRUE( doneSucceeded );
+}
+
+/**
+ * @brief Test that the done function reports failure once the attempts are
+ * exhausted, and that the scheduler can be started again afterwards.
+ */
+void test_RetryScheduler_Attempts_Exhausted( void )
+{
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Init( &scheduler, &schedulerConfig, &retryParams ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Start( &scheduler ) );
+
+    while( RetryScheduler_IsPending( &scheduler ) )
+    {
+        runNextAttempt();
+    }
+
+    /* The first attempt and each of the retries. */
+    TEST_ASSERT_EQUAL( MAX_ATTEMPTS + 1U, attemptCount );
+    TEST_ASSERT_EQUAL( 1U, doneCount );
+    TEST_ASSERT_FALSE( doneSucceeded );
+
+    succeedingAttempt = attemptCount + 1U;
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Start( &scheduler ) );
+    runNextAttempt();
+    TEST_ASSERT_EQUAL( 2U, doneCount );
+    TEST_ASSERT_TRUE( doneSucceeded );
+}
+
+/**
+ * @brief Test that a canceled scheduler makes no more attempts, and that
+ * starting a pending scheduler has no effect.
+ */
+void test_RetryScheduler_Cancel( void )
+{
+    uint32_t deadlineMs, restartDeadlineMs;
+
+    schedulerConfig.done = NULL;
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Init( &scheduler, &schedulerConfig, &retryParams ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Start( &scheduler ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, currentTimeMs ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+
+    currentTimeMs += 10U;
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Start( &scheduler ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &restartDeadlineMs ) );
+    TEST_ASSERT_EQUAL( deadlineMs, restartDeadlineMs );
+
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Cancel( &scheduler ) );
+    TEST_ASSERT_FALSE( RetryScheduler_IsPending( &scheduler ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, deadlineMs ) );
+    TEST_ASSERT_EQUAL( 1U, attemptCount );
+    TEST_ASSERT_EQUAL( 0U, doneCount );
+}
+
+/**
+ * @brief Test that schedulers sharing a budget wait for it instead of making
+ * their attempts at the same time.
+ */
+void test_RetryScheduler_Waits_For_Budget( void )
+{
+    RetryUtilsBudget_t budget;
+    RetryUtilsBudgetStats_t stats;
+    RetryScheduler_t otherScheduler;
+
+    /* The budget reads the system clock, which stays at 0. */
+    clock_gettime_StubWithCallback( clock_gettime_Stub );
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetInit( &budget, 1U, BUDGET_REFILL_MS, 0U ) );
+    schedulerConfig.pBudget = &budget;
+    succeedingAttempt = 1U;
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Init( &scheduler, &schedulerConfig, &retryParams ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Init( &otherScheduler, &schedulerConfig, &retryParams ) );
+
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Start( &scheduler ) );
+    TEST_ASSERT_EQUAL( RetrySchedulerSuccess, RetryScheduler_Start( &otherScheduler ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, currentTimeMs ) );
+
+    /* Only one attempt was allowed; the other is scheduled after the refill. */
+    TEST_ASSERT_EQUAL( 1U, attemptCount );
+    TEST_ASSERT_EQUAL( 1U, doneCount );
+    TEST_ASSERT_TRUE( RetryScheduler_IsPending( &scheduler ) != RetryScheduler_IsPending( &otherScheduler ) );
+    TEST_ASSERT_EQUAL( BUDGET_REFILL_MS, TimerWheel_GetTimeoutMs( &timerWheel, currentTimeMs ) );
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetGetStats( &budget, &stats ) );
+    TEST_ASSERT_EQUAL( 1U, stats.granted );
+    TEST_ASSERT_EQUAL( 1U, stats.rateThrottled );
+    TEST_ASSERT_EQUAL( 0U, stats.inProgress );
+
+    clock_gettime_StubWithCallback( NULL );
+}
@@ -36,11 +36,26 @@
 /* Return value of mocked #rand. */
 #define RAND_RET_VAL            ( MAX_JITTER_VALUE_SECONDS + ( MAX_JITTER_VALUE_SECONDS / ( MAX_RETRY_ATTEMPTS ) ) )
 #define EXPECTED_NEXT_JITTER    ( RAND_RET_VAL % MAX_JITTER_VALUE_SECONDS )
+
+/* Parameters passed to #RetryUtils_ParamsInit. */
+#define TEST_MAX_ATTEMPTS       ( 20U )
+#define TEST_BASE_BACKOFF_MS    ( 100U )
+#define TEST_MAX_BACKOFF_MS     ( 30000U )
+#define TEST_SEED               ( 42U )
+
+/* Parameters passed to #RetryUtils_BudgetInit. */
+#define TEST_BUDGET_CAPACITY    ( 3U )
+#define TEST_REFILL_MS          ( 500U )
+#define TEST_MAX_IN_PROGRESS    ( 2U )
+#define TEST_START_TIME_S       ( 100 )
 /* Parameters to track the next max jitter or number of attempts done. */
 static RetryUtilsParams_t retryParams;
 /* Return value of #RetryUtils_BackoffAndSleep. */
 static RetryUtilsStatus_t retryUtilsStatus;
 
+/* The time returned by the mocked #clock_gettime. */
+static struct timespec currentTime;
+
 /* ============================   UNITY FIXTURES ============================ */
 
 /* Called before each test method. */
@@ -195,3 +210,284 @@ void test_RetryUtils_BackoffAndSleep_Upper_Bound_Jitter_To_Cap( void )
                        MAX_RETRY_BACKOFF_SECONDS );
     TEST_ASSERT_EQUAL( 1U, retryParams.attemptsDone );
 }
+
+/**
+ * @brief Test that #RetryUtils_ParamsInit and #RetryUtils_GetNextBackoffMs
+ * reject invalid parameters.
+ */
+void test_RetryUtils_ParamsInit_Invalid_Params( void )
+{
+    uint32_t nextBackoffMs;
+
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter,
+                       RetryUtils_ParamsInit( NULL, TEST_MAX_ATTEMPTS, TEST_BASE_BACKOFF_MS,
+                                              TEST_MAX_BACKOFF_MS, RetryUtilsFullJitter, TEST_SEED ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter,
+                       RetryUtils_ParamsInit( &retryParams, TEST_MAX_ATTEMPTS, 0U,
+                                              TEST_MAX_BACKOFF_MS, RetryUtilsFullJitter, TEST_SEED ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter,
+                       RetryUtils_ParamsInit( &retryParams, TEST_MAX_ATTEMPTS, TEST_BASE_BACKOFF_MS,
+                                              TEST_BASE_BACKOFF_MS - 1U, RetryUtilsFullJitter, TEST_SEED ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter,
+                       RetryUtils_ParamsInit( &retryParams, TEST_MAX_ATTEMPTS, TEST_BASE_BACKOFF_MS,
+                                              TEST_MAX_BACKOFF_MS, ( RetryUtilsJitter_t ) 2, TEST_SEED ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_GetNextBackoffMs( NULL, &nextBackoffMs ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_GetNextBackoffMs( &retryParams, NULL ) );
+}
+
+/**
+ * @brief Test that #RetryUtils_GetNextBackoffMs with full jitter returns delays
+ * below the doubling, capped ceiling, exhausts after the configured attempts,
+ * and is repeatable for a seed.
+ */
+void test_RetryUtils_GetNextBackoffMs_Full_Jitter( void )
+{
+    RetryUtilsParams_t sameSeedParams;
+    uint32_t nextBackoffMs, sameSeedBackoffMs, ceilingMs = TEST_BASE_BACKOFF_MS, i;
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess,
+                       RetryUtils_ParamsInit( &retryParams, TEST_MAX_ATTEMPTS, TEST_BASE_BACKOFF_MS,
+                                              TEST_MAX_BACKOFF_MS, RetryUtilsFullJitter, TEST_SEED ) );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess,
+                       RetryUtils_ParamsInit( &sameSeedParams, TEST_MAX_ATTEMPTS, TEST_BASE_BACKOFF_MS,
+                                              TEST_MAX_BACKOFF_MS, RetryUtilsFullJitter, TEST_SEED ) );
+
+    for( i = 0; i < TEST_MAX_ATTEMPTS; i++ )
+    {
+        TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_GetNextBackoffMs( &retryParams, &nextBackoffMs ) );
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32( ceilingMs, nextBackoffMs );
+        TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_GetNextBackoffMs( &sameSeedParams, &sameSeedBackoffMs ) );
+        TEST_ASSERT_EQUAL( nextBackoffMs, sameSeedBackoffMs );
+
+        ceilingMs = ( ceilingMs < ( TEST_MAX_BACKOFF_MS / 2U ) ) ? ( ceilingMs * 2U ) : TEST_MAX_BACKOFF_MS;
+    }
+
+    /* The attempts are reset once they are exhausted. */
+    TEST_ASSERT_EQUAL( RetryUtilsRetriesExhausted, RetryUtils_GetNextBackoffMs( &retryParams, &nextBackoffMs ) );
+    TEST_ASSERT_EQUAL( 0U, retryParams.attemptsDone );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_GetNextBackoffMs( &retryParams, &nextBackoffMs ) );
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32( TEST_BASE_BACKOFF_MS, nextBackoffMs );
+}
+
+/**
+ * @brief Test that #RetryUtils_GetNextBackoffMs with decorrelated jitter returns
+ * delays between the base backoff and three times the previous delay, capped
+ * at the maximum, and retries forever when the maximum attempts are 0.
+ */
+void test_RetryUtils_GetNextBackoffMs_Decorrelated_Jitter( void )
+{
+    uint32_t nextBackoffMs, previousBackoffMs = TEST_BASE_BACKOFF_MS, i;
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess,
+                       RetryUtils_ParamsInit( &retryParams, 0U, TEST_BASE_BACKOFF_MS,
+                                              TEST_MAX_BACKOFF_MS, RetryUtilsDecorrelatedJitter, TEST_SEED ) );
+
+    for( i = 0; i < ( TEST_MAX_ATTEMPTS * 5U ); i++ )
+    {
+        TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_GetNextBackoffMs( &retryParams, &nextBackoffMs ) );
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32( TEST_BASE_BACKOFF_MS, nextBackoffMs );
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32( TEST_MAX_BACKOFF_MS, nextBackoffMs );
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32( previousBackoffMs * 3U, nextBackoffMs );
+        previousBackoffMs = nextBackoffMs;
+    }
+}
+
+/**
+ * @brief Test that #RetryUtils_ParamsInit seeds the generator from the clock
+ * when the seed is 0, without using the process-wide #rand.
+ */
+void test_RetryUtils_ParamsInit_Seeds_From_Clock( void )
+{
+    currentTime.tv_sec = TEST_START_TIME_S;
+    currentTime.tv_nsec = 0;
+    clock_gettime_ExpectAnyArgsAndReturn( 0 );
+    clock_gettime_ReturnThruPtr_time_point( &currentTime );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess,
+                       RetryUtils_ParamsInit( &retryParams, TEST_MAX_ATTEMPTS, TEST_BASE_BACKOFF_MS,
+                                              TEST_MAX_BACKOFF_MS, RetryUtilsFullJitter, 0U ) );
+    TEST_ASSERT_NOT_EQUAL( 0U, retryParams.randomState );
+}
+
+/**
+ * @brief Expect a call to #clock_gettime that returns the current time plus
+ * an offset in milliseconds.
+ */
+static void expectTimeMs( uint32_t offsetMs )
+{
+    currentTime.tv_sec = TEST_START_TIME_S + ( time_t ) ( offsetMs / 1000U );
+    currentTime.tv_nsec = ( long ) ( offsetMs % 1000U ) * 1000000L;
+    clock_gettime_ExpectAnyArgsAndReturn( 0 );
+    clock_gettime_ReturnThruPtr_time_point( &currentTime );
+}
+
+/**
+ * @brief Test that the retry budget functions reject invalid parameters.
+ */
+void test_RetryUtils_Budget_Invalid_Params( void )
+{
+    RetryUtilsBudget_t budget;
+    RetryUtilsBudgetStats_t stats;
+
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetInit( NULL, TEST_BUDGET_CAPACITY, TEST_REFILL_MS, 0U ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetInit( &budget, 0U, TEST_REFILL_MS, 0U ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetInit( &budget, TEST_BUDGET_CAPACITY, 0U, 0U ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetInit( &budget, UINT32_MAX, TEST_REFILL_MS, 0U ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetAcquire( NULL, NULL ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetAcquireAndSleep( NULL ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetRelease( NULL ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetGetStats( NULL, &stats ) );
+    TEST_ASSERT_EQUAL( RetryUtilsBadParameter, RetryUtils_BudgetGetStats( &budget, NULL ) );
+}
+
+/**
+ * @brief Test that the retry budget allows a burst of its capacity, then one
+ * attempt per refill interval, and counts the refused attempts.
+ */
+void test_RetryUtils_Budget_Rate_Limit( void )
+{
+    RetryUtilsBudget_t budget;
+    RetryUtilsBudgetStats_t stats;
+    uint32_t waitMs = 0U, i;
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetInit( &budget, TEST_BUDGET_CAPACITY, TEST_REFILL_MS, 0U ) );
+
+    for( i = 0; i < TEST_BUDGET_CAPACITY; i++ )
+    {
+        expectTimeMs( 0U );
+        TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquire( &budget, &waitMs ) );
+        TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetRelease( &budget ) );
+    }
+
+    /* The bucket is empty until one refill interval has passed. */
+    expectTimeMs( 100U );
+    TEST_ASSERT_EQUAL( RetryUtilsThrottled, RetryUtils_BudgetAcquire( &budget, &waitMs ) );
+    TEST_ASSERT_EQUAL( TEST_REFILL_MS - 100U, waitMs );
+
+    expectTimeMs( TEST_REFILL_MS );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquire( &budget, NULL ) );
+    expectTimeMs( TEST_REFILL_MS );
+    TEST_ASSERT_EQUAL( RetryUtilsThrottled, RetryUtils_BudgetAcquire( &budget, NULL ) );
+
+    /* After a long idle period the bucket is full again, but no fuller. */
+    for( i = 0; i < TEST_BUDGET_CAPACITY; i++ )
+    {
+        expectTimeMs( 60000U );
+        TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquire( &budget, NULL ) );
+    }
+
+    expectTimeMs( 60000U );
+    TEST_ASSERT_EQUAL( RetryUtilsThrottled, RetryUtils_BudgetAcquire( &budget, &waitMs ) );
+    TEST_ASSERT_EQUAL( TEST_REFILL_MS, waitMs );
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetGetStats( &budget, &stats ) );
+    TEST_ASSERT_EQUAL( TEST_BUDGET_CAPACITY * 2U + 1U, stats.granted );
+    TEST_ASSERT_EQUAL( 3U, stats.rateThrottled );
+    TEST_ASSERT_EQUAL( 0U, stats.concurrencyThrottled );
+    TEST_ASSERT_EQUAL( TEST_BUDGET_CAPACITY + 1U, stats.inProgress );
+}
+
+/**
+ * @brief Test that the retry budget limits the attempts in progress, and that
+ * releasing an attempt allows another one.
+ */
+void test_RetryUtils_Budget_Concurrency_Limit( void )
+{
+    RetryUtilsBudget_t budget;
+    RetryUtilsBudgetStats_t stats;
+    uint32_t waitMs = 0U;
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess,
+                       RetryUtils_BudgetInit( &budget, TEST_BUDGET_CAPACITY, TEST_REFILL_MS, TEST_MAX_IN_PROGRESS ) );
+
+    expectTimeMs( 0U );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquire( &budget, NULL ) );
+    expectTimeMs( 0U );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquire( &budget, NULL ) );
+
+    /* The clock is not read when too many attempts are in progress. */
+    TEST_ASSERT_EQUAL( RetryUtilsThrottled, RetryUtils_BudgetAcquire( &budget, &waitMs ) );
+    TEST_ASSERT_EQUAL( TEST_REFILL_MS, waitMs );
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetRelease( &budget ) );
+    expectTimeMs( 0U );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquire( &budget, NULL ) );
+
+    /* A refused attempt because of the rate does not stay in progress. */
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetRelease( &budget ) );
+    expectTimeMs( 0U );
+    TEST_ASSERT_EQUAL( RetryUtilsThrottled, RetryUtils_BudgetAcquire( &budget, NULL ) );
+
+    /* Releasing more often than acquiring does not go below 0. */
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetRelease( &budget ) );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetRelease( &budget ) );
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetGetStats( &budget, &stats ) );
+    TEST_ASSERT_EQUAL( 3U, stats.granted );
+    TEST_ASSERT_EQUAL( 1U, stats.rateThrottled );
+    TEST_ASSERT_EQUAL( 1U, stats.concurrencyThrottled );
+    TEST_ASSERT_EQUAL( 0U, stats.inProgress );
+}
+
+/**
+ * @brief Test that #RetryUtils_BudgetAcquireAndSleep sleeps for the suggested
+ * wait until the attempt is allowed.
+ */
+void test_RetryUtils_BudgetAcquireAndSleep( void )
+{
+    RetryUtilsBudget_t budget;
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetInit( &budget, 1U, TEST_REFILL_MS, 0U ) );
+
+    expectTimeMs( 0U );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquireAndSleep( &budget ) );
+
+    expectTimeMs( 200U );
+    nanosleep_ExpectAnyArgsAndReturn( 0 );
+    expectTimeMs( TEST_REFILL_MS );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquireAndSleep( &budget ) );
+}
+
+/**
+ * @brief Test that #RetryUtils_BackoffAndSleep releases the attempt that failed
+ * to the budget of the parameters, and waits for the budget before the next.
+ */
+void test_RetryUtils_BackoffAndSleep_Draws_From_Budget( void )
+{
+    RetryUtilsBudget_t budget = RETRY_UTILS_BUDGET_INITIALIZER( 1U, TEST_REFILL_MS, 1U );
+    RetryUtilsBudgetStats_t stats;
+
+    clock_gettime_ExpectAnyArgsAndReturn( 0 );
+    rand_ExpectAndReturn( RAND_RET_VAL );
+    RetryUtils_ParamsReset( &retryParams );
+    TEST_ASSERT_NULL( retryParams.pBudget );
+    retryParams.pBudget = &budget;
+
+    /* The application takes the first attempt. */
+    expectTimeMs( 0U );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetAcquire( &budget, NULL ) );
+
+    /* The retry waits for the backoff, then for the bucket to refill. */
+    rand_ExpectAndReturn( RAND_RET_VAL );
+    sleep_ExpectAndReturn( RAND_RET_VAL % retryParams.nextJitterMax, 0 );
+    expectTimeMs( 100U );
+    nanosleep_ExpectAnyArgsAndReturn( 0 );
+    expectTimeMs( TEST_REFILL_MS );
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BackoffAndSleep( &retryParams ) );
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetGetStats( &budget, &stats ) );
+    TEST_ASSERT_EQUAL( 2U, stats.granted );
+    TEST_ASSERT_EQUAL( 1U, stats.rateThrottled );
+    TEST_ASSERT_EQUAL( 1U, stats.inProgress );
+
+    /* When retries are exhausted, the last attempt is released and no other
+     * is taken. */
+    retryParams.attemptsDone = MAX_RETRY_ATTEMPTS;
+    clock_gettime_ExpectAnyArgsAndReturn( 0 );
+    rand_ExpectAndReturn( RAND_RET_VAL );
+    TEST_ASSERT_EQUAL( RetryUtilsRetriesExhausted, RetryUtils_BackoffAndSleep( &retryParams ) );
+    TEST_ASSERT_NULL( retryParams.pBudget );
+
+    TEST_ASSERT_EQUAL( RetryUtilsSuccess, RetryUtils_BudgetGetStats( &budget, &stats ) );
+    TEST_ASSERT_EQUAL( 2U, stats.granted );
+    TEST_ASSERT_EQUAL( 0U, stats.inProgress );
+}
@@ -0,0 +1,396 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "timer_wheel.h"
+
+/* The time at which the wheel starts in most tests. */
+#define START_TIME_MS      ( 1000U )
+
+/* The number of timers used by the tests. */
+#define TIMER_COUNT        ( 8U )
+
+/* A time later than the range covered by the levels of the wheel. */
+#define FAR_TIMEOUT_MS     ( 20000000U )
+
+static TimerWheel_t timerWheel;
+static TimerWheelTimer_t timers[ TIMER_COUNT ];
+
+/* Order in which the timers expired, and the time of the wheel when they did. */
+static TimerWheelTimer_t * expiredTimers[ TIMER_COUNT * 2U ];
+static size_t expiredCount;
+
+/* ========================================================================== */
+
+/**
+ * @brief Callback that records the timer that expired.
+ */
+static void recordExpiry( TimerWheelTimer_t * pTimer,
+                          void * pContext )
+{
+    ( void ) pContext;
+
+    TEST_ASSERT_FALSE( TimerWheel_IsArmed( pTimer ) );
+    TEST_ASSERT_LESS_THAN( TIMER_COUNT * 2U, expiredCount );
+    expiredTimers[ expiredCount ] = pTimer;
+    expiredCount++;
+}
+
+/**
+ * @brief Callback that arms its timer again after the period in its context.
+ */
+static void rearmTimer( TimerWheelTimer_t * pTimer,
+                        void * pContext )
+{
+    recordExpiry( pTimer, NULL );
+    ( void ) TimerWheel_Arm( &timerWheel,
+                             pTimer,
+                             pTimer->expiryMs + *( ( uint32_t * ) pContext ) );
+}
+
+/**
+ * @brief Callback that cancels the next timer in the array.
+ */
+static void cancelNextTimer( TimerWheelTimer_t * pTimer,
+                             void * pContext )
+{
+    ( void ) pContext;
+
+    recordExpiry( pTimer, NULL );
+    ( void ) TimerWheel_Cancel( &timerWheel, &pTimer[ 1 ] );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    size_t i;
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Init( &timerWheel, START_TIME_MS ) );
+
+    for( i = 0; i < TIMER_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_InitTimer( &timers[ i ], recordExpiry, NULL ) );
+    }
+
+    memset( expiredTimers, 0, sizeof( expiredTimers ) );
+    expiredCount = 0;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that the timer wheel functions reject NULL parameters.
+ */
+void test_TimerWheel_Invalid_Params( void )
+{
+    uint32_t deadlineMs;
+
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_Init( NULL, 0U ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_InitTimer( NULL, recordExpiry, NULL ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_InitTimer( &timers[ 0 ], NULL, NULL ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_Arm( NULL, &timers[ 0 ], 0U ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_Arm( &timerWheel, NULL, 0U ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_Cancel( NULL, &timers[ 0 ] ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_Cancel( &timerWheel, NULL ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_Advance( NULL, 0U ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_NextDeadline( NULL, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( TimerWheelBadParameter, TimerWheel_NextDeadline( &timerWheel, NULL ) );
+    TEST_ASSERT_EQUAL( TIMER_WHEEL_WAIT_FOREVER, TimerWheel_GetTimeoutMs( NULL, 0U ) );
+    TEST_ASSERT_FALSE( TimerWheel_IsArmed( NULL ) );
+}
+
+/**
+ * @brief Test that timers expire in order of expiry, once the wheel reaches
+ * their expiry time, including after an expiry time that has passed.
+ */
+void test_TimerWheel_Expires_In_Order( void )
+{
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], START_TIME_MS + 5000U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], START_TIME_MS + 10U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 2 ], START_TIME_MS + 300000U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 3 ], START_TIME_MS - 10U ) );
+    TEST_ASSERT_TRUE( TimerWheel_IsArmed( &timers[ 0 ] ) );
+
+    /* The timer whose expiry has passed expires first. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 3 ], expiredTimers[ 0 ] );
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 9U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 10U ) );
+    TEST_ASSERT_EQUAL( 2, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 1 ], expiredTimers[ 1 ] );
+
+    /* Advancing over several expiries at once runs them in order. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 400000U ) );
+    TEST_ASSERT_EQUAL( 4, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 0 ], expiredTimers[ 2 ] );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 2 ], expiredTimers[ 3 ] );
+    TEST_ASSERT_FALSE( TimerWheel_IsArmed( &timers[ 0 ] ) );
+
+    /* A time before the current time of the wheel has no effect. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], START_TIME_MS + 400010U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS ) );
+    TEST_ASSERT_EQUAL( 4, expiredCount );
+}
+
+/**
+ * @brief Test that a canceled timer does not expire, and that arming an armed
+ * timer moves it.
+ */
+void test_TimerWheel_Cancel_And_Rearm( void )
+{
+    uint32_t deadlineMs;
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], START_TIME_MS + 100U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], START_TIME_MS + 200U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Cancel( &timerWheel, &timers[ 0 ] ) );
+    TEST_ASSERT_FALSE( TimerWheel_IsArmed( &timers[ 0 ] ) );
+
+    /* Canceling a timer that is not armed has no effect. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Cancel( &timerWheel, &timers[ 0 ] ) );
+
+    /* Move the second timer earlier. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], START_TIME_MS + 50U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( START_TIME_MS + 50U, deadlineMs );
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 1000U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 1 ], expiredTimers[ 0 ] );
+    TEST_ASSERT_EQUAL( TimerWheelNoTimers, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+}
+
+/**
+ * @brief Test that callbacks can arm their own timer again and cancel timers
+ * that expired at the same time but have not run yet.
+ */
+void test_TimerWheel_Callbacks_Arm_And_Cancel( void )
+{
+    uint32_t periodMs = 100U;
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_InitTimer( &timers[ 0 ], rearmTimer, &periodMs ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], START_TIME_MS + periodMs ) );
+
+    /* The periodic timer expires once per period. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 350U ) );
+    TEST_ASSERT_EQUAL( 3, expiredCount );
+    TEST_ASSERT_TRUE( TimerWheel_IsArmed( &timers[ 0 ] ) );
+    TEST_ASSERT_EQUAL( 50U, TimerWheel_GetTimeoutMs( &timerWheel, START_TIME_MS + 350U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Cancel( &timerWheel, &timers[ 0 ] ) );
+
+    /* The first of two timers with the same expiry cancels the second. */
+    expiredCount = 0;
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_InitTimer( &timers[ 1 ], cancelNextTimer, NULL ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 2 ], START_TIME_MS + 400U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], START_TIME_MS + 400U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 400U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 1 ], expiredTimers[ 0 ] );
+    TEST_ASSERT_FALSE( TimerWheel_IsArmed( &timers[ 2 ] ) );
+    TEST_ASSERT_EQUAL( TIMER_WHEEL_WAIT_FOREVER, TimerWheel_GetTimeoutMs( &timerWheel, START_TIME_MS + 400U ) );
+}
+
+/**
+ * @brief Test that the next deadline is exact for timers in every level,
+ * including after they moved down between levels.
+ */
+void test_TimerWheel_NextDeadline_Across_Levels( void )
+{
+    uint32_t deadlineMs;
+
+    /* A timer in level 2, then one in level 1 that expires earlier. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], START_TIME_MS + 100003U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( START_TIME_MS + 100003U, deadlineMs );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], START_TIME_MS + 1234U ) );
+    TEST_ASSERT_EQUAL( 1234U, TimerWheel_GetTimeoutMs( &timerWheel, START_TIME_MS ) );
+
+    /* After advancing close to the timer in level 2, it has moved down and is
+     * still reported exactly, ahead of a later timer in level 0. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 100000U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 2 ], START_TIME_MS + 100040U ) );
+    TEST_ASSERT_EQUAL( 3U, TimerWheel_GetTimeoutMs( &timerWheel, START_TIME_MS + 100000U ) );
+
+    /* An expiry that has passed gives a timeout of 0. */
+    TEST_ASSERT_EQUAL( 0U, TimerWheel_GetTimeoutMs( &timerWheel, START_TIME_MS + 100010U ) );
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 100040U ) );
+    TEST_ASSERT_EQUAL( 3, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 0 ], expiredTimers[ 1 ] );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 2 ], expiredTimers[ 2 ] );
+
+    /* Stop just before the start of the level 1 slot of a timer, so that it
+     * has not moved down yet, while a later timer is also in level 1. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Init( &timerWheel, 0U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], 200U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], 1300U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, 191U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( 200U, deadlineMs );
+}
+
+/**
+ * @brief Test that a timer parked beyond the range of the wheel does not hide
+ * a nearer timer in a later slot of the top level.
+ */
+void test_TimerWheel_NextDeadline_With_Parked_Timer( void )
+{
+    uint32_t deadlineMs;
+    uint32_t nowMs = START_TIME_MS + ( 3U << 18 );
+
+    /* The far timer is parked in the top level slot of the start time. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], START_TIME_MS + ( 1U << 25 ) ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, nowMs ) );
+
+    /* A nearer timer lands in the top level slot after the parked one. */
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], 17300000U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( 17300000U, deadlineMs );
+    TEST_ASSERT_EQUAL( 17300000U - nowMs, TimerWheel_GetTimeoutMs( &timerWheel, nowMs ) );
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, 17300000U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 1 ], expiredTimers[ 0 ] );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( START_TIME_MS + ( 1U << 25 ), deadlineMs );
+}
+
+/**
+ * @brief Test that a timer armed for the time the wheel was last advanced to
+ * expires one millisecond later, as reported by the next deadline.
+ */
+void test_TimerWheel_Arm_At_Processed_Time( void )
+{
+    uint32_t deadlineMs;
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], START_TIME_MS ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( START_TIME_MS + 1U, deadlineMs );
+    TEST_ASSERT_EQUAL( 1U, TimerWheel_GetTimeoutMs( &timerWheel, START_TIME_MS ) );
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS ) );
+    TEST_ASSERT_EQUAL( 0, expiredCount );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, START_TIME_MS + 1U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+}
+
+/**
+ * @brief Test timers beyond the range of the levels of the wheel, and timers
+ * across the wrap around of the 32-bit time.
+ */
+void test_TimerWheel_Far_Timers_And_Wrap_Around( void )
+{
+    uint32_t deadlineMs;
+    uint32_t startMs = UINT32_MAX - 1000U;
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Init( &timerWheel, startMs ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 0 ], startMs + FAR_TIMEOUT_MS ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ 1 ], startMs + 2000U ) );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+    TEST_ASSERT_EQUAL( startMs + 2000U, deadlineMs );
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, startMs + 2000U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 1 ], expiredTimers[ 0 ] );
+    TEST_ASSERT_EQUAL( FAR_TIMEOUT_MS - 2000U, TimerWheel_GetTimeoutMs( &timerWheel, startMs + 2000U ) );
+
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, startMs + FAR_TIMEOUT_MS - 1U ) );
+    TEST_ASSERT_EQUAL( 1, expiredCount );
+    TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, startMs + FAR_TIMEOUT_MS ) );
+    TEST_ASSERT_EQUAL( 2, expiredCount );
+    TEST_ASSERT_EQUAL_PTR( &timers[ 0 ], expiredTimers[ 1 ] );
+}
+
+/**
+ * @brief Test that many timers with pseudo-random expiries each expire exactly
+ * at their expiry time while the wheel advances in uneven steps.
+ */
+void test_TimerWheel_Expires_Exactly_On_Time( void )
+{
+    uint32_t expiries[ TIMER_COUNT ];
+    uint32_t nowMs = START_TIME_MS, seed = 12345U, deadlineMs, round;
+    size_t i, previousCount;
+
+    for( round = 0; round < 200U; round++ )
+    {
+        for( i = 0; i < TIMER_COUNT; i++ )
+        {
+            if( !TimerWheel_IsArmed( &timers[ i ] ) )
+            {
+                seed = ( seed * 1103515245U ) + 12345U;
+                expiries[ i ] = nowMs + 1U + ( ( seed >> 8 ) % ( 1U << ( ( seed % 5U ) * 5U + 2U ) ) );
+                TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Arm( &timerWheel, &timers[ i ], expiries[ i ] ) );
+            }
+        }
+
+        /* Jump to the next deadline, which must be the expiry of some timer. */
+        TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_NextDeadline( &timerWheel, &deadlineMs ) );
+        nowMs = deadlineMs;
+        previousCount = expiredCount;
+        TEST_ASSERT_EQUAL( TimerWheelSuccess, TimerWheel_Advance( &timerWheel, nowMs ) );
+        TEST_ASSERT_GREATER_OR_EQUAL( previousCount + 1U, expiredCount );
+
+        /* Every timer that expired did so at its expiry, and no other one is due. */
+        for( i = 0; i < TIMER_COUNT; i++ )
+        {
+            if( TimerWheel_IsArmed( &timers[ i ] ) )
+            {
+                TEST_ASSERT_TRUE( ( int32_t ) ( expiries[ i ] - nowMs ) > 0 );
+            }
+        }
+
+        for( i = previousCount; i < expiredCount; i++ )
+        {
+            TEST_ASSERT_EQUAL( nowMs, expiries[ expiredTimers[ i ] - timers ] );
+        }
+
+        expiredCount = 0;
+    }
+}
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+Decode records produced by the binary logging backend of the logging stack
+(demos/logging-stack/binary_log.h) back into text log lines.
+
+The format strings, file names and library names are not stored in the
+records; they are read from the unstripped executable that produced them.
+"""
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct("<HBBIIiii")
+LEVELS = {1: "ERROR", 2: "WARN", 3: "INFO", 4: "DEBUG"}
+ANCHOR_SYMBOL = "BinLog_Anchor"
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHT_DYNSYM = 11
+SHF_ALLOC = 0x2
+
+
+class Elf:
+    """
+    Minimal ELF reader that resolves symbols and strings at link-time
+    addresses.
+    """
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError(f"{path} is not an ELF file")
+        self.is64 = self.data[4] == 2
+        self.endian = "<" if self.data[5] == 1 else ">"
+        if self.is64:
+            shoff, = struct.unpack_from(self.endian + "Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(self.endian + "HH", self.data, 0x3A)
+            fmt = "IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from(self.endian + "I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(self.endian + "HH", self.data, 0x2E)
+            fmt = "IIIIIIIIII"
+        self.sections = []
+        for i in range(shnum):
+            name, stype, flags, addr, offset, size, link, _, _, entsize = struct.unpack_from(
+                self.endian + fmt, self.data, shoff + i * shentsize
+            )
+            self.sections.append(
+                dict(type=stype, flags=flags, addr=addr, offset=offset, size=size, link=link, entsize=entsize)
+            )
+
+    def cstring_at_offset(self, offset):
+        end = self.data.index(b"\0", offset)
+        return self.data[offset:end].decode("utf-8", "replace")
+
+    def symbol(self, wanted):
+        """
+        Return the address of a symbol from .symtab, or .dynsym if stripped.
+        """
+        for stype in (SHT_SYMTAB, SHT_DYNSYM):
+            for sec in self.sections:
+                if sec["type"] != stype:
+                    continue
+                strtab = self.sections[sec["link"]]
+                for i in range(sec["size"] // sec["entsize"]):
+                    base = sec["offset"] + i * sec["entsize"]
+                    if self.is64:
+                        name, _, _, _, value, _ = struct.unpack_from(self.endian + "IBBHQQ", self.data, base)
+                    else:
+                        name, value, _, _, _, _ = struct.unpack_from(self.endian + "IIIBBH", self.data, base)
+                    if self.cstring_at_offset(strtab["offset"] + name) == wanted:
+                        return value
+        raise KeyError(f"symbol {wanted} not found; is the executable stripped?")
+
+    def string_at(self, address):
+        for sec in self.sections:
+            if (
+                sec["flags"] & SHF_ALLOC
+                and sec["type"] != SHT_NOBITS
+                and sec["addr"] <= address < sec["addr"] + sec["size"]
+            ):
+                return self.cstring_at_offset(sec["offset"] + address - sec["addr"])
+        raise KeyError(f"no string at address 0x{address:x}")
+
+
+class Reader:
+    """
+    Sequential little-endian reader over the argument bytes of one record.
+    """
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, size):
+        if self.pos + size > len(self.data):
+            raise EOFError
+        chunk = self.data[self.pos : self.pos + size]
+        self.pos += size
+        return chunk
+
+    def integer(self, size, signed):
+        return int.from_bytes(self.take(size), "little", signed=signed)
+
+
+def format_message(fmt, args):
+    """
+    Rebuild a printf-style message, walking the format the same way the
+    encoder in binary_log.c does.
+    """
+    reader = Reader(args)
+    out = []
+    i = 0
+    while i < len(fmt):
+        if fmt[i] != "%":
+            out.append(fmt[i])
+            i += 1
+            continue
+        i += 1
+        if i < len(fmt) and fmt[i] == "%":
+            out.append("%")
+            i += 1
+            continue
+        start = i
+        try:
+            spec = "%"
+            while i < len(fmt) and fmt[i] in "-+ #0":
+                spec += fmt[i]
+                i += 1
+            if i < len(fmt) and fmt[i] == "*":
+                spec += str(reader.integer(4, True))
+                i += 1
+            while i < len(fmt) and fmt[i].isdigit():
+                spec += fmt[i]
+                i += 1
+            if i < len(fmt) and fmt[i] == ".":
+                spec += "."
+                i += 1
+                if i < len(fmt) and fmt[i] == "*":
+                    spec += str(max(reader.integer(4, True), 0))
+                    i += 1
+                while i < len(fmt) and fmt[i].isdigit():
+                    spec += fmt[i]
+                    i += 1
+            wide = False
+            if fmt.startswith(("hh", "ll"), i):
+                wide = fmt[i] == "l"
+                i += 2
+            elif i < len(fmt) and fmt[i] in "hlzjtL":
+                wide = fmt[i] != "h" and fmt[i] != "L"
+                i += 1
+            conv = fmt[i] if i < len(fmt) else ""
+            i += 1
+            if conv in "di":
+                out.append((spec + "d") % reader.integer(8 if wide else 4, True))
+            elif conv in "uoxXc":
+                out.append((spec + ("d" if conv == "u" else conv)) % reader.integer(8 if wide else 4, False))
+            elif conv == "p":
+                out.append("0x%x" % reader.integer(8, False))
+            elif conv in "fFeEgGaA":
+                value = struct.unpack("<d", reader.take(8))[0]
+                out.append(value.hex() if conv in "aA" else (spec + conv) % value)
+            elif conv == "s":
+                length = reader.integer(2, False)
+                out.append((spec + "s") % reader.take(length).decode("utf-8", "replace"))
+            elif conv == "n":
+                pass
+            else:
+                out.append(fmt[start - 1 :])
+                break
+        except EOFError:
+            out.append("<truncated>")
+            break
+    return "".join(out)
+
+
+def decode(elf, stream, out):
+    anchor = elf.symbol(ANCHOR_SYMBOL)
+    pos = 0
+    while pos + HEADER.size <= len(stream):
+        length, level, _, timestamp, line, fmt_off, file_off, lib_off = HEADER.unpack_from(stream, pos)
+        if length < HEADER.size or pos + length > len(stream):
+            print(f"Corrupt record at offset {pos}; stopping.", file=sys.stderr)
+            break
+        message = format_message(elf.string_at(anchor + fmt_off), stream[pos + HEADER.size : pos + length])
+        file_name = elf.string_at(anchor + file_off).rsplit("/", 1)[-1]
+        library = elf.string_at(anchor + lib_off)
+        out.write(
+            f"{timestamp} [{LEVELS.get(level, level)}] [{library}] [{file_name}:{line}] {message}\n"
+        )
+        pos += length
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("executable", help="Unstripped executable that produced the records")
+    parser.add_argument("records", help="File of records drained with BinLog_Read")
+    args = parser.parse_args()
+
+    with open(args.records, "rb") as f:
+        stream = f.read()
+    decode(Elf(args.executable), stream, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
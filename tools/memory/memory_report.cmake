@@ -0,0 +1,68 @@
+# Functions to report the static memory of every target after it is built,
+# used when BUILD_MEMORY_INSTRUMENTATION is ON.
+
+find_program( SIZE_TOOL NAMES size llvm-size )
+
+# Collect the executables and libraries defined in a directory and the
+# directories below it.
+function(collect_size_report_targets directory out_var)
+    get_property(directory_targets DIRECTORY ${directory} PROPERTY BUILDSYSTEM_TARGETS)
+    get_property(subdirectories DIRECTORY ${directory} PROPERTY SUBDIRECTORIES)
+    set(targets "")
+
+    foreach(target IN LISTS directory_targets)
+        get_target_property(target_type ${target} TYPE)
+        get_target_property(exclude_from_all ${target} EXCLUDE_FROM_ALL)
+
+        # Demos without credentials are not built by default.
+        if(target_type MATCHES "^(EXECUTABLE|STATIC_LIBRARY|SHARED_LIBRARY)$" AND NOT exclude_from_all)
+            list(APPEND targets ${target})
+        endif()
+    endforeach()
+
+    foreach(subdirectory IN LISTS subdirectories)
+        collect_size_report_targets(${subdirectory} subdirectory_targets)
+        list(APPEND targets ${subdirectory_targets})
+    endforeach()
+
+    set(${out_var} ${targets} PARENT_SCOPE)
+endfunction()
+
+# Add a memory_report target, built by default, that writes the text, data
+# and bss sizes of every target and its largest RAM symbols to
+# memory_report/<target>.txt in the build directory.
+function(add_memory_report)
+    if(CMAKE_VERSION VERSION_LESS 3.7)
+        message(WARNING "The memory report needs CMake 3.7 or later to list the targets.")
+        return()
+    endif()
+
+    if(NOT SIZE_TOOL OR NOT CMAKE_NM)
+        message(WARNING "The memory report needs the size and nm tools, which were not found.")
+        return()
+    endif()
+
+    collect_size_report_targets(${CMAKE_SOURCE_DIR} report_targets)
+    set(report_commands "")
+
+    foreach(target IN LISTS report_targets)
+        list(APPEND report_commands
+             COMMAND ${CMAKE_COMMAND}
+                 -DTARGET_NAME=${target}
+                 -DTARGET_FILE=$<TARGET_FILE:${target}>
+                 -DREPORT_DIR=${CMAKE_BINARY_DIR}/memory_report
+                 -DSIZE_TOOL=${SIZE_TOOL}
+                 -DNM_TOOL=${CMAKE_NM}
+                 -P ${ROOT_DIR}/tools/memory/size_report.cmake)
+    endforeach()
+
+    add_custom_target(memory_report ALL
+        ${report_commands}
+        WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        COMMENT "Reporting the static memory of each target in ${CMAKE_BINARY_DIR}/memory_report"
+    )
+
+    if(report_targets)
+        add_dependencies(memory_report ${report_targets})
+    endif()
+endfunction()
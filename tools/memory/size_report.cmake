@@ -0,0 +1,52 @@
+# Write the static memory of one built target to REPORT_DIR/TARGET_NAME.txt.
+# Run with cmake -P, defining TARGET_NAME, TARGET_FILE, REPORT_DIR, SIZE_TOOL
+# and NM_TOOL.
+
+# Number of the largest RAM symbols to list.
+set(LARGEST_SYMBOL_COUNT 15)
+
+file(MAKE_DIRECTORY ${REPORT_DIR})
+set(report_file "${REPORT_DIR}/${TARGET_NAME}.txt")
+
+# The Berkeley format lists each object of a library, and -t adds their totals.
+execute_process(COMMAND ${SIZE_TOOL} -t ${TARGET_FILE}
+                OUTPUT_VARIABLE size_output
+                ERROR_QUIET)
+
+# Symbols in the data (d) and bss (b) sections take RAM, and are usually
+# buffers such as the network buffer of a demo.
+execute_process(COMMAND ${NM_TOOL} --size-sort --radix=d -S ${TARGET_FILE}
+                OUTPUT_VARIABLE nm_output
+                ERROR_QUIET)
+
+string(REPLACE "\n" ";" nm_lines "${nm_output}")
+set(ram_symbols "")
+
+foreach(line IN LISTS nm_lines)
+    if(line MATCHES "^[0-9]+ ([0-9]+) [bBdD] (.+)$")
+        # Drop the leading zeros of the size.
+        math(EXPR symbol_size "${CMAKE_MATCH_1}")
+        list(INSERT ram_symbols 0 "${symbol_size} ${CMAKE_MATCH_2}")
+    endif()
+endforeach()
+
+set(report "Target: ${TARGET_NAME}\nFile: ${TARGET_FILE}\n\n${size_output}\nLargest RAM symbols (bytes name):\n")
+set(symbol_count 0)
+
+foreach(symbol IN LISTS ram_symbols)
+    if(symbol_count LESS LARGEST_SYMBOL_COUNT)
+        set(report "${report}  ${symbol}\n")
+        math(EXPR symbol_count "${symbol_count} + 1")
+    endif()
+endforeach()
+
+file(WRITE ${report_file} "${report}")
+
+# Print the totals, which are the last line of the size output.
+string(STRIP "${size_output}" size_output)
+string(REGEX MATCH "[^\n]*$" totals "${size_output}")
+
+if(totals MATCHES "^[ \t]*([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)")
+    math(EXPR ram_bytes "${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+    message("${TARGET_NAME}: text=${CMAKE_MATCH_1} data=${CMAKE_MATCH_2} bss=${CMAKE_MATCH_3} static RAM=${ram_bytes} bytes")
+endif()